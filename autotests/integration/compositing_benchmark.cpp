@@ -0,0 +1,300 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include <config-kwin.h>
+
+#include "composite.h"
+#include "core/output.h"
+#include "core/platform.h"
+#include "core/renderloop.h"
+#include "core/renderloop_p.h"
+#include "effectloader.h"
+#include "utils/allocationtracker.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <KWayland/Client/buffer.h>
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/surface.h>
+
+#include <QPainter>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+
+#if KWIN_BUILD_ALLOCATION_TRACKING
+// KWin counts every heap allocation itself, including the ones of the Qt containers.
+static quint64 allocationCount()
+{
+    return KWin::AllocationTracker::allocationCount();
+}
+#else
+// Counts the allocations made by the current thread, so the compositor can be told apart from
+// the Wayland client connection thread.
+static thread_local quint64 s_allocationCount = 0;
+
+static quint64 allocationCount()
+{
+    return s_allocationCount;
+}
+
+void *operator new(std::size_t size)
+{
+    ++s_allocationCount;
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+namespace KWin
+{
+
+enum class DamagePattern {
+    FullScreenVideo,
+    TypingTerminal,
+    Tooltips,
+};
+
+} // namespace KWin
+
+Q_DECLARE_METATYPE(KWin::DamagePattern)
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_compositing_benchmark-0");
+
+static std::chrono::nanoseconds threadCpuTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+static std::chrono::nanoseconds percentile(const QVector<std::chrono::nanoseconds> &sortedValues, int percent)
+{
+    const int index = std::min<int>(sortedValues.count() - 1, sortedValues.count() * percent / 100);
+    return sortedValues[index];
+}
+
+static double toMilliseconds(std::chrono::nanoseconds value)
+{
+    return std::chrono::duration<double, std::milli>(value).count();
+}
+
+/**
+ * The compositing benchmark runs KWin on the virtual backend and measures how expensive it is
+ * to composite the frames produced by a few synthetic clients with scripted damage patterns.
+ *
+ * The number of measured frames can be changed with the KWIN_BENCHMARK_FRAMES environment
+ * variable, the compositing type with KWIN_COMPOSE as usual.
+ *
+ * If KWIN_BENCHMARK_MAX_ALLOCATIONS is set, the benchmark fails if the compositor makes more
+ * allocations per frame, so CI can keep the allocations from creeping back. Without the
+ * KWIN_BUILD_ALLOCATION_TRACKING build option only the allocations with operator new are
+ * counted, with it every allocation is, and they are reported by phase.
+ */
+class CompositingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkComposite_data();
+    void benchmarkComposite();
+};
+
+struct BenchmarkClient
+{
+    std::unique_ptr<KWayland::Client::Surface> surface;
+    std::unique_ptr<Test::XdgToplevel> shellSurface;
+    QSize size;
+};
+
+void CompositingBenchmark::initTestCase()
+{
+    qRegisterMetaType<KWin::Window *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // disable all effects - they would dominate the measurements
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    if (!qEnvironmentVariableIsSet("KWIN_COMPOSE")) {
+        qputenv("KWIN_COMPOSE", QByteArrayLiteral("Q"));
+    }
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+}
+
+void CompositingBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CompositingBenchmark::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void CompositingBenchmark::benchmarkComposite_data()
+{
+    QTest::addColumn<DamagePattern>("pattern");
+    QTest::addColumn<int>("clientCount");
+    QTest::addColumn<QSize>("clientSize");
+
+    QTest::addRow("full-screen video") << DamagePattern::FullScreenVideo << 1 << QSize(1280, 1024);
+    QTest::addRow("typing terminal") << DamagePattern::TypingTerminal << 1 << QSize(800, 600);
+    QTest::addRow("tooltips") << DamagePattern::Tooltips << 32 << QSize(160, 32);
+}
+
+void CompositingBenchmark::benchmarkComposite()
+{
+    QFETCH(DamagePattern, pattern);
+    QFETCH(int, clientCount);
+    QFETCH(QSize, clientSize);
+
+    const int frameCount = qEnvironmentVariableIsSet("KWIN_BENCHMARK_FRAMES") ? qEnvironmentVariableIntValue("KWIN_BENCHMARK_FRAMES") : 300;
+    const int warmupFrameCount = 10;
+    QVERIFY(frameCount > 0);
+
+    std::vector<BenchmarkClient> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        BenchmarkClient client;
+        client.surface = Test::createSurface();
+        client.shellSurface.reset(Test::createXdgToplevelSurface(client.surface.get()));
+        client.size = clientSize;
+        QVERIFY(Test::renderAndWaitForShown(client.surface.get(), clientSize, Qt::black));
+        clients.push_back(std::move(client));
+    }
+
+    Output *output = workspace()->outputs().constFirst();
+    RenderLoop *renderLoop = output->renderLoop();
+
+    // Attaches a buffer from the shm pool, so the client side cost stays small and constant.
+    auto update = [](const BenchmarkClient &client, const QRect &damage, const QColor &color) {
+        const int stride = client.size.width() * 4;
+        auto buffer = Test::waylandShmPool()->getBuffer(client.size, stride).toStrongRef();
+        QImage image(buffer->address(), client.size.width(), client.size.height(), stride, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        painter.fillRect(damage, color);
+        painter.end();
+        buffer->setUsed(true);
+        client.surface->attachBuffer(buffer);
+        client.surface->damage(damage);
+        client.surface->commit(KWayland::Client::Surface::CommitFlag::None);
+    };
+
+    QVector<std::chrono::nanoseconds> renderTimes;
+    std::chrono::nanoseconds compositorCpuTime = std::chrono::nanoseconds::zero();
+    quint64 compositorAllocations = 0;
+
+    QSignalSpy framePresentedSpy(renderLoop, &RenderLoop::framePresented);
+    for (int frame = 0; frame < warmupFrameCount + frameCount; ++frame) {
+        if (frame == warmupFrameCount) {
+            AllocationTracker::reset();
+        }
+        const std::chrono::nanoseconds cpuTimeBefore = threadCpuTime();
+        const quint64 allocationsBefore = allocationCount();
+
+        const QColor color = frame % 2 ? Qt::white : Qt::black;
+        switch (pattern) {
+        case DamagePattern::FullScreenVideo:
+            update(clients[0], QRect(QPoint(0, 0), clientSize), color);
+            break;
+        case DamagePattern::TypingTerminal: {
+            const QSize glyphSize(9, 18);
+            const int columns = clientSize.width() / glyphSize.width();
+            const int rows = clientSize.height() / glyphSize.height();
+            const int column = frame % columns;
+            const int row = (frame / columns) % rows;
+            update(clients[0], QRect(QPoint(column * glyphSize.width(), row * glyphSize.height()), glyphSize), color);
+            break;
+        }
+        case DamagePattern::Tooltips:
+            update(clients[frame % clients.size()], QRect(QPoint(0, 0), clientSize), color);
+            break;
+        }
+        Test::flushWaylandConnection();
+
+        // The client runs on the same thread, leave its share out.
+        const std::chrono::nanoseconds clientCpuTime = threadCpuTime() - cpuTimeBefore;
+        const quint64 clientAllocations = allocationCount() - allocationsBefore;
+
+        framePresentedSpy.clear();
+        QVERIFY(framePresentedSpy.wait());
+
+        if (frame >= warmupFrameCount) {
+            renderTimes.append(RenderLoopPrivate::get(renderLoop)->renderJournal.latest());
+            compositorCpuTime += threadCpuTime() - cpuTimeBefore - clientCpuTime;
+            compositorAllocations += allocationCount() - allocationsBefore - clientAllocations;
+        }
+    }
+
+    std::sort(renderTimes.begin(), renderTimes.end());
+    qInfo("%s: %d frames, frame time p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms, %.3f ms CPU and %.1f allocations per frame",
+          QTest::currentDataTag(), frameCount,
+          toMilliseconds(percentile(renderTimes, 50)),
+          toMilliseconds(percentile(renderTimes, 90)),
+          toMilliseconds(percentile(renderTimes, 99)),
+          toMilliseconds(renderTimes.constLast()),
+          toMilliseconds(compositorCpuTime) / frameCount,
+          double(compositorAllocations) / frameCount);
+
+    const auto phases = AllocationTracker::phases();
+    for (const AllocationTracker::Phase &phase : phases) {
+        qInfo("%s: phase \"%s\": %.1f allocations per call, %llu calls", QTest::currentDataTag(), phase.name,
+              double(phase.allocations) / phase.calls, phase.calls);
+    }
+
+    if (qEnvironmentVariableIsSet("KWIN_BENCHMARK_MAX_ALLOCATIONS")) {
+        const double maximumAllocations = qEnvironmentVariableIntValue("KWIN_BENCHMARK_MAX_ALLOCATIONS");
+        QVERIFY2(double(compositorAllocations) / frameCount <= maximumAllocations,
+                 qPrintable(QStringLiteral("%1 allocations per frame, at most %2 are allowed")
+                                .arg(double(compositorAllocations) / frameCount)
+                                .arg(maximumAllocations)));
+    }
+
+    // A single number per data row, so the result can be tracked in CI with -csv or -xml output.
+    QTest::setBenchmarkResult(toMilliseconds(percentile(renderTimes, 90)), QTest::WalltimeMilliseconds);
+}
+
+} // namespace KWin
+
+WAYLANDTEST_MAIN(KWin::CompositingBenchmark)
+#include "compositing_benchmark.moc"
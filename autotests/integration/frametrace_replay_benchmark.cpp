@@ -0,0 +1,277 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "core/output.h"
+#include "core/platform.h"
+#include "core/renderloop.h"
+#include "core/renderloop_p.h"
+#include "effectloader.h"
+#include "frametrace.h"
+#include "scene.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <KWayland/Client/buffer.h>
+#include <KWayland/Client/compositor.h>
+#include <KWayland/Client/region.h>
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/surface.h>
+
+#include <QPainter>
+
+#include <algorithm>
+#include <map>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_frametrace_replay_benchmark-0");
+
+static double toMilliseconds(std::chrono::nanoseconds value)
+{
+    return std::chrono::duration<double, std::milli>(value).count();
+}
+
+static std::chrono::nanoseconds percentile(const QVector<std::chrono::nanoseconds> &sortedValues, int percent)
+{
+    if (sortedValues.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    const int index = std::min<int>(sortedValues.count() - 1, sortedValues.count() * percent / 100);
+    return sortedValues[index];
+}
+
+/**
+ * The frame trace replay benchmark feeds a frame trace recorded with KWIN_FRAME_TRACE, or over
+ * D-Bus, to KWin on the virtual backend. Each recorded surface is played by a client that
+ * attaches synthetic buffers with the recorded size, damage and opaque region, the windows are
+ * moved, restacked and made translucent as recorded, and the effects that were active in the
+ * trace are loaded. Then the render times of the replayed frames are compared with the ones of
+ * the recording.
+ *
+ * The trace is read from the file in the KWIN_FRAME_TRACE_REPLAY environment variable, a small
+ * sample trace is replayed otherwise. Only the frames of the first recorded output are replayed.
+ */
+class FrameTraceReplayBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkReplay();
+
+private:
+    FrameTrace m_trace;
+    QString m_outputName;
+    QRect m_outputGeometry;
+};
+
+struct ReplayClient
+{
+    std::unique_ptr<KWayland::Client::Surface> surface;
+    std::unique_ptr<Test::XdgToplevel> shellSurface;
+    Window *window = nullptr;
+    QSize size;
+    QRegion opaque;
+};
+
+void FrameTraceReplayBenchmark::initTestCase()
+{
+    qRegisterMetaType<KWin::Window *>();
+
+    const QString fileName = qEnvironmentVariableIsSet("KWIN_FRAME_TRACE_REPLAY") ? qEnvironmentVariable("KWIN_FRAME_TRACE_REPLAY") : QFINDTESTDATA("data/frametrace/sample.jsonl");
+    const std::optional<FrameTrace> trace = FrameTrace::load(fileName);
+    QVERIFY(trace.has_value());
+    QVERIFY(!trace->frames.isEmpty());
+    m_outputName = trace->frames.constFirst().output;
+    m_outputGeometry = trace->frames.constFirst().outputGeometry;
+    for (const FrameTrace::Frame &frame : trace->frames) {
+        if (frame.output == m_outputName) {
+            m_trace.frames.append(frame);
+        }
+    }
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    kwinApp()->platform()->setInitialWindowSize(m_outputGeometry.size());
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // only the effects that were active in the trace are loaded
+    QStringList recordedEffects;
+    for (const FrameTrace::Frame &frame : qAsConst(m_trace.frames)) {
+        for (const QString &effect : frame.activeEffects) {
+            if (!recordedEffects.contains(effect)) {
+                recordedEffects.append(effect);
+            }
+        }
+    }
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), recordedEffects.contains(name));
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    if (!qEnvironmentVariableIsSet("KWIN_COMPOSE")) {
+        qputenv("KWIN_COMPOSE", QByteArrayLiteral("Q"));
+    }
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+}
+
+void FrameTraceReplayBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void FrameTraceReplayBenchmark::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void FrameTraceReplayBenchmark::benchmarkReplay()
+{
+    Output *output = workspace()->outputs().constFirst();
+    RenderLoop *renderLoop = output->renderLoop();
+    const QPoint offset = output->geometry().topLeft() - m_outputGeometry.topLeft();
+
+    // Attaches a buffer from the shm pool, so the client side cost stays small and constant.
+    auto update = [](ReplayClient &client, const QRegion &damage, bool flip) {
+        const int stride = client.size.width() * 4;
+        auto buffer = Test::waylandShmPool()->getBuffer(client.size, stride).toStrongRef();
+        QImage image(buffer->address(), client.size.width(), client.size.height(), stride, QImage::Format_ARGB32_Premultiplied);
+        QPainter painter(&image);
+        for (const QRect &rect : damage) {
+            painter.fillRect(rect, flip ? Qt::white : Qt::black);
+        }
+        painter.end();
+        buffer->setUsed(true);
+        client.surface->attachBuffer(buffer);
+        client.surface->damage(damage);
+    };
+
+    std::map<QString, ReplayClient> clients;
+    QVector<std::chrono::nanoseconds> recordedRenderTimes;
+    QVector<std::chrono::nanoseconds> replayedRenderTimes;
+
+    QSignalSpy framePresentedSpy(renderLoop, &RenderLoop::framePresented);
+    for (int i = 0; i < m_trace.frames.count(); ++i) {
+        const FrameTrace::Frame &frame = m_trace.frames[i];
+
+        // the windows that are gone are closed first, they don't take part in the frame anymore
+        for (auto it = clients.begin(); it != clients.end();) {
+            const bool present = std::any_of(frame.surfaces.begin(), frame.surfaces.end(), [&it](const FrameTrace::Surface &surface) {
+                return surface.id == it->first;
+            });
+            it = present ? std::next(it) : clients.erase(it);
+        }
+
+        for (const FrameTrace::Surface &surface : frame.surfaces) {
+            if (surface.size.isEmpty()) {
+                continue;
+            }
+            auto it = clients.find(surface.id);
+            if (it == clients.end()) {
+                ReplayClient client;
+                client.surface = Test::createSurface();
+                client.shellSurface.reset(Test::createXdgToplevelSurface(client.surface.get()));
+                client.size = surface.size;
+                client.window = Test::renderAndWaitForShown(client.surface.get(), surface.size, Qt::black);
+                QVERIFY(client.window);
+                it = clients.emplace(surface.id, std::move(client)).first;
+            }
+
+            ReplayClient &client = it->second;
+            bool changed = false;
+            if (client.size != surface.size) {
+                client.size = surface.size;
+                update(client, QRect(QPoint(0, 0), surface.size), i % 2);
+                changed = true;
+            } else if (!surface.damage.isEmpty()) {
+                update(client, surface.damage, i % 2);
+                changed = true;
+            }
+            if (client.opaque != surface.opaque) {
+                client.opaque = surface.opaque;
+                auto region = Test::waylandCompositor()->createRegion(surface.opaque);
+                client.surface->setOpaque(region.get());
+                changed = true;
+            }
+            if (changed) {
+                client.surface->commit(KWayland::Client::Surface::CommitFlag::None);
+            }
+
+            const QPoint position = surface.geometry.topLeft() + offset;
+            if (client.window->pos() != position) {
+                client.window->move(position);
+            }
+            if (client.window->opacity() != surface.opacity) {
+                client.window->setOpacity(surface.opacity);
+            }
+        }
+
+        // raising the windows from bottom to top yields the recorded stacking order
+        QList<Window *> recordedOrder;
+        for (const FrameTrace::Surface &surface : frame.surfaces) {
+            auto it = clients.find(surface.id);
+            if (it != clients.end()) {
+                recordedOrder.append(it->second.window);
+            }
+        }
+        QList<Window *> currentOrder = workspace()->stackingOrder();
+        currentOrder.erase(std::remove_if(currentOrder.begin(), currentOrder.end(), [&recordedOrder](Window *window) {
+                               return !recordedOrder.contains(window);
+                           }),
+                           currentOrder.end());
+        if (currentOrder != recordedOrder) {
+            for (Window *window : qAsConst(recordedOrder)) {
+                workspace()->raiseWindow(window);
+            }
+        }
+
+        // the recorded frame was painted for a reason, even if it's not in the trace, e.g. an
+        // animation or the cursor
+        Compositor::self()->scene()->addRepaint(output->geometry());
+        Test::flushWaylandConnection();
+
+        framePresentedSpy.clear();
+        QVERIFY(framePresentedSpy.wait());
+
+        replayedRenderTimes.append(RenderLoopPrivate::get(renderLoop)->renderJournal.latest());
+        if (frame.renderTime > std::chrono::nanoseconds::zero()) {
+            recordedRenderTimes.append(frame.renderTime);
+        }
+    }
+
+    std::sort(recordedRenderTimes.begin(), recordedRenderTimes.end());
+    std::sort(replayedRenderTimes.begin(), replayedRenderTimes.end());
+    qInfo("%s: %d frames, replayed render time p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, recorded p50 %.3f ms, p90 %.3f ms, p99 %.3f ms",
+          qPrintable(m_outputName), int(m_trace.frames.count()),
+          toMilliseconds(percentile(replayedRenderTimes, 50)),
+          toMilliseconds(percentile(replayedRenderTimes, 90)),
+          toMilliseconds(percentile(replayedRenderTimes, 99)),
+          toMilliseconds(percentile(recordedRenderTimes, 50)),
+          toMilliseconds(percentile(recordedRenderTimes, 90)),
+          toMilliseconds(percentile(recordedRenderTimes, 99)));
+
+    // A single number, so the result can be tracked in CI with -csv or -xml output.
+    QTest::setBenchmarkResult(toMilliseconds(percentile(replayedRenderTimes, 90)), QTest::WalltimeMilliseconds);
+}
+
+} // namespace KWin
+
+WAYLANDTEST_MAIN(KWin::FrameTraceReplayBenchmark)
+#include "frametrace_replay_benchmark.moc"
@@ -0,0 +1,110 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "core/platform.h"
+#include "input.h"
+#include "input_event.h"
+#include "pointer_input.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <linux/input.h>
+#include <xkbcommon/xkbcommon.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_inputfilter_benchmark-0");
+
+/**
+ * The input filter benchmark sends synthetic events of each kind through the filter chain of a
+ * running KWin, with all the filters installed that are installed in a real session.
+ */
+class InputFilterBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkPointerMotion();
+    void benchmarkWheel();
+    void benchmarkKey();
+    void benchmarkHoldGesture();
+    void benchmarkSwitch();
+    void benchmarkTabletPadRing();
+};
+
+void InputFilterBenchmark::initTestCase()
+{
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    input()->pointer()->warp(QPointF(640, 512));
+}
+
+void InputFilterBenchmark::benchmarkPointerMotion()
+{
+    InputDevice *device = static_cast<WaylandTestApplication *>(kwinApp())->virtualPointer();
+    MouseEvent event(QEvent::MouseMove, QPointF(640, 512), Qt::NoButton, Qt::NoButton, Qt::NoModifier, 0,
+                     QPointF(), QPointF(), 0, device);
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Pointer, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+    }
+}
+
+void InputFilterBenchmark::benchmarkWheel()
+{
+    InputDevice *device = static_cast<WaylandTestApplication *>(kwinApp())->virtualPointer();
+    WheelEvent event(QPointF(640, 512), 0, 0, Qt::Vertical, Qt::NoButton, Qt::NoModifier,
+                     InputRedirection::PointerAxisSourceWheel, 0, device);
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Wheel, std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &event));
+    }
+}
+
+void InputFilterBenchmark::benchmarkKey()
+{
+    InputDevice *device = static_cast<WaylandTestApplication *>(kwinApp())->virtualKeyboard();
+    // releasing a key that isn't pressed doesn't trigger anything
+    KeyEvent event(QEvent::KeyRelease, Qt::Key_A, Qt::NoModifier, KEY_A, XKB_KEY_a, QStringLiteral("a"), false, 0, device);
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Key, std::bind(&InputEventFilter::keyEvent, std::placeholders::_1, &event));
+    }
+}
+
+void InputFilterBenchmark::benchmarkHoldGesture()
+{
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, 0));
+    }
+}
+
+void InputFilterBenchmark::benchmarkSwitch()
+{
+    InputDevice *device = static_cast<WaylandTestApplication *>(kwinApp())->virtualKeyboard();
+    SwitchEvent event(SwitchEvent::State::Off, 0, 0, device);
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Switch, std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
+    }
+}
+
+void InputFilterBenchmark::benchmarkTabletPadRing()
+{
+    const TabletPadId padId{QStringLiteral("benchmark pad"), nullptr};
+    QBENCHMARK {
+        input()->processFilters(InputEventType::Tablet, std::bind(&InputEventFilter::tabletPadRingEvent, std::placeholders::_1, 0, 0, false, padId, 0));
+    }
+}
+
+} // namespace KWin
+
+WAYLANDTEST_MAIN(KWin::InputFilterBenchmark)
+#include "inputfilter_benchmark.moc"
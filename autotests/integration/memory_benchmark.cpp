@@ -0,0 +1,250 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "core/output.h"
+#include "core/platform.h"
+#include "core/renderloop.h"
+#include "effectloader.h"
+#include "scene.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <kwingltexture.h>
+
+#include <KWayland/Client/buffer.h>
+#include <KWayland/Client/shadow.h>
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/surface.h>
+
+#include <malloc.h>
+
+namespace KWin
+{
+
+enum class WindowKind {
+    Undecorated,
+    Decorated,
+    Shadowed,
+};
+
+} // namespace KWin
+
+Q_DECLARE_METATYPE(KWin::WindowKind)
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_memory_benchmark-0");
+
+/**
+ * Returns the bytes that are allocated on the heap, including the large chunks that are mapped.
+ */
+static qint64 heapBytes()
+{
+    const struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks) + qint64(info.hblkhd);
+}
+
+static const QList<GLTexture::MemoryCategory> s_textureCategories{
+    GLTexture::MemoryCategory::Window,
+    GLTexture::MemoryCategory::Decoration,
+    GLTexture::MemoryCategory::Shadow,
+    GLTexture::MemoryCategory::Effect,
+    GLTexture::MemoryCategory::Other,
+};
+
+static const char *categoryName(GLTexture::MemoryCategory category)
+{
+    switch (category) {
+    case GLTexture::MemoryCategory::Window:
+        return "window";
+    case GLTexture::MemoryCategory::Decoration:
+        return "decoration";
+    case GLTexture::MemoryCategory::Shadow:
+        return "shadow";
+    case GLTexture::MemoryCategory::Effect:
+        return "effect";
+    default:
+        return "other";
+    }
+}
+
+/**
+ * The memory benchmark runs KWin on the virtual backend, opens a number of windows of one kind
+ * and reports what each of them costs the compositor: the heap bytes, and with OpenGL
+ * compositing the texture bytes by category.
+ *
+ * The test client runs on the same thread, so the heap bytes include its proxy objects, which
+ * are small compared to the compositor's share. The buffers of the client are shared memory and
+ * not counted.
+ *
+ * The number of windows can be changed with the KWIN_BENCHMARK_WINDOWS environment variable,
+ * the compositing type with KWIN_COMPOSE as usual, e.g. KWIN_COMPOSE=O2 to measure textures.
+ */
+class MemoryBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkWindowMemory_data();
+    void benchmarkWindowMemory();
+};
+
+struct BenchmarkWindow
+{
+    std::unique_ptr<KWayland::Client::Surface> surface;
+    std::unique_ptr<Test::XdgToplevel> shellSurface;
+    std::unique_ptr<Test::XdgToplevelDecorationV1> decoration;
+    std::unique_ptr<KWayland::Client::Shadow> shadow;
+};
+
+void MemoryBenchmark::initTestCase()
+{
+    qRegisterMetaType<KWin::Window *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // disable all effects - their data would be attributed to the windows
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    if (!qEnvironmentVariableIsSet("KWIN_COMPOSE")) {
+        qputenv("KWIN_COMPOSE", QByteArrayLiteral("Q"));
+    }
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+}
+
+void MemoryBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection(Test::AdditionalWaylandInterface::XdgDecorationV1 | Test::AdditionalWaylandInterface::ShadowManager));
+}
+
+void MemoryBenchmark::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+static bool openWindow(WindowKind kind, BenchmarkWindow &window)
+{
+    window.surface = Test::createSurface();
+    window.shellSurface.reset(Test::createXdgToplevelSurface(window.surface.get(), Test::CreationSetup::CreateOnly));
+    if (!window.shellSurface) {
+        return false;
+    }
+
+    QSignalSpy surfaceConfigureRequestedSpy(window.shellSurface->xdgSurface(), &Test::XdgSurface::configureRequested);
+    if (kind == WindowKind::Decorated) {
+        window.decoration.reset(Test::createXdgToplevelDecorationV1(window.shellSurface.get()));
+        window.decoration->set_mode(Test::XdgToplevelDecorationV1::mode_server_side);
+    }
+    window.surface->commit(KWayland::Client::Surface::CommitFlag::None);
+    if (!surfaceConfigureRequestedSpy.wait()) {
+        return false;
+    }
+    window.shellSurface->xdgSurface()->ack_configure(surfaceConfigureRequestedSpy.last().at(0).value<quint32>());
+
+    if (kind == WindowKind::Shadowed) {
+        // A drop-shadow like the ones of Breeze, with 32 px wide tiles.
+        window.shadow.reset(Test::waylandShadowManager()->createShadow(window.surface.get()));
+        const auto tile = [](const QSize &size) {
+            QImage image(size, QImage::Format_ARGB32_Premultiplied);
+            image.fill(QColor(0, 0, 0, 64));
+            return Test::waylandShmPool()->createBuffer(image);
+        };
+        window.shadow->attachTopLeft(tile(QSize(32, 32)));
+        window.shadow->attachTop(tile(QSize(1, 32)));
+        window.shadow->attachTopRight(tile(QSize(32, 32)));
+        window.shadow->attachRight(tile(QSize(32, 1)));
+        window.shadow->attachBottomRight(tile(QSize(32, 32)));
+        window.shadow->attachBottom(tile(QSize(1, 32)));
+        window.shadow->attachBottomLeft(tile(QSize(32, 32)));
+        window.shadow->attachLeft(tile(QSize(32, 1)));
+        window.shadow->setOffsets(QMarginsF(32, 32, 32, 32));
+        window.shadow->commit();
+    }
+
+    return Test::renderAndWaitForShown(window.surface.get(), QSize(400, 300), Qt::blue);
+}
+
+void MemoryBenchmark::benchmarkWindowMemory_data()
+{
+    QTest::addColumn<WindowKind>("kind");
+
+    QTest::addRow("undecorated") << WindowKind::Undecorated;
+    QTest::addRow("server-side decoration") << WindowKind::Decorated;
+    QTest::addRow("shadow") << WindowKind::Shadowed;
+}
+
+void MemoryBenchmark::benchmarkWindowMemory()
+{
+    QFETCH(WindowKind, kind);
+
+    const int windowCount = qEnvironmentVariableIsSet("KWIN_BENCHMARK_WINDOWS") ? qEnvironmentVariableIntValue("KWIN_BENCHMARK_WINDOWS") : 50;
+    QVERIFY(windowCount > 0);
+
+    RenderLoop *renderLoop = workspace()->outputs().constFirst()->renderLoop();
+    QSignalSpy framePresentedSpy(renderLoop, &RenderLoop::framePresented);
+    const auto waitForFrame = [&framePresentedSpy]() {
+        framePresentedSpy.clear();
+        return framePresentedSpy.wait();
+    };
+
+    // The first window of a kind pays for what's shared, e.g. loading the decoration plugin.
+    std::vector<BenchmarkWindow> windows(windowCount + 1);
+    QVERIFY(openWindow(kind, windows[0]));
+    QVERIFY(waitForFrame());
+
+    const qint64 heapBefore = heapBytes();
+    QMap<GLTexture::MemoryCategory, qint64> texturesBefore;
+    for (GLTexture::MemoryCategory category : s_textureCategories) {
+        texturesBefore[category] = GLTexture::allocatedBytes(category);
+    }
+
+    for (int i = 1; i <= windowCount; ++i) {
+        QVERIFY(openWindow(kind, windows[i]));
+    }
+    // Let the windows be composited, so their textures and decorations get rendered.
+    Compositor::self()->scene()->addRepaintFull();
+    QVERIFY(waitForFrame());
+
+    const double heapPerWindow = double(heapBytes() - heapBefore) / windowCount;
+    QByteArray textures;
+    for (GLTexture::MemoryCategory category : s_textureCategories) {
+        const double bytes = double(GLTexture::allocatedBytes(category) - texturesBefore[category]) / windowCount;
+        textures += QByteArray(" ") + categoryName(category) + ' ' + QByteArray::number(bytes, 'f', 0);
+    }
+
+    qInfo("%s: %d windows, %.0f heap bytes per window, texture bytes per window:%s",
+          QTest::currentDataTag(), windowCount, heapPerWindow, textures.constData());
+
+    // A single number per data row, so the result can be tracked in CI with -csv or -xml output.
+    QTest::setBenchmarkResult(heapPerWindow, QTest::BytesAllocated);
+}
+
+} // namespace KWin
+
+WAYLANDTEST_MAIN(KWin::MemoryBenchmark)
+#include "memory_benchmark.moc"
@@ -16,10 +16,12 @@
 #include "deleted.h"
 #include "effects.h"
 #include "placement.h"
+#include "wayland/surface_interface.h"
 #include "wayland_server.h"
 #include "window.h"
 #include "workspace.h"
 #include "x11window.h"
+#include "xdgshellwindow.h"
 
 #include <KWayland/Client/compositor.h>
 #include <KWayland/Client/connection_thread.h>
@@ -48,6 +50,7 @@ private Q_SLOTS:
     void cleanup();
     void testMove();
     void testResize();
+    void testResizeThrottling();
     void testPackTo_data();
     void testPackTo();
     void testPackAgainstClient_data();
@@ -302,6 +305,63 @@ void MoveResizeWindowTest::testResize()
     QVERIFY(Test::waitForWindowDestroyed(window));
 }
 
+void MoveResizeWindowTest::testResizeThrottling()
+{
+    // this test verifies that a client that lags behind gets the latest size rather than a backlog
+    std::unique_ptr<KWayland::Client::Surface> surface(Test::createSurface());
+    std::unique_ptr<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.get()));
+    auto window = qobject_cast<XdgSurfaceWindow *>(Test::renderAndWaitForShown(surface.get(), QSize(100, 50), Qt::blue));
+    QVERIFY(window);
+    QCOMPARE(window->frameGeometry(), QRect(0, 0, 100, 50));
+
+    QSignalSpy toplevelConfigureRequestedSpy(shellSurface.get(), &Test::XdgToplevel::configureRequested);
+    QSignalSpy surfaceConfigureRequestedSpy(shellSurface->xdgSurface(), &Test::XdgSurface::configureRequested);
+    QSignalSpy frameGeometryChangedSpy(window, &Window::frameGeometryChanged);
+
+    // begin resize
+    workspace()->slotWindowResize();
+    QCOMPARE(window->isInteractiveResize(), true);
+    QVERIFY(surfaceConfigureRequestedSpy.wait());
+    QSignalSpy committedSpy(window->surface(), &KWaylandServer::SurfaceInterface::committed);
+    shellSurface->xdgSurface()->ack_configure(surfaceConfigureRequestedSpy.last().at(0).value<quint32>());
+    Test::render(surface.get(), QSize(100, 50), Qt::blue);
+    QVERIFY(committedSpy.wait());
+    const int configureCount = surfaceConfigureRequestedSpy.count();
+
+    // the first change is sent right away
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+    QVERIFY(surfaceConfigureRequestedSpy.wait());
+    QCOMPARE(surfaceConfigureRequestedSpy.count(), configureCount + 1);
+    QCOMPARE(toplevelConfigureRequestedSpy.last().at(0).toSize(), QSize(108, 50));
+
+    // the client hasn't caught up yet, further changes are folded into the next configure event
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+
+    shellSurface->xdgSurface()->ack_configure(surfaceConfigureRequestedSpy.last().at(0).value<quint32>());
+    Test::render(surface.get(), QSize(108, 50), Qt::blue);
+    QVERIFY(frameGeometryChangedSpy.wait());
+    QCOMPARE(window->frameGeometry(), QRect(0, 0, 108, 50));
+    QVERIFY(window->configureLatency() > 0);
+    QVERIFY(window->maximumConfigureLatency() >= window->averageConfigureLatency());
+
+    if (surfaceConfigureRequestedSpy.count() == configureCount + 1) {
+        QVERIFY(surfaceConfigureRequestedSpy.wait());
+    }
+    QCOMPARE(surfaceConfigureRequestedSpy.count(), configureCount + 2);
+    QCOMPARE(toplevelConfigureRequestedSpy.last().at(0).toSize(), QSize(124, 50));
+
+    // finish the resize
+    window->keyPressEvent(Qt::Key_Enter);
+    QCOMPARE(window->isInteractiveResize(), false);
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(window));
+}
+
 void MoveResizeWindowTest::testPackTo_data()
 {
     QTest::addColumn<QString>("methodCall");
@@ -0,0 +1,98 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <kwinskylinepacker.h>
+
+#include <QtTest>
+
+using namespace KWin;
+
+class SkylinePackerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testAllocate();
+    void testFull();
+    void testNoOverlap();
+    void testReleaseTop();
+    void testReleaseCovered();
+};
+
+void SkylinePackerTest::testAllocate()
+{
+    SkylinePacker packer(QSize(100, 100));
+    QCOMPARE(packer.allocate(QSize(60, 20)), QRect(0, 0, 60, 20));
+    // the rest of the first row is still free
+    QCOMPARE(packer.allocate(QSize(40, 10)), QRect(60, 0, 40, 10));
+    // and the lowest spot that fits comes next
+    QCOMPARE(packer.allocate(QSize(40, 10)), QRect(60, 10, 40, 10));
+    QCOMPARE(packer.allocate(QSize(100, 10)), QRect(0, 20, 100, 10));
+    QCOMPARE(packer.allocationCount(), 4);
+    QCOMPARE(packer.occupancy(), 0.3);
+}
+
+void SkylinePackerTest::testFull()
+{
+    SkylinePacker packer(QSize(100, 100));
+    QVERIFY(packer.allocate(QSize(101, 1)).isNull());
+    QVERIFY(packer.allocate(QSize(0, 10)).isNull());
+    QCOMPARE(packer.allocate(QSize(100, 90)), QRect(0, 0, 100, 90));
+    QVERIFY(packer.allocate(QSize(10, 11)).isNull());
+    QCOMPARE(packer.allocate(QSize(10, 10)), QRect(0, 90, 10, 10));
+}
+
+void SkylinePackerTest::testNoOverlap()
+{
+    SkylinePacker packer(QSize(256, 256));
+    QVector<QRect> rects;
+    for (int i = 0; i < 200; ++i) {
+        const QRect rect = packer.allocate(QSize(7 + (i * 13) % 41, 5 + (i * 7) % 29));
+        if (rect.isNull()) {
+            continue;
+        }
+        QVERIFY(QRect(0, 0, 256, 256).contains(rect));
+        for (const QRect &other : std::as_const(rects)) {
+            QVERIFY(!rect.intersects(other));
+        }
+        rects.append(rect);
+    }
+    QVERIFY(rects.count() > 20);
+}
+
+void SkylinePackerTest::testReleaseTop()
+{
+    SkylinePacker packer(QSize(100, 100));
+    const QRect bottom = packer.allocate(QSize(100, 50));
+    const QRect top = packer.allocate(QSize(50, 50));
+    QCOMPARE(top, QRect(0, 50, 50, 50));
+    QVERIFY(packer.allocate(QSize(60, 50)).isNull());
+
+    // nothing is on top of it, so the space can be used again right away
+    packer.release(top);
+    QCOMPARE(packer.allocate(QSize(60, 50)), QRect(0, 50, 60, 50));
+    QCOMPARE(packer.allocationCount(), 2);
+    Q_UNUSED(bottom)
+}
+
+void SkylinePackerTest::testReleaseCovered()
+{
+    SkylinePacker packer(QSize(100, 100));
+    const QRect bottom = packer.allocate(QSize(100, 50));
+    const QRect top = packer.allocate(QSize(100, 50));
+
+    // the space underneath another rectangle is only reclaimed once everything is released
+    packer.release(bottom);
+    QVERIFY(packer.allocate(QSize(100, 50)).isNull());
+    packer.release(top);
+    QCOMPARE(packer.allocationCount(), 0);
+    QCOMPARE(packer.allocate(QSize(100, 100)), QRect(0, 0, 100, 100));
+}
+
+QTEST_MAIN(SkylinePackerTest)
+
+#include "skylinepackertest.moc"
@@ -0,0 +1,116 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "core/cursorfastpath.h"
+
+#include <QtTest>
+
+#include <thread>
+
+using namespace KWin;
+
+class MockCursorPlane : public CursorPlane
+{
+public:
+    bool moveTo(const QPointF &position) override
+    {
+        moves.append(position);
+        return true;
+    }
+
+    QVector<QPointF> moves;
+};
+
+class TestCursorFastPath : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testPrediction();
+    void testNoMoveWithoutLag();
+    void testMoveWhenLagging();
+    void testDisabled();
+};
+
+void TestCursorFastPath::testPrediction()
+{
+    CursorFastPath fastPath(std::chrono::hours(1));
+    fastPath.setPosition(QPointF(100, 100));
+    fastPath.motion(QPointF(1, 2));
+    fastPath.motion(QPointF(3, 4));
+    QCOMPARE(fastPath.predictedPosition(), QPointF(104, 106));
+
+    // the main thread has processed the first motion
+    fastPath.motionProcessed(QPointF(1, 2));
+    QCOMPARE(fastPath.predictedPosition(), QPointF(104, 106));
+    fastPath.setPosition(QPointF(101, 102));
+    QCOMPARE(fastPath.predictedPosition(), QPointF(104, 106));
+
+    // and the second one, which got clamped at a screen edge
+    fastPath.motionProcessed(QPointF(3, 4));
+    fastPath.setPosition(QPointF(101, 104));
+    QCOMPARE(fastPath.predictedPosition(), QPointF(101, 104));
+}
+
+void TestCursorFastPath::testNoMoveWithoutLag()
+{
+    MockCursorPlane plane;
+    CursorFastPath fastPath(std::chrono::hours(1));
+    fastPath.addPlane(&plane);
+    fastPath.setPosition(QPointF(10, 10));
+    fastPath.motion(QPointF(1, 1));
+    fastPath.motion(QPointF(1, 1));
+    QVERIFY(plane.moves.isEmpty());
+    fastPath.removePlane(&plane);
+}
+
+void TestCursorFastPath::testMoveWhenLagging()
+{
+    MockCursorPlane plane;
+    CursorFastPath fastPath(std::chrono::milliseconds(1));
+    fastPath.addPlane(&plane);
+    fastPath.setPosition(QPointF(10, 10));
+
+    fastPath.motion(QPointF(1, 1));
+    QVERIFY(plane.moves.isEmpty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    fastPath.motion(QPointF(2, 2));
+    QCOMPARE(plane.moves, QVector<QPointF>{QPointF(13, 13)});
+    fastPath.motion(QPointF(0, 0));
+    QCOMPARE(plane.moves.count(), 1);
+
+    // once the main thread caught up, it's on time again
+    fastPath.motionProcessed(QPointF(1, 1));
+    fastPath.motionProcessed(QPointF(2, 2));
+    fastPath.motionProcessed(QPointF(0, 0));
+    fastPath.setPosition(QPointF(13, 13));
+    fastPath.motion(QPointF(1, 1));
+    QCOMPARE(plane.moves.count(), 1);
+
+    fastPath.removePlane(&plane);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    fastPath.motion(QPointF(1, 1));
+    QCOMPARE(plane.moves.count(), 1);
+}
+
+void TestCursorFastPath::testDisabled()
+{
+    MockCursorPlane plane;
+    CursorFastPath fastPath(std::chrono::microseconds(0));
+    fastPath.addPlane(&plane);
+    fastPath.setEnabled(false);
+    fastPath.motion(QPointF(1, 1));
+    QVERIFY(plane.moves.isEmpty());
+
+    fastPath.setEnabled(true);
+    fastPath.motion(QPointF(1, 1));
+    QCOMPARE(plane.moves, QVector<QPointF>{QPointF(2, 2)});
+    fastPath.removePlane(&plane);
+}
+
+QTEST_GUILESS_MAIN(TestCursorFastPath)
+
+#include "test_cursorfastpath.moc"
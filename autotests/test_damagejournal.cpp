@@ -0,0 +1,123 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/damagejournal.h"
+
+#include <QtTest>
+
+using namespace KWin;
+
+class TestDamageJournal : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testAccumulate();
+    void testCapacity();
+    void testClear();
+    void benchmarkAccumulate_data();
+    void benchmarkAccumulate();
+};
+
+void TestDamageJournal::testAccumulate()
+{
+    DamageJournal journal;
+    const QRegion fallback(0, 0, 1000, 1000);
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+    journal.add(QRect(40, 0, 10, 10));
+
+    QCOMPARE(journal.accumulate(0, fallback), fallback);
+    QCOMPARE(journal.accumulate(1, fallback), QRegion());
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), QRegion(40, 0, 10, 10) + QRegion(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(4, fallback), fallback);
+    QCOMPARE(journal.lastDamage(), QRegion(40, 0, 10, 10));
+
+    // The cached unions must follow the journal.
+    journal.add(QRect(60, 0, 10, 10));
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(60, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), QRegion(60, 0, 10, 10) + QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(4, fallback), QRegion(60, 0, 10, 10) + QRegion(40, 0, 10, 10) + QRegion(20, 0, 10, 10));
+}
+
+void TestDamageJournal::testCapacity()
+{
+    DamageJournal journal;
+    journal.setCapacity(2);
+    QCOMPARE(journal.capacity(), 2);
+
+    const QRegion fallback(0, 0, 1000, 1000);
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+    journal.add(QRect(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), fallback);
+
+    // The most recent regions are kept when the capacity changes.
+    journal.setCapacity(4);
+    journal.add(QRect(60, 0, 10, 10));
+    QCOMPARE(journal.accumulate(4, fallback), QRegion(60, 0, 10, 10) + QRegion(40, 0, 10, 10) + QRegion(20, 0, 10, 10));
+}
+
+void TestDamageJournal::testClear()
+{
+    DamageJournal journal;
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(2), QRegion(20, 0, 10, 10));
+
+    journal.clear();
+    const QRegion fallback(0, 0, 1000, 1000);
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+    QCOMPARE(journal.lastDamage(), QRegion());
+
+    journal.add(QRect(40, 0, 10, 10));
+    journal.add(QRect(60, 0, 10, 10));
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(60, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), fallback);
+}
+
+void TestDamageJournal::benchmarkAccumulate_data()
+{
+    QTest::addColumn<int>("bufferAge");
+
+    QTest::addRow("age 2") << 2;
+    QTest::addRow("age 3") << 3;
+    QTest::addRow("age 4") << 4;
+}
+
+void TestDamageJournal::benchmarkAccumulate()
+{
+    QFETCH(int, bufferAge);
+
+    // A blinking cursor and a few spinners, as a typical desktop would produce.
+    QVector<QRegion> damage;
+    for (int i = 0; i < 16; ++i) {
+        QRegion region;
+        for (int j = 0; j < 8; ++j) {
+            region += QRect((i * 37 + j * 113) % 1800, (i * 53 + j * 71) % 1000, 16, 16);
+        }
+        damage.append(region);
+    }
+
+    // Each frame queries the repaint region for the back buffer and then records its damage.
+    DamageJournal journal;
+    const QRegion fallback(0, 0, 1920, 1080);
+    int frame = 0;
+    quint64 rectCount = 0;
+    QBENCHMARK {
+        rectCount += journal.accumulate(bufferAge, fallback).rectCount();
+        journal.add(damage[frame++ % damage.count()]);
+    }
+    QVERIFY(rectCount > 0);
+}
+
+QTEST_MAIN(TestDamageJournal)
+
+#include "test_damagejournal.moc"
@@ -0,0 +1,93 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/damagesimplifier.h"
+
+#include <QtTest>
+
+using namespace KWin;
+
+class TestDamageSimplifier : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testFewRects();
+    void testDenseRects();
+    void testSparseRects();
+    void testDisabled();
+};
+
+static QRegion diagonalRects(const QPoint &origin, int count)
+{
+    QRegion region;
+    for (int i = 0; i < count; ++i) {
+        region += QRect(origin + QPoint(i * 6, i * 6), QSize(4, 4));
+    }
+    return region;
+}
+
+void TestDamageSimplifier::testFewRects()
+{
+    DamageSimplifier simplifier;
+    simplifier.setMaximumRectCount(16);
+
+    const QRegion region = diagonalRects(QPoint(0, 0), 4);
+    QCOMPARE(simplifier.simplify(region), region);
+    QCOMPARE(simplifier.statistics().regions, quint64(1));
+    QCOMPARE(simplifier.statistics().simplifiedRegions, quint64(0));
+}
+
+void TestDamageSimplifier::testDenseRects()
+{
+    DamageSimplifier simplifier;
+    simplifier.setMaximumRectCount(16);
+    simplifier.setMinimumEfficiency(0.5);
+
+    // Rows of a text view, separated by 1px gaps.
+    QRegion region;
+    for (int i = 0; i < 20; ++i) {
+        region += QRect(0, i * 10, 100, 9);
+    }
+    QCOMPARE(region.rectCount(), 20);
+
+    QCOMPARE(simplifier.simplify(region), QRegion(0, 0, 100, 199));
+    QCOMPARE(simplifier.statistics().simplifiedRegions, quint64(1));
+    QCOMPARE(simplifier.statistics().inputRects, quint64(20));
+    QCOMPARE(simplifier.statistics().outputRects, quint64(1));
+    QCOMPARE(simplifier.statistics().inputArea, quint64(20 * 100 * 9));
+    QCOMPARE(simplifier.statistics().outputArea, quint64(100 * 199));
+}
+
+void TestDamageSimplifier::testSparseRects()
+{
+    DamageSimplifier simplifier;
+    simplifier.setMaximumRectCount(16);
+    simplifier.setMinimumEfficiency(0.5);
+
+    // Two spinners far away from each other, the bounding rect would be mostly wasted.
+    const QRegion region = diagonalRects(QPoint(0, 0), 10) + diagonalRects(QPoint(960, 960), 10);
+    QCOMPARE(region.rectCount(), 20);
+
+    const QRegion expected = QRegion(0, 0, 64, 64) + QRegion(960, 960, 58, 58);
+    QCOMPARE(simplifier.simplify(region), expected);
+    QCOMPARE(simplifier.statistics().simplifiedRegions, quint64(1));
+    QCOMPARE(simplifier.statistics().outputRects, quint64(2));
+}
+
+void TestDamageSimplifier::testDisabled()
+{
+    DamageSimplifier simplifier;
+    simplifier.setMaximumRectCount(0);
+
+    const QRegion region = diagonalRects(QPoint(0, 0), 20);
+    QCOMPARE(simplifier.simplify(region), region);
+    QCOMPARE(simplifier.statistics().simplifiedRegions, quint64(0));
+}
+
+QTEST_MAIN(TestDamageSimplifier)
+
+#include "test_damagesimplifier.moc"
@@ -0,0 +1,74 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "effectpaintstatistics.h"
+
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestEffectPaintStatistics : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testAverage();
+    void testBudgetShare();
+    void testRollingWindow();
+};
+
+void TestEffectPaintStatistics::testEmpty()
+{
+    EffectPaintStatistics statistics;
+    QCOMPARE(statistics.frameCount(), 0);
+    QCOMPARE(statistics.averagePaintTime(), 0ns);
+    QCOMPARE(statistics.maximumPaintTime(), 0ns);
+    QCOMPARE(statistics.averageBudgetShare(), 0.0);
+}
+
+void TestEffectPaintStatistics::testAverage()
+{
+    EffectPaintStatistics statistics;
+    statistics.addFrame(1ms, 16ms);
+    statistics.addFrame(3ms, 16ms);
+    QCOMPARE(statistics.frameCount(), 2);
+    QCOMPARE(statistics.averagePaintTime(), 2ms);
+    QCOMPARE(statistics.maximumPaintTime(), 3ms);
+
+    statistics.clear();
+    QCOMPARE(statistics.frameCount(), 0);
+}
+
+void TestEffectPaintStatistics::testBudgetShare()
+{
+    EffectPaintStatistics statistics;
+    // the same paint time weighs more on a faster output
+    statistics.addFrame(2ms, 16ms);
+    statistics.addFrame(2ms, 8ms);
+    QCOMPARE(statistics.averageBudgetShare(), (0.125 + 0.25) / 2);
+
+    // frames without a known budget don't count
+    statistics.addFrame(2ms, 0ns);
+    QCOMPARE(statistics.averageBudgetShare(), (0.125 + 0.25) / 2);
+}
+
+void TestEffectPaintStatistics::testRollingWindow()
+{
+    EffectPaintStatistics statistics;
+    statistics.addFrame(10ms, 16ms);
+    for (int i = 0; i < EffectPaintStatistics::s_capacity; ++i) {
+        statistics.addFrame(1ms, 16ms);
+    }
+    QCOMPARE(statistics.frameCount(), EffectPaintStatistics::s_capacity);
+    QCOMPARE(statistics.maximumPaintTime(), 1ms);
+    QCOMPARE(statistics.averagePaintTime(), 1ms);
+}
+
+QTEST_GUILESS_MAIN(TestEffectPaintStatistics)
+
+#include "test_effectpaintstatistics.moc"
@@ -0,0 +1,104 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "core/framestatistics.h"
+
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestFrameStatistics : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testMissedFrames();
+    void testRenderTimeHistogram();
+    void testInputLatencyHistogram();
+    void testScanoutRefusals();
+    void testReset();
+};
+
+void TestFrameStatistics::testMissedFrames()
+{
+    FrameStatistics statistics;
+    const std::chrono::nanoseconds vblankInterval = 16ms;
+
+    statistics.addPresentedFrame(std::chrono::nanoseconds(100ms), std::chrono::nanoseconds(101ms), vblankInterval);
+    statistics.addPresentedFrame(std::chrono::nanoseconds(116ms), std::chrono::nanoseconds(132ms), vblankInterval);
+    statistics.addFailedFrame();
+
+    QCOMPARE(statistics.presentedFrames(), quint64(2));
+    QCOMPARE(statistics.missedFrames(), quint64(1));
+    QCOMPARE(statistics.failedFrames(), quint64(1));
+    QCOMPARE(statistics.averagePredictionError(), std::chrono::nanoseconds(8500us));
+    QCOMPARE(statistics.maximumPredictionError(), std::chrono::nanoseconds(16ms));
+}
+
+void TestFrameStatistics::testRenderTimeHistogram()
+{
+    FrameStatistics statistics;
+    statistics.addRenderTime(500us);
+    statistics.addRenderTime(3ms);
+    statistics.addRenderTime(4ms);
+    statistics.addRenderTime(100ms);
+
+    const QVector<quint64> histogram = statistics.renderTimeHistogram();
+    QCOMPARE(histogram.count(), FrameStatistics::renderTimeBuckets().count() + 1);
+    QCOMPARE(histogram[0], quint64(1));
+    QCOMPARE(histogram[2], quint64(2));
+    QCOMPARE(histogram.last(), quint64(1));
+}
+
+void TestFrameStatistics::testInputLatencyHistogram()
+{
+    FrameStatistics statistics;
+    statistics.addInputLatency(3ms);
+    statistics.addInputLatency(10ms);
+    statistics.addInputLatency(12ms);
+    statistics.addInputLatency(200ms);
+
+    const QVector<quint64> histogram = statistics.inputLatencyHistogram();
+    QCOMPARE(histogram.count(), FrameStatistics::inputLatencyBuckets().count() + 1);
+    QCOMPARE(histogram[0], quint64(1));
+    QCOMPARE(histogram[2], quint64(2));
+    QCOMPARE(histogram.last(), quint64(1));
+    QCOMPARE(statistics.maximumInputLatency(), std::chrono::nanoseconds(200ms));
+}
+
+void TestFrameStatistics::testScanoutRefusals()
+{
+    FrameStatistics statistics;
+    statistics.addScanoutRefusal(ScanoutRefusal::NotOpaque);
+    statistics.addScanoutRefusal(ScanoutRefusal::NotOpaque);
+    statistics.addScanoutRefusal(ScanoutRefusal::RejectedByOutput);
+
+    QCOMPARE(statistics.scanoutRefusals(ScanoutRefusal::NotOpaque), quint64(2));
+    QCOMPARE(statistics.scanoutRefusals(ScanoutRefusal::RejectedByOutput), quint64(1));
+    QCOMPARE(statistics.scanoutRefusals(ScanoutRefusal::NoCandidate), quint64(0));
+    QCOMPARE(FrameStatistics::scanoutRefusalName(ScanoutRefusal::NotOpaque), QStringLiteral("notOpaque"));
+}
+
+void TestFrameStatistics::testReset()
+{
+    FrameStatistics statistics;
+    statistics.addDirectScanoutFrame();
+    statistics.addRenderTime(1ms);
+    statistics.addInputLatency(5ms);
+    statistics.addScanoutRefusal(ScanoutRefusal::Shaped);
+    statistics.reset();
+
+    QCOMPARE(statistics.directScanoutFrames(), quint64(0));
+    QCOMPARE(statistics.renderTimeHistogram()[0], quint64(0));
+    QCOMPARE(statistics.averagePredictionError(), std::chrono::nanoseconds::zero());
+    QCOMPARE(statistics.inputLatencyHistogram()[1], quint64(0));
+    QCOMPARE(statistics.maximumInputLatency(), std::chrono::nanoseconds::zero());
+    QCOMPARE(statistics.scanoutRefusals(ScanoutRefusal::Shaped), quint64(0));
+}
+
+QTEST_MAIN(TestFrameStatistics)
+#include "test_framestatistics.moc"
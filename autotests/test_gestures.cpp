@@ -64,6 +64,7 @@ private Q_SLOTS:
     void testSwipeMaxFingerStart_data();
     void testSwipeMaxFingerStart();
     void testNotEmitCallbacksBeforeDirectionDecided();
+    void testRegisterAfterStart();
 
     // swipe only
     void testSwipeGeometryStart_data();
@@ -653,6 +654,48 @@ void GestureTest::testNotEmitCallbacksBeforeDirectionDecided()
     QCOMPARE(contractSpy.count(), 1);
 }
 
+void GestureTest::testRegisterAfterStart()
+{
+    GestureRecognizer recognizer;
+    SwipeGesture three;
+    three.setMinimumFingerCount(3);
+    three.setMaximumFingerCount(3);
+    SwipeGesture four;
+    four.setMinimumFingerCount(4);
+    four.setMaximumFingerCount(4);
+    PinchGesture pinch;
+    pinch.setMinimumFingerCount(4);
+
+    QSignalSpy threeSpy(&three, &SwipeGesture::started);
+    QSignalSpy fourSpy(&four, &SwipeGesture::started);
+    QSignalSpy pinchSpy(&pinch, &PinchGesture::started);
+
+    recognizer.registerSwipeGesture(&three);
+    recognizer.startSwipeGesture(4);
+    recognizer.cancelSwipeGesture();
+    recognizer.startPinchGesture(4);
+    recognizer.cancelPinchGesture();
+    QCOMPARE(threeSpy.count(), 0);
+
+    // gestures registered later still have to be found for a finger count that was looked up before
+    recognizer.registerSwipeGesture(&four);
+    recognizer.registerPinchGesture(&pinch);
+    recognizer.startSwipeGesture(4);
+    QCOMPARE(threeSpy.count(), 0);
+    QCOMPARE(fourSpy.count(), 1);
+    recognizer.cancelSwipeGesture();
+    recognizer.startPinchGesture(4);
+    QCOMPARE(pinchSpy.count(), 1);
+    recognizer.cancelPinchGesture();
+
+    recognizer.unregisterSwipeGesture(&four);
+    recognizer.startSwipeGesture(4);
+    QCOMPARE(fourSpy.count(), 1);
+    recognizer.startSwipeGesture(3);
+    QCOMPARE(threeSpy.count(), 1);
+    recognizer.cancelSwipeGesture();
+}
+
 void GestureTest::testSwipeGeometryStart_data()
 {
     QTest::addColumn<QRect>("geometry");
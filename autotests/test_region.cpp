@@ -0,0 +1,208 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/region.h"
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+using namespace KWin;
+
+class TestRegion : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testUnite();
+    void testIntersect();
+    void testSubtract();
+    void testTranslate();
+    void testLargeRegion();
+    void testEqual();
+    void testRandomOperations();
+    void benchmarkUnite_data();
+    void benchmarkUnite();
+};
+
+static QRegion pointsOf(const Region &region)
+{
+    QRegion points;
+    for (const QRect &rect : region) {
+        points += rect;
+    }
+    return points;
+}
+
+void TestRegion::testEmpty()
+{
+    const Region region;
+    QVERIFY(region.isEmpty());
+    QCOMPARE(region.rectCount(), 0);
+    QCOMPARE(region.boundingRect(), QRect());
+    QVERIFY(Region(QRect()).isEmpty());
+    QVERIFY(Region(QRegion()).isEmpty());
+    QCOMPARE(region.toQRegion(), QRegion());
+}
+
+void TestRegion::testUnite()
+{
+    Region region(QRect(0, 0, 10, 10));
+
+    // A rectangle that is in the region already doesn't add anything.
+    region += QRect(2, 2, 4, 4);
+    QCOMPARE(region.rectCount(), 1);
+
+    // Only the part outside the region is added.
+    region += QRect(5, 0, 10, 10);
+    QCOMPARE(region.rectCount(), 2);
+    QCOMPARE(region.boundingRect(), QRect(0, 0, 15, 10));
+    QCOMPARE(region.toQRegion(), QRegion(0, 0, 15, 10));
+
+    QVERIFY(region.contains(QPoint(14, 9)));
+    QVERIFY(!region.contains(QPoint(15, 9)));
+    QVERIFY(region.intersects(QRect(14, 9, 10, 10)));
+    QVERIFY(!region.intersects(QRect(15, 0, 10, 10)));
+}
+
+void TestRegion::testIntersect()
+{
+    const Region region = Region(QRect(0, 0, 10, 10)) | Region(QRect(20, 0, 10, 10));
+    QCOMPARE(region.intersected(QRect(5, 5, 20, 20)).toQRegion(), QRegion(5, 5, 5, 5) + QRegion(20, 5, 5, 5));
+    QVERIFY(region.intersected(QRect(10, 0, 10, 10)).isEmpty());
+    QCOMPARE((region & Region(QRect(0, 0, 100, 100))), region);
+}
+
+void TestRegion::testSubtract()
+{
+    // A hole in the middle leaves four rectangles around it.
+    const Region region = Region(QRect(0, 0, 30, 30)) - Region(QRect(10, 10, 10, 10));
+    QCOMPARE(region.rectCount(), 4);
+    QCOMPARE(region.toQRegion(), QRegion(0, 0, 30, 30) - QRegion(10, 10, 10, 10));
+    QVERIFY(!region.contains(QPoint(15, 15)));
+
+    QVERIFY((region - Region(QRect(0, 0, 30, 30))).isEmpty());
+    QCOMPARE(region - Region(QRect(100, 100, 10, 10)), region);
+}
+
+void TestRegion::testTranslate()
+{
+    const Region region = Region(QRect(0, 0, 10, 10)) | Region(QRect(20, 0, 10, 10));
+    QCOMPARE(region.translated(QPoint(5, 7)).toQRegion(), region.toQRegion().translated(5, 7));
+}
+
+void TestRegion::testLargeRegion()
+{
+    // More rectangles than are stored inline.
+    Region region;
+    QRegion reference;
+    for (int i = 0; i < 8; ++i) {
+        region += QRect(i * 20, 0, 10, 10);
+        reference += QRect(i * 20, 0, 10, 10);
+    }
+    QCOMPARE(region.rectCount(), 8);
+    QCOMPARE(region.toQRegion(), reference);
+    QCOMPARE(pointsOf(region), reference);
+
+    // It becomes small again once the rectangles fit inline.
+    region &= QRect(0, 0, 30, 10);
+    QCOMPARE(region.rectCount(), 2);
+    QCOMPARE(region.toQRegion(), QRegion(0, 0, 10, 10) + QRegion(20, 0, 10, 10));
+}
+
+void TestRegion::testEqual()
+{
+    // The same points made of different rectangles.
+    const Region a = Region(QRect(0, 0, 10, 10)) | Region(QRect(10, 0, 10, 10));
+    const Region b = Region(QRect(0, 0, 5, 10)) | Region(QRect(5, 0, 15, 10));
+    QVERIFY(a == b);
+    QVERIFY(a == Region(QRect(0, 0, 20, 10)));
+    QVERIFY(a != Region(QRect(0, 0, 20, 11)));
+}
+
+void TestRegion::testRandomOperations()
+{
+    QRandomGenerator generator(42);
+    auto randomRect = [&generator]() {
+        return QRect(generator.bounded(100), generator.bounded(100), generator.bounded(1, 50), generator.bounded(1, 50));
+    };
+
+    Region region;
+    QRegion reference;
+    for (int i = 0; i < 1000; ++i) {
+        const QRect rect = randomRect();
+        switch (generator.bounded(4)) {
+        case 0:
+            region |= rect;
+            reference |= rect;
+            break;
+        case 1:
+            region -= rect;
+            reference -= rect;
+            break;
+        case 2: {
+            const QRect other = randomRect();
+            region &= Region(rect) | Region(other);
+            reference &= QRegion(rect) | QRegion(other);
+            break;
+        }
+        case 3:
+            region = region.translated(QPoint(1, -1));
+            reference.translate(1, -1);
+            break;
+        }
+        QCOMPARE(region.toQRegion(), reference);
+        QCOMPARE(pointsOf(region), reference);
+        QCOMPARE(region.boundingRect(), reference.boundingRect());
+        QCOMPARE(region.isEmpty(), reference.isEmpty());
+    }
+}
+
+void TestRegion::benchmarkUnite_data()
+{
+    QTest::addColumn<bool>("qregion");
+
+    QTest::addRow("QRegion") << true;
+    QTest::addRow("Region") << false;
+}
+
+void TestRegion::benchmarkUnite()
+{
+    QFETCH(bool, qregion);
+
+    // The repaints of an item: the same few rectangles are scheduled over and over again.
+    const QRect rects[] = {
+        QRect(100, 100, 16, 16),
+        QRect(400, 300, 200, 30),
+        QRect(100, 100, 8, 16),
+        QRect(400, 300, 200, 30),
+    };
+    const QRect output(0, 0, 1920, 1080);
+
+    int rectCount = 0;
+    if (qregion) {
+        QBENCHMARK {
+            QRegion repaints;
+            for (const QRect &rect : rects) {
+                repaints += QRegion(rect) & output;
+            }
+            rectCount += repaints.rectCount();
+        }
+    } else {
+        QBENCHMARK {
+            Region repaints;
+            for (const QRect &rect : rects) {
+                repaints += Region(rect).intersected(output);
+            }
+            rectCount += repaints.rectCount();
+        }
+    }
+    QVERIFY(rectCount > 0);
+}
+
+QTEST_MAIN(TestRegion)
+
+#include "test_region.moc"
@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "core/renderjournal.h"
+
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestRenderJournal : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testGpuTimes();
+    void testPercentile();
+};
+
+void TestRenderJournal::testEmpty()
+{
+    RenderJournal journal;
+    QCOMPARE(journal.minimum(), std::chrono::nanoseconds::zero());
+    QCOMPARE(journal.maximum(), std::chrono::nanoseconds::zero());
+    QCOMPARE(journal.average(), std::chrono::nanoseconds::zero());
+    QCOMPARE(journal.percentile(90), std::chrono::nanoseconds::zero());
+    QVERIFY(!journal.hasGpuTimes());
+}
+
+void TestRenderJournal::testGpuTimes()
+{
+    RenderJournal journal;
+    journal.beginFrame();
+    journal.endFrame();
+
+    // The GPU measurement is the bottleneck, so it must dominate the estimates.
+    journal.addGpuTime(50ms);
+    QVERIFY(journal.hasGpuTimes());
+    QCOMPARE(journal.minimum(), std::chrono::nanoseconds(50ms));
+    QCOMPARE(journal.maximum(), std::chrono::nanoseconds(50ms));
+    QCOMPARE(journal.average(), std::chrono::nanoseconds(50ms));
+    QCOMPARE(journal.percentile(99), std::chrono::nanoseconds(50ms));
+}
+
+void TestRenderJournal::testPercentile()
+{
+    RenderJournal journal;
+    for (int i = 1; i <= 100; ++i) {
+        journal.addGpuTime(std::chrono::milliseconds(i));
+    }
+
+    QCOMPARE(journal.percentile(50), std::chrono::nanoseconds(50ms));
+    QCOMPARE(journal.percentile(90), std::chrono::nanoseconds(90ms));
+    QCOMPARE(journal.percentile(99), std::chrono::nanoseconds(99ms));
+    QCOMPARE(journal.percentile(100), std::chrono::nanoseconds(100ms));
+
+    // The short-term estimates only look at the most recent frames.
+    QCOMPARE(journal.minimum(), std::chrono::nanoseconds(86ms));
+    QCOMPARE(journal.maximum(), std::chrono::nanoseconds(100ms));
+}
+
+QTEST_MAIN(TestRenderJournal)
+#include "test_renderjournal.moc"
@@ -0,0 +1,91 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scripting/scriptwatchdog.h"
+
+#include <QJSEngine>
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestScriptWatchdog : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testInterrupt();
+    void testBudget();
+    void testBudgetRecovers();
+    void testReset();
+};
+
+void TestScriptWatchdog::testInterrupt()
+{
+    ScriptWatchdog watchdog(50ms, 0.5);
+    QJSEngine engine;
+
+    ScriptWatchdog::Guard guard(&engine, &watchdog);
+    const QJSValue result = engine.evaluate(QStringLiteral("while (true) {}"));
+    guard.finish();
+    QVERIFY(result.isError());
+    QVERIFY(guard.wasInterrupted());
+    QVERIFY(watchdog.account(QStringLiteral("loop"), 50ms, guard.wasInterrupted()));
+    QCOMPARE(watchdog.reports().count(), 1);
+    QCOMPARE(watchdog.reports().first().name, QStringLiteral("loop"));
+
+    // the engine can be used again afterwards
+    ScriptWatchdog::Guard other(&engine, &watchdog);
+    QCOMPARE(engine.evaluate(QStringLiteral("1 + 1")).toInt(), 2);
+    other.finish();
+    QVERIFY(!other.wasInterrupted());
+}
+
+void TestScriptWatchdog::testBudget()
+{
+    ScriptWatchdog watchdog(0ms, 0.5);
+    const auto start = std::chrono::steady_clock::now();
+
+    // 600 ms of every second for three seconds, the verdict is given with the next call
+    bool suspended = false;
+    for (int i = 0; i < 40 && !suspended; ++i) {
+        suspended = watchdog.account(QStringLiteral("busy"), 60ms, false, start + i * 100ms + 60ms);
+    }
+    QVERIFY(suspended);
+    QCOMPARE(watchdog.reports().count(), 1);
+
+    // a suspended script is reported only once
+    QVERIFY(!watchdog.account(QStringLiteral("busy"), 60ms, false, start + 5s));
+    QCOMPARE(watchdog.reports().count(), 1);
+}
+
+void TestScriptWatchdog::testBudgetRecovers()
+{
+    ScriptWatchdog watchdog(0ms, 0.5);
+    const auto start = std::chrono::steady_clock::now();
+
+    // busy for two seconds, then quiet for one, then busy for two again
+    for (int i = 0; i < 50; ++i) {
+        const bool quiet = i >= 20 && i < 30;
+        QVERIFY(!watchdog.account(QStringLiteral("bursty"), quiet ? 1ms : 60ms, false, start + i * 100ms + 60ms));
+    }
+    QVERIFY(watchdog.reports().isEmpty());
+}
+
+void TestScriptWatchdog::testReset()
+{
+    ScriptWatchdog watchdog(0ms, 0.5);
+    QVERIFY(watchdog.account(QStringLiteral("stuck"), 1s, true));
+    QVERIFY(!watchdog.account(QStringLiteral("stuck"), 1s, true));
+
+    watchdog.reset(QStringLiteral("stuck"));
+    QVERIFY(watchdog.account(QStringLiteral("stuck"), 1s, true));
+    QCOMPARE(watchdog.reports().count(), 2);
+}
+
+QTEST_GUILESS_MAIN(TestScriptWatchdog)
+
+#include "test_scriptwatchdog.moc"
@@ -0,0 +1,206 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scenes/qpainter/softwareblitter.h"
+
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QtTest>
+
+using namespace KWin;
+
+class SoftwareBlitterTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBlend_data();
+    void testBlend();
+    void testCopy();
+    void testMatchesPainter_data();
+    void testMatchesPainter();
+    void testUnsupported();
+};
+
+static uint32_t randomPremultipliedPixel(QRandomGenerator &generator)
+{
+    const uint32_t alpha = generator.bounded(4) == 0 ? 255 * generator.bounded(2) : generator.bounded(256);
+    const auto channel = [&]() {
+        return alpha ? generator.bounded(alpha + 1) : 0;
+    };
+    return (alpha << 24) | (channel() << 16) | (channel() << 8) | channel();
+}
+
+static QImage randomImage(const QSize &size, QImage::Format format, quint32 seed)
+{
+    QRandomGenerator generator(seed);
+    QImage image(size, format);
+    for (int y = 0; y < size.height(); ++y) {
+        uint32_t *line = reinterpret_cast<uint32_t *>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            line[x] = randomPremultipliedPixel(generator);
+            if (format == QImage::Format_RGB32) {
+                line[x] |= 0xff000000;
+            }
+        }
+    }
+    return image;
+}
+
+static bool fuzzyCompare(const QImage &a, const QImage &b, int tolerance)
+{
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            const QRgb p = a.pixel(x, y);
+            const QRgb q = b.pixel(x, y);
+            if (std::abs(qRed(p) - qRed(q)) > tolerance || std::abs(qGreen(p) - qGreen(q)) > tolerance
+                || std::abs(qBlue(p) - qBlue(q)) > tolerance || std::abs(qAlpha(p) - qAlpha(q)) > tolerance) {
+                qWarning() << x << y << Qt::hex << p << q;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SoftwareBlitterTest::testBlend_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("alpha");
+
+    QTest::newRow("opaque") << 64 << 255;
+    QTest::newRow("translucent") << 64 << 128;
+    QTest::newRow("tail") << 7 << 200;
+}
+
+void SoftwareBlitterTest::testBlend()
+{
+    QFETCH(int, count);
+    QFETCH(int, alpha);
+
+    QRandomGenerator generator(count * alpha);
+    std::vector<uint32_t> source(count);
+    std::vector<uint32_t> destination(count);
+    for (int i = 0; i < count; ++i) {
+        source[i] = randomPremultipliedPixel(generator);
+        destination[i] = randomPremultipliedPixel(generator);
+    }
+    const std::vector<uint32_t> original = destination;
+
+    SoftwareBlitter::blend(destination.data(), source.data(), count, alpha);
+
+    // the vectorized kernel has to produce the same result as a plain per channel blend
+    for (int i = 0; i < count; ++i) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            const auto multiply = [](int x, int a) {
+                const int t = x * a;
+                return (t + (t >> 8) + 0x80) >> 8;
+            };
+            const int s = multiply((source[i] >> shift) & 0xff, alpha);
+            const int sourceAlpha = multiply(source[i] >> 24, alpha);
+            const int expected = s + multiply((original[i] >> shift) & 0xff, 255 - sourceAlpha);
+            QCOMPARE(int((destination[i] >> shift) & 0xff), expected);
+        }
+    }
+}
+
+void SoftwareBlitterTest::testCopy()
+{
+    const QImage source = randomImage(QSize(300, 300), QImage::Format_ARGB32_Premultiplied, 1);
+    QImage buffer(QSize(400, 400), QImage::Format_RGB32);
+    buffer.fill(Qt::black);
+
+    SoftwareBlitter blitter;
+    blitter.setThreadCount(4);
+
+    QPainter painter(&buffer);
+    painter.translate(50, 60);
+    // the source is translucent, but the caller knows better
+    QVERIFY(blitter.blit(&painter, QRectF(0, 0, 300, 300), source, QRectF(0, 0, 300, 300), QRect(0, 0, 300, 300)));
+    painter.end();
+
+    QCOMPARE(buffer.copy(50, 60, 300, 300), source.convertToFormat(QImage::Format_RGB32));
+    QCOMPARE(buffer.pixel(49, 59), qRgb(0, 0, 0));
+}
+
+void SoftwareBlitterTest::testMatchesPainter_data()
+{
+    QTest::addColumn<QImage::Format>("format");
+    QTest::addColumn<qreal>("opacity");
+    QTest::addColumn<int>("threadCount");
+
+    QTest::newRow("argb32") << QImage::Format_ARGB32_Premultiplied << 1.0 << 1;
+    QTest::newRow("argb32, threads") << QImage::Format_ARGB32_Premultiplied << 1.0 << 4;
+    QTest::newRow("argb32, translucent") << QImage::Format_ARGB32_Premultiplied << 0.5 << 4;
+    QTest::newRow("rgb32") << QImage::Format_RGB32 << 1.0 << 4;
+    QTest::newRow("rgb32, translucent") << QImage::Format_RGB32 << 0.75 << 4;
+}
+
+void SoftwareBlitterTest::testMatchesPainter()
+{
+    QFETCH(QImage::Format, format);
+    QFETCH(qreal, opacity);
+    QFETCH(int, threadCount);
+
+    const QImage source = randomImage(QSize(256, 300), format, 2);
+    const QImage background = randomImage(QSize(400, 400), QImage::Format_ARGB32_Premultiplied, 3).convertToFormat(QImage::Format_RGB32);
+    const QRegion clip = QRegion(0, 0, 200, 400) + QRegion(250, 100, 150, 50);
+    const QRectF target(20, 30, 200, 250);
+    const QRectF sourceRect(10, 20, 200, 250);
+
+    QImage expected = background;
+    QPainter painter(&expected);
+    painter.setClipRegion(clip);
+    painter.setOpacity(opacity);
+    painter.translate(10, 10);
+    painter.drawImage(target, source, sourceRect);
+    painter.end();
+
+    SoftwareBlitter blitter;
+    blitter.setThreadCount(threadCount);
+
+    QImage actual = background;
+    painter.begin(&actual);
+    painter.setClipRegion(clip);
+    painter.setOpacity(opacity);
+    painter.translate(10, 10);
+    QVERIFY(blitter.blit(&painter, target, source, sourceRect));
+    painter.end();
+
+    // QPainter rounds the opacity a little differently
+    QVERIFY(fuzzyCompare(actual, expected, 2));
+}
+
+void SoftwareBlitterTest::testUnsupported()
+{
+    const QImage source = randomImage(QSize(100, 100), QImage::Format_ARGB32_Premultiplied, 4);
+    QImage buffer(QSize(200, 200), QImage::Format_RGB32);
+
+    SoftwareBlitter blitter;
+    QPainter painter(&buffer);
+
+    // scaled
+    QVERIFY(!blitter.blit(&painter, QRectF(0, 0, 50, 50), source, QRectF(0, 0, 100, 100)));
+    // fractional position
+    QVERIFY(!blitter.blit(&painter, QRectF(0.5, 0, 100, 100), source, QRectF(0, 0, 100, 100)));
+    // source outside of the image
+    QVERIFY(!blitter.blit(&painter, QRectF(0, 0, 100, 100), source, QRectF(10, 0, 100, 100)));
+    // unsupported format
+    QVERIFY(!blitter.blit(&painter, QRectF(0, 0, 100, 100), source.convertToFormat(QImage::Format_ARGB32), QRectF(0, 0, 100, 100)));
+
+    painter.rotate(90);
+    QVERIFY(!blitter.blit(&painter, QRectF(0, 0, 100, 100), source, QRectF(0, 0, 100, 100)));
+    painter.resetTransform();
+
+    // disabled
+    blitter.setThreadCount(0);
+    QVERIFY(!blitter.blit(&painter, QRectF(0, 0, 100, 100), source, QRectF(0, 0, 100, 100)));
+}
+
+QTEST_MAIN(SoftwareBlitterTest)
+
+#include "test_softwareblitter.moc"
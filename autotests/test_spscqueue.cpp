@@ -0,0 +1,95 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/spscqueue.h"
+
+#include <QtTest>
+
+#include <thread>
+
+using namespace KWin;
+
+class TestSpscQueue : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testPushPop();
+    void testCapacity();
+    void testWrapAround();
+    void testThreads();
+};
+
+void TestSpscQueue::testPushPop()
+{
+    SpscQueue<int> queue(4);
+    QVERIFY(queue.isEmpty());
+    QVERIFY(!queue.front());
+    QVERIFY(!queue.pop());
+
+    QVERIFY(queue.push(1));
+    QVERIFY(queue.push(2));
+    QVERIFY(!queue.isEmpty());
+    QCOMPARE(*queue.front(), 1);
+    QCOMPARE(queue.pop().value(), 1);
+    QCOMPARE(*queue.front(), 2);
+    QCOMPARE(queue.pop().value(), 2);
+    QVERIFY(queue.isEmpty());
+}
+
+void TestSpscQueue::testCapacity()
+{
+    SpscQueue<int> queue(3);
+    QCOMPARE(queue.capacity(), size_t(3));
+    QVERIFY(queue.push(1));
+    QVERIFY(queue.push(2));
+    QVERIFY(queue.push(3));
+    QVERIFY(!queue.push(4));
+
+    QCOMPARE(queue.pop().value(), 1);
+    QVERIFY(queue.push(4));
+    QVERIFY(!queue.push(5));
+}
+
+void TestSpscQueue::testWrapAround()
+{
+    SpscQueue<int> queue(2);
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(queue.push(i));
+        QCOMPARE(queue.pop().value(), i);
+    }
+    QVERIFY(queue.isEmpty());
+}
+
+void TestSpscQueue::testThreads()
+{
+    SpscQueue<int> queue(16);
+    const int count = 100000;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    while (expected < count) {
+        if (const auto value = queue.pop()) {
+            QCOMPARE(*value, expected);
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    QVERIFY(queue.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestSpscQueue)
+
+#include "test_spscqueue.moc"
@@ -0,0 +1,78 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "startuptracer.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestStartupTracer : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCriticalPath();
+    void testUnfinishedPhase();
+    void testJson();
+};
+
+void TestStartupTracer::testCriticalPath()
+{
+    StartupTracer tracer;
+    tracer.begin("backend", {}, 0us);
+    tracer.end("backend", 1000us);
+    tracer.begin("input", {"backend"}, 1000us);
+    tracer.end("input", 1500us);
+    // the compositor takes longer than the input, so the workspace waited for it
+    tracer.begin("compositor", {"backend"}, 1000us);
+    tracer.end("compositor", 4000us);
+    tracer.begin("workspace", {"input", "compositor"}, 4500us);
+    tracer.end("workspace", 5000us);
+
+    QCOMPARE(tracer.criticalPath(), QByteArrayList({"backend", "compositor", "workspace"}));
+    QCOMPARE(tracer.summary(), QStringLiteral("Startup took 5.0 ms, critical path:\n"
+                                              "  backend 1.0 ms\n"
+                                              "  compositor 3.0 ms\n"
+                                              "  workspace 0.5 ms (started 0.5 ms later)"));
+}
+
+void TestStartupTracer::testUnfinishedPhase()
+{
+    StartupTracer tracer;
+    QVERIFY(tracer.criticalPath().isEmpty());
+
+    tracer.begin("backend", {}, 0us);
+    tracer.end("backend", 1000us);
+    tracer.begin("xwayland", {"backend"}, 1000us);
+    QCOMPARE(tracer.criticalPath(), QByteArrayList({"backend"}));
+}
+
+void TestStartupTracer::testJson()
+{
+    StartupTracer tracer;
+    tracer.begin("backend", {}, 10us);
+    tracer.end("backend", 30us);
+    tracer.begin("workspace", {"backend"}, 40us);
+    tracer.end("workspace", 100us);
+
+    const QJsonArray events = QJsonDocument::fromJson(tracer.toJson()).object().value(QStringLiteral("traceEvents")).toArray();
+    QCOMPARE(events.count(), 2);
+    const QJsonObject workspace = events.at(1).toObject();
+    QCOMPARE(workspace.value(QStringLiteral("name")).toString(), QStringLiteral("workspace"));
+    QCOMPARE(workspace.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+    QCOMPARE(workspace.value(QStringLiteral("ts")).toInt(), 40);
+    QCOMPARE(workspace.value(QStringLiteral("dur")).toInt(), 60);
+    QCOMPARE(workspace.value(QStringLiteral("args")).toObject().value(QStringLiteral("dependencies")).toArray(), QJsonArray({QStringLiteral("backend")}));
+}
+
+QTEST_GUILESS_MAIN(TestStartupTracer)
+
+#include "test_startuptracer.moc"
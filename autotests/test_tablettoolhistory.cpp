@@ -0,0 +1,79 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tablettoolhistory.h"
+
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestTabletToolHistory : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRingBuffer();
+    void testPrediction();
+    void testPredictionWrapsAround();
+    void testLatency();
+};
+
+void TestTabletToolHistory::testRingBuffer()
+{
+    TabletToolHistory history;
+    QCOMPARE(history.count(), 0);
+    for (int i = 0; i < TabletToolHistory::s_capacity + 10; ++i) {
+        history.addSample({QPointF(i, 0), 0.5, quint32(i), 0us});
+    }
+    QCOMPARE(history.count(), TabletToolHistory::s_capacity);
+    QCOMPARE(history.sample(0).position, QPointF(TabletToolHistory::s_capacity + 9, 0));
+    QCOMPARE(history.sample(TabletToolHistory::s_capacity - 1).position, QPointF(10, 0));
+
+    history.clear();
+    QCOMPARE(history.count(), 0);
+}
+
+void TestTabletToolHistory::testPrediction()
+{
+    TabletToolHistory history;
+    history.addSample({QPointF(0, 0), 0.5, 1000, 0us});
+    QVERIFY(!history.predictPosition(10ms));
+
+    // 1 pixel per millisecond to the right, 2 down
+    history.addSample({QPointF(5, 10), 0.5, 1005, 0us});
+    history.addSample({QPointF(10, 20), 0.5, 1010, 0us});
+    QCOMPARE(history.predictPosition(10ms).value_or(QPointF()), QPointF(20, 40));
+
+    // samples outside of the velocity window don't count
+    history.addSample({QPointF(10, 20), 0.5, 1100, 0us});
+    QVERIFY(!history.predictPosition(10ms));
+    history.addSample({QPointF(10, 21), 0.5, 1101, 0us});
+    QCOMPARE(history.predictPosition(10ms).value_or(QPointF()), QPointF(10, 31));
+}
+
+void TestTabletToolHistory::testPredictionWrapsAround()
+{
+    TabletToolHistory history;
+    history.addSample({QPointF(0, 0), 0.5, 0xfffffffe, 0us});
+    history.addSample({QPointF(4, 0), 0.5, 2, 0us});
+    QCOMPARE(history.predictPosition(4ms).value_or(QPointF()), QPointF(8, 0));
+}
+
+void TestTabletToolHistory::testLatency()
+{
+    TabletToolHistory history;
+    QCOMPARE(history.averageLatency(), 0us);
+    history.addSample({QPointF(0, 0), 0.5, 0, 1000us});
+    history.addSample({QPointF(0, 0), 0.5, 1, 3000us});
+    history.addSample({QPointF(0, 0), 0.5, 2, 2000us});
+    QCOMPARE(history.averageLatency(), 2000us);
+    QCOMPARE(history.maximumLatency(), 3000us);
+}
+
+QTEST_GUILESS_MAIN(TestTabletToolHistory)
+
+#include "test_tablettoolhistory.moc"
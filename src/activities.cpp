@@ -16,6 +16,7 @@
 #include <QDBusInterface>
 #include <QDBusPendingCall>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QtConcurrentRun>
 
 namespace KWin
@@ -62,9 +63,26 @@ void Activities::slotCurrentChanged(const QString &newActivity)
     }
     m_previous = m_current;
     m_current = newActivity;
+    m_currentMask = newActivity.isEmpty() ? 0 : mask({newActivity});
     Q_EMIT currentChanged(newActivity);
 }
 
+quint64 Activities::mask(const QStringList &activities)
+{
+    // Activities come and go rarely, so their bits are never released.
+    static QHash<QString, quint64> bits;
+    quint64 mask = 0;
+    for (const QString &activity : activities) {
+        auto it = bits.constFind(activity);
+        if (it == bits.constEnd()) {
+            const quint64 bit = bits.count() < 63 ? quint64(1) << bits.count() : s_unindexedMask;
+            it = bits.insert(activity, bit);
+        }
+        mask |= *it;
+    }
+    return mask;
+}
+
 void Activities::slotRemoved(const QString &activity)
 {
     const auto windows = Workspace::self()->allClientList();
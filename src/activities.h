@@ -49,6 +49,17 @@ public:
 
     static QString nullUuid();
 
+    /**
+     * Returns the membership mask of the given @p activities. Every activity is assigned a bit
+     * the first time it is seen, if the bits run out s_unindexedMask is set instead.
+     */
+    static quint64 mask(const QStringList &activities);
+    static constexpr quint64 s_unindexedMask = quint64(1) << 63;
+    /**
+     * Returns the membership mask of the current activity.
+     */
+    quint64 currentMask() const;
+
     KActivities::Controller::ServiceStatus serviceStatus() const;
 
 Q_SIGNALS:
@@ -79,6 +90,7 @@ private Q_SLOTS:
 private:
     QString m_previous;
     QString m_current;
+    quint64 m_currentMask = 0;
     KActivities::Controller *m_controller;
 };
 
@@ -92,6 +104,11 @@ inline const QString &Activities::current() const
     return m_current;
 }
 
+inline quint64 Activities::currentMask() const
+{
+    return m_currentMask;
+}
+
 inline const QString &Activities::previous() const
 {
     return m_previous;
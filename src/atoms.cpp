@@ -47,6 +47,9 @@ Atoms::Atoms()
     , kde_net_wm_frame_strut(QByteArrayLiteral("_KDE_NET_WM_FRAME_STRUT"))
     , net_wm_sync_request_counter(QByteArrayLiteral("_NET_WM_SYNC_REQUEST_COUNTER"))
     , net_wm_sync_request(QByteArrayLiteral("_NET_WM_SYNC_REQUEST"))
+    , net_wm_frame_drawn(QByteArrayLiteral("_NET_WM_FRAME_DRAWN"))
+    , net_wm_frame_timings(QByteArrayLiteral("_NET_WM_FRAME_TIMINGS"))
+    , net_supported(QByteArrayLiteral("_NET_SUPPORTED"))
     , kde_net_wm_shadow(QByteArrayLiteral("_KDE_NET_WM_SHADOW"))
     , kde_first_in_window_list(QByteArrayLiteral("_KDE_FIRST_IN_WINDOWLIST"))
     , kde_color_sheme(QByteArrayLiteral("_KDE_NET_WM_COLOR_SCHEME"))
@@ -56,6 +56,9 @@ public:
     Xcb::Atom kde_net_wm_frame_strut;
     Xcb::Atom net_wm_sync_request_counter;
     Xcb::Atom net_wm_sync_request;
+    Xcb::Atom net_wm_frame_drawn;
+    Xcb::Atom net_wm_frame_timings;
+    Xcb::Atom net_supported;
     Xcb::Atom kde_net_wm_shadow;
     Xcb::Atom kde_first_in_window_list;
     Xcb::Atom kde_color_sheme;
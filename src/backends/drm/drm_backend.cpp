@@ -78,6 +78,10 @@ DrmBackend::DrmBackend(Session *session, QObject *parent)
 {
     setSupportsPointerWarping(true);
     setSupportsGammaControl(true);
+
+    m_hotplugTimer.setSingleShot(true);
+    m_hotplugTimer.setInterval(100);
+    connect(&m_hotplugTimer, &QTimer::timeout, this, &DrmBackend::updateOutputs);
 }
 
 DrmBackend::~DrmBackend() = default;
@@ -157,7 +161,9 @@ void DrmBackend::reactivate()
     }
 
     // While the session had been inactive, an output could have been added or
-    // removed, we need to re-scan outputs.
+    // removed, we need to re-scan outputs. The change events that have arrived in
+    // the meantime tell which connectors have to be probed, the gbm surfaces and
+    // framebuffers of the others are still valid and will be committed as they are.
     updateOutputs();
     Q_EMIT activeChanged();
 }
@@ -208,6 +214,9 @@ bool DrmBackend::initialize()
         qCWarning(KWIN_DRM) << "No suitable DRM devices have been found";
         return false;
     }
+    if (m_explicitGpus.isEmpty()) {
+        selectPrimaryGpu();
+    }
 
     // setup udevMonitor
     if (m_udevMonitor) {
@@ -223,13 +232,17 @@ bool DrmBackend::initialize()
     return true;
 }
 
+static std::optional<uint32_t> changedConnector(UdevDevice *device)
+{
+    // newer kernels tell which connector has changed
+    bool ok = false;
+    const uint32_t connectorId = QByteArray(device->property("CONNECTOR")).toUInt(&ok);
+    return ok ? std::optional<uint32_t>(connectorId) : std::nullopt;
+}
+
 void DrmBackend::handleUdevEvent()
 {
     while (auto device = m_udevMonitor->getDevice()) {
-        if (!m_active) {
-            continue;
-        }
-
         // Ignore the device seat if the KWIN_DRM_DEVICES envvar is set.
         if (!m_explicitGpus.isEmpty()) {
             if (!m_explicitGpus.contains(device->devNode())) {
@@ -241,6 +254,17 @@ void DrmBackend::handleUdevEvent()
             }
         }
 
+        if (!m_active) {
+            // The outputs are updated when the session becomes active again, remember
+            // which connectors have to be probed for that.
+            if (device->action() == QStringLiteral("change")) {
+                if (DrmGpu *gpu = findGpu(device->devNum())) {
+                    gpu->requestProbe(changedConnector(device.get()));
+                }
+            }
+            continue;
+        }
+
         if (device->action() == QStringLiteral("add")) {
             qCDebug(KWIN_DRM) << "New gpu found:" << device->devNode();
             if (addGpu(device->devNode())) {
@@ -265,12 +289,51 @@ void DrmBackend::handleUdevEvent()
             }
             if (gpu) {
                 qCDebug(KWIN_DRM) << "Received change event for monitored drm device" << gpu->devNode();
-                updateOutputs();
+                gpu->requestProbe(changedConnector(device.get()));
+                if (!m_hotplugTimer.isActive()) {
+                    m_hotplugTimer.start();
+                }
             }
         }
     }
 }
 
+static int connectedDisplayCount(int fd)
+{
+    drmModeRes *resources = drmModeGetResources(fd);
+    if (!resources) {
+        return 0;
+    }
+    int count = 0;
+    for (int i = 0; i < resources->count_connectors; ++i) {
+        if (drmModeConnector *connector = drmModeGetConnector(fd, resources->connectors[i])) {
+            if (connector->connection == DRM_MODE_CONNECTED) {
+                count++;
+            }
+            drmModeFreeConnector(connector);
+        }
+    }
+    drmModeFreeResources(resources);
+    return count;
+}
+
+void DrmBackend::selectPrimaryGpu()
+{
+    // Everything is rendered on the primary gpu and copied to the outputs of the other ones, so
+    // render on the gpu that drives most of the displays rather than on the boot gpu, which may
+    // be a weak integrated one. Gpus are listed with the boot gpu first, it wins ties.
+    const auto score = [](const std::unique_ptr<DrmGpu> &gpu) {
+        return gpu->gbmDevice() ? connectedDisplayCount(gpu->fd()) : -1;
+    };
+    const auto best = std::max_element(m_gpus.begin(), m_gpus.end(), [&score](const auto &gpu1, const auto &gpu2) {
+        return score(gpu1) < score(gpu2);
+    });
+    if (best != m_gpus.begin() && score(*best) > score(m_gpus.front())) {
+        qCDebug(KWIN_DRM) << "Rendering on" << (*best)->devNode() << "instead of the boot gpu" << m_gpus.front()->devNode();
+        std::rotate(m_gpus.begin(), best, best + 1);
+    }
+}
+
 DrmGpu *DrmBackend::addGpu(const QString &fileName)
 {
     int fd = m_session->openRestricted(fileName);
@@ -319,6 +382,9 @@ void DrmBackend::removeOutput(DrmAbstractOutput *o)
 
 void DrmBackend::updateOutputs()
 {
+    // this takes care of the pending change events as well
+    m_hotplugTimer.stop();
+
     for (auto it = m_gpus.begin(); it != m_gpus.end(); ++it) {
         if ((*it)->isRemoved()) {
             (*it)->removeOutputs();
@@ -358,6 +424,9 @@ std::unique_ptr<OpenGLBackend> DrmBackend::createOpenGLBackend()
 void DrmBackend::sceneInitialized()
 {
     if (m_outputs.isEmpty()) {
+        for (const auto &gpu : qAsConst(m_gpus)) {
+            gpu->requestProbe();
+        }
         updateOutputs();
     } else {
         for (const auto &gpu : qAsConst(m_gpus)) {
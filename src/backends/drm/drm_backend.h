@@ -14,6 +14,7 @@
 
 #include <QPointer>
 #include <QSize>
+#include <QTimer>
 #include <QVector>
 
 #include <memory>
@@ -94,9 +95,12 @@ private:
     void deactivate();
     void handleUdevEvent();
     DrmGpu *addGpu(const QString &fileName);
+    void selectPrimaryGpu();
 
     std::unique_ptr<Udev> m_udev;
     std::unique_ptr<UdevMonitor> m_udevMonitor;
+    // coalesces the bursts of change events, e.g. of the displays behind an MST hub
+    QTimer m_hotplugTimer;
     Session *m_session;
     QVector<DrmAbstractOutput *> m_outputs;
     DrmVirtualOutput *m_placeHolderOutput = nullptr;
@@ -119,6 +119,11 @@ KWaylandServer::ClientBuffer *GbmBuffer::clientBuffer() const
     return m_clientBuffer;
 }
 
+void GbmBuffer::setReleasePoint(const std::shared_ptr<SyncReleasePoint> &releasePoint)
+{
+    m_releasePoint = releasePoint;
+}
+
 bool GbmBuffer::map(uint32_t flags)
 {
     if (m_data) {
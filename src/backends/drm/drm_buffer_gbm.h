@@ -28,6 +28,7 @@ namespace KWin
 
 class GbmSurface;
 class GLTexture;
+class SyncReleasePoint;
 
 class GbmBuffer : public DrmGpuBuffer
 {
@@ -41,6 +42,12 @@ public:
     void *mappedData() const;
     KWaylandServer::ClientBuffer *clientBuffer() const;
 
+    /**
+     * Keeps the explicit sync release point of the client buffer alive until the buffer
+     * isn't scanned out anymore.
+     */
+    void setReleasePoint(const std::shared_ptr<SyncReleasePoint> &releasePoint);
+
     bool map(uint32_t flags);
 
     static std::shared_ptr<GbmBuffer> importBuffer(DrmGpu *gpu, KWaylandServer::LinuxDmaBufV1ClientBuffer *clientBuffer);
@@ -52,6 +59,7 @@ private:
     gbm_bo *const m_bo;
     const std::shared_ptr<GbmSurface> m_surface;
     KWaylandServer::ClientBuffer *const m_clientBuffer = nullptr;
+    std::shared_ptr<SyncReleasePoint> m_releasePoint;
     void *m_data = nullptr;
     void *m_mapping = nullptr;
 };
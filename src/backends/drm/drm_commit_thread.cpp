@@ -0,0 +1,230 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "drm_commit_thread.h"
+#include "drm_gpu.h"
+#include "drm_logging.h"
+
+#include <QMetaObject>
+
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+
+namespace KWin
+{
+
+// Commits that the kernel rejects because the previous page flip hasn't completed yet are
+// retried after this interval.
+static const std::chrono::microseconds s_busyRetryInterval(500);
+
+DrmCommitThread::DrmCommitThread(DrmGpu *gpu)
+    : m_gpu(gpu)
+{
+    m_thread = std::thread(&DrmCommitThread::run, this);
+    pthread_setname_np(m_thread.native_handle(), "kwin_drm_commit");
+}
+
+DrmCommitThread::~DrmCommitThread()
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_quit = true;
+    }
+    m_commitAdded.notify_all();
+    m_thread.join();
+}
+
+QVector<uint32_t> DrmCommitThread::addCommit(DrmUniquePtr<drmModeAtomicReq> &&request, const QVector<uint32_t> &crtcIds, std::chrono::nanoseconds targetTimestamp, bool allowAsync)
+{
+    auto commit = std::make_unique<Commit>();
+    commit->request = std::move(request);
+    commit->crtcIds = crtcIds;
+    commit->targetTime = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(targetTimestamp));
+    commit->allowAsync = allowAsync;
+
+    QVector<uint32_t> replaced;
+    {
+        std::unique_lock lock(m_mutex);
+        if (m_cursorCommit) {
+            // the frame knows where the cursor is supposed to be
+            if (drmModeAtomicMerge(m_cursorCommit.get(), commit->request.get()) == 0) {
+                commit->request = std::move(m_cursorCommit);
+            }
+            m_cursorCommit.reset();
+        }
+        if (m_commit) {
+            for (uint32_t crtcId : crtcIds) {
+                if (m_commit->crtcIds.contains(crtcId)) {
+                    replaced << crtcId;
+                }
+            }
+            commit = merge(std::move(m_commit), std::move(commit));
+        }
+        m_commit = std::move(commit);
+    }
+    m_commitAdded.notify_all();
+    return replaced;
+}
+
+void DrmCommitThread::addCursorCommit(DrmUniquePtr<drmModeAtomicReq> &&request, std::chrono::nanoseconds holdBack)
+{
+    const auto targetTime = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(holdBack);
+    {
+        std::unique_lock lock(m_mutex);
+        if (m_commit) {
+            // merging can only fail if libdrm runs out of memory, the cursor move is lost then
+            if (drmModeAtomicMerge(request.get(), m_commit->request.get()) == 0) {
+                m_commit->request = std::move(request);
+            }
+            return;
+        }
+        if (m_cursorCommit) {
+            if (drmModeAtomicMerge(m_cursorCommit.get(), request.get()) != 0) {
+                m_cursorCommit = std::move(request);
+            }
+            m_cursorTargetTime = std::min(m_cursorTargetTime, targetTime);
+        } else {
+            m_cursorCommit = std::move(request);
+            m_cursorTargetTime = targetTime;
+        }
+    }
+    m_commitAdded.notify_all();
+}
+
+void DrmCommitThread::flush()
+{
+    std::unique_lock lock(m_mutex);
+    if (!m_commit && !m_cursorCommit && !m_submitting) {
+        return;
+    }
+    m_flush = true;
+    m_commitAdded.notify_all();
+    m_idle.wait(lock, [this]() {
+        return !m_commit && !m_cursorCommit && !m_submitting;
+    });
+}
+
+std::unique_ptr<DrmCommitThread::Commit> DrmCommitThread::merge(std::unique_ptr<Commit> &&older, std::unique_ptr<Commit> &&newer)
+{
+    // libdrm only keeps the last value of properties that are set multiple times
+    if (drmModeAtomicMerge(older->request.get(), newer->request.get()) != 0) {
+        qCWarning(KWIN_DRM) << "Failed to merge atomic commits!" << strerror(errno);
+        return std::move(newer);
+    }
+    for (uint32_t crtcId : qAsConst(newer->crtcIds)) {
+        if (!older->crtcIds.contains(crtcId)) {
+            older->crtcIds << crtcId;
+        }
+    }
+    older->targetTime = std::min(older->targetTime, newer->targetTime);
+    older->allowAsync = older->allowAsync && newer->allowAsync;
+    return std::move(older);
+}
+
+int DrmCommitThread::submit(const Commit &commit)
+{
+    const uint32_t flags = DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+    if (commit.allowAsync) {
+        // Drivers reject async atomic commits that change anything but the framebuffers,
+        // e.g. when the cursor moved, in which case the commit is synchronized to the vblank.
+        if (drmModeAtomicCommit(m_gpu->fd(), commit.request.get(), flags | DRM_MODE_PAGE_FLIP_ASYNC, m_gpu) == 0) {
+            return 0;
+        }
+        qCDebug(KWIN_DRM) << "Async atomic commit failed, falling back to a synchronous commit" << strerror(errno);
+    }
+    if (drmModeAtomicCommit(m_gpu->fd(), commit.request.get(), flags, m_gpu) == 0) {
+        return 0;
+    }
+    return errno;
+}
+
+int DrmCommitThread::submitCursor(drmModeAtomicReq *request)
+{
+    if (drmModeAtomicCommit(m_gpu->fd(), request, DRM_MODE_ATOMIC_NONBLOCK, nullptr) == 0) {
+        return 0;
+    }
+    return errno;
+}
+
+void DrmCommitThread::run()
+{
+    std::unique_lock lock(m_mutex);
+    while (!m_quit) {
+        if (!m_commit && m_cursorCommit) {
+            // with adaptive sync, the cursor waits for the next frame to go along with it
+            if (!m_flush && std::chrono::steady_clock::now() < m_cursorTargetTime) {
+                m_commitAdded.wait_until(lock, m_cursorTargetTime);
+                continue;
+            }
+            DrmUniquePtr<drmModeAtomicReq> cursorCommit = std::move(m_cursorCommit);
+            m_submitting = true;
+            lock.unlock();
+            const int error = submitCursor(cursorCommit.get());
+            lock.lock();
+            m_submitting = false;
+
+            if (error == EBUSY) {
+                // a frame that got queued in the meantime takes care of the cursor, otherwise retry shortly
+                if (m_commit) {
+                    if (drmModeAtomicMerge(cursorCommit.get(), m_commit->request.get()) == 0) {
+                        m_commit->request = std::move(cursorCommit);
+                    }
+                } else {
+                    if (m_cursorCommit && drmModeAtomicMerge(cursorCommit.get(), m_cursorCommit.get()) != 0) {
+                        cursorCommit = std::move(m_cursorCommit);
+                    }
+                    m_cursorCommit = std::move(cursorCommit);
+                    m_commitAdded.wait_for(lock, s_busyRetryInterval);
+                }
+                continue;
+            } else if (error != 0) {
+                // the main thread moves the cursor again once it gets to the input
+                qCDebug(KWIN_DRM) << "Cursor commit failed" << strerror(error);
+            }
+            if (!m_commit && !m_cursorCommit) {
+                m_flush = false;
+                m_idle.notify_all();
+            }
+            continue;
+        }
+        if (!m_commit) {
+            m_commitAdded.wait(lock);
+            continue;
+        }
+        if (!m_flush && std::chrono::steady_clock::now() < m_commit->targetTime) {
+            m_commitAdded.wait_until(lock, m_commit->targetTime);
+            continue;
+        }
+
+        std::unique_ptr<Commit> commit = std::move(m_commit);
+        m_submitting = true;
+        lock.unlock();
+        const int error = submit(*commit);
+        lock.lock();
+        m_submitting = false;
+
+        if (error == EBUSY) {
+            m_commit = m_commit ? merge(std::move(commit), std::move(m_commit)) : std::move(commit);
+            m_commit->targetTime = std::chrono::steady_clock::now();
+            m_commitAdded.wait_for(lock, s_busyRetryInterval);
+            continue;
+        } else if (error != 0) {
+            qCCritical(KWIN_DRM) << "Atomic commit failed!" << strerror(error);
+            QMetaObject::invokeMethod(
+                m_gpu, [gpu = m_gpu, crtcIds = commit->crtcIds, error]() {
+                    gpu->handleCommitFailed(crtcIds, error);
+                },
+                Qt::QueuedConnection);
+        }
+        if (!m_commit && !m_cursorCommit) {
+            m_flush = false;
+            m_idle.notify_all();
+        }
+    }
+}
+
+}
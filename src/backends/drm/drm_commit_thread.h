@@ -0,0 +1,88 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include "drm_pointer.h"
+
+#include <QVector>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace KWin
+{
+
+class DrmGpu;
+
+/**
+ * The DrmCommitThread submits the atomic commits of a gpu from a separate thread, so that
+ * the main thread doesn't stall in the commit ioctl.
+ *
+ * A commit is held back until shortly before the vblank it targets. If a newer commit is
+ * added in the meantime, the two are merged with the values of the newer one taking
+ * precedence, so a frame that is late gets replaced by the next one instead of delaying it.
+ * Page flip events are still dispatched on the main thread.
+ */
+class DrmCommitThread
+{
+public:
+    explicit DrmCommitThread(DrmGpu *gpu);
+    ~DrmCommitThread();
+
+    /**
+     * Queues @a request, which presents new frames on the crtcs with the ids @a crtcIds, to
+     * be submitted at @a targetTimestamp. If @a allowAsync is @c true, the commit is tried
+     * without waiting for the vblank first.
+     *
+     * Returns the ids of the crtcs whose queued frame has been replaced by this one.
+     */
+    QVector<uint32_t> addCommit(DrmUniquePtr<drmModeAtomicReq> &&request, const QVector<uint32_t> &crtcIds, std::chrono::nanoseconds targetTimestamp, bool allowAsync);
+
+    /**
+     * Queues @a request, which only moves cursor planes, to be submitted without a page flip
+     * event after @a holdBack at the latest. If a frame is queued in the meantime, or already,
+     * the request is merged into that frame instead, whose values take precedence. Can be
+     * called from any thread.
+     */
+    void addCursorCommit(DrmUniquePtr<drmModeAtomicReq> &&request, std::chrono::nanoseconds holdBack = std::chrono::nanoseconds::zero());
+
+    /**
+     * Submits the queued commits, if any, right away and waits until that's done.
+     */
+    void flush();
+
+private:
+    struct Commit
+    {
+        DrmUniquePtr<drmModeAtomicReq> request;
+        QVector<uint32_t> crtcIds;
+        std::chrono::steady_clock::time_point targetTime;
+        bool allowAsync = false;
+    };
+
+    void run();
+    int submit(const Commit &commit);
+    int submitCursor(drmModeAtomicReq *request);
+    static std::unique_ptr<Commit> merge(std::unique_ptr<Commit> &&older, std::unique_ptr<Commit> &&newer);
+
+    DrmGpu *const m_gpu;
+    std::mutex m_mutex;
+    std::condition_variable m_commitAdded;
+    std::condition_variable m_idle;
+    std::unique_ptr<Commit> m_commit;
+    DrmUniquePtr<drmModeAtomicReq> m_cursorCommit;
+    std::chrono::steady_clock::time_point m_cursorTargetTime;
+    bool m_submitting = false;
+    bool m_flush = false;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+}
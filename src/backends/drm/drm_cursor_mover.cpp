@@ -0,0 +1,68 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "drm_cursor_mover.h"
+#include "drm_commit_thread.h"
+#include "drm_pointer.h"
+
+#include <xf86drmMode.h>
+
+namespace KWin
+{
+
+DrmCursorMover::DrmCursorMover()
+{
+    CursorFastPath::self()->addPlane(this);
+}
+
+DrmCursorMover::~DrmCursorMover()
+{
+    CursorFastPath::self()->removePlane(this);
+}
+
+void DrmCursorMover::setState(const State &state)
+{
+    std::unique_lock lock(m_mutex);
+    m_state = state;
+}
+
+bool DrmCursorMover::moveTo(const QPointF &position)
+{
+    std::unique_lock lock(m_mutex);
+    if (!m_state.enabled || !m_state.outputGeometry.contains(position.toPoint())) {
+        // crossing over to another output needs the main thread to set the cursor up there
+        return false;
+    }
+    // the same calculation as in DrmOutput::moveCursor()
+    const QRect cursorRect = m_state.logicalToNative.mapRect(QRect(position.toPoint() - m_state.hotspot, m_state.surfaceSize));
+    if (cursorRect.topLeft() == m_state.planePosition) {
+        return true;
+    }
+    if (!movePlane(cursorRect.topLeft())) {
+        return false;
+    }
+    m_state.planePosition = cursorRect.topLeft();
+    return true;
+}
+
+bool DrmCursorMover::movePlane(const QPoint &position)
+{
+    if (!m_state.commitThread) {
+        return drmModeMoveCursor(m_state.fd, m_state.crtcId, position.x(), position.y()) == 0;
+    }
+    DrmUniquePtr<drmModeAtomicReq> request{drmModeAtomicAlloc()};
+    if (!request) {
+        return false;
+    }
+    if (drmModeAtomicAddProperty(request.get(), m_state.planeId, m_state.crtcXProperty, position.x()) <= 0
+        || drmModeAtomicAddProperty(request.get(), m_state.planeId, m_state.crtcYProperty, position.y()) <= 0) {
+        return false;
+    }
+    m_state.commitThread->addCursorCommit(std::move(request), m_state.holdBack);
+    return true;
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include "core/cursorfastpath.h"
+
+#include <QMatrix4x4>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+
+#include <chrono>
+#include <mutex>
+
+namespace KWin
+{
+
+class DrmCommitThread;
+
+/**
+ * The DrmCursorMover moves the cursor plane of an output from the input thread.
+ *
+ * The output hands it a copy of everything that's needed to position the cursor whenever it
+ * sets or moves the cursor itself, so moving the plane doesn't touch the pipeline. With atomic
+ * modesetting the move goes through the commit thread of the gpu, so that it doesn't race with
+ * the page flips, otherwise the legacy cursor ioctl is used.
+ */
+class DrmCursorMover : public CursorPlane
+{
+public:
+    struct State
+    {
+        bool enabled = false;
+        int fd = -1;
+        uint32_t crtcId = 0;
+        // only set if the cursor is moved with atomic commits
+        DrmCommitThread *commitThread = nullptr;
+        uint32_t planeId = 0;
+        uint32_t crtcXProperty = 0;
+        uint32_t crtcYProperty = 0;
+        // logical coordinates
+        QRect outputGeometry;
+        QPoint hotspot;
+        QSize surfaceSize;
+        QMatrix4x4 logicalToNative;
+        // the current position of the plane, in native coordinates
+        QPoint planePosition;
+        // how long a move may wait for the next frame, with adaptive sync
+        std::chrono::nanoseconds holdBack = std::chrono::nanoseconds::zero();
+    };
+
+    DrmCursorMover();
+    ~DrmCursorMover() override;
+
+    /**
+     * Replaces the state of the cursor plane. Main thread only.
+     */
+    void setState(const State &state);
+
+    bool moveTo(const QPointF &position) override;
+
+private:
+    bool movePlane(const QPoint &position);
+
+    std::mutex m_mutex;
+    State m_state;
+};
+
+}
@@ -17,7 +17,9 @@
 #include "drm_dumb_swapchain.h"
 #include "drm_egl_cursor_layer.h"
 #include "drm_egl_layer.h"
+#include "drm_egl_overlay_layer.h"
 #include "drm_gbm_surface.h"
+#include "drm_gbm_surface_pool.h"
 #include "drm_gpu.h"
 #include "drm_logging.h"
 #include "drm_output.h"
@@ -33,6 +35,7 @@
 #include "wayland/clientconnection.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/surface_interface.h"
+#include "wayland_server.h"
 // kwin libs
 #include <kwineglimagetexture.h>
 #include <kwinglplatform.h>
@@ -48,6 +51,7 @@ namespace KWin
 EglGbmBackend::EglGbmBackend(DrmBackend *drmBackend)
     : AbstractEglBackend(drmBackend->primaryGpu()->deviceId())
     , m_backend(drmBackend)
+    , m_surfacePool(std::make_unique<GbmSurfacePool>(this))
 {
     drmBackend->setRenderBackend(this);
     setIsDirectRendering(true);
@@ -56,6 +60,7 @@ EglGbmBackend::EglGbmBackend(DrmBackend *drmBackend)
 EglGbmBackend::~EglGbmBackend()
 {
     m_backend->releaseBuffers();
+    m_surfacePool->clear();
     cleanup();
     m_backend->setRenderBackend(nullptr);
 }
@@ -108,6 +113,11 @@ void EglGbmBackend::init()
     initBufferAge();
     initKWinGL();
     initWayland();
+
+    // Explicit sync needs native fences, to wait for the clients and to signal the release points.
+    if (waylandServer() && m_backend->primaryGpu()->syncObjTimelineSupported() && hasExtension(QByteArrayLiteral("EGL_ANDROID_native_fence_sync"))) {
+        waylandServer()->linuxDrmSyncObj(m_backend->primaryGpu()->fd());
+    }
 }
 
 bool EglGbmBackend::initRenderingContext()
@@ -211,6 +221,14 @@ OutputLayer *EglGbmBackend::primaryLayer(Output *output)
     return static_cast<DrmAbstractOutput *>(output)->outputLayer();
 }
 
+OutputLayer *EglGbmBackend::overlayLayer(Output *output)
+{
+    if (const auto drmOutput = qobject_cast<DrmOutput *>(output)) {
+        return drmOutput->pipeline()->overlayLayer();
+    }
+    return nullptr;
+}
+
 std::shared_ptr<GLTexture> EglGbmBackend::textureForOutput(Output *output) const
 {
     const auto drmOutput = static_cast<DrmAbstractOutput *>(output);
@@ -246,6 +264,11 @@ std::shared_ptr<DrmOverlayLayer> EglGbmBackend::createCursorLayer(DrmPipeline *p
     return std::make_shared<EglGbmCursorLayer>(this, pipeline);
 }
 
+std::shared_ptr<DrmOverlayLayer> EglGbmBackend::createOverlayLayer(DrmPipeline *pipeline)
+{
+    return std::make_shared<EglGbmOverlayLayer>(this, pipeline);
+}
+
 std::shared_ptr<DrmOutputLayer> EglGbmBackend::createLayer(DrmVirtualOutput *output)
 {
     return std::make_shared<VirtualEglGbmLayer>(this, output);
@@ -256,6 +279,11 @@ DrmGpu *EglGbmBackend::gpu() const
     return m_backend->primaryGpu();
 }
 
+GbmSurfacePool *EglGbmBackend::surfacePool() const
+{
+    return m_surfacePool.get();
+}
+
 bool operator==(const GbmFormat &lhs, const GbmFormat &rhs)
 {
     return lhs.drmFormat == rhs.drmFormat;
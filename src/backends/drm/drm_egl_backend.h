@@ -40,6 +40,7 @@ class ShadowBuffer;
 class DrmBackend;
 class DrmGpu;
 class EglGbmLayer;
+class GbmSurfacePool;
 class DrmOutputLayer;
 class DrmPipeline;
 
@@ -66,11 +67,13 @@ public:
 
     void present(Output *output) override;
     OutputLayer *primaryLayer(Output *output) override;
+    OutputLayer *overlayLayer(Output *output) override;
 
     void init() override;
     bool prefer10bpc() const override;
     std::shared_ptr<DrmPipelineLayer> createPrimaryLayer(DrmPipeline *pipeline) override;
     std::shared_ptr<DrmOverlayLayer> createCursorLayer(DrmPipeline *pipeline) override;
+    std::shared_ptr<DrmOverlayLayer> createOverlayLayer(DrmPipeline *pipeline) override;
     std::shared_ptr<DrmOutputLayer> createLayer(DrmVirtualOutput *output) override;
 
     std::shared_ptr<GLTexture> textureForOutput(Output *requestedOutput) const override;
@@ -79,6 +82,7 @@ public:
     EGLConfig config(uint32_t format) const;
     std::optional<GbmFormat> gbmFormatForDrmFormat(uint32_t format) const;
     DrmGpu *gpu() const;
+    GbmSurfacePool *surfacePool() const;
 
     EGLImageKHR importBufferObjectAsImage(gbm_bo *bo);
     std::shared_ptr<GLTexture> importBufferObjectAsTexture(gbm_bo *bo);
@@ -91,6 +95,7 @@ private:
     DrmBackend *m_backend;
     QHash<uint32_t, GbmFormat> m_formats;
     QHash<uint32_t, EGLConfig> m_configs;
+    std::unique_ptr<GbmSurfacePool> m_surfacePool;
 
     friend class EglGbmTexture;
 };
@@ -14,13 +14,17 @@
 #include "drm_gpu.h"
 #include "drm_logging.h"
 #include "drm_output.h"
+#include "drm_object_crtc.h"
 #include "drm_pipeline.h"
 #include "egl_dmabuf.h"
 #include "surfaceitem_wayland.h"
+#include "utils/filedescriptor.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/surface_interface.h"
 
+#include <QMatrix4x4>
 #include <QRegion>
+#include <cmath>
 #include <drm_fourcc.h>
 #include <errno.h>
 #include <gbm.h>
@@ -39,6 +43,7 @@ EglGbmLayer::EglGbmLayer(EglGbmBackend *eglBackend, DrmPipeline *pipeline)
 std::optional<OutputLayerBeginFrameInfo> EglGbmLayer::beginFrame()
 {
     m_scanoutBuffer.reset();
+    m_frameRepeatable = false;
     m_dmabufFeedback.renderingSurface();
 
     return m_surface.startRendering(m_pipeline->bufferSize(), m_pipeline->renderOrientation(), m_pipeline->bufferOrientation(), m_pipeline->formats());
@@ -55,6 +60,8 @@ bool EglGbmLayer::endFrame(const QRegion &renderedRegion, const QRegion &damaged
     const auto ret = m_surface.endRendering(m_pipeline->renderOrientation(), damagedRegion);
     if (ret.has_value()) {
         std::tie(m_currentBuffer, m_currentDamage) = ret.value();
+        m_bufferDamage = logicalToBufferDamage(m_currentDamage);
+        m_frameRepeatable = m_currentBuffer != nullptr;
         return m_currentBuffer != nullptr;
     } else {
         return false;
@@ -66,6 +73,11 @@ QRegion EglGbmLayer::currentDamage() const
     return m_currentDamage;
 }
 
+QRegion EglGbmLayer::bufferDamage() const
+{
+    return m_bufferDamage;
+}
+
 bool EglGbmLayer::checkTestBuffer()
 {
     if (!m_currentBuffer || !m_surface.doesSurfaceFit(m_pipeline->bufferSize(), m_pipeline->formats())) {
@@ -74,21 +86,52 @@ bool EglGbmLayer::checkTestBuffer()
             return false;
         } else {
             m_currentBuffer = buffer;
+            m_frameRepeatable = false;
         }
     }
     return true;
 }
 
+bool EglGbmLayer::canRepeatFrame() const
+{
+    return m_frameRepeatable && !m_scanoutBuffer && m_currentBuffer->buffer()->size() == m_pipeline->bufferSize();
+}
+
+QRectF EglGbmLayer::sourceRect() const
+{
+    return m_scanoutBuffer ? m_scanoutSource : DrmPipelineLayer::sourceRect();
+}
+
+DrmPlane::Transformations EglGbmLayer::transformation() const
+{
+    return m_scanoutBuffer ? m_scanoutTransformation : DrmPipelineLayer::transformation();
+}
+
+bool EglGbmLayer::disableCompression()
+{
+    return m_surface.disableCompression();
+}
+
+bool EglGbmLayer::isScanoutTransformed() const
+{
+    return m_scanoutSource != QRectF(QPointF(0, 0), m_pipeline->bufferSize())
+        || m_scanoutTransformation != m_pipeline->bufferOrientation();
+}
+
 std::shared_ptr<GLTexture> EglGbmLayer::texture() const
 {
     if (m_scanoutBuffer) {
+        // the buffer only matches the output after the plane cropped, scaled or rotated it
+        if (isScanoutTransformed()) {
+            return nullptr;
+        }
         return m_surface.eglBackend()->importBufferObjectAsTexture(static_cast<GbmBuffer *>(m_scanoutBuffer->buffer())->bo());
     } else {
         return m_surface.texture();
     }
 }
 
-static DrmPlane::Transformations invertAndConvertTransform(Output::Transform transform)
+static DrmPlane::Transformations convertTransform(Output::Transform transform)
 {
     DrmPlane::Transformations ret;
     switch (transform) {
@@ -98,7 +141,7 @@ static DrmPlane::Transformations invertAndConvertTransform(Output::Transform tra
         break;
     case Output::Transform::Rotated90:
     case Output::Transform::Flipped90:
-        ret = DrmPlane::Transformation::Rotate270;
+        ret = DrmPlane::Transformation::Rotate90;
         break;
     case Output::Transform::Rotated180:
     case Output::Transform::Flipped180:
@@ -106,17 +149,57 @@ static DrmPlane::Transformations invertAndConvertTransform(Output::Transform tra
         break;
     case Output::Transform::Rotated270:
     case Output::Transform::Flipped270:
-        ret = DrmPlane::Transformation::Rotate90;
+        ret = DrmPlane::Transformation::Rotate270;
         break;
     }
-    if (transform == Output::Transform::Flipped || transform == Output::Transform::Flipped180) {
+    switch (transform) {
+    case Output::Transform::Flipped:
+    case Output::Transform::Flipped90:
+    case Output::Transform::Flipped180:
+    case Output::Transform::Flipped270:
         ret |= DrmPlane::Transformation::ReflectX;
-    } else if (transform == Output::Transform::Flipped90 || transform == Output::Transform::Flipped270) {
-        ret |= DrmPlane::Transformation::ReflectY;
+        break;
+    default:
+        break;
     }
     return ret;
 }
 
+static QPoint direction(const QMatrix4x4 &matrix, const QPointF &vector)
+{
+    const QPointF mapped = matrix.map(vector) - matrix.map(QPointF(0, 0));
+    const qreal length = std::hypot(mapped.x(), mapped.y());
+    return QPoint(std::round(mapped.x() / length), std::round(mapped.y() / length));
+}
+
+/**
+ * Finds the plane transformation that rotates and reflects the buffer the same way as
+ * @a bufferToNative does. Transformations that the plane can't do, like rotations by
+ * something other than a multiple of 90°, result in std::nullopt.
+ */
+static std::optional<DrmPlane::Transformations> planeTransformation(const QMatrix4x4 &bufferToNative)
+{
+    const QPoint x = direction(bufferToNative, QPointF(1, 0));
+    const QPoint y = direction(bufferToNative, QPointF(0, 1));
+    const Output::Transform transforms[] = {
+        Output::Transform::Normal,
+        Output::Transform::Rotated90,
+        Output::Transform::Rotated180,
+        Output::Transform::Rotated270,
+        Output::Transform::Flipped,
+        Output::Transform::Flipped90,
+        Output::Transform::Flipped180,
+        Output::Transform::Flipped270,
+    };
+    for (const Output::Transform transform : transforms) {
+        const QMatrix4x4 reference = Output::logicalToNativeMatrix(QRect(0, 0, 1, 1), 1, transform);
+        if (direction(reference, QPointF(1, 0)) == x && direction(reference, QPointF(0, 1)) == y) {
+            return convertTransform(transform);
+        }
+    }
+    return std::nullopt;
+}
+
 bool EglGbmLayer::scanout(SurfaceItem *surfaceItem)
 {
     static bool valid;
@@ -126,15 +209,50 @@ bool EglGbmLayer::scanout(SurfaceItem *surfaceItem)
     }
 
     SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
-    if (!item || !item->surface()) {
+    const auto output = m_pipeline->output();
+    if (!item || !item->surface() || !output) {
         return false;
     }
     const auto surface = item->surface();
-    if (invertAndConvertTransform(surface->bufferTransform()) != m_pipeline->bufferOrientation()) {
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    if (!buffer) {
         return false;
     }
-    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
-    if (!buffer || buffer->size() != m_pipeline->bufferSize()) {
+    // The kernel doesn't wait for explicit sync fences, let the frame be composited instead.
+    if (surface->acquireFence().isValid() && !surface->acquireFence().isReadable()) {
+        return false;
+    }
+
+    // The buffer may be cropped by a viewport, have a different size than the mode and be
+    // rotated relative to the output. With atomic modesetting the primary plane can do all
+    // of that, as long as the surface covers the whole output.
+    const QRectF source = surface->surfaceToBufferMatrix().mapRect(QRectF(QPointF(0, 0), surface->size()));
+    if (!QRectF(QPointF(0, 0), buffer->size()).contains(source)) {
+        return false;
+    }
+    const QPointF position = item->mapToGlobal(item->rect()).topLeft();
+    QMatrix4x4 bufferToNative = Output::logicalToNativeMatrix(output->geometry(), output->scale(), output->transform());
+    bufferToNative.translate(position.x(), position.y());
+    bufferToNative *= surface->surfaceToBufferMatrix().inverted();
+    if (bufferToNative.mapRect(source).toRect() != QRect(QPoint(0, 0), m_pipeline->mode()->size())) {
+        return false;
+    }
+    const auto transformation = planeTransformation(bufferToNative);
+    if (!transformation) {
+        return false;
+    }
+    m_scanoutSource = source;
+    m_scanoutTransformation = *transformation;
+    if (m_pipeline->gpu()->atomicModeSetting()) {
+        const auto plane = m_pipeline->crtc() ? m_pipeline->crtc()->primaryPlane() : nullptr;
+        if (!plane) {
+            return false;
+        }
+        if (m_scanoutTransformation != DrmPlane::Transformation::Rotate0 && (plane->supportedTransformations() & m_scanoutTransformation) != m_scanoutTransformation) {
+            return false;
+        }
+    } else if (isScanoutTransformed() || buffer->size() != m_pipeline->bufferSize()) {
+        // legacy page flips can only show the buffer as it is
         return false;
     }
 
@@ -155,11 +273,14 @@ bool EglGbmLayer::scanout(SurfaceItem *surfaceItem)
         m_dmabufFeedback.scanoutFailed(surface, formats);
         return false;
     }
+    gbmBuffer->setReleasePoint(surface->bufferReleasePoint());
     m_scanoutBuffer = DrmFramebuffer::createFramebuffer(gbmBuffer);
     if (m_scanoutBuffer && m_pipeline->testScanout()) {
         m_dmabufFeedback.scanoutSuccessful(surface);
         m_currentBuffer = m_scanoutBuffer;
+        m_frameRepeatable = false;
         m_currentDamage = surfaceItem->damage();
+        m_bufferDamage = infiniteRegion();
         surfaceItem->resetDamage();
         return true;
     } else {
@@ -182,6 +303,7 @@ bool EglGbmLayer::hasDirectScanoutBuffer() const
 void EglGbmLayer::releaseBuffers()
 {
     m_currentBuffer.reset();
+    m_frameRepeatable = false;
     m_scanoutBuffer.reset();
     m_surface.destroyResources();
 }
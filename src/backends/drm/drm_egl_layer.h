@@ -37,13 +37,25 @@ public:
     std::shared_ptr<DrmFramebuffer> currentBuffer() const override;
     bool hasDirectScanoutBuffer() const override;
     QRegion currentDamage() const override;
+    QRegion bufferDamage() const override;
+    bool canRepeatFrame() const override;
+    QRectF sourceRect() const override;
+    DrmPlane::Transformations transformation() const override;
+    bool disableCompression() override;
     std::shared_ptr<GLTexture> texture() const override;
     void releaseBuffers() override;
 
 private:
+    bool isScanoutTransformed() const;
+
     std::shared_ptr<DrmFramebuffer> m_scanoutBuffer;
+    QRectF m_scanoutSource;
+    DrmPlane::Transformations m_scanoutTransformation;
     std::shared_ptr<DrmFramebuffer> m_currentBuffer;
     QRegion m_currentDamage;
+    QRegion m_bufferDamage;
+    // whether m_currentBuffer holds the last frame that was rendered
+    bool m_frameRepeatable = false;
 
     EglGbmLayerSurface m_surface;
     DmabufFeedback m_dmabufFeedback;
@@ -14,6 +14,7 @@
 #include "drm_dumb_swapchain.h"
 #include "drm_egl_backend.h"
 #include "drm_gbm_surface.h"
+#include "drm_gbm_surface_pool.h"
 #include "drm_gpu.h"
 #include "drm_logging.h"
 #include "drm_output.h"
@@ -24,6 +25,7 @@
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/surface_interface.h"
 
+#include <algorithm>
 #include <drm_fourcc.h>
 #include <errno.h>
 #include <gbm.h>
@@ -51,6 +53,16 @@ void EglGbmLayerSurface::destroyResources()
     if (m_gbmSurface && (m_shadowBuffer || m_oldShadowBuffer)) {
         m_gbmSurface->makeContextCurrent();
     }
+    // another layer, or this one after the next modeset, will most likely need the same resources again
+    GbmSurfacePool *pool = m_eglBackend->surfacePool();
+    if (m_oldShadowBuffer != m_shadowBuffer) {
+        pool->recycle(m_oldShadowBuffer);
+    }
+    pool->recycle(m_shadowBuffer);
+    if (m_oldGbmSurface != m_gbmSurface) {
+        pool->recycle(m_oldGbmSurface);
+    }
+    pool->recycle(m_gbmSurface);
     m_shadowBuffer.reset();
     m_oldShadowBuffer.reset();
     m_gbmSurface.reset();
@@ -65,25 +77,40 @@ std::optional<OutputLayerBeginFrameInfo> EglGbmLayerSurface::startRendering(cons
     if (!m_gbmSurface->makeContextCurrent()) {
         return std::nullopt;
     }
+    m_nativeDamage = infiniteRegion();
 
     // shadow buffer
     const QSize renderSize = (renderOrientation & (DrmPlane::Transformation::Rotate90 | DrmPlane::Transformation::Rotate270)) ? m_gbmSurface->size().transposed() : m_gbmSurface->size();
     if (doesShadowBufferFit(m_shadowBuffer.get(), renderSize, renderOrientation, bufferOrientation)) {
+        if (m_oldShadowBuffer != m_shadowBuffer) {
+            m_eglBackend->surfacePool()->recycle(m_oldShadowBuffer);
+        }
         m_oldShadowBuffer.reset();
     } else {
         if (doesShadowBufferFit(m_oldShadowBuffer.get(), renderSize, renderOrientation, bufferOrientation)) {
-            m_shadowBuffer = m_oldShadowBuffer;
+            std::swap(m_shadowBuffer, m_oldShadowBuffer);
+            m_shadowBufferChanged = true;
         } else {
             if (renderOrientation != bufferOrientation) {
                 const auto format = m_eglBackend->gbmFormatForDrmFormat(m_gbmSurface->format());
                 if (!format.has_value()) {
                     return std::nullopt;
                 }
-                m_shadowBuffer = std::make_shared<ShadowBuffer>(renderSize, format.value());
-                if (!m_shadowBuffer->isComplete()) {
-                    return std::nullopt;
+                auto shadowBuffer = m_eglBackend->surfacePool()->takeShadowBuffer(renderSize, format->drmFormat);
+                if (!shadowBuffer) {
+                    shadowBuffer = std::make_shared<ShadowBuffer>(renderSize, format.value());
+                    if (!shadowBuffer->isComplete()) {
+                        return std::nullopt;
+                    }
                 }
+                if (m_oldShadowBuffer != m_shadowBuffer) {
+                    m_eglBackend->surfacePool()->recycle(m_oldShadowBuffer);
+                }
+                m_oldShadowBuffer = m_shadowBuffer;
+                m_shadowBuffer = shadowBuffer;
+                m_shadowBufferChanged = true;
             } else {
+                m_eglBackend->surfacePool()->recycle(m_shadowBuffer);
                 m_shadowBuffer.reset();
             }
         }
@@ -92,10 +119,13 @@ std::optional<OutputLayerBeginFrameInfo> EglGbmLayerSurface::startRendering(cons
     GLFramebuffer::pushFramebuffer(m_gbmSurface->fbo());
     if (m_shadowBuffer) {
         GLFramebuffer::pushFramebuffer(m_shadowBuffer->fbo());
-        // the blit after rendering will completely overwrite the back buffer anyways
+        // the blit after rendering will completely overwrite the back buffer anyways,
+        // but a shadow buffer that has just been switched to has outdated contents
+        const QRegion repaint = m_shadowBufferChanged ? infiniteRegion() : QRegion();
+        m_shadowBufferChanged = false;
         return OutputLayerBeginFrameInfo{
             .renderTarget = RenderTarget(m_shadowBuffer->fbo()),
-            .repaint = {},
+            .repaint = repaint,
         };
     } else {
         return OutputLayerBeginFrameInfo{
@@ -107,10 +137,18 @@ std::optional<OutputLayerBeginFrameInfo> EglGbmLayerSurface::startRendering(cons
 
 void EglGbmLayerSurface::aboutToStartPainting(DrmOutput *output, const QRegion &damagedRegion)
 {
+    m_paintingOutput = nullptr;
     if (m_shadowBuffer) {
         // with a shadow buffer, we always fully damage the surface
         return;
     }
+    const QMatrix4x4 matrix = Output::logicalToNativeMatrix(output->rect(), output->scale(), output->transform());
+    m_nativeDamage = QRegion();
+    for (const QRect &rect : damagedRegion) {
+        m_nativeDamage += matrix.mapRect(rect);
+    }
+    // the surface is in the coordinate system of the output, the damage can be passed on
+    m_paintingOutput = output;
     if (m_gbmSurface && m_gbmSurface->bufferAge() > 0 && !damagedRegion.isEmpty() && m_eglBackend->supportsPartialUpdate()) {
         QVector<EGLint> rects = output->regionToRects(damagedRegion);
         const bool correct = eglSetDamageRegionKHR(m_eglBackend->eglDisplay(), m_gbmSurface->eglSurface(), rects.data(), rects.count() / 4);
@@ -128,8 +166,14 @@ std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerS
         m_shadowBuffer->render(renderOrientation);
     }
     GLFramebuffer::popFramebuffer();
+    // tell the driver what has changed since the last frame, tile based gpus can skip the rest
+    QVector<EGLint> nativeDamage;
+    if (m_paintingOutput) {
+        nativeDamage = m_paintingOutput->regionToRects(damagedRegion & m_paintingOutput->rect());
+        m_paintingOutput = nullptr;
+    }
     if (m_gpu == m_eglBackend->gpu() && target != BufferTarget::Dumb) {
-        if (const auto buffer = m_gbmSurface->swapBuffers(damagedRegion)) {
+        if (const auto buffer = m_gbmSurface->swapBuffers(damagedRegion, nativeDamage)) {
             m_currentBuffer = buffer;
             auto ret = DrmFramebuffer::createFramebuffer(buffer);
             if (!ret) {
@@ -138,7 +182,7 @@ std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerS
             return std::tuple(ret, damagedRegion);
         }
     } else {
-        if (const auto gbmBuffer = m_gbmSurface->swapBuffers(damagedRegion)) {
+        if (const auto gbmBuffer = m_gbmSurface->swapBuffers(damagedRegion, nativeDamage)) {
             m_currentBuffer = gbmBuffer;
             const auto buffer = target == BufferTarget::Dumb ? importWithCpu() : importBuffer();
             if (buffer) {
@@ -153,6 +197,9 @@ bool EglGbmLayerSurface::checkGbmSurface(const QSize &bufferSize, const QMap<uin
 {
     forceLinear |= m_importMode == MultiGpuImportMode::DumbBuffer || m_importMode == MultiGpuImportMode::DumbBufferXrgb8888;
     if (doesGbmSurfaceFit(m_gbmSurface.get(), bufferSize, formats)) {
+        if (m_oldGbmSurface != m_gbmSurface) {
+            m_eglBackend->surfacePool()->recycle(m_oldGbmSurface);
+        }
         m_oldGbmSurface.reset();
     } else {
         if (doesGbmSurfaceFit(m_oldGbmSurface.get(), bufferSize, formats)) {
@@ -170,10 +217,83 @@ bool EglGbmLayerSurface::checkGbmSurface(const QSize &bufferSize, const QMap<uin
     return m_gbmSurface != nullptr;
 }
 
-bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, bool forceLinear)
+/**
+ * Returns whether buffers with @a modifier are compressed, which saves memory bandwidth when
+ * they're rendered and scanned out.
+ */
+static bool isCompressedModifier(uint64_t modifier)
+{
+    switch (modifier >> 56) {
+    case DRM_FORMAT_MOD_VENDOR_AMD:
+        return AMD_FMT_MOD_GET(DCC, modifier);
+    case DRM_FORMAT_MOD_VENDOR_INTEL:
+        return modifier == I915_FORMAT_MOD_Y_TILED_CCS
+            || modifier == I915_FORMAT_MOD_Yf_TILED_CCS
+            || modifier == I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS
+            || modifier == I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS_CC
+            || modifier == I915_FORMAT_MOD_Y_TILED_GEN12_MC_CCS
+#ifdef I915_FORMAT_MOD_4_TILED_DG2_RC_CCS
+            || modifier == I915_FORMAT_MOD_4_TILED_DG2_RC_CCS
+            || modifier == I915_FORMAT_MOD_4_TILED_DG2_RC_CCS_CC
+            || modifier == I915_FORMAT_MOD_4_TILED_DG2_MC_CCS
+#endif
+            ;
+    case DRM_FORMAT_MOD_VENDOR_ARM:
+        return ((modifier >> 52) & 0xf) == DRM_FORMAT_MOD_ARM_TYPE_AFBC;
+    default:
+        return false;
+    }
+}
+
+QVector<uint64_t> EglGbmLayerSurface::compressedModifiers(uint32_t format, const QVector<uint64_t> &planeModifiers) const
+{
+    // buffers that are shared with another gpu can't be compressed
+    if (!m_compressionAllowed || m_gpu != m_eglBackend->gpu()) {
+        return {};
+    }
+    const QVector<uint64_t> renderModifiers = m_eglBackend->supportedFormats().value(format);
+    QVector<uint64_t> ret;
+    for (const uint64_t modifier : planeModifiers) {
+        if (isCompressedModifier(modifier) && renderModifiers.contains(modifier)) {
+            ret << modifier;
+        }
+    }
+    return ret;
+}
+
+bool EglGbmLayerSurface::disableCompression()
+{
+    if (!m_compressionAllowed) {
+        return false;
+    }
+    m_compressionAllowed = false;
+    if (!m_gbmSurface) {
+        return false;
+    }
+    const QVector<uint64_t> modifiers = m_gbmSurface->modifiers();
+    return std::any_of(modifiers.begin(), modifiers.end(), isCompressedModifier);
+}
+
+QVector<uint64_t> EglGbmLayerSurface::multiGpuModifiers(uint32_t format, const QVector<uint64_t> &modifiers) const
+{
+    // The buffer is rendered by the render gpu and scanned out by m_gpu, so only the modifiers
+    // that both of them support allow importing it without a copy. Linear buffers can be shared
+    // between all gpus, so they're always an option if m_gpu can scan them out.
+    const QVector<uint64_t> renderModifiers = m_eglBackend->supportedFormats().value(format);
+    QVector<uint64_t> ret;
+    for (const uint64_t modifier : modifiers) {
+        if (modifier == DRM_FORMAT_MOD_LINEAR || renderModifiers.contains(modifier)) {
+            ret << modifier;
+        }
+    }
+    return ret;
+}
+
+bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &planeModifiers, bool forceLinear)
 {
     static bool modifiersEnvSet = false;
     static const bool modifiersEnv = qEnvironmentVariableIntValue("KWIN_DRM_USE_MODIFIERS", &modifiersEnvSet) != 0;
+    const QVector<uint64_t> modifiers = surfaceModifiers(format, planeModifiers);
     bool allowModifiers = m_gpu->addFB2ModifiersSupported() && (!modifiersEnvSet || (modifiersEnvSet && modifiersEnv)) && !modifiers.isEmpty();
 #if !HAVE_GBM_BO_GET_FD_FOR_PLANE
     allowModifiers &= m_gpu == m_eglBackend->gpu();
@@ -183,8 +303,33 @@ bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, co
         return false;
     }
 
+    if (allowModifiers && !forceLinear) {
+        // Offer only the compressed modifiers first, otherwise the driver is free to pick an
+        // uncompressed one. If the plane doesn't take them after all, the atomic test fails
+        // and compression is disabled with disableCompression().
+        const QVector<uint64_t> compressed = compressedModifiers(format, planeModifiers);
+        if (!compressed.isEmpty()) {
+            if (const auto surface = m_eglBackend->surfacePool()->takeSurface(size, format, compressed, 0)) {
+                m_oldGbmSurface = m_gbmSurface;
+                m_gbmSurface = surface;
+                return true;
+            }
+            const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, compressed, config);
+            if (const auto surface = std::get_if<std::shared_ptr<GbmSurface>>(&ret)) {
+                m_oldGbmSurface = m_gbmSurface;
+                m_gbmSurface = *surface;
+                return true;
+            }
+        }
+    }
     if (allowModifiers) {
-        const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, forceLinear ? linearModifier : modifiers, config);
+        const QVector<uint64_t> &usedModifiers = forceLinear ? linearModifier : modifiers;
+        if (const auto surface = m_eglBackend->surfacePool()->takeSurface(size, format, usedModifiers, 0)) {
+            m_oldGbmSurface = m_gbmSurface;
+            m_gbmSurface = surface;
+            return true;
+        }
+        const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, usedModifiers, config);
         if (const auto surface = std::get_if<std::shared_ptr<GbmSurface>>(&ret)) {
             m_oldGbmSurface = m_gbmSurface;
             m_gbmSurface = *surface;
@@ -200,6 +345,11 @@ bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, co
     if (forceLinear || m_gpu != m_eglBackend->gpu()) {
         gbmFlags |= GBM_BO_USE_LINEAR;
     }
+    if (const auto surface = m_eglBackend->surfacePool()->takeSurface(size, format, {}, gbmFlags)) {
+        m_oldGbmSurface = m_gbmSurface;
+        m_gbmSurface = surface;
+        return true;
+    }
     const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, gbmFlags, config);
     if (const auto surface = std::get_if<std::shared_ptr<GbmSurface>>(&ret)) {
         m_oldGbmSurface = m_gbmSurface;
@@ -251,7 +401,13 @@ bool EglGbmLayerSurface::doesGbmSurfaceFit(GbmSurface *surf, const QSize &size,
     return surf && surf->size() == size
         && formats.contains(surf->format())
         && (m_importMode != MultiGpuImportMode::DumbBufferXrgb8888 || surf->format() == DRM_FORMAT_XRGB8888)
-        && (surf->modifiers().isEmpty() || formats[surf->format()] == surf->modifiers());
+        && (surf->modifiers().isEmpty() || (surf->modifiers() == linearModifier && formats[surf->format()].contains(DRM_FORMAT_MOD_LINEAR)) || surfaceModifiers(surf->format(), formats[surf->format()]) == surf->modifiers()
+            || (!surf->modifiers().isEmpty() && compressedModifiers(surf->format(), formats[surf->format()]) == surf->modifiers()));
+}
+
+QVector<uint64_t> EglGbmLayerSurface::surfaceModifiers(uint32_t format, const QVector<uint64_t> &planeModifiers) const
+{
+    return m_gpu == m_eglBackend->gpu() ? planeModifiers : multiGpuModifiers(format, planeModifiers);
 }
 
 bool EglGbmLayerSurface::doesShadowBufferFit(ShadowBuffer *buffer, const QSize &size, DrmPlane::Transformations renderOrientation, DrmPlane::Transformations bufferOrientation) const
@@ -320,14 +476,33 @@ std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importWithCpu()
         qCWarning(KWIN_DRM, "mapping a gbm_bo failed: %s", strerror(errno));
         return nullptr;
     }
-    const auto importBuffer = m_importSwapchain->acquireBuffer();
+    QRegion needsRepaint;
+    const auto importBuffer = m_importSwapchain->acquireBuffer(&needsRepaint);
     if (m_currentBuffer->planeCount() != 1 || m_currentBuffer->strides()[0] != importBuffer->strides()[0]) {
         qCCritical(KWIN_DRM, "stride of gbm_bo (%d) and dumb buffer (%d) don't match!", m_currentBuffer->strides()[0], importBuffer->strides()[0]);
         return nullptr;
     }
-    if (!memcpy(importBuffer->data(), m_currentBuffer->mappedData(), importBuffer->size().height() * importBuffer->strides()[0])) {
-        return nullptr;
+
+    // The dumb buffer still contains the frame it was last used for, so only the parts
+    // that changed since then have to be copied
+    const QRect bufferRect(QPoint(0, 0), importBuffer->size());
+    const QRegion copyRegion = (needsRepaint | m_nativeDamage) & bufferRect;
+    const uint32_t stride = importBuffer->strides()[0];
+    const uint32_t bytesPerPixel = 4;
+    const auto src = static_cast<const uint8_t *>(m_currentBuffer->mappedData());
+    const auto dst = static_cast<uint8_t *>(importBuffer->data());
+    for (const QRect &rect : copyRegion) {
+        const size_t offset = rect.y() * stride + rect.x() * bytesPerPixel;
+        if (rect.width() == bufferRect.width()) {
+            memcpy(dst + offset, src + offset, rect.height() * stride);
+        } else {
+            const size_t rowSize = rect.width() * bytesPerPixel;
+            for (int row = 0; row < rect.height(); row++) {
+                memcpy(dst + offset + row * stride, src + offset + row * stride, rowSize);
+            }
+        }
     }
+    m_importSwapchain->releaseBuffer(importBuffer, m_nativeDamage & bufferRect);
     const auto ret = DrmFramebuffer::createFramebuffer(importBuffer);
     if (!ret) {
         qCWarning(KWIN_DRM, "Failed to create framebuffer for CPU import: %s", strerror(errno));
@@ -55,10 +55,18 @@ public:
     void destroyResources();
     EglGbmBackend *eglBackend() const;
     std::shared_ptr<DrmFramebuffer> renderTestBuffer(const QSize &bufferSize, const QMap<uint32_t, QVector<uint64_t>> &formats, BufferTarget target = BufferTarget::Normal);
+    /**
+     * Stops preferring compressed modifiers for the buffers. Returns whether the current
+     * surface is compressed, that is whether a new test buffer might work better.
+     */
+    bool disableCompression();
 
 private:
     bool checkGbmSurface(const QSize &size, const QMap<uint32_t, QVector<uint64_t>> &formats, bool forceLinear);
-    bool createGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, bool forceLinear);
+    bool createGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &planeModifiers, bool forceLinear);
+    QVector<uint64_t> multiGpuModifiers(uint32_t format, const QVector<uint64_t> &modifiers) const;
+    QVector<uint64_t> surfaceModifiers(uint32_t format, const QVector<uint64_t> &planeModifiers) const;
+    QVector<uint64_t> compressedModifiers(uint32_t format, const QVector<uint64_t> &planeModifiers) const;
     bool createGbmSurface(const QSize &size, const QMap<uint32_t, QVector<uint64_t>> &formats, bool forceLinear);
     bool doesGbmSurfaceFit(GbmSurface *surf, const QSize &size, const QMap<uint32_t, QVector<uint64_t>> &formats) const;
 
@@ -78,13 +86,17 @@ private:
     MultiGpuImportMode m_importMode = MultiGpuImportMode::Dmabuf;
 
     QRegion m_currentDamage;
+    QRegion m_nativeDamage;
+    DrmOutput *m_paintingOutput = nullptr;
     std::shared_ptr<GbmBuffer> m_currentBuffer;
     std::shared_ptr<GbmSurface> m_gbmSurface;
     std::shared_ptr<GbmSurface> m_oldGbmSurface;
     std::shared_ptr<ShadowBuffer> m_shadowBuffer;
     std::shared_ptr<ShadowBuffer> m_oldShadowBuffer;
+    bool m_shadowBufferChanged = false;
     std::shared_ptr<DumbSwapchain> m_importSwapchain;
     std::shared_ptr<DumbSwapchain> m_oldImportSwapchain;
+    bool m_compressionAllowed = true;
 
     DrmGpu *const m_gpu;
     EglGbmBackend *const m_eglBackend;
@@ -0,0 +1,145 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "drm_egl_overlay_layer.h"
+#include "drm_backend.h"
+#include "drm_buffer_gbm.h"
+#include "drm_gpu.h"
+#include "drm_object_crtc.h"
+#include "drm_object_plane.h"
+#include "drm_output.h"
+#include "drm_pipeline.h"
+#include "surfaceitem_wayland.h"
+#include "utils/filedescriptor.h"
+#include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/surface_interface.h"
+
+#include <drm_fourcc.h>
+
+namespace KWin
+{
+
+EglGbmOverlayLayer::EglGbmOverlayLayer(EglGbmBackend *eglBackend, DrmPipeline *pipeline)
+    : DrmOverlayLayer(pipeline)
+    , m_dmabufFeedback(pipeline->gpu(), eglBackend)
+{
+}
+
+std::optional<OutputLayerBeginFrameInfo> EglGbmOverlayLayer::beginFrame()
+{
+    return std::nullopt;
+}
+
+bool EglGbmOverlayLayer::endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion)
+{
+    Q_UNUSED(renderedRegion)
+    Q_UNUSED(damagedRegion)
+    return false;
+}
+
+bool EglGbmOverlayLayer::scanout(SurfaceItem *surfaceItem)
+{
+    static bool valid;
+    static const bool overlaysDisabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_OVERLAYS", &valid) == 1 && valid;
+    if (overlaysDisabled) {
+        return false;
+    }
+
+    const auto plane = m_pipeline->crtc() ? m_pipeline->crtc()->overlayPlane() : nullptr;
+    const auto output = m_pipeline->output();
+    if (!plane || !output) {
+        return false;
+    }
+    // the plane is always used unrotated and unscaled, so the buffer has to match the output exactly
+    if (m_pipeline->renderOrientation() != DrmPlane::Transformations(DrmPlane::Transformation::Rotate0)
+        || m_pipeline->bufferOrientation() != DrmPlane::Transformations(DrmPlane::Transformation::Rotate0)) {
+        return false;
+    }
+    SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+    if (!item || !item->surface()) {
+        return false;
+    }
+    const auto surface = item->surface();
+    if (surface->bufferTransform() != Output::Transform::Normal) {
+        return false;
+    }
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    if (!buffer) {
+        return false;
+    }
+    // The kernel doesn't wait for explicit sync fences, let the frame be composited instead.
+    if (surface->acquireFence().isValid() && !surface->acquireFence().isReadable()) {
+        return false;
+    }
+    const QRectF logicalRect = item->mapToGlobal(item->rect()).translated(-output->geometry().topLeft());
+    const QRectF deviceRect(logicalRect.topLeft() * output->scale(), logicalRect.size() * output->scale());
+    if (QRectF(deviceRect.toRect()) != deviceRect || deviceRect.toRect().size() != buffer->size()) {
+        return false;
+    }
+
+    const auto formats = plane->formats();
+    if (!formats.contains(buffer->format())) {
+        m_dmabufFeedback.scanoutFailed(surface, formats);
+        return false;
+    }
+    if (buffer->attributes().modifier == DRM_FORMAT_MOD_INVALID && m_pipeline->gpu()->platform()->gpuCount() > 1) {
+        // importing a buffer from another GPU without an explicit modifier can mess up the buffer format
+        return false;
+    }
+    if (!formats[buffer->format()].contains(buffer->attributes().modifier)) {
+        m_dmabufFeedback.scanoutFailed(surface, formats);
+        return false;
+    }
+    const auto gbmBuffer = GbmBuffer::importBuffer(m_pipeline->gpu(), buffer);
+    if (!gbmBuffer) {
+        m_dmabufFeedback.scanoutFailed(surface, formats);
+        return false;
+    }
+    gbmBuffer->setReleasePoint(surface->bufferReleasePoint());
+
+    m_scanoutBuffer = DrmFramebuffer::createFramebuffer(gbmBuffer);
+    setPosition(deviceRect.topLeft().toPoint());
+    setVisible(true);
+    if (m_scanoutBuffer && m_pipeline->testScanout()) {
+        m_dmabufFeedback.scanoutSuccessful(surface);
+        return true;
+    } else {
+        m_dmabufFeedback.scanoutFailed(surface, formats);
+        setVisible(false);
+        m_scanoutBuffer.reset();
+        return false;
+    }
+}
+
+void EglGbmOverlayLayer::releaseScanout()
+{
+    setVisible(false);
+    m_scanoutBuffer.reset();
+    // The compositor releases the overlay in every frame it isn't used in. Drop the scanout
+    // tranches unless the current candidate has just been given new ones.
+    m_dmabufFeedback.renderingSurface();
+}
+
+bool EglGbmOverlayLayer::checkTestBuffer()
+{
+    return true;
+}
+
+std::shared_ptr<DrmFramebuffer> EglGbmOverlayLayer::currentBuffer() const
+{
+    return m_scanoutBuffer;
+}
+
+bool EglGbmOverlayLayer::hasDirectScanoutBuffer() const
+{
+    return m_scanoutBuffer != nullptr;
+}
+
+void EglGbmOverlayLayer::releaseBuffers()
+{
+    m_scanoutBuffer.reset();
+}
+}
@@ -0,0 +1,44 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+#include "drm_dmabuf_feedback.h"
+#include "drm_layer.h"
+
+#include <optional>
+
+namespace KWin
+{
+
+class EglGbmBackend;
+
+/**
+ * A layer that presents client buffers on the overlay plane of a pipeline. It can't be
+ * rendered into, the only way to fill it is direct scanout.
+ *
+ * The overlay candidates that can't be put on the plane because of their buffer format get
+ * scanout tranches with the formats and modifiers of the plane in their dmabuf feedback.
+ */
+class EglGbmOverlayLayer : public DrmOverlayLayer
+{
+public:
+    EglGbmOverlayLayer(EglGbmBackend *eglBackend, DrmPipeline *pipeline);
+
+    std::optional<OutputLayerBeginFrameInfo> beginFrame() override;
+    bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) override;
+    bool scanout(SurfaceItem *surfaceItem) override;
+    void releaseScanout() override;
+    bool checkTestBuffer() override;
+    std::shared_ptr<DrmFramebuffer> currentBuffer() const override;
+    bool hasDirectScanoutBuffer() const override;
+    void releaseBuffers() override;
+
+private:
+    std::shared_ptr<DrmFramebuffer> m_scanoutBuffer;
+    DmabufFeedback m_dmabufFeedback;
+};
+
+}
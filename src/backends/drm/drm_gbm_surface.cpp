@@ -18,6 +18,7 @@
 #include "drm_logging.h"
 #include "kwineglutils_p.h"
 #include "kwinglplatform.h"
+#include "kwinglutils.h"
 
 namespace KWin
 {
@@ -50,6 +51,7 @@ bool GbmSurface::makeContextCurrent() const
         qCCritical(KWIN_DRM) << "eglMakeCurrent failed:" << getEglErrorString();
         return false;
     }
+    GLState::invalidate();
     if (!GLPlatform::instance()->isGLES()) {
         glDrawBuffer(GL_BACK);
         glReadBuffer(GL_BACK);
@@ -57,9 +59,14 @@ bool GbmSurface::makeContextCurrent() const
     return true;
 }
 
-std::shared_ptr<GbmBuffer> GbmSurface::swapBuffers(const QRegion &dirty)
+std::shared_ptr<GbmBuffer> GbmSurface::swapBuffers(const QRegion &dirty, const QVector<EGLint> &nativeDirty)
 {
-    auto error = eglSwapBuffers(m_eglBackend->eglDisplay(), m_eglSurface);
+    EGLBoolean error;
+    if (!nativeDirty.isEmpty() && m_eglBackend->supportsSwapBuffersWithDamage()) {
+        error = eglSwapBuffersWithDamageEXT(m_eglBackend->eglDisplay(), m_eglSurface, const_cast<EGLint *>(nativeDirty.data()), nativeDirty.count() / 4);
+    } else {
+        error = eglSwapBuffers(m_eglBackend->eglDisplay(), m_eglSurface);
+    }
     if (error != EGL_TRUE) {
         qCCritical(KWIN_DRM) << "an error occurred while swapping buffers" << getEglErrorString();
         return nullptr;
@@ -119,6 +126,11 @@ QRegion GbmSurface::repaintRegion() const
     }
 }
 
+void GbmSurface::resetDamage()
+{
+    m_damageJournal.clear();
+}
+
 uint32_t GbmSurface::flags() const
 {
     return m_flags;
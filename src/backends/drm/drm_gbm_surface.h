@@ -34,7 +34,12 @@ public:
 
     bool makeContextCurrent() const;
 
-    std::shared_ptr<GbmBuffer> swapBuffers(const QRegion &dirty);
+    /**
+     * Presents the back buffer. @a dirty is the logical region that has been repainted, used for
+     * the buffer age, and @a nativeDirty the same region as EGL rectangles in buffer coordinates,
+     * which tells the driver what changed if it supports swapping with damage.
+     */
+    std::shared_ptr<GbmBuffer> swapBuffers(const QRegion &dirty, const QVector<EGLint> &nativeDirty = {});
     void releaseBuffer(GbmBuffer *buffer);
 
     GLFramebuffer *fbo() const;
@@ -47,6 +52,10 @@ public:
     uint32_t flags() const;
     int bufferAge() const;
     QRegion repaintRegion() const;
+    /**
+     * Forgets the damage of the previous frames, so that all buffers get repainted fully.
+     */
+    void resetDamage();
 
     enum class Error {
         ModifiersUnsupported,
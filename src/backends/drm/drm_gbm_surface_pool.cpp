@@ -0,0 +1,137 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "drm_gbm_surface_pool.h"
+#include "drm_egl_backend.h"
+#include "drm_gbm_surface.h"
+#include "drm_shadow_buffer.h"
+#include "kwingltexture.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// The pool holds on to video memory, so it only keeps a few objects and not for long
+static const size_t s_maxUnusedSurfaces = 4;
+static const size_t s_maxUnusedShadowBuffers = 2;
+static const std::chrono::seconds s_expiryTime(10);
+
+GbmSurfacePool::GbmSurfacePool(EglGbmBackend *backend)
+    : m_backend(backend)
+{
+    m_expiryTimer.setSingleShot(true);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &GbmSurfacePool::expire);
+}
+
+GbmSurfacePool::~GbmSurfacePool()
+{
+    clear();
+}
+
+std::shared_ptr<GbmSurface> GbmSurfacePool::takeSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, uint32_t flags)
+{
+    const auto it = std::find_if(m_surfaces.begin(), m_surfaces.end(), [&](const auto &entry) {
+        const auto &surface = entry.object;
+        return surface->size() == size && surface->format() == format && surface->modifiers() == modifiers && surface->flags() == flags;
+    });
+    if (it == m_surfaces.end()) {
+        return nullptr;
+    }
+    const auto surface = it->object;
+    m_surfaces.erase(it);
+    // the scene changed while the surface wasn't used, its buffers have to be repainted fully
+    surface->resetDamage();
+    return surface;
+}
+
+std::shared_ptr<ShadowBuffer> GbmSurfacePool::takeShadowBuffer(const QSize &size, uint32_t format)
+{
+    const auto it = std::find_if(m_shadowBuffers.begin(), m_shadowBuffers.end(), [&](const auto &entry) {
+        return entry.object->texture()->size() == size && entry.object->drmFormat() == format;
+    });
+    if (it == m_shadowBuffers.end()) {
+        return nullptr;
+    }
+    const auto shadowBuffer = it->object;
+    m_shadowBuffers.erase(it);
+    return shadowBuffer;
+}
+
+void GbmSurfacePool::recycle(const std::shared_ptr<GbmSurface> &surface)
+{
+    const auto contains = [&surface](const auto &entry) {
+        return entry.object == surface;
+    };
+    if (!surface || !surface->isValid() || std::any_of(m_surfaces.begin(), m_surfaces.end(), contains)) {
+        return;
+    }
+    m_surfaces.push_back(Entry<GbmSurface>{surface, std::chrono::steady_clock::now()});
+    if (m_surfaces.size() > s_maxUnusedSurfaces) {
+        m_surfaces.erase(m_surfaces.begin());
+    }
+    scheduleExpiry();
+}
+
+void GbmSurfacePool::recycle(const std::shared_ptr<ShadowBuffer> &shadowBuffer)
+{
+    const auto contains = [&shadowBuffer](const auto &entry) {
+        return entry.object == shadowBuffer;
+    };
+    if (!shadowBuffer || !shadowBuffer->isComplete() || std::any_of(m_shadowBuffers.begin(), m_shadowBuffers.end(), contains)) {
+        return;
+    }
+    m_shadowBuffers.push_back(Entry<ShadowBuffer>{shadowBuffer, std::chrono::steady_clock::now()});
+    if (m_shadowBuffers.size() > s_maxUnusedShadowBuffers) {
+        m_shadowBuffers.erase(m_shadowBuffers.begin());
+    }
+    scheduleExpiry();
+}
+
+void GbmSurfacePool::clear()
+{
+    m_expiryTimer.stop();
+    m_surfaces.clear();
+    if (!m_shadowBuffers.empty()) {
+        m_backend->makeCurrent();
+        m_shadowBuffers.clear();
+    }
+}
+
+void GbmSurfacePool::expire()
+{
+    const auto deadline = std::chrono::steady_clock::now() - s_expiryTime;
+    const auto expired = [deadline](const auto &entry) {
+        return entry.recycleTime <= deadline;
+    };
+    m_surfaces.erase(std::remove_if(m_surfaces.begin(), m_surfaces.end(), expired), m_surfaces.end());
+    if (std::any_of(m_shadowBuffers.begin(), m_shadowBuffers.end(), expired)) {
+        m_backend->makeCurrent();
+        m_shadowBuffers.erase(std::remove_if(m_shadowBuffers.begin(), m_shadowBuffers.end(), expired), m_shadowBuffers.end());
+    }
+    scheduleExpiry();
+}
+
+void GbmSurfacePool::scheduleExpiry()
+{
+    if (m_expiryTimer.isActive()) {
+        return;
+    }
+    std::chrono::steady_clock::time_point oldest = std::chrono::steady_clock::time_point::max();
+    for (const auto &entry : m_surfaces) {
+        oldest = std::min(oldest, entry.recycleTime);
+    }
+    for (const auto &entry : m_shadowBuffers) {
+        oldest = std::min(oldest, entry.recycleTime);
+    }
+    if (oldest == std::chrono::steady_clock::time_point::max()) {
+        return;
+    }
+    const auto remaining = std::max(std::chrono::steady_clock::duration::zero(), oldest + s_expiryTime - std::chrono::steady_clock::now());
+    m_expiryTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(remaining) + std::chrono::milliseconds(1));
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <QObject>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+
+class EglGbmBackend;
+class GbmSurface;
+class ShadowBuffer;
+
+/**
+ * The GbmSurfacePool keeps the gbm surfaces and shadow buffers that layers don't use anymore
+ * for a few seconds, so that switching back and forth between configurations, like when
+ * testing modesets or when outputs are turned off and on again while docking, doesn't have
+ * to allocate them again every time.
+ *
+ * All surfaces are allocated on the render gpu of the backend, so there is one pool per
+ * render backend.
+ */
+class GbmSurfacePool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GbmSurfacePool(EglGbmBackend *backend);
+    ~GbmSurfacePool() override;
+
+    /**
+     * Returns an unused surface that has been created with the same parameters, or @c nullptr
+     * if there is none. The damage history of the surface is reset.
+     */
+    std::shared_ptr<GbmSurface> takeSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, uint32_t flags);
+    /**
+     * Returns an unused shadow buffer with the given size and format, or @c nullptr if there is none.
+     */
+    std::shared_ptr<ShadowBuffer> takeShadowBuffer(const QSize &size, uint32_t format);
+
+    /**
+     * Keeps @a surface around for a while so that it can be reused.
+     */
+    void recycle(const std::shared_ptr<GbmSurface> &surface);
+    /**
+     * Keeps @a shadowBuffer around for a while so that it can be reused. The OpenGL context
+     * has to be current.
+     */
+    void recycle(const std::shared_ptr<ShadowBuffer> &shadowBuffer);
+
+    /**
+     * Destroys all unused surfaces and shadow buffers.
+     */
+    void clear();
+
+private:
+    template<typename T>
+    struct Entry
+    {
+        std::shared_ptr<T> object;
+        std::chrono::steady_clock::time_point recycleTime;
+    };
+
+    void expire();
+    void scheduleExpiry();
+
+    EglGbmBackend *const m_backend;
+    std::vector<Entry<GbmSurface>> m_surfaces;
+    std::vector<Entry<ShadowBuffer>> m_shadowBuffers;
+    QTimer m_expiryTimer;
+};
+
+}
@@ -14,6 +14,7 @@
 #include "core/renderloop_p.h"
 #include "core/session.h"
 #include "drm_backend.h"
+#include "drm_commit_thread.h"
 #include "drm_egl_backend.h"
 #include "drm_layer.h"
 #include "drm_logging.h"
@@ -23,6 +24,7 @@
 #include "drm_output.h"
 #include "drm_pipeline.h"
 #include "drm_virtual_output.h"
+#include "ftrace.h"
 #include "gbm_dmabuf.h"
 #include "wayland/drmleasedevice_v1_interface.h"
 #include "wayland_server.h"
@@ -74,6 +76,12 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
     m_addFB2ModifiersSupported = drmGetCap(fd, DRM_CAP_ADDFB2_MODIFIERS, &capability) == 0 && capability == 1;
     qCDebug(KWIN_DRM) << "drmModeAddFB2WithModifiers is" << (m_addFB2ModifiersSupported ? "supported" : "not supported") << "on GPU" << m_devNode;
 
+    m_asyncPageFlipSupported = drmGetCap(fd, DRM_CAP_ASYNC_PAGE_FLIP, &capability) == 0 && capability == 1;
+    qCDebug(KWIN_DRM) << "Async page flips are" << (m_asyncPageFlipSupported ? "supported" : "not supported") << "on GPU" << m_devNode;
+
+    m_syncObjTimelineSupported = drmGetCap(fd, DRM_CAP_SYNCOBJ_TIMELINE, &capability) == 0 && capability == 1;
+    qCDebug(KWIN_DRM) << "Timeline syncobjs are" << (m_syncObjTimelineSupported ? "supported" : "not supported") << "on GPU" << m_devNode;
+
     // find out what driver this kms device is using
     DrmUniquePtr<drmVersion> version(drmGetVersion(fd));
     m_isNVidia = strstr(version->name, "nvidia-drm");
@@ -86,6 +94,10 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
 
     initDrmResources();
 
+    if (m_atomicModeSetting && qEnvironmentVariableIntValue("KWIN_DRM_NO_COMMIT_THREAD") == 0) {
+        m_commitThread = std::make_unique<DrmCommitThread>(this);
+    }
+
     m_leaseDevice = new KWaylandServer::DrmLeaseDeviceV1Interface(waylandServer()->display(), [this] {
         char *path = drmGetDeviceNameFromFd2(m_fd);
         FileDescriptor fd{open(path, O_RDWR | O_CLOEXEC)};
@@ -114,6 +126,7 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
 DrmGpu::~DrmGpu()
 {
     removeOutputs();
+    m_commitThread.reset();
     if (m_eglDisplay != EGL_NO_DISPLAY) {
         eglTerminate(m_eglDisplay);
     }
@@ -177,6 +190,7 @@ void DrmGpu::initDrmResources()
         uint32_t crtcId = resources->crtcs[i];
         DrmPlane *primary = nullptr;
         DrmPlane *cursor = nullptr;
+        DrmPlane *overlay = nullptr;
         for (const auto &plane : m_planes) {
             if (plane->isCrtcSupported(i) && !assignedPlanes.contains(plane.get())) {
                 if (plane->type() == DrmPlane::TypeIndex::Primary) {
@@ -187,6 +201,10 @@ void DrmGpu::initDrmResources()
                     if (!cursor || cursor->getProp(DrmPlane::PropertyIndex::CrtcId)->pending() == crtcId) {
                         cursor = plane.get();
                     }
+                } else if (plane->type() == DrmPlane::TypeIndex::Overlay) {
+                    if (!overlay || overlay->getProp(DrmPlane::PropertyIndex::CrtcId)->pending() == crtcId) {
+                        overlay = plane.get();
+                    }
                 }
             }
         }
@@ -196,7 +214,8 @@ void DrmGpu::initDrmResources()
         }
         assignedPlanes.push_back(primary);
         assignedPlanes.push_back(cursor);
-        auto crtc = std::make_unique<DrmCrtc>(this, crtcId, i, primary, cursor);
+        assignedPlanes.push_back(overlay);
+        auto crtc = std::make_unique<DrmCrtc>(this, crtcId, i, primary, cursor, overlay);
         if (!crtc->init()) {
             continue;
         }
@@ -205,9 +224,19 @@ void DrmGpu::initDrmResources()
     }
 }
 
+void DrmGpu::requestProbe(std::optional<uint32_t> connectorId)
+{
+    if (connectorId) {
+        m_connectorsToProbe.insert(*connectorId);
+    } else {
+        m_probeAllConnectors = true;
+    }
+}
+
 bool DrmGpu::updateOutputs()
 {
     waitIdle();
+    invalidateTestResults();
     DrmUniquePtr<drmModeRes> resources(drmModeGetResources(m_fd));
     if (!resources) {
         qCWarning(KWIN_DRM) << "drmModeGetResources failed";
@@ -249,10 +278,15 @@ bool DrmGpu::updateOutputs()
             m_allObjects.push_back(conn.get());
             m_connectors.push_back(std::move(conn));
         } else {
+            if (m_probeAllConnectors || m_connectorsToProbe.contains(currentConnector)) {
+                (*it)->requestProbe();
+            }
             (*it)->updateProperties();
             existing.push_back(it->get());
         }
     }
+    m_connectorsToProbe.clear();
+    m_probeAllConnectors = false;
     for (auto it = m_connectors.begin(); it != m_connectors.end();) {
         DrmConnector *conn = it->get();
         const auto output = findOutput(conn->id());
@@ -270,7 +304,7 @@ bool DrmGpu::updateOutputs()
             m_drmOutputs << output;
             addedOutputs << output;
             Q_EMIT outputAdded(output);
-            pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline));
+            pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline), m_platform->renderBackend()->createOverlayLayer(pipeline));
             pipeline->setActive(!conn->isNonDesktop());
             pipeline->applyPendingChanges();
         }
@@ -441,6 +475,19 @@ DrmPipeline::Error DrmGpu::testPendingConfiguration()
         }
         if (hwRotationUsed) {
             err = checkCrtcAssignment(connectors, crtcs);
+            if (err == DrmPipeline::Error::None) {
+                return err;
+            }
+        }
+        // and without compressed buffers
+        bool compressionUsed = false;
+        for (const auto &pipeline : qAsConst(m_pipelines)) {
+            if (pipeline->primaryLayer()) {
+                compressionUsed |= pipeline->primaryLayer()->disableCompression();
+            }
+        }
+        if (compressionUsed) {
+            err = checkCrtcAssignment(connectors, crtcs);
         }
         return err;
     }
@@ -480,6 +527,9 @@ DrmOutput *DrmGpu::findOutput(quint32 connector)
 
 void DrmGpu::waitIdle()
 {
+    if (m_commitThread) {
+        m_commitThread->flush();
+    }
     m_socketNotifier->setEnabled(false);
     while (true) {
         const bool idle = std::all_of(m_drmOutputs.constBegin(), m_drmOutputs.constEnd(), [](DrmOutput *output) {
@@ -533,7 +583,6 @@ static std::chrono::nanoseconds convertTimestamp(clockid_t sourceClock, clockid_
 void DrmGpu::pageFlipHandler(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, unsigned int crtc_id, void *user_data)
 {
     Q_UNUSED(fd)
-    Q_UNUSED(sequence)
 
     DrmGpu *gpu = static_cast<DrmGpu *>(user_data);
 
@@ -556,8 +605,76 @@ void DrmGpu::pageFlipHandler(int fd, unsigned int sequence, unsigned int sec, un
     if (it == pipelines.end()) {
         qCWarning(KWIN_DRM, "received invalid page flip event for crtc %u", crtc_id);
     } else {
+        if (DrmOutput *output = (*it)->output()) {
+            fTrace("Page flip (", output->name(), ") crtc=", crtc_id, " sequence=", sequence, " timestamp=", timestamp.count());
+        }
         (*it)->pageFlipped(timestamp);
+        if (DrmOutput *output = (*it)->output()) {
+            output->presentDeferredFrame();
+        }
+    }
+}
+
+void DrmGpu::handleCommitFailed(const QVector<uint32_t> &crtcIds, int error)
+{
+    invalidateTestResults();
+    for (DrmPipeline *pipeline : qAsConst(m_pipelines)) {
+        if (pipeline->currentCrtc() && crtcIds.contains(pipeline->currentCrtc()->id())) {
+            pipeline->pageFlipFailed();
+            if (DrmOutput *output = pipeline->output()) {
+                output->presentDeferredFrame();
+            }
+        }
+    }
+    if (error == EINVAL) {
+        // the state the commit was based on doesn't match the state of the kernel anymore
+        QTimer::singleShot(0, m_platform, &DrmBackend::updateOutputs);
+    }
+}
+
+void DrmGpu::handleFramesReplaced(const QVector<uint32_t> &crtcIds)
+{
+    for (DrmPipeline *pipeline : qAsConst(m_pipelines)) {
+        if (pipeline->currentCrtc() && pipeline->output() && crtcIds.contains(pipeline->currentCrtc()->id())) {
+            pipeline->output()->frameFailed();
+        }
+    }
+}
+
+DrmCommitThread *DrmGpu::commitThread() const
+{
+    return m_commitThread.get();
+}
+
+std::optional<DrmGpu::TestResult> DrmGpu::cachedTestResult(const QByteArray &key) const
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_TEST_CACHE") != 0;
+    if (disabled) {
+        return std::nullopt;
+    }
+    const auto it = m_testResults.constFind(key);
+    if (it == m_testResults.constEnd()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+void DrmGpu::cacheTestResult(const QByteArray &key, DrmPipeline::Error error, bool needsModeset)
+{
+    // only the outcomes that depend on the configuration alone can be reused
+    if (error != DrmPipeline::Error::None && error != DrmPipeline::Error::InvalidArguments) {
+        return;
+    }
+    // direct scanout of many different clients could make the cache grow without bounds
+    if (m_testResults.size() >= 256) {
+        m_testResults.clear();
     }
+    m_testResults.insert(key, TestResult{error, needsModeset});
+}
+
+void DrmGpu::invalidateTestResults()
+{
+    m_testResults.clear();
 }
 
 void DrmGpu::dispatchEvents()
@@ -572,7 +689,7 @@ void DrmGpu::removeOutput(DrmOutput *output)
 {
     qCDebug(KWIN_DRM) << "Removing output" << output;
     m_pipelines.removeOne(output->pipeline());
-    output->pipeline()->setLayers(nullptr, nullptr);
+    output->pipeline()->setLayers(nullptr, nullptr, nullptr);
     m_drmOutputs.removeOne(output);
     Q_EMIT outputRemoved(output);
     output->unref();
@@ -706,6 +823,16 @@ bool DrmGpu::addFB2ModifiersSupported() const
     return m_addFB2ModifiersSupported;
 }
 
+bool DrmGpu::asyncPageFlipSupported() const
+{
+    return m_asyncPageFlipSupported;
+}
+
+bool DrmGpu::syncObjTimelineSupported() const
+{
+    return m_syncObjTimelineSupported;
+}
+
 bool DrmGpu::isNVidia() const
 {
     return m_isNVidia;
@@ -776,6 +903,7 @@ QVector<DrmObject *> DrmGpu::unusedObjects() const
             ret.removeOne(pipeline->crtc());
             ret.removeOne(pipeline->crtc()->primaryPlane());
             ret.removeOne(pipeline->crtc()->cursorPlane());
+            ret.removeOne(pipeline->crtc()->overlayPlane());
         }
     }
     return ret;
@@ -797,6 +925,9 @@ void DrmGpu::releaseBuffers()
     for (const auto &pipeline : qAsConst(m_pipelines)) {
         pipeline->primaryLayer()->releaseBuffers();
         pipeline->cursorLayer()->releaseBuffers();
+        if (const auto overlayLayer = pipeline->overlayLayer()) {
+            overlayLayer->releaseBuffers();
+        }
     }
     for (const auto &output : qAsConst(m_virtualOutputs)) {
         output->outputLayer()->releaseBuffers();
@@ -806,14 +937,14 @@ void DrmGpu::releaseBuffers()
 void DrmGpu::recreateSurfaces()
 {
     for (const auto &pipeline : qAsConst(m_pipelines)) {
-        pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline));
+        pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline), m_platform->renderBackend()->createOverlayLayer(pipeline));
         pipeline->applyPendingChanges();
     }
     for (const auto &output : qAsConst(m_virtualOutputs)) {
         output->recreateSurface();
     }
     for (const auto &output : qAsConst(m_drmOutputs)) {
-        output->updateCursor();
+        Q_EMIT output->cursorInvalidated();
     }
 }
 
@@ -12,13 +12,16 @@
 
 #include "drm_pipeline.h"
 
+#include <QHash>
 #include <QPointer>
+#include <QSet>
 #include <QSize>
 #include <QSocketNotifier>
 #include <QVector>
 #include <qobject.h>
 
 #include <epoxy/egl.h>
+#include <optional>
 #include <sys/types.h>
 
 struct gbm_device;
@@ -42,6 +45,7 @@ class EglGbmBackend;
 class DrmAbstractOutput;
 class DrmRenderBackend;
 class DrmVirtualOutput;
+class DrmCommitThread;
 
 class DrmGpu : public QObject
 {
@@ -59,6 +63,8 @@ public:
 
     bool atomicModeSetting() const;
     bool addFB2ModifiersSupported() const;
+    bool asyncPageFlipSupported() const;
+    bool syncObjTimelineSupported() const;
     bool isNVidia() const;
     gbm_device *gbmDevice() const;
     EGLDisplay eglDisplay() const;
@@ -79,6 +85,12 @@ public:
     bool updateOutputs();
     void removeOutputs();
 
+    /**
+     * Makes the next updateOutputs() probe the connector with @a connectorId again, or all
+     * connectors if there's no id. The other connectors only have their state re-read.
+     */
+    void requestProbe(std::optional<uint32_t> connectorId = std::nullopt);
+
     DrmVirtualOutput *createVirtualOutput(const QString &name, const QSize &size, double scale);
     void removeVirtualOutput(DrmVirtualOutput *output);
 
@@ -89,6 +101,38 @@ public:
     void releaseBuffers();
     void recreateSurfaces();
 
+    /**
+     * Returns the thread that submits the atomic commits presenting frames, or @c nullptr
+     * if they're submitted directly.
+     */
+    DrmCommitThread *commitThread() const;
+
+    struct TestResult
+    {
+        DrmPipeline::Error error;
+        bool needsModeset;
+    };
+    /**
+     * Returns the outcome of an earlier test commit of the configuration described by @a key,
+     * see DrmObject::appendTestKey().
+     */
+    std::optional<TestResult> cachedTestResult(const QByteArray &key) const;
+    void cacheTestResult(const QByteArray &key, DrmPipeline::Error error, bool needsModeset);
+    /**
+     * Forgets about all test outcomes, they have to be invalidated whenever something that
+     * isn't part of the keys changes, like the set of connected outputs or the modes.
+     */
+    void invalidateTestResults();
+    /**
+     * Called when the commit thread failed to submit the frames of the crtcs @a crtcIds.
+     */
+    void handleCommitFailed(const QVector<uint32_t> &crtcIds, int error);
+    /**
+     * Called when the frames of the crtcs @a crtcIds have been replaced by newer ones
+     * before they were submitted.
+     */
+    void handleFramesReplaced(const QVector<uint32_t> &crtcIds);
+
 Q_SIGNALS:
     void outputAdded(DrmAbstractOutput *output);
     void outputRemoved(DrmAbstractOutput *output);
@@ -114,6 +158,8 @@ private:
     const QString m_devNode;
     bool m_atomicModeSetting;
     bool m_addFB2ModifiersSupported = false;
+    bool m_asyncPageFlipSupported = false;
+    bool m_syncObjTimelineSupported = false;
     bool m_isNVidia;
     bool m_isVirtualMachine;
     bool m_isRemoved = false;
@@ -125,6 +171,8 @@ private:
     std::vector<std::unique_ptr<DrmPlane>> m_planes;
     std::vector<std::unique_ptr<DrmCrtc>> m_crtcs;
     std::vector<std::unique_ptr<DrmConnector>> m_connectors;
+    QSet<uint32_t> m_connectorsToProbe;
+    bool m_probeAllConnectors = false;
     QVector<DrmObject *> m_allObjects;
     QVector<DrmPipeline *> m_pipelines;
 
@@ -134,6 +182,8 @@ private:
 
     QSocketNotifier *m_socketNotifier = nullptr;
     QSize m_cursorSize;
+    std::unique_ptr<DrmCommitThread> m_commitThread;
+    QHash<QByteArray, TestResult> m_testResults;
 };
 
 }
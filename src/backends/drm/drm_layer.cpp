@@ -7,6 +7,8 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "drm_layer.h"
+#include "drm_buffer.h"
+#include "drm_output.h"
 #include "drm_pipeline.h"
 
 #include <QMatrix4x4>
@@ -36,6 +38,40 @@ bool DrmPipelineLayer::hasDirectScanoutBuffer() const
     return false;
 }
 
+QRegion DrmPipelineLayer::bufferDamage() const
+{
+    return infiniteRegion();
+}
+
+QRectF DrmPipelineLayer::sourceRect() const
+{
+    return QRectF(QPointF(0, 0), currentBuffer()->buffer()->size());
+}
+
+DrmPlane::Transformations DrmPipelineLayer::transformation() const
+{
+    return m_pipeline->bufferOrientation();
+}
+
+bool DrmPipelineLayer::disableCompression()
+{
+    return false;
+}
+
+QRegion DrmPipelineLayer::logicalToBufferDamage(const QRegion &damage) const
+{
+    const DrmOutput *output = m_pipeline->output();
+    if (!output || m_pipeline->bufferOrientation() != DrmPlane::Transformation::Rotate0) {
+        return infiniteRegion();
+    }
+    const QMatrix4x4 matrix = Output::logicalToNativeMatrix(output->rect(), output->scale(), output->transform());
+    QRegion ret;
+    for (const QRect &rect : damage) {
+        ret += matrix.mapRect(rect);
+    }
+    return ret;
+}
+
 DrmOverlayLayer::DrmOverlayLayer(DrmPipeline *pipeline)
     : DrmPipelineLayer(pipeline)
 {
@@ -8,6 +8,7 @@
 */
 #pragma once
 #include "core/outputlayer.h"
+#include "drm_object_plane.h"
 
 #include <QRegion>
 #include <memory>
@@ -39,8 +40,34 @@ public:
     virtual bool checkTestBuffer() = 0;
     virtual std::shared_ptr<DrmFramebuffer> currentBuffer() const = 0;
     virtual bool hasDirectScanoutBuffer() const;
+    /**
+     * Returns the part of currentBuffer() that changed since the previous frame, in buffer
+     * coordinates. By default the whole buffer is considered damaged.
+     */
+    virtual QRegion bufferDamage() const;
+    /**
+     * Returns the part of currentBuffer() that's shown on the output, in buffer coordinates.
+     * By default that's the whole buffer.
+     */
+    virtual QRectF sourceRect() const;
+    /**
+     * Returns the transformation the primary plane applies to currentBuffer() to show it
+     * on the output. By default that's the buffer orientation of the pipeline.
+     */
+    virtual DrmPlane::Transformations transformation() const;
+    /**
+     * Makes the layer render into uncompressed buffers from now on. Returns whether that
+     * changes the buffer of the next test commit. By default buffers aren't compressed.
+     */
+    virtual bool disableCompression();
 
 protected:
+    /**
+     * Maps @a damage from the logical coordinates of the output to buffer coordinates, as
+     * long as the buffer isn't rotated by the plane.
+     */
+    QRegion logicalToBufferDamage(const QRegion &damage) const;
+
     DrmPipeline *const m_pipeline;
 };
 
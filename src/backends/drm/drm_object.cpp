@@ -8,6 +8,7 @@
 */
 #include "drm_object.h"
 
+#include <algorithm>
 #include <errno.h>
 
 #include "drm_gpu.h"
@@ -85,6 +86,28 @@ bool DrmObject::atomicPopulate(drmModeAtomicReq *req) const
     return true;
 }
 
+void DrmObject::appendTestKey(QByteArray &key) const
+{
+    appendTestKeyValue(key, m_id);
+    for (size_t i = 0; i < m_props.size(); i++) {
+        const auto &property = m_props[i];
+        if (property && !property->isImmutable() && !property->isLegacy()) {
+            appendTestKeyProperty(key, i, property.get());
+        }
+    }
+}
+
+void DrmObject::appendTestKeyProperty(QByteArray &key, uint32_t index, const DrmProperty *property) const
+{
+    appendTestKeyValue(key, index);
+    appendTestKeyValue(key, property->pending());
+}
+
+void DrmObject::appendTestKeyValue(QByteArray &key, uint64_t value)
+{
+    key.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
 void DrmObject::commit()
 {
     for (const auto &prop : qAsConst(m_props)) {
@@ -129,26 +152,45 @@ bool DrmObject::updateProperties()
         qCWarning(KWIN_DRM) << "Failed to get properties for object" << m_id;
         return false;
     }
-    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
-        const PropertyDefinition &def = m_propertyDefinitions[propIndex];
-        bool found = false;
-        for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
-            DrmUniquePtr<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), properties->props[drmPropIndex]));
-            if (!prop) {
-                qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+    // Only the values are re-read for the properties that are known already, fetching the
+    // metadata of every property takes an ioctl each.
+    std::vector<bool> found(m_propertyDefinitions.count(), false);
+    for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
+        const uint32_t propId = properties->props[drmPropIndex];
+        const uint64_t value = properties->prop_values[drmPropIndex];
+        if (const auto it = m_propertyIndices.constFind(propId); it != m_propertyIndices.constEnd()) {
+            if (*it < 0) {
                 continue;
             }
-            if (def.name == prop->name) {
-                if (m_props[propIndex]) {
-                    m_props[propIndex]->setCurrent(properties->prop_values[drmPropIndex]);
-                } else {
-                    m_props[propIndex] = std::make_unique<DrmProperty>(this, prop.get(), properties->prop_values[drmPropIndex], def.enumNames);
-                }
-                found = true;
-                break;
+            if (const auto &property = m_props[*it]; property && property->propId() == propId) {
+                property->setCurrent(value);
+                found[*it] = true;
+                continue;
             }
         }
-        if (!found) {
+        DrmUniquePtr<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), propId));
+        if (!prop) {
+            qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+            continue;
+        }
+        const auto def = std::find_if(m_propertyDefinitions.begin(), m_propertyDefinitions.end(), [&prop](const PropertyDefinition &def) {
+            return def.name == prop->name;
+        });
+        if (def == m_propertyDefinitions.end()) {
+            m_propertyIndices.insert(propId, -1);
+            continue;
+        }
+        const int propIndex = std::distance(m_propertyDefinitions.begin(), def);
+        m_propertyIndices.insert(propId, propIndex);
+        if (m_props[propIndex] && m_props[propIndex]->propId() == propId) {
+            m_props[propIndex]->setCurrent(value);
+        } else {
+            m_props[propIndex] = std::make_unique<DrmProperty>(this, prop.get(), value, def->enumNames);
+        }
+        found[propIndex] = true;
+    }
+    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
+        if (!found[propIndex]) {
             m_props[propIndex].reset();
         }
     }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <QByteArray>
+#include <QHash>
 #include <QMap>
 #include <QVector>
 
@@ -51,6 +52,11 @@ public:
     void commitPending();
     void rollbackPending();
     bool atomicPopulate(drmModeAtomicReq *req) const;
+    /**
+     * Appends the pending state of the object to @a key, which identifies the configuration
+     * of a test commit. Values that don't affect the outcome of the test are left out.
+     */
+    void appendTestKey(QByteArray &key) const;
     bool needsCommit() const;
     virtual bool updateProperties();
 
@@ -106,6 +112,9 @@ protected:
 
     bool initProps();
 
+    virtual void appendTestKeyProperty(QByteArray &key, uint32_t index, const DrmProperty *property) const;
+    static void appendTestKeyValue(QByteArray &key, uint64_t value);
+
     std::vector<std::unique_ptr<DrmProperty>> m_props;
 
 private:
@@ -113,6 +122,9 @@ private:
     const uint32_t m_id;
     const uint32_t m_objectType;
     const QVector<PropertyDefinition> m_propertyDefinitions;
+    // the index into the property definitions of every kernel property id that has been seen,
+    // -1 for the ones KWin doesn't use; the metadata of a property never changes
+    QHash<uint32_t, int> m_propertyIndices;
 };
 
 }
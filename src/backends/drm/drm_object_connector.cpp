@@ -17,6 +17,7 @@
 
 #include <cerrno>
 #include <cstring>
+#include <utility>
 #include <libxcvt/libxcvt.h>
 
 namespace KWin
@@ -259,9 +260,15 @@ Output::RgbRange DrmConnector::rgbRange() const
     return rgb->enumForValue<Output::RgbRange>(rgb->pending());
 }
 
+void DrmConnector::requestProbe()
+{
+    m_probeRequested = true;
+}
+
 bool DrmConnector::updateProperties()
 {
-    if (auto connector = drmModeGetConnector(gpu()->fd(), id())) {
+    const bool probe = std::exchange(m_probeRequested, false);
+    if (auto connector = probe ? drmModeGetConnector(gpu()->fd(), id()) : drmModeGetConnectorCurrent(gpu()->fd(), id())) {
         m_conn.reset(connector);
     } else if (!m_conn) {
         return false;
@@ -286,7 +293,11 @@ bool DrmConnector::updateProperties()
 
     // parse edid
     if (const auto edidProp = getProp(PropertyIndex::Edid); edidProp && edidProp->immutableBlob()) {
-        m_edid = Edid(edidProp->immutableBlob()->data, edidProp->immutableBlob()->length);
+        const auto blob = edidProp->immutableBlob();
+        // the same monitor is still connected, nothing to parse
+        if (m_edid.raw() != QByteArray::fromRawData(static_cast<const char *>(blob->data), blob->length)) {
+            m_edid = Edid(blob->data, blob->length);
+        }
         if (!m_edid.isValid()) {
             qCWarning(KWIN_DRM) << "Couldn't parse EDID for connector" << this;
         }
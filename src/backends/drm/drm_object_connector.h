@@ -78,7 +78,13 @@ public:
     };
 
     bool init() override;
+    /**
+     * Re-reads the state of the connector. The connector is only probed, i.e. the driver is only
+     * asked to detect the display and to read its EDID and modes again, if requestProbe() has
+     * been called; otherwise the state as the kernel knows it is used.
+     */
     bool updateProperties() override;
+    void requestProbe();
     void disable() override;
 
     bool isCrtcSupported(DrmCrtc *crtc) const;
@@ -114,6 +120,8 @@ private:
     QList<std::shared_ptr<DrmConnectorMode>> m_driverModes;
     QList<std::shared_ptr<DrmConnectorMode>> m_modes;
     uint32_t m_possibleCrtcs = 0;
+    // the connector has just been probed on creation
+    bool m_probeRequested = false;
 
     friend QDebug &operator<<(QDebug &s, const KWin::DrmConnector *obj);
 };
@@ -18,12 +18,13 @@
 namespace KWin
 {
 
-DrmCrtc::DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane)
-    : DrmObject(gpu, crtcId, {PropertyDefinition(QByteArrayLiteral("MODE_ID"), Requirement::Required), PropertyDefinition(QByteArrayLiteral("ACTIVE"), Requirement::Required), PropertyDefinition(QByteArrayLiteral("VRR_ENABLED"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("GAMMA_LUT"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("GAMMA_LUT_SIZE"), Requirement::Optional)}, DRM_MODE_OBJECT_CRTC)
+DrmCrtc::DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane, DrmPlane *overlayPlane)
+    : DrmObject(gpu, crtcId, {PropertyDefinition(QByteArrayLiteral("MODE_ID"), Requirement::Required), PropertyDefinition(QByteArrayLiteral("ACTIVE"), Requirement::Required), PropertyDefinition(QByteArrayLiteral("VRR_ENABLED"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("GAMMA_LUT"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("GAMMA_LUT_SIZE"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("DEGAMMA_LUT"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("DEGAMMA_LUT_SIZE"), Requirement::Optional), PropertyDefinition(QByteArrayLiteral("CTM"), Requirement::Optional)}, DRM_MODE_OBJECT_CRTC)
     , m_crtc(drmModeGetCrtc(gpu->fd(), crtcId))
     , m_pipeIndex(pipeIndex)
     , m_primaryPlane(primaryPlane)
     , m_cursorPlane(cursorPlane)
+    , m_overlayPlane(overlayPlane)
 {
 }
 
@@ -83,6 +84,21 @@ int DrmCrtc::gammaRampSize() const
     return m_crtc->gamma_size;
 }
 
+int DrmCrtc::degammaRampSize() const
+{
+    if (gpu()->atomicModeSetting() && getProp(PropertyIndex::Degamma_LUT)) {
+        if (auto prop = getProp(PropertyIndex::Degamma_LUT_Size); prop && prop->current() <= 4096) {
+            return prop->current();
+        }
+    }
+    return 0;
+}
+
+bool DrmCrtc::hasCtm() const
+{
+    return gpu()->atomicModeSetting() && getProp(PropertyIndex::CTM);
+}
+
 DrmPlane *DrmCrtc::primaryPlane() const
 {
     return m_primaryPlane;
@@ -93,6 +109,11 @@ DrmPlane *DrmCrtc::cursorPlane() const
     return m_cursorPlane;
 }
 
+DrmPlane *DrmCrtc::overlayPlane() const
+{
+    return m_overlayPlane;
+}
+
 void DrmCrtc::disable()
 {
     setPending(PropertyIndex::Active, 0);
@@ -27,7 +27,7 @@ class DrmPlane;
 class DrmCrtc : public DrmObject
 {
 public:
-    DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane);
+    DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane, DrmPlane *overlayPlane);
 
     enum class PropertyIndex : uint32_t {
         ModeId = 0,
@@ -35,6 +35,9 @@ public:
         VrrEnabled,
         Gamma_LUT,
         Gamma_LUT_Size,
+        Degamma_LUT,
+        Degamma_LUT_Size,
+        CTM,
         Count
     };
 
@@ -43,8 +46,18 @@ public:
 
     int pipeIndex() const;
     int gammaRampSize() const;
+    /**
+     * Returns the size of the lookup table applied before the color transformation matrix,
+     * or 0 if the crtc doesn't have one.
+     */
+    int degammaRampSize() const;
+    /**
+     * Returns whether the crtc can apply a color transformation matrix.
+     */
+    bool hasCtm() const;
     DrmPlane *primaryPlane() const;
     DrmPlane *cursorPlane() const;
+    DrmPlane *overlayPlane() const;
     drmModeModeInfo queryCurrentMode();
 
     std::shared_ptr<DrmFramebuffer> current() const;
@@ -61,6 +74,7 @@ private:
     int m_pipeIndex;
     DrmPlane *m_primaryPlane;
     DrmPlane *m_cursorPlane;
+    DrmPlane *m_overlayPlane;
 };
 
 }
@@ -15,6 +15,9 @@
 #include "drm_logging.h"
 #include "drm_pointer.h"
 
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 #include <drm_fourcc.h>
 
 namespace KWin
@@ -35,11 +38,19 @@ DrmPlane::DrmPlane(DrmGpu *gpu, uint32_t planeId)
                                   PropertyDefinition(QByteArrayLiteral("CRTC_ID"), Requirement::Required),
                                   PropertyDefinition(QByteArrayLiteral("rotation"), Requirement::Optional, {QByteArrayLiteral("rotate-0"), QByteArrayLiteral("rotate-90"), QByteArrayLiteral("rotate-180"), QByteArrayLiteral("rotate-270"), QByteArrayLiteral("reflect-x"), QByteArrayLiteral("reflect-y")}),
                                   PropertyDefinition(QByteArrayLiteral("IN_FORMATS"), Requirement::Optional),
+                                  PropertyDefinition(QByteArrayLiteral("FB_DAMAGE_CLIPS"), Requirement::Optional),
                               },
                 DRM_MODE_OBJECT_PLANE)
 {
 }
 
+DrmPlane::~DrmPlane()
+{
+    if (m_damageBlobId != 0) {
+        drmModeDestroyPropertyBlob(gpu()->fd(), m_damageBlobId);
+    }
+}
+
 bool DrmPlane::init()
 {
     DrmUniquePtr<drmModePlane> p(drmModeGetPlane(gpu()->fd(), id()));
@@ -132,9 +143,84 @@ void DrmPlane::set(const QPoint &srcPos, const QSize &srcSize, const QPoint &dst
     setPending(PropertyIndex::CrtcH, dstSize.height());
 }
 
+void DrmPlane::set(const QRectF &source, const QRect &destination)
+{
+    setPending(PropertyIndex::SrcX, std::round(source.x() * 65536));
+    setPending(PropertyIndex::SrcY, std::round(source.y() * 65536));
+    setPending(PropertyIndex::SrcW, std::round(source.width() * 65536));
+    setPending(PropertyIndex::SrcH, std::round(source.height() * 65536));
+    setPending(PropertyIndex::CrtcX, destination.x());
+    setPending(PropertyIndex::CrtcY, destination.y());
+    setPending(PropertyIndex::CrtcW, destination.width());
+    setPending(PropertyIndex::CrtcH, destination.height());
+}
+
+void DrmPlane::setDamage(const QRegion &damage, const QSize &bufferSize)
+{
+    if (!getProp(PropertyIndex::FbDamageClips)) {
+        return;
+    }
+    // the blob of the previous commit isn't needed anymore, the kernel holds its own reference
+    if (m_damageBlobId != 0) {
+        drmModeDestroyPropertyBlob(gpu()->fd(), m_damageBlobId);
+        m_damageBlobId = 0;
+    }
+    const QRect bufferRect(QPoint(0, 0), bufferSize);
+    const QRegion clippedDamage = damage & bufferRect;
+    // there is no way to express an empty damage, no clips means that the whole buffer changed
+    if (!clippedDamage.isEmpty() && clippedDamage != bufferRect) {
+        QVector<drm_mode_rect> rects;
+        rects.reserve(clippedDamage.rectCount());
+        for (const QRect &rect : clippedDamage) {
+            rects.append(drm_mode_rect{
+                .x1 = rect.left(),
+                .y1 = rect.top(),
+                .x2 = rect.left() + rect.width(),
+                .y2 = rect.top() + rect.height(),
+            });
+        }
+        if (drmModeCreatePropertyBlob(gpu()->fd(), rects.constData(), sizeof(drm_mode_rect) * rects.size(), &m_damageBlobId) != 0) {
+            qCWarning(KWIN_DRM) << "Failed to create damage clips blob!" << strerror(errno);
+            m_damageBlobId = 0;
+        }
+    }
+    setPending(PropertyIndex::FbDamageClips, m_damageBlobId);
+}
+
 void DrmPlane::setBuffer(DrmFramebuffer *buffer)
 {
     setPending(PropertyIndex::FbId, buffer ? buffer->framebufferId() : 0);
+    if (buffer && buffer->buffer()) {
+        m_pendingBufferFormat = buffer->buffer()->format();
+        m_pendingBufferModifier = buffer->buffer()->modifier();
+        m_pendingBufferSize = buffer->buffer()->size();
+    } else {
+        m_pendingBufferFormat = 0;
+        m_pendingBufferModifier = 0;
+        m_pendingBufferSize = QSize();
+    }
+}
+
+void DrmPlane::appendTestKeyProperty(QByteArray &key, uint32_t index, const DrmProperty *property) const
+{
+    switch (static_cast<PropertyIndex>(index)) {
+    case PropertyIndex::FbDamageClips:
+        // damage never makes a commit fail
+        return;
+    case PropertyIndex::FbId:
+        appendTestKeyValue(key, index);
+        if (m_pendingBufferFormat != 0) {
+            appendTestKeyValue(key, m_pendingBufferFormat);
+            appendTestKeyValue(key, m_pendingBufferModifier);
+            appendTestKeyValue(key, (uint64_t(m_pendingBufferSize.width()) << 32) | uint32_t(m_pendingBufferSize.height()));
+        } else {
+            appendTestKeyValue(key, property->pending());
+        }
+        return;
+    default:
+        DrmObject::appendTestKeyProperty(key, index, property);
+        return;
+    }
 }
 
 bool DrmPlane::isCrtcSupported(int pipeIndex) const
@@ -171,6 +257,10 @@ void DrmPlane::disable()
 {
     setPending(PropertyIndex::CrtcId, 0);
     setPending(PropertyIndex::FbId, 0);
+    setPending(PropertyIndex::FbDamageClips, 0);
+    m_pendingBufferFormat = 0;
+    m_pendingBufferModifier = 0;
+    m_pendingBufferSize = QSize();
     m_next = nullptr;
 }
 
@@ -12,6 +12,7 @@
 
 #include <QMap>
 #include <QPoint>
+#include <QRegion>
 #include <QSize>
 #include <memory>
 #include <qobjectdefs.h>
@@ -27,6 +28,7 @@ class DrmPlane : public DrmObject
     Q_GADGET
 public:
     DrmPlane(DrmGpu *gpu, uint32_t planeId);
+    ~DrmPlane() override;
 
     enum class PropertyIndex : uint32_t {
         Type = 0,
@@ -42,6 +44,7 @@ public:
         CrtcId,
         Rotation,
         In_Formats,
+        FbDamageClips,
         Count
     };
     Q_ENUM(PropertyIndex)
@@ -80,6 +83,15 @@ public:
 
     void setBuffer(DrmFramebuffer *buffer);
     void set(const QPoint &srcPos, const QSize &srcSize, const QPoint &dstPos, const QSize &dstSize);
+    /**
+     * Like above, but with a source rectangle that may have a fractional position and size.
+     */
+    void set(const QRectF &source, const QRect &destination);
+    /**
+     * Tells the driver which part of the buffer, in buffer coordinates, changed since the
+     * last commit. An infinite region or a region covering the whole buffer means full damage.
+     */
+    void setDamage(const QRegion &damage, const QSize &bufferSize);
 
     bool setTransformation(Transformations t);
     Transformations transformation();
@@ -87,12 +99,20 @@ public:
 
     void releaseBuffers();
 
+protected:
+    void appendTestKeyProperty(QByteArray &key, uint32_t index, const DrmProperty *property) const override;
+
 private:
     std::shared_ptr<DrmFramebuffer> m_current;
     std::shared_ptr<DrmFramebuffer> m_next;
 
     QMap<uint32_t, QVector<uint64_t>> m_supportedFormats;
     uint32_t m_possibleCrtcs;
+    uint32_t m_damageBlobId = 0;
+    // describes the pending buffer for test commits, the framebuffer id changes every frame
+    uint32_t m_pendingBufferFormat = 0;
+    uint64_t m_pendingBufferModifier = 0;
+    QSize m_pendingBufferSize;
     Transformations m_supportedTransformations = Transformation::Rotate0;
 };
 
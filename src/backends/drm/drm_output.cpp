@@ -9,6 +9,8 @@
 #include "drm_output.h"
 #include "drm_backend.h"
 #include "drm_buffer.h"
+#include "drm_commit_thread.h"
+#include "drm_cursor_mover.h"
 #include "drm_gpu.h"
 #include "drm_object_connector.h"
 #include "drm_object_crtc.h"
@@ -30,6 +32,7 @@
 #include <QCryptographicHash>
 #include <QMatrix4x4>
 #include <QPainter>
+#include <QScopeGuard>
 // c++
 #include <cerrno>
 // drm
@@ -48,6 +51,11 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline, KWaylandServer::DrmLeaseDeviceV1Inte
     m_pipeline->setOutput(this);
     const auto conn = m_pipeline->connector();
     m_renderLoop->setRefreshRate(m_pipeline->mode()->refreshRate());
+    // Page flip events carry the timestamp of the vblank at which the flip completed.
+    RenderLoopPrivate::get(m_renderLoop.get())->hardwarePresentation = true;
+    // Atomic commits are queued by the commit thread, which retries them until the previous
+    // page flip has completed.
+    RenderLoopPrivate::get(m_renderLoop.get())->tripleBufferingSupported = m_gpu->atomicModeSetting() && m_gpu->commitThread();
 
     Capabilities capabilities = Capability::Dpms;
     State initialState;
@@ -59,6 +67,8 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline, KWaylandServer::DrmLeaseDeviceV1Inte
     if (conn->vrrCapable()) {
         capabilities |= Capability::Vrr;
         setVrrPolicy(RenderLoop::VrrPolicy::Automatic);
+        // below the range of the panel, frames have to be repeated to keep it refreshing
+        RenderLoopPrivate::get(m_renderLoop.get())->vrrMinimumRefreshRate = conn->edid()->minimumVerticalRate() * 1000;
     }
     if (conn->hasRgbRange()) {
         capabilities |= Capability::RgbRange;
@@ -101,10 +111,8 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline, KWaylandServer::DrmLeaseDeviceV1Inte
             conn->id(),
             conn->modelName(),
             QStringLiteral("%1 %2").arg(conn->edid()->manufacturerString(), conn->modelName()));
-    } else {
-        connect(Cursors::self(), &Cursors::currentCursorChanged, this, &DrmOutput::updateCursor);
-        connect(Cursors::self(), &Cursors::hiddenChanged, this, &DrmOutput::updateCursor);
-        connect(Cursors::self(), &Cursors::positionChanged, this, &DrmOutput::moveCursor);
+    } else if (qEnvironmentVariableIntValue("KWIN_DRM_NO_THREADED_CURSOR") == 0) {
+        m_cursorMover = std::make_unique<DrmCursorMover>();
     }
 }
 
@@ -147,26 +155,29 @@ KWaylandServer::DrmLeaseV1Interface *DrmOutput::lease() const
     return m_lease;
 }
 
-void DrmOutput::updateCursor()
+bool DrmOutput::setCursor(Cursor *cursor)
 {
+    auto cursorMoverScope = qScopeGuard([this, cursor]() {
+        updateCursorMover(cursor);
+    });
     static bool valid;
     static const bool forceSoftwareCursor = qEnvironmentVariableIntValue("KWIN_FORCE_SW_CURSOR", &valid) == 1 && valid;
     // hardware cursors are broken with the NVidia proprietary driver
     if (forceSoftwareCursor || (!valid && m_gpu->isNVidia())) {
         m_setCursorSuccessful = false;
-        return;
+        return false;
     }
     const auto layer = m_pipeline->cursorLayer();
     if (!m_pipeline->crtc() || !layer) {
-        return;
+        m_setCursorSuccessful = false;
+        return false;
     }
-    const Cursor *cursor = Cursors::self()->currentCursor();
-    if (!cursor || cursor->image().isNull() || Cursors::self()->isCursorHidden()) {
+    if (!cursor || cursor->image().isNull()) {
         if (layer->isVisible()) {
             layer->setVisible(false);
             m_pipeline->setCursor();
         }
-        return;
+        return true;
     }
     bool rendered = false;
     const QMatrix4x4 monitorMatrix = logicalToNativeMatrix(geometry(), scale(), transform());
@@ -188,32 +199,43 @@ void DrmOutput::updateCursor()
             m_pipeline->setCursor();
         }
         m_setCursorSuccessful = false;
-        return;
+        return false;
     }
 
     const QSize surfaceSize = m_gpu->cursorSize() / scale();
     const QRect layerRect = monitorMatrix.mapRect(QRect(cursor->geometry().topLeft(), surfaceSize));
+    const bool wasVisible = layer->isVisible();
     layer->setPosition(layerRect.topLeft());
     layer->setVisible(cursor->geometry().intersects(geometry()));
     if (layer->isVisible()) {
         m_setCursorSuccessful = m_pipeline->setCursor(logicalToNativeMatrix(QRect(QPoint(), layerRect.size()), scale(), transform()).map(cursor->hotspot()));
         layer->setVisible(m_setCursorSuccessful);
+    } else {
+        if (wasVisible) {
+            m_pipeline->setCursor();
+        }
+        // the cursor buffer is ready, whether the plane can show it is tested once it's moved onto the output
+        m_setCursorSuccessful = true;
     }
+    m_moveCursorSuccessful = true;
+    return m_setCursorSuccessful;
 }
 
-void DrmOutput::moveCursor()
+bool DrmOutput::moveCursor(Cursor *cursor)
 {
+    auto cursorMoverScope = qScopeGuard([this, cursor]() {
+        updateCursorMover(cursor);
+    });
     if (!m_setCursorSuccessful || !m_pipeline->crtc()) {
-        return;
+        return false;
     }
     const auto layer = m_pipeline->cursorLayer();
-    Cursor *cursor = Cursors::self()->currentCursor();
-    if (!cursor || cursor->image().isNull() || Cursors::self()->isCursorHidden() || !cursor->geometry().intersects(geometry())) {
+    if (!cursor || cursor->image().isNull() || !cursor->geometry().intersects(geometry())) {
         if (layer->isVisible()) {
             layer->setVisible(false);
             m_pipeline->setCursor();
         }
-        return;
+        return true;
     }
     const QMatrix4x4 monitorMatrix = logicalToNativeMatrix(geometry(), scale(), transform());
     const QSize surfaceSize = m_gpu->cursorSize() / scale();
@@ -225,6 +247,39 @@ void DrmOutput::moveCursor()
     if (!m_moveCursorSuccessful) {
         m_pipeline->setCursor();
     }
+    return m_moveCursorSuccessful;
+}
+
+void DrmOutput::updateCursorMover(Cursor *cursor)
+{
+    if (!m_cursorMover) {
+        return;
+    }
+    DrmCursorMover::State state;
+    const auto layer = m_pipeline->cursorLayer();
+    const DrmCrtc *crtc = m_pipeline->crtc();
+    if (cursor && !cursor->image().isNull() && crtc && layer && layer->isVisible()
+        && m_setCursorSuccessful && m_moveCursorSuccessful && m_pipeline->activePending()) {
+        state.fd = m_gpu->fd();
+        state.crtcId = crtc->id();
+        if (const DrmPlane *plane = crtc->cursorPlane()) {
+            // moving the plane behind the back of the commit thread would make its page flips fail
+            state.commitThread = m_gpu->commitThread();
+            state.planeId = plane->id();
+            state.crtcXProperty = plane->getProp(DrmPlane::PropertyIndex::CrtcX)->propId();
+            state.crtcYProperty = plane->getProp(DrmPlane::PropertyIndex::CrtcY)->propId();
+        }
+        state.enabled = !crtc->cursorPlane() || state.commitThread;
+        state.outputGeometry = geometry();
+        state.hotspot = cursor->hotspot();
+        state.surfaceSize = m_gpu->cursorSize() / scale();
+        state.logicalToNative = logicalToNativeMatrix(geometry(), scale(), transform());
+        state.planePosition = layer->position();
+        if (m_deferCursorCommits) {
+            state.holdBack = RenderLoopPrivate::get(m_renderLoop.get())->maximumFrameInterval();
+        }
+    }
+    m_cursorMover->setState(state);
 }
 
 QList<std::shared_ptr<OutputMode>> DrmOutput::getModes() const
@@ -273,6 +328,7 @@ bool DrmOutput::setDrmDpmsMode(DpmsMode mode)
     if (DrmPipeline::commitPipelines({m_pipeline}, active ? DrmPipeline::CommitMode::TestAllowModeset : DrmPipeline::CommitMode::CommitModeset) == DrmPipeline::Error::None) {
         m_pipeline->applyPendingChanges();
         updateDpmsMode(mode);
+        updateCursorMover(Cursors::self()->isCursorHidden() ? nullptr : Cursors::self()->currentCursor());
         if (active) {
             m_gpu->platform()->checkOutputsAreOn();
             m_renderLoop->uninhibit();
@@ -353,6 +409,30 @@ void DrmOutput::updateDpmsMode(DpmsMode dpmsMode)
 }
 
 bool DrmOutput::present()
+{
+    // With triple buffering, the next frame is rendered while the previous one is still waiting
+    // for its page flip. It's committed once that has completed.
+    if (m_pipeline->pageflipPending()) {
+        m_presentDeferred = true;
+        return true;
+    }
+    return presentFrame();
+}
+
+void DrmOutput::presentDeferredFrame()
+{
+    if (!m_presentDeferred) {
+        return;
+    }
+    m_presentDeferred = false;
+    if (!m_pipeline->crtc() || !m_pipeline->activePending()) {
+        frameFailed();
+        return;
+    }
+    presentFrame();
+}
+
+bool DrmOutput::presentFrame()
 {
     RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(m_renderLoop.get());
     if (m_pipeline->syncMode() != renderLoopPrivate->presentMode) {
@@ -363,6 +443,11 @@ bool DrmOutput::present()
             m_pipeline->revertPendingChanges();
         }
     }
+    const bool deferCursorCommits = m_pipeline->syncMode() == RenderLoopPrivate::SyncMode::Adaptive && renderLoopPrivate->fullscreenItem != nullptr;
+    if (m_deferCursorCommits != deferCursorCommits) {
+        m_deferCursorCommits = deferCursorCommits;
+        updateCursorMover(Cursors::self()->isCursorHidden() ? nullptr : Cursors::self()->currentCursor());
+    }
     const bool needsModeset = gpu()->needsModeset();
     bool success;
     if (needsModeset) {
@@ -396,8 +481,9 @@ DrmPipeline *DrmOutput::pipeline() const
 
 bool DrmOutput::queueChanges(const OutputConfiguration &config)
 {
-    static bool valid;
-    static int envOnlySoftwareRotations = qEnvironmentVariableIntValue("KWIN_DRM_SW_ROTATIONS_ONLY", &valid) == 1 || !valid;
+    // The primary plane rotates the buffer if it can, that saves the shadow buffer pass. If the
+    // plane can't, the test commit fails and the gpu falls back to rotating in software.
+    static const bool envOnlySoftwareRotations = qEnvironmentVariableIntValue("KWIN_DRM_SW_ROTATIONS_ONLY") == 1;
 
     const auto props = config.constChangeSet(this);
     m_pipeline->setMode(std::static_pointer_cast<DrmConnectorMode>(props->mode));
@@ -446,7 +532,7 @@ void DrmOutput::applyQueuedChanges(const OutputConfiguration &config)
         m_gpu->platform()->turnOutputsOn();
     }
 
-    updateCursor();
+    Q_EMIT cursorInvalidated();
 }
 
 void DrmOutput::revertQueuedChanges()
@@ -464,12 +550,15 @@ DrmOutputLayer *DrmOutput::outputLayer() const
     return m_pipeline->primaryLayer();
 }
 
-void DrmOutput::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation)
+void DrmOutput::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update)
 {
     m_pipeline->setColorTransformation(transformation);
     if (DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test) == DrmPipeline::Error::None) {
         m_pipeline->applyPendingChanges();
-        m_renderLoop->scheduleRepaint();
+        // the gamma lookup table is part of every atomic commit
+        if (update == ColorTransformationUpdate::Immediate) {
+            m_renderLoop->scheduleRepaint();
+        }
     } else {
         m_pipeline->revertPendingChanges();
     }
@@ -484,6 +573,7 @@ void DrmOutput::renderCursorOpengl(const RenderTarget &renderTarget, const QSize
             return;
         }
         m_cursorTexture.reset(new GLTexture(img));
+        m_cursorTexture->setMemoryCategory(GLTexture::MemoryCategory::Cursor);
         m_cursorTexture->setWrapMode(GL_CLAMP_TO_EDGE);
         m_cursorTextureDirty = false;
     };
@@ -511,15 +601,15 @@ void DrmOutput::renderCursorOpengl(const RenderTarget &renderTarget, const QSize
     glClearColor(0, 0, 0, 0);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     m_cursorTexture->bind();
     ShaderBinder binder(ShaderTrait::MapTexture);
     binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
     m_cursorTexture->render(QRect(0, 0, cursorSize.width(), cursorSize.height()));
     m_cursorTexture->unbind();
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
 }
 
 void DrmOutput::renderCursorQPainter(const RenderTarget &renderTarget)
@@ -32,6 +32,7 @@ namespace KWin
 {
 
 class DrmConnector;
+class DrmCursorMover;
 class DrmGpu;
 class DrmPipeline;
 class DumbSwapchain;
@@ -51,6 +52,12 @@ public:
     bool present() override;
     DrmOutputLayer *outputLayer() const override;
 
+    /**
+     * Presents the frame that present() has held back because the previous frame was still
+     * waiting for its page flip, if there is one.
+     */
+    void presentDeferredFrame();
+
     bool queueChanges(const OutputConfiguration &config);
     void applyQueuedChanges(const OutputConfiguration &config);
     void revertQueuedChanges();
@@ -58,17 +65,18 @@ public:
     void updateDpmsMode(DpmsMode dpmsMode);
 
     bool usesSoftwareCursor() const override;
-    void updateCursor();
-    void moveCursor();
+    bool setCursor(Cursor *cursor) override;
+    bool moveCursor(Cursor *cursor) override;
 
     KWaylandServer::DrmLeaseV1Interface *lease() const;
     bool addLeaseObjects(QVector<uint32_t> &objectList);
     void leased(KWaylandServer::DrmLeaseV1Interface *lease);
     void leaseEnded();
 
-    void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation) override;
+    void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update) override;
 
 private:
+    bool presentFrame();
     bool setDrmDpmsMode(DpmsMode mode);
     void setDpmsMode(DpmsMode mode) override;
 
@@ -76,14 +84,19 @@ private:
 
     void renderCursorOpengl(const RenderTarget &renderTarget, const QSize &cursorSize);
     void renderCursorQPainter(const RenderTarget &renderTarget);
+    void updateCursorMover(Cursor *cursor);
 
     DrmPipeline *m_pipeline;
     DrmConnector *m_connector;
 
+    bool m_presentDeferred = false;
     bool m_setCursorSuccessful = false;
+    // whether cursor moves wait for the next frame, so they don't refresh the panel with adaptive sync
+    bool m_deferCursorCommits = false;
     bool m_moveCursorSuccessful = false;
     bool m_cursorTextureDirty = true;
     std::unique_ptr<GLTexture> m_cursorTexture;
+    std::unique_ptr<DrmCursorMover> m_cursorMover;
     QTimer m_turnOffTimer;
     std::unique_ptr<KWaylandServer::DrmLeaseConnectorV1Interface> m_offer;
     KWaylandServer::DrmLeaseV1Interface *m_lease = nullptr;
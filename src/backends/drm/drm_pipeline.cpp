@@ -11,11 +11,14 @@
 
 #include <errno.h>
 
+#include "core/colorpipelinestage.h"
+#include "core/colortransformation.h"
 #include "core/session.h"
 #include "cursor.h"
 #include "drm_backend.h"
 #include "drm_buffer.h"
 #include "drm_buffer_gbm.h"
+#include "drm_commit_thread.h"
 #include "drm_egl_backend.h"
 #include "drm_gpu.h"
 #include "drm_layer.h"
@@ -27,6 +30,8 @@
 
 #include <drm_fourcc.h>
 #include <gbm.h>
+#include <cmath>
+#include <lcms2.h>
 
 namespace KWin
 {
@@ -104,6 +109,12 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
         }
     };
 
+    const auto gpu = pipelines[0]->gpu();
+    if (gpu->commitThread() && (mode == CommitMode::TestAllowModeset || mode == CommitMode::CommitModeset)) {
+        // modesets have to be based on the state that has actually been committed
+        gpu->commitThread()->flush();
+    }
+
     DrmUniquePtr<drmModeAtomicReq> req{drmModeAtomicAlloc()};
     if (!req) {
         qCCritical(KWIN_DRM) << "Failed to allocate drmModeAtomicReq!" << strerror(errno);
@@ -116,7 +127,11 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
                 failed();
                 return Error::TestBufferFailed;
             }
-            pipeline->prepareAtomicPresentation();
+            if (!pipeline->prepareAtomicPresentation()) {
+                qCDebug(KWIN_DRM) << "The primary plane can't do the transformation of the buffer";
+                failed();
+                return Error::InvalidArguments;
+            }
             if (mode == CommitMode::TestAllowModeset || mode == CommitMode::CommitModeset) {
                 pipeline->prepareAtomicModeset();
             }
@@ -136,16 +151,36 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
             return errnoToError();
         }
     }
-    const auto gpu = pipelines[0]->gpu();
+
+    QByteArray testKey;
+    if (mode == CommitMode::Test || mode == CommitMode::TestAllowModeset) {
+        testKey = testCommitKey(pipelines, mode, unusedObjects);
+        if (const auto result = gpu->cachedTestResult(testKey)) {
+            if (result->error != Error::None) {
+                failed();
+                return result->error;
+            }
+            for (const auto &pipeline : pipelines) {
+                pipeline->m_pending.needsModeset = result->needsModeset;
+            }
+            std::for_each(pipelines.begin(), pipelines.end(), std::mem_fn(&DrmPipeline::atomicTestSuccessful));
+            std::for_each(unusedObjects.begin(), unusedObjects.end(), std::mem_fn(&DrmObject::commitPending));
+            return Error::None;
+        }
+    }
+
     switch (mode) {
     case CommitMode::TestAllowModeset: {
         bool withModeset = drmModeAtomicCommit(gpu->fd(), req.get(), DRM_MODE_ATOMIC_ALLOW_MODESET | DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
         if (!withModeset) {
             qCDebug(KWIN_DRM) << "Atomic modeset test failed!" << strerror(errno);
+            const Error error = errnoToError();
+            gpu->cacheTestResult(testKey, error, false);
             failed();
-            return errnoToError();
+            return error;
         }
         bool withoutModeset = drmModeAtomicCommit(gpu->fd(), req.get(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+        gpu->cacheTestResult(testKey, Error::None, !withoutModeset);
         for (const auto &pipeline : pipelines) {
             pipeline->m_pending.needsModeset = !withoutModeset;
         }
@@ -164,6 +199,8 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
             failed();
             return errnoToError();
         }
+        // the outcome of tests may depend on the modes and crtcs
+        gpu->invalidateTestResults();
         std::for_each(pipelines.begin(), pipelines.end(), std::mem_fn(&DrmPipeline::atomicModesetSuccessful));
         for (const auto &obj : unusedObjects) {
             obj->commitPending();
@@ -180,15 +217,48 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
         bool test = drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req.get(), DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
         if (!test) {
             qCDebug(KWIN_DRM) << "Atomic test failed!" << strerror(errno);
+            const Error error = errnoToError();
+            gpu->cacheTestResult(testKey, error, false);
             failed();
-            return errnoToError();
+            return error;
         }
+        gpu->cacheTestResult(testKey, Error::None, false);
         std::for_each(pipelines.begin(), pipelines.end(), std::mem_fn(&DrmPipeline::atomicTestSuccessful));
         Q_ASSERT(unusedObjects.isEmpty());
         return Error::None;
     }
     case CommitMode::Commit: {
-        bool commit = drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req.get(), DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, gpu) == 0;
+        const uint32_t flags = DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+        const bool async = gpu->asyncPageFlipSupported() && std::all_of(pipelines.begin(), pipelines.end(), [](DrmPipeline *pipeline) {
+            return pipeline->m_pending.syncMode == RenderLoopPrivate::SyncMode::Async;
+        });
+        if (const auto thread = gpu->commitThread()) {
+            QVector<uint32_t> crtcIds;
+            std::chrono::nanoseconds targetTimestamp = std::chrono::nanoseconds::max();
+            for (const auto &pipeline : pipelines) {
+                crtcIds << pipeline->m_pending.crtc->id();
+                targetTimestamp = std::min(targetTimestamp, pipeline->commitDeadline());
+            }
+            const QVector<uint32_t> replaced = thread->addCommit(std::move(req), crtcIds, targetTimestamp, async);
+            std::for_each(pipelines.begin(), pipelines.end(), std::mem_fn(&DrmPipeline::atomicCommitSuccessful));
+            Q_ASSERT(unusedObjects.isEmpty());
+            if (!replaced.isEmpty()) {
+                gpu->handleFramesReplaced(replaced);
+            }
+            return Error::None;
+        }
+        bool commit = false;
+        if (async) {
+            // Drivers reject async atomic commits that change anything but the framebuffers,
+            // e.g. when the cursor moved, in which case the commit is synchronized to the vblank.
+            commit = drmModeAtomicCommit(gpu->fd(), req.get(), flags | DRM_MODE_PAGE_FLIP_ASYNC, gpu) == 0;
+            if (!commit) {
+                qCDebug(KWIN_DRM) << "Async atomic commit failed, falling back to a synchronous commit" << strerror(errno);
+            }
+        }
+        if (!commit) {
+            commit = drmModeAtomicCommit(gpu->fd(), req.get(), flags, gpu) == 0;
+        }
         if (!commit) {
             qCCritical(KWIN_DRM) << "Atomic commit failed!" << strerror(errno);
             failed();
@@ -203,14 +273,23 @@ DrmPipeline::Error DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline
     }
 }
 
-void DrmPipeline::prepareAtomicPresentation()
+bool DrmPipeline::prepareAtomicPresentation()
 {
     m_pending.crtc->setPending(DrmCrtc::PropertyIndex::VrrEnabled, m_pending.syncMode == RenderLoopPrivate::SyncMode::Adaptive);
-    m_pending.crtc->setPending(DrmCrtc::PropertyIndex::Gamma_LUT, m_pending.gamma ? m_pending.gamma->blobId() : 0);
+    const auto &color = m_pending.colorPipeline;
+    m_pending.crtc->setPending(DrmCrtc::PropertyIndex::Gamma_LUT, color ? color->blobId() : 0);
+    m_pending.crtc->setPending(DrmCrtc::PropertyIndex::Degamma_LUT, color ? color->degammaBlobId() : 0);
+    m_pending.crtc->setPending(DrmCrtc::PropertyIndex::CTM, color ? color->ctmBlobId() : 0);
     const auto modeSize = m_pending.mode->size();
     const auto fb = m_pending.layer->currentBuffer().get();
-    m_pending.crtc->primaryPlane()->set(QPoint(0, 0), fb->buffer()->size(), QPoint(0, 0), modeSize);
+    m_pending.crtc->primaryPlane()->set(m_pending.layer->sourceRect(), QRect(QPoint(0, 0), modeSize));
+    const DrmPlane::Transformations transformation = m_pending.layer->transformation();
+    if (transformation != DrmPlane::Transformation::Rotate0 && (m_pending.crtc->primaryPlane()->supportedTransformations() & transformation) != transformation) {
+        return false;
+    }
+    m_pending.crtc->primaryPlane()->setTransformation(transformation);
     m_pending.crtc->primaryPlane()->setBuffer(fb);
+    m_pending.crtc->primaryPlane()->setDamage(m_pending.layer->bufferDamage(), fb->buffer()->size());
 
     if (m_pending.crtc->cursorPlane()) {
         const auto layer = cursorLayer();
@@ -218,6 +297,18 @@ void DrmPipeline::prepareAtomicPresentation()
         m_pending.crtc->cursorPlane()->setBuffer(layer->isVisible() ? layer->currentBuffer().get() : nullptr);
         m_pending.crtc->cursorPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, layer->isVisible() ? m_pending.crtc->id() : 0);
     }
+
+    if (const auto overlay = m_pending.crtc->overlayPlane()) {
+        const auto layer = overlayLayer();
+        const auto buffer = layer && layer->isVisible() ? layer->currentBuffer() : nullptr;
+        if (buffer) {
+            const QSize bufferSize = buffer->buffer()->size();
+            overlay->set(QPoint(0, 0), bufferSize, layer->position(), bufferSize);
+        }
+        overlay->setBuffer(buffer.get());
+        overlay->setPending(DrmPlane::PropertyIndex::CrtcId, buffer ? m_pending.crtc->id() : 0);
+    }
+    return true;
 }
 
 void DrmPipeline::prepareAtomicDisable()
@@ -229,6 +320,9 @@ void DrmPipeline::prepareAtomicDisable()
         if (auto cursor = m_pending.crtc->cursorPlane()) {
             cursor->disable();
         }
+        if (auto overlay = m_pending.crtc->overlayPlane()) {
+            overlay->disable();
+        }
     }
 }
 
@@ -261,10 +355,35 @@ void DrmPipeline::prepareAtomicModeset()
     m_pending.crtc->setPending(DrmCrtc::PropertyIndex::ModeId, m_pending.mode->blobId());
 
     m_pending.crtc->primaryPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, m_pending.crtc->id());
-    m_pending.crtc->primaryPlane()->setTransformation(m_pending.bufferOrientation);
     if (m_pending.crtc->cursorPlane()) {
         m_pending.crtc->cursorPlane()->setTransformation(DrmPlane::Transformation::Rotate0);
     }
+    if (m_pending.crtc->overlayPlane()) {
+        m_pending.crtc->overlayPlane()->setTransformation(DrmPlane::Transformation::Rotate0);
+    }
+}
+
+QByteArray DrmPipeline::testCommitKey(const QVector<DrmPipeline *> &pipelines, CommitMode mode, const QVector<DrmObject *> &unusedObjects)
+{
+    QByteArray key;
+    key.append(char(mode));
+    for (const auto &pipeline : pipelines) {
+        pipeline->m_connector->appendTestKey(key);
+        if (const auto crtc = pipeline->m_pending.crtc) {
+            crtc->appendTestKey(key);
+            crtc->primaryPlane()->appendTestKey(key);
+            if (crtc->cursorPlane()) {
+                crtc->cursorPlane()->appendTestKey(key);
+            }
+            if (crtc->overlayPlane()) {
+                crtc->overlayPlane()->appendTestKey(key);
+            }
+        }
+    }
+    for (const auto &unused : unusedObjects) {
+        unused->appendTestKey(key);
+    }
+    return key;
 }
 
 bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req)
@@ -282,6 +401,9 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req)
         if (m_pending.crtc->cursorPlane() && !m_pending.crtc->cursorPlane()->atomicPopulate(req)) {
             return false;
         }
+        if (m_pending.crtc->overlayPlane() && !m_pending.crtc->overlayPlane()->atomicPopulate(req)) {
+            return false;
+        }
     }
     return true;
 }
@@ -324,6 +446,9 @@ void DrmPipeline::atomicCommitFailed()
         if (m_pending.crtc->cursorPlane()) {
             m_pending.crtc->cursorPlane()->rollbackPending();
         }
+        if (m_pending.crtc->overlayPlane()) {
+            m_pending.crtc->overlayPlane()->rollbackPending();
+        }
     }
 }
 
@@ -336,6 +461,9 @@ void DrmPipeline::atomicTestSuccessful()
         if (m_pending.crtc->cursorPlane()) {
             m_pending.crtc->cursorPlane()->commitPending();
         }
+        if (m_pending.crtc->overlayPlane()) {
+            m_pending.crtc->overlayPlane()->commitPending();
+        }
     }
 }
 
@@ -355,6 +483,11 @@ void DrmPipeline::atomicCommitSuccessful()
             m_pending.crtc->cursorPlane()->setNext(cursorLayer()->currentBuffer());
             m_pending.crtc->cursorPlane()->commit();
         }
+        if (const auto overlay = m_pending.crtc->overlayPlane()) {
+            const auto layer = overlayLayer();
+            overlay->setNext(layer && layer->isVisible() ? layer->currentBuffer() : nullptr);
+            overlay->commit();
+        }
     }
     m_current = m_pending;
 }
@@ -376,7 +509,7 @@ bool DrmPipeline::setCursor(const QPoint &hotspot)
     if (m_pending.crtc->cursorPlane()) {
         result = commitPipelines({this}, CommitMode::Test) == Error::None;
         if (result && m_output) {
-            m_output->renderLoop()->scheduleRepaint();
+            RenderLoopPrivate::get(m_output->renderLoop())->scheduleCursorRepaint();
         }
     } else {
         result = setCursorLegacy();
@@ -401,7 +534,7 @@ bool DrmPipeline::moveCursor()
     if (result) {
         m_next = m_pending;
         if (m_output) {
-            m_output->renderLoop()->scheduleRepaint();
+            RenderLoopPrivate::get(m_output->renderLoop())->scheduleCursorRepaint();
         }
     } else {
         m_pending = m_next;
@@ -433,6 +566,29 @@ DrmGpu *DrmPipeline::gpu() const
     return m_connector->gpu();
 }
 
+std::chrono::nanoseconds DrmPipeline::commitDeadline() const
+{
+    // The commit has to reach the kernel before the vblank, with some leeway for the
+    // scheduling of the commit thread and the driver's own work
+    static const std::chrono::nanoseconds margin = std::chrono::microseconds(1500);
+    if (!m_output || m_pending.syncMode != RenderLoopPrivate::SyncMode::Fixed) {
+        return std::chrono::nanoseconds::zero();
+    }
+    // With triple buffering, the next frame may have been scheduled already when a frame that
+    // has been held back gets committed; the frame being committed is the newest pending one
+    const RenderLoopPrivate *renderLoop = RenderLoopPrivate::get(m_output->renderLoop());
+    const std::chrono::nanoseconds presentation = renderLoop->pendingFrames.empty() ? renderLoop->nextPresentationTimestamp : renderLoop->pendingFrames.back().predictedPresentationTimestamp;
+    return std::max(presentation - margin, std::chrono::nanoseconds::zero());
+}
+
+void DrmPipeline::pageFlipFailed()
+{
+    m_pageflipPending = false;
+    if (m_output) {
+        m_output->frameFailed();
+    }
+}
+
 void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
 {
     m_current.crtc->flipBuffer();
@@ -442,6 +598,9 @@ void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
     if (m_current.crtc->cursorPlane()) {
         m_current.crtc->cursorPlane()->flipBuffer();
     }
+    if (m_current.crtc->overlayPlane()) {
+        m_current.crtc->overlayPlane()->flipBuffer();
+    }
     m_pageflipPending = false;
     if (m_output) {
         m_output->pageFlipped(timestamp);
@@ -522,40 +681,146 @@ DrmCrtc *DrmPipeline::currentCrtc() const
     return m_current.crtc;
 }
 
-DrmGammaRamp::DrmGammaRamp(DrmCrtc *crtc, const std::shared_ptr<ColorTransformation> &transformation)
+static QVector<drm_color_lut> toAtomicLut(const ColorLUT &lut)
+{
+    QVector<drm_color_lut> atomicLut(lut.size());
+    for (uint32_t i = 0; i < lut.size(); i++) {
+        atomicLut[i].red = lut.red()[i];
+        atomicLut[i].green = lut.green()[i];
+        atomicLut[i].blue = lut.blue()[i];
+    }
+    return atomicLut;
+}
+
+// the CTM uses S31.32 sign-magnitude fixed point numbers
+static uint64_t toCtmValue(float value)
+{
+    const uint64_t magnitude = uint64_t(std::abs(double(value)) * (1ull << 32));
+    return value < 0 ? (magnitude | (1ull << 63)) : magnitude;
+}
+
+static std::vector<std::unique_ptr<ColorPipelineStage>> duplicateStages(const std::vector<std::unique_ptr<ColorPipelineStage>> &stages, size_t begin, size_t end)
+{
+    std::vector<std::unique_ptr<ColorPipelineStage>> ret;
+    for (size_t i = begin; i < end; i++) {
+        ret.push_back(stages[i]->dup());
+    }
+    return ret;
+}
+
+DrmColorPipeline::DrmColorPipeline(DrmCrtc *crtc, const std::shared_ptr<ColorTransformation> &transformation)
     : m_gpu(crtc->gpu())
-    , m_lut(transformation, crtc->gammaRampSize())
 {
-    if (crtc->gpu()->atomicModeSetting()) {
-        QVector<drm_color_lut> atomicLut(m_lut.size());
-        for (uint32_t i = 0; i < m_lut.size(); i++) {
-            atomicLut[i].red = m_lut.red()[i];
-            atomicLut[i].green = m_lut.green()[i];
-            atomicLut[i].blue = m_lut.blue()[i];
+    if (!decompose(crtc, transformation.get())) {
+        m_lut.emplace(transformation, crtc->gammaRampSize());
+        if (m_gpu->atomicModeSetting()) {
+            const auto atomicLut = toAtomicLut(*m_lut);
+            m_blobId = createBlob(atomicLut.constData(), sizeof(drm_color_lut) * atomicLut.size(), "gamma");
         }
-        if (drmModeCreatePropertyBlob(crtc->gpu()->fd(), atomicLut.data(), sizeof(drm_color_lut) * m_lut.size(), &m_blobId) != 0) {
-            qCWarning(KWIN_DRM) << "Failed to create gamma blob!" << strerror(errno);
+    }
+}
+
+bool DrmColorPipeline::decompose(DrmCrtc *crtc, const ColorTransformation *transformation)
+{
+    const auto &stages = transformation->stages();
+    std::optional<size_t> matrixIndex;
+    for (size_t i = 0; i < stages.size(); i++) {
+        switch (cmsStageType(stages[i]->stage())) {
+        case cmsSigCurveSetElemType:
+            break;
+        case cmsSigMatrixElemType:
+            if (matrixIndex) {
+                qCDebug(KWIN_DRM) << "Color transformations with more than one matrix can't be mapped to a crtc";
+                return false;
+            }
+            matrixIndex = i;
+            break;
+        default:
+            qCDebug(KWIN_DRM) << "Color transformation stage" << Qt::hex << cmsStageType(stages[i]->stage()) << "can't be mapped to a crtc";
+            return false;
+        }
+    }
+    if (!matrixIndex) {
+        // only tone curves, the gamma lookup table expresses them exactly
+        return false;
+    }
+    if (!crtc->hasCtm() || (*matrixIndex > 0 && crtc->degammaRampSize() == 0)) {
+        qCDebug(KWIN_DRM) << "crtc" << crtc->id() << "has no color transformation matrix, approximating the color transformation";
+        return false;
+    }
+
+    std::vector<std::unique_ptr<ColorPipelineStage>> matrixStage;
+    matrixStage.push_back(stages[*matrixIndex]->dup());
+    const ColorTransformation matrix(std::move(matrixStage));
+    const QVector3D offset = matrix.transform(QVector3D(0, 0, 0));
+    if (!qFuzzyIsNull(offset.x()) || !qFuzzyIsNull(offset.y()) || !qFuzzyIsNull(offset.z())) {
+        qCDebug(KWIN_DRM) << "The color transformation matrix has an offset, which a crtc can't apply";
+        return false;
+    }
+    drm_color_ctm ctm;
+    const QVector3D columns[3] = {
+        matrix.transform(QVector3D(1, 0, 0)),
+        matrix.transform(QVector3D(0, 1, 0)),
+        matrix.transform(QVector3D(0, 0, 1)),
+    };
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            ctm.matrix[row * 3 + column] = toCtmValue(columns[column][row]);
         }
     }
+
+    if (*matrixIndex > 0) {
+        const ColorLUT degamma(std::make_shared<ColorTransformation>(duplicateStages(stages, 0, *matrixIndex)), crtc->degammaRampSize());
+        const auto atomicLut = toAtomicLut(degamma);
+        m_degammaBlobId = createBlob(atomicLut.constData(), sizeof(drm_color_lut) * atomicLut.size(), "degamma");
+    }
+    m_ctmBlobId = createBlob(&ctm, sizeof(ctm), "ctm");
+    m_lut.emplace(std::make_shared<ColorTransformation>(duplicateStages(stages, *matrixIndex + 1, stages.size())), crtc->gammaRampSize());
+    const auto atomicLut = toAtomicLut(*m_lut);
+    m_blobId = createBlob(atomicLut.constData(), sizeof(drm_color_lut) * atomicLut.size(), "gamma");
+    return true;
+}
+
+uint32_t DrmColorPipeline::createBlob(const void *data, size_t size, const char *name) const
+{
+    uint32_t blobId = 0;
+    if (drmModeCreatePropertyBlob(m_gpu->fd(), data, size, &blobId) != 0) {
+        qCWarning(KWIN_DRM) << "Failed to create" << name << "blob!" << strerror(errno);
+        return 0;
+    }
+    return blobId;
 }
 
-DrmGammaRamp::~DrmGammaRamp()
+DrmColorPipeline::~DrmColorPipeline()
 {
-    if (m_blobId != 0) {
-        drmModeDestroyPropertyBlob(m_gpu->fd(), m_blobId);
+    for (uint32_t blobId : {m_blobId, m_degammaBlobId, m_ctmBlobId}) {
+        if (blobId != 0) {
+            drmModeDestroyPropertyBlob(m_gpu->fd(), blobId);
+        }
     }
 }
 
-uint32_t DrmGammaRamp::blobId() const
+uint32_t DrmColorPipeline::blobId() const
 {
     return m_blobId;
 }
 
-const ColorLUT &DrmGammaRamp::lut() const
+uint32_t DrmColorPipeline::degammaBlobId() const
 {
-    return m_lut;
+    return m_degammaBlobId;
 }
 
+uint32_t DrmColorPipeline::ctmBlobId() const
+{
+    return m_ctmBlobId;
+}
+
+const ColorLUT &DrmColorPipeline::lut() const
+{
+    return *m_lut;
+}
+
+
 void DrmPipeline::printFlags(uint32_t flags)
 {
     if (flags == 0) {
@@ -586,6 +851,9 @@ void DrmPipeline::printDebugInfo() const
         if (m_pending.crtc->cursorPlane()) {
             m_pending.crtc->cursorPlane()->printProps(DrmObject::PrintMode::All);
         }
+        if (m_pending.crtc->overlayPlane()) {
+            m_pending.crtc->overlayPlane()->printProps(DrmObject::PrintMode::All);
+        }
     }
 }
 
@@ -619,6 +887,11 @@ DrmOverlayLayer *DrmPipeline::cursorLayer() const
     return m_pending.cursorLayer.get();
 }
 
+DrmOverlayLayer *DrmPipeline::overlayLayer() const
+{
+    return m_pending.overlayLayer.get();
+}
+
 DrmPlane::Transformations DrmPipeline::renderOrientation() const
 {
     return m_pending.renderOrientation;
@@ -646,8 +919,9 @@ Output::RgbRange DrmPipeline::rgbRange() const
 
 void DrmPipeline::setCrtc(DrmCrtc *crtc)
 {
-    if (crtc && m_pending.crtc && crtc->gammaRampSize() != m_pending.crtc->gammaRampSize() && m_pending.colorTransformation) {
-        m_pending.gamma = std::make_shared<DrmGammaRamp>(crtc, m_pending.colorTransformation);
+    if (crtc && m_pending.crtc && crtc != m_pending.crtc && m_pending.colorTransformation) {
+        // crtcs can differ in their color management capabilities
+        m_pending.colorPipeline = std::make_shared<DrmColorPipeline>(crtc, m_pending.colorTransformation);
     }
     m_pending.crtc = crtc;
     if (crtc) {
@@ -672,10 +946,11 @@ void DrmPipeline::setEnable(bool enable)
     m_pending.enabled = enable;
 }
 
-void DrmPipeline::setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer)
+void DrmPipeline::setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer, const std::shared_ptr<DrmOverlayLayer> &overlayLayer)
 {
     m_pending.layer = primaryLayer;
     m_pending.cursorLayer = cursorLayer;
+    m_pending.overlayLayer = overlayLayer;
 }
 
 void DrmPipeline::setRenderOrientation(DrmPlane::Transformations orientation)
@@ -706,6 +981,6 @@ void DrmPipeline::setRgbRange(Output::RgbRange range)
 void DrmPipeline::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation)
 {
     m_pending.colorTransformation = transformation;
-    m_pending.gamma = std::make_shared<DrmGammaRamp>(m_pending.crtc, transformation);
+    m_pending.colorPipeline = std::make_shared<DrmColorPipeline>(m_pending.crtc, transformation);
 }
 }
@@ -14,6 +14,7 @@
 #include <QVector>
 
 #include <chrono>
+#include <optional>
 #include <xf86drmMode.h>
 
 #include "core/colorlut.h"
@@ -32,19 +33,35 @@ class DrmConnectorMode;
 class DrmPipelineLayer;
 class DrmOverlayLayer;
 
-class DrmGammaRamp
+/**
+ * The DrmColorPipeline maps a ColorTransformation onto the color management properties of
+ * a crtc. A transformation made of tone curves, a matrix and more tone curves is split into
+ * DEGAMMA_LUT, CTM and GAMMA_LUT. Transformations that the crtc can't express like that are
+ * sampled into the gamma lookup table, which is only exact for per channel transformations.
+ */
+class DrmColorPipeline
 {
 public:
-    DrmGammaRamp(DrmCrtc *crtc, const std::shared_ptr<ColorTransformation> &transformation);
-    ~DrmGammaRamp();
+    DrmColorPipeline(DrmCrtc *crtc, const std::shared_ptr<ColorTransformation> &transformation);
+    ~DrmColorPipeline();
 
+    /**
+     * The lookup table that is applied last, used for GAMMA_LUT and legacy gamma ramps.
+     */
     const ColorLUT &lut() const;
     uint32_t blobId() const;
+    uint32_t degammaBlobId() const;
+    uint32_t ctmBlobId() const;
 
 private:
+    bool decompose(DrmCrtc *crtc, const ColorTransformation *transformation);
+    uint32_t createBlob(const void *data, size_t size, const char *name) const;
+
     DrmGpu *m_gpu;
-    const ColorLUT m_lut;
+    std::optional<ColorLUT> m_lut;
     uint32_t m_blobId = 0;
+    uint32_t m_degammaBlobId = 0;
+    uint32_t m_ctmBlobId = 0;
 };
 
 class DrmPipeline
@@ -85,6 +102,10 @@ public:
 
     void pageFlipped(std::chrono::nanoseconds timestamp);
     bool pageflipPending() const;
+    /**
+     * Called when the commit that would have presented the pending frame failed.
+     */
+    void pageFlipFailed();
     bool modesetPresentPending() const;
     void resetModesetPresentPending();
     void printDebugInfo() const;
@@ -107,6 +128,7 @@ public:
     bool enabled() const;
     DrmPipelineLayer *primaryLayer() const;
     DrmOverlayLayer *cursorLayer() const;
+    DrmOverlayLayer *overlayLayer() const;
     DrmPlane::Transformations renderOrientation() const;
     DrmPlane::Transformations bufferOrientation() const;
     RenderLoopPrivate::SyncMode syncMode() const;
@@ -117,7 +139,7 @@ public:
     void setMode(const std::shared_ptr<DrmConnectorMode> &mode);
     void setActive(bool active);
     void setEnable(bool enable);
-    void setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer);
+    void setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer, const std::shared_ptr<DrmOverlayLayer> &overlayLayer);
     void setRenderOrientation(DrmPlane::Transformations orientation);
     void setBufferOrientation(DrmPlane::Transformations orientation);
     void setSyncMode(RenderLoopPrivate::SyncMode mode);
@@ -149,14 +171,20 @@ private:
 
     // atomic modesetting only
     bool populateAtomicValues(drmModeAtomicReq *req);
+    static QByteArray testCommitKey(const QVector<DrmPipeline *> &pipelines, CommitMode mode, const QVector<DrmObject *> &unusedObjects);
     void atomicCommitFailed();
     void atomicTestSuccessful();
     void atomicCommitSuccessful();
     void atomicModesetSuccessful();
     void prepareAtomicModeset();
-    void prepareAtomicPresentation();
+    bool prepareAtomicPresentation();
     void prepareAtomicDisable();
     static Error commitPipelinesAtomic(const QVector<DrmPipeline *> &pipelines, CommitMode mode, const QVector<DrmObject *> &unusedObjects);
+    /**
+     * Returns the latest point in time at which a commit can be submitted to catch the
+     * next vblank, or zero if it should be submitted right away.
+     */
+    std::chrono::nanoseconds commitDeadline() const;
 
     // logging helpers
     enum class PrintMode {
@@ -183,11 +211,12 @@ private:
         Output::RgbRange rgbRange = Output::RgbRange::Automatic;
         RenderLoopPrivate::SyncMode syncMode = RenderLoopPrivate::SyncMode::Fixed;
         std::shared_ptr<ColorTransformation> colorTransformation;
-        std::shared_ptr<DrmGammaRamp> gamma;
+        std::shared_ptr<DrmColorPipeline> colorPipeline;
 
         std::shared_ptr<DrmPipelineLayer> layer;
         std::shared_ptr<DrmOverlayLayer> cursorLayer;
         QPoint cursorHotspot;
+        std::shared_ptr<DrmOverlayLayer> overlayLayer;
 
         // the transformation that this pipeline will apply to submitted buffers
         DrmPlane::Transformations bufferOrientation = DrmPlane::Transformation::Rotate0;
@@ -112,6 +112,10 @@ bool DrmProperty::needsCommit() const
 
 void DrmProperty::setCurrent(uint64_t value)
 {
+    // a blob id always refers to the same contents
+    if (m_current == value && (m_immutableBlob || value == 0)) {
+        return;
+    }
     m_current = value;
     updateBlob();
 }
@@ -34,6 +34,7 @@ std::optional<OutputLayerBeginFrameInfo> DrmQPainterLayer::beginFrame()
     if (!doesSwapchainFit()) {
         m_swapchain = std::make_shared<DumbSwapchain>(m_pipeline->gpu(), m_pipeline->bufferSize(), DRM_FORMAT_XRGB8888);
     }
+    m_frameRepeatable = false;
     QRegion needsRepaint;
     if (!m_swapchain->acquireBuffer(&needsRepaint)) {
         return std::nullopt;
@@ -53,12 +54,14 @@ bool DrmQPainterLayer::endFrame(const QRegion &renderedRegion, const QRegion &da
     if (!m_currentFramebuffer) {
         qCWarning(KWIN_DRM, "Failed to create dumb framebuffer: %s", strerror(errno));
     }
+    m_frameRepeatable = m_currentFramebuffer != nullptr;
     return m_currentFramebuffer != nullptr;
 }
 
 bool DrmQPainterLayer::checkTestBuffer()
 {
     if (!doesSwapchainFit()) {
+        m_frameRepeatable = false;
         m_swapchain = std::make_shared<DumbSwapchain>(m_pipeline->gpu(), m_pipeline->bufferSize(), DRM_FORMAT_XRGB8888);
         if (!m_swapchain->isEmpty()) {
             m_currentFramebuffer = DrmFramebuffer::createFramebuffer(m_swapchain->currentBuffer());
@@ -87,9 +90,20 @@ QRegion DrmQPainterLayer::currentDamage() const
     return m_currentDamage;
 }
 
+QRegion DrmQPainterLayer::bufferDamage() const
+{
+    return logicalToBufferDamage(m_currentDamage);
+}
+
+bool DrmQPainterLayer::canRepeatFrame() const
+{
+    return m_frameRepeatable && doesSwapchainFit();
+}
+
 void DrmQPainterLayer::releaseBuffers()
 {
     m_swapchain.reset();
+    m_frameRepeatable = false;
 }
 
 DrmCursorQPainterLayer::DrmCursorQPainterLayer(DrmPipeline *pipeline)
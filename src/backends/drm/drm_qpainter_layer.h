@@ -31,6 +31,8 @@ public:
     bool checkTestBuffer() override;
     std::shared_ptr<DrmFramebuffer> currentBuffer() const override;
     QRegion currentDamage() const override;
+    QRegion bufferDamage() const override;
+    bool canRepeatFrame() const override;
     void releaseBuffers() override;
 
 private:
@@ -39,6 +41,8 @@ private:
     std::shared_ptr<DumbSwapchain> m_swapchain;
     std::shared_ptr<DrmFramebuffer> m_currentFramebuffer;
     QRegion m_currentDamage;
+    // whether m_currentFramebuffer holds the last frame that was rendered
+    bool m_frameRepeatable = false;
 };
 
 class DrmCursorQPainterLayer : public DrmOverlayLayer
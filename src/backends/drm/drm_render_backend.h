@@ -26,6 +26,14 @@ public:
 
     virtual std::shared_ptr<DrmPipelineLayer> createPrimaryLayer(DrmPipeline *pipeline) = 0;
     virtual std::shared_ptr<DrmOverlayLayer> createCursorLayer(DrmPipeline *pipeline) = 0;
+    /**
+     * Creates a layer that shows client buffers on the overlay plane of the pipeline,
+     * or returns nullptr if the render backend can't scan out client buffers
+     */
+    virtual std::shared_ptr<DrmOverlayLayer> createOverlayLayer(DrmPipeline *)
+    {
+        return nullptr;
+    }
     virtual std::shared_ptr<DrmOutputLayer> createLayer(DrmVirtualOutput *output) = 0;
 };
 
@@ -21,6 +21,7 @@
 #include "egl_dmabuf.h"
 #include "kwineglutils_p.h"
 #include "surfaceitem_wayland.h"
+#include "utils/filedescriptor.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/surface_interface.h"
 
@@ -80,7 +81,7 @@ bool VirtualEglGbmLayer::endFrame(const QRegion &renderedRegion, const QRegion &
 {
     Q_UNUSED(renderedRegion);
     GLFramebuffer::popFramebuffer();
-    const auto buffer = m_gbmSurface->swapBuffers(damagedRegion);
+    const auto buffer = m_gbmSurface->swapBuffers(damagedRegion, m_output->regionToRects(damagedRegion & m_output->rect()));
     if (buffer) {
         m_currentBuffer = buffer;
         m_currentDamage = damagedRegion;
@@ -158,10 +159,15 @@ bool VirtualEglGbmLayer::scanout(SurfaceItem *surfaceItem)
     if (!buffer || buffer->size() != m_output->pixelSize()) {
         return false;
     }
+    const auto &acquireFence = item->surface()->acquireFence();
+    if (acquireFence.isValid() && !acquireFence.isReadable()) {
+        return false;
+    }
     const auto scanoutBuffer = GbmBuffer::importBuffer(m_output->gpu(), buffer);
     if (!scanoutBuffer) {
         return false;
     }
+    scanoutBuffer->setReleasePoint(item->surface()->bufferReleasePoint());
     // damage tracking for screen casting
     m_currentDamage = m_scanoutSurface == item->surface() ? surfaceItem->damage() : infiniteRegion();
     surfaceItem->resetDamage();
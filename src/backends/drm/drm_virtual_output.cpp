@@ -17,6 +17,8 @@
 #include "drm_render_backend.h"
 #include "softwarevsyncmonitor.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -69,6 +71,22 @@ void DrmVirtualOutput::setDpmsMode(DpmsMode mode)
     setState(next);
 }
 
+void DrmVirtualOutput::setConsumerRefreshRate(std::optional<int> refreshRate)
+{
+    const bool paused = refreshRate == 0;
+    if (paused != m_pausedForConsumers) {
+        m_pausedForConsumers = paused;
+        if (paused) {
+            m_renderLoop->inhibit();
+        } else {
+            m_renderLoop->uninhibit();
+        }
+    }
+    const int rate = refreshRate.value_or(0) > 0 ? std::min(*refreshRate, this->refreshRate()) : this->refreshRate();
+    m_renderLoop->setRefreshRate(rate);
+    m_vsyncMonitor->setRefreshRate(rate);
+}
+
 DrmOutputLayer *DrmVirtualOutput::outputLayer() const
 {
     return m_layer.get();
@@ -32,6 +32,7 @@ public:
     bool present() override;
     DrmOutputLayer *outputLayer() const override;
     void recreateSurface();
+    void setConsumerRefreshRate(std::optional<int> refreshRate) override;
 
 private:
     void vblank(std::chrono::nanoseconds timestamp);
@@ -39,6 +40,7 @@ private:
 
     std::shared_ptr<DrmOutputLayer> m_layer;
     bool m_pageFlipPending = true;
+    bool m_pausedForConsumers = false;
 
     std::unique_ptr<SoftwareVsyncMonitor> m_vsyncMonitor;
 };
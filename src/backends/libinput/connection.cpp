@@ -20,6 +20,7 @@
 #include "workspace.h"
 #endif
 
+#include "core/cursorfastpath.h"
 #include "core/session.h"
 #include "input_event.h"
 #include "libinput_logging.h"
@@ -99,8 +100,14 @@ std::unique_ptr<Connection> Connection::create(Session *session)
     return std::unique_ptr<Connection>(new Connection(std::move(context)));
 }
 
+// Enough for the events of a few frames from a number of high rate devices. If the main thread
+// falls behind even further, the events wait in libinput's own queue.
+static const size_t s_eventQueueCapacity = 1024;
+
 Connection::Connection(std::unique_ptr<Context> &&input)
     : m_notifier(nullptr)
+    , m_eventQueue(s_eventQueueCapacity)
+    , m_releasedEvents(s_eventQueueCapacity)
     , m_connectionAdaptor(std::make_unique<ConnectionAdaptor>(this))
     , m_input(std::move(input))
 {
@@ -110,7 +117,15 @@ Connection::Connection(std::unique_ptr<Context> &&input)
                                           QStringLiteral("notifyChange"), this, SLOT(slotKGlobalSettingsNotifyChange(int, int)));
 }
 
-Connection::~Connection() = default;
+Connection::~Connection()
+{
+    while (const auto event = m_eventQueue.pop()) {
+        delete *event;
+    }
+    while (const auto event = m_releasedEvents.pop()) {
+        delete *event;
+    }
+}
 
 void Connection::setup()
 {
@@ -151,20 +166,60 @@ void Connection::deactivate()
 void Connection::handleEvent()
 {
     QMutexLocker locker(&m_mutex);
-    const bool wasEmpty = m_eventQueue.empty();
+    bool queued = false;
     do {
-        m_input->dispatch();
-        std::unique_ptr<Event> event = m_input->event();
-        if (!event) {
-            break;
+        while (const auto event = m_releasedEvents.pop()) {
+            delete *event;
+        }
+        if (!m_pendingEvent) {
+            m_input->dispatch();
+            m_pendingEvent = m_input->event();
+            if (!m_pendingEvent) {
+                break;
+            }
         }
-        m_eventQueue.push_back(std::move(event));
+        if (!m_eventQueue.push(m_pendingEvent.get())) {
+            // the main thread asks for the remaining events once it has caught up
+            m_eventQueueFull = true;
+            // unless it already did so in the meantime
+            if (!m_eventQueue.push(m_pendingEvent.get())) {
+                break;
+            }
+        }
+        if (m_pendingEvent->type() == LIBINPUT_EVENT_POINTER_MOTION) {
+            // lets the cursor keep up with the mouse if the main thread doesn't get to the event in time
+            CursorFastPath::self()->motion(static_cast<PointerEvent *>(m_pendingEvent.get())->delta());
+        }
+        m_pendingEvent.release();
+        queued = true;
     } while (true);
-    if (wasEmpty && !m_eventQueue.empty()) {
+
+    // one wakeup for all the events that are read before the main thread gets to them
+    if (queued && !m_wakeupPending.exchange(true)) {
         Q_EMIT eventsRead();
     }
 }
 
+Connection::QueuedEvent Connection::takeEvent()
+{
+    const auto event = m_eventQueue.pop();
+    return QueuedEvent(event.value_or(nullptr), EventReleaser{this});
+}
+
+void Connection::releaseEvent(Event *event)
+{
+    if (!m_releasedEvents.push(event)) {
+        // the libinput thread hasn't come around to destroying the previous events yet
+        QMutexLocker locker(&m_mutex);
+        delete event;
+    }
+}
+
+void Connection::EventReleaser::operator()(Event *event) const
+{
+    connection->releaseEvent(event);
+}
+
 #ifndef KWIN_BUILD_TESTING
 QPointF devicePointToGlobalPosition(const QPointF &devicePos, const Output *output)
 {
@@ -264,12 +319,12 @@ static TabletPadId createTabletPadId(LibInput::Device *device)
 
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
-    while (m_eventQueue.size() != 0) {
-        std::unique_ptr<Event> event = std::move(m_eventQueue.front());
-        m_eventQueue.pop_front();
+    m_wakeupPending = false;
+    while (const QueuedEvent event = takeEvent()) {
         switch (event->type()) {
         case LIBINPUT_EVENT_DEVICE_ADDED: {
+            // creating the device configures it through libinput
+            QMutexLocker locker(&m_mutex);
             auto device = new Device(event->nativeDevice());
             device->moveToThread(thread());
             m_devices << device;
@@ -281,6 +336,7 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_DEVICE_REMOVED: {
+            QMutexLocker locker(&m_mutex);
             auto it = std::find_if(m_devices.begin(), m_devices.end(), [&event](Device *d) {
                 return event->device() == d;
             });
@@ -315,24 +371,24 @@ void Connection::processEvents()
         }
         case LIBINPUT_EVENT_POINTER_MOTION: {
             PointerEvent *pe = static_cast<PointerEvent *>(event.get());
-            auto delta = pe->delta();
-            auto deltaNonAccel = pe->deltaUnaccelerated();
             quint32 latestTime = pe->time();
-            quint64 latestTimeUsec = pe->timeMicroseconds();
-            auto it = m_eventQueue.begin();
-            while (it != m_eventQueue.end()) {
-                if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                    std::unique_ptr<PointerEvent> p{static_cast<PointerEvent *>(it->release())};
-                    delta += p->delta();
-                    deltaNonAccel += p->deltaUnaccelerated();
-                    latestTime = p->time();
-                    latestTimeUsec = p->timeMicroseconds();
-                    it = m_eventQueue.erase(it);
-                } else {
+            QVector<RelativePointerMotion> motions{{pe->delta(), pe->deltaUnaccelerated(), pe->timeMicroseconds()}};
+            CursorFastPath::self()->motionProcessed(pe->delta());
+            while (Event **next = m_eventQueue.front()) {
+                if ((*next)->type() != LIBINPUT_EVENT_POINTER_MOTION || (*next)->device() != pe->device()) {
                     break;
                 }
+                const QueuedEvent nextEvent = takeEvent();
+                PointerEvent *p = static_cast<PointerEvent *>(nextEvent.get());
+                motions.append({p->delta(), p->deltaUnaccelerated(), p->timeMicroseconds()});
+                CursorFastPath::self()->motionProcessed(p->delta());
+                latestTime = p->time();
+            }
+            if (motions.count() == 1) {
+                Q_EMIT pe->device()->pointerMotion(pe->delta(), pe->deltaUnaccelerated(), latestTime, pe->timeMicroseconds(), pe->device());
+            } else {
+                Q_EMIT pe->device()->pointerMotionCoalesced(motions, latestTime, pe->device());
             }
-            Q_EMIT pe->device()->pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
             break;
         }
         case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE: {
@@ -514,6 +570,9 @@ void Connection::processEvents()
             break;
         }
     }
+    if (m_eventQueueFull.exchange(false)) {
+        QMetaObject::invokeMethod(this, &Connection::handleEvent, Qt::QueuedConnection);
+    }
 }
 
 void Connection::updateScreens()
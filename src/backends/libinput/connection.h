@@ -11,6 +11,8 @@
 
 #include <kwinglobals.h>
 
+#include "utils/spscqueue.h"
+
 #include <KSharedConfig>
 
 #include <QObject>
@@ -19,7 +21,9 @@
 #include <QSize>
 #include <QStringList>
 #include <QVector>
-#include <deque>
+
+#include <atomic>
+#include <memory>
 
 class QSocketNotifier;
 class QThread;
@@ -71,12 +75,27 @@ private Q_SLOTS:
 
 private:
     Connection(std::unique_ptr<Context> &&input);
+    struct EventReleaser
+    {
+        void operator()(Event *event) const;
+        Connection *connection;
+    };
+    using QueuedEvent = std::unique_ptr<Event, EventReleaser>;
+
     void handleEvent();
+    QueuedEvent takeEvent();
+    void releaseEvent(Event *event);
     void applyDeviceConfig(Device *device);
     void applyScreenToDevice(Device *device);
     QSocketNotifier *m_notifier;
     QRecursiveMutex m_mutex;
-    std::deque<std::unique_ptr<Event>> m_eventQueue;
+    // Events are read on the libinput thread and processed on the main thread. They go back to
+    // the libinput thread to be destroyed, because libinput isn't thread safe.
+    SpscQueue<Event *> m_eventQueue;
+    SpscQueue<Event *> m_releasedEvents;
+    std::unique_ptr<Event> m_pendingEvent;
+    std::atomic<bool> m_eventQueueFull = false;
+    std::atomic<bool> m_wakeupPending = false;
     QVector<Device *> m_devices;
     KSharedConfigPtr m_config;
     std::unique_ptr<ConnectionAdaptor> m_connectionAdaptor;
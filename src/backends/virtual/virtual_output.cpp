@@ -12,6 +12,8 @@
 #include "core/renderloop_p.h"
 #include "softwarevsyncmonitor.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -79,6 +81,22 @@ void VirtualOutput::updateEnabled(bool enabled)
     setState(next);
 }
 
+void VirtualOutput::setConsumerRefreshRate(std::optional<int> refreshRate)
+{
+    const bool paused = refreshRate == 0;
+    if (paused != m_pausedForConsumers) {
+        m_pausedForConsumers = paused;
+        if (paused) {
+            m_renderLoop->inhibit();
+        } else {
+            m_renderLoop->uninhibit();
+        }
+    }
+    const int rate = refreshRate.value_or(0) > 0 ? std::min(*refreshRate, this->refreshRate()) : this->refreshRate();
+    m_renderLoop->setRefreshRate(rate);
+    m_vsyncMonitor->setRefreshRate(rate);
+}
+
 void VirtualOutput::vblank(std::chrono::nanoseconds timestamp)
 {
     RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(m_renderLoop.get());
@@ -34,6 +34,7 @@ public:
     void setGeometry(const QRect &geo);
     void updateScale(qreal scale);
     void updateEnabled(bool enabled);
+    void setConsumerRefreshRate(std::optional<int> refreshRate) override;
 
 private:
     void vblank(std::chrono::nanoseconds timestamp);
@@ -47,6 +48,7 @@ private:
     int m_gammaSize = 200;
     bool m_gammaResult = true;
     int m_identifier;
+    bool m_pausedForConsumers = false;
 };
 
 } // namespace KWin
@@ -46,11 +46,14 @@
 #include <KWayland/Client/touch.h>
 #include <KWayland/Client/xdgshell.h>
 
+#include "wayland-presentation-time-client-protocol.h"
+
 #include <QMetaMethod>
 #include <QThread>
 
 #include <fcntl.h>
 #include <linux/input.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "../drm/gbm_dmabuf.h"
@@ -604,6 +607,9 @@ WaylandBackend::~WaylandBackend()
     }
     m_subCompositor->release();
     m_compositor->release();
+    if (m_presentation) {
+        wp_presentation_destroy(m_presentation);
+    }
     m_registry->release();
     m_seat.reset();
     m_shm->release();
@@ -616,8 +622,28 @@ WaylandBackend::~WaylandBackend()
     qCDebug(KWIN_WAYLAND_BACKEND) << "Destroyed Wayland display";
 }
 
+wp_presentation *WaylandBackend::presentation() const
+{
+    return m_presentationClockMonotonic ? m_presentation : nullptr;
+}
+
 bool WaylandBackend::initialize()
 {
+    connect(m_registry.get(), &Registry::interfaceAnnounced, this, [this](const QByteArray &interface, quint32 name, quint32 version) {
+        Q_UNUSED(version)
+        if (interface != wp_presentation_interface.name || m_presentation) {
+            return;
+        }
+        m_presentation = static_cast<wp_presentation *>(wl_registry_bind(*m_registry, name, &wp_presentation_interface, 1));
+        static const wp_presentation_listener listener = {
+            .clock_id = [](void *data, wp_presentation *presentation, uint32_t clockId) {
+                Q_UNUSED(presentation)
+                // the render loop works with the monotonic clock
+                static_cast<WaylandBackend *>(data)->m_presentationClockMonotonic = clockId == CLOCK_MONOTONIC;
+            },
+        };
+        wp_presentation_add_listener(m_presentation, &listener, this);
+    });
     connect(m_registry.get(), &Registry::compositorAnnounced, this, [this](quint32 name, quint32 version) {
         if (version < 4) {
             qFatal("wl_compositor version 4 or later is required");
@@ -798,12 +824,9 @@ WaylandOutput *WaylandBackend::createOutput(const QString &name, const QSize &si
     }
 
     waylandOutput->init(size);
-    connect(waylandOutput, &WaylandOutput::frameRendered, this, [waylandOutput]() {
-        // The current time of the monotonic clock is a pretty good estimate when the frame
-        // has been presented, however it will be much better if we check whether the host
-        // compositor supports the wp_presentation protocol.
+    connect(waylandOutput, &WaylandOutput::frameRendered, this, [waylandOutput](std::chrono::nanoseconds timestamp) {
         RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(waylandOutput->renderLoop());
-        renderLoopPrivate->notifyFrameCompleted(std::chrono::steady_clock::now().time_since_epoch());
+        renderLoopPrivate->notifyFrameCompleted(timestamp);
     });
 
     // The output will only actually be added when it receives its first
@@ -28,6 +28,7 @@ struct wl_buffer;
 struct wl_display;
 struct wl_event_queue;
 struct wl_seat;
+struct wp_presentation;
 struct gbm_device;
 struct gbm_bo;
 
@@ -278,6 +279,11 @@ public:
     {
         return m_relativePointerManager;
     }
+    /**
+     * Returns the wp_presentation global of the host compositor, or @c nullptr if it isn't
+     * supported or its timestamps are not in the monotonic clock.
+     */
+    wp_presentation *presentation() const;
 
     bool supportsPointerLock();
     void togglePointerLock();
@@ -341,6 +347,8 @@ private:
     KWayland::Client::PointerConstraints *m_pointerConstraints = nullptr;
     KWayland::Client::PointerGestures *m_pointerGestures = nullptr;
     WaylandEglBackend *m_eglBackend = nullptr;
+    wp_presentation *m_presentation = nullptr;
+    bool m_presentationClockMonotonic = false;
 
     std::unique_ptr<QThread> m_connectionThread;
     QVector<WaylandOutput *> m_outputs;
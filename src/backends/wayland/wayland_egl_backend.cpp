@@ -134,6 +134,7 @@ bool WaylandEglOutput::makeContextCurrent() const
         qCCritical(KWIN_WAYLAND_BACKEND) << "Make Context Current failed";
         return false;
     }
+    GLState::invalidate();
     EGLint error = eglGetError();
     if (error != EGL_SUCCESS) {
         qCWarning(KWIN_WAYLAND_BACKEND) << "Error occurred while creating context " << error;
@@ -181,7 +182,7 @@ void WaylandEglOutput::aboutToStartPainting(const QRegion &damage)
 
 void WaylandEglOutput::present()
 {
-    m_waylandOutput->surface()->setupFrameCallback();
+    m_waylandOutput->requestFrameFeedback();
     m_waylandOutput->surface()->setScale(std::ceil(m_waylandOutput->scale()));
     Q_EMIT m_waylandOutput->outputChange(m_damageJournal.lastDamage());
 
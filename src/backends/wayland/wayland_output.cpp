@@ -16,19 +16,25 @@
 
 #include <KLocalizedString>
 
+#include <cmath>
+
+#include "wayland-presentation-time-client-protocol.h"
+
 namespace KWin
 {
 namespace Wayland
 {
 
 using namespace KWayland::Client;
-static const int s_refreshRate = 60000; // TODO: can we get refresh rate data from Wayland host?
+// used until the host tells the refresh rate in a presentation feedback
+static const int s_refreshRate = 60000;
 
 WaylandOutput::WaylandOutput(const QString &name, std::unique_ptr<Surface> &&surface, WaylandBackend *backend)
     : Output(backend)
     , m_renderLoop(std::make_unique<RenderLoop>())
     , m_surface(std::move(surface))
     , m_backend(backend)
+    , m_refreshRate(s_refreshRate)
 {
     setInformation(Information{
         .name = name,
@@ -36,7 +42,11 @@ WaylandOutput::WaylandOutput(const QString &name, std::unique_ptr<Surface> &&sur
         .capabilities = Capability::Dpms,
     });
 
-    connect(m_surface.get(), &Surface::frameRendered, this, &WaylandOutput::frameRendered);
+    connect(m_surface.get(), &Surface::frameRendered, this, [this]() {
+        // The host doesn't support wp_presentation, the current time is a pretty good
+        // estimate when the frame has been presented.
+        Q_EMIT frameRendered(std::chrono::steady_clock::now().time_since_epoch());
+    });
     m_turnOffTimer.setSingleShot(true);
     m_turnOffTimer.setInterval(dimAnimationTime());
     connect(&m_turnOffTimer, &QTimer::timeout, this, [this] {
@@ -46,6 +56,9 @@ WaylandOutput::WaylandOutput(const QString &name, std::unique_ptr<Surface> &&sur
 
 WaylandOutput::~WaylandOutput()
 {
+    for (struct wp_presentation_feedback *feedback : std::as_const(m_feedbacks)) {
+        wp_presentation_feedback_destroy(feedback);
+    }
     m_surface->destroy();
 }
 
@@ -56,9 +69,9 @@ RenderLoop *WaylandOutput::renderLoop() const
 
 void WaylandOutput::init(const QSize &pixelSize)
 {
-    m_renderLoop->setRefreshRate(s_refreshRate);
+    m_renderLoop->setRefreshRate(m_refreshRate);
 
-    auto mode = std::make_shared<OutputMode>(pixelSize, s_refreshRate);
+    auto mode = std::make_shared<OutputMode>(pixelSize, m_refreshRate);
 
     State initialState;
     initialState.modes = {mode};
@@ -69,7 +82,7 @@ void WaylandOutput::init(const QSize &pixelSize)
 
 void WaylandOutput::resize(const QSize &pixelSize)
 {
-    auto mode = std::make_shared<OutputMode>(pixelSize, s_refreshRate);
+    auto mode = std::make_shared<OutputMode>(pixelSize, m_refreshRate);
 
     State next = m_state;
     next.modes = {mode};
@@ -79,6 +92,74 @@ void WaylandOutput::resize(const QSize &pixelSize)
     Q_EMIT m_backend->outputsQueried();
 }
 
+void WaylandOutput::requestFrameFeedback()
+{
+    wp_presentation *presentation = m_backend->presentation();
+    if (!presentation) {
+        m_surface->setupFrameCallback();
+        return;
+    }
+
+    static const wp_presentation_feedback_listener listener = {
+        .sync_output = [](void *data, struct wp_presentation_feedback *feedback, wl_output *output) {
+            Q_UNUSED(data)
+            Q_UNUSED(feedback)
+            Q_UNUSED(output)
+        },
+        .presented = [](void *data, struct wp_presentation_feedback *feedback, uint32_t secondsHigh, uint32_t secondsLow, uint32_t nanoseconds, uint32_t refresh, uint32_t sequenceHigh, uint32_t sequenceLow, uint32_t flags) {
+            Q_UNUSED(sequenceHigh)
+            Q_UNUSED(sequenceLow)
+            Q_UNUSED(flags)
+            const std::chrono::seconds seconds((uint64_t(secondsHigh) << 32) | secondsLow);
+            static_cast<WaylandOutput *>(data)->handlePresented(feedback, seconds + std::chrono::nanoseconds(nanoseconds), refresh);
+        },
+        .discarded = [](void *data, struct wp_presentation_feedback *feedback) {
+            static_cast<WaylandOutput *>(data)->handleDiscarded(feedback);
+        },
+    };
+    // the request has the same name as the interface, which hides the type
+    struct wp_presentation_feedback *feedback = ::wp_presentation_feedback(presentation, *m_surface);
+    wp_presentation_feedback_add_listener(feedback, &listener, this);
+    m_feedbacks.append(feedback);
+}
+
+void WaylandOutput::handlePresented(struct wp_presentation_feedback *feedback, std::chrono::nanoseconds timestamp, uint32_t refresh)
+{
+    m_feedbacks.removeOne(feedback);
+    wp_presentation_feedback_destroy(feedback);
+
+    // zero means that the host's output doesn't have a constant refresh rate
+    if (refresh > 0) {
+        setRefreshRate(std::round(1'000'000'000'000.0 / refresh));
+    }
+    Q_EMIT frameRendered(timestamp);
+}
+
+void WaylandOutput::handleDiscarded(struct wp_presentation_feedback *feedback)
+{
+    m_feedbacks.removeOne(feedback);
+    wp_presentation_feedback_destroy(feedback);
+
+    // The frame hasn't been shown, e.g. because the window is hidden, the render loop still
+    // has to know that the host is done with it.
+    Q_EMIT frameRendered(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+void WaylandOutput::setRefreshRate(int refreshRate)
+{
+    if (m_refreshRate == refreshRate) {
+        return;
+    }
+    m_refreshRate = refreshRate;
+    m_renderLoop->setRefreshRate(refreshRate);
+
+    State next = m_state;
+    auto mode = std::make_shared<OutputMode>(next.currentMode->size(), refreshRate);
+    next.modes = {mode};
+    next.currentMode = mode;
+    setState(next);
+}
+
 void WaylandOutput::setDpmsMode(DpmsMode mode)
 {
     if (mode == DpmsMode::Off) {
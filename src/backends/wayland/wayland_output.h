@@ -15,6 +15,10 @@
 #include <QObject>
 #include <QTimer>
 
+#include <chrono>
+
+struct wp_presentation_feedback;
+
 namespace KWayland
 {
 namespace Client
@@ -69,9 +73,16 @@ public:
     void updateDpmsMode(DpmsMode dpmsMode);
     void updateEnabled(bool enabled);
 
+    /**
+     * Asks the host compositor to tell when the next commit of the surface is shown. The
+     * presentation feedback is used if the host supports wp_presentation, it gives the time
+     * and the refresh rate of the host's output; otherwise a frame callback is used.
+     */
+    void requestFrameFeedback();
+
 Q_SIGNALS:
     void sizeChanged(const QSize &size);
-    void frameRendered();
+    void frameRendered(std::chrono::nanoseconds timestamp);
 
 protected:
     WaylandBackend *backend()
@@ -80,10 +91,16 @@ protected:
     }
 
 private:
+    void handlePresented(wp_presentation_feedback *feedback, std::chrono::nanoseconds timestamp, uint32_t refresh);
+    void handleDiscarded(wp_presentation_feedback *feedback);
+    void setRefreshRate(int refreshRate);
+
     std::unique_ptr<RenderLoop> m_renderLoop;
     std::unique_ptr<KWayland::Client::Surface> m_surface;
     WaylandBackend *m_backend;
     QTimer m_turnOffTimer;
+    QVector<wp_presentation_feedback *> m_feedbacks;
+    int m_refreshRate;
 };
 
 class XdgShellOutput : public WaylandOutput
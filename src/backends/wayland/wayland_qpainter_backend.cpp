@@ -88,7 +88,8 @@ void WaylandQPainterOutput::present()
     s->attachBuffer(m_back->buffer);
     s->damage(m_damageJournal.lastDamage());
     s->setScale(std::ceil(m_waylandOutput->scale()));
-    s->commit();
+    m_waylandOutput->requestFrameFeedback();
+    s->commit(KWayland::Client::Surface::CommitFlag::None);
 }
 
 WaylandQPainterBufferSlot *WaylandQPainterOutput::back() const
@@ -279,7 +279,9 @@ OverlayWindow *EglOnXBackend::overlayWindow() const
 
 bool EglOnXBackend::makeContextCurrent(const EGLSurface &surface)
 {
-    return eglMakeCurrent(eglDisplay(), surface, surface, context()) == EGL_TRUE;
+    const bool current = eglMakeCurrent(eglDisplay(), surface, surface, context()) == EGL_TRUE;
+    GLState::invalidate();
+    return current;
 }
 
 } // namespace
@@ -846,6 +846,8 @@ bool GlxBackend::makeCurrent()
         context->doneCurrent();
     }
     const bool current = glXMakeCurrent(display(), glxWindow, ctx);
+    // Qt may have rendered with the context meanwhile
+    GLState::invalidate();
     return current;
 }
 
@@ -965,7 +967,7 @@ bool GlxPixmapTexturePrivate::create(SurfacePixmapX11 *texture)
     q->setDirty();
     q->setFilter(GL_NEAREST);
 
-    glBindTexture(m_target, m_texture);
+    GLState::bindTexture(m_target, m_texture);
     glXBindTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT, nullptr);
 
     updateMatrix();
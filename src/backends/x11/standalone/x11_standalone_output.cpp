@@ -39,8 +39,10 @@ void X11Output::setXineramaNumber(int number)
     m_xineramaNumber = number;
 }
 
-void X11Output::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation)
+void X11Output::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update)
 {
+    // the gamma ramps of the crtc don't wait for a frame
+    Q_UNUSED(update)
     if (m_crtc == XCB_NONE) {
         return;
     }
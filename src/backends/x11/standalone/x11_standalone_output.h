@@ -42,7 +42,7 @@ public:
     int xineramaNumber() const;
     void setXineramaNumber(int number);
 
-    void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation) override;
+    void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update) override;
 
 private:
     void setCrtc(xcb_randr_crtc_t crtc);
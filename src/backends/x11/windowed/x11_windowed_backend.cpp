@@ -26,6 +26,9 @@
 #include <QSocketNotifier>
 // xcb
 #include <xcb/xcb_keysyms.h>
+#if HAVE_XCB_PRESENT
+#include <xcb/present.h>
+#endif
 // X11
 #include <X11/Xlib-xcb.h>
 #include <fixx11h.h>
@@ -202,6 +205,7 @@ bool X11WindowedBackend::initialize()
             }
         }
         initXInput();
+        initPresent();
         XRenderUtils::init(m_connection, m_screen->root);
         createOutputs();
         connect(kwinApp(), &Application::workspaceCreated, this, &X11WindowedBackend::startEventReading);
@@ -253,6 +257,19 @@ void X11WindowedBackend::initXInput()
 #endif
 }
 
+void X11WindowedBackend::initPresent()
+{
+#if HAVE_XCB_PRESENT
+    const xcb_query_extension_reply_t *extension = xcb_get_extension_data(m_connection, &xcb_present_id);
+    if (!extension || !extension->present) {
+        qCDebug(KWIN_X11WINDOWED) << "Present extension not available, falling back to software vsync";
+        return;
+    }
+    m_presentOpcode = extension->major_opcode;
+    m_hasPresent = true;
+#endif
+}
+
 X11WindowedOutput *X11WindowedBackend::findOutput(xcb_window_t window) const
 {
     auto it = std::find_if(m_outputs.constBegin(), m_outputs.constEnd(),
@@ -385,8 +402,20 @@ void X11WindowedBackend::handleEvent(xcb_generic_event_t *e)
             xcb_refresh_keyboard_mapping(m_keySymbols, reinterpret_cast<xcb_mapping_notify_event_t *>(e));
         }
         break;
-#if HAVE_X11_XINPUT
     case XCB_GE_GENERIC: {
+#if HAVE_XCB_PRESENT
+        if (reinterpret_cast<xcb_ge_generic_event_t *>(e)->extension == m_presentOpcode && m_hasPresent) {
+            auto pe = reinterpret_cast<xcb_present_generic_event_t *>(e);
+            if (pe->evtype == XCB_PRESENT_COMPLETE_NOTIFY) {
+                auto ce = reinterpret_cast<xcb_present_complete_notify_event_t *>(e);
+                if (X11WindowedOutput *output = findOutput(ce->window)) {
+                    output->handlePresentCompleteNotify(ce);
+                }
+            }
+            break;
+        }
+#endif
+#if HAVE_X11_XINPUT
         GeEventMemMover ge(e);
         auto te = reinterpret_cast<xXIDeviceEvent *>(e);
         const X11WindowedOutput *output = findOutput(te->event);
@@ -419,9 +448,9 @@ void X11WindowedBackend::handleEvent(xcb_generic_event_t *e)
             break;
         }
         }
+#endif
         break;
     }
-#endif
     default:
         break;
     }
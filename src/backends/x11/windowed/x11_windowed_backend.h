@@ -113,6 +113,10 @@ public:
     {
         return m_hasXInput;
     }
+    bool hasPresent() const
+    {
+        return m_hasPresent;
+    }
 
     std::unique_ptr<OpenGLBackend> createOpenGLBackend() override;
     std::unique_ptr<QPainterBackend> createQPainterBackend() override;
@@ -148,6 +152,7 @@ private:
     void updateSize(xcb_configure_notify_event_t *event);
     void createCursor(const QImage &img, const QPoint &hotspot);
     void initXInput();
+    void initPresent();
     X11WindowedOutput *findOutput(xcb_window_t window) const;
 
     xcb_connection_t *m_connection = nullptr;
@@ -171,6 +176,9 @@ private:
     int m_majorVersion = 0;
     int m_minorVersion = 0;
 
+    bool m_hasPresent = false;
+    uint8_t m_presentOpcode = 0;
+
     QVector<X11WindowedOutput *> m_outputs;
 };
 
@@ -15,6 +15,7 @@
 #include "x11_windowed_output.h"
 // kwin libs
 #include <kwinglplatform.h>
+#include <kwinglutils.h>
 
 namespace KWin
 {
@@ -41,6 +42,7 @@ void X11WindowedEglOutput::ensureFbo()
 std::optional<OutputLayerBeginFrameInfo> X11WindowedEglOutput::beginFrame()
 {
     eglMakeCurrent(m_backend->eglDisplay(), m_eglSurface, m_eglSurface, m_backend->context());
+    GLState::invalidate();
     ensureFbo();
     GLFramebuffer::pushFramebuffer(m_fbo.get());
 
@@ -111,7 +113,7 @@ bool X11WindowedEglBackend::createSurfaces()
 
 void X11WindowedEglBackend::present(Output *output)
 {
-    static_cast<X11WindowedOutput *>(output)->vsyncMonitor()->arm();
+    static_cast<X11WindowedOutput *>(output)->scheduleVblank();
 
     const auto &renderOutput = m_outputs[output];
     presentSurface(renderOutput->surface(), renderOutput->lastDamage(), output->geometry());
@@ -19,6 +19,9 @@
 #if HAVE_X11_XINPUT
 #include <X11/extensions/XInput2.h>
 #endif
+#if HAVE_XCB_PRESENT
+#include <xcb/present.h>
+#endif
 
 #include <QIcon>
 
@@ -117,6 +120,14 @@ void X11WindowedOutput::init(const QSize &pixelSize)
     // select xinput 2 events
     initXInputForWindow();
 
+#if HAVE_XCB_PRESENT
+    if (m_backend->hasPresent()) {
+        m_presentEvent = xcb_generate_id(m_backend->connection());
+        xcb_present_select_input(m_backend->connection(), m_presentEvent, m_window,
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY);
+    }
+#endif
+
     m_winInfo = std::make_unique<NETWinInfo>(m_backend->connection(), m_window, m_backend->screen()->root,
                                              NET::WMWindowType, NET::Properties2());
 
@@ -192,6 +203,36 @@ QPointF X11WindowedOutput::mapFromGlobal(const QPointF &pos) const
     return (pos - hostPosition() + internalPosition()) / scale();
 }
 
+void X11WindowedOutput::scheduleVblank()
+{
+#if HAVE_XCB_PRESENT
+    if (m_presentEvent) {
+        // The notification comes with the first msc after the current one, which is when a
+        // frame that has just been presented hits the screen.
+        m_vblankPending = true;
+        xcb_present_notify_msc(m_backend->connection(), m_window, ++m_presentSerial, 0, 1, 0);
+        xcb_flush(m_backend->connection());
+        return;
+    }
+#endif
+    m_vsyncMonitor->arm();
+}
+
+void X11WindowedOutput::handlePresentCompleteNotify(xcb_present_complete_notify_event_t *event)
+{
+#if HAVE_XCB_PRESENT
+    // The presentations made by the EGL implementation on the window are reported too.
+    if (event->kind != XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC || event->serial != m_presentSerial || !m_vblankPending) {
+        return;
+    }
+    m_vblankPending = false;
+    // the ust is the time of the monotonic clock in microseconds
+    vblank(std::chrono::microseconds(event->ust));
+#else
+    Q_UNUSED(event)
+#endif
+}
+
 void X11WindowedOutput::vblank(std::chrono::nanoseconds timestamp)
 {
     RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(m_renderLoop.get());
@@ -18,6 +18,7 @@
 #include <xcb/xcb.h>
 
 class NETWinInfo;
+struct xcb_present_complete_notify_event_t;
 
 namespace KWin
 {
@@ -68,6 +69,14 @@ public:
 
     void updateEnabled(bool enabled);
 
+    /**
+     * Asks to be notified of the next vblank after a frame has been presented. The host's
+     * Present extension is used if it's available, so the output renders exactly as often
+     * as the host displays; otherwise the vblanks come from the software vsync monitor.
+     */
+    void scheduleVblank();
+    void handlePresentCompleteNotify(xcb_present_complete_notify_event_t *event);
+
 private:
     void initXInputForWindow();
     void vblank(std::chrono::nanoseconds timestamp);
@@ -78,6 +87,9 @@ private:
     std::unique_ptr<SoftwareVsyncMonitor> m_vsyncMonitor;
     QPoint m_hostPosition;
     QRegion m_exposedArea;
+    uint32_t m_presentEvent = 0;
+    uint32_t m_presentSerial = 0;
+    bool m_vblankPending = false;
 
     X11WindowedBackend *m_backend;
 };
@@ -84,7 +84,7 @@ void X11WindowedQPainterBackend::removeOutput(Output *output)
 
 void X11WindowedQPainterBackend::present(Output *output)
 {
-    static_cast<X11WindowedOutput *>(output)->vsyncMonitor()->arm();
+    static_cast<X11WindowedOutput *>(output)->scheduleVblank();
 
     xcb_connection_t *c = m_backend->connection();
     const xcb_window_t window = m_backend->window();
@@ -8,6 +8,7 @@
 #include "core/colorpipelinestage.h"
 #include "core/colortransformation.h"
 #include "core/output.h"
+#include "core/renderloop.h"
 #include "utils/common.h"
 
 #include "3rdparty/colortemperature.h"
@@ -16,6 +17,9 @@
 
 #include <lcms2.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace KWin
 {
 
@@ -30,6 +34,11 @@ struct CmsDeleter
 };
 using UniqueToneCurvePtr = std::unique_ptr<cmsToneCurve, CmsDeleter>;
 
+// how often an idle output is updated during a long temperature transition
+static const std::chrono::milliseconds s_idleTransitionInterval(1000);
+// the number of updates of an idle output during a short temperature transition
+static const int s_minimumTransitionSteps = 20;
+
 class ColorDevicePrivate
 {
 public:
@@ -46,6 +55,11 @@ public:
     void updateBrightnessToneCurves();
     void updateCalibrationToneCurves();
 
+    void startTransition(uint target, std::chrono::milliseconds duration);
+    void stopTransition();
+    void stepTransition(bool idle);
+
+    ColorDevice *q;
     Output *output;
     DirtyToneCurves dirtyCurves;
     QTimer *updateTimer;
@@ -58,6 +72,19 @@ public:
     std::unique_ptr<ColorPipelineStage> calibrationStage;
 
     std::shared_ptr<ColorTransformation> transformation;
+
+    struct Transition
+    {
+        uint from = 6500;
+        uint to = 6500;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::milliseconds duration = std::chrono::milliseconds::zero();
+        QTimer *idleTimer = nullptr;
+        QMetaObject::Connection framePresentedConnection;
+        // whether the last step waits for a frame to be put on the screen
+        bool stepPending = false;
+    };
+    Transition transition;
 };
 
 void ColorDevicePrivate::rebuildPipeline()
@@ -230,14 +257,74 @@ void ColorDevicePrivate::updateCalibrationToneCurves()
     cmsCloseProfile(handle);
 }
 
+void ColorDevicePrivate::startTransition(uint target, std::chrono::milliseconds duration)
+{
+    transition.from = temperature;
+    transition.to = target;
+    transition.start = std::chrono::steady_clock::now();
+    transition.duration = duration;
+    transition.idleTimer->start(std::min(s_idleTransitionInterval, duration / s_minimumTransitionSteps));
+
+    if (!transition.framePresentedConnection) {
+        // The steps are made along with the frames, without asking for frames of their own,
+        // so animating the temperature doesn't wake up an output that has nothing to show.
+        transition.framePresentedConnection = QObject::connect(output->renderLoop(), &RenderLoop::framePresented, q, [this]() {
+            transition.stepPending = false;
+            stepTransition(false);
+            if (transition.idleTimer->isActive()) {
+                transition.idleTimer->start();
+            }
+        });
+    }
+}
+
+void ColorDevicePrivate::stopTransition()
+{
+    transition.idleTimer->stop();
+    QObject::disconnect(transition.framePresentedConnection);
+    transition.framePresentedConnection = QMetaObject::Connection();
+    transition.stepPending = false;
+}
+
+void ColorDevicePrivate::stepTransition(bool idle)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - transition.start;
+    const bool finished = elapsed >= transition.duration;
+    const qreal progress = finished ? 1.0 : std::chrono::duration<qreal>(elapsed) / transition.duration;
+    const uint next = std::round(interpolate(transition.from, transition.to, progress));
+
+    if (next != temperature) {
+        temperature = next;
+        dirtyCurves |= DirtyTemperatureToneCurve;
+        rebuildPipeline();
+        output->setColorTransformation(transformation, idle ? Output::ColorTransformationUpdate::Immediate : Output::ColorTransformationUpdate::WithNextFrame);
+        transition.stepPending = !idle;
+        Q_EMIT q->temperatureChanged();
+    } else if (idle && transition.stepPending) {
+        // no frame has come along to show the previous step
+        output->renderLoop()->scheduleRepaint();
+        transition.stepPending = false;
+    }
+
+    if (finished && !transition.stepPending) {
+        stopTransition();
+    }
+}
+
 ColorDevice::ColorDevice(Output *output, QObject *parent)
     : QObject(parent)
     , d(new ColorDevicePrivate)
 {
+    d->q = this;
     d->updateTimer = new QTimer(this);
     d->updateTimer->setSingleShot(true);
     connect(d->updateTimer, &QTimer::timeout, this, &ColorDevice::update);
 
+    d->transition.idleTimer = new QTimer(this);
+    connect(d->transition.idleTimer, &QTimer::timeout, this, [this]() {
+        d->stepTransition(true);
+    });
+
     d->output = output;
     scheduleUpdate();
 }
@@ -282,6 +369,7 @@ void ColorDevice::setTemperature(uint temperature)
         qCWarning(KWIN_CORE) << "Got invalid temperature value:" << temperature;
         temperature = 6500;
     }
+    d->stopTransition();
     if (d->temperature == temperature) {
         return;
     }
@@ -291,6 +379,19 @@ void ColorDevice::setTemperature(uint temperature)
     Q_EMIT temperatureChanged();
 }
 
+void ColorDevice::setTemperature(uint temperature, std::chrono::milliseconds duration)
+{
+    if (duration <= std::chrono::milliseconds::zero()) {
+        setTemperature(temperature);
+        return;
+    }
+    if (temperature > 6500) {
+        qCWarning(KWIN_CORE) << "Got invalid temperature value:" << temperature;
+        temperature = 6500;
+    }
+    d->startTransition(temperature, duration);
+}
+
 // QString ColorDevice::profile() const
 // {
 //     return d->profile;
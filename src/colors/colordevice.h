@@ -9,6 +9,7 @@
 #include <kwinglobals.h>
 
 #include <QObject>
+#include <chrono>
 #include <memory>
 
 namespace KWin
@@ -53,6 +54,14 @@ public:
      */
     void setTemperature(uint temperature);
 
+    /**
+     * Moves the color temperature on this device to @a temperature gradually, over @a duration.
+     * The intermediate temperatures are shown along with the frames the output renders anyway;
+     * while the output is idle, it's only updated once a second, or more often if the whole
+     * transition is short. A zero @a duration sets the temperature right away.
+     */
+    void setTemperature(uint temperature, std::chrono::milliseconds duration);
+
     /**
      * Returns the color profile for this device.
      */
@@ -16,13 +16,17 @@
 #include "core/platform.h"
 #include "core/renderlayer.h"
 #include "core/renderloop.h"
+#include "core/renderloop_p.h"
 #include "cursordelegate_opengl.h"
 #include "cursordelegate_qpainter.h"
+#include "damageaudit.h"
 #include "dbusinterface.h"
 #include "decorations/decoratedclient.h"
 #include "deleted.h"
 #include "effects.h"
+#include "frametrace.h"
 #include "ftrace.h"
+#include "idlepowermode.h"
 #include "internalwindow.h"
 #include "openglbackend.h"
 #include "qpainterbackend.h"
@@ -30,11 +34,14 @@
 #include "scenes/opengl/scene_opengl.h"
 #include "scenes/qpainter/scene_qpainter.h"
 #include "shadow.h"
+#include "surfaceitem_wayland.h"
 #include "surfaceitem_x11.h"
 #include "unmanaged.h"
 #include "useractions.h"
 #include "utils/common.h"
+#include "utils/damagesimplifier.h"
 #include "utils/xcbutils.h"
+#include "wayland/display.h"
 #include "wayland/surface_interface.h"
 #include "wayland_server.h"
 #include "workspace.h"
@@ -158,7 +165,11 @@ Compositor::Compositor(QObject *workspace)
 
     // register DBus
     new CompositorDBusInterface(this);
+    new FrameStatsDBusInterface(this);
     FTraceLogger::create();
+    IdlePowerMode::create(this);
+    FrameTraceRecorder::create(this);
+    DamageAudit::create(this);
 }
 
 Compositor::~Compositor()
@@ -432,17 +443,27 @@ void Compositor::addOutput(Output *output)
     cursorLayer->setParent(workspaceLayer);
     cursorLayer->setSuperlayer(workspaceLayer);
 
-    auto updateCursorLayer = [output, cursorLayer]() {
-        const Cursor *cursor = Cursors::self()->currentCursor();
-        cursorLayer->setVisible(cursor->isOnOutput(output) && output->usesSoftwareCursor());
+    // The software cursor is only painted if the output fails to show the cursor with its
+    // hardware cursor, so moving the cursor usually doesn't need any compositing.
+    auto showCursorLayer = [output, cursorLayer](Cursor *cursor, bool hardwareCursor) {
+        cursorLayer->setVisible(cursor->isOnOutput(output) && !hardwareCursor);
         cursorLayer->setGeometry(output->mapFromGlobal(cursor->geometry()));
         cursorLayer->addRepaintFull();
     };
+    auto updateCursorLayer = [output, showCursorLayer]() {
+        Cursor *cursor = Cursors::self()->currentCursor();
+        showCursorLayer(cursor, output->setCursor(Cursors::self()->isCursorHidden() ? nullptr : cursor));
+    };
+    auto moveCursorLayer = [output, showCursorLayer]() {
+        Cursor *cursor = Cursors::self()->currentCursor();
+        showCursorLayer(cursor, output->moveCursor(Cursors::self()->isCursorHidden() ? nullptr : cursor));
+    };
     updateCursorLayer();
     connect(output, &Output::geometryChanged, cursorLayer, updateCursorLayer);
+    connect(output, &Output::cursorInvalidated, cursorLayer, updateCursorLayer);
     connect(Cursors::self(), &Cursors::currentCursorChanged, cursorLayer, updateCursorLayer);
     connect(Cursors::self(), &Cursors::hiddenChanged, cursorLayer, updateCursorLayer);
-    connect(Cursors::self(), &Cursors::positionChanged, cursorLayer, updateCursorLayer);
+    connect(Cursors::self(), &Cursors::positionChanged, cursorLayer, moveCursorLayer);
 
     addSuperLayer(workspaceLayer);
 }
@@ -461,6 +482,7 @@ void Compositor::addSuperLayer(RenderLayer *layer)
 void Compositor::removeSuperLayer(RenderLayer *layer)
 {
     m_superlayers.remove(layer->loop());
+    m_overlayRegions.remove(layer->loop());
     disconnect(layer->loop(), &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
     delete layer;
 }
@@ -623,43 +645,115 @@ void Compositor::composite(RenderLoop *renderLoop)
     fTraceDuration("Paint (", output->name(), ")");
 
     RenderLayer *superLayer = m_superlayers[renderLoop];
-    prePaintPass(superLayer);
+    {
+        fTraceDuration("Pre-paint pass (", output->name(), ")");
+        prePaintPass(superLayer);
+    }
     superLayer->setOutputLayer(outputLayer);
+    FrameTraceRecorder::self()->recordFrame(output);
 
-    SurfaceItem *scanoutCandidate = superLayer->delegate()->scanoutCandidate();
+    ScanoutRefusal scanoutRefusal;
+    SurfaceItem *scanoutCandidate = superLayer->delegate()->scanoutCandidate(&scanoutRefusal);
     renderLoop->setFullscreenSurface(scanoutCandidate);
 
+    bool allowTearing = false;
+    if (options->allowTearing()) {
+        if (auto surfaceItem = qobject_cast<SurfaceItemWayland *>(scanoutCandidate)) {
+            allowTearing = surfaceItem->surface() && surfaceItem->surface()->presentationHint() == KWaylandServer::PresentationHint::Async;
+        }
+    }
+    RenderLoopPrivate::get(renderLoop)->fullscreenItemAllowsTearing = allowTearing;
+
     renderLoop->beginFrame();
+    fTraceBegin(RenderLoopPrivate::get(renderLoop)->pendingFrames.back().traceContext, "Frame (", output->name(), ")");
     bool directScanout = false;
     if (scanoutCandidate) {
         const auto sublayers = superLayer->sublayers();
         const bool scanoutPossible = std::none_of(sublayers.begin(), sublayers.end(), [](RenderLayer *sublayer) {
             return sublayer->isVisible();
         });
-        if (scanoutPossible && !output->directScanoutInhibited()) {
+        if (!scanoutPossible) {
+            scanoutRefusal = ScanoutRefusal::SublayerVisible;
+        } else if (output->directScanoutInhibited()) {
+            scanoutRefusal = ScanoutRefusal::Inhibited;
+        } else {
             directScanout = outputLayer->scanout(scanoutCandidate);
+            scanoutRefusal = ScanoutRefusal::RejectedByOutput;
+        }
+    }
+    if (directScanout) {
+        RenderLoopPrivate::get(renderLoop)->frameStatistics.addDirectScanoutFrame();
+        RenderLoopPrivate::get(renderLoop)->pendingFrames.back().directScanout = true;
+    } else {
+        RenderLoopPrivate::get(renderLoop)->frameStatistics.addScanoutRefusal(scanoutRefusal);
+    }
+
+    QRegion overlayRegion;
+    if (OutputLayer *overlayLayer = m_backend->overlayLayer(output)) {
+        SurfaceItem *overlayCandidate = directScanout ? nullptr : superLayer->delegate()->overlayCandidate();
+        if (overlayCandidate && !output->directScanoutInhibited()) {
+            const QRect candidateRect = output->mapFromGlobal(overlayCandidate->mapToGlobal(overlayCandidate->rect()).toRect());
+            const auto sublayers = superLayer->sublayers();
+            const bool overlayPossible = std::none_of(sublayers.begin(), sublayers.end(), [&candidateRect](RenderLayer *sublayer) {
+                return sublayer->isVisible() && sublayer->mapToGlobal(sublayer->rect()).intersects(candidateRect);
+            });
+            if (overlayPossible && overlayLayer->scanout(overlayCandidate)) {
+                overlayRegion = candidateRect;
+            }
+        }
+        if (overlayRegion.isEmpty()) {
+            overlayLayer->releaseScanout();
+        }
+    }
+
+    // The primary layer is stale underneath the overlay, repaint it when the overlay moves away.
+    const QRegion previousOverlayRegion = m_overlayRegions.value(renderLoop);
+    if (overlayRegion != previousOverlayRegion) {
+        outputLayer->addRepaint(previousOverlayRegion - overlayRegion);
+        if (overlayRegion.isEmpty()) {
+            m_overlayRegions.remove(renderLoop);
+        } else {
+            m_overlayRegions.insert(renderLoop, overlayRegion);
         }
     }
 
     if (!directScanout) {
         QRegion surfaceDamage = outputLayer->repaints();
         outputLayer->resetRepaints();
-        preparePaintPass(superLayer, &surfaceDamage);
+        QRegion opaque;
+        preparePaintPass(superLayer, &surfaceDamage, &opaque);
 
-        if (auto beginInfo = outputLayer->beginFrame()) {
-            auto &[renderTarget, repaint] = beginInfo.value();
-            renderTarget.setDevicePixelRatio(output->scale());
+        // Damage covered by the overlay is not visible. If nothing else changed, e.g. only the
+        // hardware cursor moved, the last primary buffer can be presented again.
+        surfaceDamage = DamageSimplifier::outputDamage()->simplify(surfaceDamage - overlayRegion);
+        const bool primaryUpToDate = surfaceDamage.isEmpty() && previousOverlayRegion == overlayRegion && outputLayer->canRepeatFrame();
 
-            const QRegion bufferDamage = surfaceDamage.united(repaint).intersected(superLayer->rect());
-            outputLayer->aboutToStartPainting(bufferDamage);
+        if (!primaryUpToDate) {
+            if (auto beginInfo = outputLayer->beginFrame()) {
+                auto &[renderTarget, repaint] = beginInfo.value();
+                renderTarget.setDevicePixelRatio(output->scale());
 
-            paintPass(superLayer, &renderTarget, bufferDamage);
-            outputLayer->endFrame(bufferDamage, surfaceDamage);
+                const QRegion bufferDamage = surfaceDamage.united(repaint).intersected(superLayer->rect());
+                outputLayer->aboutToStartPainting(bufferDamage);
+
+                fTraceDuration("Paint pass (", output->name(), ")");
+                paintPass(superLayer, &renderTarget, bufferDamage);
+                outputLayer->endFrame(bufferDamage, surfaceDamage);
+            }
         }
     }
     renderLoop->endFrame();
 
-    postPaintPass(superLayer);
+    {
+        fTraceDuration("Post-paint pass (", output->name(), ")");
+        postPaintPass(superLayer);
+    }
+
+    // Send the frame callbacks right away rather than at the end of the flush interval,
+    // clients need them to start working on the next frame.
+    if (waylandServer()) {
+        waylandServer()->display()->flush();
+    }
 
     m_backend->present(output);
 
@@ -695,24 +789,48 @@ void Compositor::postPaintPass(RenderLayer *layer)
     }
 }
 
-void Compositor::preparePaintPass(RenderLayer *layer, QRegion *repaint)
+void Compositor::preparePaintPass(RenderLayer *layer, QRegion *repaint, QRegion *opaque)
 {
-    // TODO: Cull opaque region.
-    *repaint += layer->mapToGlobal(layer->repaints() + layer->delegate()->repaints());
+    // Sublayers are painted on top of their superlayer, so visit the layer tree front-to-back
+    // and drop the repaints that are hidden behind opaque layers.
+    const auto sublayers = layer->sublayers();
+    for (auto it = sublayers.crbegin(); it != sublayers.crend(); ++it) {
+        if ((*it)->isVisible()) {
+            preparePaintPass(*it, repaint, opaque);
+        }
+    }
+
+    *repaint += layer->mapToGlobal(layer->repaints() + layer->delegate()->repaints()) - *opaque;
     layer->resetRepaints();
+    *opaque += layer->mapToGlobal(layer->delegate()->opaque());
+}
+
+QRegion Compositor::opaqueRegion(RenderLayer *layer) const
+{
+    QRegion opaque = layer->mapToGlobal(layer->delegate()->opaque());
     const auto sublayers = layer->sublayers();
     for (RenderLayer *sublayer : sublayers) {
         if (sublayer->isVisible()) {
-            preparePaintPass(sublayer, repaint);
+            opaque += opaqueRegion(sublayer);
         }
     }
+    return opaque;
 }
 
 void Compositor::paintPass(RenderLayer *layer, RenderTarget *target, const QRegion &region)
 {
-    layer->delegate()->paint(target, region);
-
     const auto sublayers = layer->sublayers();
+
+    // Don't paint the parts of the layer that are going to be covered by opaque sublayers.
+    QRegion occluded;
+    for (RenderLayer *sublayer : sublayers) {
+        if (sublayer->isVisible()) {
+            occluded += opaqueRegion(sublayer);
+        }
+    }
+
+    layer->delegate()->paint(target, region - occluded);
+
     for (RenderLayer *sublayer : sublayers) {
         if (sublayer->isVisible()) {
             paintPass(sublayer, target, region);
@@ -765,6 +883,12 @@ X11Compositor::X11Compositor(QObject *parent)
     if (qEnvironmentVariableIsSet("KWIN_MAX_FRAMES_TESTED")) {
         m_framesToTestForSafety = qEnvironmentVariableIntValue("KWIN_MAX_FRAMES_TESTED");
     }
+
+    m_fullscreenTimer.setSingleShot(true);
+    connect(&m_fullscreenTimer, &QTimer::timeout, this, &X11Compositor::applyFullscreenSuspension);
+    connect(workspace(), &Workspace::windowActivated, this, &X11Compositor::setFullscreenCandidate);
+    connect(workspace(), &Workspace::geometryChanged, this, &X11Compositor::updateFullscreenSuspension);
+    connect(options, &Options::unredirectFullscreenChanged, this, &X11Compositor::updateFullscreenSuspension);
 }
 
 X11Compositor::~X11Compositor()
@@ -848,6 +972,9 @@ void X11Compositor::start()
         if (m_suspended & ScriptSuspend) {
             reasons << QStringLiteral("Disabled by Script");
         }
+        if (m_suspended & FullscreenSuspend) {
+            reasons << QStringLiteral("Disabled by Fullscreen Window");
+        }
         qCInfo(KWIN_CORE) << "Compositing is suspended, reason:" << reasons;
         return;
     } else if (!kwinApp()->platform()->compositingPossible()) {
@@ -984,6 +1111,76 @@ void X11Compositor::updateClientCompositeBlocking(X11Window *c)
     }
 }
 
+void X11Compositor::setFullscreenCandidate(Window *activeWindow)
+{
+    X11Window *window = qobject_cast<X11Window *>(activeWindow);
+    if (m_fullscreenCandidate == window) {
+        return;
+    }
+    for (const QMetaObject::Connection &connection : std::as_const(m_fullscreenCandidateConnections)) {
+        disconnect(connection);
+    }
+    m_fullscreenCandidateConnections.clear();
+    m_fullscreenCandidate = window;
+
+    if (window) {
+        m_fullscreenCandidateConnections = {
+            connect(window, &Window::fullScreenChanged, this, &X11Compositor::updateFullscreenSuspension),
+            connect(window, &Window::frameGeometryChanged, this, &X11Compositor::updateFullscreenSuspension),
+            connect(window, &Window::opacityChanged, this, &X11Compositor::updateFullscreenSuspension),
+            connect(window, &Window::hasAlphaChanged, this, &X11Compositor::updateFullscreenSuspension),
+            connect(window, &X11Window::blockingCompositingChanged, this, &X11Compositor::updateFullscreenSuspension),
+            connect(window, &Window::windowClosed, this, [this]() {
+                setFullscreenCandidate(nullptr);
+            }),
+        };
+    }
+    updateFullscreenSuspension();
+}
+
+bool X11Compositor::wantsFullscreenSuspension() const
+{
+    if (!options->unredirectFullscreen()) {
+        return false;
+    }
+    const X11Window *window = m_fullscreenCandidate;
+    if (!window || !window->isFullScreen() || window->hasAlpha() || window->opacity() < 1.0) {
+        return false;
+    }
+    // A window rule that forces "block compositing" off opts the application out.
+    if (!window->rules()->checkBlockCompositing(true)) {
+        return false;
+    }
+    // Suspending affects all outputs, so the window has to cover all of them.
+    return window->frameGeometry().toAlignedRect().contains(workspace()->geometry());
+}
+
+void X11Compositor::updateFullscreenSuspension()
+{
+    const bool suspended = m_suspended & FullscreenSuspend;
+    if (wantsFullscreenSuspension() == suspended) {
+        m_fullscreenTimer.stop();
+        return;
+    }
+    if (!m_fullscreenTimer.isActive()) {
+        // Leaving the fullscreen state has to be quick, entering it has to be sustained.
+        m_fullscreenTimer.start(suspended ? 250 : 1000);
+    }
+}
+
+void X11Compositor::applyFullscreenSuspension()
+{
+    const bool wanted = wantsFullscreenSuspension();
+    if (wanted == bool(m_suspended & FullscreenSuspend)) {
+        return;
+    }
+    if (wanted) {
+        suspend(FullscreenSuspend);
+    } else {
+        resume(FullscreenSuspend);
+    }
+}
+
 X11Compositor *X11Compositor::self()
 {
     return qobject_cast<X11Compositor *>(Compositor::self());
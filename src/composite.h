@@ -145,8 +145,9 @@ private:
 
     void prePaintPass(RenderLayer *layer);
     void postPaintPass(RenderLayer *layer);
-    void preparePaintPass(RenderLayer *layer, QRegion *repaint);
+    void preparePaintPass(RenderLayer *layer, QRegion *repaint, QRegion *opaque);
     void paintPass(RenderLayer *layer, RenderTarget *target, const QRegion &region);
+    QRegion opaqueRegion(RenderLayer *layer) const;
 
     State m_state = State::Off;
     std::unique_ptr<CompositorSelectionOwner> m_selectionOwner;
@@ -156,6 +157,7 @@ private:
     std::unique_ptr<Scene> m_scene;
     std::unique_ptr<RenderBackend> m_backend;
     QHash<RenderLoop *, RenderLayer *> m_superlayers;
+    QHash<RenderLoop *, QRegion> m_overlayRegions;
 };
 
 class KWIN_EXPORT WaylandCompositor final : public Compositor
@@ -183,6 +185,7 @@ public:
         UserSuspend = 1 << 0,
         BlockRuleSuspend = 1 << 1,
         ScriptSuspend = 1 << 2,
+        FullscreenSuspend = 1 << 3,
         AllReasonSuspend = 0xff
     };
     Q_DECLARE_FLAGS(SuspendReasons, SuspendReason)
@@ -242,6 +245,13 @@ public:
 
     void updateClientCompositeBlocking(X11Window *client = nullptr);
 
+    /**
+     * Re-evaluates whether compositing should be suspended for an opaque fullscreen X11 window.
+     * The change is applied only once the state has been stable for a while, so that briefly
+     * switching away from a fullscreen game doesn't restart the compositor every time.
+     */
+    void updateFullscreenSuspension();
+
     static X11Compositor *self();
 
 protected:
@@ -251,12 +261,19 @@ protected:
 
 private:
     explicit X11Compositor(QObject *parent);
+    void setFullscreenCandidate(Window *window);
+    bool wantsFullscreenSuspension() const;
+    void applyFullscreenSuspension();
+
     std::unique_ptr<X11SyncManager> m_syncManager;
     /**
      * Whether the Compositor is currently suspended, 8 bits encoding the reason
      */
     SuspendReasons m_suspended;
     int m_framesToTestForSafety = 3;
+    QTimer m_fullscreenTimer;
+    X11Window *m_fullscreenCandidate = nullptr;
+    QVector<QMetaObject::Connection> m_fullscreenCandidateConnections;
 };
 
 }
@@ -6,6 +6,7 @@
 #cmakedefine01 KWIN_BUILD_SCREENLOCKER
 #cmakedefine01 KWIN_BUILD_TABBOX
 #cmakedefine01 KWIN_BUILD_ACTIVITIES
+#cmakedefine01 KWIN_BUILD_ALLOCATION_TRACKING
 #define KWIN_NAME "${KWIN_NAME}"
 #define KWIN_INTERNAL_NAME_X11 "${KWIN_INTERNAL_NAME_X11}"
 #define KWIN_CONFIG "${KWIN_NAME}rc"
@@ -15,6 +16,7 @@
 #define KWIN_RULES_DIALOG_BIN "${CMAKE_INSTALL_FULL_LIBEXECDIR}/kwin_rules_dialog"
 #cmakedefine01 HAVE_X11_XCB
 #cmakedefine01 HAVE_X11_XINPUT
+#cmakedefine01 HAVE_XCB_PRESENT
 #cmakedefine01 HAVE_GBM_BO_GET_FD_FOR_PLANE
 #cmakedefine01 HAVE_MEMFD
 #cmakedefine01 HAVE_WAYLAND_EGL
@@ -14,13 +14,9 @@ namespace KWin
 {
 
 ColorLUT::ColorLUT(const std::shared_ptr<ColorTransformation> &transformation, size_t size)
-    : m_transformation(transformation)
+    : m_data(transformation->sampleRamp(size))
+    , m_transformation(transformation)
 {
-    m_data.fill(0, 3 * size);
-    for (uint64_t i = 0; i < size; i++) {
-        const uint16_t index = (i * 0xFFFF) / size;
-        std::tie(m_data[i], m_data[size + i], m_data[size * 2 + i]) = transformation->transform(index, index, index);
-    }
 }
 
 uint16_t *ColorLUT::red() const
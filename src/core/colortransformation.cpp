@@ -10,6 +10,9 @@
 #include "colorpipelinestage.h"
 
 #include <lcms2.h>
+#include <lcms2_plugin.h>
+
+#include <algorithm>
 
 #include "utils/common.h"
 
@@ -31,6 +34,9 @@ ColorTransformation::ColorTransformation(std::vector<std::unique_ptr<ColorPipeli
             m_valid = false;
             return;
         }
+        if (cmsStageType(stage->stage()) != cmsSigCurveSetElemType || cmsStageInputChannels(stage->stage()) != 3) {
+            m_curvesOnly = false;
+        }
     }
 }
 
@@ -58,4 +64,65 @@ std::tuple<uint16_t, uint16_t, uint16_t> ColorTransformation::transform(uint16_t
     return {out[0], out[1], out[2]};
 }
 
+QVector3D ColorTransformation::transform(const QVector3D &in) const
+{
+    const cmsFloat32Number input[3] = {in.x(), in.y(), in.z()};
+    cmsFloat32Number output[3] = {0, 0, 0};
+    cmsPipelineEvalFloat(input, output, m_pipeline);
+    return QVector3D(output[0], output[1], output[2]);
+}
+
+void ColorTransformation::transform(const uint16_t *input, uint16_t *output, size_t count) const
+{
+    if (!m_curvesOnly) {
+        for (size_t i = 0; i < count; i++) {
+            uint16_t out[3];
+            cmsPipelineEval16(input + i * 3, out, m_pipeline);
+            std::copy_n(out, 3, output + i * 3);
+        }
+        return;
+    }
+    // Evaluating the tone curves directly, one channel at a time, avoids the conversion to
+    // floating point and back at every stage of the pipeline
+    if (output != input) {
+        std::copy_n(input, count * 3, output);
+    }
+    for (const auto &stage : m_stages) {
+        const auto data = static_cast<const _cmsStageToneCurvesData *>(cmsStageData(stage->stage()));
+        for (int channel = 0; channel < 3; channel++) {
+            const cmsToneCurve *curve = data->TheCurves[channel];
+            for (size_t i = 0; i < count; i++) {
+                output[i * 3 + channel] = cmsEvalToneCurve16(curve, output[i * 3 + channel]);
+            }
+        }
+    }
+}
+
+QVector<uint16_t> ColorTransformation::sampleRamp(size_t size) const
+{
+    if (const auto it = m_rampCache.constFind(size); it != m_rampCache.constEnd()) {
+        return *it;
+    }
+    QVector<uint16_t> interleaved(3 * size);
+    for (size_t i = 0; i < size; i++) {
+        const uint16_t index = (i * 0xFFFF) / size;
+        std::fill_n(interleaved.data() + i * 3, 3, index);
+    }
+    transform(interleaved.constData(), interleaved.data(), size);
+
+    QVector<uint16_t> ret(3 * size);
+    for (size_t i = 0; i < size; i++) {
+        ret[i] = interleaved[i * 3];
+        ret[size + i] = interleaved[i * 3 + 1];
+        ret[size * 2 + i] = interleaved[i * 3 + 2];
+    }
+    m_rampCache.insert(size, ret);
+    return ret;
+}
+
+const std::vector<std::unique_ptr<ColorPipelineStage>> &ColorTransformation::stages() const
+{
+    return m_stages;
+}
+
 }
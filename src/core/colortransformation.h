@@ -8,6 +8,8 @@
 */
 #pragma once
 
+#include <QHash>
+#include <QVector3D>
 #include <QVector>
 #include <memory>
 #include <stdint.h>
@@ -31,11 +33,30 @@ public:
     bool valid() const;
 
     std::tuple<uint16_t, uint16_t, uint16_t> transform(uint16_t r, uint16_t g, uint16_t b) const;
+    /**
+     * Transforms @a in, with channels in the [0, 1] range, without clamping intermediate values.
+     */
+    QVector3D transform(const QVector3D &in) const;
+    /**
+     * Transforms the @a count interleaved rgb triplets in @a input at once and writes the
+     * results to @a output, which may be the same as @a input.
+     */
+    void transform(const uint16_t *input, uint16_t *output, size_t count) const;
+    /**
+     * Returns the transformation of a gray ramp with @a size steps, with the red, green and
+     * blue channels one after another. The result is cached.
+     */
+    QVector<uint16_t> sampleRamp(size_t size) const;
+
+    const std::vector<std::unique_ptr<ColorPipelineStage>> &stages() const;
 
 private:
     cmsPipeline *const m_pipeline;
     const std::vector<std::unique_ptr<ColorPipelineStage>> m_stages;
     bool m_valid = true;
+    // whether the channels are transformed independently by tone curves only
+    bool m_curvesOnly = true;
+    mutable QHash<size_t, QVector<uint16_t>> m_rampCache;
 };
 
 }
@@ -0,0 +1,107 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "cursorfastpath.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// If the main thread picks up a motion within this time, it moves the cursor itself. This
+// is well below a refresh cycle, but longer than it usually takes an idle main thread.
+static const std::chrono::microseconds s_defaultLatencyThreshold(4000);
+
+CursorFastPath::CursorFastPath(std::chrono::microseconds latencyThreshold)
+    : m_latencyThreshold(latencyThreshold)
+{
+}
+
+CursorFastPath *CursorFastPath::self()
+{
+    static CursorFastPath fastPath(s_defaultLatencyThreshold);
+    return &fastPath;
+}
+
+void CursorFastPath::addPlane(CursorPlane *plane)
+{
+    std::unique_lock lock(m_mutex);
+    if (!m_planes.contains(plane)) {
+        m_planes.append(plane);
+    }
+}
+
+void CursorFastPath::removePlane(CursorPlane *plane)
+{
+    std::unique_lock lock(m_mutex);
+    m_planes.removeOne(plane);
+}
+
+void CursorFastPath::setEnabled(bool enabled)
+{
+    std::unique_lock lock(m_mutex);
+    m_enabled = enabled;
+}
+
+void CursorFastPath::motionProcessed(const QPointF &delta)
+{
+    std::unique_lock lock(m_mutex);
+    m_processedDelta += delta;
+    m_processedCount++;
+}
+
+void CursorFastPath::setPosition(const QPointF &position)
+{
+    std::unique_lock lock(m_mutex);
+    m_position = position;
+    m_pendingCount -= std::min(m_processedCount, m_pendingCount);
+    if (m_pendingCount == 0) {
+        // don't let rounding errors pile up
+        m_pendingDelta = QPointF();
+    } else {
+        m_pendingDelta -= m_processedDelta;
+        // the main thread just caught up, the remaining motions are younger than the ones it processed
+        m_pendingSince = std::chrono::steady_clock::now();
+    }
+    m_processedDelta = QPointF();
+    m_processedCount = 0;
+    m_moved = false;
+}
+
+void CursorFastPath::motion(const QPointF &delta)
+{
+    std::unique_lock lock(m_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (m_pendingCount == 0) {
+        m_pendingSince = now;
+    }
+    m_pendingDelta += delta;
+    m_pendingCount++;
+
+    if (!m_enabled || now - m_pendingSince < m_latencyThreshold) {
+        return;
+    }
+    const QPointF position = m_position + m_pendingDelta;
+    if (m_moved && m_lastMovedPosition == position) {
+        return;
+    }
+    bool moved = false;
+    for (CursorPlane *plane : qAsConst(m_planes)) {
+        // the cursor may be visible on several outputs at once
+        moved |= plane->moveTo(position);
+    }
+    m_moved = moved;
+    m_lastMovedPosition = position;
+}
+
+QPointF CursorFastPath::predictedPosition() const
+{
+    std::unique_lock lock(m_mutex);
+    return m_position + m_pendingDelta;
+}
+
+} // namespace KWin
@@ -0,0 +1,111 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QPointF>
+#include <QVector>
+
+#include <chrono>
+#include <mutex>
+
+namespace KWin
+{
+
+/**
+ * A CursorPlane is a hardware cursor that can be moved from the input thread.
+ */
+class KWIN_EXPORT CursorPlane
+{
+public:
+    virtual ~CursorPlane() = default;
+
+    /**
+     * Moves the cursor so that its hotspot is at @a position, in global logical coordinates.
+     * This is called from the input thread, implementations may not touch any state that
+     * belongs to the main thread. Returns @c false if the plane doesn't show the cursor at
+     * @a position, e.g. because the position is on another output.
+     */
+    virtual bool moveTo(const QPointF &position) = 0;
+};
+
+/**
+ * The CursorFastPath lets the input thread move the hardware cursor while the main thread
+ * is busy.
+ *
+ * The input thread reports every relative pointer motion as soon as it's read, the main
+ * thread reports which motions it has processed and where that put the pointer. If the
+ * oldest motion that the main thread hasn't processed yet is older than the latency
+ * threshold, the input thread predicts the pointer position from the unprocessed motions and
+ * moves the cursor planes there itself. Once the main thread catches up, it moves the cursor
+ * to the actual position, which also undoes any misprediction, e.g. at screen edges.
+ *
+ * The prediction doesn't know about pointer constraints, so the main thread disables the fast
+ * path while the pointer is confined or locked.
+ */
+class KWIN_EXPORT CursorFastPath
+{
+public:
+    explicit CursorFastPath(std::chrono::microseconds latencyThreshold);
+
+    static CursorFastPath *self();
+
+    /**
+     * Adds @a plane to the planes that are moved from the input thread. Main thread only.
+     */
+    void addPlane(CursorPlane *plane);
+    /**
+     * Removes @a plane, waiting for a move of the plane that is in progress to finish.
+     * Main thread only.
+     */
+    void removePlane(CursorPlane *plane);
+
+    /**
+     * Sets whether the input thread may move the cursor planes. Main thread only.
+     */
+    void setEnabled(bool enabled);
+    /**
+     * Records that the main thread has processed a relative motion by @a delta. It's taken
+     * into account with the next setPosition(), when the position reflects the motion.
+     * Main thread only.
+     */
+    void motionProcessed(const QPointF &delta);
+    /**
+     * Sets the actual pointer position. Main thread only.
+     */
+    void setPosition(const QPointF &position);
+
+    /**
+     * Records a relative pointer motion by @a delta that the main thread hasn't processed yet
+     * and moves the cursor planes if the main thread is lagging behind. Input thread only.
+     */
+    void motion(const QPointF &delta);
+
+    /**
+     * Returns the position that the pointer is going to be at once all reported motions
+     * have been processed.
+     */
+    QPointF predictedPosition() const;
+
+private:
+    const std::chrono::microseconds m_latencyThreshold;
+    mutable std::mutex m_mutex;
+    QVector<CursorPlane *> m_planes;
+    bool m_enabled = true;
+    QPointF m_position;
+    QPointF m_pendingDelta;
+    int m_pendingCount = 0;
+    std::chrono::steady_clock::time_point m_pendingSince;
+    QPointF m_processedDelta;
+    int m_processedCount = 0;
+    QPointF m_lastMovedPosition;
+    bool m_moved = false;
+};
+
+} // namespace KWin
@@ -0,0 +1,164 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "framestatistics.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+using namespace std::chrono_literals;
+
+static constexpr std::array<std::chrono::nanoseconds, 7> s_renderTimeBounds = {1ms, 2ms, 4ms, 8ms, 16ms, 33ms, 66ms};
+static constexpr std::array<std::chrono::nanoseconds, 8> s_inputLatencyBounds = {4ms, 8ms, 12ms, 16ms, 24ms, 33ms, 50ms, 100ms};
+
+FrameStatistics::FrameStatistics()
+{
+}
+
+void FrameStatistics::addPresentedFrame(std::chrono::nanoseconds predictedTimestamp, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds vblankInterval)
+{
+    m_presentedFrames++;
+
+    const std::chrono::nanoseconds error = timestamp - predictedTimestamp;
+    if (error > vblankInterval / 2) {
+        m_missedFrames++;
+    }
+
+    if (m_predictionErrors.count() >= s_predictionErrorLogSize) {
+        m_predictionErrors.dequeue();
+    }
+    m_predictionErrors.enqueue(std::chrono::abs(error));
+}
+
+void FrameStatistics::addFailedFrame()
+{
+    m_failedFrames++;
+}
+
+void FrameStatistics::addDirectScanoutFrame()
+{
+    m_directScanoutFrames++;
+}
+
+void FrameStatistics::addScanoutRefusal(ScanoutRefusal refusal)
+{
+    m_scanoutRefusals[int(refusal)]++;
+}
+
+void FrameStatistics::addRenderTime(std::chrono::nanoseconds renderTime)
+{
+    static_assert(s_renderTimeBounds.size() + 1 == s_bucketCount);
+    const auto it = std::lower_bound(s_renderTimeBounds.begin(), s_renderTimeBounds.end(), renderTime);
+    m_renderTimeHistogram[std::distance(s_renderTimeBounds.begin(), it)]++;
+}
+
+void FrameStatistics::addInputLatency(std::chrono::nanoseconds latency)
+{
+    static_assert(s_inputLatencyBounds.size() + 1 == s_inputLatencyBucketCount);
+    const auto it = std::lower_bound(s_inputLatencyBounds.begin(), s_inputLatencyBounds.end(), latency);
+    m_inputLatencyHistogram[std::distance(s_inputLatencyBounds.begin(), it)]++;
+    m_maximumInputLatency = std::max(m_maximumInputLatency, latency);
+}
+
+void FrameStatistics::reset()
+{
+    *this = FrameStatistics();
+}
+
+quint64 FrameStatistics::presentedFrames() const
+{
+    return m_presentedFrames;
+}
+
+quint64 FrameStatistics::missedFrames() const
+{
+    return m_missedFrames;
+}
+
+quint64 FrameStatistics::failedFrames() const
+{
+    return m_failedFrames;
+}
+
+quint64 FrameStatistics::directScanoutFrames() const
+{
+    return m_directScanoutFrames;
+}
+
+QVector<std::chrono::nanoseconds> FrameStatistics::renderTimeBuckets()
+{
+    return QVector<std::chrono::nanoseconds>(s_renderTimeBounds.begin(), s_renderTimeBounds.end());
+}
+
+QVector<quint64> FrameStatistics::renderTimeHistogram() const
+{
+    return QVector<quint64>(m_renderTimeHistogram.begin(), m_renderTimeHistogram.end());
+}
+
+QVector<std::chrono::nanoseconds> FrameStatistics::inputLatencyBuckets()
+{
+    return QVector<std::chrono::nanoseconds>(s_inputLatencyBounds.begin(), s_inputLatencyBounds.end());
+}
+
+QVector<quint64> FrameStatistics::inputLatencyHistogram() const
+{
+    return QVector<quint64>(m_inputLatencyHistogram.begin(), m_inputLatencyHistogram.end());
+}
+
+std::chrono::nanoseconds FrameStatistics::maximumInputLatency() const
+{
+    return m_maximumInputLatency;
+}
+
+quint64 FrameStatistics::scanoutRefusals(ScanoutRefusal refusal) const
+{
+    return m_scanoutRefusals[int(refusal)];
+}
+
+QString FrameStatistics::scanoutRefusalName(ScanoutRefusal refusal)
+{
+    switch (refusal) {
+    case ScanoutRefusal::NoCandidate:
+        return QStringLiteral("noCandidate");
+    case ScanoutRefusal::BlockedByEffect:
+        return QStringLiteral("blockedByEffect");
+    case ScanoutRefusal::Translucent:
+        return QStringLiteral("translucent");
+    case ScanoutRefusal::NotCovered:
+        return QStringLiteral("notCovered");
+    case ScanoutRefusal::Shaped:
+        return QStringLiteral("shaped");
+    case ScanoutRefusal::NotOpaque:
+        return QStringLiteral("notOpaque");
+    case ScanoutRefusal::SublayerVisible:
+        return QStringLiteral("sublayerVisible");
+    case ScanoutRefusal::Inhibited:
+        return QStringLiteral("inhibited");
+    case ScanoutRefusal::RejectedByOutput:
+        return QStringLiteral("rejectedByOutput");
+    }
+    Q_UNREACHABLE();
+}
+
+std::chrono::nanoseconds FrameStatistics::averagePredictionError() const
+{
+    if (m_predictionErrors.isEmpty()) {
+        return 0ns;
+    }
+    std::chrono::nanoseconds sum = 0ns;
+    for (const std::chrono::nanoseconds &error : m_predictionErrors) {
+        sum += error;
+    }
+    return sum / m_predictionErrors.count();
+}
+
+std::chrono::nanoseconds FrameStatistics::maximumPredictionError() const
+{
+    const auto it = std::max_element(m_predictionErrors.begin(), m_predictionErrors.end());
+    return it != m_predictionErrors.end() ? *it : 0ns;
+}
+
+} // namespace KWin
@@ -0,0 +1,115 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QQueue>
+#include <QString>
+#include <QVector>
+
+#include <array>
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * Why a frame has been composited rather than directly scanned out.
+ */
+enum class ScanoutRefusal {
+    // there's no fullscreen window on top that could be scanned out
+    NoCandidate,
+    // an active effect paints over or transforms the screen
+    BlockedByEffect,
+    Translucent,
+    // the topmost surface doesn't cover the window, e.g. a subsurface on top
+    NotCovered,
+    Shaped,
+    // the buffer has an alpha channel and the surface isn't marked as opaque
+    NotOpaque,
+    // something is painted on top, e.g. a software cursor
+    SublayerVisible,
+    // direct scanout is inhibited for the output, e.g. while it's being recorded
+    Inhibited,
+    // the output layer can't show the buffer, e.g. because of its format or its size
+    RejectedByOutput,
+};
+
+/**
+ * The FrameStatistics class collects counters that describe how well a render loop keeps
+ * up with the display. The frame counters and the render time histogram are cumulative, so
+ * they can be sampled at any interval. The prediction error is tracked over the most recent
+ * frames only.
+ */
+class KWIN_EXPORT FrameStatistics
+{
+public:
+    FrameStatistics();
+
+    /**
+     * Records that a frame has been presented at @a timestamp, while it was expected to be
+     * presented at @a predictedTimestamp. If the frame is presented more than half of the
+     * @a vblankInterval later than predicted, it is counted as missed.
+     */
+    void addPresentedFrame(std::chrono::nanoseconds predictedTimestamp, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds vblankInterval);
+    void addFailedFrame();
+    void addDirectScanoutFrame();
+    void addScanoutRefusal(ScanoutRefusal refusal);
+    void addRenderTime(std::chrono::nanoseconds renderTime);
+    /**
+     * Records the time between an input event being generated by the kernel and the frame
+     * that shows the reaction of a client to it being presented.
+     */
+    void addInputLatency(std::chrono::nanoseconds latency);
+    void reset();
+
+    quint64 presentedFrames() const;
+    quint64 missedFrames() const;
+    quint64 failedFrames() const;
+    quint64 directScanoutFrames() const;
+    quint64 scanoutRefusals(ScanoutRefusal refusal) const;
+
+    static constexpr int scanoutRefusalCount = int(ScanoutRefusal::RejectedByOutput) + 1;
+    /**
+     * Returns the name of @a refusal, e.g. "notOpaque".
+     */
+    static QString scanoutRefusalName(ScanoutRefusal refusal);
+
+    /**
+     * Returns the upper bounds of the render time histogram buckets. The last bucket
+     * has no upper bound.
+     */
+    static QVector<std::chrono::nanoseconds> renderTimeBuckets();
+    QVector<quint64> renderTimeHistogram() const;
+
+    /**
+     * Returns the upper bounds of the input latency histogram buckets. The last bucket
+     * has no upper bound.
+     */
+    static QVector<std::chrono::nanoseconds> inputLatencyBuckets();
+    QVector<quint64> inputLatencyHistogram() const;
+    std::chrono::nanoseconds maximumInputLatency() const;
+
+    std::chrono::nanoseconds averagePredictionError() const;
+    std::chrono::nanoseconds maximumPredictionError() const;
+
+private:
+    static constexpr int s_bucketCount = 8;
+    static constexpr int s_inputLatencyBucketCount = 9;
+    static constexpr int s_predictionErrorLogSize = 240;
+
+    quint64 m_presentedFrames = 0;
+    quint64 m_missedFrames = 0;
+    quint64 m_failedFrames = 0;
+    quint64 m_directScanoutFrames = 0;
+    std::array<quint64, scanoutRefusalCount> m_scanoutRefusals{};
+    std::array<quint64, s_bucketCount> m_renderTimeHistogram{};
+    std::array<quint64, s_inputLatencyBucketCount> m_inputLatencyHistogram{};
+    std::chrono::nanoseconds m_maximumInputLatency = std::chrono::nanoseconds::zero();
+    QQueue<std::chrono::nanoseconds> m_predictionErrors;
+};
+
+} // namespace KWin
@@ -49,6 +49,12 @@ Q_SIGNALS:
     void pointerButtonChanged(quint32 button, InputRedirection::PointerButtonState state, quint32 time, InputDevice *device);
     void pointerMotionAbsolute(const QPointF &position, quint32 time, InputDevice *device);
     void pointerMotion(const QPointF &delta, const QPointF &deltaNonAccelerated, quint32 time, quint64 timeMicroseconds, InputDevice *device);
+    /**
+     * Emitted instead of pointerMotion() when several relative motions have been read at once.
+     * They are processed as one motion by the compositor, the individual @a motions are only
+     * forwarded to clients that want relative pointer events.
+     */
+    void pointerMotionCoalesced(const QVector<KWin::RelativePointerMotion> &motions, quint32 time, InputDevice *device);
     void pointerAxisChanged(InputRedirection::PointerAxis axis, qreal delta, qint32 discreteDelta,
                             InputRedirection::PointerAxisSource source, quint32 time, InputDevice *device);
     void touchFrame(InputDevice *device);
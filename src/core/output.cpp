@@ -149,6 +149,18 @@ bool Output::usesSoftwareCursor() const
     return true;
 }
 
+bool Output::setCursor(Cursor *cursor)
+{
+    Q_UNUSED(cursor)
+    return !usesSoftwareCursor();
+}
+
+bool Output::moveCursor(Cursor *cursor)
+{
+    Q_UNUSED(cursor)
+    return !usesSoftwareCursor();
+}
+
 QRect Output::mapFromGlobal(const QRect &rect) const
 {
     return rect.translated(-geometry().topLeft());
@@ -312,6 +324,11 @@ void Output::setDpmsMode(DpmsMode mode)
     Q_UNUSED(mode)
 }
 
+void Output::setConsumerRefreshRate(std::optional<int> refreshRate)
+{
+    Q_UNUSED(refreshRate)
+}
+
 Output::DpmsMode Output::dpmsMode() const
 {
     return m_state.dpmsMode;
@@ -393,9 +410,10 @@ Output::RgbRange Output::rgbRange() const
     return m_state.rgbRange;
 }
 
-void Output::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation)
+void Output::setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update)
 {
     Q_UNUSED(transformation);
+    Q_UNUSED(update);
 }
 
 } // namespace KWin
@@ -21,6 +21,8 @@
 #include <QUuid>
 #include <QVector>
 
+#include <optional>
+
 namespace KWin
 {
 
@@ -28,6 +30,7 @@ class EffectScreenImpl;
 class RenderLoop;
 class OutputConfiguration;
 class ColorTransformation;
+class Cursor;
 
 class KWIN_EXPORT OutputMode
 {
@@ -213,6 +216,16 @@ public:
     Transform transform() const;
 
     virtual bool usesSoftwareCursor() const;
+    /**
+     * Shows @a cursor with the hardware cursor of the output, a null @a cursor hides it.
+     * Returns @c false if the cursor has to be painted in software instead.
+     */
+    virtual bool setCursor(Cursor *cursor);
+    /**
+     * Moves the hardware cursor to the current position of @a cursor. Returns @c false if
+     * the cursor has to be painted in software instead.
+     */
+    virtual bool moveCursor(Cursor *cursor);
 
     void applyChanges(const OutputConfiguration &config);
 
@@ -225,6 +238,14 @@ public:
     DpmsMode dpmsMode() const;
     virtual void setDpmsMode(DpmsMode mode);
 
+    /**
+     * Paces an output whose contents are only consumed by screencast streams to them. With a
+     * @a refreshRate of 0 nothing consumes the output and it isn't rendered, otherwise it's
+     * rendered at up to @a refreshRate, in millihertz. std::nullopt goes back to rendering
+     * at the refresh rate of the mode. Physical outputs ignore this, which is the default.
+     */
+    virtual void setConsumerRefreshRate(std::optional<int> refreshRate);
+
     uint32_t overscan() const;
 
     /**
@@ -239,7 +260,20 @@ public:
     bool isPlaceholder() const;
     bool isNonDesktop() const;
 
-    virtual void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation);
+    enum class ColorTransformationUpdate {
+        /**
+         * The output is repainted to show the new color transformation right away.
+         */
+        Immediate,
+        /**
+         * The new color transformation is shown along with the next frame that is rendered
+         * anyway, e.g. for the steps of an animation that must not keep an idle output busy.
+         */
+        WithNextFrame,
+    };
+    Q_ENUM(ColorTransformationUpdate)
+
+    virtual void setColorTransformation(const std::shared_ptr<ColorTransformation> &transformation, ColorTransformationUpdate update = ColorTransformationUpdate::Immediate);
 
 Q_SIGNALS:
     /**
@@ -294,6 +328,11 @@ Q_SIGNALS:
     void overscanChanged();
     void vrrPolicyChanged();
     void rgbRangeChanged();
+    /**
+     * This signal is emitted when the cursor has to be set again with setCursor(), e.g.
+     * because the buffers of the hardware cursor have been recreated.
+     */
+    void cursorInvalidated();
 
 protected:
     struct Information
@@ -40,4 +40,13 @@ bool OutputLayer::scanout(SurfaceItem *surfaceItem)
     return false;
 }
 
+void OutputLayer::releaseScanout()
+{
+}
+
+bool OutputLayer::canRepeatFrame() const
+{
+    return false;
+}
+
 } // namespace KWin
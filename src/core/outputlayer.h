@@ -50,6 +50,18 @@ public:
      */
     virtual bool scanout(SurfaceItem *surfaceItem);
 
+    /**
+     * Stops showing the buffer that has been imported with scanout(). This only matters
+     * for layers that are presented on top of the primary layer.
+     */
+    virtual void releaseScanout();
+
+    /**
+     * Returns @c true if the last rendered frame can be presented again without calling
+     * beginFrame() and endFrame(), so frames without damage don't have to be rendered.
+     */
+    virtual bool canRepeatFrame() const;
+
 private:
     QRegion m_repaints;
 };
@@ -21,6 +21,12 @@ OverlayWindow *RenderBackend::overlayWindow() const
     return nullptr;
 }
 
+OutputLayer *RenderBackend::overlayLayer(Output *output)
+{
+    Q_UNUSED(output)
+    return nullptr;
+}
+
 bool RenderBackend::checkGraphicsReset()
 {
     return false;
@@ -34,6 +34,11 @@ public:
     virtual bool checkGraphicsReset();
 
     virtual OutputLayer *primaryLayer(Output *output) = 0;
+    /**
+     * Returns the layer that can present a client buffer on top of the primary layer
+     * of the given @a output, or @c null if there is no such layer.
+     */
+    virtual OutputLayer *overlayLayer(Output *output);
     virtual void present(Output *output) = 0;
 
     virtual QHash<uint32_t, QVector<uint64_t>> supportedFormats() const;
@@ -6,6 +6,10 @@
 
 #include "renderjournal.h"
 
+#include <QVector>
+
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -13,6 +17,61 @@ RenderJournal::RenderJournal()
 {
 }
 
+static void appendEntry(QQueue<std::chrono::nanoseconds> &log, std::chrono::nanoseconds duration, int size)
+{
+    if (log.count() >= size) {
+        log.dequeue();
+    }
+    log.enqueue(duration);
+}
+
+static auto recentEntries(const QQueue<std::chrono::nanoseconds> &log, int size)
+{
+    return std::make_pair(log.constEnd() - std::min<int>(log.count(), size), log.constEnd());
+}
+
+static std::chrono::nanoseconds minimumEntry(const QQueue<std::chrono::nanoseconds> &log, int size)
+{
+    const auto [begin, end] = recentEntries(log, size);
+    auto it = std::min_element(begin, end);
+    return it != end ? (*it) : std::chrono::nanoseconds::zero();
+}
+
+static std::chrono::nanoseconds maximumEntry(const QQueue<std::chrono::nanoseconds> &log, int size)
+{
+    const auto [begin, end] = recentEntries(log, size);
+    auto it = std::max_element(begin, end);
+    return it != end ? (*it) : std::chrono::nanoseconds::zero();
+}
+
+static std::chrono::nanoseconds averageEntry(const QQueue<std::chrono::nanoseconds> &log, int size)
+{
+    const auto [begin, end] = recentEntries(log, size);
+    if (begin == end) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    std::chrono::nanoseconds result = std::chrono::nanoseconds::zero();
+    for (auto it = begin; it != end; ++it) {
+        result += *it;
+    }
+
+    return result / std::distance(begin, end);
+}
+
+static std::chrono::nanoseconds percentileEntry(const QQueue<std::chrono::nanoseconds> &log, int percentile)
+{
+    if (log.isEmpty()) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    QVector<std::chrono::nanoseconds> entries(log.constBegin(), log.constEnd());
+    const int index = std::clamp(int(entries.count() * percentile + 99) / 100 - 1, 0, int(entries.count()) - 1);
+    std::nth_element(entries.begin(), entries.begin() + index, entries.end());
+
+    return entries[index];
+}
+
 void RenderJournal::beginFrame()
 {
     m_timer.start();
@@ -20,37 +79,42 @@ void RenderJournal::beginFrame()
 
 void RenderJournal::endFrame()
 {
-    std::chrono::nanoseconds duration(m_timer.nsecsElapsed());
-    if (m_log.count() >= m_size) {
-        m_log.dequeue();
-    }
-    m_log.enqueue(duration);
+    appendEntry(m_log, std::chrono::nanoseconds(m_timer.nsecsElapsed()), m_longSize);
+}
+
+std::chrono::nanoseconds RenderJournal::latest() const
+{
+    return m_log.isEmpty() ? std::chrono::nanoseconds::zero() : m_log.last();
+}
+
+void RenderJournal::addGpuTime(std::chrono::nanoseconds duration)
+{
+    appendEntry(m_gpuLog, duration, m_longSize);
+}
+
+bool RenderJournal::hasGpuTimes() const
+{
+    return !m_gpuLog.isEmpty();
 }
 
 std::chrono::nanoseconds RenderJournal::minimum() const
 {
-    auto it = std::min_element(m_log.constBegin(), m_log.constEnd());
-    return it != m_log.constEnd() ? (*it) : std::chrono::nanoseconds::zero();
+    return std::max(minimumEntry(m_log, m_size), minimumEntry(m_gpuLog, m_size));
 }
 
 std::chrono::nanoseconds RenderJournal::maximum() const
 {
-    auto it = std::max_element(m_log.constBegin(), m_log.constEnd());
-    return it != m_log.constEnd() ? (*it) : std::chrono::nanoseconds::zero();
+    return std::max(maximumEntry(m_log, m_size), maximumEntry(m_gpuLog, m_size));
 }
 
 std::chrono::nanoseconds RenderJournal::average() const
 {
-    if (m_log.isEmpty()) {
-        return std::chrono::nanoseconds::zero();
-    }
-
-    std::chrono::nanoseconds result = std::chrono::nanoseconds::zero();
-    for (const std::chrono::nanoseconds &entry : m_log) {
-        result += entry;
-    }
+    return std::max(averageEntry(m_log, m_size), averageEntry(m_gpuLog, m_size));
+}
 
-    return result / m_log.count();
+std::chrono::nanoseconds RenderJournal::percentile(int percentile) const
+{
+    return std::max(percentileEntry(m_log, percentile), percentileEntry(m_gpuLog, percentile));
 }
 
 } // namespace KWin
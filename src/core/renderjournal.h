@@ -17,6 +17,11 @@ namespace KWin
 /**
  * The RenderJournal class measures how long it takes to render frames and estimates how
  * long it will take to render the next frame.
+ *
+ * The journal keeps two logs. The CPU log contains the time spent between beginFrame() and
+ * endFrame(). The GPU log contains the time it took the GPU to finish rendering, measured from
+ * beginFrame(), if the render backend is able to provide such measurements. If both logs are
+ * available, the estimates are based on whichever is the bottleneck.
  */
 class KWIN_EXPORT RenderJournal
 {
@@ -33,6 +38,18 @@ public:
      */
     void endFrame();
 
+    /**
+     * Returns the time spent between beginFrame() and endFrame() for the most recent frame.
+     */
+    std::chrono::nanoseconds latest() const;
+
+    /**
+     * Adds a GPU measurement for a previously rendered frame. The @a duration is the time
+     * between beginFrame() and the moment when the GPU had finished executing the rendering
+     * commands. GPU measurements are usually available only a frame or two later.
+     */
+    void addGpuTime(std::chrono::nanoseconds duration);
+
     /**
      * Returns the maximum estimated amount of time that it takes to render a single frame.
      */
@@ -48,10 +65,23 @@ public:
      */
     std::chrono::nanoseconds average() const;
 
+    /**
+     * Returns the estimated amount of time that is not exceeded by @a percentile percent
+     * of frames. Unlike other estimates, the percentile is computed over a longer window.
+     */
+    std::chrono::nanoseconds percentile(int percentile) const;
+
+    /**
+     * Returns @c true if the journal has received GPU measurements.
+     */
+    bool hasGpuTimes() const;
+
 private:
     QElapsedTimer m_timer;
     QQueue<std::chrono::nanoseconds> m_log;
+    QQueue<std::chrono::nanoseconds> m_gpuLog;
     int m_size = 15;
+    int m_longSize = 240;
 };
 
 } // namespace KWin
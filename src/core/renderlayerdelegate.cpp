@@ -29,6 +29,11 @@ QRegion RenderLayerDelegate::repaints() const
     return QRegion();
 }
 
+QRegion RenderLayerDelegate::opaque() const
+{
+    return QRegion();
+}
+
 void RenderLayerDelegate::prePaint()
 {
 }
@@ -37,7 +42,13 @@ void RenderLayerDelegate::postPaint()
 {
 }
 
-SurfaceItem *RenderLayerDelegate::scanoutCandidate() const
+SurfaceItem *RenderLayerDelegate::scanoutCandidate(ScanoutRefusal *refusal) const
+{
+    *refusal = ScanoutRefusal::NoCandidate;
+    return nullptr;
+}
+
+SurfaceItem *RenderLayerDelegate::overlayCandidate() const
 {
     return nullptr;
 }
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "core/framestatistics.h"
 #include "kwin_export.h"
 
 #include <QObject>
@@ -36,6 +37,13 @@ public:
      */
     virtual QRegion repaints() const;
 
+    /**
+     * Returns the region of the render layer that is guaranteed to be fully opaque, in the
+     * layer-local coordinates. The compositor uses it to skip repainting render layers that
+     * are occluded by their sublayers. The default implementation returns an empty region.
+     */
+    virtual QRegion opaque() const;
+
     /**
      * This function is called by the compositor before starting compositing. Reimplement
      * this function to do frame initialization.
@@ -50,9 +58,15 @@ public:
 
     /**
      * Returns the direct scanout candidate hint. It can be used to avoid compositing the
-     * render layer.
+     * render layer. If there's none, @a refusal is set to the reason.
+     */
+    virtual SurfaceItem *scanoutCandidate(ScanoutRefusal *refusal) const;
+
+    /**
+     * Returns a surface that is painted on top of everything else in the render layer
+     * and can be presented on an overlay plane instead of being composited.
      */
-    virtual SurfaceItem *scanoutCandidate() const;
+    virtual SurfaceItem *overlayCandidate() const;
 
     /**
      * This function is called when the compositor wants the render layer delegate
@@ -6,8 +6,11 @@
 
 #include "renderloop.h"
 #include "renderloop_p.h"
+#include "ftrace.h"
+#include "idlepowermode.h"
 #include "surfaceitem.h"
 #include "utils/common.h"
+#include "wayland/presentationtime_interface.h"
 
 namespace KWin
 {
@@ -23,21 +26,43 @@ RenderLoopPrivate *RenderLoopPrivate::get(RenderLoop *loop)
     return loop->d.get();
 }
 
+RenderLoopPrivate::PendingFrame::PendingFrame() = default;
+RenderLoopPrivate::PendingFrame::PendingFrame(PendingFrame &&other) = default;
+RenderLoopPrivate::PendingFrame::~PendingFrame() = default;
+
 RenderLoopPrivate::RenderLoopPrivate(RenderLoop *q)
     : q(q)
 {
     compositeTimer.setSingleShot(true);
+    // Coarse timers may be coalesced with the timers of other render loops, which makes
+    // outputs with different refresh rates wake up together and wait for each other.
+    compositeTimer.setTimerType(Qt::PreciseTimer);
     QObject::connect(&compositeTimer, &QTimer::timeout, q, [this]() {
         dispatch();
     });
 }
 
-void RenderLoopPrivate::scheduleRepaint()
+// The lowest refresh rate that adaptive sync is assumed to support if the panel doesn't
+// advertise its range.
+static const int s_defaultVrrMinimumRefreshRate = 40000;
+
+void RenderLoopPrivate::scheduleRepaint(bool deferred)
 {
-    if (kwinApp()->isTerminating() || compositeTimer.isActive()) {
+    if (kwinApp()->isTerminating()) {
+        return;
+    }
+    // A frame of the fullscreen client doesn't wait for a deferred repaint.
+    if (compositeTimer.isActive() && (deferred || !deferredRepaint)) {
         return;
     }
-    if (vrrPolicy == RenderLoop::VrrPolicy::Always || (vrrPolicy == RenderLoop::VrrPolicy::Automatic && fullscreenItem != nullptr)) {
+    deferredRepaint = deferred;
+    // leave the idle mode before the composite timer is armed, it mustn't get the idle timer slack
+    if (IdlePowerMode *idlePowerMode = IdlePowerMode::self()) {
+        idlePowerMode->markBusy();
+    }
+    if (fullscreenItem != nullptr && fullscreenItemAllowsTearing) {
+        presentMode = SyncMode::Async;
+    } else if (vrrPolicy == RenderLoop::VrrPolicy::Always || (vrrPolicy == RenderLoop::VrrPolicy::Automatic && fullscreenItem != nullptr)) {
         presentMode = SyncMode::Adaptive;
     } else {
         presentMode = SyncMode::Fixed;
@@ -45,33 +70,44 @@ void RenderLoopPrivate::scheduleRepaint()
     const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
     const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
 
-    // Estimate when the next presentation will occur. Note that this is a prediction.
-    nextPresentationTimestamp = lastPresentationTimestamp + vblankInterval;
-    if (nextPresentationTimestamp < currentTime && presentMode == SyncMode::Fixed) {
-        nextPresentationTimestamp = lastPresentationTimestamp
-            + alignTimestamp(currentTime - lastPresentationTimestamp, vblankInterval);
+    // With triple buffering, a frame may still be waiting to be presented, the next one can
+    // only be presented at a later vblank.
+    std::chrono::nanoseconds previousPresentationTimestamp = lastPresentationTimestamp;
+    if (!pendingFrames.empty()) {
+        previousPresentationTimestamp = std::max(previousPresentationTimestamp, pendingFrames.back().predictedPresentationTimestamp);
     }
 
-    // Estimate when it's a good time to perform the next compositing cycle.
-    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+    // There is no vblank to wait for, the frame will be shown as soon as it's been rendered.
+    if (presentMode == SyncMode::Async) {
+        nextPresentationTimestamp = std::max(currentTime, previousPresentationTimestamp) + renderJournal.latest();
+        compositeTimer.start(0);
+        return;
+    }
 
-    std::chrono::nanoseconds renderTime;
-    switch (q->latencyPolicy()) {
-    case LatencyExtremelyLow:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.1));
-        break;
-    case LatencyLow:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.25));
-        break;
-    case LatencyMedium:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.5));
-        break;
-    case LatencyHigh:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.75));
-        break;
-    case LatencyExtremelyHigh:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.9));
-        break;
+    // Estimate when it's a good time to perform the next compositing cycle.
+    std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+
+    // With adaptive sync, the frame is composited as soon as the client has committed it and
+    // the panel can show it, so only the time that rendering actually takes matters.
+    std::chrono::nanoseconds renderTime = std::chrono::nanoseconds::zero();
+    if (presentMode == SyncMode::Fixed) {
+        switch (q->latencyPolicy()) {
+        case LatencyExtremelyLow:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.1));
+            break;
+        case LatencyLow:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.25));
+            break;
+        case LatencyMedium:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.5));
+            break;
+        case LatencyHigh:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.75));
+            break;
+        case LatencyExtremelyHigh:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.9));
+            break;
+        }
     }
 
     switch (options->renderTimeEstimator()) {
@@ -84,6 +120,45 @@ void RenderLoopPrivate::scheduleRepaint()
     case RenderTimeEstimatorAverage:
         renderTime = std::max(renderTime, renderJournal.average());
         break;
+    case RenderTimeEstimatorPercentile90:
+        renderTime = std::max(renderTime, renderJournal.percentile(90));
+        break;
+    case RenderTimeEstimatorPercentile99:
+        renderTime = std::max(renderTime, renderJournal.percentile(99));
+        break;
+    }
+
+    // If the GPU reports when it has actually finished rendering, the percentile estimates
+    // already include the tail of the render time distribution, so a smaller margin suffices.
+    if (renderJournal.hasGpuTimes()) {
+        switch (options->renderTimeEstimator()) {
+        case RenderTimeEstimatorPercentile90:
+        case RenderTimeEstimatorPercentile99:
+            safetyMargin = std::chrono::milliseconds(1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Estimate when the next presentation will occur. Note that this is a prediction.
+    if (presentMode == SyncMode::Fixed) {
+        nextPresentationTimestamp = previousPresentationTimestamp + vblankInterval;
+        if (nextPresentationTimestamp < currentTime) {
+            nextPresentationTimestamp = previousPresentationTimestamp
+                + alignTimestamp(currentTime - previousPresentationTimestamp, vblankInterval);
+        }
+    } else {
+        // The panel can't refresh sooner than a vblank interval after the previous frame, but
+        // a frame that's late is shown as soon as it's ready. A deferred repaint waits for the
+        // client until the panel needs a new frame.
+        if (deferredRepaint) {
+            const std::chrono::nanoseconds repeatInterval = frameRepeatInterval(currentTime);
+            nextPresentationTimestamp = previousPresentationTimestamp + (repeatInterval.count() ? repeatInterval : maximumFrameInterval());
+        } else {
+            nextPresentationTimestamp = previousPresentationTimestamp + vblankInterval;
+        }
+        nextPresentationTimestamp = std::max(nextPresentationTimestamp, currentTime + renderTime + safetyMargin);
     }
 
     std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
@@ -97,17 +172,96 @@ void RenderLoopPrivate::scheduleRepaint()
     compositeTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
 }
 
-void RenderLoopPrivate::delayScheduleRepaint()
+int RenderLoopPrivate::maxPendingFrameCount() const
 {
+    return tripleBuffering ? 2 : 1;
+}
+
+void RenderLoopPrivate::updateTripleBuffering()
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_DISABLE_TRIPLE_BUFFERING") != 0;
+    if (disabled || !tripleBufferingSupported || presentMode != SyncMode::Fixed || !renderJournal.hasGpuTimes()) {
+        tripleBuffering = false;
+        return;
+    }
+
+    // If rendering can't keep up with the refresh rate, every other vblank is missed. Starting
+    // the next frame while the previous one waits for the vblank pipelines rendering with the
+    // scanout, at the cost of a frame of latency, so it's only done while all recent frames
+    // have been slow, and stopped once none of them has been.
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    if (!tripleBuffering && renderJournal.minimum() > vblankInterval * 3 / 4) {
+        tripleBuffering = true;
+    } else if (tripleBuffering && renderJournal.maximum() < vblankInterval / 2) {
+        tripleBuffering = false;
+    }
+}
+
+void RenderLoopPrivate::delayScheduleRepaint(bool deferred)
+{
+    // the delayed repaint may only wait for the client if none of the requests for it need it sooner
+    deferredReschedule = pendingReschedule ? deferredReschedule && deferred : deferred;
     pendingReschedule = true;
 }
 
 void RenderLoopPrivate::maybeScheduleRepaint()
 {
     if (pendingReschedule) {
-        scheduleRepaint();
+        scheduleRepaint(deferredReschedule);
         pendingReschedule = false;
+        deferredReschedule = false;
+    }
+}
+
+void RenderLoopPrivate::scheduleCursorRepaint()
+{
+    if (pendingRepaint) {
+        return;
+    }
+    // Committing the cursor on its own refreshes the panel right away with adaptive sync,
+    // which throws off the cadence of the fullscreen client.
+    const bool deferred = presentMode == SyncMode::Adaptive && fullscreenItem != nullptr;
+    if (pendingFrameCount < maxPendingFrameCount() && !inhibitCount) {
+        scheduleRepaint(deferred);
+    } else {
+        delayScheduleRepaint(deferred);
+    }
+}
+
+void RenderLoopPrivate::notifyClientCommit(std::chrono::nanoseconds timestamp)
+{
+    if (lastClientCommitTimestamp != std::chrono::nanoseconds::zero()) {
+        const std::chrono::nanoseconds interval = timestamp - lastClientCommitTimestamp;
+        if (interval > std::chrono::seconds(1)) {
+            // the client has been idle, its frame rate is unknown again
+            clientFrameInterval = std::chrono::nanoseconds::zero();
+        } else if (clientFrameInterval == std::chrono::nanoseconds::zero()) {
+            clientFrameInterval = interval;
+        } else {
+            clientFrameInterval = (clientFrameInterval * 3 + interval) / 4;
+        }
+    }
+    lastClientCommitTimestamp = timestamp;
+}
+
+std::chrono::nanoseconds RenderLoopPrivate::maximumFrameInterval() const
+{
+    const int minimumRefreshRate = vrrMinimumRefreshRate > 0 ? vrrMinimumRefreshRate : s_defaultVrrMinimumRefreshRate;
+    return std::chrono::nanoseconds(1'000'000'000'000ull / std::min(minimumRefreshRate, refreshRate));
+}
+
+std::chrono::nanoseconds RenderLoopPrivate::frameRepeatInterval(std::chrono::nanoseconds currentTime) const
+{
+    const std::chrono::nanoseconds maximumInterval = maximumFrameInterval();
+    if (clientFrameInterval <= maximumInterval || currentTime - lastClientCommitTimestamp > clientFrameInterval * 4) {
+        return std::chrono::nanoseconds::zero();
     }
+    // Low framerate compensation: the frames of the client are shown a whole number of times,
+    // evenly spaced, so that the panel is ready for the next one when it arrives.
+    const auto repeatCount = (clientFrameInterval + maximumInterval - std::chrono::nanoseconds(1)) / maximumInterval;
+    const std::chrono::nanoseconds repeatInterval = clientFrameInterval / repeatCount;
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    return repeatInterval >= vblankInterval ? repeatInterval : std::chrono::nanoseconds::zero();
 }
 
 void RenderLoopPrivate::notifyFrameFailed()
@@ -115,6 +269,18 @@ void RenderLoopPrivate::notifyFrameFailed()
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
 
+    frameStatistics.addFailedFrame();
+
+    if (!pendingFrames.empty()) {
+        // The presentation feedbacks of the frame are discarded when they're destroyed.
+        const PendingFrame frame = std::move(pendingFrames.front());
+        pendingFrames.pop_front();
+        for (quint32 surfaceContext : frame.surfaceTraceContexts) {
+            fTraceEnd(surfaceContext, "Surface presented frame=", frame.traceContext, " failed=1");
+        }
+        fTraceEnd(frame.traceContext, "Frame failed");
+    }
+
     if (!inhibitCount) {
         maybeScheduleRepaint();
     }
@@ -135,8 +301,55 @@ void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
         lastPresentationTimestamp = std::chrono::steady_clock::now().time_since_epoch();
     }
 
+    if (!pendingFrames.empty()) {
+        const PendingFrame frame = std::move(pendingFrames.front());
+        pendingFrames.pop_front();
+
+        const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+        frameStatistics.addPresentedFrame(frame.predictedPresentationTimestamp, lastPresentationTimestamp, vblankInterval);
+
+        KWaylandServer::PresentationFeedback::Kinds kinds;
+        if (frame.presentMode != SyncMode::Async) {
+            kinds |= KWaylandServer::PresentationFeedback::Kind::Vsync;
+        }
+        if (hardwarePresentation) {
+            kinds |= KWaylandServer::PresentationFeedback::Kind::HwClock | KWaylandServer::PresentationFeedback::Kind::HwCompletion;
+        }
+        // The refresh interval is not constant with adaptive sync, in which case it must be zero.
+        const std::chrono::nanoseconds refreshInterval = frame.presentMode == SyncMode::Fixed ? vblankInterval : std::chrono::nanoseconds::zero();
+        for (const auto &feedback : frame.presentationFeedbacks) {
+            feedback->presented(lastPresentationTimestamp, refreshInterval, 0, kinds);
+        }
+        for (const auto &feedback : frame.zeroCopyPresentationFeedbacks) {
+            feedback->presented(lastPresentationTimestamp, refreshInterval, 0, kinds | KWaylandServer::PresentationFeedback::Kind::ZeroCopy);
+        }
+
+        for (quint32 surfaceContext : frame.surfaceTraceContexts) {
+            fTraceEnd(surfaceContext, "Surface presented frame=", frame.traceContext);
+        }
+        for (std::chrono::microseconds inputTimestamp : frame.inputTimestamps) {
+            const std::chrono::nanoseconds latency = lastPresentationTimestamp - inputTimestamp;
+            if (latency < std::chrono::nanoseconds::zero()) {
+                // not the same clock, e.g. with a virtual input device
+                continue;
+            }
+            frameStatistics.addInputLatency(latency);
+            fTrace("Input latency frame=", frame.traceContext, " latency=", std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        }
+        fTraceEnd(frame.traceContext, "Frame presented timestamp=", timestamp.count());
+    }
+
+    updateTripleBuffering();
+
     if (!inhibitCount) {
         maybeScheduleRepaint();
+        // Below the adaptive sync range, the panel would refresh on its own at some point and
+        // the next frame of the client would have to wait for that, repeat the frame instead.
+        if (presentMode == SyncMode::Adaptive && fullscreenItem != nullptr && !compositeTimer.isActive()
+            && !pendingReschedule && pendingFrameCount < maxPendingFrameCount()
+            && frameRepeatInterval(timestamp) != std::chrono::nanoseconds::zero()) {
+            scheduleRepaint(true);
+        }
     }
 
     Q_EMIT q->framePresented(q, timestamp);
@@ -147,6 +360,7 @@ void RenderLoopPrivate::dispatch()
     // On X11, we want to ignore repaints that are scheduled by windows right before
     // the Compositor starts repainting.
     pendingRepaint = true;
+    deferredRepaint = false;
 
     Q_EMIT q->frameRequested(q);
 
@@ -158,7 +372,10 @@ void RenderLoopPrivate::dispatch()
 void RenderLoopPrivate::invalidate()
 {
     pendingReschedule = false;
+    deferredRepaint = false;
+    deferredReschedule = false;
     pendingFrameCount = 0;
+    pendingFrames.clear();
     compositeTimer.stop();
 }
 
@@ -193,13 +410,20 @@ void RenderLoop::uninhibit()
 void RenderLoop::beginFrame()
 {
     d->pendingRepaint = false;
+    d->clientCommitPending = false;
     d->pendingFrameCount++;
+    RenderLoopPrivate::PendingFrame frame;
+    frame.predictedPresentationTimestamp = d->nextPresentationTimestamp;
+    frame.traceContext = FTraceLogger::nextContext();
+    frame.presentMode = d->presentMode;
+    d->pendingFrames.push_back(std::move(frame));
     d->renderJournal.beginFrame();
 }
 
 void RenderLoop::endFrame()
 {
     d->renderJournal.endFrame();
+    d->frameStatistics.addRenderTime(d->renderJournal.latest());
 }
 
 int RenderLoop::refreshRate() const
@@ -221,7 +445,11 @@ void RenderLoop::scheduleRepaint(Item *item)
     if (d->pendingRepaint || (d->fullscreenItem != nullptr && item != nullptr && item != d->fullscreenItem)) {
         return;
     }
-    if (!d->pendingFrameCount && !d->inhibitCount) {
+    if (item != nullptr && item == d->fullscreenItem && !d->clientCommitPending) {
+        d->clientCommitPending = true;
+        d->notifyClientCommit(std::chrono::steady_clock::now().time_since_epoch());
+    }
+    if (d->pendingFrameCount < d->maxPendingFrameCount() && !d->inhibitCount) {
         d->scheduleRepaint();
     } else {
         d->delayScheduleRepaint();
@@ -255,6 +483,10 @@ std::chrono::nanoseconds RenderLoop::nextPresentationTimestamp() const
 
 void RenderLoop::setFullscreenSurface(Item *surfaceItem)
 {
+    if (d->fullscreenItem != surfaceItem) {
+        d->lastClientCommitTimestamp = std::chrono::nanoseconds::zero();
+        d->clientFrameInterval = std::chrono::nanoseconds::zero();
+    }
     d->fullscreenItem = surfaceItem;
 }
 
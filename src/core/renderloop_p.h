@@ -6,12 +6,22 @@
 
 #pragma once
 
+#include "framestatistics.h"
 #include "renderjournal.h"
 #include "renderloop.h"
 
 #include <QTimer>
+#include <QVector>
 
+#include <deque>
+#include <memory>
 #include <optional>
+#include <vector>
+
+namespace KWaylandServer
+{
+class PresentationFeedback;
+}
 
 namespace KWin
 {
@@ -25,19 +35,89 @@ public:
     void dispatch();
     void invalidate();
 
-    void delayScheduleRepaint();
-    void scheduleRepaint();
+    void delayScheduleRepaint(bool deferred = false);
+    void scheduleRepaint(bool deferred = false);
     void maybeScheduleRepaint();
 
+    /**
+     * Schedules a repaint that only updates the cursor plane. With adaptive sync, it waits for
+     * the next frame of the fullscreen item, or until the panel needs a new frame.
+     */
+    void scheduleCursorRepaint();
+
+    /**
+     * Notes that the fullscreen item has asked for a repaint at @a timestamp, which is how
+     * the frame rate of the fullscreen client is estimated.
+     */
+    void notifyClientCommit(std::chrono::nanoseconds timestamp);
+
+    /**
+     * Returns the longest time a frame can be shown with adaptive sync before the panel
+     * refreshes on its own.
+     */
+    std::chrono::nanoseconds maximumFrameInterval() const;
+
+    /**
+     * Returns the interval at which frames are repeated while the fullscreen client renders
+     * below the adaptive sync range of the panel, or zero if they don't need to be.
+     */
+    std::chrono::nanoseconds frameRepeatInterval(std::chrono::nanoseconds currentTime) const;
+
     void notifyFrameFailed();
     void notifyFrameCompleted(std::chrono::nanoseconds timestamp);
 
+    /**
+     * Returns the number of frames that may be rendered before the oldest of them has been
+     * presented.
+     */
+    int maxPendingFrameCount() const;
+
+    /**
+     * Enables triple buffering if the recent frames took too long to be rendered within a
+     * vblank interval, and disables it once they don't anymore.
+     */
+    void updateTripleBuffering();
+
+    enum class SyncMode {
+        Fixed,
+        Adaptive,
+        /**
+         * The frame is presented as soon as it's ready, without waiting for the vblank.
+         */
+        Async,
+    };
+
+    /**
+     * A frame that has been submitted but not presented yet, along with the presentation
+     * feedback and the ftrace contexts of the surface commits it shows.
+     */
+    struct PendingFrame
+    {
+        PendingFrame();
+        PendingFrame(PendingFrame &&other);
+        ~PendingFrame();
+
+        std::chrono::nanoseconds predictedPresentationTimestamp = std::chrono::nanoseconds::zero();
+        quint32 traceContext = 0;
+        QVector<quint32> surfaceTraceContexts;
+        // kernel timestamps of the input events that the commits shown by the frame react to
+        QVector<std::chrono::microseconds> inputTimestamps;
+        std::vector<std::unique_ptr<KWaylandServer::PresentationFeedback>> presentationFeedbacks;
+        std::vector<std::unique_ptr<KWaylandServer::PresentationFeedback>> zeroCopyPresentationFeedbacks;
+        bool directScanout = false;
+        SyncMode presentMode = SyncMode::Fixed;
+    };
+
     RenderLoop *q;
     std::chrono::nanoseconds lastPresentationTimestamp = std::chrono::nanoseconds::zero();
     std::chrono::nanoseconds nextPresentationTimestamp = std::chrono::nanoseconds::zero();
     QTimer compositeTimer;
     RenderJournal renderJournal;
+    FrameStatistics frameStatistics;
+    std::deque<PendingFrame> pendingFrames;
     int refreshRate = 60000;
+    // Whether the presentation timestamps are provided by the hardware, e.g. page flip events.
+    bool hardwarePresentation = false;
     int pendingFrameCount = 0;
     int inhibitCount = 0;
     bool pendingReschedule = false;
@@ -45,12 +125,24 @@ public:
     RenderLoop::VrrPolicy vrrPolicy = RenderLoop::VrrPolicy::Never;
     std::optional<LatencyPolicy> latencyPolicy;
     Item *fullscreenItem = nullptr;
-
-    enum class SyncMode {
-        Fixed,
-        Adaptive,
-    };
+    // Whether the fullscreen item asked to be presented without waiting for the vblank.
+    bool fullscreenItemAllowsTearing = false;
     SyncMode presentMode = SyncMode::Fixed;
+    // Whether the output can hold a frame back until the previous one has been presented.
+    bool tripleBufferingSupported = false;
+    // Whether the next frame is rendered while the previous one is waiting for the vblank.
+    bool tripleBuffering = false;
+    // The lowest refresh rate of the adaptive sync range, in millihertz, 0 if it's unknown.
+    int vrrMinimumRefreshRate = 0;
+    // Whether the scheduled repaint, respectively the delayed one, may wait for the next
+    // frame of the fullscreen item.
+    bool deferredRepaint = false;
+    bool deferredReschedule = false;
+    // Whether the fullscreen item has asked for a repaint since the last frame.
+    bool clientCommitPending = false;
+    std::chrono::nanoseconds lastClientCommitTimestamp = std::chrono::nanoseconds::zero();
+    // The average interval between the frames of the fullscreen client, zero if unknown.
+    std::chrono::nanoseconds clientFrameInterval = std::chrono::nanoseconds::zero();
 };
 
 } // namespace KWin
@@ -0,0 +1,119 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "syncobjtimeline.h"
+#include "utils/common.h"
+
+#include <cerrno>
+#include <cstring>
+#include <linux/sync_file.h>
+#include <sys/ioctl.h>
+#include <xf86drm.h>
+
+namespace KWin
+{
+
+SyncReleasePoint::SyncReleasePoint(const std::shared_ptr<SyncTimeline> &timeline, uint64_t timelinePoint)
+    : m_timeline(timeline)
+    , m_timelinePoint(timelinePoint)
+{
+}
+
+SyncReleasePoint::~SyncReleasePoint()
+{
+    if (m_releaseFence.isValid()) {
+        m_timeline->moveInto(m_timelinePoint, m_releaseFence);
+    } else {
+        m_timeline->signal(m_timelinePoint);
+    }
+}
+
+SyncTimeline *SyncReleasePoint::timeline() const
+{
+    return m_timeline.get();
+}
+
+uint64_t SyncReleasePoint::timelinePoint() const
+{
+    return m_timelinePoint;
+}
+
+void SyncReleasePoint::addReleaseFence(const FileDescriptor &fence)
+{
+    if (!fence.isValid()) {
+        return;
+    }
+    if (!m_releaseFence.isValid()) {
+        m_releaseFence = fence.duplicate();
+        return;
+    }
+
+    sync_merge_data data = {};
+    qstrncpy(data.name, "kwin release fence", sizeof(data.name));
+    data.fd2 = fence.get();
+    if (ioctl(m_releaseFence.get(), SYNC_IOC_MERGE, &data) == 0) {
+        m_releaseFence = FileDescriptor(data.fence);
+    } else {
+        qCWarning(KWIN_CORE) << "Failed to merge release fences:" << strerror(errno);
+    }
+}
+
+SyncTimeline::SyncTimeline(int drmFd, uint32_t handle)
+    : m_drmFd(drmFd)
+    , m_handle(handle)
+{
+}
+
+SyncTimeline::~SyncTimeline()
+{
+    drmSyncobjDestroy(m_drmFd, m_handle);
+}
+
+FileDescriptor SyncTimeline::exportSyncFile(uint64_t timelinePoint) const
+{
+    // Sync files can only be exported from binary syncobjs, transfer the fence to one first.
+    uint32_t binaryHandle = 0;
+    if (drmSyncobjCreate(m_drmFd, 0, &binaryHandle) != 0) {
+        qCWarning(KWIN_CORE) << "Failed to create a syncobj:" << strerror(errno);
+        return FileDescriptor{};
+    }
+
+    FileDescriptor fence;
+    if (drmSyncobjTransfer(m_drmFd, binaryHandle, 0, m_handle, timelinePoint, 0) == 0) {
+        int fd = -1;
+        if (drmSyncobjExportSyncFile(m_drmFd, binaryHandle, &fd) == 0) {
+            fence = FileDescriptor(fd);
+        }
+    }
+    drmSyncobjDestroy(m_drmFd, binaryHandle);
+    return fence;
+}
+
+void SyncTimeline::signal(uint64_t timelinePoint)
+{
+    if (drmSyncobjTimelineSignal(m_drmFd, &m_handle, &timelinePoint, 1) != 0) {
+        qCWarning(KWIN_CORE) << "Failed to signal a timeline point:" << strerror(errno);
+    }
+}
+
+void SyncTimeline::moveInto(uint64_t timelinePoint, const FileDescriptor &fence)
+{
+    uint32_t binaryHandle = 0;
+    if (drmSyncobjCreate(m_drmFd, 0, &binaryHandle) != 0) {
+        qCWarning(KWIN_CORE) << "Failed to create a syncobj:" << strerror(errno);
+        signal(timelinePoint);
+        return;
+    }
+    if (drmSyncobjImportSyncFile(m_drmFd, binaryHandle, fence.get()) != 0
+        || drmSyncobjTransfer(m_drmFd, m_handle, timelinePoint, binaryHandle, 0, 0) != 0) {
+        qCWarning(KWIN_CORE) << "Failed to attach a fence to a timeline point:" << strerror(errno);
+        // Don't leave the client waiting for a buffer that will never be released.
+        signal(timelinePoint);
+    }
+    drmSyncobjDestroy(m_drmFd, binaryHandle);
+}
+
+} // namespace KWin
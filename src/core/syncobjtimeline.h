@@ -0,0 +1,82 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+#include "utils/filedescriptor.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace KWin
+{
+
+class SyncTimeline;
+
+/**
+ * The SyncReleasePoint class represents a point on a DRM syncobj timeline that is signaled
+ * once the compositor is done with a buffer, i.e. when the last reference to the release
+ * point is dropped.
+ *
+ * If the GPU may still be reading the buffer at that time, the corresponding fences have
+ * to be added with addReleaseFence(), the timeline point is then signaled by the kernel
+ * after all of them have been signaled.
+ */
+class KWIN_EXPORT SyncReleasePoint
+{
+public:
+    SyncReleasePoint(const std::shared_ptr<SyncTimeline> &timeline, uint64_t timelinePoint);
+    ~SyncReleasePoint();
+
+    SyncTimeline *timeline() const;
+    uint64_t timelinePoint() const;
+
+    /**
+     * Adds the sync file @a fence to the fences that must be signaled before the release point.
+     */
+    void addReleaseFence(const FileDescriptor &fence);
+
+private:
+    const std::shared_ptr<SyncTimeline> m_timeline;
+    const uint64_t m_timelinePoint;
+    FileDescriptor m_releaseFence;
+};
+
+/**
+ * The SyncTimeline class wraps a DRM syncobj timeline that has been imported from a client.
+ */
+class KWIN_EXPORT SyncTimeline
+{
+public:
+    /**
+     * Takes the ownership of the syncobj @a handle on the DRM device @a drmFd.
+     */
+    SyncTimeline(int drmFd, uint32_t handle);
+    ~SyncTimeline();
+
+    /**
+     * Exports the fence at @a timelinePoint as a sync file. Returns an invalid file descriptor
+     * if no work has been submitted for the timeline point yet.
+     */
+    FileDescriptor exportSyncFile(uint64_t timelinePoint) const;
+
+    /**
+     * Signals @a timelinePoint immediately.
+     */
+    void signal(uint64_t timelinePoint);
+
+    /**
+     * Makes @a timelinePoint signaled when the sync file @a fence is signaled.
+     */
+    void moveInto(uint64_t timelinePoint, const FileDescriptor &fence);
+
+private:
+    const int m_drmFd;
+    const uint32_t m_handle;
+};
+
+} // namespace KWin
@@ -8,6 +8,7 @@
 #include "core/renderlayer.h"
 #include "core/rendertarget.h"
 #include "cursor.h"
+#include "cursortexturecache.h"
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 
@@ -35,8 +36,7 @@ void CursorDelegateOpenGL::paint(RenderTarget *renderTarget, const QRegion &regi
             m_cursorTextureDirty = false;
             return;
         }
-        m_cursorTexture.reset(new GLTexture(img));
-        m_cursorTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_cursorTexture = CursorTextureCache::self()->texture(img);
         m_cursorTextureDirty = false;
     };
 
@@ -49,13 +49,7 @@ void CursorDelegateOpenGL::paint(RenderTarget *renderTarget, const QRegion &regi
             m_cursorTextureDirty = true;
         });
     } else if (m_cursorTextureDirty) {
-        const QImage image = Cursors::self()->currentCursor()->image();
-        if (image.size() == m_cursorTexture->size()) {
-            m_cursorTexture->update(image);
-            m_cursorTextureDirty = false;
-        } else {
-            allocateTexture();
-        }
+        allocateTexture();
     }
 
     const QRect cursorRect = layer()->mapToGlobal(layer()->rect());
@@ -66,15 +60,15 @@ void CursorDelegateOpenGL::paint(RenderTarget *renderTarget, const QRegion &regi
 
     // Don't need to call GLVertexBuffer::beginFrame() and GLVertexBuffer::endOfFrame() because
     // the GLVertexBuffer::streamingBuffer() is not being used when painting cursor.
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     m_cursorTexture->bind();
     ShaderBinder binder(ShaderTrait::MapTexture);
     binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
     m_cursorTexture->render(region, QRect(0, 0, cursorRect.width(), cursorRect.height()));
     m_cursorTexture->unbind();
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
 }
 
 } // namespace KWin
@@ -25,7 +25,7 @@ public:
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
 
 private:
-    std::unique_ptr<GLTexture> m_cursorTexture;
+    std::shared_ptr<GLTexture> m_cursorTexture;
     bool m_cursorTextureDirty = false;
 };
 
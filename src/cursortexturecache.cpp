@@ -0,0 +1,70 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "cursortexturecache.h"
+#include "kwingltexture.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static const size_t s_maximumEntryCount = 16;
+
+CursorTextureCache *CursorTextureCache::s_self = nullptr;
+
+CursorTextureCache::CursorTextureCache()
+{
+    Q_ASSERT(!s_self);
+    s_self = this;
+}
+
+CursorTextureCache::~CursorTextureCache()
+{
+    s_self = nullptr;
+}
+
+CursorTextureCache *CursorTextureCache::self()
+{
+    return s_self;
+}
+
+std::shared_ptr<GLTexture> CursorTextureCache::texture(const QImage &image)
+{
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [&image](const Entry &entry) {
+        return entry.key == image.cacheKey();
+    });
+    if (it != m_entries.end()) {
+        std::rotate(m_entries.begin(), it, it + 1);
+        return m_entries.front().texture;
+    }
+
+    // Reuse the least recently used texture if it has the right size and nobody holds it.
+    std::shared_ptr<GLTexture> texture;
+    for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+        if (it->texture.use_count() == 1 && it->texture->size() == image.size()) {
+            texture = std::move(it->texture);
+            m_entries.erase(std::next(it).base());
+            texture->update(image);
+            break;
+        }
+    }
+    if (!texture) {
+        texture = std::make_shared<GLTexture>(image);
+        texture->setMemoryCategory(GLTexture::MemoryCategory::Cursor);
+        texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    }
+
+    m_entries.insert(m_entries.begin(), Entry{image.cacheKey(), texture});
+    if (m_entries.size() > s_maximumEntryCount) {
+        m_entries.pop_back();
+    }
+    return texture;
+}
+
+} // namespace KWin
@@ -0,0 +1,59 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QImage>
+
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The CursorTextureCache keeps the textures of the most recently shown cursor images.
+ *
+ * The cursor is painted by the software cursor, the cursor planes and embedded in screen
+ * casts. They share the cache, so an image is uploaded once no matter how many of them
+ * show it, and switching back to a cursor shape that has been shown recently doesn't
+ * upload it again. When a new image has to be uploaded, the least recently used texture
+ * of the same size that is not in use anymore is updated in place.
+ *
+ * The cache belongs to the OpenGL scene, the textures live in its context.
+ */
+class KWIN_EXPORT CursorTextureCache
+{
+public:
+    CursorTextureCache();
+    ~CursorTextureCache();
+
+    /**
+     * Returns the cache of the OpenGL scene, or @c null if compositing doesn't use OpenGL.
+     */
+    static CursorTextureCache *self();
+
+    /**
+     * Returns the texture with the contents of @a image. The returned texture must not be
+     * modified, it's shared with the other users of the cache.
+     */
+    std::shared_ptr<GLTexture> texture(const QImage &image);
+
+private:
+    struct Entry
+    {
+        qint64 key;
+        std::shared_ptr<GLTexture> texture;
+    };
+    // The most recently used entry comes first.
+    std::vector<Entry> m_entries;
+
+    static CursorTextureCache *s_self;
+};
+
+} // namespace KWin
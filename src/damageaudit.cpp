@@ -0,0 +1,139 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "damageaudit.h"
+#include "core/output.h"
+#include "utils/region.h"
+#include "window.h"
+#include "windowitem.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace KWin
+{
+
+KWIN_SINGLETON_FACTORY(DamageAudit)
+
+DamageAudit::DamageAudit(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DamageAudit::~DamageAudit()
+{
+    s_self = nullptr;
+}
+
+DamageAudit::Scope::Scope(const QString &source)
+{
+    DamageAudit *audit = DamageAudit::self();
+    if (!source.isNull() && audit && audit->isAuditing()) {
+        m_previousSource = std::exchange(audit->m_source, source);
+        m_active = true;
+    }
+}
+
+DamageAudit::Scope::~Scope()
+{
+    if (m_active) {
+        if (DamageAudit *audit = DamageAudit::self()) {
+            audit->m_source = m_previousSource;
+        }
+    }
+}
+
+void DamageAudit::start()
+{
+    m_damagers.clear();
+    m_start = std::chrono::steady_clock::now();
+    m_auditing = true;
+}
+
+void DamageAudit::stop()
+{
+    if (!m_auditing) {
+        return;
+    }
+    m_auditing = false;
+    m_end = std::chrono::steady_clock::now();
+    m_source.clear();
+}
+
+std::chrono::milliseconds DamageAudit::duration() const
+{
+    const auto end = m_auditing ? std::chrono::steady_clock::now() : m_end;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - m_start);
+}
+
+template<typename Rects>
+static quint64 areaOf(const Rects &rects)
+{
+    // The rectangles of a region don't overlap.
+    quint64 area = 0;
+    for (const QRect &rect : rects) {
+        area += quint64(rect.width()) * rect.height();
+    }
+    return area;
+}
+
+void DamageAudit::recordItem(const Item *item, Output *output, const Region &region)
+{
+    const Item *root = item;
+    while (root->parentItem()) {
+        root = root->parentItem();
+    }
+
+    Damager damager;
+    damager.output = output->name();
+    damager.source = QString::fromLatin1(item->metaObject()->className()).remove(QStringLiteral("KWin::"));
+    if (auto windowItem = qobject_cast<const WindowItem *>(root)) {
+        damager.client = QString::fromUtf8(windowItem->window()->resourceClass());
+        damager.pid = windowItem->window()->pid();
+    }
+
+    const QString key = damager.output + QLatin1Char('\n') + damager.source + QLatin1Char('\n') + damager.client + QLatin1Char('\n') + QString::number(damager.pid);
+    record(key, damager, areaOf(region));
+}
+
+void DamageAudit::recordScene(Output *output, const QRegion &region)
+{
+    Damager damager;
+    damager.output = output->name();
+    damager.source = m_source.isEmpty() ? QStringLiteral("scene") : m_source;
+
+    const QString key = damager.output + QLatin1Char('\n') + damager.source;
+    record(key, damager, areaOf(region));
+}
+
+void DamageAudit::record(const QString &key, const Damager &damager, quint64 pixels)
+{
+    auto it = m_damagers.find(key);
+    if (it == m_damagers.end()) {
+        it = m_damagers.insert(key, damager);
+    }
+    it->pixels += pixels;
+    it->repaints++;
+}
+
+QVector<DamageAudit::Damager> DamageAudit::topDamagers(int count) const
+{
+    QVector<Damager> damagers;
+    damagers.reserve(m_damagers.count());
+    for (const Damager &damager : m_damagers) {
+        damagers.append(damager);
+    }
+    std::sort(damagers.begin(), damagers.end(), [](const Damager &a, const Damager &b) {
+        return a.pixels > b.pixels;
+    });
+    if (count >= 0 && damagers.count() > count) {
+        damagers.resize(count);
+    }
+    return damagers;
+}
+
+} // namespace KWin
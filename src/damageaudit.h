@@ -0,0 +1,111 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+#include <chrono>
+
+namespace KWin
+{
+
+class Item;
+class Output;
+class Region;
+
+/**
+ * The DamageAudit class attributes the repaints of the outputs to what has scheduled them, to
+ * find out what keeps the outputs busy, e.g. a blinking caret that repaints a whole output.
+ *
+ * While the audit runs, the repaints scheduled by items are attributed to the item and its
+ * window, and the ones scheduled on the scene to the current source, e.g. the effect that is
+ * being painted. The audit only counts, the repaints themselves aren't affected.
+ */
+class KWIN_EXPORT DamageAudit : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~DamageAudit() override;
+
+    struct Damager
+    {
+        QString output;
+        /**
+         * What has scheduled the repaints, the class of the item or the effect.
+         */
+        QString source;
+        /**
+         * The resource class of the window of the item, empty if the item has no window.
+         */
+        QString client;
+        qint64 pid = 0;
+        quint64 pixels = 0;
+        quint64 repaints = 0;
+    };
+
+    /**
+     * Sets the source of the repaints that are scheduled on the scene until the scope ends.
+     * A null @a source leaves the current one.
+     */
+    class KWIN_EXPORT Scope
+    {
+    public:
+        explicit Scope(const QString &source);
+        ~Scope();
+
+    private:
+        QString m_previousSource;
+        bool m_active = false;
+    };
+
+    bool isAuditing() const
+    {
+        return m_auditing;
+    }
+    /**
+     * Starts attributing repaints, the previous counts are dropped.
+     */
+    void start();
+    void stop();
+    /**
+     * Returns for how long the current or last audit has been running.
+     */
+    std::chrono::milliseconds duration() const;
+
+    /**
+     * Records that @a item has scheduled a repaint of @a region on @a output.
+     */
+    void recordItem(const Item *item, Output *output, const Region &region);
+    /**
+     * Records that the current source has scheduled a repaint of @a region on @a output.
+     */
+    void recordScene(Output *output, const QRegion &region);
+
+    /**
+     * Returns the @a count damagers that have caused the most repainted pixels, most first.
+     */
+    QVector<Damager> topDamagers(int count) const;
+
+private:
+    void record(const QString &key, const Damager &damager, quint64 pixels);
+
+    QHash<QString, Damager> m_damagers;
+    QString m_source;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_end;
+    bool m_auditing = false;
+
+    KWIN_SINGLETON(DamageAudit)
+};
+
+} // namespace KWin
@@ -10,6 +10,7 @@
 // own
 #include "dbusinterface.h"
 #include "compositingadaptor.h"
+#include "framestatsadaptor.h"
 #include "pluginsadaptor.h"
 #include "virtualdesktopmanageradaptor.h"
 
@@ -19,15 +20,27 @@
 #include "core/output.h"
 #include "core/platform.h"
 #include "core/renderbackend.h"
+#include "core/renderloop_p.h"
+#include "damageaudit.h"
 #include "debug_console.h"
+#include "frametrace.h"
+#include "idlepowermode.h"
 #include "kwinadaptor.h"
 #include "main.h"
 #include "placement.h"
 #include "pluginmanager.h"
+#include "scenes/opengl/scene_opengl.h"
 #include "unmanaged.h"
+#include "utils/allocationtracker.h"
+#include "utils/damagesimplifier.h"
+#include "utils/iconcache.h"
 #include "virtualdesktops.h"
+#include "wayland/clientconnection.h"
+#include "wayland/display.h"
+#include "wayland_server.h"
 #include "window.h"
 #include "workspace.h"
+#include "xdgshellwindow.h"
 #if KWIN_BUILD_ACTIVITIES
 #include "activities.h"
 #endif
@@ -35,6 +48,8 @@
 // Qt
 #include <QOpenGLContext>
 
+#include <malloc.h>
+
 namespace KWin
 {
 
@@ -167,7 +182,7 @@ namespace
 {
 QVariantMap clientToVariantMap(const Window *c)
 {
-    return
+    QVariantMap map =
     {
         {QStringLiteral("resourceClass"), c->resourceClass()},
             {QStringLiteral("resourceName"), c->resourceName()},
@@ -197,6 +212,17 @@ QVariantMap clientToVariantMap(const Window *c)
             {QStringLiteral("activities"), c->activities()},
 #endif
     };
+    if (auto xdgWindow = qobject_cast<const XdgSurfaceWindow *>(c)) {
+        map.insert(QStringLiteral("initialConfigureLatency"), xdgWindow->initialConfigureLatency());
+        map.insert(QStringLiteral("firstCommitLatency"), xdgWindow->firstCommitLatency());
+        map.insert(QStringLiteral("mapLatency"), xdgWindow->mapLatency());
+        map.insert(QStringLiteral("firstFrameLatency"), xdgWindow->firstFrameLatency());
+    }
+    if (auto toplevel = qobject_cast<const XdgToplevelWindow *>(c)) {
+        map.insert(QStringLiteral("setupDuration"), toplevel->setupDuration());
+        map.insert(QStringLiteral("earlyInitialConfigure"), toplevel->earlyInitialConfigure());
+    }
+    return map;
 }
 }
 
@@ -522,6 +548,306 @@ void VirtualDesktopManagerDBusInterface::removeDesktop(const QString &id)
     m_manager->removeVirtualDesktop(id);
 }
 
+FrameStatsDBusInterface::FrameStatsDBusInterface(Compositor *parent)
+    : QObject(parent)
+{
+    new FrameStatsAdaptor(this);
+
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FrameStats"),
+                                                 QStringLiteral("org.kde.KWin.FrameStats"),
+                                                 this);
+}
+
+QStringList FrameStatsDBusInterface::outputs() const
+{
+    QStringList names;
+    const auto outputs = workspace()->outputs();
+    for (Output *output : outputs) {
+        names.append(output->name());
+    }
+    return names;
+}
+
+static qint64 toMicroseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+QVariantMap FrameStatsDBusInterface::Statistics(const QString &name) const
+{
+    const auto outputs = workspace()->outputs();
+    auto it = std::find_if(outputs.begin(), outputs.end(), [&name](Output *output) {
+        return output->name() == name;
+    });
+    if (it == outputs.end()) {
+        return QVariantMap();
+    }
+
+    const FrameStatistics &statistics = RenderLoopPrivate::get((*it)->renderLoop())->frameStatistics;
+
+    QVariantList histogram;
+    const auto buckets = statistics.renderTimeHistogram();
+    for (quint64 count : buckets) {
+        histogram.append(count);
+    }
+    QVariantList bounds;
+    const auto renderTimeBuckets = FrameStatistics::renderTimeBuckets();
+    for (std::chrono::nanoseconds bound : renderTimeBuckets) {
+        bounds.append(toMicroseconds(bound));
+    }
+
+    QVariantList inputLatencyHistogram;
+    const auto inputLatencies = statistics.inputLatencyHistogram();
+    for (quint64 count : inputLatencies) {
+        inputLatencyHistogram.append(count);
+    }
+    QVariantList inputLatencyBounds;
+    const auto inputLatencyBuckets = FrameStatistics::inputLatencyBuckets();
+    for (std::chrono::nanoseconds bound : inputLatencyBuckets) {
+        inputLatencyBounds.append(toMicroseconds(bound));
+    }
+
+    QVariantMap scanoutRefusals;
+    for (int i = 0; i < FrameStatistics::scanoutRefusalCount; ++i) {
+        const auto refusal = ScanoutRefusal(i);
+        scanoutRefusals.insert(FrameStatistics::scanoutRefusalName(refusal), statistics.scanoutRefusals(refusal));
+    }
+
+    return QVariantMap{
+        {QStringLiteral("presentedFrames"), statistics.presentedFrames()},
+        {QStringLiteral("missedFrames"), statistics.missedFrames()},
+        {QStringLiteral("failedFrames"), statistics.failedFrames()},
+        {QStringLiteral("directScanoutFrames"), statistics.directScanoutFrames()},
+        {QStringLiteral("scanoutRefusals"), scanoutRefusals},
+        {QStringLiteral("renderTimeHistogram"), histogram},
+        {QStringLiteral("renderTimeBuckets"), bounds},
+        {QStringLiteral("averagePredictionError"), toMicroseconds(statistics.averagePredictionError())},
+        {QStringLiteral("maximumPredictionError"), toMicroseconds(statistics.maximumPredictionError())},
+        {QStringLiteral("inputLatencyHistogram"), inputLatencyHistogram},
+        {QStringLiteral("inputLatencyBuckets"), inputLatencyBounds},
+        {QStringLiteral("maximumInputLatency"), toMicroseconds(statistics.maximumInputLatency())},
+    };
+}
+
+static void insertDamageStatistics(QVariantMap &map, const QString &prefix, const DamageSimplifier::Statistics &statistics)
+{
+    map.insert(prefix + QStringLiteral("Regions"), statistics.regions);
+    map.insert(prefix + QStringLiteral("SimplifiedRegions"), statistics.simplifiedRegions);
+    map.insert(prefix + QStringLiteral("InputRects"), statistics.inputRects);
+    map.insert(prefix + QStringLiteral("OutputRects"), statistics.outputRects);
+    map.insert(prefix + QStringLiteral("InputArea"), statistics.inputArea);
+    map.insert(prefix + QStringLiteral("OutputArea"), statistics.outputArea);
+}
+
+QVariantMap FrameStatsDBusInterface::DamageStatistics() const
+{
+    QVariantMap map;
+    insertDamageStatistics(map, QStringLiteral("surface"), DamageSimplifier::surfaceDamage()->statistics());
+    insertDamageStatistics(map, QStringLiteral("output"), DamageSimplifier::outputDamage()->statistics());
+    return map;
+}
+
+QVariantMap FrameStatsDBusInterface::TextureMemory() const
+{
+    QVariantMap map{
+        {QStringLiteral("window"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Window)},
+        {QStringLiteral("decoration"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Decoration)},
+        {QStringLiteral("shadow"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Shadow)},
+        {QStringLiteral("effect"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Effect)},
+        {QStringLiteral("cursor"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Cursor)},
+        {QStringLiteral("other"), GLTexture::allocatedBytes(GLTexture::MemoryCategory::Other)},
+        {QStringLiteral("total"), GLTexture::totalAllocatedBytes()},
+        {QStringLiteral("budget"), qint64(0)},
+        {QStringLiteral("evictedTextures"), quint64(0)},
+    };
+    if (auto scene = qobject_cast<SceneOpenGL *>(Compositor::self()->scene())) {
+        map[QStringLiteral("budget")] = scene->textureBudget();
+        map[QStringLiteral("evictedTextures")] = scene->evictedTextureCount();
+    }
+    return map;
+}
+
+QVariantMap FrameStatsDBusInterface::GLStateStatistics() const
+{
+    return QVariantMap{
+        {QStringLiteral("issuedCalls"), GLState::issuedCalls()},
+        {QStringLiteral("skippedCalls"), GLState::skippedCalls()},
+    };
+}
+
+QVariantList FrameStatsDBusInterface::ClientStatistics() const
+{
+    QVariantList list;
+    if (!waylandServer()) {
+        return list;
+    }
+    const auto clients = waylandServer()->display()->connections();
+    for (KWaylandServer::ClientConnection *client : clients) {
+        QVariantMap objects;
+        const auto objectCounts = client->objectCounts();
+        for (auto it = objectCounts.constBegin(); it != objectCounts.constEnd(); ++it) {
+            objects.insert(QString::fromLatin1(it.key()), it.value());
+        }
+        list.append(QVariantMap{
+            {QStringLiteral("pid"), qint64(client->processId())},
+            {QStringLiteral("executable"), client->executablePath()},
+            {QStringLiteral("objects"), objects},
+            {QStringLiteral("bufferMemory"), client->bufferMemory()},
+            {QStringLiteral("requests"), client->requestCount()},
+            {QStringLiteral("events"), client->eventCount()},
+            {QStringLiteral("bytesReceived"), client->bytesReceived()},
+            {QStringLiteral("bytesSent"), client->bytesSent()},
+        });
+    }
+    return list;
+}
+
+QVariantMap FrameStatsDBusInterface::MemoryStatistics() const
+{
+    qint64 heap = -1;
+#if defined(__GLIBC__)
+    const struct mallinfo2 info = mallinfo2();
+    heap = qint64(info.uordblks) + qint64(info.hblkhd);
+#endif
+
+    qint64 clientBuffers = 0;
+    if (waylandServer()) {
+        const auto clients = waylandServer()->display()->connections();
+        for (KWaylandServer::ClientConnection *client : clients) {
+            clientBuffers += client->bufferMemory();
+        }
+    }
+
+    qint64 decorationPartCache = 0;
+    if (auto scene = qobject_cast<SceneOpenGL *>(Compositor::self()->scene())) {
+        // The cost of the cached parts is in kilobytes.
+        decorationPartCache = qint64(scene->decorationPartCache()->totalCost()) * 1024;
+    }
+
+    return QVariantMap{
+        {QStringLiteral("heap"), heap},
+        {QStringLiteral("windows"), qint64(workspace()->allClientList().count())},
+        {QStringLiteral("deletedWindows"), qint64(workspace()->deletedList().count())},
+        {QStringLiteral("icons"), qint64(IconCache::count())},
+        {QStringLiteral("textures"), TextureMemory()},
+        {QStringLiteral("decorationPartCache"), decorationPartCache},
+        {QStringLiteral("clientBuffers"), clientBuffers},
+    };
+}
+
+QVariantMap FrameStatsDBusInterface::AllocationStatistics() const
+{
+    QVariantMap phases;
+    const auto recorded = AllocationTracker::phases();
+    for (const AllocationTracker::Phase &phase : recorded) {
+        // The phases are named after the first argument of fTraceDuration(), e.g. "Paint (".
+        QString name = QString::fromLatin1(phase.name);
+        if (name.endsWith(QLatin1Char('('))) {
+            name.chop(1);
+        }
+        phases.insert(name.trimmed(), QVariantMap{
+            {QStringLiteral("calls"), phase.calls},
+            {QStringLiteral("allocations"), phase.allocations},
+            {QStringLiteral("allocationsPerCall"), double(phase.allocations) / phase.calls},
+        });
+    }
+
+    return QVariantMap{
+        {QStringLiteral("available"), AllocationTracker::isAvailable()},
+        {QStringLiteral("phases"), phases},
+    };
+}
+
+void FrameStatsDBusInterface::StartWakeupAudit()
+{
+    IdlePowerMode::self()->startWakeupAudit();
+}
+
+void FrameStatsDBusInterface::StopWakeupAudit()
+{
+    IdlePowerMode::self()->stopWakeupAudit();
+}
+
+bool FrameStatsDBusInterface::StartFrameTrace(const QString &fileName)
+{
+    return FrameTraceRecorder::self()->start(fileName);
+}
+
+void FrameStatsDBusInterface::StopFrameTrace()
+{
+    FrameTraceRecorder::self()->stop();
+}
+
+QVariantMap FrameStatsDBusInterface::WakeupAudit() const
+{
+    const IdlePowerMode *idlePowerMode = IdlePowerMode::self();
+    const qint64 duration = idlePowerMode->auditDuration().count();
+
+    QVariantMap wakeups;
+    const auto counts = idlePowerMode->wakeups();
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        wakeups.insert(it.key(), duration > 0 ? it.value() * 1000.0 / duration : 0.0);
+    }
+
+    return QVariantMap{
+        {QStringLiteral("auditing"), idlePowerMode->isAuditing()},
+        {QStringLiteral("duration"), duration},
+        {QStringLiteral("wakeups"), wakeups},
+        {QStringLiteral("idle"), idlePowerMode->isIdle()},
+        {QStringLiteral("idleTime"), qint64(idlePowerMode->idleTime().count())},
+    };
+}
+
+void FrameStatsDBusInterface::StartDamageAudit()
+{
+    DamageAudit::self()->start();
+}
+
+void FrameStatsDBusInterface::StopDamageAudit()
+{
+    DamageAudit::self()->stop();
+}
+
+QVariantMap FrameStatsDBusInterface::TopDamagers(int count) const
+{
+    const DamageAudit *audit = DamageAudit::self();
+    const qint64 duration = audit->duration().count();
+    const auto perSecond = [duration](quint64 value) {
+        return duration > 0 ? value * 1000.0 / duration : 0.0;
+    };
+
+    QVariantList damagers;
+    const auto top = audit->topDamagers(count);
+    for (const DamageAudit::Damager &damager : top) {
+        damagers.append(QVariantMap{
+            {QStringLiteral("output"), damager.output},
+            {QStringLiteral("source"), damager.source},
+            {QStringLiteral("client"), damager.client},
+            {QStringLiteral("pid"), damager.pid},
+            {QStringLiteral("pixelsPerSecond"), perSecond(damager.pixels)},
+            {QStringLiteral("repaintsPerSecond"), perSecond(damager.repaints)},
+        });
+    }
+
+    return QVariantMap{
+        {QStringLiteral("auditing"), audit->isAuditing()},
+        {QStringLiteral("duration"), duration},
+        {QStringLiteral("damagers"), damagers},
+    };
+}
+
+void FrameStatsDBusInterface::Reset()
+{
+    const auto outputs = workspace()->outputs();
+    for (Output *output : outputs) {
+        RenderLoopPrivate::get(output->renderLoop())->frameStatistics.reset();
+    }
+    DamageSimplifier::surfaceDamage()->resetStatistics();
+    DamageSimplifier::outputDamage()->resetStatistics();
+    GLState::resetStatistics();
+    AllocationTracker::reset();
+}
+
 PluginManagerDBusInterface::PluginManagerDBusInterface(PluginManager *manager)
     : QObject(manager)
     , m_manager(manager)
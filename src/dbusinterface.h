@@ -281,6 +281,37 @@ private:
     VirtualDesktopManager *m_manager;
 };
 
+class FrameStatsDBusInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.FrameStats")
+
+    Q_PROPERTY(QStringList Outputs READ outputs)
+
+public:
+    explicit FrameStatsDBusInterface(Compositor *parent);
+
+    QStringList outputs() const;
+
+public Q_SLOTS:
+    QVariantMap Statistics(const QString &name) const;
+    QVariantMap DamageStatistics() const;
+    QVariantMap TextureMemory() const;
+    QVariantMap GLStateStatistics() const;
+    QVariantList ClientStatistics() const;
+    QVariantMap MemoryStatistics() const;
+    QVariantMap AllocationStatistics() const;
+    void StartWakeupAudit();
+    void StopWakeupAudit();
+    QVariantMap WakeupAudit() const;
+    void StartDamageAudit();
+    void StopDamageAudit();
+    QVariantMap TopDamagers(int count) const;
+    bool StartFrameTrace(const QString &fileName);
+    void StopFrameTrace();
+    void Reset();
+};
+
 class PluginManagerDBusInterface : public QObject
 {
     Q_OBJECT
@@ -9,11 +9,16 @@
 #include "debug_console.h"
 #include "composite.h"
 #include "core/inputdevice.h"
+#include "core/output.h"
+#include "core/renderloop_p.h"
+#include "effects.h"
 #include "input_event.h"
 #include "internalwindow.h"
 #include "keyboard_input.h"
 #include "main.h"
 #include "scene.h"
+#include "scenes/opengl/scene_opengl.h"
+#include "scripting/scripting.h"
 #include "unmanaged.h"
 #include "utils/filedescriptor.h"
 #include "utils/subsurfacemonitor.h"
@@ -33,6 +38,7 @@
 #include "x11window.h"
 #include <cerrno>
 #include <kwinglplatform.h>
+#include <kwingltextureatlas.h>
 #include <kwinglutils.h>
 
 #include "ui_debug_console.h"
@@ -47,6 +53,7 @@
 #include <QMouseEvent>
 #include <QScopeGuard>
 #include <QSortFilterProxyModel>
+#include <QTimer>
 #include <QtConcurrentRun>
 
 #include <wayland-server-core.h>
@@ -611,6 +618,11 @@ DebugConsole::DebugConsole()
     m_ui->primaryContent->setModel(new DataSourceModel(this));
     m_ui->inputDevicesView->setModel(new InputDeviceModel(this));
     m_ui->inputDevicesView->setItemDelegate(new DebugConsoleDelegate(this));
+    m_ui->x11EventsView->setModel(new X11EventModel(this));
+    m_ui->scriptsView->setModel(new ScriptsModel(this));
+    auto performanceModel = new PerformanceModel(this);
+    m_ui->performanceView->setModel(performanceModel);
+    connect(performanceModel, &QAbstractItemModel::modelReset, m_ui->performanceView, &QTreeView::expandAll);
     m_ui->quitButton->setIcon(QIcon::fromTheme(QStringLiteral("application-exit")));
     m_ui->tabWidget->setTabIcon(0, QIcon::fromTheme(QStringLiteral("view-list-tree")));
     m_ui->tabWidget->setTabIcon(1, QIcon::fromTheme(QStringLiteral("view-list-tree")));
@@ -1597,6 +1609,517 @@ void InputDeviceModel::setupDeviceConnections(InputDevice *device)
     }
 }
 
+static const char *const s_coreEventNames[] = {
+    "Error",
+    nullptr,
+    "KeyPress",
+    "KeyRelease",
+    "ButtonPress",
+    "ButtonRelease",
+    "MotionNotify",
+    "EnterNotify",
+    "LeaveNotify",
+    "FocusIn",
+    "FocusOut",
+    "KeymapNotify",
+    "Expose",
+    "GraphicsExposure",
+    "NoExposure",
+    "VisibilityNotify",
+    "CreateNotify",
+    "DestroyNotify",
+    "UnmapNotify",
+    "MapNotify",
+    "MapRequest",
+    "ReparentNotify",
+    "ConfigureNotify",
+    "ConfigureRequest",
+    "GravityNotify",
+    "ResizeRequest",
+    "CirculateNotify",
+    "CirculateRequest",
+    "PropertyNotify",
+    "SelectionClear",
+    "SelectionRequest",
+    "SelectionNotify",
+    "ColormapNotify",
+    "ClientMessage",
+    "MappingNotify",
+    "GenericEvent",
+};
+
+X11EventModel::X11EventModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+    auto timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &X11EventModel::update);
+    timer->start(std::chrono::seconds(1));
+    update();
+}
+
+void X11EventModel::update()
+{
+    QVector<Row> rows;
+    const auto &statistics = kwinApp()->x11EventStatistics();
+    for (size_t type = 0; type < statistics.size(); ++type) {
+        if (!statistics[type].count) {
+            continue;
+        }
+        QString name;
+        if (type < std::size(s_coreEventNames) && s_coreEventNames[type]) {
+            name = QString::fromLatin1(s_coreEventNames[type]);
+        } else {
+            name = QStringLiteral("Extension event %1").arg(type);
+        }
+        rows.append(Row{name, statistics[type].count, statistics[type].time});
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+        return a.count > b.count;
+    });
+
+    QVector<Row> windowRows;
+    if (workspace()) {
+        const auto windows = workspace()->clientList();
+        for (X11Window *window : windows) {
+            if (window->propertyNotifyCount()) {
+                const QString name = QStringLiteral("PropertyNotify of %1 (0x%2)").arg(window->caption(), QString::number(window->window(), 16));
+                windowRows.append(Row{name, window->propertyNotifyCount(), std::nullopt});
+            }
+        }
+        std::sort(windowRows.begin(), windowRows.end(), [](const Row &a, const Row &b) {
+            return a.count > b.count;
+        });
+    }
+    rows += windowRows;
+
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+}
+
+QModelIndex X11EventModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column >= 4 || row >= m_rows.count()) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex X11EventModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int X11EventModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+QVariant X11EventModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return QStringLiteral("Event");
+    case 1:
+        return QStringLiteral("Count");
+    case 2:
+        return QStringLiteral("Total time (ms)");
+    case 3:
+        return QStringLiteral("Average time (µs)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant X11EventModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::ParentIsInvalid | CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    const Row &row = m_rows.at(index.row());
+    switch (index.column()) {
+    case 0:
+        return row.name;
+    case 1:
+        return row.count;
+    case 2:
+        if (row.time) {
+            return std::chrono::duration<double, std::milli>(*row.time).count();
+        }
+        return QVariant();
+    case 3:
+        if (row.time) {
+            return std::chrono::duration<double, std::micro>(*row.time).count() / row.count;
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+ScriptsModel::ScriptsModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+    auto timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &ScriptsModel::update);
+    timer->start(std::chrono::seconds(1));
+    update();
+}
+
+void ScriptsModel::update()
+{
+    QVector<Row> rows;
+    if (Scripting::self()) {
+        const auto scripts = Scripting::self()->loadedScripts();
+        for (AbstractScript *script : scripts) {
+            rows.append(Row{script->pluginName(), script->callCount(), script->runningTime()});
+        }
+        std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+            return a.time > b.time;
+        });
+    }
+
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+}
+
+QModelIndex ScriptsModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column >= 4 || row >= m_rows.count()) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex ScriptsModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int ScriptsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+QVariant ScriptsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return QStringLiteral("Script");
+    case 1:
+        return QStringLiteral("Calls");
+    case 2:
+        return QStringLiteral("Total time (ms)");
+    case 3:
+        return QStringLiteral("Average time (µs)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant ScriptsModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::ParentIsInvalid | CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    const Row &row = m_rows.at(index.row());
+    switch (index.column()) {
+    case 0:
+        return row.name;
+    case 1:
+        return row.count;
+    case 2:
+        return std::chrono::duration<double, std::milli>(row.time).count();
+    case 3:
+        if (row.count) {
+            return std::chrono::duration<double, std::micro>(row.time).count() / row.count;
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+PerformanceModel::PerformanceModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+    trackWindows();
+    connect(workspace(), &Workspace::stackingOrderChanged, this, &PerformanceModel::trackWindows);
+
+    auto timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &PerformanceModel::update);
+    timer->start(std::chrono::seconds(1));
+    m_interval.start();
+    update();
+}
+
+PerformanceModel::~PerformanceModel()
+{
+    if (effects) {
+        static_cast<EffectsHandlerImpl *>(effects)->setPaintProfilingEnabled(false);
+    }
+}
+
+void PerformanceModel::trackWindows()
+{
+    const auto windows = workspace()->stackingOrder();
+    for (Window *window : windows) {
+        connect(window, &Window::damaged, this, &PerformanceModel::handleWindowDamaged, Qt::UniqueConnection);
+    }
+}
+
+void PerformanceModel::handleWindowDamaged(Window *window, const QRegion &damage)
+{
+    Damage &stats = m_damage[window];
+    if (stats.caption.isEmpty()) {
+        stats.caption = window->caption();
+    }
+    stats.count++;
+    for (const QRect &rect : damage) {
+        stats.area += quint64(rect.width()) * rect.height();
+    }
+}
+
+static QString formatMilliseconds(std::chrono::nanoseconds duration)
+{
+    return QString::number(std::chrono::duration<double, std::milli>(duration).count(), 'f', 2) + QStringLiteral(" ms");
+}
+
+static QString formatMebibytes(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + QStringLiteral(" MiB");
+}
+
+void PerformanceModel::update()
+{
+    const double seconds = std::max(m_interval.restart(), qint64(1)) / 1000.0;
+    QVector<Section> sections;
+
+    const auto outputs = workspace()->outputs();
+    for (Output *output : outputs) {
+        const RenderLoopPrivate *renderLoop = RenderLoopPrivate::get(output->renderLoop());
+        const FrameStatistics &statistics = renderLoop->frameStatistics;
+        const RenderJournal &journal = renderLoop->renderJournal;
+        Section section{
+            QStringLiteral("Output ") + output->name(),
+            {
+                {QStringLiteral("Presented frames"), QString::number(statistics.presentedFrames())},
+                {QStringLiteral("Missed frames"), QString::number(statistics.missedFrames())},
+                {QStringLiteral("Failed frames"), QString::number(statistics.failedFrames())},
+                {QStringLiteral("Direct scanout frames"), QString::number(statistics.directScanoutFrames())},
+                {QStringLiteral("Latest render time"), formatMilliseconds(journal.latest())},
+                {QStringLiteral("Average render time"), formatMilliseconds(journal.average())},
+                {QStringLiteral("Maximum render time"), formatMilliseconds(journal.maximum())},
+                {QStringLiteral("Average prediction error"), formatMilliseconds(statistics.averagePredictionError())},
+                {QStringLiteral("Maximum prediction error"), formatMilliseconds(statistics.maximumPredictionError())},
+            },
+        };
+        for (int i = 0; i < FrameStatistics::scanoutRefusalCount; ++i) {
+            const auto refusal = ScanoutRefusal(i);
+            if (const quint64 count = statistics.scanoutRefusals(refusal)) {
+                section.rows.append({QStringLiteral("Not scanned out: ") + FrameStatistics::scanoutRefusalName(refusal), QString::number(count)});
+            }
+        }
+        sections.append(section);
+    }
+
+    if (effects) {
+        auto effectsHandler = static_cast<EffectsHandlerImpl *>(effects);
+        if (!effectsHandler->isPaintProfilingEnabled()) {
+            // the compositor was restarted, or this is the first update
+            effectsHandler->setPaintProfilingEnabled(true);
+            m_previousPaintTimes.clear();
+        }
+        QVector<QPair<std::chrono::nanoseconds, QString>> paintTimes;
+        const auto totals = effectsHandler->paintTimes();
+        for (const auto &total : totals) {
+            const QString label = total.first.isEmpty() ? QStringLiteral("Scene") : total.first;
+            const std::chrono::nanoseconds previous = m_previousPaintTimes.value(label);
+            m_previousPaintTimes[label] = total.second;
+            paintTimes.append({std::max(total.second - previous, std::chrono::nanoseconds::zero()), label});
+        }
+        std::sort(paintTimes.begin(), paintTimes.end(), [](const auto &a, const auto &b) {
+            return a.first > b.first;
+        });
+        Section section{QStringLiteral("Effect paint time per second"), {}};
+        for (const auto &paintTime : std::as_const(paintTimes)) {
+            section.rows.append({paintTime.second, formatMilliseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(paintTime.first / seconds))});
+        }
+        sections.append(section);
+    }
+
+    Section textures{
+        QStringLiteral("Textures"),
+        {
+            {QStringLiteral("Windows"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Window))},
+            {QStringLiteral("Decorations"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Decoration))},
+            {QStringLiteral("Shadows"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Shadow))},
+            {QStringLiteral("Effects"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Effect))},
+            {QStringLiteral("Cursors"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Cursor))},
+            {QStringLiteral("Other"), formatMebibytes(GLTexture::allocatedBytes(GLTexture::MemoryCategory::Other))},
+            {QStringLiteral("Total"), formatMebibytes(GLTexture::totalAllocatedBytes())},
+        },
+    };
+    auto scene = Compositor::self() ? qobject_cast<SceneOpenGL *>(Compositor::self()->scene()) : nullptr;
+    if (scene && scene->textureBudget() > 0) {
+        textures.rows.append({QStringLiteral("Budget"), formatMebibytes(scene->textureBudget())});
+        textures.rows.append({QStringLiteral("Evicted window textures"), QString::number(scene->evictedTextureCount())});
+    }
+    textures.rows.append({QStringLiteral("Images converted before upload"), QString::number(GLTexture::convertedImageCount())});
+    if (GLTextureAtlas *atlas = GLTextureAtlas::instance(); atlas && atlas->pageCount() > 0) {
+        textures.rows.append({QStringLiteral("Texture atlas pages"), QString::number(atlas->pageCount())});
+        textures.rows.append({QStringLiteral("Texture atlas entries"), QString::number(atlas->entryCount())});
+    }
+    sections.append(textures);
+
+    if (scene) {
+        const quint64 exact = scene->exactSurfaceDrawCount();
+        const quint64 resampled = scene->resampledSurfaceDrawCount();
+        const quint64 total = exact + resampled;
+        sections.append(Section{
+            QStringLiteral("Surface sampling"),
+            {
+                {QStringLiteral("Drawn pixel for pixel"), QString::number(exact)},
+                {QStringLiteral("Resampled"), QString::number(resampled)},
+                {QStringLiteral("Resampled share"), total ? QStringLiteral("%1 %").arg(100.0 * resampled / total, 0, 'f', 1) : QStringLiteral("-")},
+            },
+        });
+    }
+
+    QVector<Damage> damage;
+    damage.reserve(m_damage.count());
+    for (const Damage &stats : std::as_const(m_damage)) {
+        damage.append(stats);
+    }
+    m_damage.clear();
+    std::sort(damage.begin(), damage.end(), [](const Damage &a, const Damage &b) {
+        return a.area > b.area;
+    });
+    Section damageSection{QStringLiteral("Damage per second"), {}};
+    for (int i = 0; i < std::min(damage.count(), 10); ++i) {
+        const Damage &stats = damage.at(i);
+        damageSection.rows.append({stats.caption,
+                                   QStringLiteral("%1 events, %2 pixels").arg(qRound(stats.count / seconds)).arg(qRound64(stats.area / seconds))});
+    }
+    sections.append(damageSection);
+
+    if (waylandServer()) {
+        struct ClientTraffic
+        {
+            KWaylandServer::ClientConnection *client;
+            Traffic rate;
+        };
+        QVector<ClientTraffic> traffic;
+        QHash<KWaylandServer::ClientConnection *, Traffic> totals;
+        const auto clients = waylandServer()->display()->connections();
+        for (KWaylandServer::ClientConnection *client : clients) {
+            const Traffic total{client->requestCount(), client->eventCount(), client->bytesReceived(), client->bytesSent()};
+            const Traffic previous = m_traffic.value(client);
+            totals.insert(client, total);
+            traffic.append({client, Traffic{total.requests - previous.requests, total.events - previous.events, total.bytesReceived - previous.bytesReceived, total.bytesSent - previous.bytesSent}});
+        }
+        m_traffic = totals;
+        std::sort(traffic.begin(), traffic.end(), [](const ClientTraffic &a, const ClientTraffic &b) {
+            return a.rate.requests + a.rate.events > b.rate.requests + b.rate.events;
+        });
+        Section clientSection{QStringLiteral("Wayland clients"), {}};
+        for (int i = 0; i < std::min(traffic.count(), 10); ++i) {
+            const ClientTraffic &client = traffic.at(i);
+            int objects = 0;
+            const auto objectCounts = client.client->objectCounts();
+            for (int count : objectCounts) {
+                objects += count;
+            }
+            clientSection.rows.append({QStringLiteral("%1 (%2)").arg(client.client->executablePath()).arg(client.client->processId()),
+                                       QStringLiteral("%1 objects, %2 of buffers, %3 requests and %4 events per second, %5 KiB/s in, %6 KiB/s out")
+                                           .arg(objects)
+                                           .arg(formatMebibytes(client.client->bufferMemory()))
+                                           .arg(qRound64(client.rate.requests / seconds))
+                                           .arg(qRound64(client.rate.events / seconds))
+                                           .arg(client.rate.bytesReceived / seconds / 1024.0, 0, 'f', 1)
+                                           .arg(client.rate.bytesSent / seconds / 1024.0, 0, 'f', 1)});
+        }
+        sections.append(clientSection);
+    }
+
+    beginResetModel();
+    m_sections = sections;
+    endResetModel();
+}
+
+QModelIndex PerformanceModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column >= 2 || row < 0) {
+        return QModelIndex();
+    }
+    if (!parent.isValid()) {
+        if (row >= m_sections.count()) {
+            return QModelIndex();
+        }
+        return createIndex(row, column, quintptr(0));
+    }
+    if (parent.internalId() != 0 || parent.row() >= m_sections.count() || row >= m_sections.at(parent.row()).rows.count()) {
+        return QModelIndex();
+    }
+    // the children carry the row of their section, offset by one
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex PerformanceModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || child.internalId() == 0) {
+        return QModelIndex();
+    }
+    return createIndex(int(child.internalId() - 1), 0, quintptr(0));
+}
+
+int PerformanceModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return m_sections.count();
+    }
+    if (parent.internalId() != 0 || parent.column() != 0) {
+        return 0;
+    }
+    return m_sections.at(parent.row()).rows.count();
+}
+
+QVariant PerformanceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return QStringLiteral("Name");
+    case 1:
+        return QStringLiteral("Value");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant PerformanceModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (index.internalId() == 0) {
+        return index.column() == 0 ? QVariant(m_sections.at(index.row()).name) : QVariant();
+    }
+    const Row &row = m_sections.at(index.internalId() - 1).rows.at(index.row());
+    return index.column() == 0 ? row.name : row.value;
+}
+
 QModelIndex DataSourceModel::index(int row, int column, const QModelIndex &parent) const
 {
     if (!m_source || parent.isValid() || column >= 2 || row >= m_source->mimeTypes().size()) {
@@ -15,16 +15,21 @@
 #include <kwin_export.h>
 
 #include <QAbstractItemModel>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QStyledItemDelegate>
 #include <QVector>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <optional>
 
 class QTextEdit;
 
 namespace KWaylandServer
 {
 class AbstractDataSource;
+class ClientConnection;
 }
 
 namespace Ui
@@ -183,6 +188,123 @@ private:
     QList<InputDevice *> m_devices;
 };
 
+/**
+ * Lists how many X11 events of each type KWin has dispatched and how long they took, and which
+ * windows cause the most PropertyNotify events. It's updated every second.
+ */
+class X11EventModel : public QAbstractItemModel
+{
+public:
+    explicit X11EventModel(QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent) const override;
+    int columnCount(const QModelIndex &parent) const override
+    {
+        return parent.isValid() ? 0 : 4;
+    }
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void update();
+
+    struct Row
+    {
+        QString name;
+        quint64 count = 0;
+        std::optional<std::chrono::nanoseconds> time;
+    };
+    QVector<Row> m_rows;
+};
+
+class ScriptsModel : public QAbstractItemModel
+{
+public:
+    explicit ScriptsModel(QObject *parent = nullptr);
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent) const override;
+    int columnCount(const QModelIndex &parent) const override
+    {
+        return parent.isValid() ? 0 : 4;
+    }
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void update();
+
+    struct Row
+    {
+        QString name;
+        quint64 count = 0;
+        std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    };
+    QVector<Row> m_rows;
+};
+
+/**
+ * Shows the frame statistics and render times of each output, how much time each effect
+ * spends painting, which windows produce the most damage and which Wayland clients are the
+ * busiest. It's updated every second, the rates are measured over that second.
+ */
+class PerformanceModel : public QAbstractItemModel
+{
+public:
+    explicit PerformanceModel(QObject *parent = nullptr);
+    ~PerformanceModel() override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent) const override;
+    int columnCount(const QModelIndex &parent) const override
+    {
+        Q_UNUSED(parent)
+        return 2;
+    }
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void update();
+    void trackWindows();
+    void handleWindowDamaged(Window *window, const QRegion &damage);
+
+    struct Row
+    {
+        QString name;
+        QString value;
+    };
+    struct Section
+    {
+        QString name;
+        QVector<Row> rows;
+    };
+    struct Damage
+    {
+        QString caption;
+        quint64 count = 0;
+        quint64 area = 0;
+    };
+    struct Traffic
+    {
+        quint64 requests = 0;
+        quint64 events = 0;
+        quint64 bytesReceived = 0;
+        quint64 bytesSent = 0;
+    };
+    QVector<Section> m_sections;
+    QHash<QString, std::chrono::nanoseconds> m_previousPaintTimes;
+    // only used as keys, a window may be gone by the time the damage is reported
+    QHash<Window *, Damage> m_damage;
+    // only used as keys, like the windows above
+    QHash<KWaylandServer::ClientConnection *, Traffic> m_traffic;
+    QElapsedTimer m_interval;
+};
+
 class DataSourceModel : public QAbstractItemModel
 {
 public:
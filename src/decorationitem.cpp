@@ -128,8 +128,6 @@ DecorationItem::DecorationItem(KDecoration2::Decoration *decoration, Window *win
     : Item(parent)
     , m_window(window)
 {
-    m_renderer.reset(Compositor::self()->scene()->createDecorationRenderer(window->decoratedClient()));
-
     connect(window, &Window::frameGeometryChanged,
             this, &DecorationItem::handleFrameGeometryChanged);
     connect(window, &Window::windowClosed,
@@ -140,9 +138,6 @@ DecorationItem::DecorationItem(KDecoration2::Decoration *decoration, Window *win
     connect(decoration, &KDecoration2::Decoration::bordersChanged,
             this, &DecorationItem::discardQuads);
 
-    connect(renderer(), &DecorationRenderer::damaged,
-            this, qOverload<const QRegion &>(&Item::scheduleRepaint));
-
     // this toSize is to match that DecoratedWindow also rounds
     setSize(window->size().toSize());
     handleOutputChanged();
@@ -160,8 +155,34 @@ QRegion DecorationItem::opaque() const
     return m_window->decorationHasAlpha() ? QRegion() : shape();
 }
 
+void DecorationItem::createRenderer()
+{
+    m_renderer.reset(Compositor::self()->scene()->createDecorationRenderer(m_window->decoratedClient()));
+    m_renderer->setDevicePixelRatio(devicePixelRatio());
+
+    connect(m_renderer.get(), &DecorationRenderer::damaged,
+            this, qOverload<const QRegion &>(&Item::scheduleRepaint));
+}
+
+void DecorationItem::releaseRenderer()
+{
+    if (m_window->isDeleted()) {
+        // The decoration is gone, it can't be rendered again.
+        return;
+    }
+    m_renderer.reset();
+}
+
+qreal DecorationItem::devicePixelRatio() const
+{
+    return m_output ? m_output->scale() : 1.0;
+}
+
 void DecorationItem::preprocess()
 {
+    if (!m_renderer) {
+        createRenderer();
+    }
     const QRegion damage = m_renderer->damage();
     if (!damage.isEmpty()) {
         m_renderer->render(damage);
@@ -185,11 +206,10 @@ void DecorationItem::handleOutputChanged()
 
 void DecorationItem::handleOutputScaleChanged()
 {
-    const qreal dpr = m_output->scale();
-    if (m_renderer->devicePixelRatio() != dpr) {
-        m_renderer->setDevicePixelRatio(dpr);
-        discardQuads();
+    if (m_renderer) {
+        m_renderer->setDevicePixelRatio(devicePixelRatio());
     }
+    discardQuads();
 }
 
 void DecorationItem::handleFrameGeometryChanged()
@@ -200,9 +220,12 @@ void DecorationItem::handleFrameGeometryChanged()
 void DecorationItem::handleWindowClosed(Window *original, Deleted *deleted)
 {
     Q_UNUSED(original)
-    m_window = deleted;
 
     // If the decoration is about to be destroyed, render the decoration for the last time.
+    if (!m_renderer) {
+        createRenderer();
+    }
+    m_window = deleted;
     preprocess();
 }
 
@@ -259,7 +282,8 @@ WindowQuadList DecorationItem::buildQuads() const
     }
 
     QRectF left, top, right, bottom;
-    const qreal devicePixelRatio = m_renderer->effectiveDevicePixelRatio();
+    // The renderer doesn't paint with a device pixel ratio less than 1.
+    const qreal devicePixelRatio = std::max(qreal(1.0), this->devicePixelRatio());
     const int texturePad = DecorationRenderer::TexturePad;
 
     m_window->layoutDecorationRects(left, top, right, bottom);
@@ -72,6 +72,10 @@ private:
 
 /**
  * The DecorationItem class represents a server-side decoration.
+ *
+ * The renderer, and with it the texture of the decoration, is created when the decoration is
+ * painted for the first time, and released while the window is hidden, e.g. when it's minimized
+ * or on another virtual desktop.
  */
 class KWIN_EXPORT DecorationItem : public Item
 {
@@ -80,9 +84,18 @@ class KWIN_EXPORT DecorationItem : public Item
 public:
     explicit DecorationItem(KDecoration2::Decoration *decoration, Window *window, Item *parent = nullptr);
 
+    /**
+     * Returns the renderer of the decoration, or @c null if the decoration hasn't been painted
+     * since the renderer has been released.
+     */
     DecorationRenderer *renderer() const;
     Window *window() const;
 
+    /**
+     * Destroys the renderer, it's created again when the decoration is painted.
+     */
+    void releaseRenderer();
+
     QRegion shape() const override final;
     QRegion opaque() const override final;
 
@@ -97,6 +110,9 @@ protected:
     WindowQuadList buildQuads() const override;
 
 private:
+    void createRenderer();
+    qreal devicePixelRatio() const;
+
     Window *m_window;
     QPointer<Output> m_output;
     QPointer<KDecoration2::Decoration> m_decoration;
@@ -57,6 +57,15 @@ public:
 
     void reconfigure();
 
+    QString plugin() const
+    {
+        return m_plugin;
+    }
+    QString theme() const
+    {
+        return m_theme;
+    }
+
     const QSharedPointer<KDecoration2::DecorationSettings> &settings() const
     {
         return m_settings;
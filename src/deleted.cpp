@@ -9,10 +9,15 @@
 
 #include "deleted.h"
 
+#if KWIN_BUILD_ACTIVITIES
+#include "activities.h"
+#endif
 #include "group.h"
 #include "netinfo.h"
 #include "shadow.h"
+#include "surfaceitem.h"
 #include "virtualdesktops.h"
+#include "windowitem.h"
 #include "workspace.h"
 
 #include <QDebug>
@@ -79,7 +84,11 @@ void Deleted::copyToDeleted(Window *window)
     m_frameMargins = window->frameMargins();
     desk = window->desktop();
     m_desktops = window->desktops();
+    m_desktopMask = VirtualDesktop::membershipMask(m_desktops);
     activityList = window->activities();
+#if KWIN_BUILD_ACTIVITIES
+    m_activityMask = Activities::mask(activityList);
+#endif
     contentsRect = QRectF(window->clientPos(), window->clientSize());
     m_layer = window->layer();
     m_frame = window->frameId();
@@ -110,6 +119,7 @@ void Deleted::copyToDeleted(Window *window)
     for (auto vd : qAsConst(m_desktops)) {
         connect(vd, &QObject::destroyed, this, [=] {
             m_desktops.removeOne(vd);
+            m_desktopMask = VirtualDesktop::membershipMask(m_desktops);
         });
     }
 
@@ -118,9 +128,35 @@ void Deleted::copyToDeleted(Window *window)
     m_wasLockScreen = window->isLockScreen();
 }
 
+static void trimSurfaceItems(Item *item, bool keepContents)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+        surfaceItem->trim(keepContents);
+    }
+    const QList<Item *> children = item->childItems();
+    for (Item *child : children) {
+        trimSurfaceItems(child, keepContents);
+    }
+}
+
+void Deleted::trim()
+{
+    // The first unref comes from the window that has been closed, after the effects had
+    // their chance to reference the Deleted for a closing animation. Mass closes e.g. at
+    // logout would otherwise keep the buffers and the pixmap history of every window.
+    m_trimmed = true;
+    if (WindowItem *item = windowItem()) {
+        trimSurfaceItems(item, delete_refcount > 0);
+    }
+}
+
 void Deleted::unrefWindow()
 {
-    if (--delete_refcount > 0) {
+    --delete_refcount;
+    if (!m_trimmed) {
+        trim();
+    }
+    if (delete_refcount > 0) {
         return;
     }
     // needs to be delayed
@@ -137,11 +137,13 @@ private Q_SLOTS:
 private:
     Deleted(); // use create()
     void copyToDeleted(Window *c);
+    void trim();
     ~Deleted() override; // deleted only using unrefWindow()
 
     QMargins m_frameMargins;
 
     int delete_refcount;
+    bool m_trimmed = false;
     int desk;
     QStringList activityList;
     QRectF contentsRect; // for clientPos()/clientSize()
@@ -20,7 +20,7 @@ namespace KWin
 {
 
 DpmsInputEventFilter::DpmsInputEventFilter()
-    : InputEventFilter()
+    : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch)
 {
     KSharedConfig::Ptr kwinSettings = kwinApp()->config();
     m_enableDoubleTap = kwinSettings->group("Wayland").readEntry<bool>("DoubleTapWakeup", true);
@@ -24,6 +24,7 @@
 #include <QFutureWatcher>
 #include <QStaticPlugin>
 #include <QStringList>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 
 namespace KWin
@@ -196,6 +197,7 @@ void ScriptedEffectLoader::clear()
 PluginEffectLoader::PluginEffectLoader(QObject *parent)
     : AbstractEffectLoader(parent)
     , m_pluginSubDirectory(QStringLiteral("kwin/effects/plugins"))
+    , m_queue(new EffectLoadQueue<PluginEffectLoader, KPluginMetaData>(this))
 {
 }
 
@@ -327,13 +329,59 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
 
 void PluginEffectLoader::queryAndLoadAll()
 {
-    const auto effects = findAllEffects();
+    if (m_queryConnection) {
+        return;
+    }
+    // perform querying for the plugins in a thread
+    QFutureWatcher<QVector<KPluginMetaData>> *watcher = new QFutureWatcher<QVector<KPluginMetaData>>(this);
+    m_queryConnection = connect(
+        watcher, &QFutureWatcher<QVector<KPluginMetaData>>::finished, this, [this, watcher]() {
+            const auto effects = watcher->result();
+            watcher->deleteLater();
+            enqueueEffects(effects);
+        },
+        Qt::QueuedConnection);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    watcher->setFuture(QtConcurrent::run(this, &PluginEffectLoader::findAllEffects));
+#else
+    watcher->setFuture(QtConcurrent::run(&PluginEffectLoader::findAllEffects, this));
+#endif
+}
+
+void PluginEffectLoader::enqueueEffects(const QVector<KPluginMetaData> &effects)
+{
+    QVector<KPluginMetaData> enabledEffects;
+    QVector<LoadEffectFlags> enabledFlags;
     for (const auto &effect : effects) {
         const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
-        if (flags.testFlag(LoadEffectFlag::Load)) {
-            loadEffect(effect, flags);
+        if (flags.testFlag(LoadEffectFlag::Load) && !m_loadedEffects.contains(effect.pluginId())) {
+            enabledEffects << effect;
+            enabledFlags << flags;
         }
     }
+    // The effects have to be created in the compositor thread, but mapping and relocating the
+    // libraries doesn't, so that happens in parallel before they get queued up for creation.
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    m_queryConnection = connect(
+        watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, enabledEffects, enabledFlags]() {
+            for (int i = 0; i < enabledEffects.count(); ++i) {
+                m_queue->enqueue(qMakePair(enabledEffects[i], enabledFlags[i]));
+            }
+            watcher->deleteLater();
+            m_queryConnection = QMetaObject::Connection();
+        },
+        Qt::QueuedConnection);
+    watcher->setFuture(QtConcurrent::mapped(enabledEffects, &PluginEffectLoader::preloadLibrary));
+}
+
+bool PluginEffectLoader::preloadLibrary(const KPluginMetaData &info)
+{
+    if (info.isStaticPlugin()) {
+        return true;
+    }
+    // the library stays loaded after the loader is gone, factory() picks it up from there
+    QPluginLoader loader(info.fileName());
+    return loader.load();
 }
 
 QVector<KPluginMetaData> PluginEffectLoader::findAllEffects() const
@@ -348,6 +396,9 @@ void PluginEffectLoader::setPluginSubDirectory(const QString &directory)
 
 void PluginEffectLoader::clear()
 {
+    disconnect(m_queryConnection);
+    m_queryConnection = QMetaObject::Connection();
+    m_queue->clear();
 }
 
 EffectLoader::EffectLoader(QObject *parent)
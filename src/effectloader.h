@@ -318,8 +318,12 @@ private:
     QVector<KPluginMetaData> findAllEffects() const;
     KPluginMetaData findEffect(const QString &name) const;
     EffectPluginFactory *factory(const KPluginMetaData &info) const;
+    void enqueueEffects(const QVector<KPluginMetaData> &effects);
+    static bool preloadLibrary(const KPluginMetaData &info);
     QStringList m_loadedEffects;
     QString m_pluginSubDirectory;
+    EffectLoadQueue<PluginEffectLoader, KPluginMetaData> *m_queue;
+    QMetaObject::Connection m_queryConnection;
 };
 
 class KWIN_EXPORT EffectLoader : public AbstractEffectLoader
@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "effectpaintstatistics.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+void EffectPaintStatistics::addFrame(std::chrono::nanoseconds paintTime, std::chrono::nanoseconds budget)
+{
+    m_frames[m_head] = Frame{paintTime, budget};
+    m_head = (m_head + 1) % s_capacity;
+    m_count = std::min(m_count + 1, s_capacity);
+}
+
+void EffectPaintStatistics::clear()
+{
+    m_head = 0;
+    m_count = 0;
+}
+
+int EffectPaintStatistics::frameCount() const
+{
+    return m_count;
+}
+
+std::chrono::nanoseconds EffectPaintStatistics::averagePaintTime() const
+{
+    if (m_count == 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+    std::chrono::nanoseconds sum = std::chrono::nanoseconds::zero();
+    for (int i = 0; i < m_count; ++i) {
+        sum += m_frames[i].paintTime;
+    }
+    return sum / m_count;
+}
+
+std::chrono::nanoseconds EffectPaintStatistics::maximumPaintTime() const
+{
+    std::chrono::nanoseconds maximum = std::chrono::nanoseconds::zero();
+    for (int i = 0; i < m_count; ++i) {
+        maximum = std::max(maximum, m_frames[i].paintTime);
+    }
+    return maximum;
+}
+
+qreal EffectPaintStatistics::averageBudgetShare() const
+{
+    qreal sum = 0;
+    int frames = 0;
+    for (int i = 0; i < m_count; ++i) {
+        if (m_frames[i].budget > std::chrono::nanoseconds::zero()) {
+            sum += qreal(m_frames[i].paintTime.count()) / m_frames[i].budget.count();
+            frames++;
+        }
+    }
+    return frames ? sum / frames : 0;
+}
+
+} // namespace KWin
@@ -0,0 +1,56 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QtGlobal>
+
+#include <array>
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The EffectPaintStatistics class keeps the paint times of an effect over the most recent
+ * frames it took part in, along with the frame budget of each of those frames, i.e. the
+ * refresh interval of the output that was painted.
+ */
+class KWIN_EXPORT EffectPaintStatistics
+{
+public:
+    static constexpr int s_capacity = 120;
+
+    void addFrame(std::chrono::nanoseconds paintTime, std::chrono::nanoseconds budget);
+    void clear();
+
+    /**
+     * Returns the number of recorded frames, at most s_capacity.
+     */
+    int frameCount() const;
+    std::chrono::nanoseconds averagePaintTime() const;
+    std::chrono::nanoseconds maximumPaintTime() const;
+    /**
+     * Returns the paint time relative to the frame budget, averaged over the recorded frames.
+     * For example, 0.1 means that the effect used a tenth of the budget.
+     */
+    qreal averageBudgetShare() const;
+
+private:
+    struct Frame
+    {
+        std::chrono::nanoseconds paintTime = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds budget = std::chrono::nanoseconds::zero();
+    };
+    std::array<Frame, s_capacity> m_frames;
+    int m_head = 0;
+    int m_count = 0;
+};
+
+} // namespace KWin
@@ -13,6 +13,7 @@
 #include <config-kwin.h>
 
 #include "core/output.h"
+#include "core/renderloop.h"
 #include "effectloader.h"
 #include "effectsadaptor.h"
 #if KWIN_BUILD_ACTIVITIES
@@ -21,6 +22,7 @@
 #include "core/renderbackend.h"
 #include "core/renderlayer.h"
 #include "cursor.h"
+#include "damageaudit.h"
 #include "deleted.h"
 #include "group.h"
 #include "input_event.h"
@@ -134,6 +136,13 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
         effectsChanged();
     });
     m_effectLoader->setConfig(kwinApp()->config());
+    // KWIN_EFFECT_PAINT_BUDGET=<percent> logs the effects that take more than the given
+    // share of the frame budget
+    const int paintBudget = qEnvironmentVariableIntValue("KWIN_EFFECT_PAINT_BUDGET");
+    if (paintBudget > 0) {
+        m_paintBudgetThreshold = paintBudget / 100.0;
+        m_paintProfilingEnabled = true;
+    }
     new EffectsAdaptor(this);
     QDBusConnection dbus = QDBusConnection::sessionBus();
     dbus.registerObject(QStringLiteral("/Effects"), this);
@@ -381,10 +390,51 @@ void EffectsHandlerImpl::reconfigure()
     m_effectLoader->queryAndLoadAll();
 }
 
+/**
+ * Measures a call into the effect chain while paint profiling is enabled. Every effect calls
+ * the next one from within its own hook, so the time of the nested calls is subtracted to get
+ * the time of the effect alone.
+ */
+class EffectsHandlerImpl::PaintTimer
+{
+public:
+    PaintTimer(EffectsHandlerImpl *handler, Effect *effect)
+        : m_handler(handler->m_paintProfilingEnabled ? handler : nullptr)
+        , m_effects(handler)
+        , m_effect(effect)
+        , m_previousEffect(std::exchange(handler->m_paintingEffect, effect))
+    {
+        if (m_handler) {
+            m_parentChildTime = m_handler->m_paintChildTime;
+            m_handler->m_paintChildTime = std::chrono::nanoseconds::zero();
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PaintTimer()
+    {
+        m_effects->m_paintingEffect = m_previousEffect;
+        if (m_handler) {
+            const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - m_start;
+            m_handler->m_framePaintTimes[m_effect] += elapsed - m_handler->m_paintChildTime;
+            m_handler->m_paintChildTime = m_parentChildTime + elapsed;
+        }
+    }
+
+private:
+    EffectsHandlerImpl *m_handler;
+    EffectsHandlerImpl *m_effects;
+    Effect *m_effect;
+    Effect *m_previousEffect;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::nanoseconds m_parentChildTime;
+};
+
 // the idea is that effects call this function again which calls the next one
 void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintScreenIterator);
         (*m_currentPaintScreenIterator++)->prePaintScreen(data, presentTime);
         --m_currentPaintScreenIterator;
     }
@@ -394,9 +444,11 @@ void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData &data, std::chrono::m
 void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintScreenIterator);
         (*m_currentPaintScreenIterator++)->paintScreen(mask, region, data);
         --m_currentPaintScreenIterator;
     } else {
+        PaintTimer timer(this, nullptr);
         m_scene->finalPaintScreen(mask, region, data);
     }
 }
@@ -404,6 +456,7 @@ void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPain
 void EffectsHandlerImpl::postPaintScreen()
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintScreenIterator);
         (*m_currentPaintScreenIterator++)->postPaintScreen();
         --m_currentPaintScreenIterator;
     }
@@ -413,6 +466,7 @@ void EffectsHandlerImpl::postPaintScreen()
 void EffectsHandlerImpl::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintWindowIterator);
         (*m_currentPaintWindowIterator++)->prePaintWindow(w, data, presentTime);
         --m_currentPaintWindowIterator;
     }
@@ -422,9 +476,11 @@ void EffectsHandlerImpl::prePaintWindow(EffectWindow *w, WindowPrePaintData &dat
 void EffectsHandlerImpl::paintWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintWindowIterator);
         (*m_currentPaintWindowIterator++)->paintWindow(w, mask, region, data);
         --m_currentPaintWindowIterator;
     } else {
+        PaintTimer timer(this, nullptr);
         m_scene->finalPaintWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
     }
 }
@@ -432,6 +488,7 @@ void EffectsHandlerImpl::paintWindow(EffectWindow *w, int mask, const QRegion &r
 void EffectsHandlerImpl::postPaintWindow(EffectWindow *w)
 {
     if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentPaintWindowIterator);
         (*m_currentPaintWindowIterator++)->postPaintWindow(w);
         --m_currentPaintWindowIterator;
     }
@@ -451,9 +508,11 @@ Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 void EffectsHandlerImpl::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
     if (m_currentDrawWindowIterator != m_activeEffects.constEnd()) {
+        PaintTimer timer(this, *m_currentDrawWindowIterator);
         (*m_currentDrawWindowIterator++)->drawWindow(w, mask, region, data);
         --m_currentDrawWindowIterator;
     } else {
+        PaintTimer timer(this, nullptr);
         m_scene->finalDrawWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
     }
 }
@@ -1265,28 +1324,49 @@ EffectWindow *EffectsHandlerImpl::currentTabBoxWindow() const
     return nullptr;
 }
 
+QString EffectsHandlerImpl::repaintSource() const
+{
+    const DamageAudit *audit = DamageAudit::self();
+    if (!audit || !audit->isAuditing()) {
+        return QString();
+    }
+    if (m_paintingEffect) {
+        for (const EffectPair &pair : loaded_effects) {
+            if (pair.second == m_paintingEffect) {
+                return QStringLiteral("effect ") + pair.first;
+            }
+        }
+    }
+    return QStringLiteral("effects");
+}
+
 void EffectsHandlerImpl::addRepaintFull()
 {
+    const DamageAudit::Scope scope(repaintSource());
     m_compositor->scene()->addRepaintFull();
 }
 
 void EffectsHandlerImpl::addRepaint(const QRect &r)
 {
+    const DamageAudit::Scope scope(repaintSource());
     m_compositor->scene()->addRepaint(r);
 }
 
 void EffectsHandlerImpl::addRepaint(const QRectF &r)
 {
+    const DamageAudit::Scope scope(repaintSource());
     m_compositor->scene()->addRepaint(r.toAlignedRect());
 }
 
 void EffectsHandlerImpl::addRepaint(const QRegion &r)
 {
+    const DamageAudit::Scope scope(repaintSource());
     m_compositor->scene()->addRepaint(r);
 }
 
 void EffectsHandlerImpl::addRepaint(int x, int y, int w, int h)
 {
+    const DamageAudit::Scope scope(repaintSource());
     m_compositor->scene()->addRepaint(x, y, w, h);
 }
 
@@ -1505,6 +1585,10 @@ void EffectsHandlerImpl::destroyEffect(Effect *effect)
         removeSupportProperty(property, effect);
     }
 
+    m_paintTimes.remove(effect);
+    m_framePaintTimes.remove(effect);
+    m_paintStatistics.remove(effect);
+    m_overBudgetEffects.remove(effect);
     delete effect;
 }
 
@@ -1594,6 +1678,96 @@ QStringList EffectsHandlerImpl::activeEffects() const
     return ret;
 }
 
+void EffectsHandlerImpl::setPaintProfilingEnabled(bool enabled)
+{
+    enabled = enabled || m_paintBudgetThreshold > 0;
+    if (m_paintProfilingEnabled == enabled) {
+        return;
+    }
+    m_paintProfilingEnabled = enabled;
+    m_paintChildTime = std::chrono::nanoseconds::zero();
+    m_paintTimes.clear();
+    m_framePaintTimes.clear();
+    m_paintStatistics.clear();
+}
+
+bool EffectsHandlerImpl::isPaintProfilingEnabled() const
+{
+    return m_paintProfilingEnabled;
+}
+
+QVector<QPair<QString, std::chrono::nanoseconds>> EffectsHandlerImpl::paintTimes() const
+{
+    QVector<QPair<QString, std::chrono::nanoseconds>> ret;
+    ret.reserve(loaded_effects.count() + 1);
+    ret.append({QString(), m_paintTimes.value(nullptr)});
+    for (const EffectPair &pair : loaded_effects) {
+        ret.append({pair.first, m_paintTimes.value(pair.second)});
+    }
+    return ret;
+}
+
+void EffectsHandlerImpl::endPaint(Output *output)
+{
+    if (!m_paintProfilingEnabled) {
+        return;
+    }
+    const std::chrono::nanoseconds budget(1'000'000'000'000 / std::max(output->refreshRate(), 1));
+
+    auto addFrame = [this, budget](Effect *effect) {
+        const std::chrono::nanoseconds paintTime = m_framePaintTimes.value(effect);
+        m_paintTimes[effect] += paintTime;
+        EffectPaintStatistics &statistics = m_paintStatistics[effect];
+        statistics.addFrame(paintTime, budget);
+        if (!effect || m_paintBudgetThreshold <= 0 || statistics.frameCount() < EffectPaintStatistics::s_capacity) {
+            return;
+        }
+        const qreal share = statistics.averageBudgetShare();
+        if (share > m_paintBudgetThreshold) {
+            if (!m_overBudgetEffects.contains(effect)) {
+                m_overBudgetEffects.insert(effect);
+                const auto it = std::find_if(loaded_effects.constBegin(), loaded_effects.constEnd(), [effect](const EffectPair &pair) {
+                    return pair.second == effect;
+                });
+                qCWarning(KWIN_CORE, "Effect %s takes %.1f%% of the frame budget on average, %.2f ms at most",
+                          it != loaded_effects.constEnd() ? qPrintable(it->first) : "unknown",
+                          share * 100, std::chrono::duration<double, std::milli>(statistics.maximumPaintTime()).count());
+            }
+        } else {
+            m_overBudgetEffects.remove(effect);
+        }
+    };
+
+    addFrame(nullptr);
+    for (Effect *effect : std::as_const(m_activeEffects)) {
+        addFrame(effect);
+    }
+    m_framePaintTimes.clear();
+}
+
+QVariantMap EffectsHandlerImpl::paintStatistics() const
+{
+    auto toMap = [](const EffectPaintStatistics &statistics) {
+        return QVariantMap{
+            {QStringLiteral("frames"), statistics.frameCount()},
+            {QStringLiteral("averagePaintTime"), qint64(std::chrono::duration_cast<std::chrono::microseconds>(statistics.averagePaintTime()).count())},
+            {QStringLiteral("maximumPaintTime"), qint64(std::chrono::duration_cast<std::chrono::microseconds>(statistics.maximumPaintTime()).count())},
+            {QStringLiteral("averageBudgetShare"), statistics.averageBudgetShare()},
+        };
+    };
+
+    QVariantMap ret;
+    if (const auto it = m_paintStatistics.constFind(nullptr); it != m_paintStatistics.constEnd()) {
+        ret.insert(QString(), toMap(*it));
+    }
+    for (const EffectPair &pair : loaded_effects) {
+        if (const auto it = m_paintStatistics.constFind(pair.second); it != m_paintStatistics.constEnd()) {
+            ret.insert(pair.first, toMap(*it));
+        }
+    }
+    return ret;
+}
+
 bool EffectsHandlerImpl::blocksDirectScanout() const
 {
     return std::any_of(m_activeEffects.constBegin(), m_activeEffects.constEnd(), [](const Effect *effect) {
@@ -1828,7 +2002,7 @@ void EffectsHandlerImpl::renderScreen(EffectScreen *screen)
     renderTarget.setDevicePixelRatio(screen->devicePixelRatio());
 
     auto output = static_cast<EffectScreenImpl *>(screen)->platformOutput();
-    m_scene->prePaint(output);
+    m_scene->prePaint(output, QRegion());
     m_scene->paint(&renderTarget, output->geometry());
     m_scene->postPaint();
 }
@@ -1848,6 +2022,11 @@ qreal EffectsHandlerImpl::renderTargetScale() const
     return m_scene->renderTargetScale();
 }
 
+QRegion EffectsHandlerImpl::renderTargetChanges() const
+{
+    return m_scene->renderTargetChanges();
+}
+
 KWin::EffectWindow *EffectsHandlerImpl::inputPanel() const
 {
     if (!kwinApp()->inputMethod() || !kwinApp()->inputMethod()->isEnabled()) {
@@ -1949,6 +2128,13 @@ EffectScreen::Transform EffectScreenImpl::transform() const
     return EffectScreen::Transform(m_platformOutput->transform());
 }
 
+void EffectScreenImpl::scheduleRepaint()
+{
+    if (m_platformOutput) {
+        m_platformOutput->renderLoop()->scheduleRepaint();
+    }
+}
+
 //****************************************
 // EffectWindowImpl
 //****************************************
@@ -2239,7 +2425,9 @@ EffectWindowList EffectWindowImpl::mainWindows() const
 
 void EffectWindowImpl::setData(int role, const QVariant &data)
 {
-    if (!data.isNull()) {
+    if (isWellKnownRole(role)) {
+        setWellKnownData(role, data.isNull() ? QVariant() : data);
+    } else if (!data.isNull()) {
         dataMap[role] = data;
     } else {
         dataMap.remove(role);
@@ -2249,6 +2437,9 @@ void EffectWindowImpl::setData(int role, const QVariant &data)
 
 QVariant EffectWindowImpl::data(int role) const
 {
+    if (isWellKnownRole(role)) {
+        return wellKnownData(role);
+    }
     return dataMap.value(role);
 }
 
@@ -2539,7 +2730,7 @@ EffectFrameImpl::EffectFrameImpl(EffectFrameStyle style, bool staticSize, QPoint
     , m_view(new EffectFrameQuickScene(style, staticSize, position, alignment, nullptr))
 {
     connect(m_view, &OffscreenQuickScene::repaintNeeded, this, [this] {
-        effects->addRepaint(geometry());
+        effects->addRepaint(m_view->damage().translated(m_view->geometry().topLeft()));
     });
     connect(m_view, &OffscreenQuickScene::geometryChanged, this, [this](const QRect &oldGeometry, const QRect &newGeometry) {
         effects->addRepaint(oldGeometry);
@@ -11,6 +11,7 @@
 #ifndef KWIN_EFFECTSIMPL_H
 #define KWIN_EFFECTSIMPL_H
 
+#include "effectpaintstatistics.h"
 #include "kwineffects.h"
 
 #include "kwinoffscreenquickview.h"
@@ -18,6 +19,7 @@
 
 #include <QFont>
 #include <QHash>
+#include <QSet>
 
 #include <memory>
 
@@ -193,6 +195,18 @@ public:
     QList<EffectWindow *> elevatedWindows() const;
     QStringList activeEffects() const;
 
+    /**
+     * Returns the time each loaded effect spent in the paint hooks since profiling was enabled,
+     * not counting the effects further down the chain. The time spent by the scene itself is
+     * reported with an empty name.
+     */
+    QVector<QPair<QString, std::chrono::nanoseconds>> paintTimes() const;
+    /**
+     * Finishes the frame for @a output that was started with startPaint(). If paint profiling
+     * is enabled, the paint times of the frame are added to the statistics of each effect.
+     */
+    void endPaint(Output *output);
+
     /**
      * @returns whether or not any effect is currently active where KWin should not use direct scanout
      */
@@ -260,6 +274,7 @@ public:
     bool isCursorHidden() const override;
     QRect renderTargetRect() const override;
     qreal renderTargetScale() const override;
+    QRegion renderTargetChanges() const override;
 
     KWin::EffectWindow *inputPanel() const override;
     bool isInputPanelOverlay() const override;
@@ -279,6 +294,18 @@ public Q_SLOTS:
     Q_SCRIPTABLE QList<bool> areEffectsSupported(const QStringList &names);
     Q_SCRIPTABLE QString supportInformation(const QString &name) const;
     Q_SCRIPTABLE QString debug(const QString &name, const QString &parameter = QString()) const;
+    /**
+     * Enables measuring the time spent by each effect in the paint hooks. It's off by default,
+     * the debug console turns it on while it's open. It stays on if the KWIN_EFFECT_PAINT_BUDGET
+     * environment variable is set.
+     */
+    Q_SCRIPTABLE void setPaintProfilingEnabled(bool enabled);
+    Q_SCRIPTABLE bool isPaintProfilingEnabled() const;
+    /**
+     * Returns the paint time statistics of each effect that has painted since profiling was
+     * enabled, over its recent frames. See org.kde.kwin.Effects.xml for the entries.
+     */
+    Q_SCRIPTABLE QVariantMap paintStatistics() const;
 
 protected Q_SLOTS:
     void slotWindowShown(KWin::Window *);
@@ -333,6 +360,9 @@ protected:
 private:
     void registerPropertyType(long atom, bool reg);
     void destroyEffect(Effect *effect);
+    QString repaintSource() const;
+
+    class PaintTimer;
 
     typedef QVector<Effect *> EffectsList;
     typedef EffectsList::const_iterator EffectsIterator;
@@ -350,6 +380,16 @@ private:
     int m_trackingCursorChanges;
     std::unique_ptr<WindowPropertyNotifyX11Filter> m_x11WindowPropertyNotify;
     QList<EffectScreen *> m_effectScreens;
+    bool m_paintProfilingEnabled = false;
+    std::chrono::nanoseconds m_paintChildTime = std::chrono::nanoseconds::zero();
+    QHash<Effect *, std::chrono::nanoseconds> m_paintTimes;
+    QHash<Effect *, std::chrono::nanoseconds> m_framePaintTimes;
+    QHash<Effect *, EffectPaintStatistics> m_paintStatistics;
+    // the share of the frame budget above which an effect is reported, 0 if it's disabled
+    qreal m_paintBudgetThreshold = 0;
+    QSet<Effect *> m_overBudgetEffects;
+    // the effect that is being called in a paint pass, repaints that it schedules are its own
+    Effect *m_paintingEffect = nullptr;
 };
 
 class EffectScreenImpl : public EffectScreen
@@ -370,6 +410,7 @@ public:
     QRect geometry() const override;
     int refreshRate() const override;
     Transform transform() const override;
+    void scheduleRepaint() override;
 
     static EffectScreenImpl *get(Output *output);
 
@@ -511,6 +552,7 @@ private:
 
     Window *m_window;
     WindowItem *m_windowItem; // This one is used only during paint pass.
+    // the roles that aren't one of the DataRole values
     QHash<int, QVariant> dataMap;
     bool managed = false;
     bool m_waylandWindow;
@@ -78,6 +78,11 @@ ContrastEffect::~ContrastEffect()
     if (s_contrastManager) {
         s_contrastManagerRemoveTimer->start(1000);
     }
+
+    const EffectWindowList windows = effects->stackingOrder();
+    for (EffectWindow *window : windows) {
+        window->setData(WindowBackgroundContrastMatrixRole, QVariant());
+    }
 }
 
 void ContrastEffect::slotScreenGeometryChanged()
@@ -156,6 +161,14 @@ void ContrastEffect::updateContrastRegion(EffectWindow *w)
         }
     }
 
+    // The blur effect applies the contrast along with the blur if it can.
+    const auto colorMatrix = m_colorMatrices.constFind(w);
+    if (valid && colorMatrix != m_colorMatrices.constEnd()) {
+        w->setData(WindowBackgroundContrastMatrixRole, QVariant::fromValue(*colorMatrix));
+    } else {
+        w->setData(WindowBackgroundContrastMatrixRole, QVariant());
+    }
+
     // If the specified region is empty, enable the contrast effect for the whole window.
     if (region.isEmpty() && valid) {
         // Set the data to a dummy value.
@@ -292,9 +305,9 @@ QRegion ContrastEffect::contrastRegion(const EffectWindow *w) const
 {
     QRegion region;
 
-    const QVariant value = w->data(WindowBackgroundContrastRole);
-    if (value.isValid()) {
-        const QRegion appRegion = qvariant_cast<QRegion>(value);
+    bool isSet;
+    const QRegion appRegion = w->dataRegion(WindowBackgroundContrastRole, &isSet);
+    if (isSet) {
         if (!appRegion.isEmpty()) {
             region |= appRegion.translated(w->contentsRect().topLeft().toPoint()) & w->decorationInnerRect().toRect();
         } else {
@@ -351,7 +364,7 @@ bool ContrastEffect::shouldContrast(const EffectWindow *w, int mask, const Windo
         return false;
     }
 
-    if (effects->activeFullScreenEffect() && !w->data(WindowForceBackgroundContrastRole).toBool()) {
+    if (effects->activeFullScreenEffect() && !w->dataFlag(WindowForceBackgroundContrastRole)) {
         return false;
     }
 
@@ -359,10 +372,15 @@ bool ContrastEffect::shouldContrast(const EffectWindow *w, int mask, const Windo
         return false;
     }
 
+    // The blur effect has already applied the contrast to the blurred background.
+    if (w->dataFlag(WindowBackgroundContrastAppliedRole)) {
+        return false;
+    }
+
     bool scaled = !qFuzzyCompare(data.xScale(), 1.0) && !qFuzzyCompare(data.yScale(), 1.0);
     bool translated = data.xTranslation() || data.yTranslation();
 
-    if ((scaled || (translated || (mask & PAINT_WINDOW_TRANSFORMED))) && !w->data(WindowForceBackgroundContrastRole).toBool()) {
+    if ((scaled || (translated || (mask & PAINT_WINDOW_TRANSFORMED))) && !w->dataFlag(WindowForceBackgroundContrastRole)) {
         return false;
     }
 
@@ -455,7 +473,7 @@ void ContrastEffect::doContrast(EffectWindow *w, const QRegion &shape, const QRe
     vbo->unbindArrays();
 
     if (opacity < 1.0) {
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
     }
 
     m_shader->unbind();
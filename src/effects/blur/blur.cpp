@@ -7,6 +7,7 @@
 */
 
 #include "blur.h"
+#include "blurcomputeshader.h"
 #include "blurshader.h"
 // KConfigSkeleton
 #include "blurconfig.h"
@@ -43,6 +44,13 @@ BlurEffect::BlurEffect()
     initConfig<BlurConfig>();
     m_shader = new BlurShader(this);
 
+    if (BlurComputeShader::supported()) {
+        auto computeShader = std::make_unique<BlurComputeShader>();
+        if (computeShader->isValid()) {
+            m_computeShader = std::move(computeShader);
+        }
+    }
+
     initBlurStrengthValues();
     reconfigure(ReconfigureAll);
 
@@ -73,6 +81,7 @@ BlurEffect::BlurEffect()
     connect(effects, &EffectsHandler::windowDecorationChanged, this, &BlurEffect::setupDecorationConnections);
     connect(effects, &EffectsHandler::propertyNotify, this, &BlurEffect::slotPropertyNotify);
     connect(effects, &EffectsHandler::virtualScreenGeometryChanged, this, &BlurEffect::slotScreenGeometryChanged);
+    connect(effects, &EffectsHandler::textureMemoryLow, this, &BlurEffect::slotTextureMemoryLow);
     connect(effects, &EffectsHandler::xcbConnectionChanged, this, [this]() {
         if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
             net_wm_blur_region = effects->announceSupportProperty(s_blurAtomName, this);
@@ -93,6 +102,14 @@ BlurEffect::~BlurEffect()
         s_blurManagerRemoveTimer->start(1000);
     }
     deleteFBOs();
+
+    // The contrast effect has to apply the background contrast on its own again.
+    const EffectWindowList windows = effects->stackingOrder();
+    for (EffectWindow *window : windows) {
+        if (window->dataFlag(WindowBackgroundContrastAppliedRole)) {
+            window->setData(WindowBackgroundContrastAppliedRole, QVariant());
+        }
+    }
 }
 
 void BlurEffect::slotScreenGeometryChanged()
@@ -118,6 +135,8 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCache.clear();
+
     qDeleteAll(m_renderTargets);
     qDeleteAll(m_renderTextures);
 
@@ -145,7 +164,7 @@ void BlurEffect::updateTexture()
         glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, reinterpret_cast<GLint *>(&prevFbo));
 
         if (prevFbo != 0) {
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
         }
 
         GLenum colorEncoding = GL_LINEAR;
@@ -154,7 +173,7 @@ void BlurEffect::updateTexture()
                                               reinterpret_cast<GLint *>(&colorEncoding));
 
         if (prevFbo != 0) {
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
+            GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
         }
 
         if (colorEncoding == GL_SRGB) {
@@ -164,6 +183,7 @@ void BlurEffect::updateTexture()
 
     for (int i = 0; i <= m_downSampleIterations; i++) {
         m_renderTextures.append(new GLTexture(textureFormat, effects->virtualScreenSize() / (1 << i)));
+        m_renderTextures.constLast()->setMemoryCategory(GLTexture::MemoryCategory::Effect);
         m_renderTextures.constLast()->setFilter(GL_LINEAR);
         m_renderTextures.constLast()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -172,6 +192,7 @@ void BlurEffect::updateTexture()
 
     // This last set is used as a temporary helper texture
     m_renderTextures.append(new GLTexture(textureFormat, effects->virtualScreenSize()));
+    m_renderTextures.constLast()->setMemoryCategory(GLTexture::MemoryCategory::Effect);
     m_renderTextures.constLast()->setFilter(GL_LINEAR);
     m_renderTextures.constLast()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -343,8 +364,25 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
     updateBlurRegion(w);
 }
 
+void BlurEffect::slotTextureMemoryLow()
+{
+    // a cached blur that hasn't been painted in the last pass would have to be redone anyway
+    for (auto it = m_blurCache.begin(); it != m_blurCache.end();) {
+        if (it->second.paintPass != m_lastPaintPass.value(it->second.screen)) {
+            it = m_blurCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    if (auto cacheIt = m_blurCache.find(w); cacheIt != m_blurCache.end()) {
+        effects->makeOpenGLContextCurrent();
+        m_blurCache.erase(cacheIt);
+    }
+
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -454,9 +492,9 @@ QRegion BlurEffect::blurRegion(const EffectWindow *w) const
 {
     QRegion region;
 
-    const QVariant value = w->data(WindowBlurBehindRole);
-    if (value.isValid()) {
-        const QRegion appRegion = qvariant_cast<QRegion>(value);
+    bool isSet;
+    const QRegion appRegion = w->dataRegion(WindowBlurBehindRole, &isSet);
+    if (isSet) {
         if (!appRegion.isEmpty()) {
             if (w->decorationHasAlpha() && decorationSupportsBlurBehind(w)) {
                 region = decorationBlurRegion(w);
@@ -526,6 +564,12 @@ void BlurEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseco
 {
     m_paintedArea = QRegion();
     m_currentBlur = QRegion();
+    m_blurCandidates.clear();
+    m_sharedBlurShape = QRegion();
+
+    m_currentScreen = data.screen;
+    m_previousPaintPass = m_lastPaintPass.value(data.screen);
+    m_lastPaintPass[data.screen] = ++m_paintPass;
 
     effects->prePaintScreen(data, presentTime);
 }
@@ -564,6 +608,24 @@ void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::
     const QRegion blurArea = blurRegion(w).translated(w->pos().toPoint()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
+    if (!blurArea.isEmpty()) {
+        EffectWindow *modal = w->transientFor();
+        if (!w->isDock() && !(modal && modal->isDock())) {
+            m_blurCandidates.append(w);
+        }
+
+        // The cached blur stays valid only if the window has been painted in the previous
+        // pass on this screen and nothing underneath it has been repainted since then.
+        BlurCache &cache = m_blurCache[w];
+        if (cache.screen != m_currentScreen || cache.paintPass != m_previousPaintPass
+            || cache.area != expandedBlur || m_paintedArea.intersects(expandedBlur)) {
+            cache.dirty = true;
+        }
+        cache.screen = m_currentScreen;
+        cache.paintPass = m_paintPass;
+        cache.area = expandedBlur;
+    }
+
     // if this window or a window underneath the blurred area is painted again we have to
     // blur everything
     if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
@@ -587,7 +649,7 @@ bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintDa
         return false;
     }
 
-    if (effects->activeFullScreenEffect() && !w->data(WindowForceBlurRole).toBool()) {
+    if (effects->activeFullScreenEffect() && !w->dataFlag(WindowForceBlurRole)) {
         return false;
     }
 
@@ -598,7 +660,7 @@ bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintDa
     bool scaled = !qFuzzyCompare(data.xScale(), 1.0) && !qFuzzyCompare(data.yScale(), 1.0);
     bool translated = data.xTranslation() || data.yTranslation();
 
-    if ((scaled || (translated || (mask & PAINT_WINDOW_TRANSFORMED))) && !w->data(WindowForceBlurRole).toBool()) {
+    if ((scaled || (translated || (mask & PAINT_WINDOW_TRANSFORMED))) && !w->dataFlag(WindowForceBlurRole)) {
         return false;
     }
 
@@ -611,8 +673,47 @@ bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintDa
     return true;
 }
 
+// Windows with both blur and background contrast, e.g. panels, get the contrast applied in the final
+// upsample pass rather than in another screen copy and pass of the contrast effect. That only gives
+// the same result where the contrast effect would apply the contrast to the blurred background as
+// a whole: the whole blur shape has to be contrasted, and the blurred background must not be blended
+// with what's underneath it or encoded to sRGB before the contrast is applied.
+std::optional<QMatrix4x4> BlurEffect::backgroundContrast(const EffectWindow *w, const WindowPaintData &data) const
+{
+    const QVariant colorMatrix = w->data(WindowBackgroundContrastMatrixRole);
+    if (!colorMatrix.isValid() || !w->hasAlpha() || data.opacity() < 1.0) {
+        return std::nullopt;
+    }
+    if (effects->activeFullScreenEffect() && !w->dataFlag(WindowForceBackgroundContrastRole)) {
+        return std::nullopt;
+    }
+    if (data.xTranslation() || data.yTranslation() || data.xScale() != 1 || data.yScale() != 1) {
+        return std::nullopt;
+    }
+    if (m_renderTextures.constFirst()->internalFormat() == GL_SRGB8_ALPHA8) {
+        return std::nullopt;
+    }
+
+    bool isSet;
+    QRegion contrastRegion = w->dataRegion(WindowBackgroundContrastRole, &isSet);
+    if (!isSet) {
+        return std::nullopt;
+    }
+    if (!contrastRegion.isEmpty()) {
+        contrastRegion = contrastRegion.translated(w->contentsRect().topLeft().toPoint()) & w->decorationInnerRect().toRect();
+    } else {
+        contrastRegion = w->decorationInnerRect().toRect();
+    }
+    if (contrastRegion != blurRegion(w)) {
+        return std::nullopt;
+    }
+
+    return colorMatrix.value<QMatrix4x4>();
+}
+
 void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
+    bool contrastApplied = false;
     if (shouldBlur(w, mask, data)) {
         const QRect screen = effects->renderTargetRect();
         QRegion shape = blurRegion(w).translated(w->pos().toPoint());
@@ -640,14 +741,73 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         EffectWindow *modal = w->transientFor();
         const bool transientForIsDock = (modal ? modal->isDock() : false);
 
+        if (auto it = m_blurCache.find(w); it != m_blurCache.end()) {
+            BlurCache &cache = it->second;
+            if (cache.shape != shape || cache.renderTargetRect != screen || cache.renderTargetScale != effects->renderTargetScale()) {
+                cache.dirty = true;
+            }
+            cache.shape = shape;
+            cache.renderTargetRect = screen;
+            cache.renderTargetScale = effects->renderTargetScale();
+        }
+
+        const std::optional<QMatrix4x4> colorMatrix = backgroundContrast(w, data);
+        contrastApplied = colorMatrix.has_value();
+
         shape &= region;
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry().toRect());
+            doBlur(w, shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry().toRect(), colorMatrix.value_or(QMatrix4x4()));
         }
     }
 
+    // Tell the contrast effect whether the contrast has already been applied.
+    if (w->dataFlag(WindowBackgroundContrastAppliedRole) != contrastApplied) {
+        w->setData(WindowBackgroundContrastAppliedRole, contrastApplied ? QVariant(true) : QVariant());
+    }
+
     // Draw the window over the blurred area
     effects->drawWindow(w, mask, region, data);
+
+    // The blur of the windows above can't be shared where it depends on what has just been painted.
+    if (!m_sharedBlurShape.isEmpty()) {
+        const bool transformed = (mask & PAINT_WINDOW_TRANSFORMED) || data.xTranslation() || data.yTranslation()
+            || data.xScale() != 1 || data.yScale() != 1;
+        if (transformed || region == infiniteRegion()) {
+            m_sharedBlurShape = QRegion();
+        } else {
+            m_sharedBlurShape -= expand(region & w->expandedGeometry().toAlignedRect());
+        }
+    }
+}
+
+QRegion BlurEffect::sharedBlurShape(EffectWindow *w) const
+{
+    // The background of a window above can be blurred along with the background of @p w if neither
+    // @p w nor any window in between paints over it.
+    if (!m_blurCandidates.contains(w)) {
+        return QRegion();
+    }
+
+    QRegion shared;
+    QRegion occluded;
+    bool above = false;
+
+    const auto stackingOrder = effects->stackingOrder();
+    for (EffectWindow *window : stackingOrder) {
+        if (window == w) {
+            above = true;
+        } else if (above && m_blurCandidates.contains(window)) {
+            const QRegion shape = blurRegion(window).translated(window->pos().toPoint());
+            if (!expand(shape).intersects(occluded)) {
+                shared |= shape;
+            }
+        }
+        if (above) {
+            occluded |= window->expandedGeometry().toAlignedRect();
+        }
+    }
+
+    return shared;
 }
 
 void BlurEffect::generateNoiseTexture()
@@ -677,16 +837,21 @@ void BlurEffect::generateNoiseTexture()
     m_noiseTexture->setWrapMode(GL_REPEAT);
 }
 
-void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
+void BlurEffect::doBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, const QMatrix4x4 &colorMatrix)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
     // BUG: 393723
     const int xTranslate = -screen.x();
     const int yTranslate = effects->virtualScreenSize().height() - screen.height() - screen.y();
 
-    const QRegion expandedBlurRegion = expand(shape) & expand(screen);
+    // Windows above this one that can be blurred in the same pass share the down and upsample
+    // iterations, given that nothing is painted over their background until then.
+    const bool reuseSharedBlur = !isDock && (shape - m_sharedBlurShape).isEmpty();
+    const QRegion blurShape = isDock || reuseSharedBlur ? shape : shape | (sharedBlurShape(w) & screen);
+    const QRegion expandedBlurRegion = expand(blurShape) & expand(screen);
 
     const bool useSRGB = m_renderTextures.constFirst()->internalFormat() == GL_SRGB8_ALPHA8;
+    const bool useCompute = m_computeShader && !useSRGB;
 
     // Upload geometry for the down and upsample iterations
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
@@ -699,43 +864,102 @@ void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float o
     const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
     int blurRectCount = expandedBlurRegion.rectCount() * 6;
 
-    /*
-     * If the window is a dock or panel we avoid the "extended blur" effect.
-     * Extended blur is when windows that are not under the blurred area affect
-     * the final blur result.
-     * We want to avoid this on panels, because it looks really weird and ugly
-     * when maximized windows or windows near the panel affect the dock blur.
-     */
-    if (isDock) {
-        m_renderTargets.last()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
-        GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+    // The upsampled texture has half the size of the screen, the final pass samples the part
+    // of it that covers the expanded blur region.
+    const QRect blurredRect = (expand(shape) & expand(screen)).translated(xTranslate, yTranslate).boundingRect();
+    const QRect cachedRect = QRect(QPoint(blurredRect.left() / 2, blurredRect.top() / 2),
+                                   QPoint(blurredRect.right() / 2 + 1, blurredRect.bottom() / 2 + 1))
+                                 & QRect(QPoint(), m_renderTextures[1]->size());
+
+    auto cacheIt = m_blurCache.find(w);
+    BlurCache *cache = cacheIt != m_blurCache.end() ? &cacheIt->second : nullptr;
+
+    if (cache && !cache->dirty && cache->texture && (shape - cache->validShape).isEmpty()) {
+        // Nothing has changed behind the window, skip the down and upsample iterations.
+        GLFramebuffer::pushFramebuffer(cache->framebuffer.get());
+        m_renderTargets[1]->blitFromFramebuffer(QRect(QPoint(), cache->texture->size()), cache->validRect);
+        GLFramebuffer::popFramebuffer();
+        m_sharedBlurShape = QRegion();
 
         if (useSRGB) {
             glEnable(GL_FRAMEBUFFER_SRGB);
         }
-
-        const QRect screenRect = effects->virtualScreenGeometry();
-        QMatrix4x4 mvp;
-        mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
-        copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
     } else {
-        m_renderTargets.first()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
-        GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+        if (reuseSharedBlur) {
+            // A window underneath has already blurred this background in the current pass.
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+        } else {
+            /*
+             * If the window is a dock or panel we avoid the "extended blur" effect.
+             * Extended blur is when windows that are not under the blurred area affect
+             * the final blur result.
+             * We want to avoid this on panels, because it looks really weird and ugly
+             * when maximized windows or windows near the panel affect the dock blur.
+             */
+            if (isDock) {
+                m_renderTargets.last()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
+                if (useCompute) {
+                    GLFramebuffer::pushFramebuffer(m_renderTargets.first());
+                } else {
+                    GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+                }
+
+                if (useSRGB) {
+                    glEnable(GL_FRAMEBUFFER_SRGB);
+                }
+
+                const QRect screenRect = effects->virtualScreenGeometry();
+                QMatrix4x4 mvp;
+                mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
+                copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
+            } else if (useCompute) {
+                m_renderTargets.first()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
+            } else {
+                m_renderTargets.first()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
+                GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+
+                if (useSRGB) {
+                    glEnable(GL_FRAMEBUFFER_SRGB);
+                }
+
+                // Remove the m_renderTargets[0] from the top of the stack that we will not use
+                GLFramebuffer::popFramebuffer();
+            }
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+            if (useCompute) {
+                m_computeShader->blur(m_renderTextures, m_downSampleIterations, m_offset, expandedBlurRegion.translated(xTranslate, yTranslate));
+            } else {
+                downSampleTexture(vbo, blurRectCount);
+                upSampleTexture(vbo, blurRectCount);
+            }
+
+            m_sharedBlurShape = isDock ? QRegion() : blurShape;
         }
 
-        // Remove the m_renderTargets[0] from the top of the stack that we will not use
-        GLFramebuffer::popFramebuffer();
+        if (cache && !cachedRect.isEmpty()) {
+            if (!cache->texture || cache->texture->size() != cachedRect.size()) {
+                cache->framebuffer.reset();
+                cache->texture = std::make_unique<GLTexture>(m_renderTextures[1]->internalFormat(), cachedRect.size());
+                cache->texture->setMemoryCategory(GLTexture::MemoryCategory::Effect);
+                cache->framebuffer = std::make_unique<GLFramebuffer>(cache->texture.get());
+            }
+            if (cache->framebuffer->valid()) {
+                GLFramebuffer::pushFramebuffer(m_renderTargets[1]);
+                cache->framebuffer->blitFromFramebuffer(cachedRect, QRect(QPoint(), cachedRect.size()));
+                GLFramebuffer::popFramebuffer();
+
+                cache->validRect = cachedRect;
+                cache->validShape = shape;
+                cache->dirty = false;
+            }
+        }
     }
 
-    downSampleTexture(vbo, blurRectCount);
-    upSampleTexture(vbo, blurRectCount);
-
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
-        glEnable(GL_BLEND);
+        GLState::setBlendEnabled(true);
 #if 1 // bow shape, always above y = x
         float o = 1.0f - opacity;
         o = 1.0f - o * o;
@@ -744,17 +968,17 @@ void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float o
         o = 0.5f + o / (1.0f + qAbs(o));
 #endif
         glBlendColor(0, 0, 0, o);
-        glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+        GLState::setBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
     }
 
-    upscaleRenderToScreen(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft());
+    upscaleRenderToScreen(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft(), colorMatrix);
 
     if (useSRGB) {
         glDisable(GL_FRAMEBUFFER_SRGB);
     }
 
     if (opacity < 1.0) {
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
     }
 
     if (m_noiseStrength > 0) {
@@ -764,24 +988,24 @@ void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float o
         // The noise is applied in perceptual space (i.e. after glDisable(GL_FRAMEBUFFER_SRGB)). This practice is also
         // seen in other application of noise synthesis (films, image codecs), and makes the noise less visible overall
         // (reduces graininess).
-        glEnable(GL_BLEND);
+        GLState::setBlendEnabled(true);
         if (opacity < 1.0) {
             // We need to modulate the opacity of the noise as well; otherwise a thin layer would appear when applying
             // effects like fade out.
             // glBlendColor should have been set above.
-            glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE);
+            GLState::setBlendFunc(GL_CONSTANT_ALPHA, GL_ONE);
         } else {
             // Add the shader's output directly to the pixels in framebuffer.
-            glBlendFunc(GL_ONE, GL_ONE);
+            GLState::setBlendFunc(GL_ONE, GL_ONE);
         }
         applyNoise(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft());
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
     }
 
     vbo->unbindArrays();
 }
 
-void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition)
+void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition, const QMatrix4x4 &colorMatrix)
 {
     Q_UNUSED(windowPosition)
 
@@ -789,6 +1013,7 @@ void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int bl
 
     m_shader->bind(BlurShader::UpSampleType);
     m_shader->setTargetTextureSize(m_renderTextures[0]->size() * effects->renderTargetScale());
+    m_shader->setColorMatrix(colorMatrix);
 
     m_shader->setOffset(m_offset);
     m_shader->setModelViewProjectionMatrix(screenProjection);
@@ -848,6 +1073,7 @@ void BlurEffect::upSampleTexture(GLVertexBuffer *vbo, int blurRectCount)
 
     m_shader->bind(BlurShader::UpSampleType);
     m_shader->setOffset(m_offset);
+    m_shader->setColorMatrix(QMatrix4x4());
 
     for (int i = m_downSampleIterations - 1; i >= 1; i--) {
         modelViewProjectionMatrix.setToIdentity();
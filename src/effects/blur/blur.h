@@ -16,6 +16,9 @@
 #include <QVector2D>
 #include <QVector>
 
+#include <optional>
+#include <unordered_map>
+
 namespace KWaylandServer
 {
 class BlurManagerInterface;
@@ -26,6 +29,7 @@ namespace KWin
 
 static const int borderSize = 5;
 
+class BlurComputeShader;
 class BlurShader;
 
 class BlurEffect : public KWin::Effect
@@ -61,6 +65,7 @@ public Q_SLOTS:
     void slotWindowDeleted(KWin::EffectWindow *w);
     void slotPropertyNotify(KWin::EffectWindow *w, long atom);
     void slotScreenGeometryChanged();
+    void slotTextureMemoryLow();
     void setupDecorationConnections(EffectWindow *w);
 
 private:
@@ -74,13 +79,15 @@ private:
     QRegion decorationBlurRegion(const EffectWindow *w) const;
     bool decorationSupportsBlurBehind(const EffectWindow *w) const;
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
+    std::optional<QMatrix4x4> backgroundContrast(const EffectWindow *w, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
-    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    QRegion sharedBlurShape(EffectWindow *w) const;
+    void doBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, const QMatrix4x4 &colorMatrix);
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
 
-    void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
+    void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition, const QMatrix4x4 &colorMatrix);
     void applyNoise(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
     void downSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
     void upSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
@@ -88,6 +95,7 @@ private:
 
 private:
     BlurShader *m_shader;
+    std::unique_ptr<BlurComputeShader> m_computeShader;
     QVector<GLFramebuffer *> m_renderTargets;
     QVector<GLTexture *> m_renderTextures;
     QStack<GLFramebuffer *> m_renderTargetStack;
@@ -98,6 +106,8 @@ private:
     long net_wm_blur_region = 0;
     QRegion m_paintedArea; // keeps track of all painted areas (from bottom to top)
     QRegion m_currentBlur; // keeps track of the currently blured area of the windows(from bottom to top)
+    QVector<EffectWindow *> m_blurCandidates; // windows that may be blurred in a shared pass (from bottom to top)
+    QRegion m_sharedBlurShape; // the part of the screen m_renderTextures[1] holds the blur for
 
     int m_downSampleIterations; // number of times the texture will be downsized to half size
     int m_offset;
@@ -124,6 +134,31 @@ private:
 
     QMap<EffectWindow *, QMetaObject::Connection> windowBlurChangedConnections;
 
+    /**
+     * The blurred background of a window, it's reused as long as nothing underneath the
+     * blurred area is repainted.
+     */
+    struct BlurCache
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        EffectScreen *screen = nullptr;
+        quint64 paintPass = 0;
+        QRegion area; // the expanded blur area, as seen in prePaintWindow()
+        QRect renderTargetRect;
+        qreal renderTargetScale = 1;
+        QRegion shape; // the unclipped blur shape, as seen in drawWindow()
+        QRegion validShape; // the part of the shape the texture holds the blur for
+        QRect validRect; // where the texture goes in the upsampled render texture
+        bool dirty = true;
+    };
+
+    std::unordered_map<EffectWindow *, BlurCache> m_blurCache;
+    EffectScreen *m_currentScreen = nullptr;
+    quint64 m_paintPass = 0;
+    quint64 m_previousPaintPass = 0;
+    QHash<EffectScreen *, quint64> m_lastPaintPass;
+
     static KWaylandServer::BlurManagerInterface *s_blurManager;
     static QTimer *s_blurManagerRemoveTimer;
 };
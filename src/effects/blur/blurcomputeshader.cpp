@@ -0,0 +1,141 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "blurcomputeshader.h"
+
+#include <kwinglplatform.h>
+
+#include <QFile>
+#include <QLoggingCategory>
+
+Q_LOGGING_CATEGORY(KWIN_BLUR, "kwin_effect_blur", QtWarningMsg)
+
+namespace KWin
+{
+
+static const int s_workGroupSize = 16;
+
+BlurComputeShader::BlurComputeShader()
+{
+    m_valid = load(m_downsample, QStringLiteral(":/effects/blur/shaders/downsample.comp"))
+        && load(m_upsample, QStringLiteral(":/effects/blur/shaders/upsample.comp"));
+}
+
+BlurComputeShader::~BlurComputeShader()
+{
+    if (m_downsample.program) {
+        glDeleteProgram(m_downsample.program);
+    }
+    if (m_upsample.program) {
+        glDeleteProgram(m_upsample.program);
+    }
+}
+
+bool BlurComputeShader::supported()
+{
+    if (qEnvironmentVariableIntValue("KWIN_BLUR_NO_COMPUTE")) {
+        return false;
+    }
+    // GLTexture allocates mutable BGRA textures with OpenGL ES, they can't be bound as images.
+    const GLPlatform *platform = GLPlatform::instance();
+    return !platform->isGLES() && platform->glVersion() >= kVersionNumber(4, 3);
+}
+
+bool BlurComputeShader::load(Program &program, const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(KWIN_BLUR) << "Failed to read" << fileName;
+        return false;
+    }
+    const QByteArray source = file.readAll();
+    const char *sourceData = source.constData();
+
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shader, 1, &sourceData, nullptr);
+    glCompileShader(shader);
+
+    GLint status = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        QByteArray log(length, '\0');
+        glGetShaderInfoLog(shader, length, nullptr, log.data());
+        qCWarning(KWIN_BLUR) << "Failed to compile" << fileName << log;
+        glDeleteShader(shader);
+        return false;
+    }
+
+    program.program = glCreateProgram();
+    glAttachShader(program.program, shader);
+    glLinkProgram(program.program);
+    glDeleteShader(shader);
+
+    glGetProgramiv(program.program, GL_LINK_STATUS, &status);
+    if (!status) {
+        qCWarning(KWIN_BLUR) << "Failed to link" << fileName;
+        return false;
+    }
+
+    program.offsetLocation = glGetUniformLocation(program.program, "offset");
+    program.renderTextureSizeLocation = glGetUniformLocation(program.program, "renderTextureSize");
+    program.halfpixelLocation = glGetUniformLocation(program.program, "halfpixel");
+    program.targetRectLocation = glGetUniformLocation(program.program, "targetRect");
+    return true;
+}
+
+static QRect levelRect(const QRect &rect, int level, const QSize &levelSize)
+{
+    // Images have a bottom-left origin, same as gl_FragCoord in the fragment shaders.
+    const QRect scaled = QRect(QPoint(rect.left() >> level, rect.top() >> level),
+                               QPoint((rect.right() >> level) + 1, (rect.bottom() >> level) + 1))
+        & QRect(QPoint(), levelSize);
+    return QRect(scaled.x(), levelSize.height() - scaled.y() - scaled.height(), scaled.width(), scaled.height());
+}
+
+void BlurComputeShader::dispatch(const Program &program, float offset, GLTexture *source, GLTexture *target, const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+
+    GLState::useProgram(program.program);
+    glUniform1f(program.offsetLocation, offset);
+    glUniform2f(program.renderTextureSizeLocation, target->width(), target->height());
+    glUniform2f(program.halfpixelLocation, 0.5 / target->width(), 0.5 / target->height());
+    glUniform4i(program.targetRectLocation, rect.x(), rect.y(), rect.width(), rect.height());
+
+    GLState::activeTexture(GL_TEXTURE0);
+    source->bind();
+    glBindImageTexture(0, target->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    glDispatchCompute((rect.width() + s_workGroupSize - 1) / s_workGroupSize,
+                      (rect.height() + s_workGroupSize - 1) / s_workGroupSize, 1);
+
+    // The next iteration samples what this one has written.
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    source->unbind();
+}
+
+void BlurComputeShader::blur(const QVector<GLTexture *> &textures, int iterations, float offset, const QRegion &region)
+{
+    const QRect bounds = region.boundingRect();
+
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+    for (int i = 1; i <= iterations; i++) {
+        dispatch(m_downsample, offset, textures[i - 1], textures[i], levelRect(bounds, i, textures[i]->size()));
+    }
+    for (int i = iterations - 1; i >= 1; i--) {
+        dispatch(m_upsample, offset, textures[i + 1], textures[i], levelRect(bounds, i, textures[i]->size()));
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    GLState::useProgram(previousProgram);
+}
+
+} // namespace KWin
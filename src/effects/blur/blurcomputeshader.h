@@ -0,0 +1,64 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglutils.h>
+
+#include <QRegion>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The BlurComputeShader runs the down and upsample iterations of the dual kawase blur with
+ * compute shaders. Every iteration is a single dispatch that reads one level of the render
+ * textures and writes the next one as an image, so no framebuffer has to be bound and no
+ * geometry has to be uploaded between the iterations.
+ *
+ * It requires OpenGL 4.3. The render textures must not use an sRGB format, sRGB images
+ * cannot be written by compute shaders.
+ */
+class BlurComputeShader
+{
+public:
+    BlurComputeShader();
+    ~BlurComputeShader();
+
+    static bool supported();
+
+    bool isValid() const;
+
+    /**
+     * Downsamples the first of @a textures @a iterations times and upsamples the result back
+     * into the second texture. Only the bounding rect of @a region, in the coordinates of the
+     * first texture with a top-left origin, is processed.
+     */
+    void blur(const QVector<GLTexture *> &textures, int iterations, float offset, const QRegion &region);
+
+private:
+    struct Program
+    {
+        GLuint program = 0;
+        int offsetLocation = -1;
+        int renderTextureSizeLocation = -1;
+        int halfpixelLocation = -1;
+        int targetRectLocation = -1;
+    };
+
+    static bool load(Program &program, const QString &fileName);
+    static void dispatch(const Program &program, float offset, GLTexture *source, GLTexture *target, const QRect &rect);
+
+    Program m_downsample;
+    Program m_upsample;
+    bool m_valid = false;
+};
+
+inline bool BlurComputeShader::isValid() const
+{
+    return m_valid;
+}
+
+} // namespace KWin
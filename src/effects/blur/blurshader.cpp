@@ -55,6 +55,7 @@ BlurShader::BlurShader(QObject *parent)
         m_offsetLocationUpsample = m_shaderUpsample->uniformLocation("offset");
         m_renderTextureSizeLocationUpsample = m_shaderUpsample->uniformLocation("renderTextureSize");
         m_halfpixelLocationUpsample = m_shaderUpsample->uniformLocation("halfpixel");
+        m_colorMatrixLocationUpsample = m_shaderUpsample->uniformLocation("colorMatrix");
 
         m_mvpMatrixLocationCopysample = m_shaderCopysample->uniformLocation("modelViewProjectionMatrix");
         m_renderTextureSizeLocationCopysample = m_shaderCopysample->uniformLocation("renderTextureSize");
@@ -84,6 +85,7 @@ BlurShader::BlurShader(QObject *parent)
         m_shaderUpsample->setUniform(m_offsetLocationUpsample, float(1.0));
         m_shaderUpsample->setUniform(m_renderTextureSizeLocationUpsample, QVector2D(1.0, 1.0));
         m_shaderUpsample->setUniform(m_halfpixelLocationUpsample, QVector2D(1.0, 1.0));
+        m_shaderUpsample->setUniform(m_colorMatrixLocationUpsample, QMatrix4x4());
         ShaderManager::instance()->popShader();
 
         ShaderManager::instance()->pushShader(m_shaderCopysample.get());
@@ -261,6 +263,16 @@ void BlurShader::setBlurRect(const QRect &blurRect, const QSize &screenSize)
     m_shaderCopysample->setUniform(m_blurRectLocationCopysample, rect);
 }
 
+void BlurShader::setColorMatrix(const QMatrix4x4 &matrix)
+{
+    if (!isValid() || m_activeSampleType != UpSampleType || matrix == m_colorMatrixUpsample) {
+        return;
+    }
+
+    m_colorMatrixUpsample = matrix;
+    m_shaderUpsample->setUniform(m_colorMatrixLocationUpsample, matrix);
+}
+
 void BlurShader::bind(SampleType sampleType)
 {
     if (!isValid()) {
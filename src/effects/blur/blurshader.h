@@ -44,6 +44,7 @@ public:
     void setNoiseTextureSize(const QSize &noiseTextureSize);
     void setTexturePosition(const QPoint &texPos);
     void setBlurRect(const QRect &blurRect, const QSize &screenSize);
+    void setColorMatrix(const QMatrix4x4 &matrix);
 
 private:
     std::unique_ptr<GLShader> m_shaderDownsample;
@@ -60,6 +61,7 @@ private:
     int m_offsetLocationUpsample;
     int m_renderTextureSizeLocationUpsample;
     int m_halfpixelLocationUpsample;
+    int m_colorMatrixLocationUpsample;
 
     int m_mvpMatrixLocationCopysample;
     int m_renderTextureSizeLocationCopysample;
@@ -80,6 +82,7 @@ private:
 
     float m_offsetUpsample = 0.0;
     QMatrix4x4 m_matrixUpsample;
+    QMatrix4x4 m_colorMatrixUpsample;
 
     QMatrix4x4 m_matrixCopysample;
 
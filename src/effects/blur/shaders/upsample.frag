@@ -2,6 +2,7 @@ uniform sampler2D texUnit;
 uniform float offset;
 uniform vec2 renderTextureSize;
 uniform vec2 halfpixel;
+uniform mat4 colorMatrix;
 
 void main(void)
 {
@@ -16,5 +17,5 @@ void main(void)
     sum += texture2D(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);
     sum += texture2D(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;
 
-    gl_FragColor = sum / 12.0;
+    gl_FragColor = (sum / 12.0) * colorMatrix;
 }
@@ -4,6 +4,7 @@ uniform sampler2D texUnit;
 uniform float offset;
 uniform vec2 renderTextureSize;
 uniform vec2 halfpixel;
+uniform mat4 colorMatrix;
 
 out vec4 fragColor;
 
@@ -20,5 +21,5 @@ void main(void)
     sum += texture(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);
     sum += texture(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;
 
-    fragColor = sum / 12.0;
+    fragColor = (sum / 12.0) * colorMatrix;
 }
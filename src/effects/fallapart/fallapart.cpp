@@ -173,7 +173,7 @@ void FallApartEffect::slotWindowClosed(EffectWindow *c)
     if (!c->isVisible()) {
         return;
     }
-    const void *e = c->data(WindowClosedGrabRole).value<void *>();
+    const void *e = c->grab(WindowClosedGrabRole);
     if (e && e != this) {
         return;
     }
@@ -199,7 +199,7 @@ void GlideEffect::windowAdded(EffectWindow *w)
         return;
     }
 
-    const void *addGrab = w->data(WindowAddedGrabRole).value<void *>();
+    const void *addGrab = w->grab(WindowAddedGrabRole);
     if (addGrab && addGrab != this) {
         return;
     }
@@ -229,7 +229,7 @@ void GlideEffect::windowClosed(EffectWindow *w)
         return;
     }
 
-    const void *closeGrab = w->data(WindowClosedGrabRole).value<void *>();
+    const void *closeGrab = w->grab(WindowClosedGrabRole);
     if (closeGrab && closeGrab != this) {
         return;
     }
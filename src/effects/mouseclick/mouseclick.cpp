@@ -315,13 +315,13 @@ void MouseClickEffect::paintScreenSetupGl(int, QRegion, ScreenPaintData &data)
     shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix());
 
     glLineWidth(m_lineWidth);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void MouseClickEffect::paintScreenFinishGl(int, QRegion, ScreenPaintData &)
 {
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
 
     ShaderManager::instance()->popShader();
 }
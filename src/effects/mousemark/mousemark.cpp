@@ -76,8 +76,8 @@ void MouseMarkEffect::paintScreen(int mask, const QRegion &region, ScreenPaintDa
     }
     if (effects->isOpenGLCompositing()) {
         if (!GLPlatform::instance()->isGLES()) {
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            GLState::setBlendEnabled(true);
+            GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
             glEnable(GL_LINE_SMOOTH);
             glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
@@ -111,7 +111,7 @@ void MouseMarkEffect::paintScreen(int mask, const QRegion &region, ScreenPaintDa
         glLineWidth(1.0);
         if (!GLPlatform::instance()->isGLES()) {
             glDisable(GL_LINE_SMOOTH);
-            glDisable(GL_BLEND);
+            GLState::setBlendEnabled(false);
         }
     } else if (effects->compositingType() == QPainterCompositing) {
         QPainter *painter = effects->scenePainter();
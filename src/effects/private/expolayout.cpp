@@ -10,6 +10,12 @@
 
 #include "expolayout.h"
 
+#include <QCache>
+#include <QDataStream>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include <algorithm>
 #include <cmath>
 
 ExpoCell::ExpoCell(QObject *parent)
@@ -237,6 +243,48 @@ void ExpoCell::setBottomMargin(int margin)
     }
 }
 
+struct ExpoLayoutCell
+{
+    QString persistentKey;
+    QRect naturalRect;
+    QMargins margins;
+};
+
+/**
+ * The input of a layout, copied from the cells so the layout can be calculated on
+ * another thread.
+ */
+struct ExpoLayoutSnapshot
+{
+    ExpoLayout::LayoutMode mode;
+    QRect area;
+    int spacing;
+    int accuracy;
+    bool fillGaps;
+    QVector<ExpoLayoutCell> cells;
+
+    QByteArray key() const;
+};
+
+QByteArray ExpoLayoutSnapshot::key() const
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << uint(mode) << area << spacing << accuracy << fillGaps;
+    for (const ExpoLayoutCell &cell : cells) {
+        stream << cell.persistentKey << cell.naturalRect << cell.margins;
+    }
+    return key;
+}
+
+// Layouts stay the same as long as the windows, their geometries and the area do, so they
+// are cached across activations of the effects.
+static QCache<QByteArray, QVector<QRect>> &layoutCache()
+{
+    static QCache<QByteArray, QVector<QRect>> cache(64);
+    return cache;
+}
+
 ExpoLayout::ExpoLayout(QQuickItem *parent)
     : QQuickItem(parent)
 {
@@ -297,25 +345,106 @@ void ExpoLayout::setReady()
     }
 }
 
+static QVector<QRect> calculateWindowTransformationsClosest(const ExpoLayoutSnapshot &snapshot);
+static QVector<QRect> calculateWindowTransformationsNatural(const ExpoLayoutSnapshot &snapshot);
+static QVector<QRect> calculateWindowTransformationsPreliminary(const ExpoLayoutSnapshot &snapshot);
+
+static QVector<QRect> calculateWindowTransformations(const ExpoLayoutSnapshot &snapshot)
+{
+    switch (snapshot.mode) {
+    case ExpoLayout::LayoutClosest:
+        return calculateWindowTransformationsClosest(snapshot);
+    case ExpoLayout::LayoutNatural:
+    default:
+        return calculateWindowTransformationsNatural(snapshot);
+    }
+}
+
 void ExpoLayout::forceLayout()
 {
-    updatePolish();
+    // The layout is needed right away, e.g. to place a window that has been dropped.
+    m_layoutWatcher = nullptr;
+    if (!m_cells.isEmpty()) {
+        const ExpoLayoutSnapshot snapshot = takeSnapshot();
+        const QByteArray key = snapshot.key();
+        if (!layoutCache().contains(key)) {
+            layoutCache().insert(key, new QVector<QRect>(calculateWindowTransformations(snapshot)));
+        }
+        applyLayout(m_cells, *layoutCache().object(key));
+    }
+    setReady();
 }
 
 void ExpoLayout::updatePolish()
 {
-    if (!m_cells.isEmpty()) {
-        switch (m_mode) {
-        case LayoutClosest:
-            calculateWindowTransformationsClosest();
-            break;
-        case LayoutNatural:
-            calculateWindowTransformationsNatural();
-            break;
+    m_layoutWatcher = nullptr;
+    if (m_cells.isEmpty()) {
+        setReady();
+        return;
+    }
+
+    const ExpoLayoutSnapshot snapshot = takeSnapshot();
+    const QByteArray key = snapshot.key();
+    if (const QVector<QRect> *layout = layoutCache().object(key)) {
+        applyLayout(m_cells, *layout);
+        setReady();
+        return;
+    }
+
+    // Arranging many windows takes a while, so it is done on a worker thread. Until the layout
+    // arrives, the windows stay where they are, or, if they haven't been arranged yet, they start
+    // moving to a preliminary layout; the layout retargets their animations.
+    if (!m_ready) {
+        applyLayout(m_cells, calculateWindowTransformationsPreliminary(snapshot));
+        setReady();
+    }
+
+    auto watcher = new QFutureWatcher<QVector<QRect>>(this);
+    connect(watcher, &QFutureWatcher<QVector<QRect>>::finished, this, [this, watcher, key, cells = m_cells]() {
+        watcher->deleteLater();
+        const QVector<QRect> layout = watcher->result();
+        layoutCache().insert(key, new QVector<QRect>(layout));
+
+        // A newer layout has been started since, or the cells have changed and a new layout is
+        // about to be started.
+        if (m_layoutWatcher != watcher || m_cells != cells) {
+            return;
         }
+        m_layoutWatcher = nullptr;
+        applyLayout(m_cells, layout);
+    });
+    watcher->setFuture(QtConcurrent::run(calculateWindowTransformations, snapshot));
+    m_layoutWatcher = watcher;
+}
+
+ExpoLayoutSnapshot ExpoLayout::takeSnapshot()
+{
+    // As we are using pseudo-random movement (See "slot") we need to make sure the list
+    // is always sorted the same way no matter which window is currently active.
+    if (m_mode == LayoutNatural) {
+        std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
+            return a->persistentKey() < b->persistentKey();
+        });
     }
 
-    setReady();
+    ExpoLayoutSnapshot snapshot{m_mode, QRect(0, 0, width(), height()), m_spacing, m_accuracy, m_fillGaps, {}};
+    snapshot.cells.reserve(m_cells.count());
+    for (const ExpoCell *cell : qAsConst(m_cells)) {
+        snapshot.cells.append(ExpoLayoutCell{cell->persistentKey(), cell->naturalRect(), cell->margins()});
+    }
+    return snapshot;
+}
+
+void ExpoLayout::applyLayout(const QList<ExpoCell *> &cells, const QVector<QRect> &layout)
+{
+    for (int i = 0; i < cells.count(); ++i) {
+        ExpoCell *cell = cells[i];
+        const QRect &rect = layout[i];
+        cell->setX(rect.x());
+        cell->setY(rect.y());
+        cell->setWidth(rect.width());
+        cell->setHeight(rect.height());
+    }
 }
 
 void ExpoLayout::addCell(ExpoCell *cell)
@@ -354,10 +483,9 @@ static int distance(const QPoint &a, const QPoint &b)
     return int(std::sqrt(qreal(xdiff * xdiff + ydiff * ydiff)));
 }
 
-static QRect centered(ExpoCell *cell, const QRect &bounds)
+static QRect centered(const QSize &size, const QRect &bounds)
 {
-    const QSize scaled = QSize(cell->naturalWidth(), cell->naturalHeight())
-                             .scaled(bounds.size(), Qt::KeepAspectRatio);
+    const QSize scaled = size.scaled(bounds.size(), Qt::KeepAspectRatio);
 
     return QRect(bounds.center().x() - scaled.width() / 2,
                  bounds.center().y() - scaled.height() / 2,
@@ -365,18 +493,42 @@ static QRect centered(ExpoCell *cell, const QRect &bounds)
                  scaled.height());
 }
 
-void ExpoLayout::calculateWindowTransformationsClosest()
+static QVector<QRect> calculateWindowTransformationsPreliminary(const ExpoLayoutSnapshot &snapshot)
+{
+    // Scale the windows down as a whole, in place, until they fit the area.
+    QRect bounds;
+    for (const ExpoLayoutCell &cell : snapshot.cells) {
+        bounds |= cell.naturalRect;
+    }
+    const QRect &area = snapshot.area;
+    const qreal scale = std::min({1.0, area.width() / qreal(bounds.width()), area.height() / qreal(bounds.height())});
+    const QPointF offset = QPointF(area.center()) - QPointF(bounds.center()) * scale;
+
+    QVector<QRect> layout;
+    layout.reserve(snapshot.cells.count());
+    for (const ExpoLayoutCell &cell : snapshot.cells) {
+        const QRectF rect(cell.naturalRect.x() * scale + offset.x(),
+                          cell.naturalRect.y() * scale + offset.y(),
+                          cell.naturalRect.width() * scale,
+                          cell.naturalRect.height() * scale);
+        layout.append(centered(cell.naturalRect.size(), rect.toRect().marginsRemoved(cell.margins)));
+    }
+    return layout;
+}
+
+static QVector<QRect> calculateWindowTransformationsClosest(const ExpoLayoutSnapshot &snapshot)
 {
-    QRect area = QRect(0, 0, width(), height());
-    const int columns = int(std::ceil(std::sqrt(qreal(m_cells.count()))));
-    const int rows = int(std::ceil(m_cells.count() / qreal(columns)));
+    const QVector<ExpoLayoutCell> &cells = snapshot.cells;
+    const QRect area = snapshot.area;
+    const int columns = int(std::ceil(std::sqrt(qreal(cells.count()))));
+    const int rows = int(std::ceil(cells.count() / qreal(columns)));
 
     // Assign slots
     const int slotWidth = area.width() / columns;
     const int slotHeight = area.height() / rows;
-    QVector<ExpoCell *> takenSlots;
+    QVector<int> takenSlots;
     takenSlots.resize(rows * columns);
-    takenSlots.fill(nullptr);
+    takenSlots.fill(-1);
 
     // precalculate all slot centers
     QVector<QPoint> slotCenters;
@@ -389,18 +541,21 @@ void ExpoLayout::calculateWindowTransformationsClosest()
     }
 
     // Assign each window to the closest available slot
-    QList<ExpoCell *> tmpList = m_cells; // use a QLinkedList copy instead?
+    QList<int> tmpList;
+    for (int i = 0; i < cells.count(); ++i) {
+        tmpList.append(i);
+    }
     while (!tmpList.isEmpty()) {
-        ExpoCell *cell = tmpList.first();
+        const int cell = tmpList.first();
         int slotCandidate = -1, slotCandidateDistance = INT_MAX;
-        const QPoint pos = cell->naturalRect().center();
+        const QPoint pos = cells[cell].naturalRect.center();
 
         for (int i = 0; i < columns * rows; ++i) { // all slots
             const int dist = distance(pos, slotCenters[i]);
             if (dist < slotCandidateDistance) { // window is interested in this slot
-                ExpoCell *occupier = takenSlots[i];
+                const int occupier = takenSlots[i];
                 Q_ASSERT(occupier != cell);
-                if (!occupier || dist < distance(occupier->naturalRect().center(), slotCenters[i])) {
+                if (occupier == -1 || dist < distance(cells[occupier].naturalRect.center(), slotCenters[i])) {
                     // either nobody lives here, or we're better - takeover the slot if it's our best
                     slotCandidate = i;
                     slotCandidateDistance = dist;
@@ -408,120 +563,110 @@ void ExpoLayout::calculateWindowTransformationsClosest()
             }
         }
         Q_ASSERT(slotCandidate != -1);
-        if (takenSlots[slotCandidate]) {
+        if (takenSlots[slotCandidate] != -1) {
             tmpList << takenSlots[slotCandidate]; // occupier needs a new home now :p
         }
         tmpList.removeAll(cell);
         takenSlots[slotCandidate] = cell; // ...and we rumble in =)
     }
 
+    QVector<QRect> layout(cells.count());
     for (int slot = 0; slot < columns * rows; ++slot) {
-        ExpoCell *cell = takenSlots[slot];
-        if (!cell) { // some slots might be empty
+        if (takenSlots[slot] == -1) { // some slots might be empty
             continue;
         }
+        const ExpoLayoutCell &cell = cells[takenSlots[slot]];
+        const int naturalWidth = cell.naturalRect.width();
+        const int naturalHeight = cell.naturalRect.height();
 
         // Work out where the slot is
         QRect target(area.x() + (slot % columns) * slotWidth,
                      area.y() + (slot / columns) * slotHeight,
                      slotWidth, slotHeight);
-        target.adjust(m_spacing, m_spacing, -m_spacing, -m_spacing); // Borders
-        target = target.marginsRemoved(cell->margins());
+        target.adjust(snapshot.spacing, snapshot.spacing, -snapshot.spacing, -snapshot.spacing); // Borders
+        target = target.marginsRemoved(cell.margins);
 
         qreal scale;
-        if (target.width() / qreal(cell->naturalWidth()) < target.height() / qreal(cell->naturalHeight())) {
+        if (target.width() / qreal(naturalWidth) < target.height() / qreal(naturalHeight)) {
             // Center vertically
-            scale = target.width() / qreal(cell->naturalWidth());
-            target.moveTop(target.top() + (target.height() - int(cell->naturalHeight() * scale)) / 2);
-            target.setHeight(int(cell->naturalHeight() * scale));
+            scale = target.width() / qreal(naturalWidth);
+            target.moveTop(target.top() + (target.height() - int(naturalHeight * scale)) / 2);
+            target.setHeight(int(naturalHeight * scale));
         } else {
             // Center horizontally
-            scale = target.height() / qreal(cell->naturalHeight());
-            target.moveLeft(target.left() + (target.width() - int(cell->naturalWidth() * scale)) / 2);
-            target.setWidth(int(cell->naturalWidth() * scale));
+            scale = target.height() / qreal(naturalHeight);
+            target.moveLeft(target.left() + (target.width() - int(naturalWidth * scale)) / 2);
+            target.setWidth(int(naturalWidth * scale));
         }
         // Don't scale the windows too much
-        if (scale > 2.0 || (scale > 1.0 && (cell->naturalWidth() > 300 || cell->naturalHeight() > 300))) {
-            scale = (cell->naturalWidth() > 300 || cell->naturalHeight() > 300) ? 1.0 : 2.0;
+        if (scale > 2.0 || (scale > 1.0 && (naturalWidth > 300 || naturalHeight > 300))) {
+            scale = (naturalWidth > 300 || naturalHeight > 300) ? 1.0 : 2.0;
             target = QRect(
-                target.center().x() - int(cell->naturalWidth() * scale) / 2,
-                target.center().y() - int(cell->naturalHeight() * scale) / 2,
-                scale * cell->naturalWidth(), scale * cell->naturalHeight());
+                target.center().x() - int(naturalWidth * scale) / 2,
+                target.center().y() - int(naturalHeight * scale) / 2,
+                scale * naturalWidth, scale * naturalHeight);
         }
 
-        cell->setX(target.x());
-        cell->setY(target.y());
-        cell->setWidth(target.width());
-        cell->setHeight(target.height());
+        layout[takenSlots[slot]] = target;
     }
+    return layout;
 }
 
-static inline int heightForWidth(ExpoCell *cell, int width)
+static inline int heightForWidth(const ExpoLayoutCell &cell, int width)
 {
-    return int((width / qreal(cell->naturalWidth())) * cell->naturalHeight());
+    return int((width / qreal(cell.naturalRect.width())) * cell.naturalRect.height());
 }
 
-static bool isOverlappingAny(ExpoCell *w, const QHash<ExpoCell *, QRect> &targets, const QRegion &border, int spacing)
+static bool isOverlappingAny(int w, const QVector<QRect> &targets, const QRegion &border, int spacing)
 {
-    QHash<ExpoCell *, QRect>::const_iterator winTarget = targets.find(w);
-    if (winTarget == targets.constEnd()) {
-        return false;
-    }
-    if (border.intersects(*winTarget)) {
+    const QRect &winTarget = targets[w];
+    if (border.intersects(winTarget)) {
         return true;
     }
     const QMargins halfSpacing(spacing / 2, spacing / 2, spacing / 2, spacing / 2);
 
     // Is there a better way to do this?
-    QHash<ExpoCell *, QRect>::const_iterator target;
-    for (target = targets.constBegin(); target != targets.constEnd(); ++target) {
-        if (target == winTarget) {
+    for (int i = 0; i < targets.count(); ++i) {
+        if (i == w) {
             continue;
         }
-        if (winTarget->marginsAdded(halfSpacing).intersects(target->marginsAdded(halfSpacing))) {
+        if (winTarget.marginsAdded(halfSpacing).intersects(targets[i].marginsAdded(halfSpacing))) {
             return true;
         }
     }
     return false;
 }
 
-void ExpoLayout::calculateWindowTransformationsNatural()
+static QVector<QRect> calculateWindowTransformationsNatural(const ExpoLayoutSnapshot &snapshot)
 {
-    const QRect area = QRect(0, 0, width(), height());
-
-    // As we are using pseudo-random movement (See "slot") we need to make sure the list
-    // is always sorted the same way no matter which window is currently active.
-    std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
-        return a->persistentKey() < b->persistentKey();
-    });
+    const QVector<ExpoLayoutCell> &cells = snapshot.cells;
+    const QRect area = snapshot.area;
+    const int accuracy = snapshot.accuracy;
 
     QRect bounds;
-    int direction = 0;
-    QHash<ExpoCell *, QRect> targets;
-    QHash<ExpoCell *, int> directions;
-
-    for (ExpoCell *cell : qAsConst(m_cells)) {
-        const QRect cellRect(cell->naturalX(), cell->naturalY(), cell->naturalWidth(), cell->naturalHeight());
-        targets[cell] = cellRect;
+    QVector<QRect> targets;
+    QVector<int> directions;
+    targets.reserve(cells.count());
+    directions.reserve(cells.count());
+
+    for (int i = 0; i < cells.count(); ++i) {
+        const QRect &cellRect = cells[i].naturalRect;
+        targets.append(cellRect);
         // Reuse the unused "slot" as a preferred direction attribute. This is used when the window
         // is on the edge of the screen to try to use as much screen real estate as possible.
-        directions[cell] = direction;
+        directions.append(i % 4);
         bounds = bounds.united(cellRect);
-        direction++;
-        if (direction == 4) {
-            direction = 0;
-        }
     }
 
     // Iterate over all windows, if two overlap push them apart _slightly_ as we try to
     // brute-force the most optimal positions over many iterations.
-    const int halfSpacing = m_spacing / 2;
+    const int halfSpacing = snapshot.spacing / 2;
     bool overlap;
     do {
         overlap = false;
-        for (ExpoCell *cell : qAsConst(m_cells)) {
+        for (int cell = 0; cell < cells.count(); ++cell) {
             QRect *target_w = &targets[cell];
-            for (ExpoCell *e : qAsConst(m_cells)) {
+            for (int e = 0; e < cells.count(); ++e) {
                 if (cell == e) {
                     continue;
                 }
@@ -543,7 +688,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                     // else
                     //    diff.setX(diff.x() / 2);
                     // Approximate a vector of between 10px and 20px in magnitude in the same direction
-                    diff *= m_accuracy / qreal(diff.manhattanLength());
+                    diff *= accuracy / qreal(diff.manhattanLength());
                     // Move both windows apart
                     target_w->translate(-diff);
                     target_e->translate(diff);
@@ -582,7 +727,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                         diff = QPoint(bounds.bottomLeft() - target_w->center());
                     }
                     if (diff.x() != 0 || diff.y() != 0) {
-                        diff *= m_accuracy / qreal(diff.manhattanLength());
+                        diff *= accuracy / qreal(diff.manhattanLength());
                         target_w->translate(diff);
                     }
 
@@ -610,17 +755,15 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                    area.height() / scale);
 
     // Move all windows back onto the screen and set their scale
-    QHash<ExpoCell *, QRect>::iterator target = targets.begin();
-    while (target != targets.end()) {
-        target->setRect((target->x() - bounds.x()) * scale + area.x(),
-                        (target->y() - bounds.y()) * scale + area.y(),
-                        target->width() * scale,
-                        target->height() * scale);
-        ++target;
+    for (QRect &target : targets) {
+        target.setRect((target.x() - bounds.x()) * scale + area.x(),
+                       (target.y() - bounds.y()) * scale + area.y(),
+                       target.width() * scale,
+                       target.height() * scale);
     }
 
     // Try to fill the gaps by enlarging windows if they have the space
-    if (m_fillGaps) {
+    if (snapshot.fillGaps) {
         // Don't expand onto or over the border
         QRegion borderRegion(area.adjusted(-200, -200, 200, 200));
         borderRegion ^= area;
@@ -628,12 +771,12 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         bool moved;
         do {
             moved = false;
-            for (ExpoCell *cell : qAsConst(m_cells)) {
+            for (int cell = 0; cell < cells.count(); ++cell) {
                 QRect oldRect;
                 QRect *target = &targets[cell];
                 // This may cause some slight distortion if the windows are enlarged a large amount
-                int widthDiff = m_accuracy;
-                int heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                int widthDiff = accuracy;
+                int heightDiff = heightForWidth(cells[cell], target->width() + widthDiff) - target->height();
                 int xDiff = widthDiff / 2; // Also move a bit in the direction of the enlarge, allows the
                 int yDiff = heightDiff / 2; // center windows to be enlarged if there is gaps on the side.
 
@@ -646,11 +789,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(cell, targets, borderRegion, snapshot.spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(cells[cell], target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -660,11 +803,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(cell, targets, borderRegion, snapshot.spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(cells[cell], target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -674,11 +817,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(cell, targets, borderRegion, snapshot.spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(cells[cell], target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -688,7 +831,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(cell, targets, borderRegion, snapshot.spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -699,25 +842,25 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         // The expanding code above can actually enlarge windows over 1.0/2.0 scale, we don't like this
         // We can't add this to the loop above as it would cause a never-ending loop so we have to make
         // do with the less-than-optimal space usage with using this method.
-        for (ExpoCell *cell : qAsConst(m_cells)) {
+        for (int cell = 0; cell < cells.count(); ++cell) {
             QRect *target = &targets[cell];
-            qreal scale = target->width() / qreal(cell->naturalWidth());
-            if (scale > 2.0 || (scale > 1.0 && (cell->naturalWidth() > 300 || cell->naturalHeight() > 300))) {
-                scale = (cell->naturalWidth() > 300 || cell->naturalHeight() > 300) ? 1.0 : 2.0;
-                target->setRect(target->center().x() - int(cell->naturalWidth() * scale) / 2,
-                                target->center().y() - int(cell->naturalHeight() * scale) / 2,
-                                cell->naturalWidth() * scale,
-                                cell->naturalHeight() * scale);
+            const int naturalWidth = cells[cell].naturalRect.width();
+            const int naturalHeight = cells[cell].naturalRect.height();
+            qreal scale = target->width() / qreal(naturalWidth);
+            if (scale > 2.0 || (scale > 1.0 && (naturalWidth > 300 || naturalHeight > 300))) {
+                scale = (naturalWidth > 300 || naturalHeight > 300) ? 1.0 : 2.0;
+                target->setRect(target->center().x() - int(naturalWidth * scale) / 2,
+                                target->center().y() - int(naturalHeight * scale) / 2,
+                                naturalWidth * scale,
+                                naturalHeight * scale);
             }
         }
     }
 
-    for (ExpoCell *cell : qAsConst(m_cells)) {
-        const QRect rect = centered(cell, targets.value(cell).marginsRemoved(cell->margins()));
-
-        cell->setX(rect.x());
-        cell->setY(rect.y());
-        cell->setWidth(rect.width());
-        cell->setHeight(rect.height());
+    QVector<QRect> layout;
+    layout.reserve(cells.count());
+    for (int cell = 0; cell < cells.count(); ++cell) {
+        layout.append(centered(cells[cell].naturalRect.size(), targets[cell].marginsRemoved(cells[cell].margins)));
     }
+    return layout;
 }
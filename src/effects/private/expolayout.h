@@ -13,6 +13,7 @@
 #include <optional>
 
 class ExpoCell;
+struct ExpoLayoutSnapshot;
 
 class ExpoLayout : public QQuickItem
 {
@@ -63,10 +64,12 @@ Q_SIGNALS:
     void readyChanged();
 
 private:
-    void calculateWindowTransformationsClosest();
-    void calculateWindowTransformationsNatural();
+    ExpoLayoutSnapshot takeSnapshot();
+    void applyLayout(const QList<ExpoCell *> &cells, const QVector<QRect> &layout);
 
     QList<ExpoCell *> m_cells;
+    // The layout that is being calculated on a worker thread.
+    QObject *m_layoutWatcher = nullptr;
     LayoutMode m_mode = LayoutNatural;
     int m_accuracy = 20;
     int m_spacing = 10;
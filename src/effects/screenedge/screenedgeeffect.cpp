@@ -77,8 +77,8 @@ void ScreenEdgeEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
         }
         if (effects->isOpenGLCompositing()) {
             GLTexture *texture = glow->texture.get();
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            GLState::setBlendEnabled(true);
+            GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
             texture->bind();
             ShaderBinder binder(ShaderTrait::MapTexture | ShaderTrait::Modulate);
             const QVector4D constant(opacity, opacity, opacity, opacity);
@@ -88,7 +88,7 @@ void ScreenEdgeEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
             binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
             texture->render(glow->geometry);
             texture->unbind();
-            glDisable(GL_BLEND);
+            GLState::setBlendEnabled(false);
         } else if (effects->compositingType() == QPainterCompositing) {
             QImage tmp(glow->image->size(), QImage::Format_ARGB32_Premultiplied);
             tmp.fill(Qt::transparent);
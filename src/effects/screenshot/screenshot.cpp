@@ -17,14 +17,48 @@
 
 #include <QPainter>
 
+#include <cstring>
+
 namespace KWin
 {
 
+/**
+ * The ScreenShotReadback reads the pixels of the current framebuffer back. If possible, the
+ * pixels are copied into a pixel pack buffer and fetched once the GPU is done with it, so
+ * taking a screenshot doesn't stall the compositor.
+ */
+class ScreenShotReadback
+{
+public:
+    ScreenShotReadback(const QSize &size, qreal devicePixelRatio);
+    ~ScreenShotReadback();
+
+    static bool asyncSupported();
+
+    bool isFinished() const;
+    QImage image();
+
+private:
+    QSize m_size;
+    qreal m_devicePixelRatio;
+    GLuint m_buffer = 0;
+    GLsync m_fence = nullptr;
+    QImage m_image;
+};
+
 struct ScreenShotWindowData
 {
     QFutureInterface<QImage> promise;
     ScreenShotFlags flags;
     EffectWindow *window = nullptr;
+    QPoint origin;
+    std::shared_ptr<ScreenShotReadback> readback;
+};
+
+struct ScreenShotAreaPart
+{
+    QRect sourceRect;
+    std::shared_ptr<ScreenShotReadback> readback;
 };
 
 struct ScreenShotAreaData
@@ -34,6 +68,7 @@ struct ScreenShotAreaData
     QRect area;
     QImage result;
     QList<EffectScreen *> screens;
+    QVector<ScreenShotAreaPart> parts;
 };
 
 struct ScreenShotScreenData
@@ -41,6 +76,7 @@ struct ScreenShotScreenData
     QFutureInterface<QImage> promise;
     ScreenShotFlags flags;
     EffectScreen *screen = nullptr;
+    std::shared_ptr<ScreenShotReadback> readback;
 };
 
 static void convertFromGLImage(QImage &img, int w, int h)
@@ -73,6 +109,81 @@ static void convertFromGLImage(QImage &img, int w, int h)
     img = img.mirrored();
 }
 
+ScreenShotReadback::ScreenShotReadback(const QSize &size, qreal devicePixelRatio)
+    : m_size(size)
+    , m_devicePixelRatio(devicePixelRatio)
+{
+    if (!asyncSupported()) {
+        m_image = QImage(size, QImage::Format_ARGB32);
+        glReadnPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, m_image.sizeInBytes(),
+                      static_cast<GLvoid *>(m_image.bits()));
+        return;
+    }
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size.width() * size.height() * 4, nullptr, GL_STREAM_READ);
+    glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure that the fence gets signaled even if nothing else is rendered.
+    glFlush();
+}
+
+ScreenShotReadback::~ScreenShotReadback()
+{
+    if (m_fence) {
+        glDeleteSync(m_fence);
+    }
+    if (m_buffer) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+bool ScreenShotReadback::asyncSupported()
+{
+    static const bool supported = hasGLVersion(3, 0)
+        && (GLPlatform::instance()->isGLES() || hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+    return supported;
+}
+
+bool ScreenShotReadback::isFinished() const
+{
+    if (!m_fence) {
+        return true;
+    }
+    return glClientWaitSync(m_fence, 0, 0) != GL_TIMEOUT_EXPIRED;
+}
+
+QImage ScreenShotReadback::image()
+{
+    if (m_buffer) {
+        m_image = QImage(m_size, QImage::Format_ARGB32);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+        const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_image.sizeInBytes(), GL_MAP_READ_BIT);
+        if (pixels) {
+            memcpy(m_image.bits(), pixels, m_image.sizeInBytes());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            m_image.fill(Qt::transparent);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        glDeleteSync(m_fence);
+        m_fence = nullptr;
+    }
+
+    if (!m_image.isNull()) {
+        convertFromGLImage(m_image, m_size.width(), m_size.height());
+        m_image.setDevicePixelRatio(m_devicePixelRatio);
+    }
+    return std::exchange(m_image, QImage());
+}
+
 bool ScreenShotEffect::supported()
 {
     return effects->isOpenGLCompositing() && GLFramebuffer::supported();
@@ -85,10 +196,18 @@ ScreenShotEffect::ScreenShotEffect()
     connect(effects, &EffectsHandler::screenAdded, this, &ScreenShotEffect::handleScreenAdded);
     connect(effects, &EffectsHandler::screenRemoved, this, &ScreenShotEffect::handleScreenRemoved);
     connect(effects, &EffectsHandler::windowClosed, this, &ScreenShotEffect::handleWindowClosed);
+
+    m_readbackTimer.setSingleShot(true);
+    connect(&m_readbackTimer, &QTimer::timeout, this, [this]() {
+        effects->makeOpenGLContextCurrent();
+        finishScreenShots();
+    });
 }
 
 ScreenShotEffect::~ScreenShotEffect()
 {
+    // The pending readbacks own buffers in the OpenGL context.
+    effects->makeOpenGLContextCurrent();
     cancelWindowScreenShots();
     cancelAreaScreenShots();
     cancelScreenScreenShots();
@@ -200,21 +319,107 @@ void ScreenShotEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
     m_paintedScreen = data.screen();
     effects->paintScreen(mask, region, data);
 
-    while (!m_windowScreenShots.isEmpty()) {
-        ScreenShotWindowData screenshot = m_windowScreenShots.takeLast();
+    for (ScreenShotWindowData &screenshot : m_windowScreenShots) {
+        if (!screenshot.readback) {
+            takeScreenShot(&screenshot);
+        }
+    }
+
+    for (ScreenShotAreaData &screenshot : m_areaScreenShots) {
         takeScreenShot(&screenshot);
     }
 
+    for (ScreenShotScreenData &screenshot : m_screenScreenShots) {
+        if (!screenshot.readback) {
+            takeScreenShot(&screenshot);
+        }
+    }
+
+    finishScreenShots();
+}
+
+void ScreenShotEffect::finishScreenShots()
+{
+    bool pending = false;
+
+    for (int i = m_windowScreenShots.count() - 1; i >= 0; --i) {
+        ScreenShotWindowData &screenshot = m_windowScreenShots[i];
+        if (screenshot.promise.isCanceled()) {
+            m_windowScreenShots.removeAt(i);
+            continue;
+        }
+        if (!screenshot.readback) {
+            continue;
+        }
+        if (!screenshot.readback->isFinished()) {
+            pending = true;
+            continue;
+        }
+
+        QImage img = screenshot.readback->image();
+        if (screenshot.flags & ScreenShotIncludeCursor) {
+            grabPointerImage(img, screenshot.origin.x(), screenshot.origin.y());
+        }
+        screenshot.promise.reportResult(img);
+        screenshot.promise.reportFinished();
+        m_windowScreenShots.removeAt(i);
+    }
+
     for (int i = m_areaScreenShots.count() - 1; i >= 0; --i) {
-        if (takeScreenShot(&m_areaScreenShots[i])) {
-            m_areaScreenShots.removeAt(i);
+        ScreenShotAreaData &screenshot = m_areaScreenShots[i];
+        if (!screenshot.screens.isEmpty()) {
+            continue;
+        }
+        const bool finished = std::all_of(screenshot.parts.cbegin(), screenshot.parts.cend(), [](const ScreenShotAreaPart &part) {
+            return part.readback->isFinished();
+        });
+        if (!finished) {
+            pending = true;
+            continue;
         }
+
+        const QRect nativeArea(screenshot.area.topLeft(),
+                               screenshot.area.size() * screenshot.result.devicePixelRatio());
+
+        QPainter painter(&screenshot.result);
+        painter.setWindow(nativeArea);
+        for (const ScreenShotAreaPart &part : qAsConst(screenshot.parts)) {
+            painter.drawImage(part.sourceRect, part.readback->image());
+        }
+        painter.end();
+
+        if (screenshot.flags & ScreenShotIncludeCursor) {
+            grabPointerImage(screenshot.result, screenshot.area.x(), screenshot.area.y());
+        }
+        screenshot.promise.reportResult(screenshot.result);
+        screenshot.promise.reportFinished();
+        m_areaScreenShots.removeAt(i);
     }
 
     for (int i = m_screenScreenShots.count() - 1; i >= 0; --i) {
-        if (takeScreenShot(&m_screenScreenShots[i])) {
-            m_screenScreenShots.removeAt(i);
+        ScreenShotScreenData &screenshot = m_screenScreenShots[i];
+        if (!screenshot.readback) {
+            continue;
+        }
+        if (!screenshot.readback->isFinished()) {
+            pending = true;
+            continue;
+        }
+
+        QImage snapshot = screenshot.readback->image();
+        if (screenshot.flags & ScreenShotIncludeCursor) {
+            const int xOffset = screenshot.screen->geometry().x();
+            const int yOffset = screenshot.screen->geometry().y();
+            grabPointerImage(snapshot, xOffset, yOffset);
         }
+        screenshot.promise.reportResult(snapshot);
+        screenshot.promise.reportFinished();
+        m_screenScreenShots.removeAt(i);
+    }
+
+    // The readbacks are usually done by the next frame, but there may be no next frame.
+    if (pending) {
+        m_readbackTimer.start(std::chrono::milliseconds(4));
     }
 }
 
@@ -249,7 +454,6 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
 
         // render window into offscreen texture
         int mask = PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT;
-        QImage img;
         if (effects->isOpenGLCompositing()) {
             GLFramebuffer::pushFramebuffer(target.get());
             glClearColor(0.0, 0.0, 0.0, 0.0);
@@ -263,38 +467,26 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
             effects->drawWindow(window, mask, infiniteRegion(), d);
 
             // copy content from framebuffer into image
-            img = QImage(offscreenTexture->size(), QImage::Format_ARGB32);
-            img.setDevicePixelRatio(devicePixelRatio);
-            glReadnPixels(0, 0, img.width(), img.height(), GL_RGBA, GL_UNSIGNED_BYTE, img.sizeInBytes(),
-                          static_cast<GLvoid *>(img.bits()));
+            screenshot->readback = std::make_shared<ScreenShotReadback>(offscreenTexture->size(), devicePixelRatio);
+            screenshot->origin = geometry.topLeft().toPoint();
             GLFramebuffer::popFramebuffer();
-            convertFromGLImage(img, img.width(), img.height());
-        }
-
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(img, geometry.x(), geometry.y());
         }
-
-        screenshot->promise.reportResult(img);
-        screenshot->promise.reportFinished();
     } else {
         screenshot->promise.reportCanceled();
     }
 }
 
-bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
+void ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
 {
     if (!effects->waylandDisplay()) {
         // On X11, all screens are painted simultaneously and there is no native HiDPI support.
-        QImage snapshot = blitScreenshot(screenshot->area);
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(snapshot, screenshot->area.x(), screenshot->area.y());
+        if (screenshot->parts.isEmpty()) {
+            screenshot->parts.append(ScreenShotAreaPart{screenshot->area, blitScreenshot(screenshot->area)});
+            screenshot->screens.clear();
         }
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
     } else {
         if (!screenshot->screens.contains(m_paintedScreen)) {
-            return false;
+            return;
         }
         screenshot->screens.removeOne(m_paintedScreen);
 
@@ -304,28 +496,11 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
             sourceDevicePixelRatio = m_paintedScreen->devicePixelRatio();
         }
 
-        const QImage snapshot = blitScreenshot(sourceRect, sourceDevicePixelRatio);
-        const QRect nativeArea(screenshot->area.topLeft(),
-                               screenshot->area.size() * screenshot->result.devicePixelRatio());
-
-        QPainter painter(&screenshot->result);
-        painter.setWindow(nativeArea);
-        painter.drawImage(sourceRect, snapshot);
-        painter.end();
-
-        if (screenshot->screens.isEmpty()) {
-            if (screenshot->flags & ScreenShotIncludeCursor) {
-                grabPointerImage(screenshot->result, screenshot->area.x(), screenshot->area.y());
-            }
-            screenshot->promise.reportResult(screenshot->result);
-            screenshot->promise.reportFinished();
-        }
+        screenshot->parts.append(ScreenShotAreaPart{sourceRect, blitScreenshot(sourceRect, sourceDevicePixelRatio)});
     }
-
-    return screenshot->promise.isFinished();
 }
 
-bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
+void ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
 {
     if (!m_paintedScreen || screenshot->screen == m_paintedScreen) {
         qreal devicePixelRatio = 1.0;
@@ -333,47 +508,26 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
             devicePixelRatio = screenshot->screen->devicePixelRatio();
         }
 
-        QImage snapshot = blitScreenshot(screenshot->screen->geometry(), devicePixelRatio);
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            const int xOffset = screenshot->screen->geometry().x();
-            const int yOffset = screenshot->screen->geometry().y();
-            grabPointerImage(snapshot, xOffset, yOffset);
-        }
-
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
+        screenshot->readback = blitScreenshot(screenshot->screen->geometry(), devicePixelRatio);
     }
-
-    return screenshot->promise.isFinished();
 }
 
-QImage ScreenShotEffect::blitScreenshot(const QRect &geometry, qreal devicePixelRatio) const
+std::shared_ptr<ScreenShotReadback> ScreenShotEffect::blitScreenshot(const QRect &geometry, qreal devicePixelRatio) const
 {
-    QImage image;
-
-    if (effects->isOpenGLCompositing()) {
-        const QSize nativeSize = geometry.size() * devicePixelRatio;
-
-        if (GLFramebuffer::blitSupported() && !GLPlatform::instance()->isGLES()) {
-            image = QImage(nativeSize.width(), nativeSize.height(), QImage::Format_ARGB32);
-            GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
-            GLFramebuffer target(&texture);
-            target.blitFromFramebuffer(effects->mapToRenderTarget(geometry));
-            // copy content from framebuffer into image
-            texture.bind();
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                          static_cast<GLvoid *>(image.bits()));
-            texture.unbind();
-        } else {
-            image = QImage(nativeSize.width(), nativeSize.height(), QImage::Format_ARGB32);
-            glReadPixels(0, 0, nativeSize.width(), nativeSize.height(), GL_RGBA,
-                         GL_UNSIGNED_BYTE, static_cast<GLvoid *>(image.bits()));
-        }
-        convertFromGLImage(image, nativeSize.width(), nativeSize.height());
+    const QSize nativeSize = geometry.size() * devicePixelRatio;
+
+    if (GLFramebuffer::blitSupported() && !GLPlatform::instance()->isGLES()) {
+        GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
+        GLFramebuffer target(&texture);
+        target.blitFromFramebuffer(effects->mapToRenderTarget(geometry));
+        // copy content from framebuffer into image
+        GLFramebuffer::pushFramebuffer(&target);
+        auto readback = std::make_shared<ScreenShotReadback>(nativeSize, devicePixelRatio);
+        GLFramebuffer::popFramebuffer();
+        return readback;
+    } else {
+        return std::make_shared<ScreenShotReadback>(nativeSize, devicePixelRatio);
     }
-
-    image.setDevicePixelRatio(devicePixelRatio);
-    return image;
 }
 
 void ScreenShotEffect::grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const
@@ -405,11 +559,13 @@ int ScreenShotEffect::requestedEffectChainPosition() const
 
 void ScreenShotEffect::handleScreenAdded()
 {
+    effects->makeOpenGLContextCurrent();
     cancelAreaScreenShots();
 }
 
 void ScreenShotEffect::handleScreenRemoved(EffectScreen *screen)
 {
+    effects->makeOpenGLContextCurrent();
     cancelAreaScreenShots();
 
     for (int i = m_screenScreenShots.count() - 1; i >= 0; --i) {
@@ -422,6 +578,7 @@ void ScreenShotEffect::handleScreenRemoved(EffectScreen *screen)
 
 void ScreenShotEffect::handleWindowClosed(EffectWindow *window)
 {
+    effects->makeOpenGLContextCurrent();
     for (int i = m_windowScreenShots.count() - 1; i >= 0; --i) {
         if (m_windowScreenShots[i].window == window) {
             m_windowScreenShots[i].promise.reportCanceled();
@@ -16,6 +16,9 @@
 #include <QFutureInterface>
 #include <QImage>
 #include <QObject>
+#include <QTimer>
+
+#include <memory>
 
 namespace KWin
 {
@@ -32,6 +35,7 @@ Q_DECLARE_FLAGS(ScreenShotFlags, ScreenShotFlag)
 
 class ScreenShotDBusInterface1;
 class ScreenShotDBusInterface2;
+class ScreenShotReadback;
 struct ScreenShotWindowData;
 struct ScreenShotAreaData;
 struct ScreenShotScreenData;
@@ -85,15 +89,16 @@ private Q_SLOTS:
 
 private:
     void takeScreenShot(ScreenShotWindowData *screenshot);
-    bool takeScreenShot(ScreenShotAreaData *screenshot);
-    bool takeScreenShot(ScreenShotScreenData *screenshot);
+    void takeScreenShot(ScreenShotAreaData *screenshot);
+    void takeScreenShot(ScreenShotScreenData *screenshot);
+    void finishScreenShots();
 
     void cancelWindowScreenShots();
     void cancelAreaScreenShots();
     void cancelScreenScreenShots();
 
     void grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const;
-    QImage blitScreenshot(const QRect &geometry, qreal devicePixelRatio = 1.0) const;
+    std::shared_ptr<ScreenShotReadback> blitScreenshot(const QRect &geometry, qreal devicePixelRatio = 1.0) const;
 
     QVector<ScreenShotWindowData> m_windowScreenShots;
     QVector<ScreenShotAreaData> m_areaScreenShots;
@@ -102,6 +107,7 @@ private:
     std::unique_ptr<ScreenShotDBusInterface1> m_dbusInterface1;
     std::unique_ptr<ScreenShotDBusInterface2> m_dbusInterface2;
     EffectScreen *m_paintedScreen = nullptr;
+    QTimer m_readbackTimer;
 };
 
 } // namespace KWin
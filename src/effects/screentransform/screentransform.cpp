@@ -206,9 +206,9 @@ void ScreenTransformEffect::paintScreen(int mask, const QRegion &region, KWin::S
     modelViewProjectionMatrix.rotate(angle, 0, 0, 1);
     modelViewProjectionMatrix.translate(-transformOrigin);
 
-    glActiveTexture(GL_TEXTURE1);
+    GLState::activeTexture(GL_TEXTURE1);
     it->m_prev.texture->bind();
-    glActiveTexture(GL_TEXTURE0);
+    GLState::activeTexture(GL_TEXTURE0);
     it->m_current.texture->bind();
 
     // Clear the background.
@@ -228,9 +228,9 @@ void ScreenTransformEffect::paintScreen(int mask, const QRegion &region, KWin::S
     vbo->unbindArrays();
     sm->popShader();
 
-    glActiveTexture(GL_TEXTURE1);
+    GLState::activeTexture(GL_TEXTURE1);
     it->m_prev.texture->unbind();
-    glActiveTexture(GL_TEXTURE0);
+    GLState::activeTexture(GL_TEXTURE0);
     it->m_current.texture->unbind();
 
     effects->addRepaintFull();
@@ -18,6 +18,8 @@
 #include <QAction>
 #include <QPainter>
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -31,6 +33,10 @@ static const QVector<QColor> s_colors{
     Qt::yellow,
     Qt::gray};
 
+static const int s_heatCellSize = 64;
+static const int s_heatLevels = 8;
+static const auto s_heatInterval = std::chrono::seconds(1);
+
 ShowPaintEffect::ShowPaintEffect()
 {
     auto *toggleAction = new QAction(this);
@@ -41,43 +47,70 @@ ShowPaintEffect::ShowPaintEffect()
     effects->registerGlobalShortcut({}, toggleAction);
 
     connect(toggleAction, &QAction::triggered, this, &ShowPaintEffect::toggle);
+
+    auto *toggleHeatmapAction = new QAction(this);
+    toggleHeatmapAction->setObjectName(QStringLiteral("ToggleHeatmap"));
+    toggleHeatmapAction->setText(i18n("Toggle Repaint Heatmap"));
+    KGlobalAccel::self()->setDefaultShortcut(toggleHeatmapAction, {});
+    KGlobalAccel::self()->setShortcut(toggleHeatmapAction, {});
+    effects->registerGlobalShortcut({}, toggleHeatmapAction);
+
+    connect(toggleHeatmapAction, &QAction::triggered, this, &ShowPaintEffect::toggleHeatmap);
 }
 
 void ShowPaintEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
     m_painted = QRegion();
     effects->paintScreen(mask, region, data);
-    if (effects->isOpenGLCompositing()) {
-        paintGL(data.projectionMatrix());
-    } else if (effects->compositingType() == QPainterCompositing) {
-        paintQPainter();
+    if (m_heatmap) {
+        accumulateHeat(data.screen());
+        paintHeatmap(data.projectionMatrix());
+        return;
     }
+    QColor color = s_colors[m_colorIndex];
+    color.setAlphaF(s_alpha);
+    paint(m_painted, color, data.projectionMatrix());
     if (++m_colorIndex == s_colors.count()) {
         m_colorIndex = 0;
     }
 }
 
+void ShowPaintEffect::postPaintScreen()
+{
+    if (m_heatmap && std::chrono::steady_clock::now() - m_heatStart >= s_heatInterval) {
+        updateHeat();
+    }
+    effects->postPaintScreen();
+}
+
 void ShowPaintEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowPaintData &data)
 {
     m_painted |= region;
     effects->paintWindow(w, mask, region, data);
 }
 
-void ShowPaintEffect::paintGL(const QMatrix4x4 &projection)
+void ShowPaintEffect::paint(const QRegion &region, const QColor &color, const QMatrix4x4 &projection)
+{
+    if (effects->isOpenGLCompositing()) {
+        paintGL(region, color, projection);
+    } else if (effects->compositingType() == QPainterCompositing) {
+        paintQPainter(region, color);
+    }
+}
+
+void ShowPaintEffect::paintGL(const QRegion &region, const QColor &color, const QMatrix4x4 &projection)
 {
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
     vbo->reset();
     vbo->setUseColor(true);
     ShaderBinder binder(ShaderTrait::UniformColor);
     binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projection);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    QColor color = s_colors[m_colorIndex];
-    color.setAlphaF(s_alpha);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     vbo->setColor(color);
     QVector<float> verts;
-    verts.reserve(m_painted.rectCount() * 12);
-    for (const QRect &r : m_painted) {
+    verts.reserve(region.rectCount() * 12);
+    for (const QRect &r : region) {
         verts << r.x() + r.width() << r.y();
         verts << r.x() << r.y();
         verts << r.x() << r.y() + r.height();
@@ -87,26 +120,124 @@ void ShowPaintEffect::paintGL(const QMatrix4x4 &projection)
     }
     vbo->setData(verts.count() / 2, 2, verts.data(), nullptr);
     vbo->render(GL_TRIANGLES);
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
 }
 
-void ShowPaintEffect::paintQPainter()
+void ShowPaintEffect::paintQPainter(const QRegion &region, const QColor &color)
 {
-    QColor color = s_colors[m_colorIndex];
-    color.setAlphaF(s_alpha);
-    for (const QRect &r : m_painted) {
+    for (const QRect &r : region) {
         effects->scenePainter()->fillRect(r, color);
     }
 }
 
+void ShowPaintEffect::paintHeatmap(const QMatrix4x4 &projection)
+{
+    // The cells are grouped by their level of heat, from cold blue to hot red, and drawn only
+    // where the screen has been painted, elsewhere the heatmap of the previous frames stays.
+    QVector<QRegion> levels(s_heatLevels);
+    for (int row = 0; row < m_heatRows; ++row) {
+        for (int column = 0; column < m_heatColumns; ++column) {
+            const qreal heat = m_heat[row * m_heatColumns + column];
+            if (heat > 0) {
+                const int level = std::min(int(heat * s_heatLevels), s_heatLevels - 1);
+                levels[level] += QRect(m_heatGeometry.x() + column * s_heatCellSize,
+                                       m_heatGeometry.y() + row * s_heatCellSize,
+                                       s_heatCellSize, s_heatCellSize);
+            }
+        }
+    }
+    for (int level = 0; level < s_heatLevels; ++level) {
+        const QRegion region = levels[level] & m_painted;
+        if (region.isEmpty()) {
+            continue;
+        }
+        const qreal heat = qreal(level) / (s_heatLevels - 1);
+        paint(region, QColor::fromHsvF((1 - heat) * 2 / 3, 1, 1, 0.2 + 0.4 * heat), projection);
+    }
+}
+
+void ShowPaintEffect::accumulateHeat(EffectScreen *screen)
+{
+    if (m_heatGeometry != effects->virtualScreenGeometry()) {
+        resetHeat();
+    }
+    if (m_refreshingScreens.remove(screen)) {
+        return;
+    }
+    for (QRect rect : m_painted) {
+        rect = rect.intersected(m_heatGeometry).translated(-m_heatGeometry.topLeft());
+        if (rect.isEmpty()) {
+            continue;
+        }
+        const int lastColumn = rect.right() / s_heatCellSize;
+        const int lastRow = rect.bottom() / s_heatCellSize;
+        for (int row = rect.top() / s_heatCellSize; row <= lastRow; ++row) {
+            for (int column = rect.left() / s_heatCellSize; column <= lastColumn; ++column) {
+                const QRect cell(column * s_heatCellSize, row * s_heatCellSize, s_heatCellSize, s_heatCellSize);
+                const QRect painted = cell.intersected(rect);
+                m_paintedPixels[row * m_heatColumns + column] += quint64(painted.width()) * painted.height();
+            }
+        }
+    }
+}
+
+void ShowPaintEffect::updateHeat()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const qreal seconds = std::chrono::duration<qreal>(now - m_heatStart).count();
+
+    for (int row = 0; row < m_heatRows; ++row) {
+        for (int column = 0; column < m_heatColumns; ++column) {
+            const QRect cell = QRect(m_heatGeometry.x() + column * s_heatCellSize,
+                                     m_heatGeometry.y() + row * s_heatCellSize,
+                                     s_heatCellSize, s_heatCellSize)
+                                   .intersected(m_heatGeometry);
+            const EffectScreen *screen = effects->screenAt(cell.center());
+            const qreal refreshRate = screen ? screen->refreshRate() / 1000.0 : 60.0;
+            const qreal frames = refreshRate * seconds * cell.width() * cell.height();
+            const int index = row * m_heatColumns + column;
+            m_heat[index] = frames > 0 ? std::min(m_paintedPixels[index] / frames, 1.0) : 0.0;
+        }
+    }
+    m_paintedPixels.fill(0);
+    m_heatStart = now;
+
+    // Repaint the whole heatmap to show the new heat, the cells that aren't painted otherwise too.
+    const auto screens = effects->screens();
+    m_refreshingScreens = QSet<EffectScreen *>(screens.begin(), screens.end());
+    effects->addRepaintFull();
+}
+
+void ShowPaintEffect::resetHeat()
+{
+    m_heatGeometry = effects->virtualScreenGeometry();
+    m_heatColumns = (m_heatGeometry.width() + s_heatCellSize - 1) / s_heatCellSize;
+    m_heatRows = (m_heatGeometry.height() + s_heatCellSize - 1) / s_heatCellSize;
+    m_paintedPixels = QVector<quint64>(m_heatColumns * m_heatRows, 0);
+    m_heat = QVector<qreal>(m_heatColumns * m_heatRows, 0.0);
+    m_heatStart = std::chrono::steady_clock::now();
+    m_refreshingScreens.clear();
+}
+
 bool ShowPaintEffect::isActive() const
 {
-    return m_active;
+    return m_active || m_heatmap;
 }
 
 void ShowPaintEffect::toggle()
 {
     m_active = !m_active;
+    m_heatmap = false;
+    effects->addRepaintFull();
+}
+
+void ShowPaintEffect::toggleHeatmap()
+{
+    m_heatmap = !m_heatmap;
+    m_active = false;
+    if (m_heatmap) {
+        resetHeat();
+    }
     effects->addRepaintFull();
 }
 
@@ -12,6 +12,10 @@
 
 #include <kwineffects.h>
 
+#include <QSet>
+
+#include <chrono>
+
 namespace KWin
 {
 
@@ -23,20 +27,39 @@ public:
     ShowPaintEffect();
 
     void paintScreen(int mask, const QRegion &region, ScreenPaintData &data) override;
+    void postPaintScreen() override;
     void paintWindow(EffectWindow *w, int mask, QRegion region, WindowPaintData &data) override;
 
     bool isActive() const override;
 
 private Q_SLOTS:
     void toggle();
+    void toggleHeatmap();
 
 private:
-    void paintGL(const QMatrix4x4 &projection);
-    void paintQPainter();
+    void paint(const QRegion &region, const QColor &color, const QMatrix4x4 &projection);
+    void paintGL(const QRegion &region, const QColor &color, const QMatrix4x4 &projection);
+    void paintQPainter(const QRegion &region, const QColor &color);
+    void paintHeatmap(const QMatrix4x4 &projection);
+    void accumulateHeat(EffectScreen *screen);
+    void updateHeat();
+    void resetHeat();
 
     bool m_active = false;
     QRegion m_painted; // what's painted in one pass
     int m_colorIndex = 0;
+
+    // The heatmap shows how often the cells of a grid over the screens have been painted in
+    // the last second, as a fraction of the refresh rate.
+    bool m_heatmap = false;
+    QRect m_heatGeometry;
+    int m_heatColumns = 0;
+    int m_heatRows = 0;
+    QVector<quint64> m_paintedPixels; // per cell, since m_heatStart
+    QVector<qreal> m_heat; // per cell, in the last second
+    std::chrono::steady_clock::time_point m_heatStart;
+    // the screens that repaint the whole heatmap, these frames aren't counted
+    QSet<EffectScreen *> m_refreshingScreens;
 };
 
 } // namespace KWin
@@ -40,6 +40,12 @@ ShowPaintEffectConfig::ShowPaintEffectConfig(QWidget *parent, const QVariantList
     KGlobalAccel::self()->setDefaultShortcut(toggleAction, {});
     KGlobalAccel::self()->setShortcut(toggleAction, {});
 
+    QAction *toggleHeatmapAction = actionCollection->addAction(QStringLiteral("ToggleHeatmap"));
+    toggleHeatmapAction->setText(i18n("Toggle Repaint Heatmap"));
+    toggleHeatmapAction->setProperty("isConfigurationAction", true);
+    KGlobalAccel::self()->setDefaultShortcut(toggleHeatmapAction, {});
+    KGlobalAccel::self()->setShortcut(toggleHeatmapAction, {});
+
     m_ui->shortcutsEditor->addCollection(actionCollection);
 
     connect(m_ui->shortcutsEditor, &KShortcutsEditor::keyChange,
@@ -41,6 +41,24 @@ SlideEffect::SlideEffect()
             this, &SlideEffect::finishedSwitching);
     connect(effects, &EffectsHandler::screenRemoved,
             this, &SlideEffect::finishedSwitching);
+    connect(effects, &EffectsHandler::windowDamaged,
+            this, &SlideEffect::windowChanged);
+    connect(effects, &EffectsHandler::windowOpacityChanged,
+            this, &SlideEffect::windowChanged);
+    connect(effects, &EffectsHandler::windowMinimized,
+            this, &SlideEffect::windowChanged);
+    connect(effects, &EffectsHandler::windowUnminimized,
+            this, &SlideEffect::windowChanged);
+    connect(effects, &EffectsHandler::windowClosed,
+            this, &SlideEffect::windowChanged);
+    connect(effects, &EffectsHandler::windowFrameGeometryChanged,
+            this, &SlideEffect::windowFrameGeometryChanged);
+    connect(effects, &EffectsHandler::desktopPresenceChanged, this, [this]() {
+        addSnapshotDamage();
+    });
+    connect(effects, &EffectsHandler::stackingOrderChanged, this, [this]() {
+        addSnapshotDamage();
+    });
 
     m_currentPosition = effects->desktopGridCoords(effects->currentDesktop());
 }
@@ -69,6 +87,7 @@ void SlideEffect::reconfigure(ReconfigureFlags)
     m_vGap = SlideConfig::verticalGap();
     m_slideDocks = SlideConfig::slideDocks();
     m_slideBackground = SlideConfig::slideBackground();
+    m_snapshotDesktops = SlideConfig::snapshotDesktops();
 }
 
 inline QRegion buildClipRegion(const QPoint &pos, int w, int h)
@@ -156,9 +175,41 @@ void SlideEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &
         }
     }
 
+    m_paintCtx.useSnapshots = m_snapshotDesktops && m_snapshotsSupported && effects->isOpenGLCompositing();
+    m_paintCtx.snapshotsPainted = false;
+    if (m_paintCtx.useSnapshots) {
+        updateSnapshots(region);
+    }
+
     effects->paintScreen(mask, region, data);
 }
 
+/**
+ * Returns the position of the given @p desktop relative to the current position, in desktops.
+ */
+QPointF SlideEffect::desktopTranslation(int desktop) const
+{
+    const int gridWidth = effects->desktopGridWidth();
+    const int gridHeight = effects->desktopGridHeight();
+
+    QPointF drawPosition = forcePositivePosition(m_currentPosition);
+    drawPosition = m_paintCtx.wrap ? constrainToDrawableRange(drawPosition) : drawPosition;
+
+    // If we're wrapping, draw the desktop in the second position.
+    const bool wrappingX = drawPosition.x() > gridWidth - 1;
+    const bool wrappingY = drawPosition.y() > gridHeight - 1;
+
+    QPointF translation = QPointF(effects->desktopGridCoords(desktop)) - drawPosition;
+    // Decide if that first desktop should be drawn at 0 or the higher position used for wrapping.
+    if (effects->desktopGridCoords(desktop).x() == 0 && wrappingX) {
+        translation = QPointF(translation.x() + gridWidth, translation.y());
+    }
+    if (effects->desktopGridCoords(desktop).y() == 0 && wrappingY) {
+        translation = QPointF(translation.x(), translation.y() + gridHeight);
+    }
+    return translation;
+}
+
 QPoint SlideEffect::getDrawCoords(QPointF pos, EffectScreen *screen)
 {
     QPoint c = QPoint();
@@ -249,15 +300,14 @@ void SlideEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowP
         return;
     }
 
-    const int gridWidth = effects->desktopGridWidth();
-    const int gridHeight = effects->desktopGridHeight();
-
-    QPointF drawPosition = forcePositivePosition(m_currentPosition);
-    drawPosition = m_paintCtx.wrap ? constrainToDrawableRange(drawPosition) : drawPosition;
-
-    // If we're wrapping, draw the desktop in the second position.
-    const bool wrappingX = drawPosition.x() > gridWidth - 1;
-    const bool wrappingY = drawPosition.y() > gridHeight - 1;
+    // The translated windows are in the snapshots, they're painted all at once.
+    if (m_paintCtx.useSnapshots) {
+        if (!m_paintCtx.snapshotsPainted) {
+            paintSnapshots(region, data);
+            m_paintCtx.snapshotsPainted = true;
+        }
+        return;
+    }
 
     const auto screens = effects->screens();
 
@@ -265,17 +315,10 @@ void SlideEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowP
         if (!isPainted(desktop, w)) {
             continue;
         }
-        QPointF desktopTranslation = QPointF(effects->desktopGridCoords(desktop)) - drawPosition;
-        // Decide if that first desktop should be drawn at 0 or the higher position used for wrapping.
-        if (effects->desktopGridCoords(desktop).x() == 0 && wrappingX) {
-            desktopTranslation = QPointF(desktopTranslation.x() + gridWidth, desktopTranslation.y());
-        }
-        if (effects->desktopGridCoords(desktop).y() == 0 && wrappingY) {
-            desktopTranslation = QPointF(desktopTranslation.x(), desktopTranslation.y() + gridHeight);
-        }
+        const QPointF translation = desktopTranslation(desktop);
 
         for (EffectScreen *screen : screens) {
-            QPoint drawTranslation = getDrawCoords(desktopTranslation, screen);
+            QPoint drawTranslation = getDrawCoords(translation, screen);
             data += drawTranslation;
 
             const QRect screenArea = screen->geometry();
@@ -304,6 +347,165 @@ void SlideEffect::postPaintScreen()
     effects->postPaintScreen();
 }
 
+/**
+ * Renders the snapshots of the visible desktops on the screens in @p region that are out of date.
+ */
+void SlideEffect::updateSnapshots(const QRegion &region)
+{
+    const auto screens = effects->screens();
+    for (int desktop : qAsConst(m_paintCtx.visibleDesktops)) {
+        for (EffectScreen *screen : screens) {
+            const QRect screenArea = screen->geometry();
+            if (!region.intersects(screenArea)) {
+                continue;
+            }
+
+            const QSize size = (QSizeF(screenArea.size()) * screen->devicePixelRatio()).toSize();
+            Snapshot &snapshot = m_snapshots[{desktop, screen}];
+            if (!snapshot.texture || snapshot.texture->size() != size) {
+                snapshot.framebuffer.reset();
+                snapshot.texture = std::make_unique<GLTexture>(GL_RGBA8, size);
+                snapshot.texture->setMemoryCategory(GLTexture::MemoryCategory::Effect);
+                snapshot.texture->setFilter(GL_LINEAR);
+                snapshot.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+                snapshot.framebuffer = std::make_unique<GLFramebuffer>(snapshot.texture.get());
+                snapshot.damage = screenArea;
+            }
+            if (!snapshot.framebuffer->valid()) {
+                // Fall back to painting the windows.
+                m_snapshotsSupported = false;
+                m_paintCtx.useSnapshots = false;
+                discardSnapshots();
+                return;
+            }
+
+            const QRect rect = (snapshot.damage & screenArea).boundingRect();
+            snapshot.damage = QRegion();
+            if (!rect.isEmpty()) {
+                renderSnapshot(desktop, screen, rect);
+            }
+        }
+    }
+}
+
+/**
+ * Renders the part @p rect, in global coordinates, of the snapshot of @p desktop on @p screen.
+ */
+void SlideEffect::renderSnapshot(int desktop, EffectScreen *screen, const QRect &rect)
+{
+    const Snapshot &snapshot = m_snapshots[{desktop, screen}];
+    const QRect screenArea = screen->geometry();
+    const qreal scale = screen->devicePixelRatio();
+
+    GLFramebuffer::pushFramebuffer(snapshot.framebuffer.get());
+
+    // The framebuffer has its origin in the bottom left corner.
+    GLState::setScissorEnabled(true);
+    glScissor(std::floor((rect.x() - screenArea.x()) * scale),
+              std::floor((screenArea.y() + screenArea.height() - rect.y() - rect.height()) * scale),
+              std::ceil(rect.width() * scale),
+              std::ceil(rect.height() * scale));
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(screenArea);
+
+    const auto windows = effects->stackingOrder();
+    for (EffectWindow *w : windows) {
+        if (!isTranslated(w) || !isPainted(desktop, w)) {
+            continue;
+        }
+        if (w->isMinimized() || !w->isOnCurrentActivity() || !w->expandedGeometry().intersects(rect)) {
+            continue;
+        }
+        WindowPaintData data;
+        data.setProjectionMatrix(projectionMatrix);
+        effects->renderWindow(w, PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT, infiniteRegion(), data);
+    }
+
+    GLState::setScissorEnabled(false);
+    GLFramebuffer::popFramebuffer();
+}
+
+/**
+ * Paints the snapshots of the visible desktops at their current positions. The snapshots take
+ * the place of the bottom-most translated window in the stacking order.
+ */
+void SlideEffect::paintSnapshots(const QRegion &region, const WindowPaintData &data)
+{
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setScissorEnabled(true);
+
+    const auto screens = effects->screens();
+    for (int desktop : qAsConst(m_paintCtx.visibleDesktops)) {
+        const QPointF translation = desktopTranslation(desktop);
+
+        for (EffectScreen *screen : screens) {
+            const auto it = m_snapshots.find({desktop, screen});
+            if (it == m_snapshots.end()) {
+                continue;
+            }
+
+            const QRect screenArea = screen->geometry();
+            const QRect target = screenArea.translated(getDrawCoords(translation, screen));
+            const QRegion clip = region & target & screenArea;
+            if (clip.isEmpty()) {
+                continue;
+            }
+
+            QMatrix4x4 mvp = data.screenProjectionMatrix();
+            mvp.translate(target.x(), target.y());
+            binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+            GLTexture *texture = it->second.texture.get();
+            texture->bind();
+            texture->render(effects->mapToRenderTarget(clip), QRect(QPoint(0, 0), screenArea.size()), true);
+            texture->unbind();
+        }
+    }
+
+    GLState::setScissorEnabled(false);
+    GLState::setBlendEnabled(false);
+}
+
+/**
+ * Marks the area @p rect of the snapshots that the window @p w is painted in as out of date.
+ */
+void SlideEffect::addSnapshotDamage(const EffectWindow *w, const QRectF &rect)
+{
+    if (!isTranslated(w)) {
+        return;
+    }
+    const QRect damage = rect.toAlignedRect();
+    for (auto &[key, snapshot] : m_snapshots) {
+        if (isPainted(key.first, w)) {
+            snapshot.damage += damage;
+        }
+    }
+}
+
+/**
+ * Marks all snapshots as out of date.
+ */
+void SlideEffect::addSnapshotDamage()
+{
+    for (auto &[key, snapshot] : m_snapshots) {
+        snapshot.damage = key.second->geometry();
+    }
+}
+
+void SlideEffect::discardSnapshots()
+{
+    if (m_snapshots.empty()) {
+        return;
+    }
+    effects->makeOpenGLContextCurrent();
+    m_snapshots.clear();
+}
+
 /*
  * Negative desktop positions aren't allowed.
  */
@@ -340,7 +542,10 @@ void SlideEffect::startAnimation(int old, int current, EffectWindow *movingWindo
     }
 
     m_state = State::ActiveAnimation;
-    m_movingWindow = movingWindow;
+    if (m_movingWindow != movingWindow) {
+        m_movingWindow = movingWindow;
+        addSnapshotDamage();
+    }
 
     m_startPos = m_currentPosition;
     m_endPos = effects->desktopGridCoords(current);
@@ -395,6 +600,8 @@ void SlideEffect::finishedSwitching()
 
     m_windowData.clear();
     m_paintCtx.fullscreenWindows.clear();
+    discardSnapshots();
+    m_snapshotsSupported = true;
     m_movingWindow = nullptr;
     m_state = State::Inactive;
     m_lastPresentTime = std::chrono::milliseconds::zero();
@@ -423,7 +630,10 @@ void SlideEffect::desktopChanging(uint old, QPointF desktopOffset, EffectWindow
     }
 
     m_state = State::ActiveGesture;
-    m_movingWindow = with;
+    if (m_movingWindow != with) {
+        m_movingWindow = with;
+        addSnapshotDamage();
+    }
 
     // Find desktop position based on animationDelta
     QPoint gridPos = effects->desktopGridCoords(old);
@@ -481,6 +691,7 @@ void SlideEffect::windowAdded(EffectWindow *w)
     m_windowData[w] = WindowData{
         .visibilityRef = EffectWindowVisibleRef(w, EffectWindow::PAINT_DISABLED_BY_DESKTOP),
     };
+    addSnapshotDamage(w, w->expandedGeometry());
 }
 
 void SlideEffect::windowDeleted(EffectWindow *w)
@@ -494,6 +705,30 @@ void SlideEffect::windowDeleted(EffectWindow *w)
     m_elevatedWindows.removeAll(w);
     m_windowData.remove(w);
     m_paintCtx.fullscreenWindows.removeAll(w);
+    addSnapshotDamage();
+}
+
+void SlideEffect::windowChanged(EffectWindow *w)
+{
+    if (m_state == State::Inactive) {
+        return;
+    }
+    addSnapshotDamage(w, w->expandedGeometry());
+}
+
+void SlideEffect::windowFrameGeometryChanged(EffectWindow *w, const QRectF &oldGeometry)
+{
+    if (m_state == State::Inactive) {
+        return;
+    }
+    // The old expanded geometry isn't known, assume the margins around the frame haven't changed.
+    const QRectF expandedGeometry = w->expandedGeometry();
+    const QRectF frameGeometry = w->frameGeometry();
+    const QRectF oldExpandedGeometry = oldGeometry.adjusted(expandedGeometry.left() - frameGeometry.left(),
+                                                            expandedGeometry.top() - frameGeometry.top(),
+                                                            expandedGeometry.right() - frameGeometry.right(),
+                                                            expandedGeometry.bottom() - frameGeometry.bottom());
+    addSnapshotDamage(w, expandedGeometry | oldExpandedGeometry);
 }
 
 /*
@@ -561,7 +796,7 @@ void SlideEffect::optimizePath()
  * This function finds the true fastest path, regardless of which direction the animation is already going;
  * I was a little upset about this limitation until I realized that MacOS can't even wrap desktops :)
  */
-QPointF SlideEffect::constrainToDrawableRange(QPointF p)
+QPointF SlideEffect::constrainToDrawableRange(QPointF p) const
 {
     p.setX(fmod(p.x(), effects->desktopGridWidth()));
     p.setY(fmod(p.y(), effects->desktopGridHeight()));
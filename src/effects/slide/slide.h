@@ -14,9 +14,13 @@
 
 // kwineffects
 #include <kwineffects.h>
+#include <kwinglutils.h>
 
 #include "springmotion.h"
 
+#include <map>
+#include <memory>
+
 namespace KWin
 {
 
@@ -39,6 +43,11 @@ namespace KWin
  * 2. It will draw the desktop at index 0 at index gridWidth if it has to.
  * I will not draw any thing farther outside the range than that.
  *
+ * With snapshots enabled (the default with OpenGL compositing), every visible desktop is rendered
+ * into one texture per screen, and only the textures are slid across the screen. A snapshot is
+ * rendered again only in the parts where its windows have changed, so the cost of a frame doesn't
+ * depend on the number of windows on the desktops.
+ *
  * I've put an explanation of all the important private vars down at the bottom.
  *
  * Good luck :)
@@ -51,6 +60,7 @@ class SlideEffect : public Effect
     Q_PROPERTY(int verticalGap READ verticalGap)
     Q_PROPERTY(bool slideDocks READ slideDocks)
     Q_PROPERTY(bool slideBackground READ slideBackground)
+    Q_PROPERTY(bool snapshotDesktops READ snapshotDesktops)
 
 public:
     SlideEffect();
@@ -74,6 +84,7 @@ public:
     int verticalGap() const;
     bool slideDocks() const;
     bool slideBackground() const;
+    bool snapshotDesktops() const;
 
 private Q_SLOTS:
     void desktopChanged(int old, int current, EffectWindow *with);
@@ -81,15 +92,18 @@ private Q_SLOTS:
     void desktopChangingCancelled();
     void windowAdded(EffectWindow *w);
     void windowDeleted(EffectWindow *w);
+    void windowChanged(EffectWindow *w);
+    void windowFrameGeometryChanged(EffectWindow *w, const QRectF &oldGeometry);
 
 private:
+    QPointF desktopTranslation(int desktop) const;
     QPoint getDrawCoords(QPointF pos, EffectScreen *screen);
     bool isTranslated(const EffectWindow *w) const;
     bool isPainted(int desktopId, const EffectWindow *w) const;
     bool willBePainted(const EffectWindow *w) const;
     bool shouldElevate(const EffectWindow *w) const;
     QPointF moveInsideDesktopGrid(QPointF p);
-    QPointF constrainToDrawableRange(QPointF p);
+    QPointF constrainToDrawableRange(QPointF p) const;
     QPointF forcePositivePosition(QPointF p) const;
     void optimizePath(); // Find the best path to target desktop
 
@@ -97,11 +111,19 @@ private:
     void prepareSwitching();
     void finishedSwitching();
 
+    void updateSnapshots(const QRegion &region);
+    void renderSnapshot(int desktop, EffectScreen *screen, const QRect &rect);
+    void paintSnapshots(const QRegion &region, const WindowPaintData &data);
+    void addSnapshotDamage(const EffectWindow *w, const QRectF &rect);
+    void addSnapshotDamage();
+    void discardSnapshots();
+
 private:
     int m_hGap;
     int m_vGap;
     bool m_slideDocks;
     bool m_slideBackground;
+    bool m_snapshotDesktops;
 
     enum class State {
         Inactive,
@@ -127,6 +149,8 @@ private:
         bool wrap;
         QVector<int> visibleDesktops;
         EffectWindowList fullscreenWindows;
+        bool useSnapshots;
+        bool snapshotsPainted;
     } m_paintCtx;
 
     struct WindowData
@@ -136,6 +160,18 @@ private:
 
     EffectWindowList m_elevatedWindows;
     QHash<EffectWindow *, WindowData> m_windowData;
+
+    struct Snapshot
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        QRegion damage; // in global coordinates, the parts that have to be rendered again
+    };
+
+    // The snapshots of the desktops, one per desktop and screen.
+    std::map<std::pair<int, EffectScreen *>, Snapshot> m_snapshots;
+    // Cleared when a snapshot can't be created, e.g. the framebuffer is incomplete.
+    bool m_snapshotsSupported = true;
 };
 
 inline int SlideEffect::horizontalGap() const
@@ -158,6 +194,11 @@ inline bool SlideEffect::slideBackground() const
     return m_slideBackground;
 }
 
+inline bool SlideEffect::snapshotDesktops() const
+{
+    return m_snapshotDesktops;
+}
+
 inline bool SlideEffect::isActive() const
 {
     return m_state != State::Inactive;
@@ -256,7 +256,7 @@ void SlidingPopupsEffect::slotPropertyNotify(EffectWindow *w, long atom)
 
     if (rawAtomData.isEmpty()) {
         // Property was removed, thus also remove the effect for window
-        if (w->data(WindowClosedGrabRole).value<void *>() == this) {
+        if (w->grab(WindowClosedGrabRole) == this) {
             w->setData(WindowClosedGrabRole, QVariant());
         }
         m_animations.remove(w);
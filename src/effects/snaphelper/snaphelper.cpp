@@ -106,8 +106,8 @@ void SnapHelperEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
         vbo->setUseColor(true);
         ShaderBinder binder(ShaderTrait::UniformColor);
         binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix());
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::setBlendEnabled(true);
+        GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         QColor color = s_lineColor;
         color.setAlphaF(color.alphaF() * opacityFactor);
@@ -150,7 +150,7 @@ void SnapHelperEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
         vbo->setData(verts.count() / 2, 2, verts.data(), nullptr);
         vbo->render(GL_LINES);
 
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
         glLineWidth(1.0);
     } else if (effects->compositingType() == QPainterCompositing) {
         QPainter *painter = effects->scenePainter();
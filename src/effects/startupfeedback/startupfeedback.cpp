@@ -212,8 +212,8 @@ void StartupFeedbackEffect::paintScreen(int mask, const QRegion &region, ScreenP
         default:
             return; // safety
         }
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::setBlendEnabled(true);
+        GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         texture->bind();
         if (m_type == BlinkingFeedback && m_blinkingShader && m_blinkingShader->isValid()) {
             const QColor &blinkingColor = BLINKING_COLORS[FRAME_TO_BLINKING_COLOR[m_frame]];
@@ -228,7 +228,7 @@ void StartupFeedbackEffect::paintScreen(int mask, const QRegion &region, ScreenP
         texture->render(m_currentGeometry);
         ShaderManager::instance()->popShader();
         texture->unbind();
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
     }
 }
 
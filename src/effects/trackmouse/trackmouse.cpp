@@ -108,8 +108,8 @@ void TrackMouseEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
         if (!shader) {
             return;
         }
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::setBlendEnabled(true);
+        GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
         QMatrix4x4 matrix(data.projectionMatrix());
         const QPointF p = m_lastRect[0].topLeft() + QPoint(m_lastRect[0].width() / 2.0, m_lastRect[0].height() / 2.0);
         const float x = p.x();
@@ -125,7 +125,7 @@ void TrackMouseEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
             m_texture[i]->render(m_lastRect[i]);
             m_texture[i]->unbind();
         }
-        glDisable(GL_BLEND);
+        GLState::setBlendEnabled(false);
     } else if (effects->compositingType() == QPainterCompositing && !m_image[0].isNull() && !m_image[1].isNull()) {
         QPainter *painter = effects->scenePainter();
         const QPointF p = m_lastRect[0].topLeft() + QPoint(m_lastRect[0].width() / 2.0, m_lastRect[0].height() / 2.0);
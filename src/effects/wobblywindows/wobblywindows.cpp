@@ -174,6 +174,10 @@ void WobblyWindowsEffect::reconfigure(ReconfigureFlags)
     m_moveWobble = WobblyWindowsConfig::moveWobble();
     m_resizeWobble = WobblyWindowsConfig::resizeWobble();
 
+    for (WindowWobblyInfos &wwi : windows) {
+        wwi.quadsDirty = true;
+    }
+
 #if defined VERBOSE_MODE
     qCDebug(KWIN_WOBBLYWINDOWS) << "Parameters :\n"
                                 << "grid(" << m_stiffness << ", " << m_drag << ", " << m_move_factor << ")\n"
@@ -249,11 +253,12 @@ void WobblyWindowsEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &da
         // opaque wobbly windows.
         data.opaque = QRegion();
 
-        while ((presentTime - infoIt->clock).count() > 0) {
-            const auto delta = std::min(presentTime - infoIt->clock, integrationStep);
-            infoIt->clock += delta;
+        // The grid is only advanced in whole integration steps, so the cost of the physics
+        // doesn't depend on the refresh rate. The remainder is carried over to the next frame.
+        while (presentTime - infoIt->clock >= integrationStep) {
+            infoIt->clock += integrationStep;
 
-            if (!updateWindowWobblyDatas(w, delta.count())) {
+            if (!updateWindowWobblyDatas(w, integrationStep.count())) {
                 break;
             }
         }
@@ -264,35 +269,52 @@ void WobblyWindowsEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &da
 
 void WobblyWindowsEffect::apply(EffectWindow *w, int mask, WindowPaintData &data, WindowQuadList &quads)
 {
-    if (!(mask & PAINT_SCREEN_TRANSFORMED) && windows.contains(w)) {
-        quads = quads.makeRegularGrid(m_xTesselation, m_yTesselation);
-
-        WindowWobblyInfos &wwi = windows[w];
-        int tx = w->frameGeometry().x();
-        int ty = w->frameGeometry().y();
-        int width = w->frameGeometry().width();
-        int height = w->frameGeometry().height();
-        double left = 0.0;
-        double top = 0.0;
-        double right = w->width();
-        double bottom = w->height();
-        for (int i = 0; i < quads.count(); ++i) {
-            for (int j = 0; j < 4; ++j) {
-                WindowVertex &v = quads[i][j];
-                Pair uv = {v.x() / width, v.y() / height};
-                Pair newPos = computeBezierPoint(wwi, uv);
-                v.move(newPos.x - tx, newPos.y - ty);
+    auto infoIt = windows.find(w);
+    if (!(mask & PAINT_SCREEN_TRANSFORMED) && infoIt != windows.end()) {
+        WindowWobblyInfos &wwi = *infoIt;
+        const QRectF geometry = w->frameGeometry();
+
+        if (wwi.quadsDirty || wwi.quadsSize != geometry.size() || wwi.quadsSourceCount != quads.count()) {
+            wwi.quadsSourceCount = quads.count();
+            wwi.quadsSize = geometry.size();
+            wwi.quadsOrigin = QPoint(geometry.x(), geometry.y());
+            wwi.quadsDirty = false;
+            wwi.quads = quads.makeRegularGrid(m_xTesselation, m_yTesselation);
+
+            int tx = wwi.quadsOrigin.x();
+            int ty = wwi.quadsOrigin.y();
+            int width = geometry.width();
+            int height = geometry.height();
+            double left = 0.0;
+            double top = 0.0;
+            double right = w->width();
+            double bottom = w->height();
+            for (int i = 0; i < wwi.quads.count(); ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    WindowVertex &v = wwi.quads[i][j];
+                    Pair uv = {v.x() / width, v.y() / height};
+                    Pair newPos = computeBezierPoint(wwi, uv);
+                    v.move(newPos.x - tx, newPos.y - ty);
+                }
+                left = qMin(left, wwi.quads[i].left());
+                top = qMin(top, wwi.quads[i].top());
+                right = qMax(right, wwi.quads[i].right());
+                bottom = qMax(bottom, wwi.quads[i].bottom());
             }
-            left = qMin(left, quads[i].left());
-            top = qMin(top, quads[i].top());
-            right = qMax(right, quads[i].right());
-            bottom = qMax(bottom, quads[i].bottom());
+            wwi.quadsBounds = QRectF(QPointF(left, top), QPointF(right, bottom));
         }
+
+        // The window may have moved since the last physics step, the deformed quads follow it.
+        quads = wwi.quads;
+        const QPoint offset = wwi.quadsOrigin - QPoint(geometry.x(), geometry.y());
+        data.translate(offset.x() * data.xScale(), offset.y() * data.yScale());
+
+        const QRectF &bounds = wwi.quadsBounds;
         QRectF dirtyRect(
-            left * data.xScale() + w->x() + data.xTranslation(),
-            top * data.yScale() + w->y() + data.yTranslation(),
-            (right - left + 1.0) * data.xScale(),
-            (bottom - top + 1.0) * data.yScale());
+            bounds.left() * data.xScale() + w->x() + data.xTranslation(),
+            bounds.top() * data.yScale() + w->y() + data.yTranslation(),
+            (bounds.width() + 1.0) * data.xScale(),
+            (bounds.height() + 1.0) * data.yScale());
         // Expand the dirty region by 1px to fix potential round/floor issues.
         dirtyRect.adjust(-1.0, -1.0, 1.0, 1.0);
         m_updateRegion = m_updateRegion.united(dirtyRect.toRect());
@@ -452,7 +474,7 @@ void WobblyWindowsEffect::stepMovedResized(EffectWindow *w)
     for (unsigned int j = 0; j < wwi.height; ++j) {
         for (unsigned int i = 0; i < wwi.width; ++i) {
             Pair v = {magnitude * (i / qreal(wwi.width - 1) - 0.5), magnitude * (j / qreal(wwi.height - 1) - 0.5)};
-            wwi.velocity[j * wwi.width + i] = v;
+            wwi.velocity.set(j * wwi.width + i, v);
         }
     }
 
@@ -470,19 +492,6 @@ void WobblyWindowsEffect::initWobblyInfo(WindowWobblyInfos &wwi, QRectF geometry
     wwi.width = 4;
     wwi.height = 4;
 
-    wwi.bezierWidth = m_xTesselation;
-    wwi.bezierHeight = m_yTesselation;
-    wwi.bezierCount = m_xTesselation * m_yTesselation;
-
-    wwi.origin.resize(wwi.count);
-    wwi.position.resize(wwi.count);
-    wwi.velocity.resize(wwi.count);
-    wwi.acceleration.resize(wwi.count);
-    wwi.buffer.resize(wwi.count);
-    wwi.constraint.resize(wwi.count);
-
-    wwi.bezierSurface.resize(wwi.bezierCount);
-
     wwi.status = Moving;
     wwi.clock = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now().time_since_epoch());
@@ -499,9 +508,9 @@ void WobblyWindowsEffect::initWobblyInfo(WindowWobblyInfos &wwi, QRectF geometry
     for (unsigned int j = 0; j < 4; ++j) {
         for (unsigned int i = 0; i < 4; ++i) {
             unsigned int idx = j * 4 + i;
-            wwi.origin[idx] = initValue;
-            wwi.position[idx] = initValue;
-            wwi.velocity[idx] = nullPair;
+            wwi.origin.set(idx, initValue);
+            wwi.position.set(idx, initValue);
+            wwi.velocity.set(idx, nullPair);
             wwi.constraint[idx] = false;
             if (i != 4 - 2) { // x grid count - 2, i.e. not the last point
                 initValue.x += x_increment;
@@ -545,8 +554,8 @@ WobblyWindowsEffect::Pair WobblyWindowsEffect::computeBezierPoint(const WindowWo
     for (unsigned int j = 0; j < 4; ++j) {
         for (unsigned int i = 0; i < 4; ++i) {
             // this assume the grid is 4*4
-            res.x += px[i] * py[j] * wwi.position[i + j * wwi.width].x;
-            res.y += px[i] * py[j] * wwi.position[i + j * wwi.width].y;
+            res.x += px[i] * py[j] * wwi.position.x[i + j * wwi.width];
+            res.y += px[i] * py[j] * wwi.position.y[i + j * wwi.width];
         }
     }
 
@@ -556,41 +565,49 @@ WobblyWindowsEffect::Pair WobblyWindowsEffect::computeBezierPoint(const WindowWo
 namespace
 {
 
-static inline void fixVectorBounds(WobblyWindowsEffect::Pair &vec, qreal min, qreal max)
+static inline qreal fixBounds(qreal value, qreal min, qreal max)
 {
-    if (fabs(vec.x) < min) {
-        vec.x = 0.0;
-    } else if (fabs(vec.x) > max) {
-        if (vec.x > 0.0) {
-            vec.x = max;
-        } else {
-            vec.x = -max;
-        }
+    const qreal magnitude = std::abs(value);
+    return magnitude < min ? 0.0 : (magnitude > max ? std::copysign(max, value) : value);
+}
+
+// The velocity and the position are integrated one coordinate at a time over all points of
+// the grid. The loops have no branches, so the compiler can vectorize them.
+static inline qreal integrateVelocity(std::array<qreal, 16> &velocity, const std::array<qreal, 16> &acceleration,
+                                      qreal time, qreal drag, qreal min, qreal max)
+{
+    qreal sum = 0.0;
+    for (size_t i = 0; i < velocity.size(); ++i) {
+        const qreal acc = fixBounds(acceleration[i], min, max);
+        velocity[i] = acc * time + velocity[i] * drag;
+        sum += std::abs(acc);
     }
+    return sum;
+}
 
-    if (fabs(vec.y) < min) {
-        vec.y = 0.0;
-    } else if (fabs(vec.y) > max) {
-        if (vec.y > 0.0) {
-            vec.y = max;
-        } else {
-            vec.y = -max;
-        }
+static inline qreal integratePosition(std::array<qreal, 16> &position, std::array<qreal, 16> &velocity,
+                                      qreal factor, qreal min, qreal max)
+{
+    qreal sum = 0.0;
+    for (size_t i = 0; i < position.size(); ++i) {
+        const qreal vel = fixBounds(velocity[i], min, max);
+        velocity[i] = vel;
+        position[i] += vel * factor;
+        sum += std::abs(vel);
     }
+    return sum;
 }
 
 #if defined COMPUTE_STATS
-static inline void computeVectorBounds(WobblyWindowsEffect::Pair &vec, WobblyWindowsEffect::Pair &bound)
+static inline void computeBounds(const std::array<qreal, 16> &values, qreal min, qreal max, WobblyWindowsEffect::Pair &bound)
 {
-    if (fabs(vec.x) < bound.x) {
-        bound.x = fabs(vec.x);
-    } else if (fabs(vec.x) > bound.y) {
-        bound.y = fabs(vec.x);
-    }
-    if (fabs(vec.y) < bound.x) {
-        bound.x = fabs(vec.y);
-    } else if (fabs(vec.y) > bound.y) {
-        bound.y = fabs(vec.y);
+    for (qreal value : values) {
+        const qreal magnitude = std::abs(fixBounds(value, min, max));
+        if (magnitude < bound.x) {
+            bound.x = magnitude;
+        } else if (magnitude > bound.y) {
+            bound.y = magnitude;
+        }
     }
 }
 #endif
@@ -614,7 +631,7 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
 
     for (unsigned int j = 0; j < wwi.height; ++j) {
         for (unsigned int i = 0; i < wwi.width; ++i) {
-            wwi.origin[wwi.width * j + i] = origine;
+            wwi.origin.set(wwi.width * j + i, origine);
             if (i != wwi.width - 2) {
                 origine.x += x_length;
             } else {
@@ -642,15 +659,15 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
     // top-left
 
     if (wwi.constraint[0]) {
-        Pair window_pos = wwi.origin[0];
-        Pair current_pos = wwi.position[0];
+        Pair window_pos = wwi.origin.at(0);
+        Pair current_pos = wwi.position.at(0);
         Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
         Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-        wwi.acceleration[0] = accel;
+        wwi.acceleration.set(0, accel);
     } else {
-        Pair &pos = wwi.position[0];
-        neibourgs[0] = wwi.position[1];
-        neibourgs[1] = wwi.position[wwi.width];
+        const Pair pos = wwi.position.at(0);
+        neibourgs[0] = wwi.position.at(1);
+        neibourgs[1] = wwi.position.at(wwi.width);
 
         acceleration.x = ((neibourgs[0].x - pos.x) - x_length) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness;
         acceleration.y = ((neibourgs[1].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -658,21 +675,21 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
         acceleration.x /= 2;
         acceleration.y /= 2;
 
-        wwi.acceleration[0] = acceleration;
+        wwi.acceleration.set(0, acceleration);
     }
 
     // top-right
 
     if (wwi.constraint[wwi.width - 1]) {
-        Pair window_pos = wwi.origin[wwi.width - 1];
-        Pair current_pos = wwi.position[wwi.width - 1];
+        Pair window_pos = wwi.origin.at(wwi.width - 1);
+        Pair current_pos = wwi.position.at(wwi.width - 1);
         Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
         Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-        wwi.acceleration[wwi.width - 1] = accel;
+        wwi.acceleration.set(wwi.width - 1, accel);
     } else {
-        Pair &pos = wwi.position[wwi.width - 1];
-        neibourgs[0] = wwi.position[wwi.width - 2];
-        neibourgs[1] = wwi.position[2 * wwi.width - 1];
+        const Pair pos = wwi.position.at(wwi.width - 1);
+        neibourgs[0] = wwi.position.at(wwi.width - 2);
+        neibourgs[1] = wwi.position.at(2 * wwi.width - 1);
 
         acceleration.x = (x_length - (pos.x - neibourgs[0].x)) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness;
         acceleration.y = ((neibourgs[1].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -680,21 +697,21 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
         acceleration.x /= 2;
         acceleration.y /= 2;
 
-        wwi.acceleration[wwi.width - 1] = acceleration;
+        wwi.acceleration.set(wwi.width - 1, acceleration);
     }
 
     // bottom-left
 
     if (wwi.constraint[wwi.width * (wwi.height - 1)]) {
-        Pair window_pos = wwi.origin[wwi.width * (wwi.height - 1)];
-        Pair current_pos = wwi.position[wwi.width * (wwi.height - 1)];
+        Pair window_pos = wwi.origin.at(wwi.width * (wwi.height - 1));
+        Pair current_pos = wwi.position.at(wwi.width * (wwi.height - 1));
         Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
         Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-        wwi.acceleration[wwi.width * (wwi.height - 1)] = accel;
+        wwi.acceleration.set(wwi.width * (wwi.height - 1), accel);
     } else {
-        Pair &pos = wwi.position[wwi.width * (wwi.height - 1)];
-        neibourgs[0] = wwi.position[wwi.width * (wwi.height - 1) + 1];
-        neibourgs[1] = wwi.position[wwi.width * (wwi.height - 2)];
+        const Pair pos = wwi.position.at(wwi.width * (wwi.height - 1));
+        neibourgs[0] = wwi.position.at(wwi.width * (wwi.height - 1) + 1);
+        neibourgs[1] = wwi.position.at(wwi.width * (wwi.height - 2));
 
         acceleration.x = ((neibourgs[0].x - pos.x) - x_length) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness;
         acceleration.y = (y_length - (pos.y - neibourgs[1].y)) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -702,21 +719,21 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
         acceleration.x /= 2;
         acceleration.y /= 2;
 
-        wwi.acceleration[wwi.width * (wwi.height - 1)] = acceleration;
+        wwi.acceleration.set(wwi.width * (wwi.height - 1), acceleration);
     }
 
     // bottom-right
 
     if (wwi.constraint[wwi.count - 1]) {
-        Pair window_pos = wwi.origin[wwi.count - 1];
-        Pair current_pos = wwi.position[wwi.count - 1];
+        Pair window_pos = wwi.origin.at(wwi.count - 1);
+        Pair current_pos = wwi.position.at(wwi.count - 1);
         Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
         Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-        wwi.acceleration[wwi.count - 1] = accel;
+        wwi.acceleration.set(wwi.count - 1, accel);
     } else {
-        Pair &pos = wwi.position[wwi.count - 1];
-        neibourgs[0] = wwi.position[wwi.count - 2];
-        neibourgs[1] = wwi.position[wwi.width * (wwi.height - 1) - 1];
+        const Pair pos = wwi.position.at(wwi.count - 1);
+        neibourgs[0] = wwi.position.at(wwi.count - 2);
+        neibourgs[1] = wwi.position.at(wwi.width * (wwi.height - 1) - 1);
 
         acceleration.x = (x_length - (pos.x - neibourgs[0].x)) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness;
         acceleration.y = (y_length - (pos.y - neibourgs[1].y)) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -724,7 +741,7 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
         acceleration.x /= 2;
         acceleration.y /= 2;
 
-        wwi.acceleration[wwi.count - 1] = acceleration;
+        wwi.acceleration.set(wwi.count - 1, acceleration);
     }
 
     // for borders
@@ -732,16 +749,16 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
     // top border
     for (unsigned int i = 1; i < wwi.width - 1; ++i) {
         if (wwi.constraint[i]) {
-            Pair window_pos = wwi.origin[i];
-            Pair current_pos = wwi.position[i];
+            Pair window_pos = wwi.origin.at(i);
+            Pair current_pos = wwi.position.at(i);
             Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
             Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-            wwi.acceleration[i] = accel;
+            wwi.acceleration.set(i, accel);
         } else {
-            Pair &pos = wwi.position[i];
-            neibourgs[0] = wwi.position[i - 1];
-            neibourgs[1] = wwi.position[i + 1];
-            neibourgs[2] = wwi.position[i + wwi.width];
+            const Pair pos = wwi.position.at(i);
+            neibourgs[0] = wwi.position.at(i - 1);
+            neibourgs[1] = wwi.position.at(i + 1);
+            neibourgs[2] = wwi.position.at(i + wwi.width);
 
             acceleration.x = (x_length - (pos.x - neibourgs[0].x)) * m_stiffness + ((neibourgs[1].x - pos.x) - x_length) * m_stiffness + (neibourgs[2].x - pos.x) * m_stiffness;
             acceleration.y = ((neibourgs[2].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness + (neibourgs[1].y - pos.y) * m_stiffness;
@@ -749,23 +766,23 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
             acceleration.x /= 3;
             acceleration.y /= 3;
 
-            wwi.acceleration[i] = acceleration;
+            wwi.acceleration.set(i, acceleration);
         }
     }
 
     // bottom border
     for (unsigned int i = wwi.width * (wwi.height - 1) + 1; i < wwi.count - 1; ++i) {
         if (wwi.constraint[i]) {
-            Pair window_pos = wwi.origin[i];
-            Pair current_pos = wwi.position[i];
+            Pair window_pos = wwi.origin.at(i);
+            Pair current_pos = wwi.position.at(i);
             Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
             Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-            wwi.acceleration[i] = accel;
+            wwi.acceleration.set(i, accel);
         } else {
-            Pair &pos = wwi.position[i];
-            neibourgs[0] = wwi.position[i - 1];
-            neibourgs[1] = wwi.position[i + 1];
-            neibourgs[2] = wwi.position[i - wwi.width];
+            const Pair pos = wwi.position.at(i);
+            neibourgs[0] = wwi.position.at(i - 1);
+            neibourgs[1] = wwi.position.at(i + 1);
+            neibourgs[2] = wwi.position.at(i - wwi.width);
 
             acceleration.x = (x_length - (pos.x - neibourgs[0].x)) * m_stiffness + ((neibourgs[1].x - pos.x) - x_length) * m_stiffness + (neibourgs[2].x - pos.x) * m_stiffness;
             acceleration.y = (y_length - (pos.y - neibourgs[2].y)) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness + (neibourgs[1].y - pos.y) * m_stiffness;
@@ -773,23 +790,23 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
             acceleration.x /= 3;
             acceleration.y /= 3;
 
-            wwi.acceleration[i] = acceleration;
+            wwi.acceleration.set(i, acceleration);
         }
     }
 
     // left border
     for (unsigned int i = wwi.width; i < wwi.width * (wwi.height - 1); i += wwi.width) {
         if (wwi.constraint[i]) {
-            Pair window_pos = wwi.origin[i];
-            Pair current_pos = wwi.position[i];
+            Pair window_pos = wwi.origin.at(i);
+            Pair current_pos = wwi.position.at(i);
             Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
             Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-            wwi.acceleration[i] = accel;
+            wwi.acceleration.set(i, accel);
         } else {
-            Pair &pos = wwi.position[i];
-            neibourgs[0] = wwi.position[i + 1];
-            neibourgs[1] = wwi.position[i - wwi.width];
-            neibourgs[2] = wwi.position[i + wwi.width];
+            const Pair pos = wwi.position.at(i);
+            neibourgs[0] = wwi.position.at(i + 1);
+            neibourgs[1] = wwi.position.at(i - wwi.width);
+            neibourgs[2] = wwi.position.at(i + wwi.width);
 
             acceleration.x = ((neibourgs[0].x - pos.x) - x_length) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness + (neibourgs[2].x - pos.x) * m_stiffness;
             acceleration.y = (y_length - (pos.y - neibourgs[1].y)) * m_stiffness + ((neibourgs[2].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -797,23 +814,23 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
             acceleration.x /= 3;
             acceleration.y /= 3;
 
-            wwi.acceleration[i] = acceleration;
+            wwi.acceleration.set(i, acceleration);
         }
     }
 
     // right border
     for (unsigned int i = 2 * wwi.width - 1; i < wwi.count - 1; i += wwi.width) {
         if (wwi.constraint[i]) {
-            Pair window_pos = wwi.origin[i];
-            Pair current_pos = wwi.position[i];
+            Pair window_pos = wwi.origin.at(i);
+            Pair current_pos = wwi.position.at(i);
             Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
             Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-            wwi.acceleration[i] = accel;
+            wwi.acceleration.set(i, accel);
         } else {
-            Pair &pos = wwi.position[i];
-            neibourgs[0] = wwi.position[i - 1];
-            neibourgs[1] = wwi.position[i - wwi.width];
-            neibourgs[2] = wwi.position[i + wwi.width];
+            const Pair pos = wwi.position.at(i);
+            neibourgs[0] = wwi.position.at(i - 1);
+            neibourgs[1] = wwi.position.at(i - wwi.width);
+            neibourgs[2] = wwi.position.at(i + wwi.width);
 
             acceleration.x = (x_length - (pos.x - neibourgs[0].x)) * m_stiffness + (neibourgs[1].x - pos.x) * m_stiffness + (neibourgs[2].x - pos.x) * m_stiffness;
             acceleration.y = (y_length - (pos.y - neibourgs[1].y)) * m_stiffness + ((neibourgs[2].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness;
@@ -821,7 +838,7 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
             acceleration.x /= 3;
             acceleration.y /= 3;
 
-            wwi.acceleration[i] = acceleration;
+            wwi.acceleration.set(i, acceleration);
         }
     }
 
@@ -831,17 +848,17 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
             unsigned int index = i + j * wwi.width;
 
             if (wwi.constraint[index]) {
-                Pair window_pos = wwi.origin[index];
-                Pair current_pos = wwi.position[index];
+                Pair window_pos = wwi.origin.at(index);
+                Pair current_pos = wwi.position.at(index);
                 Pair move = {window_pos.x - current_pos.x, window_pos.y - current_pos.y};
                 Pair accel = {move.x * m_stiffness, move.y * m_stiffness};
-                wwi.acceleration[index] = accel;
+                wwi.acceleration.set(index, accel);
             } else {
-                Pair &pos = wwi.position[index];
-                neibourgs[0] = wwi.position[index - 1];
-                neibourgs[1] = wwi.position[index + 1];
-                neibourgs[2] = wwi.position[index - wwi.width];
-                neibourgs[3] = wwi.position[index + wwi.width];
+                const Pair pos = wwi.position.at(index);
+                neibourgs[0] = wwi.position.at(index - 1);
+                neibourgs[1] = wwi.position.at(index + 1);
+                neibourgs[2] = wwi.position.at(index - wwi.width);
+                neibourgs[3] = wwi.position.at(index + wwi.width);
 
                 acceleration.x = ((neibourgs[0].x - pos.x) - x_length) * m_stiffness + (x_length - (pos.x - neibourgs[1].x)) * m_stiffness + (neibourgs[2].x - pos.x) * m_stiffness + (neibourgs[3].x - pos.x) * m_stiffness;
                 acceleration.y = (y_length - (pos.y - neibourgs[2].y)) * m_stiffness + ((neibourgs[3].y - pos.y) - y_length) * m_stiffness + (neibourgs[0].y - pos.y) * m_stiffness + (neibourgs[1].y - pos.y) * m_stiffness;
@@ -849,83 +866,70 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
                 acceleration.x /= 4;
                 acceleration.y /= 4;
 
-                wwi.acceleration[index] = acceleration;
+                wwi.acceleration.set(index, acceleration);
             }
         }
     }
 
-    heightRingLinearMean(wwi.acceleration, wwi);
+    heightRingLinearMean(wwi.acceleration.x, wwi);
+    heightRingLinearMean(wwi.acceleration.y, wwi);
 
 #if defined COMPUTE_STATS
     Pair accBound = {m_maxAcceleration, m_minAcceleration};
     Pair velBound = {m_maxVelocity, m_minVelocity};
+    computeBounds(wwi.acceleration.x, m_minAcceleration, m_maxAcceleration, accBound);
+    computeBounds(wwi.acceleration.y, m_minAcceleration, m_maxAcceleration, accBound);
 #endif
 
     // compute the new velocity of each vertex.
-    for (unsigned int i = 0; i < wwi.count; ++i) {
-        Pair acc = wwi.acceleration[i];
-        fixVectorBounds(acc, m_minAcceleration, m_maxAcceleration);
-
-#if defined COMPUTE_STATS
-        computeVectorBounds(acc, accBound);
-#endif
-
-        Pair &vel = wwi.velocity[i];
-        vel.x = acc.x * time + vel.x * m_drag;
-        vel.y = acc.y * time + vel.y * m_drag;
-
-        acc_sum += fabs(acc.x) + fabs(acc.y);
-    }
+    acc_sum += integrateVelocity(wwi.velocity.x, wwi.acceleration.x, time, m_drag, m_minAcceleration, m_maxAcceleration);
+    acc_sum += integrateVelocity(wwi.velocity.y, wwi.acceleration.y, time, m_drag, m_minAcceleration, m_maxAcceleration);
 
-    heightRingLinearMean(wwi.velocity, wwi);
+    heightRingLinearMean(wwi.velocity.x, wwi);
+    heightRingLinearMean(wwi.velocity.y, wwi);
 
     // compute the new pos of each vertex.
-    for (unsigned int i = 0; i < wwi.count; ++i) {
-        Pair &pos = wwi.position[i];
-        Pair &vel = wwi.velocity[i];
+    vel_sum += integratePosition(wwi.position.x, wwi.velocity.x, time * m_move_factor, m_minVelocity, m_maxVelocity);
+    vel_sum += integratePosition(wwi.position.y, wwi.velocity.y, time * m_move_factor, m_minVelocity, m_maxVelocity);
 
-        fixVectorBounds(vel, m_minVelocity, m_maxVelocity);
 #if defined COMPUTE_STATS
-        computeVectorBounds(vel, velBound);
+    computeBounds(wwi.velocity.x, m_minVelocity, m_maxVelocity, velBound);
+    computeBounds(wwi.velocity.y, m_minVelocity, m_maxVelocity, velBound);
 #endif
 
-        pos.x += vel.x * time * m_move_factor;
-        pos.y += vel.y * time * m_move_factor;
-
-        vel_sum += fabs(vel.x) + fabs(vel.y);
-
 #if defined VERBOSE_MODE
+    for (unsigned int i = 0; i < wwi.count; ++i) {
         if (wwi.constraint[i]) {
-            qCDebug(KWIN_WOBBLYWINDOWS) << "Constraint point ** vel : " << vel.x << "," << vel.y << " ** move : " << vel.x * time << "," << vel.y * time;
+            qCDebug(KWIN_WOBBLYWINDOWS) << "Constraint point ** vel : " << wwi.velocity.x[i] << "," << wwi.velocity.y[i] << " ** move : " << wwi.velocity.x[i] * time << "," << wwi.velocity.y[i] * time;
         }
-#endif
     }
+#endif
 
     if (!wwi.can_wobble_top) {
         for (unsigned int i = 0; i < wwi.width; ++i) {
             for (unsigned j = 0; j < wwi.width - 1; ++j) {
-                wwi.position[i + wwi.width * j].y = wwi.origin[i + wwi.width * j].y;
+                wwi.position.y[i + wwi.width * j] = wwi.origin.y[i + wwi.width * j];
             }
         }
     }
     if (!wwi.can_wobble_bottom) {
         for (unsigned int i = wwi.width * (wwi.height - 1); i < wwi.count; ++i) {
             for (unsigned j = 0; j < wwi.width - 1; ++j) {
-                wwi.position[i - wwi.width * j].y = wwi.origin[i - wwi.width * j].y;
+                wwi.position.y[i - wwi.width * j] = wwi.origin.y[i - wwi.width * j];
             }
         }
     }
     if (!wwi.can_wobble_left) {
         for (unsigned int i = 0; i < wwi.count; i += wwi.width) {
             for (unsigned j = 0; j < wwi.width - 1; ++j) {
-                wwi.position[i + j].x = wwi.origin[i + j].x;
+                wwi.position.x[i + j] = wwi.origin.x[i + j];
             }
         }
     }
     if (!wwi.can_wobble_right) {
         for (unsigned int i = wwi.width - 1; i < wwi.count; i += wwi.width) {
             for (unsigned j = 0; j < wwi.width - 1; ++j) {
-                wwi.position[i - j].x = wwi.origin[i - j].x;
+                wwi.position.x[i - j] = wwi.origin.x[i - j];
             }
         }
     }
@@ -947,145 +951,33 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow *w, qreal time)
         return false;
     }
 
+    wwi.quadsDirty = true;
     return true;
 }
 
-void WobblyWindowsEffect::heightRingLinearMean(QVector<Pair> &data, WindowWobblyInfos &wwi)
+void WobblyWindowsEffect::heightRingLinearMean(std::array<qreal, 16> &data, WindowWobblyInfos &wwi)
 {
-    Pair neibourgs[8];
-
-    // for corners
-
-    // top-left
-    {
-        Pair &res = wwi.buffer[0];
-        Pair vit = data[0];
-        neibourgs[0] = data[1];
-        neibourgs[1] = data[wwi.width];
-        neibourgs[2] = data[wwi.width + 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + 3.0 * vit.x) / 6.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + 3.0 * vit.y) / 6.0;
-    }
-
-    // top-right
-    {
-        Pair &res = wwi.buffer[wwi.width - 1];
-        Pair vit = data[wwi.width - 1];
-        neibourgs[0] = data[wwi.width - 2];
-        neibourgs[1] = data[2 * wwi.width - 1];
-        neibourgs[2] = data[2 * wwi.width - 2];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + 3.0 * vit.x) / 6.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + 3.0 * vit.y) / 6.0;
-    }
-
-    // bottom-left
-    {
-        Pair &res = wwi.buffer[wwi.width * (wwi.height - 1)];
-        Pair vit = data[wwi.width * (wwi.height - 1)];
-        neibourgs[0] = data[wwi.width * (wwi.height - 1) + 1];
-        neibourgs[1] = data[wwi.width * (wwi.height - 2)];
-        neibourgs[2] = data[wwi.width * (wwi.height - 2) + 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + 3.0 * vit.x) / 6.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + 3.0 * vit.y) / 6.0;
-    }
-
-    // bottom-right
-    {
-        Pair &res = wwi.buffer[wwi.count - 1];
-        Pair vit = data[wwi.count - 1];
-        neibourgs[0] = data[wwi.count - 2];
-        neibourgs[1] = data[wwi.width * (wwi.height - 1) - 1];
-        neibourgs[2] = data[wwi.width * (wwi.height - 1) - 2];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + 3.0 * vit.x) / 6.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + 3.0 * vit.y) / 6.0;
-    }
-
-    // for borders
-
-    // top border
-    for (unsigned int i = 1; i < wwi.width - 1; ++i) {
-        Pair &res = wwi.buffer[i];
-        Pair vit = data[i];
-        neibourgs[0] = data[i - 1];
-        neibourgs[1] = data[i + 1];
-        neibourgs[2] = data[i + wwi.width];
-        neibourgs[3] = data[i + wwi.width - 1];
-        neibourgs[4] = data[i + wwi.width + 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + neibourgs[3].x + neibourgs[4].x + 5.0 * vit.x) / 10.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + neibourgs[3].y + neibourgs[4].y + 5.0 * vit.y) / 10.0;
-    }
-
-    // bottom border
-    for (unsigned int i = wwi.width * (wwi.height - 1) + 1; i < wwi.count - 1; ++i) {
-        Pair &res = wwi.buffer[i];
-        Pair vit = data[i];
-        neibourgs[0] = data[i - 1];
-        neibourgs[1] = data[i + 1];
-        neibourgs[2] = data[i - wwi.width];
-        neibourgs[3] = data[i - wwi.width - 1];
-        neibourgs[4] = data[i - wwi.width + 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + neibourgs[3].x + neibourgs[4].x + 5.0 * vit.x) / 10.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + neibourgs[3].y + neibourgs[4].y + 5.0 * vit.y) / 10.0;
-    }
-
-    // left border
-    for (unsigned int i = wwi.width; i < wwi.width * (wwi.height - 1); i += wwi.width) {
-        Pair &res = wwi.buffer[i];
-        Pair vit = data[i];
-        neibourgs[0] = data[i + 1];
-        neibourgs[1] = data[i - wwi.width];
-        neibourgs[2] = data[i + wwi.width];
-        neibourgs[3] = data[i - wwi.width + 1];
-        neibourgs[4] = data[i + wwi.width + 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + neibourgs[3].x + neibourgs[4].x + 5.0 * vit.x) / 10.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + neibourgs[3].y + neibourgs[4].y + 5.0 * vit.y) / 10.0;
-    }
-
-    // right border
-    for (unsigned int i = 2 * wwi.width - 1; i < wwi.count - 1; i += wwi.width) {
-        Pair &res = wwi.buffer[i];
-        Pair vit = data[i];
-        neibourgs[0] = data[i - 1];
-        neibourgs[1] = data[i - wwi.width];
-        neibourgs[2] = data[i + wwi.width];
-        neibourgs[3] = data[i - wwi.width - 1];
-        neibourgs[4] = data[i + wwi.width - 1];
-
-        res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + neibourgs[3].x + neibourgs[4].x + 5.0 * vit.x) / 10.0;
-        res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + neibourgs[3].y + neibourgs[4].y + 5.0 * vit.y) / 10.0;
-    }
-
-    // for the inner points
-    for (unsigned int j = 1; j < wwi.height - 1; ++j) {
-        for (unsigned int i = 1; i < wwi.width - 1; ++i) {
-            unsigned int index = i + j * wwi.width;
+    // Every point is averaged with its neighbours, the point itself weighs as much as all
+    // of its neighbours together.
+    for (unsigned int j = 0; j < wwi.height; ++j) {
+        for (unsigned int i = 0; i < wwi.width; ++i) {
+            qreal sum = 0.0;
+            int neighbours = 0;
+            for (unsigned int y = std::max(j, 1u) - 1; y <= std::min(j + 1, wwi.height - 1); ++y) {
+                for (unsigned int x = std::max(i, 1u) - 1; x <= std::min(i + 1, wwi.width - 1); ++x) {
+                    if (x != i || y != j) {
+                        sum += data[x + y * wwi.width];
+                        ++neighbours;
+                    }
+                }
+            }
 
-            Pair &res = wwi.buffer[index];
-            Pair &vit = data[index];
-            neibourgs[0] = data[index - 1];
-            neibourgs[1] = data[index + 1];
-            neibourgs[2] = data[index - wwi.width];
-            neibourgs[3] = data[index + wwi.width];
-            neibourgs[4] = data[index - wwi.width - 1];
-            neibourgs[5] = data[index - wwi.width + 1];
-            neibourgs[6] = data[index + wwi.width - 1];
-            neibourgs[7] = data[index + wwi.width + 1];
-
-            res.x = (neibourgs[0].x + neibourgs[1].x + neibourgs[2].x + neibourgs[3].x + neibourgs[4].x + neibourgs[5].x + neibourgs[6].x + neibourgs[7].x + 8.0 * vit.x) / 16.0;
-            res.y = (neibourgs[0].y + neibourgs[1].y + neibourgs[2].y + neibourgs[3].y + neibourgs[4].y + neibourgs[5].y + neibourgs[6].y + neibourgs[7].y + 8.0 * vit.y) / 16.0;
+            const unsigned int index = i + j * wwi.width;
+            wwi.buffer[index] = (sum + neighbours * data[index]) / (2.0 * neighbours);
         }
     }
 
-    auto tmp = data;
     data = wwi.buffer;
-    wwi.buffer = tmp;
 }
 
 bool WobblyWindowsEffect::isActive() const
@@ -13,6 +13,8 @@
 // Include with base class for effects.
 #include <kwinoffscreeneffect.h>
 
+#include <array>
+
 namespace KWin
 {
 
@@ -67,6 +69,26 @@ public:
         qreal y;
     };
 
+    /**
+     * The points of the 4x4 physics grid. The coordinates are stored separately so the
+     * integrator can process all points of one coordinate at once.
+     */
+    struct PointGrid
+    {
+        std::array<qreal, 16> x;
+        std::array<qreal, 16> y;
+
+        Pair at(unsigned int index) const
+        {
+            return {x[index], y[index]};
+        }
+        void set(unsigned int index, const Pair &pair)
+        {
+            x[index] = pair.x;
+            y[index] = pair.y;
+        }
+    };
+
     enum WindowStatus {
         Free,
         Moving,
@@ -105,24 +127,28 @@ private:
 
     struct WindowWobblyInfos
     {
-        QVector<Pair> origin;
-        QVector<Pair> position;
-        QVector<Pair> velocity;
-        QVector<Pair> acceleration;
-        QVector<Pair> buffer;
+        PointGrid origin;
+        PointGrid position;
+        PointGrid velocity;
+        PointGrid acceleration;
+        std::array<qreal, 16> buffer;
 
         // if true, the physics system moves this point based only on it "normal" destination
         // given by the window position, ignoring neighbour points.
-        QVector<bool> constraint;
+        std::array<bool, 16> constraint;
 
         unsigned int width;
         unsigned int height;
         unsigned int count;
 
-        QVector<Pair> bezierSurface;
-        unsigned int bezierWidth;
-        unsigned int bezierHeight;
-        unsigned int bezierCount;
+        // The deformed quads of the last physics step, relative to the window position at
+        // that step. They're regenerated only after the grid has been stepped.
+        WindowQuadList quads;
+        QPoint quadsOrigin;
+        QSizeF quadsSize;
+        int quadsSourceCount = 0;
+        QRectF quadsBounds;
+        bool quadsDirty = true;
 
         WindowStatus status;
 
@@ -161,7 +187,7 @@ private:
 
     WobblyWindowsEffect::Pair computeBezierPoint(const WindowWobblyInfos &wwi, Pair point) const;
 
-    static void heightRingLinearMean(QVector<Pair> &data, WindowWobblyInfos &wwi);
+    static void heightRingLinearMean(std::array<qreal, 16> &data, WindowWobblyInfos &wwi);
 
     void setParameterSet(const ParameterSet &pset);
 };
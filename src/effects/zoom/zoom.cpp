@@ -26,6 +26,8 @@
 
 #include <kwinglutils.h>
 
+#include <cmath>
+
 namespace KWin
 {
 
@@ -254,6 +256,10 @@ void ZoomEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseco
 
     if (zoom == 1.0) {
         showCursor();
+        // Nothing of the scene is tracked while the screen isn't zoomed.
+        for (auto &[screen, offscreenData] : m_offscreenData) {
+            offscreenData.valid = QRegion();
+        }
     } else {
         hideCursor();
         data.mask |= PAINT_SCREEN_TRANSFORMED;
@@ -274,10 +280,12 @@ ZoomEffect::OffscreenData *ZoomEffect::ensureOffscreenData(EffectScreen *screen)
         data.texture->setFilter(GL_LINEAR);
         data.texture->setWrapMode(GL_CLAMP_TO_EDGE);
         data.framebuffer = std::make_unique<GLFramebuffer>(data.texture.get());
+        data.valid = QRegion();
     }
     if (!data.vbo || data.viewport != rect) {
         data.vbo.reset(new GLVertexBuffer(GLVertexBuffer::Static));
         data.viewport = rect;
+        data.valid = QRegion();
 
         QVector<float> verts;
         QVector<float> texcoords;
@@ -307,11 +315,6 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &d
 {
     OffscreenData *offscreenData = ensureOffscreenData(data.screen());
 
-    // Render the scene in an offscreen texture and then upscale it.
-    GLFramebuffer::pushFramebuffer(offscreenData->framebuffer.get());
-    effects->paintScreen(mask, region, data);
-    GLFramebuffer::popFramebuffer();
-
     const QSize screenSize = effects->virtualScreenSize();
 
     // mouse-tracking allows navigation of the zoom-area using the mouse.
@@ -374,14 +377,48 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &d
         }
     }
 
-    // Render transformed offscreen texture.
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT);
-
     QMatrix4x4 matrix;
     matrix.translate(xTranslation, yTranslation);
     matrix.scale(zoom, zoom);
 
+    // Render the scene in an offscreen texture and then upscale it. Only the part of the scene
+    // that ends up on the screens is needed, and the part that the texture has from previous
+    // frames is kept unless it changed.
+    const QRect renderTargetRect = effects->renderTargetRect();
+    offscreenData->valid -= effects->renderTargetChanges();
+
+    const QMatrix4x4 inverse = matrix.inverted();
+    QRegion visible;
+    const auto screens = effects->screens();
+    for (EffectScreen *screen : screens) {
+        visible += inverse.mapRect(QRectF(screen->geometry())).toAlignedRect();
+    }
+
+    const QRect dirty = ((visible & renderTargetRect) - offscreenData->valid).boundingRect();
+    if (!dirty.isEmpty()) {
+        const qreal scale = effects->renderTargetScale();
+
+        // The framebuffer has its origin in the bottom left corner. The scissor clips the
+        // background, the windows are clipped in paintWindow().
+        GLFramebuffer::pushFramebuffer(offscreenData->framebuffer.get());
+        GLState::setScissorEnabled(true);
+        glScissor(std::floor((dirty.x() - renderTargetRect.x()) * scale),
+                  std::floor((renderTargetRect.y() + renderTargetRect.height() - dirty.y() - dirty.height()) * scale),
+                  std::ceil(dirty.width() * scale),
+                  std::ceil(dirty.height() * scale));
+        m_offscreenRegion = dirty;
+        effects->paintScreen(mask, region, data);
+        m_offscreenRegion = infiniteRegion();
+        GLState::setScissorEnabled(false);
+        GLFramebuffer::popFramebuffer();
+
+        offscreenData->valid += dirty;
+    }
+
+    // Render transformed offscreen texture.
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
     auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
     shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix() * matrix);
     for (auto &[screen, data] : m_offscreenData) {
@@ -408,8 +445,8 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &d
             QRect rect(p * zoom + QPoint(xTranslation, yTranslation), cursorSize);
 
             cursorTexture->bind();
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            GLState::setBlendEnabled(true);
+            GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             auto s = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
             QMatrix4x4 mvp = data.projectionMatrix();
             mvp.translate(rect.x(), rect.y());
@@ -417,7 +454,7 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &d
             cursorTexture->render(rect);
             ShaderManager::instance()->popShader();
             cursorTexture->unbind();
-            glDisable(GL_BLEND);
+            GLState::setBlendEnabled(false);
         }
     }
 }
@@ -436,6 +473,16 @@ void ZoomEffect::postPaintScreen()
     effects->postPaintScreen();
 }
 
+void ZoomEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowPaintData &data)
+{
+    // Windows are only painted where the offscreen texture is out of date, whatever the
+    // effects further down the chain do with them.
+    if (m_offscreenRegion != infiniteRegion()) {
+        region &= m_offscreenRegion;
+    }
+    effects->paintWindow(w, mask, region, data);
+}
+
 void ZoomEffect::zoomIn(double to)
 {
     source_zoom = zoom;
@@ -549,6 +596,16 @@ void ZoomEffect::moveMouseToCenter()
     QCursor::setPos(r.x() + r.width() / 2, r.y() + r.height() / 2);
 }
 
+// While a screen is zoomed in, it's repainted as a whole, whatever changed. Adding repaints
+// would only make the offscreen textures render the scene again.
+void ZoomEffect::scheduleRepaint()
+{
+    const auto screens = effects->screens();
+    for (EffectScreen *screen : screens) {
+        screen->scheduleRepaint();
+    }
+}
+
 void ZoomEffect::slotMouseChanged(const QPoint &pos, const QPoint &old, Qt::MouseButtons,
                                   Qt::MouseButtons, Qt::KeyboardModifiers, Qt::KeyboardModifiers)
 {
@@ -558,14 +615,14 @@ void ZoomEffect::slotMouseChanged(const QPoint &pos, const QPoint &old, Qt::Mous
     cursorPoint = pos;
     if (pos != old) {
         lastMouseEvent = QTime::currentTime();
-        effects->addRepaintFull();
+        scheduleRepaint();
     }
 }
 
 void ZoomEffect::slotWindowDamaged()
 {
     if (zoom != 1.0) {
-        effects->addRepaintFull();
+        scheduleRepaint();
     }
 }
 
@@ -584,7 +641,7 @@ void ZoomEffect::moveFocus(const QPoint &point)
     }
     focusPoint = point;
     lastFocusEvent = QTime::currentTime();
-    effects->addRepaintFull();
+    scheduleRepaint();
 }
 
 bool ZoomEffect::isActive() const
@@ -47,6 +47,7 @@ public:
     void prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime) override;
     void paintScreen(int mask, const QRegion &region, ScreenPaintData &data) override;
     void postPaintScreen() override;
+    void paintWindow(EffectWindow *w, int mask, QRegion region, WindowPaintData &data) override;
     bool isActive() const override;
     int requestedEffectChainPosition() const override;
     // for properties
@@ -92,11 +93,14 @@ private:
         std::unique_ptr<GLFramebuffer> framebuffer;
         std::unique_ptr<GLVertexBuffer> vbo;
         QRect viewport;
+        // The part of the texture that is up to date, in the global coordinates.
+        QRegion valid;
     };
 
     GLTexture *ensureCursorTexture();
     OffscreenData *ensureOffscreenData(EffectScreen *screen);
     void markCursorTextureDirty();
+    void scheduleRepaint();
 
 #if HAVE_ACCESSIBILITY
     ZoomAccessibilityIntegration *m_accessibilityIntegration = nullptr;
@@ -133,6 +137,8 @@ private:
     double moveFactor;
     std::chrono::milliseconds lastPresentTime;
     std::map<EffectScreen *, OffscreenData> m_offscreenData;
+    // The part of the scene that is being rendered in an offscreen texture.
+    QRegion m_offscreenRegion = infiniteRegion();
 };
 
 } // namespace
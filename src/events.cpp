@@ -346,7 +346,7 @@ bool X11Window::windowEvent(xcb_generic_event_t *e)
         }
         if ((dirtyProperties & NET::WMStrut) != 0
             || (dirtyProperties2 & NET::WM2ExtendedStrut) != 0) {
-            workspace()->updateClientArea();
+            workspace()->updateClientArea(this);
         }
         if ((dirtyProperties & NET::WMIcon) != 0) {
             getIcons();
@@ -412,6 +412,7 @@ bool X11Window::windowEvent(xcb_generic_event_t *e)
         configureRequestEvent(reinterpret_cast<xcb_configure_request_event_t *>(e));
         break;
     case XCB_PROPERTY_NOTIFY:
+        ++m_propertyNotifyCount;
         propertyNotifyEvent(reinterpret_cast<xcb_property_notify_event_t *>(e));
         break;
     case XCB_KEY_PRESS:
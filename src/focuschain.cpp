@@ -10,17 +10,116 @@
 #include "window.h"
 #include "workspace.h"
 
+#include <iterator>
+
 namespace KWin
 {
 
+FocusChain::Chain::Chain(const Chain &other)
+    : m_windows(other.m_windows)
+{
+    rebuildIndex();
+}
+
+FocusChain::Chain &FocusChain::Chain::operator=(const Chain &other)
+{
+    if (this != &other) {
+        m_windows = other.m_windows;
+        rebuildIndex();
+    }
+    return *this;
+}
+
+void FocusChain::Chain::rebuildIndex()
+{
+    m_index.clear();
+    for (auto it = m_windows.begin(); it != m_windows.end(); ++it) {
+        m_index.insert(*it, it);
+    }
+}
+
+bool FocusChain::Chain::isEmpty() const
+{
+    return m_windows.empty();
+}
+
+bool FocusChain::Chain::contains(Window *window) const
+{
+    return m_index.contains(window);
+}
+
+Window *FocusChain::Chain::first() const
+{
+    return m_windows.front();
+}
+
+Window *FocusChain::Chain::last() const
+{
+    return m_windows.back();
+}
+
+FocusChain::Chain::const_iterator FocusChain::Chain::begin() const
+{
+    return m_windows.cbegin();
+}
+
+FocusChain::Chain::const_iterator FocusChain::Chain::end() const
+{
+    return m_windows.cend();
+}
+
+FocusChain::Chain::const_reverse_iterator FocusChain::Chain::rbegin() const
+{
+    return m_windows.crbegin();
+}
+
+FocusChain::Chain::const_reverse_iterator FocusChain::Chain::rend() const
+{
+    return m_windows.crend();
+}
+
+FocusChain::Chain::const_iterator FocusChain::Chain::find(Window *window) const
+{
+    const auto it = m_index.constFind(window);
+    if (it == m_index.constEnd()) {
+        return m_windows.cend();
+    }
+    return *it;
+}
+
+void FocusChain::Chain::append(Window *window)
+{
+    insert(m_windows.cend(), window);
+}
+
+void FocusChain::Chain::prepend(Window *window)
+{
+    insert(m_windows.cbegin(), window);
+}
+
+void FocusChain::Chain::insert(const_iterator position, Window *window)
+{
+    Q_ASSERT(!contains(window));
+    m_index.insert(window, m_windows.insert(position, window));
+}
+
+void FocusChain::Chain::remove(Window *window)
+{
+    const auto it = m_index.find(window);
+    if (it != m_index.end()) {
+        m_windows.erase(*it);
+        m_index.erase(it);
+    }
+}
+
 void FocusChain::remove(Window *window)
 {
     for (auto it = m_desktopFocusChains.begin();
          it != m_desktopFocusChains.end();
          ++it) {
-        it.value().removeAll(window);
+        it.value().remove(window);
     }
-    m_mostRecentlyUsed.removeAll(window);
+    m_mostRecentlyUsed.remove(window);
 }
 
 void FocusChain::addDesktop(VirtualDesktop *desktop)
@@ -48,8 +147,8 @@ Window *FocusChain::getForActivation(VirtualDesktop *desktop, Output *output) co
         return nullptr;
     }
     const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto tmp = chain.at(i);
+    for (auto windowIt = chain.rbegin(); windowIt != chain.rend(); ++windowIt) {
+        auto tmp = *windowIt;
         // TODO: move the check into Window
         if (!tmp->isShade() && tmp->isShown() && tmp->isOnCurrentActivity()
             && (!m_separateScreenFocus || tmp->output() == output)) {
@@ -94,7 +193,7 @@ void FocusChain::update(Window *window, FocusChain::Change change)
             if (window->isOnDesktop(it.key())) {
                 updateWindowInChain(window, change, chain);
             } else {
-                chain.removeAll(window);
+                chain.remove(window);
             }
         }
     }
@@ -119,9 +218,9 @@ void FocusChain::insertWindowIntoChain(Window *window, Chain &chain)
     if (chain.contains(window)) {
         return;
     }
-    if (m_activeWindow && m_activeWindow != window && !chain.empty() && chain.last() == m_activeWindow) {
+    if (m_activeWindow && m_activeWindow != window && !chain.isEmpty() && chain.last() == m_activeWindow) {
         // Add it after the active window
-        chain.insert(chain.size() - 1, window);
+        chain.insert(std::prev(chain.end()), window);
     } else {
         // Otherwise add as the first one
         chain.append(window);
@@ -147,17 +246,16 @@ void FocusChain::moveAfterWindow(Window *window, Window *reference)
 
 void FocusChain::moveAfterWindowInChain(Window *window, Window *reference, Chain &chain)
 {
-    if (!chain.contains(reference)) {
+    if (window == reference || !chain.contains(reference)) {
         return;
     }
+    chain.remove(window);
     if (Window::belongToSameApplication(reference, window)) {
-        chain.removeAll(window);
-        chain.insert(chain.indexOf(reference), window);
+        chain.insert(chain.find(reference), window);
     } else {
-        chain.removeAll(window);
-        for (int i = chain.size() - 1; i >= 0; --i) {
-            if (Window::belongToSameApplication(reference, chain.at(i))) {
-                chain.insert(i, window);
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if (Window::belongToSameApplication(reference, *it)) {
+                chain.insert(std::prev(it.base()), window);
                 break;
             }
         }
@@ -177,14 +275,14 @@ Window *FocusChain::nextMostRecentlyUsed(Window *reference) const
     if (m_mostRecentlyUsed.isEmpty()) {
         return nullptr;
     }
-    const int index = m_mostRecentlyUsed.indexOf(reference);
-    if (index == -1) {
+    const auto it = m_mostRecentlyUsed.find(reference);
+    if (it == m_mostRecentlyUsed.end()) {
         return m_mostRecentlyUsed.first();
     }
-    if (index == 0) {
+    if (it == m_mostRecentlyUsed.begin()) {
         return m_mostRecentlyUsed.last();
     }
-    return m_mostRecentlyUsed.at(index - 1);
+    return *std::prev(it);
 }
 
 // copied from activation.cpp
@@ -200,8 +298,8 @@ Window *FocusChain::nextForDesktop(Window *reference, VirtualDesktop *desktop) c
         return nullptr;
     }
     const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto window = chain.at(i);
+    for (auto windowIt = chain.rbegin(); windowIt != chain.rend(); ++windowIt) {
+        auto window = *windowIt;
         if (isUsableFocusCandidate(window, reference)) {
             return window;
         }
@@ -211,12 +309,12 @@ Window *FocusChain::nextForDesktop(Window *reference, VirtualDesktop *desktop) c
 
 void FocusChain::makeFirstInChain(Window *window, Chain &chain)
 {
-    chain.removeAll(window);
+    chain.remove(window);
     if (options->moveMinimizedWindowsToEndOfTabBoxFocusChain()) {
         if (window->isMinimized()) { // add it before the first minimized ...
-            for (int i = chain.count() - 1; i >= 0; --i) {
-                if (chain.at(i)->isMinimized()) {
-                    chain.insert(i + 1, window);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                if ((*it)->isMinimized()) {
+                    chain.insert(it.base(), window);
                     return;
                 }
             }
@@ -231,7 +329,7 @@ void FocusChain::makeFirstInChain(Window *window, Chain &chain)
 
 void FocusChain::makeLastInChain(Window *window, Chain &chain)
 {
-    chain.removeAll(window);
+    chain.remove(window);
     chain.prepend(window);
 }
 
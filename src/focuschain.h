@@ -13,6 +13,8 @@
 // Qt
 #include <QHash>
 #include <QObject>
+// STL
+#include <list>
 
 namespace KWin
 {
@@ -174,7 +176,50 @@ public Q_SLOTS:
     void removeDesktop(VirtualDesktop *desktop);
 
 private:
-    using Chain = QList<Window *>;
+    /**
+     * A focus chain is a linked list of windows, the first item being the least recently used
+     * window and the last item being the most recently used one. The position of every window
+     * is indexed, so looking up, inserting and removing a window take constant time.
+     */
+    class Chain
+    {
+    public:
+        using const_iterator = std::list<Window *>::const_iterator;
+        using const_reverse_iterator = std::list<Window *>::const_reverse_iterator;
+
+        Chain() = default;
+        Chain(const Chain &other);
+        Chain &operator=(const Chain &other);
+
+        bool isEmpty() const;
+        bool contains(Window *window) const;
+        Window *first() const;
+        Window *last() const;
+
+        const_iterator begin() const;
+        const_iterator end() const;
+        const_reverse_iterator rbegin() const;
+        const_reverse_iterator rend() const;
+        /**
+         * Returns the position of @p window, or end() if it's not in the chain.
+         */
+        const_iterator find(Window *window) const;
+
+        void append(Window *window);
+        void prepend(Window *window);
+        /**
+         * Inserts @p window in front of @p position, the window must not be in the chain yet.
+         */
+        void insert(const_iterator position, Window *window);
+        void remove(Window *window);
+
+    private:
+        void rebuildIndex();
+
+        std::list<Window *> m_windows;
+        QHash<Window *, std::list<Window *>::iterator> m_index;
+    };
+
     /**
      * @brief Makes @p window the first Window in the given focus @p chain.
      *
@@ -0,0 +1,275 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "frametrace.h"
+#include "core/output.h"
+#include "core/renderloop.h"
+#include "core/renderloop_p.h"
+#include "effects.h"
+#include "surfaceitem.h"
+#include "utils/common.h"
+#include "window.h"
+#include "windowitem.h"
+#include "workspace.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace KWin
+{
+
+static QJsonArray rectToJson(const QRect &rect)
+{
+    return QJsonArray{rect.x(), rect.y(), rect.width(), rect.height()};
+}
+
+static QRect rectFromJson(const QJsonValue &value)
+{
+    const QJsonArray array = value.toArray();
+    if (array.count() != 4) {
+        return QRect();
+    }
+    return QRect(array[0].toInt(), array[1].toInt(), array[2].toInt(), array[3].toInt());
+}
+
+static QJsonArray regionToJson(const QRegion &region)
+{
+    QJsonArray array;
+    for (const QRect &rect : region) {
+        array.append(rectToJson(rect));
+    }
+    return array;
+}
+
+static QRegion regionFromJson(const QJsonValue &value)
+{
+    QRegion region;
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &rect : array) {
+        region += rectFromJson(rect);
+    }
+    return region;
+}
+
+QByteArray FrameTrace::frameToJson(const Frame &frame)
+{
+    QJsonArray surfaces;
+    for (const Surface &surface : frame.surfaces) {
+        surfaces.append(QJsonObject{
+            {QStringLiteral("id"), surface.id},
+            {QStringLiteral("resourceClass"), surface.resourceClass},
+            {QStringLiteral("geometry"), rectToJson(surface.geometry)},
+            {QStringLiteral("size"), QJsonArray{surface.size.width(), surface.size.height()}},
+            {QStringLiteral("damage"), regionToJson(surface.damage)},
+            {QStringLiteral("opaque"), regionToJson(surface.opaque)},
+            {QStringLiteral("opacity"), surface.opacity},
+        });
+    }
+
+    const QJsonObject object{
+        {QStringLiteral("type"), QStringLiteral("frame")},
+        {QStringLiteral("output"), frame.output},
+        {QStringLiteral("outputGeometry"), rectToJson(frame.outputGeometry)},
+        {QStringLiteral("refreshRate"), qint64(frame.refreshRate)},
+        {QStringLiteral("timestamp"), qint64(frame.timestamp.count())},
+        {QStringLiteral("activeEffects"), QJsonArray::fromStringList(frame.activeEffects)},
+        {QStringLiteral("surfaces"), surfaces},
+    };
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+QByteArray FrameTrace::presentationToJson(const QString &output, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds renderTime)
+{
+    const QJsonObject object{
+        {QStringLiteral("type"), QStringLiteral("presentation")},
+        {QStringLiteral("output"), output},
+        {QStringLiteral("timestamp"), qint64(timestamp.count())},
+        {QStringLiteral("renderTime"), qint64(renderTime.count())},
+    };
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+std::optional<FrameTrace> FrameTrace::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(KWIN_CORE) << "Failed to open the frame trace" << fileName << file.errorString();
+        return std::nullopt;
+    }
+
+    FrameTrace trace;
+    // the presentation of the last frame of each output, if it hasn't been recorded yet
+    QHash<QString, int> unpresentedFrames;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonObject object = QJsonDocument::fromJson(line, &error).object();
+        if (error.error != QJsonParseError::NoError) {
+            qCWarning(KWIN_CORE) << "Failed to parse the frame trace" << fileName << error.errorString();
+            return std::nullopt;
+        }
+
+        const QString type = object[QStringLiteral("type")].toString();
+        const QString output = object[QStringLiteral("output")].toString();
+        if (type == QLatin1String("frame")) {
+            Frame frame;
+            frame.output = output;
+            frame.outputGeometry = rectFromJson(object[QStringLiteral("outputGeometry")]);
+            frame.refreshRate = object[QStringLiteral("refreshRate")].toInt();
+            frame.timestamp = std::chrono::nanoseconds(object[QStringLiteral("timestamp")].toVariant().toLongLong());
+            frame.activeEffects = object[QStringLiteral("activeEffects")].toVariant().toStringList();
+
+            const QJsonArray surfaces = object[QStringLiteral("surfaces")].toArray();
+            for (const QJsonValue &value : surfaces) {
+                const QJsonObject surfaceObject = value.toObject();
+                const QJsonArray size = surfaceObject[QStringLiteral("size")].toArray();
+
+                Surface surface;
+                surface.id = surfaceObject[QStringLiteral("id")].toString();
+                surface.resourceClass = surfaceObject[QStringLiteral("resourceClass")].toString();
+                surface.geometry = rectFromJson(surfaceObject[QStringLiteral("geometry")]);
+                surface.size = QSize(size[0].toInt(), size[1].toInt());
+                surface.damage = regionFromJson(surfaceObject[QStringLiteral("damage")]);
+                surface.opaque = regionFromJson(surfaceObject[QStringLiteral("opaque")]);
+                surface.opacity = surfaceObject[QStringLiteral("opacity")].toDouble(1.0);
+                frame.surfaces.append(surface);
+            }
+
+            unpresentedFrames[output] = trace.frames.count();
+            trace.frames.append(frame);
+        } else if (type == QLatin1String("presentation")) {
+            const int index = unpresentedFrames.value(output, -1);
+            unpresentedFrames.remove(output);
+            if (index != -1) {
+                trace.frames[index].renderTime = std::chrono::nanoseconds(object[QStringLiteral("renderTime")].toVariant().toLongLong());
+            }
+        }
+    }
+
+    return trace;
+}
+
+KWIN_SINGLETON_FACTORY(FrameTraceRecorder)
+
+FrameTraceRecorder::FrameTraceRecorder(QObject *parent)
+    : QObject(parent)
+{
+    const QString fileName = qEnvironmentVariable("KWIN_FRAME_TRACE");
+    if (!fileName.isEmpty()) {
+        start(fileName);
+    }
+}
+
+FrameTraceRecorder::~FrameTraceRecorder()
+{
+    stop();
+    s_self = nullptr;
+}
+
+bool FrameTraceRecorder::isRecording() const
+{
+    return m_file.isOpen();
+}
+
+QString FrameTraceRecorder::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool FrameTraceRecorder::start(const QString &fileName)
+{
+    stop();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(KWIN_CORE) << "Failed to open the frame trace" << fileName << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void FrameTraceRecorder::stop()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_presentationConnections)) {
+        disconnect(connection);
+    }
+    m_presentationConnections.clear();
+    m_file.close();
+}
+
+void FrameTraceRecorder::write(const QByteArray &line)
+{
+    if (m_file.write(line + '\n') == -1) {
+        qCWarning(KWIN_CORE) << "Failed to write the frame trace, stopping it" << m_file.errorString();
+        stop();
+    }
+}
+
+void FrameTraceRecorder::recordFrame(Output *output)
+{
+    if (!isRecording()) {
+        return;
+    }
+
+    RenderLoop *renderLoop = output->renderLoop();
+    if (!m_presentationConnections.contains(renderLoop)) {
+        m_presentationConnections.insert(renderLoop, connect(renderLoop, &RenderLoop::framePresented, this, &FrameTraceRecorder::handleFramePresented));
+        connect(renderLoop, &QObject::destroyed, this, [this, renderLoop]() {
+            m_presentationConnections.remove(renderLoop);
+        });
+    }
+
+    FrameTrace::Frame frame;
+    frame.output = output->name();
+    frame.outputGeometry = output->geometry();
+    frame.refreshRate = output->refreshRate();
+    frame.timestamp = std::chrono::steady_clock::now().time_since_epoch();
+    if (effects) {
+        frame.activeEffects = static_cast<EffectsHandlerImpl *>(effects)->activeEffects();
+    }
+
+    const QList<Window *> windows = workspace()->stackingOrder();
+    for (Window *window : windows) {
+        SurfaceItem *surfaceItem = window->surfaceItem();
+        if (!surfaceItem || !window->windowItem() || !window->windowItem()->isVisible()) {
+            continue;
+        }
+        const QRect geometry = surfaceItem->mapToGlobal(surfaceItem->rect()).toRect();
+        if (!geometry.intersects(frame.outputGeometry)) {
+            continue;
+        }
+
+        FrameTrace::Surface surface;
+        surface.id = window->internalId().toString();
+        surface.resourceClass = QString::fromUtf8(window->resourceClass());
+        surface.geometry = geometry;
+        surface.size = surfaceItem->size().toSize();
+        surface.damage = surfaceItem->damage();
+        surface.opaque = surfaceItem->opaque();
+        surface.opacity = window->opacity();
+        frame.surfaces.append(surface);
+    }
+
+    write(FrameTrace::frameToJson(frame));
+}
+
+void FrameTraceRecorder::handleFramePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp)
+{
+    const QList<Output *> outputs = workspace()->outputs();
+    for (Output *output : outputs) {
+        if (output->renderLoop() == renderLoop) {
+            write(FrameTrace::presentationToJson(output->name(), timestamp, RenderLoopPrivate::get(renderLoop)->renderJournal.latest()));
+            return;
+        }
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,120 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QRect>
+#include <QRegion>
+#include <QStringList>
+#include <QVector>
+
+#include <chrono>
+#include <optional>
+
+namespace KWin
+{
+
+class Output;
+class RenderLoop;
+
+/**
+ * The FrameTrace class is a recording of what the compositor has been given to composite,
+ * frame by frame. It's renderer agnostic: it contains the geometry, the damage and the opaque
+ * regions of the surfaces, not their contents, so it can be replayed with synthetic buffers.
+ *
+ * The trace is stored as JSON, one object per line. A frame line is written when an output is
+ * composited, a presentation line when the frame has been shown.
+ */
+class KWIN_EXPORT FrameTrace
+{
+public:
+    struct Surface
+    {
+        /**
+         * The internal id of the window, stable for the lifetime of the window.
+         */
+        QString id;
+        QString resourceClass;
+        QRect geometry;
+        QSize size;
+        QRegion damage;
+        QRegion opaque;
+        qreal opacity = 1.0;
+    };
+
+    struct Frame
+    {
+        QString output;
+        QRect outputGeometry;
+        uint refreshRate = 0;
+        std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+        /**
+         * The render time of the frame, or zero if its presentation hasn't been recorded.
+         */
+        std::chrono::nanoseconds renderTime = std::chrono::nanoseconds::zero();
+        QStringList activeEffects;
+        /**
+         * The surfaces on the output, in stacking order from bottom to top.
+         */
+        QVector<Surface> surfaces;
+    };
+
+    QVector<Frame> frames;
+
+    /**
+     * Reads the trace stored in @a fileName, returns an empty optional if it can't be read.
+     */
+    static std::optional<FrameTrace> load(const QString &fileName);
+
+    static QByteArray frameToJson(const Frame &frame);
+    static QByteArray presentationToJson(const QString &output, std::chrono::nanoseconds timestamp, std::chrono::nanoseconds renderTime);
+};
+
+/**
+ * The FrameTraceRecorder records a FrameTrace of the running session.
+ *
+ * It's started by setting the KWIN_FRAME_TRACE environment variable to a file name, or over
+ * D-Bus with org.kde.KWin.FrameStats.StartFrameTrace. The trace can be replayed on the virtual
+ * backend with the frame trace replay benchmark.
+ */
+class KWIN_EXPORT FrameTraceRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~FrameTraceRecorder() override;
+
+    bool isRecording() const;
+    QString fileName() const;
+    /**
+     * Starts writing a trace to @a fileName, it's truncated. A trace that is being recorded
+     * already is finished first.
+     */
+    bool start(const QString &fileName);
+    void stop();
+
+    /**
+     * Records the frame that is about to be composited on @a output.
+     */
+    void recordFrame(Output *output);
+
+private:
+    void write(const QByteArray &line);
+    void handleFramePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp);
+
+    QFile m_file;
+    QHash<RenderLoop *, QMetaObject::Connection> m_presentationConnections;
+
+    KWIN_SINGLETON(FrameTraceRecorder)
+};
+
+} // namespace KWin
@@ -113,6 +113,12 @@ QString FTraceLogger::filePath()
     return markerFileInfo.absoluteFilePath();
 }
 
+quint32 FTraceLogger::nextContext()
+{
+    static QAtomicInteger<quint32> s_context = 0;
+    return ++s_context;
+}
+
 FTraceDuration::~FTraceDuration()
 {
     FTraceLogger::self()->trace(m_message, " end_ctx=", m_context);
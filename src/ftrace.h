@@ -9,8 +9,11 @@
 
 #pragma once
 
+#include <config-kwin.h>
 #include <kwinglobals.h>
 
+#include "utils/allocationtracker.h"
+
 #include <QFile>
 #include <QMutex>
 #include <QMutexLocker>
@@ -55,6 +58,12 @@ public:
         (stream << ... << args) << Qt::endl;
     }
 
+    /**
+     * Returns a new context id for a pair of begin_ctx and end_ctx markers. The ids are unique
+     * across all marker types, so they can be used to correlate the markers of a single frame.
+     */
+    static quint32 nextContext();
+
 Q_SIGNALS:
     void enabledChanged();
 
@@ -75,11 +84,10 @@ public:
     template<typename... Args>
     FTraceDuration(Args... args)
     {
-        static QAtomicInteger<quint32> s_context = 0;
         QTextStream stream(&m_message);
         (stream << ... << args);
         stream.flush();
-        m_context = ++s_context;
+        m_context = FTraceLogger::nextContext();
         FTraceLogger::self()->trace(m_message, " begin_ctx=", m_context);
     }
 
@@ -102,6 +110,28 @@ private:
 /**
  * Will insert two markers into the log. Once when called, and the second at the end of the relevant block
  * In GPUVis this will appear as a timed block with begin_ctx and end_ctx markers
+ *
+ * With KWIN_BUILD_ALLOCATION_TRACKING, the allocations of the block are also attributed to the phase
+ * named by the first argument, which must be a string literal, see AllocationTracker.
  */
+#if KWIN_BUILD_ALLOCATION_TRACKING
+#define fTraceDuration(...)                              \
+    KWin::AllocationScope _allocationScope(__VA_ARGS__); \
+    std::unique_ptr<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isEnabled() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+#else
 #define fTraceDuration(...) \
     std::unique_ptr<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isEnabled() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+#endif
+
+/**
+ * Inserts the begin or the end marker of a block that doesn't match a C++ scope, e.g. a frame that
+ * is painted in one event loop cycle and presented in a later one. The context must be obtained
+ * with FTraceLogger::nextContext() and passed to both markers.
+ */
+#define fTraceBegin(context, ...)                \
+    if (KWin::FTraceLogger::self()->isEnabled()) \
+        KWin::FTraceLogger::self()->trace(__VA_ARGS__, " begin_ctx=", context);
+
+#define fTraceEnd(context, ...)                  \
+    if (KWin::FTraceLogger::self()->isEnabled()) \
+        KWin::FTraceLogger::self()->trace(__VA_ARGS__, " end_ctx=", context);
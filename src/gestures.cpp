@@ -94,6 +94,7 @@ void GestureRecognizer::registerSwipeGesture(KWin::SwipeGesture *gesture)
     auto connection = connect(gesture, &QObject::destroyed, this, std::bind(&GestureRecognizer::unregisterSwipeGesture, this, gesture));
     m_destroyConnections.insert(gesture, connection);
     m_swipeGestures << gesture;
+    m_swipeCandidates.clear();
 }
 
 void GestureRecognizer::unregisterSwipeGesture(KWin::SwipeGesture *gesture)
@@ -104,6 +105,7 @@ void GestureRecognizer::unregisterSwipeGesture(KWin::SwipeGesture *gesture)
         m_destroyConnections.erase(it);
     }
     m_swipeGestures.removeAll(gesture);
+    m_swipeCandidates.clear();
     if (m_activeSwipeGestures.removeOne(gesture)) {
         Q_EMIT gesture->cancelled();
     }
@@ -115,6 +117,7 @@ void GestureRecognizer::registerPinchGesture(KWin::PinchGesture *gesture)
     auto connection = connect(gesture, &QObject::destroyed, this, std::bind(&GestureRecognizer::unregisterPinchGesture, this, gesture));
     m_destroyConnections.insert(gesture, connection);
     m_pinchGestures << gesture;
+    m_pinchCandidates.clear();
 }
 
 void GestureRecognizer::unregisterPinchGesture(KWin::PinchGesture *gesture)
@@ -125,29 +128,83 @@ void GestureRecognizer::unregisterPinchGesture(KWin::PinchGesture *gesture)
         m_destroyConnections.erase(it);
     }
     m_pinchGestures.removeAll(gesture);
+    m_pinchCandidates.clear();
     if (m_activePinchGestures.removeOne(gesture)) {
         Q_EMIT gesture->cancelled();
     }
 }
 
-int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior)
+template<typename T>
+static bool acceptsFingerCount(const T *gesture, uint fingerCount)
 {
-    m_currentFingerCount = fingerCount;
-    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
-        return 0;
+    if (gesture->minimumFingerCountIsRelevant() && gesture->minimumFingerCount() > fingerCount) {
+        return false;
     }
-    int count = 0;
-    for (SwipeGesture *gesture : qAsConst(m_swipeGestures)) {
-        if (gesture->minimumFingerCountIsRelevant()) {
-            if (gesture->minimumFingerCount() > fingerCount) {
+    if (gesture->maximumFingerCountIsRelevant() && gesture->maximumFingerCount() < fingerCount) {
+        return false;
+    }
+    return true;
+}
+
+const QVector<SwipeGesture *> &GestureRecognizer::swipeCandidates(uint fingerCount, Axis axis)
+{
+    auto it = m_swipeCandidates.find(fingerCount);
+    if (it == m_swipeCandidates.end()) {
+        SwipeCandidates candidates;
+        for (SwipeGesture *gesture : qAsConst(m_swipeGestures)) {
+            if (!acceptsFingerCount(gesture, fingerCount)) {
                 continue;
             }
+            switch (gesture->direction()) {
+            case SwipeGesture::Direction::Up:
+            case SwipeGesture::Direction::Down:
+                candidates.vertical << gesture;
+                break;
+            case SwipeGesture::Direction::Left:
+            case SwipeGesture::Direction::Right:
+                candidates.horizontal << gesture;
+                break;
+            }
+            candidates.all << gesture;
         }
-        if (gesture->maximumFingerCountIsRelevant()) {
-            if (gesture->maximumFingerCount() < fingerCount) {
-                continue;
+        it = m_swipeCandidates.insert(fingerCount, candidates);
+    }
+    // Only gestures who's direction aligns with current swipe axis
+    switch (axis) {
+    case Axis::Horizontal:
+        return it->horizontal;
+    case Axis::Vertical:
+        return it->vertical;
+    default:
+        return it->all;
+    }
+}
+
+const QVector<PinchGesture *> &GestureRecognizer::pinchCandidates(uint fingerCount)
+{
+    auto it = m_pinchCandidates.find(fingerCount);
+    if (it == m_pinchCandidates.end()) {
+        QVector<PinchGesture *> candidates;
+        for (PinchGesture *gesture : qAsConst(m_pinchGestures)) {
+            if (acceptsFingerCount(gesture, fingerCount)) {
+                candidates << gesture;
             }
         }
+        it = m_pinchCandidates.insert(fingerCount, candidates);
+    }
+    return *it;
+}
+
+int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior)
+{
+    m_currentFingerCount = fingerCount;
+    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
+        return 0;
+    }
+    int count = 0;
+    // copied, the started() signal might register or unregister gestures
+    const QVector<SwipeGesture *> candidates = swipeCandidates(fingerCount, m_currentSwipeAxis);
+    for (SwipeGesture *gesture : candidates) {
         if (startPosBehavior == StartPositionBehavior::Relevant) {
             if (gesture->minimumXIsRelevant()) {
                 if (gesture->minimumX() > startPos.x()) {
@@ -171,22 +228,6 @@ int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startP
             }
         }
 
-        // Only add gestures who's direction aligns with current swipe axis
-        switch (gesture->direction()) {
-        case SwipeGesture::Direction::Up:
-        case SwipeGesture::Direction::Down:
-            if (m_currentSwipeAxis == Axis::Horizontal) {
-                continue;
-            }
-            break;
-        case SwipeGesture::Direction::Left:
-        case SwipeGesture::Direction::Right:
-            if (m_currentSwipeAxis == Axis::Vertical) {
-                continue;
-            }
-            break;
-        }
-
         m_activeSwipeGestures << gesture;
         count++;
         Q_EMIT gesture->started();
@@ -307,18 +348,8 @@ int GestureRecognizer::startPinchGesture(uint fingerCount)
     if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
         return 0;
     }
-    for (PinchGesture *gesture : qAsConst(m_pinchGestures)) {
-        if (gesture->minimumFingerCountIsRelevant()) {
-            if (gesture->minimumFingerCount() > fingerCount) {
-                continue;
-            }
-        }
-        if (gesture->maximumFingerCountIsRelevant()) {
-            if (gesture->maximumFingerCount() < fingerCount) {
-                continue;
-            }
-        }
-
+    const QVector<PinchGesture *> candidates = pinchCandidates(fingerCount);
+    for (PinchGesture *gesture : candidates) {
         // direction doesn't matter yet
         m_activePinchGestures << gesture;
         count++;
@@ -11,6 +11,7 @@
 
 #include <kwin_export.h>
 
+#include <QHash>
 #include <QMap>
 #include <QObject>
 #include <QPointF>
@@ -179,6 +180,12 @@ private:
     qreal m_minimumScaleDelta = DEFAULT_UNIT_SCALE_DELTA;
 };
 
+/**
+ * The GestureRecognizer matches swipe and pinch gestures against the registered Gestures.
+ *
+ * The finger count and direction of a Gesture must not be changed while it's registered, they
+ * are used to look up the candidates for a gesture without going through all registered ones.
+ */
 class KWIN_EXPORT GestureRecognizer : public QObject
 {
     Q_OBJECT
@@ -214,9 +221,20 @@ private:
         Vertical,
         None,
     };
+    struct SwipeCandidates
+    {
+        QVector<SwipeGesture *> horizontal;
+        QVector<SwipeGesture *> vertical;
+        QVector<SwipeGesture *> all;
+    };
     int startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior);
+    const QVector<SwipeGesture *> &swipeCandidates(uint fingerCount, Axis axis);
+    const QVector<PinchGesture *> &pinchCandidates(uint fingerCount);
     QVector<SwipeGesture *> m_swipeGestures;
     QVector<PinchGesture *> m_pinchGestures;
+    // registered gestures by finger count, in the order of registration
+    QHash<uint, SwipeCandidates> m_swipeCandidates;
+    QHash<uint, QVector<PinchGesture *>> m_pinchCandidates;
     QVector<SwipeGesture *> m_activeSwipeGestures;
     QVector<PinchGesture *> m_activePinchGestures;
     QMap<Gesture *, QMetaObject::Connection> m_destroyConnections;
@@ -129,11 +129,26 @@ void GlobalShortcutsManager::init()
     }
 }
 
+static QPair<uint, uint> pointerButtonKey(Qt::KeyboardModifiers modifiers, Qt::MouseButtons pointerButtons)
+{
+    return qMakePair(uint(modifiers), uint(pointerButtons));
+}
+
+static QPair<uint, uint> pointerAxisKey(Qt::KeyboardModifiers modifiers, PointerAxisDirection axis)
+{
+    return qMakePair(uint(modifiers), uint(axis));
+}
+
 void GlobalShortcutsManager::objectDeleted(QObject *object)
 {
     auto it = m_shortcuts.begin();
     while (it != m_shortcuts.end()) {
         if (it->action() == object) {
+            if (auto shortcut = std::get_if<PointerButtonShortcut>(&it->shortcut())) {
+                m_pointerButtonShortcuts.remove(pointerButtonKey(shortcut->pointerModifiers, shortcut->pointerButtons));
+            } else if (auto shortcut = std::get_if<PointerAxisShortcut>(&it->shortcut())) {
+                m_pointerAxisShortcuts.remove(pointerAxisKey(shortcut->axisModifiers, shortcut->axisDirection));
+            }
             it = m_shortcuts.erase(it);
         } else {
             ++it;
@@ -143,10 +158,24 @@ void GlobalShortcutsManager::objectDeleted(QObject *object)
 
 bool GlobalShortcutsManager::addIfNotExists(GlobalShortcut sc, DeviceType device)
 {
-    for (const auto &cs : qAsConst(m_shortcuts)) {
-        if (sc.shortcut() == cs.shortcut()) {
+    if (auto shortcut = std::get_if<PointerButtonShortcut>(&sc.shortcut())) {
+        const auto key = pointerButtonKey(shortcut->pointerModifiers, shortcut->pointerButtons);
+        if (m_pointerButtonShortcuts.contains(key)) {
+            return false;
+        }
+        m_pointerButtonShortcuts.insert(key, sc.action());
+    } else if (auto shortcut = std::get_if<PointerAxisShortcut>(&sc.shortcut())) {
+        const auto key = pointerAxisKey(shortcut->axisModifiers, shortcut->axisDirection);
+        if (m_pointerAxisShortcuts.contains(key)) {
             return false;
         }
+        m_pointerAxisShortcuts.insert(key, sc.action());
+    } else {
+        for (const auto &cs : qAsConst(m_shortcuts)) {
+            if (sc.shortcut() == cs.shortcut()) {
+                return false;
+            }
+        }
     }
 
     const auto &recognizer = device == DeviceType::Touchpad ? m_touchpadGestureRecognizer : m_touchscreenGestureRecognizer;
@@ -256,29 +285,24 @@ bool GlobalShortcutsManager::processKeyRelease(Qt::KeyboardModifiers mods, int k
     return false;
 }
 
-template<typename ShortcutKind, typename... Args>
-bool match(QVector<GlobalShortcut> &shortcuts, Args... args)
+static bool invoke(const QHash<QPair<uint, uint>, QAction *> &shortcuts, const QPair<uint, uint> &key)
 {
-    for (auto &sc : shortcuts) {
-        if (std::holds_alternative<ShortcutKind>(sc.shortcut())) {
-            if (std::get<ShortcutKind>(sc.shortcut()) == ShortcutKind{args...}) {
-                sc.invoke();
-                return true;
-            }
-        }
+    QAction *action = shortcuts.value(key);
+    if (!action) {
+        return false;
     }
-    return false;
+    QMetaObject::invokeMethod(action, "trigger", Qt::QueuedConnection);
+    return true;
 }
 
-// TODO(C++20): use ranges for a nicer way of filtering by shortcut type
 bool GlobalShortcutsManager::processPointerPressed(Qt::KeyboardModifiers mods, Qt::MouseButtons pointerButtons)
 {
-    return match<PointerButtonShortcut>(m_shortcuts, mods, pointerButtons);
+    return invoke(m_pointerButtonShortcuts, pointerButtonKey(mods, pointerButtons));
 }
 
 bool GlobalShortcutsManager::processAxis(Qt::KeyboardModifiers mods, PointerAxisDirection axis)
 {
-    return match<PointerAxisShortcut>(m_shortcuts, mods, axis);
+    return invoke(m_pointerAxisShortcuts, pointerAxisKey(mods, axis));
 }
 
 void GlobalShortcutsManager::processSwipeStart(DeviceType device, uint fingerCount)
@@ -11,6 +11,7 @@
 // KWin
 #include <kwinglobals.h>
 // Qt
+#include <QHash>
 #include <QKeySequence>
 
 #include <memory>
@@ -123,6 +124,10 @@ private:
     bool addIfNotExists(GlobalShortcut sc, DeviceType device = DeviceType::Touchpad);
 
     QVector<GlobalShortcut> m_shortcuts;
+    // The pointer button and axis shortcuts by their modifiers and button or axis, so a pointer
+    // event is matched with a lookup instead of going through all shortcuts.
+    QHash<QPair<uint, uint>, QAction *> m_pointerButtonShortcuts;
+    QHash<QPair<uint, uint>, QAction *> m_pointerAxisShortcuts;
 
     std::unique_ptr<KGlobalAccelD> m_kglobalAccel;
     KGlobalAccelInterface *m_kglobalAccelInterface = nullptr;
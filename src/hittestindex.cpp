@@ -0,0 +1,209 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "hittestindex.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace KWin
+{
+
+// Big enough that a typical window only covers a handful of cells, small enough that
+// a cell is rarely covered by more than a few windows
+static const int s_cellSize = 256;
+
+HitTestIndex::HitTestIndex(QObject *parent)
+    : QObject(parent)
+{
+    // a window entering or leaving the stack always goes along with a restack, windows that
+    // are added get included as soon as they're part of the stacking order
+    connect(workspace(), &Workspace::stackingOrderChanged, this, &HitTestIndex::invalidateStackingOrder);
+    connect(workspace(), &Workspace::windowAdded, this, &HitTestIndex::invalidateStackingOrder);
+    connect(workspace(), &Workspace::unmanagedAdded, this, &HitTestIndex::invalidateStackingOrder);
+    connect(workspace(), &Workspace::internalWindowAdded, this, &HitTestIndex::invalidateStackingOrder);
+}
+
+QVector<Window *> HitTestIndex::candidatesAt(const QPointF &pos)
+{
+    if (m_stackingOrderDirty) {
+        sync();
+    }
+    if (m_lastQueryValid && m_lastQueryPos == pos) {
+        // several input filters usually look up the window under the same position
+        return m_lastQueryResult;
+    }
+
+    QVector<Window *> result;
+    const auto it = m_cells.constFind(cellKey(std::floor(pos.x() / s_cellSize), std::floor(pos.y() / s_cellSize)));
+    if (it != m_cells.constEnd()) {
+        for (Window *window : *it) {
+            if (QRectF(m_bounds.value(window)).contains(pos)) {
+                result.append(window);
+            }
+        }
+        std::sort(result.begin(), result.end(), [this](Window *a, Window *b) {
+            return m_stackingPosition.value(a) > m_stackingPosition.value(b);
+        });
+    }
+
+    m_lastQueryValid = true;
+    m_lastQueryPos = pos;
+    m_lastQueryResult = result;
+    return result;
+}
+
+void HitTestIndex::invalidateStackingOrder()
+{
+    m_stackingOrderDirty = true;
+    invalidateLastQuery();
+}
+
+void HitTestIndex::invalidateLastQuery()
+{
+    m_lastQueryValid = false;
+    m_lastQueryResult.clear();
+}
+
+void HitTestIndex::sync()
+{
+    m_stackingOrderDirty = false;
+    const QList<Window *> &stacking = workspace()->stackingOrder();
+
+    QHash<Window *, int> stackingPosition;
+    stackingPosition.reserve(stacking.count());
+    for (int i = 0; i < stacking.count(); ++i) {
+        Window *window = stacking[i];
+        if (window->isDeleted()) {
+            // a deleted window doesn't get mouse events
+            continue;
+        }
+        stackingPosition.insert(window, i);
+        if (!m_bounds.contains(window)) {
+            addWindow(window);
+        }
+    }
+    const QList<Window *> indexed = m_bounds.keys();
+    for (Window *window : indexed) {
+        if (!stackingPosition.contains(window)) {
+            removeWindow(window);
+        }
+    }
+    m_stackingPosition = stackingPosition;
+}
+
+void HitTestIndex::addWindow(Window *window)
+{
+    const QRect bounds = inputBounds(window);
+    m_bounds.insert(window, bounds);
+    insertIntoCells(window, bounds);
+
+    connect(window, &Window::frameGeometryChanged, this, &HitTestIndex::updateWindow);
+    connect(window, &Window::bufferGeometryChanged, this, &HitTestIndex::updateWindow);
+    connect(window, &Window::visibleGeometryChanged, this, [this, window]() {
+        updateWindow(window);
+    });
+    connect(window, &Window::decorationChanged, this, [this, window]() {
+        updateWindow(window);
+    });
+    connect(window, &Window::windowClosed, this, &HitTestIndex::removeWindow);
+    // the pointer must not outlive the window, no matter how it goes away
+    connect(window, &QObject::destroyed, this, [this, window]() {
+        removeWindow(window);
+    });
+}
+
+void HitTestIndex::removeWindow(Window *window)
+{
+    const auto it = m_bounds.find(window);
+    if (it == m_bounds.end()) {
+        return;
+    }
+    removeFromCells(window, *it);
+    m_bounds.erase(it);
+    m_stackingPosition.remove(window);
+    disconnect(window, nullptr, this, nullptr);
+    invalidateLastQuery();
+}
+
+void HitTestIndex::updateWindow(Window *window)
+{
+    const auto it = m_bounds.find(window);
+    if (it == m_bounds.end()) {
+        return;
+    }
+    const QRect bounds = inputBounds(window);
+    if (bounds == *it) {
+        return;
+    }
+    if (cellRange(bounds) != cellRange(*it)) {
+        removeFromCells(window, *it);
+        insertIntoCells(window, bounds);
+    }
+    *it = bounds;
+    invalidateLastQuery();
+}
+
+void HitTestIndex::insertIntoCells(Window *window, const QRect &bounds)
+{
+    const QRect range = cellRange(bounds);
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            m_cells[cellKey(x, y)].append(window);
+        }
+    }
+    invalidateLastQuery();
+}
+
+void HitTestIndex::removeFromCells(Window *window, const QRect &bounds)
+{
+    const QRect range = cellRange(bounds);
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            const auto it = m_cells.find(cellKey(x, y));
+            if (it == m_cells.end()) {
+                continue;
+            }
+            it->removeOne(window);
+            if (it->isEmpty()) {
+                m_cells.erase(it);
+            }
+        }
+    }
+}
+
+QRect HitTestIndex::inputBounds(const Window *window)
+{
+    // Window::hitTest() accepts points on the decoration, including the resize only borders,
+    // and on the input region of the surface and its subsurfaces, which may stick out of the
+    // buffer but are always inside the bounding rect of the window item
+    const QRectF bounds = window->frameGeometry()
+        | window->bufferGeometry()
+        | window->inputGeometry()
+        | window->visibleGeometry();
+    return bounds.toAlignedRect();
+}
+
+QRect HitTestIndex::cellRange(const QRect &bounds)
+{
+    if (bounds.isEmpty()) {
+        return QRect();
+    }
+    const int left = std::floor(qreal(bounds.left()) / s_cellSize);
+    const int top = std::floor(qreal(bounds.top()) / s_cellSize);
+    const int right = std::floor(qreal(bounds.right()) / s_cellSize);
+    const int bottom = std::floor(qreal(bounds.bottom()) / s_cellSize);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+quint64 HitTestIndex::cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+} // namespace KWin
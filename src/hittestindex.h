@@ -0,0 +1,68 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QPointF>
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+class Window;
+
+/**
+ * The HitTestIndex keeps track of the area in which each window in the stacking order can
+ * accept pointer input, so that finding the window under a point doesn't have to test every
+ * window.
+ *
+ * The workspace is split into a grid of square cells, and each cell references the windows
+ * whose input bounds intersect it. The bounds are conservative, the caller still has to do
+ * the exact hit test, but only for the few windows that cover the cell of the point.
+ */
+class KWIN_EXPORT HitTestIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HitTestIndex(QObject *parent = nullptr);
+
+    /**
+     * Returns the windows whose input bounds contain @a pos, ordered from the top of the
+     * stack to the bottom. Deleted windows are not included.
+     */
+    QVector<Window *> candidatesAt(const QPointF &pos);
+
+private:
+    void invalidateStackingOrder();
+    void sync();
+    void addWindow(Window *window);
+    void removeWindow(Window *window);
+    void updateWindow(Window *window);
+    void insertIntoCells(Window *window, const QRect &bounds);
+    void removeFromCells(Window *window, const QRect &bounds);
+    void invalidateLastQuery();
+
+    static QRect inputBounds(const Window *window);
+    static QRect cellRange(const QRect &bounds);
+    static quint64 cellKey(int x, int y);
+
+    QHash<quint64, QVector<Window *>> m_cells;
+    QHash<Window *, QRect> m_bounds;
+    QHash<Window *, int> m_stackingPosition;
+    bool m_stackingOrderDirty = true;
+
+    bool m_lastQueryValid = false;
+    QPointF m_lastQueryPos;
+    QVector<Window *> m_lastQueryResult;
+};
+
+} // namespace KWin
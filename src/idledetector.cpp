@@ -12,13 +12,9 @@ namespace KWin
 
 IdleDetector::IdleDetector(std::chrono::milliseconds timeout, QObject *parent)
     : QObject(parent)
-    , m_timer(new QTimer(this))
+    , m_timeout(timeout)
+    , m_activityTime(std::chrono::steady_clock::now())
 {
-    m_timer->setSingleShot(true);
-    m_timer->setInterval(timeout);
-    connect(m_timer, &QTimer::timeout, this, &IdleDetector::markAsIdle);
-    m_timer->start();
-
     input()->addIdleDetector(this);
 }
 
@@ -29,6 +25,16 @@ IdleDetector::~IdleDetector()
     }
 }
 
+std::chrono::milliseconds IdleDetector::timeout() const
+{
+    return m_timeout;
+}
+
+bool IdleDetector::isIdle() const
+{
+    return m_isIdle;
+}
+
 bool IdleDetector::isInhibited() const
 {
     return m_isInhibited;
@@ -40,17 +46,17 @@ void IdleDetector::setInhibited(bool inhibited)
         return;
     }
     m_isInhibited = inhibited;
-    if (inhibited) {
-        m_timer->stop();
-    } else {
-        m_timer->start();
+    if (!inhibited) {
+        m_activityTime = std::chrono::steady_clock::now();
+        input()->scheduleIdleCheck();
     }
 }
 
 void IdleDetector::activity()
 {
     if (!m_isInhibited) {
-        m_timer->start();
+        m_activityTime = std::chrono::steady_clock::now();
+        input()->scheduleIdleCheck();
         markAsResumed();
     }
 }
@@ -59,6 +65,7 @@ void IdleDetector::markAsIdle()
 {
     if (!m_isIdle) {
         m_isIdle = true;
+        input()->m_triggeredIdleDetectors.append(this);
         Q_EMIT idle();
     }
 }
@@ -67,6 +74,7 @@ void IdleDetector::markAsResumed()
 {
     if (m_isIdle) {
         m_isIdle = false;
+        input()->m_triggeredIdleDetectors.removeOne(this);
         Q_EMIT resumed();
     }
 }
@@ -8,11 +8,19 @@
 
 #include <kwin_export.h>
 
-#include <QTimer>
+#include <QObject>
+
+#include <chrono>
 
 namespace KWin
 {
 
+/**
+ * The IdleDetector emits idle() once there hasn't been any user activity for its timeout.
+ *
+ * The detectors don't have timers of their own. The InputRedirection only records the time of
+ * the last user activity and checks the deadlines of all detectors with a single timer.
+ */
 class KWIN_EXPORT IdleDetector : public QObject
 {
     Q_OBJECT
@@ -23,6 +31,9 @@ public:
 
     void activity();
 
+    std::chrono::milliseconds timeout() const;
+    bool isIdle() const;
+
     bool isInhibited() const;
     void setInhibited(bool inhibited);
 
@@ -34,9 +45,13 @@ private:
     void markAsIdle();
     void markAsResumed();
 
-    QTimer *m_timer;
+    std::chrono::milliseconds m_timeout;
+    // the timeout counts from here, or from the last user activity if that's later
+    std::chrono::steady_clock::time_point m_activityTime;
     bool m_isIdle = false;
     bool m_isInhibited = false;
+
+    friend class InputRedirection;
 };
 
 } // namespace KWin
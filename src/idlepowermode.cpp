@@ -0,0 +1,178 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "idlepowermode.h"
+#include "utils/common.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(Q_OS_LINUX)
+#include <sys/prctl.h>
+#endif
+
+namespace KWin
+{
+
+KWIN_SINGLETON_FACTORY(IdlePowerMode)
+
+// for how long no output may have scheduled a repaint before the idle mode is entered
+static const std::chrono::milliseconds s_idleDelay(1000);
+static const std::chrono::milliseconds s_defaultIdleTimerSlack(50);
+
+IdlePowerMode::IdlePowerMode(QObject *parent)
+    : QObject(parent)
+{
+    bool ok = false;
+    const int slack = qEnvironmentVariableIntValue("KWIN_IDLE_TIMER_SLACK", &ok);
+    m_idleSlack = ok ? std::chrono::milliseconds(std::max(slack, 0)) : s_defaultIdleTimerSlack;
+
+#if defined(PR_GET_TIMERSLACK)
+    const int defaultSlack = prctl(PR_GET_TIMERSLACK);
+    if (defaultSlack < 0) {
+        m_idleSlack = std::chrono::nanoseconds::zero();
+    } else {
+        m_defaultSlack = std::chrono::nanoseconds(defaultSlack);
+    }
+#else
+    m_idleSlack = std::chrono::nanoseconds::zero();
+#endif
+
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setTimerType(Qt::CoarseTimer);
+    connect(&m_idleTimer, &QTimer::timeout, this, &IdlePowerMode::checkIdle);
+    markBusy();
+}
+
+IdlePowerMode::~IdlePowerMode()
+{
+    stopWakeupAudit();
+    setIdle(false);
+    s_self = nullptr;
+}
+
+bool IdlePowerMode::isIdle() const
+{
+    return m_idle;
+}
+
+std::chrono::milliseconds IdlePowerMode::idleTime() const
+{
+    if (m_idle) {
+        return m_idleTime + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_idleSince);
+    }
+    return m_idleTime;
+}
+
+void IdlePowerMode::markBusy()
+{
+    m_lastBusy = std::chrono::steady_clock::now();
+    setIdle(false);
+    // the timer isn't restarted for every frame, it checks how much time is left instead
+    if (!m_idleTimer.isActive()) {
+        m_idleTimer.start(s_idleDelay);
+    }
+}
+
+void IdlePowerMode::checkIdle()
+{
+    const auto elapsed = std::chrono::steady_clock::now() - m_lastBusy;
+    if (elapsed < s_idleDelay) {
+        m_idleTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(s_idleDelay - elapsed) + std::chrono::milliseconds(1));
+    } else {
+        setIdle(true);
+    }
+}
+
+void IdlePowerMode::setIdle(bool idle)
+{
+    if (m_idle == idle) {
+        return;
+    }
+    m_idle = idle;
+    if (idle) {
+        m_idleSince = std::chrono::steady_clock::now();
+        setTimerSlack(m_idleSlack);
+    } else {
+        m_idleTime += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_idleSince);
+        setTimerSlack(m_defaultSlack);
+    }
+    Q_EMIT idleChanged();
+}
+
+void IdlePowerMode::setTimerSlack(std::chrono::nanoseconds slack)
+{
+#if defined(PR_SET_TIMERSLACK)
+    // zero would reset the slack to the default of the thread, that's never what's meant
+    if (m_idleSlack > std::chrono::nanoseconds::zero() && slack > std::chrono::nanoseconds::zero()) {
+        if (prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slack.count())) != 0) {
+            qCWarning(KWIN_CORE) << "Failed to change the timer slack:" << strerror(errno);
+        }
+    }
+#else
+    Q_UNUSED(slack)
+#endif
+}
+
+bool IdlePowerMode::isAuditing() const
+{
+    return m_auditing;
+}
+
+void IdlePowerMode::startWakeupAudit()
+{
+    m_wakeups.clear();
+    m_auditStart = std::chrono::steady_clock::now();
+    if (!m_auditing) {
+        m_auditing = true;
+        QCoreApplication::instance()->installEventFilter(this);
+    }
+}
+
+void IdlePowerMode::stopWakeupAudit()
+{
+    if (!m_auditing) {
+        return;
+    }
+    m_auditing = false;
+    m_auditEnd = std::chrono::steady_clock::now();
+    QCoreApplication::instance()->removeEventFilter(this);
+}
+
+QHash<QString, quint64> IdlePowerMode::wakeups() const
+{
+    return m_wakeups;
+}
+
+std::chrono::milliseconds IdlePowerMode::auditDuration() const
+{
+    const auto end = m_auditing ? std::chrono::steady_clock::now() : m_auditEnd;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(end - m_auditStart);
+}
+
+bool IdlePowerMode::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::Timer:
+    case QEvent::SockAct: {
+        // QTimer and QSocketNotifier say little, the object that owns them tells the subsystem
+        const bool helper = qobject_cast<QTimer *>(watched) || qobject_cast<QSocketNotifier *>(watched);
+        const QObject *owner = helper && watched->parent() ? watched->parent() : watched;
+        m_wakeups[QString::fromLatin1(owner->metaObject()->className())]++;
+        break;
+    }
+    default:
+        break;
+    }
+    return false;
+}
+
+} // namespace KWin
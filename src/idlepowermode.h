@@ -0,0 +1,102 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The IdlePowerMode class lets the compositor thread save power while no output is repainted.
+ *
+ * The outputs report every repaint they schedule. Once none has done so for a while, nothing
+ * is damaged and no animation is running, so the idle mode is entered: the timer slack of the
+ * thread is raised, which allows the kernel to coalesce the wakeups of all the timers that are
+ * still running, the ones of KWin as well as the ones of Qt. The next repaint leaves the idle
+ * mode before the render loop arms its timer, so frame scheduling isn't affected.
+ *
+ * The idle mode can be tuned with the KWIN_IDLE_TIMER_SLACK environment variable, the timer
+ * slack in milliseconds, 0 disables it.
+ *
+ * The wakeup audit counts the timer and socket events that the compositor thread handles, by
+ * the object they are meant for, to find out what keeps an idle machine busy.
+ */
+class KWIN_EXPORT IdlePowerMode : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~IdlePowerMode() override;
+
+    /**
+     * Returns whether the idle mode is in effect.
+     */
+    bool isIdle() const;
+
+    /**
+     * Returns for how long the idle mode has been in effect in total.
+     */
+    std::chrono::milliseconds idleTime() const;
+
+    /**
+     * Notifies that a repaint has been scheduled on an output, it leaves the idle mode.
+     */
+    void markBusy();
+
+    bool isAuditing() const;
+    /**
+     * Starts counting the wakeups of the compositor thread, the previous counts are dropped.
+     */
+    void startWakeupAudit();
+    void stopWakeupAudit();
+
+    /**
+     * Returns the number of wakeups per subsystem, which is the class of the object that has
+     * handled the event, or of the parent of the timer or socket notifier.
+     */
+    QHash<QString, quint64> wakeups() const;
+    /**
+     * Returns for how long the current or last wakeup audit has been running.
+     */
+    std::chrono::milliseconds auditDuration() const;
+
+Q_SIGNALS:
+    void idleChanged();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void checkIdle();
+    void setIdle(bool idle);
+    void setTimerSlack(std::chrono::nanoseconds slack);
+
+    QTimer m_idleTimer;
+    std::chrono::steady_clock::time_point m_lastBusy;
+    std::chrono::steady_clock::time_point m_idleSince;
+    std::chrono::milliseconds m_idleTime = std::chrono::milliseconds::zero();
+    std::chrono::nanoseconds m_defaultSlack = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_idleSlack = std::chrono::nanoseconds::zero();
+    bool m_idle = false;
+
+    QHash<QString, quint64> m_wakeups;
+    std::chrono::steady_clock::time_point m_auditStart;
+    std::chrono::steady_clock::time_point m_auditEnd;
+    bool m_auditing = false;
+
+    KWIN_SINGLETON(IdlePowerMode)
+};
+
+} // namespace KWin
@@ -19,15 +19,18 @@
 #include "gestures.h"
 #include "globalshortcuts.h"
 #include "hide_cursor_spy.h"
+#include "hittestindex.h"
 #include "idledetector.h"
 #include "input_event.h"
 #include "input_event_spy.h"
+#include "inputlatencytracker.h"
 #include "inputmethod.h"
 #include "keyboard_input.h"
 #include "main.h"
 #include "mousebuttons.h"
 #include "pointer_input.h"
 #include "tablet_input.h"
+#include "tablettoolhistory.h"
 #include "touch_input.h"
 #include "x11window.h"
 #if KWIN_BUILD_TABBOX
@@ -67,11 +70,13 @@
 #include <QDBusPendingCall>
 #include <QKeyEvent>
 #include <QThread>
+#include <QTimer>
 #include <qpa/qwindowsysteminterface.h>
 
 #include <xkbcommon/xkbcommon.h>
 
 #include <cmath>
+#include <optional>
 
 namespace KWin
 {
@@ -93,7 +98,16 @@ static KWaylandServer::PointerAxisSource kwinAxisSourceToKWaylandAxisSource(Inpu
     }
 }
 
-InputEventFilter::InputEventFilter() = default;
+InputEventFilter::InputEventFilter()
+    : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch
+                       | InputEventType::Gesture | InputEventType::Switch | InputEventType::Tablet)
+{
+}
+
+InputEventFilter::InputEventFilter(InputEventTypes eventTypes)
+    : m_eventTypes(eventTypes)
+{
+}
 
 InputEventFilter::~InputEventFilter()
 {
@@ -102,6 +116,22 @@ InputEventFilter::~InputEventFilter()
     }
 }
 
+InputEventTypes InputEventFilter::eventTypes() const
+{
+    return m_eventTypes;
+}
+
+void InputEventFilter::setEventTypes(InputEventTypes eventTypes)
+{
+    if (m_eventTypes == eventTypes) {
+        return;
+    }
+    m_eventTypes = eventTypes;
+    if (input()) {
+        input()->updateActiveFilters();
+    }
+}
+
 bool InputEventFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
     Q_UNUSED(event)
@@ -317,6 +347,11 @@ bool InputEventFilter::passToInputMethod(QKeyEvent *event)
 class VirtualTerminalFilter : public InputEventFilter
 {
 public:
+    VirtualTerminalFilter()
+        : InputEventFilter(InputEventType::Key)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         // really on press and not on release? X11 switches on press.
@@ -334,6 +369,11 @@ public:
 class TerminateServerFilter : public InputEventFilter
 {
 public:
+    TerminateServerFilter()
+        : InputEventFilter(InputEventType::Key)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
@@ -350,6 +390,11 @@ public:
 class LockScreenFilter : public InputEventFilter
 {
 public:
+    LockScreenFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch | InputEventType::Gesture)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         if (!waylandServer()->isScreenLocked()) {
@@ -571,6 +616,11 @@ private:
 class EffectsFilter : public InputEventFilter
 {
 public:
+    EffectsFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch | InputEventType::Tablet)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -657,6 +707,11 @@ public:
 class MoveResizeFilter : public InputEventFilter
 {
 public:
+    MoveResizeFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch | InputEventType::Tablet)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -774,6 +829,11 @@ private:
 class WindowSelectorFilter : public InputEventFilter
 {
 public:
+    WindowSelectorFilter()
+        : InputEventFilter(InputEventTypes())
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -891,6 +951,7 @@ public:
     {
         Q_ASSERT(!m_active);
         m_active = true;
+        setEventTypes(s_activeEventTypes);
         m_callback = callback;
         input()->keyboard()->update();
         input()->touch()->cancel();
@@ -899,6 +960,7 @@ public:
     {
         Q_ASSERT(!m_active);
         m_active = true;
+        setEventTypes(s_activeEventTypes);
         m_pointSelectionFallback = callback;
         input()->keyboard()->update();
         input()->touch()->cancel();
@@ -908,6 +970,8 @@ private:
     void deactivate()
     {
         m_active = false;
+        // the filter doesn't need to see anything until the next selection
+        setEventTypes(InputEventTypes());
         m_callback = std::function<void(KWin::Window *)>();
         m_pointSelectionFallback = std::function<void(const QPoint &)>();
         input()->pointer()->removeWindowSelectionCursor();
@@ -936,6 +1000,8 @@ private:
         deactivate();
     }
 
+    static constexpr InputEventTypes s_activeEventTypes = InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch;
+
     bool m_active = false;
     std::function<void(KWin::Window *)> m_callback;
     std::function<void(const QPoint &)> m_pointSelectionFallback;
@@ -946,6 +1012,7 @@ class GlobalShortcutFilter : public InputEventFilter
 {
 public:
     GlobalShortcutFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch | InputEventType::Gesture)
     {
         m_powerDown.setSingleShot(true);
         m_powerDown.setInterval(1000);
@@ -1123,7 +1190,7 @@ public:
             if (m_touchPoints.count() >= 3 && !m_gestureCancelled) {
                 m_gestureTaken = true;
                 m_syntheticCancel = true;
-                input()->processFilters(std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
+                input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
                 m_syntheticCancel = false;
                 input()->shortcuts()->processSwipeStart(DeviceType::Touchscreen, m_touchPoints.count());
                 return true;
@@ -1264,6 +1331,12 @@ std::pair<bool, bool> performWindowWheelAction(QWheelEvent *event, Window *windo
 
 class InternalWindowEventFilter : public InputEventFilter
 {
+public:
+    InternalWindowEventFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1435,6 +1508,11 @@ private:
 class DecorationEventFilter : public InputEventFilter
 {
 public:
+    DecorationEventFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Touch | InputEventType::Tablet)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1650,6 +1728,11 @@ private:
 class TabBoxInputFilter : public InputEventFilter
 {
 public:
+    TabBoxInputFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 button) override
     {
         Q_UNUSED(button)
@@ -1690,6 +1773,11 @@ public:
 class ScreenEdgeInputFilter : public InputEventFilter
 {
 public:
+    ScreenEdgeInputFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Touch)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1750,6 +1838,11 @@ private:
 class WindowActionInputFilter : public InputEventFilter
 {
 public:
+    WindowActionInputFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Touch | InputEventType::Tablet)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1822,6 +1915,11 @@ public:
 class InputKeyboardFilter : public InputEventFilter
 {
 public:
+    InputKeyboardFilter()
+        : InputEventFilter(InputEventType::Key)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         return passToInputMethod(event);
@@ -1834,6 +1932,11 @@ public:
 class ForwardInputFilter : public InputEventFilter
 {
 public:
+    ForwardInputFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch | InputEventType::Gesture)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         auto seat = waylandServer()->seat();
@@ -1842,19 +1945,33 @@ public:
         case QEvent::MouseMove: {
             seat->notifyPointerMotion(event->globalPos());
             MouseEvent *e = static_cast<MouseEvent *>(event);
-            if (!e->delta().isNull()) {
+            if (!e->relativeMotions().isEmpty()) {
+                // relative pointer clients, e.g. games, want every sample of the device
+                for (const RelativePointerMotion &motion : e->relativeMotions()) {
+                    seat->relativePointerMotion(motion.delta, motion.deltaNonAccelerated, motion.timeMicroseconds);
+                }
+            } else if (!e->delta().isNull()) {
                 seat->relativePointerMotion(e->delta(), e->deltaUnaccelerated(), e->timestampMicroseconds());
             }
             seat->notifyPointerFrame();
+            // the oldest sample is the one the user has been waiting for the longest
+            const quint64 timestamp = e->relativeMotions().isEmpty() ? e->timestampMicroseconds() : e->relativeMotions().first().timeMicroseconds;
+            if (timestamp) {
+                InputLatencyTracker::self()->inputDelivered(seat->focusedPointerSurface(), std::chrono::microseconds(timestamp));
+            } else {
+                InputLatencyTracker::self()->inputDelivered(seat->focusedPointerSurface(), quint32(event->timestamp()));
+            }
             break;
         }
         case QEvent::MouseButtonPress:
             seat->notifyPointerButton(nativeButton, KWaylandServer::PointerButtonState::Pressed);
             seat->notifyPointerFrame();
+            InputLatencyTracker::self()->inputDelivered(seat->focusedPointerSurface(), quint32(event->timestamp()));
             break;
         case QEvent::MouseButtonRelease:
             seat->notifyPointerButton(nativeButton, KWaylandServer::PointerButtonState::Released);
             seat->notifyPointerFrame();
+            InputLatencyTracker::self()->inputDelivered(seat->focusedPointerSurface(), quint32(event->timestamp()));
             break;
         default:
             break;
@@ -1869,6 +1986,7 @@ public:
         seat->notifyPointerAxis(_event->orientation(), _event->delta(), _event->discreteDelta(),
                                 kwinAxisSourceToKWaylandAxisSource(_event->axisSource()));
         seat->notifyPointerFrame();
+        InputLatencyTracker::self()->inputDelivered(seat->focusedPointerSurface(), quint32(event->timestamp()));
         return true;
     }
     bool keyEvent(QKeyEvent *event) override
@@ -1881,6 +1999,7 @@ public:
         input()->keyboard()->update();
         seat->setTimestamp(event->timestamp());
         passToWaylandServer(event);
+        InputLatencyTracker::self()->inputDelivered(seat->focusedKeyboardSurface(), quint32(event->timestamp()));
         return true;
     }
     bool touchDown(qint32 id, const QPointF &pos, quint32 time) override
@@ -1888,6 +2007,7 @@ public:
         auto seat = waylandServer()->seat();
         seat->setTimestamp(time);
         seat->notifyTouchDown(id, pos);
+        InputLatencyTracker::self()->inputDelivered(seat->focusedTouchSurface(), time);
         return true;
     }
     bool touchMotion(qint32 id, const QPointF &pos, quint32 time) override
@@ -1895,6 +2015,7 @@ public:
         auto seat = waylandServer()->seat();
         seat->setTimestamp(time);
         seat->notifyTouchMotion(id, pos);
+        InputLatencyTracker::self()->inputDelivered(seat->focusedTouchSurface(), time);
         return true;
     }
     bool touchUp(qint32 id, quint32 time) override
@@ -2053,6 +2174,7 @@ class TabletInputFilter : public QObject, public InputEventFilter
 {
 public:
     TabletInputFilter()
+        : InputEventFilter(InputEventType::Tablet)
     {
         const auto devices = input()->devices();
         for (InputDevice *device : devices) {
@@ -2235,41 +2357,143 @@ public:
             return emulateTabletEvent(event);
         }
 
+        recordSample(tool, event);
         switch (event->type()) {
         case QEvent::TabletMove: {
             const auto pos = window->mapToLocal(event->globalPosF());
             tool->sendMotion(pos);
-            m_cursorByTool[tool]->setPos(event->globalPos());
+            setCursorPos(tool, event);
             break;
         }
         case QEvent::TabletEnterProximity: {
-            const QPoint pos = event->globalPos();
-            m_cursorByTool[tool]->setPos(pos);
+            setCursorPos(tool, event);
             tool->sendProximityIn(tablet);
             tool->sendMotion(window->mapToLocal(event->globalPosF()));
             break;
         }
         case QEvent::TabletLeaveProximity:
             tool->sendProximityOut();
+            endStroke(tool);
+            finishHistory(tool);
             break;
         case QEvent::TabletPress: {
             const auto pos = window->mapToLocal(event->globalPosF());
             tool->sendMotion(pos);
-            m_cursorByTool[tool]->setPos(event->globalPos());
+            setCursorPos(tool, event);
             tool->sendDown();
+            endStroke(tool);
+            m_strokes.append(Stroke{event->tabletId().m_serialId, event->tabletId().m_toolType, tool, window});
             break;
         }
         case QEvent::TabletRelease:
             tool->sendUp();
+            endStroke(tool);
             break;
         default:
             qCWarning(KWIN_CORE) << "Unexpected tablet event type" << event;
             break;
         }
+        sendFrame(tool, surface, event);
+        return true;
+    }
+
+    struct Stroke
+    {
+        quint64 serialId;
+        InputRedirection::TabletToolType toolType;
+        QPointer<KWaylandServer::TabletToolV2Interface> tool;
+        QPointer<Window> window;
+    };
+
+    /**
+     * Returns whether the tip of the tool is down on a window, which gets all motions of the
+     * tool until it's lifted.
+     */
+    bool hasStroke(const TabletToolId &tabletId)
+    {
+        auto it = findStroke(tabletId);
+        if (it == m_strokes.end()) {
+            return false;
+        }
+        if (!it->tool || !it->window || !it->window->surface()) {
+            m_strokes.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Sends a motion of a tool that has a stroke to the surface the tip went down on, without
+     * looking up the window under the tool.
+     */
+    void continueStroke(TabletEvent *event)
+    {
+        auto it = findStroke(event->tabletId());
+        Q_ASSERT(it != m_strokes.end());
+        KWaylandServer::TabletToolV2Interface *tool = it->tool;
+        recordSample(tool, event);
+        tool->sendMotion(it->window->mapToLocal(event->globalPosF()));
+        setCursorPos(tool, event);
+        sendFrame(tool, it->window->surface(), event);
+    }
+
+    QVector<Stroke>::iterator findStroke(const TabletToolId &tabletId)
+    {
+        return std::find_if(m_strokes.begin(), m_strokes.end(), [&tabletId](const Stroke &stroke) {
+            return stroke.serialId == tabletId.m_serialId && stroke.toolType == tabletId.m_toolType;
+        });
+    }
+
+    void endStroke(KWaylandServer::TabletToolV2Interface *tool)
+    {
+        m_strokes.erase(std::remove_if(m_strokes.begin(), m_strokes.end(), [tool](const Stroke &stroke) {
+                            return stroke.tool == tool;
+                        }),
+                        m_strokes.end());
+    }
+
+    void setCursorPos(KWaylandServer::TabletToolV2Interface *tool, TabletEvent *event)
+    {
+        // Drawing the cursor where the pen is going to be hides some of the latency of the client,
+        // the client still gets the real positions.
+        static const std::chrono::milliseconds prediction(qEnvironmentVariableIntValue("KWIN_TABLET_CURSOR_PREDICTION"));
+        QPointF pos = event->globalPosF();
+        if (prediction.count() > 0 && event->type() == QEvent::TabletMove) {
+            pos = m_historyByTool[tool].predictPosition(prediction).value_or(pos);
+        }
+        m_cursorByTool[tool]->setPos(pos);
+    }
+
+    void sendFrame(KWaylandServer::TabletToolV2Interface *tool, KWaylandServer::SurfaceInterface *surface, TabletEvent *event)
+    {
         const quint32 MAX_VAL = 65535;
         tool->sendPressure(MAX_VAL * event->pressure());
         tool->sendFrame(event->timestamp());
-        return true;
+        InputLatencyTracker::self()->inputDelivered(surface, quint32(event->timestamp()));
+    }
+
+    void recordSample(KWaylandServer::TabletToolV2Interface *tool, TabletEvent *event)
+    {
+        if (event->type() == QEvent::TabletLeaveProximity || event->type() == QEvent::TabletRelease) {
+            return;
+        }
+        // the timestamps are CLOCK_MONOTONIC in milliseconds, truncated to 32 bits
+        const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+        const quint32 nowMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+        const std::chrono::milliseconds age(quint32(nowMilliseconds - quint32(event->timestamp())));
+        const std::chrono::microseconds latency = age + now % std::chrono::milliseconds(1);
+        m_historyByTool[tool].addSample({event->globalPosF(), event->pressure(), quint32(event->timestamp()), latency});
+    }
+
+    void finishHistory(KWaylandServer::TabletToolV2Interface *tool)
+    {
+        auto it = m_historyByTool.find(tool);
+        if (it == m_historyByTool.end() || it->count() == 0) {
+            return;
+        }
+        qCDebug(KWIN_CORE) << "Tablet tool" << tool << "latency of the last" << it->count() << "samples: average"
+                           << it->averageLatency().count() << "us, maximum" << it->maximumLatency().count() << "us";
+        it->clear();
     }
 
     bool emulateTabletEvent(TabletEvent *event)
@@ -2376,6 +2600,9 @@ public:
     }
 
     QHash<KWaylandServer::TabletToolV2Interface *, Cursor *> m_cursorByTool;
+    QHash<KWaylandServer::TabletToolV2Interface *, TabletToolHistory> m_historyByTool;
+    // the tools that are down on a surface, which implicitly grab their motions
+    QVector<Stroke> m_strokes;
 };
 
 static KWaylandServer::AbstractDropHandler *dropHandler(Window *window)
@@ -2402,6 +2629,7 @@ class DragAndDropInputFilter : public QObject, public InputEventFilter
     Q_OBJECT
 public:
     DragAndDropInputFilter()
+        : InputEventFilter(InputEventType::Pointer | InputEventType::Key | InputEventType::Touch)
     {
         m_raiseTimer.setSingleShot(true);
         m_raiseTimer.setInterval(250);
@@ -2594,7 +2822,10 @@ InputRedirection::InputRedirection(QObject *parent)
     , m_tablet(new TabletInputRedirection(this))
     , m_touch(new TouchInputRedirection(this))
     , m_shortcuts(new GlobalShortcutsManager(this))
+    , m_idleTimer(new QTimer(this))
 {
+    m_idleTimer->setSingleShot(true);
+    connect(m_idleTimer, &QTimer::timeout, this, &InputRedirection::checkIdleDetectors);
     qRegisterMetaType<KWin::InputRedirection::KeyboardKeyState>();
     qRegisterMetaType<KWin::InputRedirection::PointerButtonState>();
     qRegisterMetaType<KWin::InputRedirection::PointerAxis>();
@@ -2616,17 +2847,37 @@ void InputRedirection::installInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters << filter;
+    updateActiveFilters();
 }
 
 void InputRedirection::prependInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters.prepend(filter);
+    updateActiveFilters();
 }
 
 void InputRedirection::uninstallInputEventFilter(InputEventFilter *filter)
 {
-    m_filters.removeOne(filter);
+    if (m_filters.removeOne(filter)) {
+        updateActiveFilters();
+    }
+}
+
+void InputRedirection::updateActiveFilters()
+{
+    // filters come and go and change what they're interested in far less often than events
+    // arrive, so the lists are rebuilt from scratch
+    for (int i = 0; i < s_inputEventTypeCount; ++i) {
+        const InputEventType type = InputEventType(1 << i);
+        QVector<InputEventFilter *> &filters = m_activeFilters[i];
+        filters.clear();
+        for (InputEventFilter *filter : qAsConst(m_filters)) {
+            if (filter->eventTypes() & type) {
+                filters << filter;
+            }
+        }
+    }
 }
 
 void InputRedirection::installInputEventSpy(InputEventSpy *spy)
@@ -2650,6 +2901,7 @@ void InputRedirection::init()
 
 void InputRedirection::setupWorkspace()
 {
+    m_hitTestIndex = new HitTestIndex(this);
     connect(workspace(), &Workspace::outputsChanged, this, &InputRedirection::updateScreens);
     if (waylandServer()) {
         m_keyboard->init();
@@ -2929,7 +3181,8 @@ void InputRedirection::setupInputFilters()
     installInputEventFilter(new InternalWindowEventFilter);
     installInputEventFilter(new InputKeyboardFilter);
     installInputEventFilter(new ForwardInputFilter);
-    installInputEventFilter(new TabletInputFilter);
+    m_tabletFilter = new TabletInputFilter;
+    installInputEventFilter(m_tabletFilter);
 }
 
 void InputRedirection::handleInputConfigChanged(const KConfigGroup &group)
@@ -2958,6 +3211,8 @@ void InputRedirection::addInputDevice(InputDevice *device)
             m_pointer, &PointerInputRedirection::processMotionAbsolute);
     connect(device, &InputDevice::pointerMotion,
             m_pointer, &PointerInputRedirection::processMotion);
+    connect(device, &InputDevice::pointerMotionCoalesced,
+            m_pointer, &PointerInputRedirection::processCoalescedMotion);
     connect(device, &InputDevice::pointerButtonChanged,
             m_pointer, &PointerInputRedirection::processButton);
     connect(device, &InputDevice::pointerAxisChanged,
@@ -2994,7 +3249,7 @@ void InputRedirection::addInputDevice(InputDevice *device)
     auto handleSwitchEvent = [this](SwitchEvent::State state, quint32 time, quint64 timeMicroseconds, InputDevice *device) {
         SwitchEvent event(state, time, timeMicroseconds, device);
         processSpies(std::bind(&InputEventSpy::switchEvent, std::placeholders::_1, &event));
-        processFilters(std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
+        processFilters(InputEventType::Switch, std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
     };
     connect(device, &InputDevice::switchToggledOn, this,
             std::bind(handleSwitchEvent, SwitchEvent::State::On, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -3192,8 +3447,55 @@ Qt::MouseButtons InputRedirection::qtButtonStates() const
 
 void InputRedirection::simulateUserActivity()
 {
+    // This runs for every input event. The deadlines of the detectors that are not idle only
+    // move later, which checkIdleDetectors() takes into account when the timer fires.
+    m_lastUserActivity = std::chrono::steady_clock::now();
+    if (m_triggeredIdleDetectors.isEmpty()) {
+        return;
+    }
+    const QList<IdleDetector *> triggered = m_triggeredIdleDetectors;
+    for (IdleDetector *idleDetector : triggered) {
+        // resuming may delete other detectors
+        if (m_triggeredIdleDetectors.contains(idleDetector) && !idleDetector->isInhibited()) {
+            idleDetector->markAsResumed();
+        }
+    }
+    scheduleIdleCheck();
+}
+
+void InputRedirection::scheduleIdleCheck()
+{
+    m_idleTimer->start(0);
+}
+
+void InputRedirection::checkIdleDetectors()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto deadline = [this](const IdleDetector *detector) {
+        return std::max(detector->m_activityTime, m_lastUserActivity) + detector->timeout();
+    };
+
+    QVector<QPointer<IdleDetector>> expired;
     for (IdleDetector *idleDetector : std::as_const(m_idleDetectors)) {
-        idleDetector->activity();
+        if (!idleDetector->isIdle() && !idleDetector->isInhibited() && deadline(idleDetector) <= now) {
+            expired.append(idleDetector);
+        }
+    }
+    for (const QPointer<IdleDetector> &idleDetector : std::as_const(expired)) {
+        if (idleDetector) {
+            idleDetector->markAsIdle();
+        }
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> next;
+    for (IdleDetector *idleDetector : std::as_const(m_idleDetectors)) {
+        if (!idleDetector->isIdle() && !idleDetector->isInhibited()) {
+            next = next ? std::min(*next, deadline(idleDetector)) : deadline(idleDetector);
+        }
+    }
+    if (next) {
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*next - std::chrono::steady_clock::now());
+        m_idleTimer->start(std::max(remaining, std::chrono::milliseconds::zero()));
     }
 }
 
@@ -3202,11 +3504,13 @@ void InputRedirection::addIdleDetector(IdleDetector *detector)
     Q_ASSERT(!m_idleDetectors.contains(detector));
     detector->setInhibited(!m_idleInhibitors.isEmpty());
     m_idleDetectors.append(detector);
+    scheduleIdleCheck();
 }
 
 void InputRedirection::removeIdleDetector(IdleDetector *detector)
 {
     m_idleDetectors.removeOne(detector);
+    m_triggeredIdleDetectors.removeOne(detector);
 }
 
 QList<Window *> InputRedirection::idleInhibitors() const
@@ -3245,10 +3549,11 @@ Window *InputRedirection::findToplevel(const QPointF &pos)
         if (effects && static_cast<EffectsHandlerImpl *>(effects)->isMouseInterception()) {
             return nullptr;
         }
-        const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
-        for (Unmanaged *u : unmanaged) {
-            if (u->hitTest(pos)) {
-                return u;
+        // override-redirect windows are above everything else
+        const QVector<Window *> candidates = m_hitTestIndex->candidatesAt(pos);
+        for (Window *window : candidates) {
+            if (window->isUnmanaged() && window->hitTest(pos)) {
+                return window;
             }
         }
     }
@@ -3261,18 +3566,9 @@ Window *InputRedirection::findManagedToplevel(const QPointF &pos)
         return nullptr;
     }
     const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
-    const QList<Window *> &stacking = Workspace::self()->stackingOrder();
-    if (stacking.isEmpty()) {
-        return nullptr;
-    }
-    auto it = stacking.end();
-    do {
-        --it;
-        Window *window = (*it);
-        if (window->isDeleted()) {
-            // a deleted window doesn't get mouse events
-            continue;
-        }
+    // only the windows that can accept input at pos, from top to bottom
+    const QVector<Window *> candidates = m_hitTestIndex->candidatesAt(pos);
+    for (Window *window : candidates) {
         if (!window->isOnCurrentActivity() || !window->isOnCurrentDesktop() || window->isMinimized() || window->isHiddenInternal()) {
             continue;
         }
@@ -3287,7 +3583,7 @@ Window *InputRedirection::findManagedToplevel(const QPointF &pos)
         if (window->hitTest(pos)) {
             return window;
         }
-    } while (it != stacking.begin());
+    }
     return nullptr;
 }
 
@@ -3392,6 +3688,26 @@ bool InputRedirection::isSelectingWindow() const
     return m_windowSelector ? m_windowSelector->isActive() : false;
 }
 
+bool InputRedirection::processTabletStroke(TabletEvent *event)
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_TABLET_NO_FAST_PATH");
+    if (disabled || !m_tabletFilter) {
+        return false;
+    }
+    // these are the filters in front of the tablet filter that could take the motion
+    if (waylandServer()->isScreenLocked() || isSelectingWindow() || workspace()->moveResizeWindow()) {
+        return false;
+    }
+    if (!m_tabletFilter->hasStroke(event->tabletId())) {
+        return false;
+    }
+    if (effects && static_cast<EffectsHandlerImpl *>(effects)->tabletToolEvent(event)) {
+        return true;
+    }
+    m_tabletFilter->continueStroke(event);
+    return true;
+}
+
 InputDeviceHandler::InputDeviceHandler(InputRedirection *input)
     : QObject(input)
 {
@@ -22,10 +22,13 @@
 #include <KSharedConfig>
 #include <QSet>
 
+#include <array>
+#include <chrono>
 #include <functional>
 
 class KGlobalAccelInterface;
 class QKeySequence;
+class QTimer;
 class QMouseEvent;
 class QKeyEvent;
 class QWheelEvent;
@@ -35,6 +38,7 @@ namespace KWin
 class IdleDetector;
 class Window;
 class GlobalShortcutsManager;
+class HitTestIndex;
 class InputEventFilter;
 class InputEventSpy;
 class KeyboardInputRedirection;
@@ -42,6 +46,7 @@ class PointerInputRedirection;
 class TabletInputRedirection;
 class TouchInputRedirection;
 class WindowSelectorFilter;
+class TabletInputFilter;
 class SwitchEvent;
 class TabletEvent;
 class TabletToolId;
@@ -55,6 +60,31 @@ class DecoratedClientImpl;
 class InputBackend;
 class InputDevice;
 
+/**
+ * A single relative motion reported by a pointer device.
+ */
+struct RelativePointerMotion
+{
+    QPointF delta;
+    QPointF deltaNonAccelerated;
+    quint64 timeMicroseconds = 0;
+};
+
+/**
+ * The kinds of events that pass through the InputEventFilter chain.
+ */
+enum class InputEventType {
+    Pointer = 1 << 0,
+    Wheel = 1 << 1,
+    Key = 1 << 2,
+    Touch = 1 << 3,
+    Gesture = 1 << 4,
+    Switch = 1 << 5,
+    Tablet = 1 << 6,
+};
+Q_DECLARE_FLAGS(InputEventTypes, InputEventType)
+static constexpr int s_inputEventTypeCount = 7;
+
 /**
  * @brief This class is responsible for redirecting incoming input to the surface which currently
  * has input or send enter/leave events.
@@ -184,7 +214,7 @@ public:
     }
 
     /**
-     * Sends an event through all InputFilters.
+     * Sends an event of the given @p type through all InputFilters that are interested in it.
      * The method @p function is invoked on each input filter. Processing is stopped if
      * a filter returns @c true for @p function.
      *
@@ -198,9 +228,12 @@ public:
      * bind.
      */
     template<class UnaryPredicate>
-    void processFilters(UnaryPredicate function)
+    void processFilters(InputEventType type, UnaryPredicate function)
     {
-        std::any_of(m_filters.constBegin(), m_filters.constEnd(), function);
+        // iterate over a copy, a filter may get installed, uninstalled or change the events
+        // it is interested in while it processes the event
+        const QVector<InputEventFilter *> filters = m_activeFilters[activeFiltersIndex(type)];
+        std::any_of(filters.constBegin(), filters.constEnd(), function);
     }
 
     /**
@@ -256,6 +289,14 @@ public:
     void startInteractivePositionSelection(std::function<void(const QPoint &)> callback);
     bool isSelectingWindow() const;
 
+    /**
+     * Sends the motion of a tablet tool whose tip is down directly to the surface the tip
+     * went down on, skipping the filter chain, which only the screen locker, the window
+     * selection, interactive move/resize and effects could take it from. Returns @c false if
+     * the event has to go through the filters.
+     */
+    bool processTabletStroke(TabletEvent *event);
+
     void toggleTouchpads();
     void enableTouchpads();
     void disableTouchpads();
@@ -319,8 +360,15 @@ private:
     void setupInputBackends();
     void setupTouchpadShortcuts();
     void setupWorkspace();
+    void scheduleIdleCheck();
+    void checkIdleDetectors();
     void setupInputFilters();
     void installInputEventFilter(InputEventFilter *filter);
+    void updateActiveFilters();
+    static int activeFiltersIndex(InputEventType type)
+    {
+        return qCountTrailingZeroBits(uint(type));
+    }
     void updateLeds(LEDs leds);
     void updateAvailableInputDevices();
     void addInputBackend(std::unique_ptr<InputBackend> &&inputBackend);
@@ -336,10 +384,18 @@ private:
     QList<InputDevice *> m_inputDevices;
 
     QList<IdleDetector *> m_idleDetectors;
+    // the detectors that are idle
+    QList<IdleDetector *> m_triggeredIdleDetectors;
+    std::chrono::steady_clock::time_point m_lastUserActivity;
+    QTimer *m_idleTimer;
     QList<Window *> m_idleInhibitors;
     WindowSelectorFilter *m_windowSelector = nullptr;
+    TabletInputFilter *m_tabletFilter = nullptr;
+    HitTestIndex *m_hitTestIndex = nullptr;
 
     QVector<InputEventFilter *> m_filters;
+    // the filters in m_filters that are interested in each InputEventType
+    std::array<QVector<InputEventFilter *>, s_inputEventTypeCount> m_activeFilters;
     QVector<InputEventSpy *> m_spies;
     KConfigWatcher::Ptr m_inputConfigWatcher;
 
@@ -356,6 +412,8 @@ private:
     friend class DecorationEventFilter;
     friend class InternalWindowEventFilter;
     friend class ForwardInputFilter;
+    friend class InputEventFilter;
+    friend class IdleDetector;
 };
 
 /**
@@ -380,9 +438,22 @@ private:
 class KWIN_EXPORT InputEventFilter
 {
 public:
+    /**
+     * Creates a filter that gets all kinds of events.
+     */
     InputEventFilter();
+    /**
+     * Creates a filter that only gets the events of the given @p eventTypes.
+     */
+    explicit InputEventFilter(InputEventTypes eventTypes);
     virtual ~InputEventFilter();
 
+    /**
+     * The kinds of events this filter gets. The methods for the other kinds of events are not
+     * invoked.
+     */
+    InputEventTypes eventTypes() const;
+
     /**
      * Event filter for pointer events which can be described by a QMouseEvent.
      *
@@ -439,8 +510,18 @@ public:
     virtual bool tabletPadRingEvent(int number, int position, bool isFinger, const TabletPadId &tabletPadId, uint time);
 
 protected:
+    /**
+     * Changes the kinds of events this filter gets. Filters that only act in a certain mode, e.g.
+     * while a window is being selected, should not ask for any events outside of that mode, so
+     * that events don't have to pass through them on the hot path.
+     */
+    void setEventTypes(InputEventTypes eventTypes);
+
     void passToWaylandServer(QKeyEvent *event);
     bool passToInputMethod(QKeyEvent *event);
+
+private:
+    InputEventTypes m_eventTypes;
 };
 
 class KWIN_EXPORT InputDeviceHandler : public QObject
@@ -552,6 +633,7 @@ inline void InputRedirection::registerShortcut(const QKeySequence &shortcut, QAc
 
 } // namespace KWin
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWin::InputEventTypes)
 Q_DECLARE_METATYPE(KWin::InputRedirection::KeyboardKeyState)
 Q_DECLARE_METATYPE(KWin::InputRedirection::PointerButtonState)
 Q_DECLARE_METATYPE(KWin::InputRedirection::PointerAxis)
@@ -66,6 +66,20 @@ public:
         m_nativeButton = button;
     }
 
+    /**
+     * The individual motions that have been coalesced into this event, if there were several.
+     * Their deltas add up to delta().
+     */
+    QVector<RelativePointerMotion> relativeMotions() const
+    {
+        return m_relativeMotions;
+    }
+
+    void setRelativeMotions(const QVector<RelativePointerMotion> &motions)
+    {
+        m_relativeMotions = motions;
+    }
+
 private:
     QPointF m_delta;
     QPointF m_deltaUnccelerated;
@@ -73,6 +87,7 @@ private:
     InputDevice *m_device;
     Qt::KeyboardModifiers m_modifiersRelevantForShortcuts = Qt::KeyboardModifiers();
     quint32 m_nativeButton = 0;
+    QVector<RelativePointerMotion> m_relativeMotions;
 };
 
 // TODO: Don't derive from QWheelEvent, this event is quite domain specific.
@@ -0,0 +1,62 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "inputlatencytracker.h"
+#include "wayland/clientconnection.h"
+#include "wayland/surface_interface.h"
+
+namespace KWin
+{
+
+InputLatencyTracker *InputLatencyTracker::self()
+{
+    static InputLatencyTracker tracker;
+    return &tracker;
+}
+
+void InputLatencyTracker::inputDelivered(KWaylandServer::SurfaceInterface *surface, std::chrono::microseconds timestamp)
+{
+    if (!surface || timestamp == std::chrono::microseconds::zero()) {
+        return;
+    }
+    KWaylandServer::ClientConnection *client = surface->client();
+    if (m_pendingInput.contains(client)) {
+        return;
+    }
+    m_pendingInput.insert(client, timestamp);
+    connect(client, &KWaylandServer::ClientConnection::disconnected, this, &InputLatencyTracker::handleClientDisconnected, Qt::UniqueConnection);
+}
+
+void InputLatencyTracker::handleClientDisconnected(KWaylandServer::ClientConnection *client)
+{
+    m_pendingInput.remove(client);
+}
+
+void InputLatencyTracker::inputDelivered(KWaylandServer::SurfaceInterface *surface, quint32 timestampMilliseconds)
+{
+    if (timestampMilliseconds == 0) {
+        return;
+    }
+    // The millisecond timestamps are CLOCK_MONOTONIC truncated to 32 bits, take the upper
+    // bits from the current time. The event has been generated within the last 49 days.
+    const quint64 now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    const quint64 age = quint32(quint32(now) - timestampMilliseconds);
+    inputDelivered(surface, std::chrono::milliseconds(now - age));
+}
+
+std::optional<std::chrono::microseconds> InputLatencyTracker::takeInputTimestamp(KWaylandServer::SurfaceInterface *surface)
+{
+    const auto it = m_pendingInput.find(surface->client());
+    if (it == m_pendingInput.end()) {
+        return std::nullopt;
+    }
+    const std::chrono::microseconds timestamp = *it;
+    m_pendingInput.erase(it);
+    return timestamp;
+}
+
+} // namespace KWin
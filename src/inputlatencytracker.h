@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+
+#include <chrono>
+#include <optional>
+
+namespace KWaylandServer
+{
+class ClientConnection;
+class SurfaceInterface;
+}
+
+namespace KWin
+{
+
+/**
+ * The InputLatencyTracker follows input events from the kernel to the screen.
+ *
+ * When an input event is sent to a client, the tracker remembers its kernel timestamp until
+ * the client commits one of its surfaces. The surface items pass the timestamp on to the frame
+ * that shows the commit, and once that frame is presented, the render loop records the time
+ * between the input event and the presentation in its FrameStatistics.
+ *
+ * Only the oldest event that a client got since its last commit is tracked, as that's the one
+ * the user has been waiting for the longest.
+ */
+class KWIN_EXPORT InputLatencyTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static InputLatencyTracker *self();
+
+    /**
+     * Records that an input event with the kernel timestamp @a timestamp, in CLOCK_MONOTONIC,
+     * has been sent to the client that owns @a surface.
+     */
+    void inputDelivered(KWaylandServer::SurfaceInterface *surface, std::chrono::microseconds timestamp);
+    /**
+     * Convenience overload for events that only carry a 32 bit millisecond timestamp.
+     */
+    void inputDelivered(KWaylandServer::SurfaceInterface *surface, quint32 timestampMilliseconds);
+
+    /**
+     * Returns the timestamp of the oldest input event the client of @a surface got since it
+     * last committed a surface, if any, and forgets about it.
+     */
+    std::optional<std::chrono::microseconds> takeInputTimestamp(KWaylandServer::SurfaceInterface *surface);
+
+private:
+    void handleClientDisconnected(KWaylandServer::ClientConnection *client);
+
+    QHash<KWaylandServer::ClientConnection *, std::chrono::microseconds> m_pendingInput;
+};
+
+} // namespace KWin
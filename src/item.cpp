@@ -8,6 +8,7 @@
 #include "composite.h"
 #include "core/output.h"
 #include "core/renderloop.h"
+#include "damageaudit.h"
 #include "main.h"
 #include "scene.h"
 #include "utils/common.h"
@@ -16,18 +17,25 @@
 namespace KWin
 {
 
+static Item *s_firstItem = nullptr;
+
 Item::Item(Item *parent)
 {
+    link();
     setParentItem(parent);
-    connect(workspace(), &Workspace::outputRemoved, this, &Item::removeRepaints);
 }
 
 Item::~Item()
 {
     setParentItem(nullptr);
-    for (const auto &dirty : qAsConst(m_repaints)) {
-        if (!dirty.isEmpty()) {
-            Compositor::self()->scene()->addRepaint(dirty);
+    for (Item *childItem : qAsConst(m_childItems)) {
+        childItem->markRootPositionDirty();
+        childItem->m_parentItem = nullptr;
+    }
+    unlink();
+    for (const OutputRepaints &dirty : qAsConst(m_repaints)) {
+        if (!dirty.region.isEmpty()) {
+            Compositor::self()->scene()->addRepaint(dirty.region.toQRegion());
         }
     }
 }
@@ -79,6 +87,7 @@ void Item::setParentItem(Item *item)
     if (m_parentItem) {
         m_parentItem->addChild(this);
     }
+    markRootPositionDirty();
     updateEffectiveVisibility();
 }
 
@@ -119,6 +128,7 @@ void Item::setPosition(const QPointF &point)
     if (m_position != point) {
         scheduleRepaint(boundingRect());
         m_position = point;
+        markRootPositionDirty();
         if (m_parentItem) {
             m_parentItem->updateBoundingRect();
         }
@@ -181,25 +191,38 @@ QRegion Item::opaque() const
 
 QPointF Item::rootPosition() const
 {
-    QPointF ret = position();
-
-    Item *parent = parentItem();
-    while (parent) {
-        ret += parent->position();
-        parent = parent->parentItem();
+    if (!m_rootPosition.has_value()) {
+        m_rootPosition = m_parentItem ? m_parentItem->rootPosition() + position() : position();
     }
+    return m_rootPosition.value();
+}
 
-    return ret;
+void Item::markRootPositionDirty()
+{
+    if (!m_rootPosition.has_value()) {
+        // the root positions of the child items are computed from this one, so they are dirty too
+        return;
+    }
+    m_rootPosition.reset();
+    for (Item *childItem : qAsConst(m_childItems)) {
+        childItem->markRootPositionDirty();
+    }
 }
 
 QMatrix4x4 Item::transform() const
 {
-    return m_transform;
+    return m_transform ? *m_transform : QMatrix4x4();
 }
 
 void Item::setTransform(const QMatrix4x4 &transform)
 {
-    m_transform = transform;
+    if (transform.isIdentity()) {
+        m_transform.reset();
+    } else if (m_transform) {
+        *m_transform = transform;
+    } else {
+        m_transform = std::make_unique<QMatrix4x4>(transform);
+    }
 }
 
 QRegion Item::mapToGlobal(const QRegion &region) const
@@ -289,21 +312,63 @@ void Item::scheduleRepaint(const QRegion &region)
     }
 }
 
+QVarLengthArray<Output *, 2> Item::overlappedOutputs(const QRect &rect)
+{
+    const QRect bounds = mapToGlobal(boundingRect()).toAlignedRect();
+    if (m_overlappedRect != bounds) {
+        m_overlappedOutputs.clear();
+        const QList<Output *> outputs = workspace()->outputs();
+        for (Output *output : outputs) {
+            if (output->geometry().intersects(bounds)) {
+                m_overlappedOutputs.append(output);
+            }
+        }
+        m_overlappedRect = bounds;
+    }
+    if (bounds.contains(rect)) {
+        return m_overlappedOutputs;
+    }
+
+    // A repaint outside of the item, e.g. where a child item has been before it was removed.
+    QVarLengthArray<Output *, 2> outputs;
+    const QList<Output *> allOutputs = workspace()->outputs();
+    outputs.append(allOutputs.constData(), allOutputs.count());
+    return outputs;
+}
+
+void Item::addRepaints(Output *output, const Region &region)
+{
+    for (OutputRepaints &repaints : m_repaints) {
+        if (repaints.output == output) {
+            repaints.region += region;
+            return;
+        }
+    }
+    m_repaints.append(OutputRepaints{output, region});
+}
+
 void Item::scheduleRepaintInternal(const QRegion &region)
 {
-    const QList<Output *> outputs = workspace()->outputs();
-    const QRegion globalRegion = mapToGlobal(region);
+    const Region globalRegion(mapToGlobal(region));
+    DamageAudit *audit = DamageAudit::self();
     if (kwinApp()->operationMode() != Application::OperationModeX11) {
-        for (const auto &output : outputs) {
-            const QRegion dirtyRegion = globalRegion & output->geometry();
+        for (Output *output : overlappedOutputs(globalRegion.boundingRect())) {
+            const Region dirtyRegion = globalRegion.intersected(output->geometry());
             if (!dirtyRegion.isEmpty()) {
-                m_repaints[output] += dirtyRegion;
+                if (audit && audit->isAuditing()) {
+                    audit->recordItem(this, output, dirtyRegion);
+                }
+                addRepaints(output, dirtyRegion);
                 output->renderLoop()->scheduleRepaint(this);
             }
         }
     } else {
-        m_repaints[outputs.constFirst()] += globalRegion;
-        outputs.constFirst()->renderLoop()->scheduleRepaint(this);
+        Output *output = workspace()->outputs().constFirst();
+        if (audit && audit->isAuditing()) {
+            audit->recordItem(this, output, globalRegion);
+        }
+        addRepaints(output, globalRegion);
+        output->renderLoop()->scheduleRepaint(this);
     }
 }
 
@@ -312,16 +377,15 @@ void Item::scheduleFrame()
     if (!isVisible()) {
         return;
     }
-    const QList<Output *> outputs = workspace()->outputs();
     if (kwinApp()->operationMode() != Application::OperationModeX11) {
         const QRect geometry = mapToGlobal(rect()).toAlignedRect();
-        for (const Output *output : outputs) {
+        for (const Output *output : overlappedOutputs(geometry)) {
             if (output->geometry().intersects(geometry)) {
                 output->renderLoop()->scheduleRepaint(this);
             }
         }
     } else {
-        outputs.constFirst()->renderLoop()->scheduleRepaint(this);
+        workspace()->outputs().constFirst()->renderLoop()->scheduleRepaint(this);
     }
 }
 
@@ -349,17 +413,70 @@ WindowQuadList Item::quads() const
 
 QRegion Item::repaints(Output *output) const
 {
-    return m_repaints.value(output);
+    for (const OutputRepaints &repaints : m_repaints) {
+        if (repaints.output == output) {
+            return repaints.region.toQRegion();
+        }
+    }
+    return QRegion();
 }
 
 void Item::resetRepaints(Output *output)
 {
-    m_repaints.insert(output, QRegion());
+    for (OutputRepaints &repaints : m_repaints) {
+        if (repaints.output == output) {
+            repaints.region = Region();
+            return;
+        }
+    }
 }
 
 void Item::removeRepaints(Output *output)
 {
-    m_repaints.remove(output);
+    for (int i = 0; i < m_repaints.count(); ++i) {
+        if (m_repaints[i].output == output) {
+            m_repaints.remove(i);
+            break;
+        }
+    }
+    m_overlappedRect.reset();
+}
+
+void Item::link()
+{
+    m_nextItem = s_firstItem;
+    if (s_firstItem) {
+        s_firstItem->m_previousItem = this;
+    }
+    s_firstItem = this;
+}
+
+void Item::unlink()
+{
+    if (m_previousItem) {
+        m_previousItem->m_nextItem = m_nextItem;
+    } else {
+        s_firstItem = m_nextItem;
+    }
+    if (m_nextItem) {
+        m_nextItem->m_previousItem = m_previousItem;
+    }
+    m_previousItem = nullptr;
+    m_nextItem = nullptr;
+}
+
+void Item::removeOutput(Output *output)
+{
+    for (Item *item = s_firstItem; item; item = item->m_nextItem) {
+        item->removeRepaints(output);
+    }
+}
+
+void Item::invalidateOutputs()
+{
+    for (Item *item = s_firstItem; item; item = item->m_nextItem) {
+        item->m_overlappedRect.reset();
+    }
 }
 
 bool Item::explicitVisible() const
@@ -424,6 +541,45 @@ QList<Item *> Item::sortedChildItems() const
     return m_sortedChildItems.value();
 }
 
+static bool isIntegral(const QPointF &point)
+{
+    return point == QPointF(point.toPoint());
+}
+
+QList<Item *> Item::occludedChildItems() const
+{
+    const QList<Item *> sortedChildItems = this->sortedChildItems();
+    if (sortedChildItems.isEmpty()) {
+        return {};
+    }
+
+    // Go through the items from the top to the bottom and collect what they cover. Items that
+    // are transformed, translucent or at a fractional position neither cover nor get culled.
+    QList<Item *> occluded;
+    QRegion covered;
+    bool selfVisited = false;
+    for (auto it = sortedChildItems.crbegin(); it != sortedChildItems.crend(); ++it) {
+        Item *childItem = *it;
+        if (!selfVisited && childItem->z() < 0) {
+            covered += opaque() & shape();
+            selfVisited = true;
+        }
+        if (!childItem->explicitVisible() || !childItem->transform().isIdentity() || !isIntegral(childItem->position())) {
+            continue;
+        }
+        const QRect boundingRect = childItem->boundingRect().translated(childItem->position()).toAlignedRect();
+        if (!covered.isEmpty() && (QRegion(boundingRect) - covered).isEmpty()) {
+            occluded.append(childItem);
+            continue;
+        }
+        if (childItem->opacity() == 1.0) {
+            covered += (childItem->opaque() & childItem->shape()).translated(childItem->position().toPoint());
+        }
+    }
+
+    return occluded;
+}
+
 void Item::markSortedChildItemsDirty()
 {
     m_sortedChildItems.reset();
@@ -8,10 +8,13 @@
 
 #include "kwineffects.h"
 #include "kwinglobals.h"
+#include "utils/region.h"
 
 #include <QMatrix4x4>
 #include <QObject>
+#include <QVarLengthArray>
 
+#include <memory>
 #include <optional>
 
 namespace KWin
@@ -62,6 +65,12 @@ public:
     void setParentItem(Item *parent);
     QList<Item *> childItems() const;
     QList<Item *> sortedChildItems() const;
+    /**
+     * Returns the child items that are completely covered by the opaque region of this item or
+     * of siblings that are painted after them. This assumes that this item and its children are
+     * painted at full opacity, the caller has to check that.
+     */
+    QList<Item *> occludedChildItems() const;
 
     QPointF rootPosition() const;
 
@@ -106,6 +115,15 @@ public:
     WindowQuadList quads() const;
     virtual void preprocess();
 
+    /**
+     * Drops the repaints of all items on the given @a output, it's about to be removed.
+     */
+    static void removeOutput(Output *output);
+    /**
+     * Makes all items look up the outputs that they are on again.
+     */
+    static void invalidateOutputs();
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the position of this item has changed.
@@ -132,14 +150,26 @@ private:
     void updateBoundingRect();
     void scheduleRepaintInternal(const QRegion &region);
     void markSortedChildItemsDirty();
+    void markRootPositionDirty();
 
     bool computeEffectiveVisibility() const;
     void updateEffectiveVisibility();
     void removeRepaints(Output *output);
-
-    QPointer<Item> m_parentItem;
+    void link();
+    void unlink();
+    void addRepaints(Output *output, const Region &region);
+    QVarLengthArray<Output *, 2> overlappedOutputs(const QRect &rect);
+
+    struct OutputRepaints
+    {
+        Output *output;
+        Region region;
+    };
+
+    Item *m_parentItem = nullptr;
     QList<Item *> m_childItems;
-    QMatrix4x4 m_transform;
+    // Most items aren't transformed, the matrix is only allocated for those that are.
+    std::unique_ptr<QMatrix4x4> m_transform;
     QRectF m_boundingRect;
     QPointF m_position;
     QSizeF m_size = QSize(0, 0);
@@ -147,9 +177,17 @@ private:
     int m_z = 0;
     bool m_explicitVisible = true;
     bool m_effectiveVisible = true;
-    QMap<Output *, QRegion> m_repaints;
+    // Items are on one or two outputs most of the time, the repaints are kept in a small array.
+    QVarLengthArray<OutputRepaints, 2> m_repaints;
+    // The outputs that the global bounding rect of the item overlaps, as of m_overlappedRect.
+    QVarLengthArray<Output *, 2> m_overlappedOutputs;
+    std::optional<QRect> m_overlappedRect;
     mutable std::optional<WindowQuadList> m_quads;
     mutable std::optional<QList<Item *>> m_sortedChildItems;
+    mutable std::optional<QPointF> m_rootPosition;
+    // All items are linked in a list, so output changes reach them without a connection each.
+    Item *m_previousItem = nullptr;
+    Item *m_nextItem = nullptr;
 };
 
 } // namespace KWin
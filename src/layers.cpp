@@ -82,9 +82,9 @@
 #include "x11window.h"
 
 #include <array>
+#include <queue>
 
 #include <QDebug>
-#include <QQueue>
 
 namespace KWin
 {
@@ -530,43 +530,66 @@ QList<Window *> Workspace::constrainedStackingOrder()
         stacking += windows[layer];
     }
 
-    // Apply the stacking order constraints. First, we enqueue the root constraints, i.e.
-    // the ones that are not affected by other constraints.
-    QQueue<Constraint *> constraints;
-    constraints.reserve(m_constraints.count());
-    for (Constraint *constraint : qAsConst(m_constraints)) {
-        if (constraint->parents.isEmpty()) {
-            constraint->enqueued = true;
-            constraints.enqueue(constraint);
-        } else {
-            constraint->enqueued = false;
+    // Apply the stacking order constraints. The constraints form a graph where an edge goes
+    // from a "below" window to an "above" window. The graph is sorted topologically, among the
+    // windows whose constraints are all met the one that comes first in the layered order is
+    // picked. This preserves the order of unconstrained windows, and if a constraint is not
+    // met, the above window ends up right on top of its below window.
+    QHash<Window *, int> indices;
+    indices.reserve(stacking.count());
+    for (int i = 0; i < stacking.count(); ++i) {
+        indices.insert(stacking[i], i);
+    }
+
+    QVector<int> inDegrees(stacking.count(), 0);
+    QVector<QVector<int>> aboveIndices(stacking.count());
+    for (const Constraint *constraint : qAsConst(m_constraints)) {
+        const auto belowIt = indices.constFind(constraint->below);
+        const auto aboveIt = indices.constFind(constraint->above);
+        if (belowIt == indices.constEnd() || aboveIt == indices.constEnd()) {
+            continue;
         }
+        aboveIndices[*belowIt].append(*aboveIt);
+        ++inDegrees[*aboveIt];
     }
 
-    // Once we've enqueued all the root constraints, we traverse the constraints tree in
-    // the breadth-first search fashion. A constraint is applied only if its condition is
-    // not met.
-    while (!constraints.isEmpty()) {
-        Constraint *constraint = constraints.dequeue();
+    std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+    for (int i = 0; i < stacking.count(); ++i) {
+        if (inDegrees[i] == 0) {
+            ready.push(i);
+        }
+    }
 
-        const int belowIndex = stacking.indexOf(constraint->below);
-        const int aboveIndex = stacking.indexOf(constraint->above);
-        if (belowIndex == -1 || aboveIndex == -1) {
+    QList<Window *> constrained;
+    constrained.reserve(stacking.count());
+    QVector<bool> placed(stacking.count(), false);
+    int nextUnplaced = 0;
+    while (constrained.count() < stacking.count()) {
+        int index;
+        if (!ready.empty()) {
+            index = ready.top();
+            ready.pop();
+        } else {
+            // The remaining windows are constrained in a cycle, break it at the bottom-most one.
+            while (placed[nextUnplaced]) {
+                ++nextUnplaced;
+            }
+            index = nextUnplaced;
+        }
+        if (placed[index]) {
             continue;
-        } else if (aboveIndex < belowIndex) {
-            stacking.removeAt(aboveIndex);
-            stacking.insert(belowIndex, constraint->above);
         }
+        placed[index] = true;
+        constrained.append(stacking[index]);
 
-        for (Constraint *child : qAsConst(constraint->children)) {
-            if (!child->enqueued) {
-                child->enqueued = true;
-                constraints.enqueue(child);
+        for (int aboveIndex : qAsConst(aboveIndices[index])) {
+            if (--inDegrees[aboveIndex] == 0 && !placed[aboveIndex]) {
+                ready.push(aboveIndex);
             }
         }
     }
 
-    return stacking;
+    return constrained;
 }
 
 void Workspace::blockStackingUpdates(bool block)
@@ -12,6 +12,8 @@
 
 #include "logging_p.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -75,6 +77,58 @@ AniData::AniData(AnimationEffect::Attribute a, int meta_, const FPx2 &to_,
 {
 }
 
+static qreal easedValue(const QEasingCurve &curve, qreal t)
+{
+    // The curves that animations use most often are evaluated inline, these are the same
+    // formulas as in QEasingCurve.
+    t = std::clamp(t, 0.0, 1.0);
+    switch (curve.type()) {
+    case QEasingCurve::Linear:
+        return t;
+    case QEasingCurve::InQuad:
+        return t * t;
+    case QEasingCurve::OutQuad:
+        return -t * (t - 2);
+    case QEasingCurve::InOutQuad:
+        if (t < 0.5) {
+            return 2 * t * t;
+        } else {
+            t = 2 * t - 1;
+            return -0.5 * (t * (t - 2) - 1);
+        }
+    case QEasingCurve::InCubic:
+        return t * t * t;
+    case QEasingCurve::OutCubic:
+        t -= 1.0;
+        return t * t * t + 1;
+    case QEasingCurve::InOutCubic:
+        t *= 2.0;
+        if (t < 1) {
+            return 0.5 * t * t * t;
+        } else {
+            t -= 2.0;
+            return 0.5 * (t * t * t + 2);
+        }
+    default:
+        return curve.valueForProgress(t);
+    }
+}
+
+qreal AniData::value() const
+{
+    const qint64 elapsed = timeLine.elapsed().count();
+    const qint64 duration = timeLine.duration().count();
+    const TimeLine::Direction direction = timeLine.direction();
+    if (elapsed != m_cachedElapsed || duration != m_cachedDuration || direction != m_cachedDirection) {
+        const qreal t = timeLine.progress();
+        m_cachedValue = easedValue(timeLine.easingCurve(), direction == TimeLine::Backward ? 1.0 - t : t);
+        m_cachedElapsed = elapsed;
+        m_cachedDuration = duration;
+        m_cachedDirection = direction;
+    }
+    return m_cachedValue;
+}
+
 bool AniData::isActive() const
 {
     if (!timeLine.done()) {
@@ -58,6 +58,12 @@ public:
 
     bool isActive() const;
 
+    /**
+     * Returns the eased value of the timeline. It's evaluated once for every position of
+     * the timeline, no matter how many attributes and windows read it within a frame.
+     */
+    qreal value() const;
+
     inline bool isOneDimensional() const
     {
         return from[0] == from[1] && to[0] == to[1];
@@ -80,6 +86,12 @@ public:
     PreviousWindowPixmapLockPtr previousWindowPixmapLock;
     AnimationEffect::TerminationFlags terminationFlags;
     GLShader *shader{nullptr};
+
+private:
+    mutable qreal m_cachedValue = 0;
+    mutable qint64 m_cachedElapsed = -1;
+    mutable qint64 m_cachedDuration = -1;
+    mutable TimeLine::Direction m_cachedDirection = TimeLine::Forward;
 };
 
 } // namespace
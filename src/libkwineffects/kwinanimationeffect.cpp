@@ -280,7 +280,7 @@ quint64 AnimationEffect::p_animate(EffectWindow *w, Attribute a, uint meta, int
             w->addLayerRepaint(0, 0, s.width(), s.height());
         }
     } else {
-        triggerRepaint();
+        repaintAnimatedWindow(w);
     }
     if (shader) {
         CrossFadeEffect::redirect(w);
@@ -744,12 +744,12 @@ void AnimationEffect::postPaintScreen()
 
 float AnimationEffect::interpolated(const AniData &a, int i) const
 {
-    return a.from[i] + a.timeLine.value() * (a.to[i] - a.from[i]);
+    return a.from[i] + a.value() * (a.to[i] - a.from[i]);
 }
 
 float AnimationEffect::progress(const AniData &a) const
 {
-    return a.startTime < clock() ? a.timeLine.value() : 0.0;
+    return a.startTime < clock() ? a.value() : 0.0;
 }
 
 // TODO - get this out of the header - the functionpointer usage of QEasingCurve somehow sucks ;-)
@@ -830,6 +830,19 @@ void AnimationEffect::triggerRepaint()
     }
 }
 
+void AnimationEffect::repaintAnimatedWindow(EffectWindow *w)
+{
+    Q_D(AnimationEffect);
+    // Only the layer rect of the given window has been invalidated, the rects of the other
+    // animated windows are still valid and they're repainted in postPaintScreen() anyway.
+    updateLayerRepaints();
+    if (d->m_needSceneRepaint) {
+        effects->addRepaintFull();
+    } else if (auto it = d->m_animations.constFind(w); it != d->m_animations.constEnd()) {
+        w->addLayerRepaint(it->second);
+    }
+}
+
 static float fixOvershoot(float f, const AniData &d, short int dir, float s = 1.1)
 {
     switch (d.timeLine.easingCurve().type()) {
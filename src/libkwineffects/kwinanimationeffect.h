@@ -524,6 +524,7 @@ private:
     float progress(const AniData &) const;
     void disconnectGeometryChanges();
     void updateLayerRepaints();
+    void repaintAnimatedWindow(EffectWindow *w);
     void validate(Attribute a, uint &meta, FPx2 *from, FPx2 *to, const EffectWindow *w) const;
 
 private Q_SLOTS:
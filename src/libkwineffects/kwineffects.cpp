@@ -25,7 +25,9 @@
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
 
+#include <array>
 #include <optional>
+#include <vector>
 
 namespace KWin
 {
@@ -762,13 +764,41 @@ class Q_DECL_HIDDEN EffectWindow::Private
 {
 public:
     Private(EffectWindow *q);
+    ~Private();
+
+    struct WellKnownData
+    {
+        QVariant value;
+        void *pointer = nullptr;
+        bool flag = false;
+        bool hasRegion = false;
+        QRegion region;
+    };
 
     EffectWindow *q;
+    // indexed by the DataRole minus one
+    std::array<WellKnownData, WindowBackgroundContrastAppliedRole> wellKnownData;
+    std::vector<std::shared_ptr<void>> dataSlots;
+
+    // the windows are walked when a data slot is unregistered, so its values are dropped
+    static QSet<Private *> s_windows;
+    static int s_dataSlotCount;
+    static QVector<int> s_freeDataSlots;
 };
 
+QSet<EffectWindow::Private *> EffectWindow::Private::s_windows;
+int EffectWindow::Private::s_dataSlotCount = 0;
+QVector<int> EffectWindow::Private::s_freeDataSlots;
+
 EffectWindow::Private::Private(EffectWindow *q)
     : q(q)
 {
+    s_windows.insert(this);
+}
+
+EffectWindow::Private::~Private()
+{
+    s_windows.remove(this);
 }
 
 EffectWindow::EffectWindow(QObject *parent)
@@ -781,6 +811,84 @@ EffectWindow::~EffectWindow()
 {
 }
 
+bool EffectWindow::isWellKnownRole(int role)
+{
+    return role >= WindowAddedGrabRole && role <= WindowBackgroundContrastAppliedRole;
+}
+
+void EffectWindow::setWellKnownData(int role, const QVariant &data)
+{
+    Q_ASSERT(isWellKnownRole(role));
+    Private::WellKnownData &slot = d->wellKnownData[role - 1];
+    slot.value = data;
+    slot.pointer = data.value<void *>();
+    slot.flag = data.toBool();
+    slot.hasRegion = data.isValid();
+    slot.region = qvariant_cast<QRegion>(data);
+}
+
+QVariant EffectWindow::wellKnownData(int role) const
+{
+    Q_ASSERT(isWellKnownRole(role));
+    return d->wellKnownData[role - 1].value;
+}
+
+void *EffectWindow::grab(DataRole role) const
+{
+    return d->wellKnownData[role - 1].pointer;
+}
+
+bool EffectWindow::dataFlag(DataRole role) const
+{
+    return d->wellKnownData[role - 1].flag;
+}
+
+QRegion EffectWindow::dataRegion(DataRole role, bool *isSet) const
+{
+    const Private::WellKnownData &slot = d->wellKnownData[role - 1];
+    if (isSet) {
+        *isSet = slot.hasRegion;
+    }
+    return slot.region;
+}
+
+int EffectWindow::registerDataSlot()
+{
+    if (!Private::s_freeDataSlots.isEmpty()) {
+        return Private::s_freeDataSlots.takeLast();
+    }
+    return Private::s_dataSlotCount++;
+}
+
+void EffectWindow::unregisterDataSlot(int index)
+{
+    for (Private *window : std::as_const(Private::s_windows)) {
+        if (index < int(window->dataSlots.size())) {
+            window->dataSlots[index].reset();
+        }
+    }
+    Private::s_freeDataSlots.append(index);
+}
+
+void *EffectWindow::dataSlot(int index) const
+{
+    if (index < int(d->dataSlots.size())) {
+        return d->dataSlots[index].get();
+    }
+    return nullptr;
+}
+
+void EffectWindow::setDataSlot(int index, std::shared_ptr<void> &&value)
+{
+    if (index >= int(d->dataSlots.size())) {
+        if (!value) {
+            return;
+        }
+        d->dataSlots.resize(index + 1);
+    }
+    d->dataSlots[index] = std::move(value);
+}
+
 bool EffectWindow::isOnActivity(const QString &activity) const
 {
     const QStringList _activities = activities();
@@ -1075,13 +1183,11 @@ void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertic
         for (const WindowQuad &quad : *this) {
 #pragma GCC unroll 4
             for (int j = 0; j < 4; j++) {
-                const WindowVertex &wv = quad[j];
+                const WindowVertex &wv = quad.verts[j];
 
-                GLVertex2D v;
-                v.position = QVector2D(wv.x(), wv.y());
-                v.texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-
-                *(vertex++) = v;
+                vertex->position = QVector2D(wv.px, wv.py);
+                vertex->texcoord = QVector2D(wv.tx, wv.ty) * coeff + offset;
+                vertex++;
             }
         }
     } break;
@@ -1091,10 +1197,10 @@ void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertic
 
 #pragma GCC unroll 4
             for (int j = 0; j < 4; j++) {
-                const WindowVertex &wv = quad[j];
+                const WindowVertex &wv = quad.verts[j];
 
-                v[j].position = QVector2D(wv.x(), wv.y());
-                v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
+                v[j].position = QVector2D(wv.px, wv.py);
+                v[j].texcoord = QVector2D(wv.tx, wv.ty) * coeff + offset;
             }
 
             // First triangle
@@ -1124,15 +1230,20 @@ void WindowQuadList::makeArrays(float **vertices, float **texcoords, const QSize
     // Note: The positions in a WindowQuad are stored in clockwise order
     const int index[] = {1, 0, 3, 3, 2, 1};
 
+    // Turn the texture coordinate normalization into a single multiply-add per component
+    const float uScale = 1.0 / size.width();
+    const float vScale = yInverted ? 1.0 / size.height() : -1.0 / size.height();
+    const float vOffset = yInverted ? 0.0 : 1.0;
+
     for (const WindowQuad &quad : *this) {
         for (int j = 0; j < 6; j++) {
-            const WindowVertex &wv = quad[index[j]];
+            const WindowVertex &wv = quad.verts[index[j]];
 
-            *vpos++ = wv.x();
-            *vpos++ = wv.y();
+            *vpos++ = wv.px;
+            *vpos++ = wv.py;
 
-            *tpos++ = wv.u() / size.width();
-            *tpos++ = yInverted ? (wv.v() / size.height()) : (1.0 - wv.v() / size.height());
+            *tpos++ = wv.tx * uScale;
+            *tpos++ = wv.ty * vScale + vOffset;
         }
     }
 }
@@ -40,6 +40,7 @@
 #include <climits>
 #include <cmath>
 #include <functional>
+#include <memory>
 
 class KConfigGroup;
 class QFont;
@@ -159,7 +160,7 @@ typedef QList<KWin::EffectWindow *> EffectWindowList;
 
 #define KWIN_EFFECT_API_MAKE_VERSION(major, minor) ((major) << 8 | (minor))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 235
+#define KWIN_EFFECT_API_VERSION_MINOR 236
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
     KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR)
 
@@ -178,6 +179,8 @@ enum DataRole {
     WindowBlurBehindRole, ///< For single windows to blur behind
     WindowForceBackgroundContrastRole, ///< For fullscreen effects to enforce the background contrast,
     WindowBackgroundContrastRole, ///< For single windows to enable Background contrast
+    WindowBackgroundContrastMatrixRole, ///< The color matrix of the background contrast, set by the contrast effect
+    WindowBackgroundContrastAppliedRole, ///< Set by the blur effect while it applies the background contrast itself
 };
 
 /**
@@ -1427,6 +1430,13 @@ public:
      * Returns the device pixel ratio of the current render target.
      */
     virtual qreal renderTargetScale() const = 0;
+    /**
+     * Returns the part of the render target that changed since the previous frame, in the
+     * logical pixels. Unlike the repainted area, it isn't the whole render target while the
+     * screen is transformed, so effects that keep the screen in a texture of their own can
+     * update only that part of it. It's valid in paintScreen().
+     */
+    virtual QRegion renderTargetChanges() const = 0;
 
     /**
      * Maps the given @a rect from the global screen cordinates to the render
@@ -1954,6 +1964,14 @@ Q_SIGNALS:
 
     void inputPanelChanged();
 
+    /**
+     * This signal is emitted when the textures take more memory than the texture budget
+     * allows. Effects should free the textures that they cache but don't need right now.
+     *
+     * @since 5.27
+     */
+    void textureMemoryLow();
+
 protected:
     QVector<EffectPair> loaded_effects;
     // QHash< QString, EffectFactory* > effect_factories;
@@ -2017,6 +2035,12 @@ public:
     virtual QString model() const = 0;
     virtual QString serialNumber() const = 0;
 
+    /**
+     * Schedules a new frame on the screen without repainting anything in particular. It's
+     * meant for effects that repaint the whole screen anyway, e.g. while they transform it.
+     */
+    virtual void scheduleRepaint() = 0;
+
 Q_SIGNALS:
     /**
      * Notifies that the display will be dimmed in @p time ms.
@@ -2696,6 +2720,26 @@ public:
     Q_SCRIPTABLE virtual void setData(int role, const QVariant &data) = 0;
     Q_SCRIPTABLE virtual QVariant data(int role) const = 0;
 
+    /**
+     * Returns the effect that has grabbed the window for the grab @a role, it's the same as
+     * data(role).value<void *>() but doesn't go through a QVariant.
+     * @since 5.26
+     */
+    void *grab(DataRole role) const;
+    /**
+     * Returns whether @a role has been set to a value that converts to @c true, it's the same
+     * as data(role).toBool() but doesn't go through a QVariant.
+     * @since 5.26
+     */
+    bool dataFlag(DataRole role) const;
+    /**
+     * Returns the region that @a role has been set to, e.g. for WindowBlurBehindRole. An empty
+     * region is returned if the role hasn't been set or has been set to something else than a
+     * region, @a isSet tells the two cases apart.
+     * @since 5.26
+     */
+    QRegion dataRegion(DataRole role, bool *isSet = nullptr) const;
+
     /**
      * @brief References the previous window pixmap to prevent discarding.
      *
@@ -2730,11 +2774,82 @@ protected:
     virtual void refVisible(const EffectWindowVisibleRef *holder) = 0;
     virtual void unrefVisible(const EffectWindowVisibleRef *holder) = 0;
 
+    /**
+     * Returns whether @a role is one of the DataRole values, which are kept in fixed slots
+     * along with their decoded values rather than in a hash.
+     */
+    static bool isWellKnownRole(int role);
+    void setWellKnownData(int role, const QVariant &data);
+    QVariant wellKnownData(int role) const;
+
 private:
+    template<typename T>
+    friend class EffectWindowDataSlot;
+    static int registerDataSlot();
+    static void unregisterDataSlot(int index);
+    void *dataSlot(int index) const;
+    void setDataSlot(int index, std::shared_ptr<void> &&value);
+
     class Private;
     std::unique_ptr<Private> d;
 };
 
+/**
+ * The EffectWindowDataSlot class stores a value of type @c T in every EffectWindow.
+ *
+ * It's meant for the data that an effect looks up while painting. Getting the value is an
+ * indexed access rather than a hash lookup and a QVariant conversion as with EffectWindow::data().
+ * The values are private to the slot, which has to outlive the windows' use of it, they are
+ * dropped from all windows when the slot is destroyed. Setting a value doesn't emit
+ * EffectsHandler::windowDataChanged.
+ *
+ * @code
+ * EffectWindowDataSlot<QRegion> m_blurRegion;
+ * ...
+ * if (const QRegion *region = m_blurRegion.value(w)) {
+ * @endcode
+ * @since 5.26
+ */
+template<typename T>
+class EffectWindowDataSlot
+{
+public:
+    EffectWindowDataSlot()
+        : m_index(EffectWindow::registerDataSlot())
+    {
+    }
+    ~EffectWindowDataSlot()
+    {
+        EffectWindow::unregisterDataSlot(m_index);
+    }
+
+    EffectWindowDataSlot(const EffectWindowDataSlot &) = delete;
+    EffectWindowDataSlot &operator=(const EffectWindowDataSlot &) = delete;
+
+    /**
+     * Returns the value stored in @a window, or @c nullptr if none has been set.
+     */
+    T *value(const EffectWindow *window) const
+    {
+        return static_cast<T *>(window->dataSlot(m_index));
+    }
+    void setValue(EffectWindow *window, const T &value) const
+    {
+        if (T *current = this->value(window)) {
+            *current = value;
+        } else {
+            window->setDataSlot(m_index, std::make_shared<T>(value));
+        }
+    }
+    void reset(EffectWindow *window) const
+    {
+        window->setDataSlot(m_index, nullptr);
+    }
+
+private:
+    const int m_index;
+};
+
 /**
  * The EffectWindowDeletedRef provides a convenient way to prevent deleting a closed
  * window until an effect has finished animating it.
@@ -2907,8 +3022,10 @@ public:
 private:
     friend class WindowQuad;
     friend class WindowQuadList;
-    double px, py; // position
-    double tx, ty; // texture coords
+    // Single precision is enough for screen and texture coordinates, and it halves the
+    // memory traffic when building vertex arrays for finely subdivided windows.
+    float px, py; // position
+    float tx, ty; // texture coords
 };
 
 /**
@@ -23,6 +23,9 @@
 #include <QVector3D>
 #include <QVector4D>
 
+#include <algorithm>
+#include <numeric>
+
 namespace KWin
 {
 
@@ -37,7 +40,12 @@ bool GLTexturePrivate::s_supportsTextureStorage = false;
 bool GLTexturePrivate::s_supportsTextureSwizzle = false;
 bool GLTexturePrivate::s_supportsTextureFormatRG = false;
 bool GLTexturePrivate::s_supportsTexture16Bit = false;
+bool GLTexturePrivate::s_supportsPixelUnpackBuffer = false;
+quint64 GLTexturePrivate::s_convertedImages = 0;
+qint64 GLTexturePrivate::s_allocatedBytes[GLTexture::MemoryCategoryCount] = {};
 uint GLTexturePrivate::s_fbo = 0;
+GLuint GLTexturePrivate::s_pixelUnpackBuffers[GLTexturePrivate::s_pixelUnpackBufferCount] = {};
+int GLTexturePrivate::s_pixelUnpackBufferIndex = 0;
 
 // Table of GL formats/types associated with different values of QImage::Format.
 // Zero values indicate a direct upload is not feasible.
@@ -79,9 +87,38 @@ struct
     {0, 0, 0}, // QImage::Format_RGBA64
     {GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT}, // QImage::Format_RGBA64_Premultiplied
     {GL_R16, GL_RED, GL_UNSIGNED_SHORT}, // QImage::Format_Grayscale16
-    {0, 0, 0}, // QImage::Format_BGR888
+    {GL_RGB8, GL_BGR, GL_UNSIGNED_BYTE}, // QImage::Format_BGR888
 };
 
+// An estimate of the storage that a texture needs, drivers usually pad texels with three
+// channels to four bytes.
+static qint64 storageBytes(GLenum internalFormat, const QSize &size, int levels)
+{
+    int bytesPerPixel;
+    switch (internalFormat) {
+    case GL_R8:
+        bytesPerPixel = 1;
+        break;
+    case GL_R16:
+    case GL_RG8:
+        bytesPerPixel = 2;
+        break;
+    case GL_RGBA16:
+    case GL_RGBA16F:
+        bytesPerPixel = 8;
+        break;
+    case GL_RGBA32F:
+        bytesPerPixel = 16;
+        break;
+    default:
+        bytesPerPixel = 4;
+        break;
+    }
+    const qint64 bytes = qint64(size.width()) * size.height() * bytesPerPixel;
+    // the smaller mipmap levels add up to a third of the base level
+    return levels > 1 ? bytes * 4 / 3 : bytes;
+}
+
 GLTexture::GLTexture(GLenum target)
     : d_ptr(new GLTexturePrivate())
 {
@@ -145,6 +182,7 @@ GLTexture::GLTexture(const QImage &image, GLenum target)
             im = image;
         } else {
             im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            ++d->s_convertedImages;
             internalFormat = GL_RGBA8;
             format = GL_BGRA;
             type = GL_UNSIGNED_INT_8_8_8_8_REV;
@@ -165,16 +203,35 @@ GLTexture::GLTexture(const QImage &image, GLenum target)
     } else {
         d->m_internalFormat = GL_RGBA8;
 
-        if (d->s_supportsARGB32) {
-            const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-            glTexImage2D(d->m_target, 0, GL_BGRA_EXT, im.width(), im.height(),
-                         0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, im.constBits());
-        } else {
-            const QImage im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-            glTexImage2D(d->m_target, 0, GL_RGBA, im.width(), im.height(),
-                         0, GL_RGBA, GL_UNSIGNED_BYTE, im.constBits());
+        // Without GL_EXT_texture_format_BGRA8888, the images that QPainter and most clients
+        // produce are uploaded as they are and the channels are put in order when sampling.
+        switch (image.format()) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+            if (!d->s_supportsARGB32 && d->s_supportsTextureSwizzle) {
+                d->m_bgraSwizzle = true;
+                setSwizzle(GL_BLUE, GL_GREEN, GL_RED, GL_ALPHA);
+            }
+            break;
+        default:
+            break;
         }
+
+        GLenum format;
+        GLenum type;
+        QImage::Format uploadFormat;
+        d->uploadFormat(image.format(), &format, &type, &uploadFormat);
+        QImage im = image;
+        if (im.format() != uploadFormat) {
+            im.convertTo(uploadFormat);
+            ++d->s_convertedImages;
+        }
+        // the internal format has to match the format on GLES 2
+        glTexImage2D(d->m_target, 0, format, im.width(), im.height(),
+                     0, format, type, im.constBits());
     }
+    d->setAllocatedBytes(storageBytes(d->m_internalFormat, d->m_size, d->m_mipLevels));
 
     unbind();
     setFilter(GL_LINEAR);
@@ -230,6 +287,7 @@ GLTexture::GLTexture(GLenum internalFormat, int width, int height, int levels, b
         // internalFormat() won't need to be specialized for GLES2.
         d->m_internalFormat = GL_RGBA8;
     }
+    d->setAllocatedBytes(storageBytes(d->m_internalFormat, d->m_size, levels));
 
     unbind();
 }
@@ -297,14 +355,49 @@ GLTexturePrivate::GLTexturePrivate()
 {
 }
 
+void GLTexturePrivate::uploadFormat(QImage::Format imageFormat, GLenum *glFormat, GLenum *type, QImage::Format *uploadFormat) const
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        if (imageFormat < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[imageFormat].internalFormat
+            && !(formatTable[imageFormat].type == GL_UNSIGNED_SHORT && !s_supportsTexture16Bit)) {
+            *glFormat = formatTable[imageFormat].format;
+            *type = formatTable[imageFormat].type;
+            *uploadFormat = imageFormat;
+        } else {
+            *glFormat = GL_BGRA;
+            *type = GL_UNSIGNED_INT_8_8_8_8_REV;
+            *uploadFormat = QImage::Format_ARGB32_Premultiplied;
+        }
+    } else {
+        // The padding byte of the formats without alpha channel is always 0xff, so they can be
+        // uploaded like the formats with the same channel order.
+        *type = GL_UNSIGNED_BYTE;
+        if (s_supportsARGB32 || m_bgraSwizzle) {
+            *glFormat = s_supportsARGB32 ? GL_BGRA_EXT : GL_RGBA;
+            *uploadFormat = imageFormat == QImage::Format_RGB32 ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+        } else {
+            *glFormat = GL_RGBA;
+            *uploadFormat = imageFormat == QImage::Format_RGBX8888 ? QImage::Format_RGBX8888 : QImage::Format_RGBA8888_Premultiplied;
+        }
+    }
+}
+
 GLTexturePrivate::~GLTexturePrivate()
 {
+    setAllocatedBytes(0);
     delete m_vbo;
     if (m_texture != 0 && !m_foreign) {
+        GLState::forgetTexture(m_texture);
         glDeleteTextures(1, &m_texture);
     }
 }
 
+void GLTexturePrivate::setAllocatedBytes(qint64 bytes)
+{
+    s_allocatedBytes[int(m_memoryCategory)] += bytes - m_allocatedBytes;
+    m_allocatedBytes = bytes;
+}
+
 void GLTexturePrivate::initStatic()
 {
     if (!GLPlatform::instance()->isGLES()) {
@@ -316,6 +409,8 @@ void GLTexturePrivate::initStatic()
         s_supportsTexture16Bit = true;
         s_supportsARGB32 = true;
         s_supportsUnpack = true;
+        s_supportsPixelUnpackBuffer = hasGLVersion(3, 0)
+            || (hasGLExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object")) && hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range")));
     } else {
         s_supportsFramebufferObjects = true;
         s_supportsTextureStorage = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_texture_storage"));
@@ -329,6 +424,11 @@ void GLTexturePrivate::initStatic()
         s_supportsARGB32 = QSysInfo::ByteOrder == QSysInfo::LittleEndian && hasGLExtension(QByteArrayLiteral("GL_EXT_texture_format_BGRA8888"));
 
         s_supportsUnpack = hasGLExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
+        s_supportsPixelUnpackBuffer = hasGLVersion(3, 0);
+    }
+
+    if (qEnvironmentVariableIsSet("KWIN_GL_NO_PIXEL_UNPACK_BUFFER")) {
+        s_supportsPixelUnpackBuffer = false;
     }
 }
 
@@ -336,10 +436,18 @@ void GLTexturePrivate::cleanup()
 {
     s_supportsFramebufferObjects = false;
     s_supportsARGB32 = false;
+    s_convertedImages = 0;
     if (s_fbo) {
+        GLState::forgetFramebuffer(s_fbo);
         glDeleteFramebuffers(1, &s_fbo);
         s_fbo = 0;
     }
+    if (s_supportsPixelUnpackBuffer) {
+        glDeleteBuffers(s_pixelUnpackBufferCount, s_pixelUnpackBuffers);
+        std::fill(std::begin(s_pixelUnpackBuffers), std::end(s_pixelUnpackBuffers), 0);
+        s_pixelUnpackBufferIndex = 0;
+    }
+    s_supportsPixelUnpackBuffer = false;
 }
 
 bool GLTexture::isNull() const
@@ -376,30 +484,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     GLenum glFormat;
     GLenum type;
     QImage::Format uploadFormat;
-    if (!GLPlatform::instance()->isGLES()) {
-        const QImage::Format index = image.format();
-
-        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat
-            && !(formatTable[index].type == GL_UNSIGNED_SHORT && !d->s_supportsTexture16Bit)) {
-            glFormat = formatTable[index].format;
-            type = formatTable[index].type;
-            uploadFormat = index;
-        } else {
-            glFormat = GL_BGRA;
-            type = GL_UNSIGNED_INT_8_8_8_8_REV;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        }
-    } else {
-        if (d->s_supportsARGB32) {
-            glFormat = GL_BGRA_EXT;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        } else {
-            glFormat = GL_RGBA;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
-        }
-    }
+    d->uploadFormat(image.format(), &glFormat, &type, &uploadFormat);
     bool useUnpack = d->s_supportsUnpack && image.format() == uploadFormat && !src.isNull();
 
     QImage im;
@@ -417,6 +502,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
         }
         if (im.format() != uploadFormat) {
             im.convertTo(uploadFormat);
+            ++d->s_convertedImages;
         }
     }
 
@@ -429,7 +515,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
 
     bind();
 
-    glTexSubImage2D(d->m_target, 0, offset.x(), offset.y(), width, height, glFormat, type, im.constBits());
+    glTexSubImage2D(d->m_target, 0, d->m_atlasOffset.x() + offset.x(), d->m_atlasOffset.y() + offset.y(), width, height, glFormat, type, im.constBits());
 
     unbind();
 
@@ -440,6 +526,104 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     }
 }
 
+void GLTexture::update(const QImage &image, const QRegion &region)
+{
+    if (image.isNull() || isNull() || region.isEmpty()) {
+        return;
+    }
+
+    Q_D(GLTexture);
+    Q_ASSERT(!d->m_foreign);
+
+    // Uploading many small rectangles one by one costs more than uploading a few pixels that
+    // have not changed, so merge the damage into its bounding rectangle if it's dense enough.
+    QVector<QRect> rects;
+    const QRect bounds = region.boundingRect().intersected(image.rect());
+    quint64 damagedArea = 0;
+    for (const QRect &rect : region) {
+        damagedArea += quint64(rect.width()) * rect.height();
+    }
+    if (region.rectCount() > 32 || quint64(bounds.width()) * bounds.height() <= damagedArea * 3 / 2) {
+        rects.append(bounds);
+    } else {
+        for (const QRect &rect : region) {
+            rects.append(rect.intersected(image.rect()));
+        }
+    }
+
+    GLenum glFormat;
+    GLenum type;
+    QImage::Format uploadFormat;
+    d->uploadFormat(image.format(), &glFormat, &type, &uploadFormat);
+
+    if (!d->s_supportsPixelUnpackBuffer || image.format() != uploadFormat) {
+        for (const QRect &rect : std::as_const(rects)) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+
+    const int bytesPerPixel = image.depth() / 8;
+    qsizetype bufferSize = 0;
+    for (const QRect &rect : std::as_const(rects)) {
+        bufferSize += qsizetype(rect.width()) * rect.height() * bytesPerPixel;
+    }
+    if (!bufferSize) {
+        return;
+    }
+
+    GLuint &buffer = GLTexturePrivate::s_pixelUnpackBuffers[GLTexturePrivate::s_pixelUnpackBufferIndex];
+    GLTexturePrivate::s_pixelUnpackBufferIndex = (GLTexturePrivate::s_pixelUnpackBufferIndex + 1) % GLTexturePrivate::s_pixelUnpackBufferCount;
+    if (!buffer) {
+        glGenBuffers(1, &buffer);
+    }
+
+    // The previous contents of the buffer are orphaned, so the driver doesn't have to wait
+    // until the GPU has finished the transfers that still read from them.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    uchar *data = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!data) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (const QRect &rect : std::as_const(rects)) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+
+    // Pack the rows of the damaged rectangles tightly, the transfers are done by the GPU later.
+    qsizetype offset = 0;
+    for (const QRect &rect : std::as_const(rects)) {
+        const qsizetype rowSize = qsizetype(rect.width()) * bytesPerPixel;
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            memcpy(data + offset, image.constScanLine(y) + rect.x() * bytesPerPixel, rowSize);
+            offset += rowSize;
+        }
+    }
+
+    if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+        // The buffer contents got corrupted, e.g. due to a mode switch.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (const QRect &rect : std::as_const(rects)) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+
+    bind();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    offset = 0;
+    for (const QRect &rect : std::as_const(rects)) {
+        glTexSubImage2D(d->m_target, 0, d->m_atlasOffset.x() + rect.x(), d->m_atlasOffset.y() + rect.y(), rect.width(), rect.height(), glFormat, type,
+                        reinterpret_cast<const void *>(offset));
+        offset += qsizetype(rect.width()) * rect.height() * bytesPerPixel;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    unbind();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void GLTexture::discard()
 {
     d_ptr = new GLTexturePrivate();
@@ -450,7 +634,7 @@ void GLTexture::bind()
     Q_D(GLTexture);
     Q_ASSERT(d->m_texture);
 
-    glBindTexture(d->m_target, d->m_texture);
+    GLState::bindTexture(d->m_target, d->m_texture);
 
     if (d->m_markedDirty) {
         d->onDamage();
@@ -505,7 +689,7 @@ void GLTexture::generateMipmaps()
 void GLTexture::unbind()
 {
     Q_D(GLTexture);
-    glBindTexture(d->m_target, 0);
+    GLState::bindTexture(d->m_target, 0);
 }
 
 void GLTexture::render(const QRect &rect)
@@ -580,30 +764,27 @@ void GLTexture::clear()
         glGenFramebuffers(1, &GLTexturePrivate::s_fbo);
     }
 
-    if (GLTexturePrivate::s_fbo) {
+    // an entry of a texture atlas must not clear the rest of the atlas
+    if (GLTexturePrivate::s_fbo && d->m_atlasSize.isEmpty()) {
         // Clear the texture
-        GLuint previousFramebuffer = 0;
-        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, reinterpret_cast<GLint *>(&previousFramebuffer));
-        if (GLTexturePrivate::s_fbo != previousFramebuffer) {
-            glBindFramebuffer(GL_FRAMEBUFFER, GLTexturePrivate::s_fbo);
-        }
+        const GLuint previousFramebuffer = GLState::drawFramebuffer();
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, GLTexturePrivate::s_fbo);
         glClearColor(0, 0, 0, 0);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, d->m_texture, 0);
         glClear(GL_COLOR_BUFFER_BIT);
-        if (GLTexturePrivate::s_fbo != previousFramebuffer) {
-            glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
-        }
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
     } else {
         if (const int size = width() * height()) {
             uint32_t *buffer = new uint32_t[size];
             memset(buffer, 0, size * sizeof(uint32_t));
             bind();
+            const QPoint offset = d->m_atlasOffset;
             if (!GLPlatform::instance()->isGLES()) {
-                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width(), height(),
+                glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x(), offset.y(), width(), height(),
                                 GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
             } else {
                 const GLenum format = d->s_supportsARGB32 ? GL_BGRA_EXT : GL_RGBA;
-                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width(), height(),
+                glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x(), offset.y(), width(), height(),
                                 format, GL_UNSIGNED_BYTE, buffer);
             }
             unbind();
@@ -665,6 +846,15 @@ void GLTexturePrivate::updateMatrix()
         m_matrix[UnnormalizedCoordinates].translate(0.0, m_size.height());
         m_matrix[UnnormalizedCoordinates].scale(1.0, -1.0);
     }
+
+    if (!m_atlasSize.isEmpty()) {
+        // map the normalized coordinates of the entry to its area in the atlas
+        QMatrix4x4 atlasMatrix;
+        atlasMatrix.translate(qreal(m_atlasOffset.x()) / m_atlasSize.width(), qreal(m_atlasOffset.y()) / m_atlasSize.height());
+        atlasMatrix.scale(qreal(m_size.width()) / m_atlasSize.width(), qreal(m_size.height()) / m_atlasSize.height());
+        m_matrix[NormalizedCoordinates] = atlasMatrix * m_matrix[NormalizedCoordinates];
+        m_matrix[UnnormalizedCoordinates] = atlasMatrix * m_matrix[UnnormalizedCoordinates];
+    }
 }
 
 bool GLTexture::isYInverted() const
@@ -727,6 +917,45 @@ bool GLTexture::supportsSwizzle()
     return GLTexturePrivate::s_supportsTextureSwizzle;
 }
 
+quint64 GLTexture::convertedImageCount()
+{
+    return GLTexturePrivate::s_convertedImages;
+}
+
+void GLTexture::setMemoryCategory(MemoryCategory category)
+{
+    Q_D(GLTexture);
+    if (d->m_memoryCategory == category) {
+        return;
+    }
+    const qint64 bytes = d->m_allocatedBytes;
+    d->setAllocatedBytes(0);
+    d->m_memoryCategory = category;
+    d->setAllocatedBytes(bytes);
+}
+
+GLTexture::MemoryCategory GLTexture::memoryCategory() const
+{
+    Q_D(const GLTexture);
+    return d->m_memoryCategory;
+}
+
+qint64 GLTexture::allocatedBytes() const
+{
+    Q_D(const GLTexture);
+    return d->m_allocatedBytes;
+}
+
+qint64 GLTexture::allocatedBytes(MemoryCategory category)
+{
+    return GLTexturePrivate::s_allocatedBytes[int(category)];
+}
+
+qint64 GLTexture::totalAllocatedBytes()
+{
+    return std::accumulate(std::begin(GLTexturePrivate::s_allocatedBytes), std::end(GLTexturePrivate::s_allocatedBytes), qint64(0));
+}
+
 bool GLTexture::supportsFormatRG()
 {
     return GLTexturePrivate::s_supportsTextureFormatRG;
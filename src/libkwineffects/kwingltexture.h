@@ -40,6 +40,21 @@ enum TextureCoordinateType {
 class KWINGLUTILS_EXPORT GLTexture
 {
 public:
+    /**
+     * The owners that texture memory is accounted to, see setMemoryCategory().
+     *
+     * @since 5.27
+     */
+    enum class MemoryCategory {
+        Other,
+        Window,
+        Decoration,
+        Shadow,
+        Effect,
+        Cursor,
+    };
+    static constexpr int MemoryCategoryCount = int(MemoryCategory::Cursor) + 1;
+
     explicit GLTexture(GLenum target);
     GLTexture(const GLTexture &tex);
     explicit GLTexture(const QImage &image, GLenum target = GL_TEXTURE_2D);
@@ -99,6 +114,14 @@ public:
     QMatrix4x4 matrix(TextureCoordinateType type) const;
 
     void update(const QImage &image, const QPoint &offset = QPoint(0, 0), const QRect &src = QRect());
+    /**
+     * Uploads the given @a region of the @a image to the same position in the texture. Small
+     * damage rectangles are merged, and if pixel buffer objects are supported, the pixels are
+     * staged in a pixel unpack buffer so the GPU can transfer them asynchronously.
+     *
+     * @since 5.27
+     */
+    void update(const QImage &image, const QRegion &region);
     virtual void discard();
     void bind();
     void unbind();
@@ -146,6 +169,40 @@ public:
      */
     static bool supportsFormatRG();
 
+    /**
+     * Returns how many images had to be converted to another format on the CPU before they
+     * could be uploaded, since the OpenGL context was created.
+     */
+    static quint64 convertedImageCount();
+
+    /**
+     * Sets the owner that the memory of this texture is accounted to. Textures that aren't
+     * assigned to anything are accounted as MemoryCategory::Other.
+     *
+     * @since 5.27
+     */
+    void setMemoryCategory(MemoryCategory category);
+    MemoryCategory memoryCategory() const;
+    /**
+     * Returns an estimate of how much memory the storage of this texture takes in bytes. Textures
+     * that wrap storage that they don't own, e.g. an EGLImage or a foreign texture, take none.
+     *
+     * @since 5.27
+     */
+    qint64 allocatedBytes() const;
+    /**
+     * Returns how much memory the textures of the given @a category take in bytes.
+     *
+     * @since 5.27
+     */
+    static qint64 allocatedBytes(MemoryCategory category);
+    /**
+     * Returns how much memory all textures take in bytes.
+     *
+     * @since 5.27
+     */
+    static qint64 totalAllocatedBytes();
+
 protected:
     QExplicitlySharedDataPointer<GLTexturePrivate> d_ptr;
     GLTexture(GLTexturePrivate &dd);
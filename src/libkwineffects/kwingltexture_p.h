@@ -37,6 +37,7 @@ public:
     virtual void onDamage();
 
     void updateMatrix();
+    void setAllocatedBytes(qint64 bytes);
 
     GLuint m_texture;
     GLenum m_target;
@@ -53,7 +54,14 @@ public:
     bool m_wrapModeChanged;
     bool m_immutable;
     bool m_foreign;
+    // the texture holds BGRA data, the red and blue channels are swapped when it's sampled
+    bool m_bgraSwizzle = false;
+    // if the texture is an entry of a texture atlas, its position in the atlas and the atlas size
+    QPoint m_atlasOffset;
+    QSize m_atlasSize;
     int m_mipLevels;
+    qint64 m_allocatedBytes = 0;
+    GLTexture::MemoryCategory m_memoryCategory = GLTexture::MemoryCategory::Other;
 
     int m_unnormalizeActive; // 0 - no, otherwise refcount
     int m_normalizeActive; // 0 - no, otherwise refcount
@@ -61,6 +69,7 @@ public:
     QSize m_cachedSize;
 
     static void initStatic();
+    void uploadFormat(QImage::Format imageFormat, GLenum *glFormat, GLenum *type, QImage::Format *uploadFormat) const;
 
     static bool s_supportsFramebufferObjects;
     static bool s_supportsARGB32;
@@ -69,8 +78,15 @@ public:
     static bool s_supportsTextureSwizzle;
     static bool s_supportsTextureFormatRG;
     static bool s_supportsTexture16Bit;
+    static bool s_supportsPixelUnpackBuffer;
+    static quint64 s_convertedImages;
+    static qint64 s_allocatedBytes[GLTexture::MemoryCategoryCount];
     static GLuint s_fbo;
 
+    static constexpr int s_pixelUnpackBufferCount = 3;
+    static GLuint s_pixelUnpackBuffers[s_pixelUnpackBufferCount];
+    static int s_pixelUnpackBufferIndex;
+
 private:
     friend void KWin::cleanupGL();
     static void cleanup();
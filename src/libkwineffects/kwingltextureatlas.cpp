@@ -0,0 +1,189 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwingltextureatlas.h"
+#include "kwinglplatform.h"
+#include "kwingltexture_p.h"
+#include "kwinskylinepacker.h"
+
+#include <QImage>
+
+#include <algorithm>
+#include <numeric>
+
+namespace KWin
+{
+
+static const int s_pageSize = 2048;
+static const int s_maximumEntrySize = 256;
+static const int s_maximumPageCount = 4;
+
+static std::unique_ptr<GLTextureAtlas> s_atlas;
+
+struct GLTextureAtlas::Page
+{
+    explicit Page(const QSize &size)
+        : texture(std::make_unique<GLTexture>(GL_RGBA8, size))
+        , packer(size)
+    {
+        texture->setFilter(GL_LINEAR);
+        texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    }
+
+    void clear(const QRect &rect)
+    {
+        const std::vector<uint32_t> pixels(rect.width() * rect.height(), 0);
+        texture->bind();
+        if (!GLPlatform::instance()->isGLES()) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, pixels.data());
+        } else {
+            const GLenum format = GLTexturePrivate::s_supportsARGB32 ? GL_BGRA_EXT : GL_RGBA;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            format, GL_UNSIGNED_BYTE, pixels.data());
+        }
+        texture->unbind();
+    }
+
+    std::unique_ptr<GLTexture> texture;
+    SkylinePacker packer;
+};
+
+class GLTextureAtlasEntryPrivate : public GLTexturePrivate
+{
+public:
+    GLTextureAtlasEntryPrivate(const std::shared_ptr<GLTextureAtlas::Page> &page, const QRect &allocation)
+        : m_page(page)
+        , m_allocation(allocation)
+    {
+        const QRect rect = allocation.adjusted(1, 1, -1, -1);
+        m_texture = page->texture->texture();
+        m_target = GL_TEXTURE_2D;
+        m_internalFormat = page->texture->internalFormat();
+        m_filter = GL_LINEAR;
+        m_wrapMode = GL_CLAMP_TO_EDGE;
+        m_wrapModeChanged = true;
+        m_yInverted = true;
+        m_size = rect.size();
+        m_scale = QSizeF(1.0 / rect.width(), 1.0 / rect.height());
+        m_atlasOffset = rect.topLeft();
+        m_atlasSize = page->packer.size();
+        updateMatrix();
+    }
+
+    ~GLTextureAtlasEntryPrivate() override
+    {
+        // the texture belongs to the page
+        m_texture = 0;
+        m_page->packer.release(m_allocation);
+    }
+
+private:
+    std::shared_ptr<GLTextureAtlas::Page> m_page;
+    QRect m_allocation;
+};
+
+class GLTextureAtlasEntry : public GLTexture
+{
+public:
+    explicit GLTextureAtlasEntry(GLTextureAtlasEntryPrivate &dd)
+        : GLTexture(dd)
+    {
+    }
+};
+
+GLTextureAtlas::GLTextureAtlas()
+{
+}
+
+GLTextureAtlas::~GLTextureAtlas()
+{
+}
+
+GLTextureAtlas *GLTextureAtlas::instance()
+{
+    static const bool enabled = qEnvironmentVariable("KWIN_TEXTURE_ATLAS") != QLatin1String("0");
+    if (!enabled) {
+        return nullptr;
+    }
+    if (!s_atlas) {
+        s_atlas = std::make_unique<GLTextureAtlas>();
+    }
+    return s_atlas.get();
+}
+
+void GLTextureAtlas::cleanup()
+{
+    s_atlas.reset();
+}
+
+bool GLTextureAtlas::accepts(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBA8888_Premultiplied:
+        break;
+    default:
+        // without an alpha channel the padding bytes would end up as alpha
+        return false;
+    }
+    return !image.isNull() && image.width() <= s_maximumEntrySize && image.height() <= s_maximumEntrySize;
+}
+
+std::unique_ptr<GLTexture> GLTextureAtlas::upload(const QImage &image)
+{
+    if (!accepts(image)) {
+        return nullptr;
+    }
+
+    // leave room for a transparent border around the entry
+    const QSize allocationSize = image.size() + QSize(2, 2);
+    std::shared_ptr<Page> page;
+    QRect allocation;
+    for (const std::shared_ptr<Page> &candidate : m_pages) {
+        allocation = candidate->packer.allocate(allocationSize);
+        if (!allocation.isNull()) {
+            page = candidate;
+            break;
+        }
+    }
+    if (!page) {
+        if (int(m_pages.size()) >= s_maximumPageCount) {
+            return nullptr;
+        }
+        GLint maximumTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+        const int size = std::min(s_pageSize, int(maximumTextureSize));
+        page = std::make_shared<Page>(QSize(size, size));
+        m_pages.push_back(page);
+        allocation = page->packer.allocate(allocationSize);
+        if (allocation.isNull()) {
+            return nullptr;
+        }
+    }
+
+    // previous entries may have left their pixels behind
+    page->clear(allocation);
+
+    auto texture = std::make_unique<GLTextureAtlasEntry>(*new GLTextureAtlasEntryPrivate(page, allocation));
+    texture->update(image);
+    return texture;
+}
+
+int GLTextureAtlas::pageCount() const
+{
+    return m_pages.size();
+}
+
+int GLTextureAtlas::entryCount() const
+{
+    return std::accumulate(m_pages.cbegin(), m_pages.cend(), 0, [](int count, const std::shared_ptr<Page> &page) {
+        return count + page->packer.allocationCount();
+    });
+}
+
+} // namespace KWin
@@ -0,0 +1,80 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglutils_export.h>
+
+#include <QSize>
+
+#include <memory>
+#include <vector>
+
+class QImage;
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The GLTextureAtlas class packs small images into a few large textures.
+ *
+ * Every texture costs a bind and a draw call of its own, so the scene puts small surfaces
+ * and shadows in an atlas. Consecutive render nodes that sample the same atlas can be drawn
+ * at once.
+ *
+ * The textures that upload() returns behave like normal textures, their matrix maps to their
+ * area in the atlas and updates only touch that area. They are meant to be rendered through
+ * the texture matrix, GLTexture::render() and GLTexture::toImage() see the entire atlas. Each
+ * entry is surrounded by a transparent pixel so linear filtering doesn't pick up neighbours.
+ *
+ * The atlas can be disabled by setting the KWIN_TEXTURE_ATLAS environment variable to 0.
+ */
+class KWINGLUTILS_EXPORT GLTextureAtlas
+{
+public:
+    GLTextureAtlas();
+    ~GLTextureAtlas();
+
+    /**
+     * Returns the atlas of the current OpenGL context, or @c nullptr if it's disabled.
+     */
+    static GLTextureAtlas *instance();
+
+    /**
+     * Returns whether the @a image can be put in the atlas. It has to be small and have an
+     * alpha channel with 8 bits per channel, as the atlas holds premultiplied RGBA data.
+     */
+    static bool accepts(const QImage &image);
+
+    /**
+     * Uploads @a image into the atlas. Returns @c nullptr if the image is too big or the atlas
+     * is full, the caller should create a texture of its own then.
+     */
+    std::unique_ptr<GLTexture> upload(const QImage &image);
+
+    int pageCount() const;
+    /**
+     * Returns how many entries are in the atlas.
+     */
+    int entryCount() const;
+
+    /**
+     * Destroys the atlas of the current OpenGL context, textures that are still alive keep
+     * their page alive. @internal
+     */
+    static void cleanup();
+
+private:
+    struct Page;
+    friend class GLTextureAtlasEntryPrivate;
+
+    std::vector<std::shared_ptr<Page>> m_pages;
+};
+
+} // namespace KWin
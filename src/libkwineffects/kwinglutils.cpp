@@ -15,13 +15,19 @@
 
 #include "kwineffects.h"
 #include "kwinglplatform.h"
+#include "kwingltextureatlas.h"
 #include "logging_p.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
 #include <QFile>
 #include <QHash>
 #include <QImage>
 #include <QMatrix4x4>
 #include <QPixmap>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QVarLengthArray>
 #include <QVector2D>
 #include <QVector3D>
@@ -154,14 +160,19 @@ void initGL(const std::function<resolveFuncPtr(const char *)> &resolveFunction)
     GLTexturePrivate::initStatic();
     GLFramebuffer::initStatic();
     GLVertexBuffer::initStatic();
+    GLRenderTimeQuery::initStatic();
+    GLState::invalidate();
 }
 
 void cleanupGL()
 {
+    GLState::invalidate();
     ShaderManager::cleanup();
+    GLTextureAtlas::cleanup();
     GLTexturePrivate::cleanup();
     GLFramebuffer::cleanup();
     GLVertexBuffer::cleanup();
+    GLRenderTimeQuery::cleanup();
     GLPlatform::cleanup();
 
     glExtensions.clear();
@@ -182,6 +193,241 @@ QList<QByteArray> openGLExtensions()
     return glExtensions;
 }
 
+//****************************************
+// GLState
+//****************************************
+
+namespace
+{
+
+struct CachedGLState
+{
+    static constexpr int textureUnitCount = 16;
+    static constexpr int textureTargetCount = 3;
+
+    // zero is a valid name for all of them, the state is unknown until set the first time
+    std::optional<GLenum> activeTexture;
+    std::array<std::array<std::optional<GLuint>, textureTargetCount>, textureUnitCount> textures;
+    std::optional<GLuint> program;
+    std::optional<GLuint> drawFramebuffer;
+    std::optional<GLuint> readFramebuffer;
+    std::optional<QRect> viewport;
+    std::optional<bool> blend;
+    std::optional<std::pair<GLenum, GLenum>> blendFunc;
+    std::optional<bool> scissor;
+};
+
+}
+
+static CachedGLState s_glState;
+static quint64 s_issuedGLCalls = 0;
+static quint64 s_skippedGLCalls = 0;
+
+static bool isGLStateCacheEnabled()
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_GL_NO_STATE_CACHE");
+    return !disabled;
+}
+
+// Returns whether the change has to be issued, and remembers the new value.
+template<typename T>
+static bool updateGLState(std::optional<T> &cached, const T &value)
+{
+    if (cached == value && isGLStateCacheEnabled()) {
+        ++s_skippedGLCalls;
+        return false;
+    }
+    cached = value;
+    ++s_issuedGLCalls;
+    return true;
+}
+
+static std::optional<GLuint> *cachedTextureBinding(GLenum target)
+{
+    if (!s_glState.activeTexture) {
+        return nullptr;
+    }
+    const int unit = *s_glState.activeTexture - GL_TEXTURE0;
+    if (unit < 0 || unit >= CachedGLState::textureUnitCount) {
+        return nullptr;
+    }
+    switch (target) {
+    case GL_TEXTURE_2D:
+        return &s_glState.textures[unit][0];
+    case GL_TEXTURE_EXTERNAL_OES:
+        return &s_glState.textures[unit][1];
+    case GL_TEXTURE_RECTANGLE:
+        return &s_glState.textures[unit][2];
+    default:
+        return nullptr;
+    }
+}
+
+void GLState::activeTexture(GLenum unit)
+{
+    if (updateGLState(s_glState.activeTexture, unit)) {
+        glActiveTexture(unit);
+    }
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    // the active unit is only known once it has been set, the first frame finds it out
+    if (!s_glState.activeTexture) {
+        activeTexture(GL_TEXTURE0);
+    }
+    std::optional<GLuint> *cached = cachedTextureBinding(target);
+    if (!cached) {
+        ++s_issuedGLCalls;
+        glBindTexture(target, texture);
+    } else if (updateGLState(*cached, texture)) {
+        glBindTexture(target, texture);
+    }
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (updateGLState(s_glState.program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    switch (target) {
+    case GL_FRAMEBUFFER:
+        if (s_glState.drawFramebuffer == framebuffer && s_glState.readFramebuffer == framebuffer && isGLStateCacheEnabled()) {
+            ++s_skippedGLCalls;
+        } else {
+            s_glState.drawFramebuffer = s_glState.readFramebuffer = framebuffer;
+            ++s_issuedGLCalls;
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+        break;
+    case GL_DRAW_FRAMEBUFFER:
+        if (updateGLState(s_glState.drawFramebuffer, framebuffer)) {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        }
+        break;
+    case GL_READ_FRAMEBUFFER:
+        if (updateGLState(s_glState.readFramebuffer, framebuffer)) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        }
+        break;
+    default:
+        ++s_issuedGLCalls;
+        glBindFramebuffer(target, framebuffer);
+        break;
+    }
+}
+
+static GLuint queryFramebufferBinding(std::optional<GLuint> &cached, GLenum binding)
+{
+    if (!cached || !isGLStateCacheEnabled()) {
+        GLint framebuffer = 0;
+        glGetIntegerv(binding, &framebuffer);
+        cached = framebuffer;
+    }
+    return *cached;
+}
+
+GLuint GLState::drawFramebuffer()
+{
+    return queryFramebufferBinding(s_glState.drawFramebuffer, GL_DRAW_FRAMEBUFFER_BINDING);
+}
+
+GLuint GLState::readFramebuffer()
+{
+    return queryFramebufferBinding(s_glState.readFramebuffer, GL_READ_FRAMEBUFFER_BINDING);
+}
+
+void GLState::setViewport(const QRect &viewport)
+{
+    if (updateGLState(s_glState.viewport, viewport)) {
+        glViewport(viewport.x(), viewport.y(), viewport.width(), viewport.height());
+    }
+}
+
+void GLState::setBlendEnabled(bool enabled)
+{
+    if (updateGLState(s_glState.blend, enabled)) {
+        if (enabled) {
+            glEnable(GL_BLEND);
+        } else {
+            glDisable(GL_BLEND);
+        }
+    }
+}
+
+void GLState::setBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    if (updateGLState(s_glState.blendFunc, std::make_pair(sourceFactor, destinationFactor))) {
+        glBlendFunc(sourceFactor, destinationFactor);
+    }
+}
+
+void GLState::setScissorEnabled(bool enabled)
+{
+    if (updateGLState(s_glState.scissor, enabled)) {
+        if (enabled) {
+            glEnable(GL_SCISSOR_TEST);
+        } else {
+            glDisable(GL_SCISSOR_TEST);
+        }
+    }
+}
+
+void GLState::forgetTexture(GLuint texture)
+{
+    // deleting a bound texture binds zero instead
+    for (auto &unit : s_glState.textures) {
+        for (std::optional<GLuint> &binding : unit) {
+            if (binding == texture) {
+                binding = 0;
+            }
+        }
+    }
+}
+
+void GLState::forgetProgram(GLuint program)
+{
+    // a deleted program stays in use until another one is used, its name isn't reused before
+    if (s_glState.program == program) {
+        s_glState.program.reset();
+    }
+}
+
+void GLState::forgetFramebuffer(GLuint framebuffer)
+{
+    if (s_glState.drawFramebuffer == framebuffer) {
+        s_glState.drawFramebuffer = 0;
+    }
+    if (s_glState.readFramebuffer == framebuffer) {
+        s_glState.readFramebuffer = 0;
+    }
+}
+
+void GLState::invalidate()
+{
+    s_glState = CachedGLState();
+}
+
+quint64 GLState::issuedCalls()
+{
+    return s_issuedGLCalls;
+}
+
+quint64 GLState::skippedCalls()
+{
+    return s_skippedGLCalls;
+}
+
+void GLState::resetStatistics()
+{
+    s_issuedGLCalls = 0;
+    s_skippedGLCalls = 0;
+}
+
 static QString formatGLError(GLenum err)
 {
     switch (err) {
@@ -248,6 +494,7 @@ GLShader::GLShader(const QString &vertexfile, const QString &fragmentfile, unsig
 GLShader::~GLShader()
 {
     if (mProgram) {
+        GLState::forgetProgram(mProgram);
         glDeleteProgram(mProgram);
     }
 }
@@ -408,12 +655,12 @@ void GLShader::bindFragDataLocation(const char *name, int index)
 
 void GLShader::bind()
 {
-    glUseProgram(mProgram);
+    GLState::useProgram(mProgram);
 }
 
 void GLShader::unbind()
 {
-    glUseProgram(0);
+    GLState::useProgram(0);
 }
 
 void GLShader::resolveLocations()
@@ -621,6 +868,119 @@ QMatrix4x4 GLShader::getUniformMatrix4x4(const char *name)
     }
 }
 
+//****************************************
+// ShaderProgramCache
+//****************************************
+
+/**
+ * The ShaderProgramCache keeps the binaries of linked shader programs on disk, so they
+ * don't have to be compiled and linked again the next time they are needed. The binaries
+ * are only valid for the driver that has produced them, so the driver is part of the key.
+ */
+class ShaderProgramCache
+{
+public:
+    ShaderProgramCache();
+
+    static bool isSupported();
+
+    QByteArray key(const QByteArray &bindings, const QByteArray &vertexSource, const QByteArray &fragmentSource) const;
+    bool load(const QByteArray &key, GLenum *format, QByteArray *binary) const;
+    void store(const QByteArray &key, GLenum format, const QByteArray &binary) const;
+    void remove(const QByteArray &key) const;
+
+private:
+    QString filePath(const QByteArray &key) const;
+
+    QString m_directory;
+    QByteArray m_driver;
+};
+
+ShaderProgramCache::ShaderProgramCache()
+    : m_directory(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/kwin/shaders"))
+{
+    const GLPlatform *platform = GLPlatform::instance();
+    m_driver = platform->glVendorString() + '\n'
+        + platform->glRendererString() + '\n'
+        + platform->glVersionString() + '\n'
+        + platform->glShadingLanguageVersionString() + '\n';
+
+    QDir().mkpath(m_directory);
+}
+
+bool ShaderProgramCache::isSupported()
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_GL_NO_PROGRAM_CACHE");
+    if (disabled) {
+        return false;
+    }
+
+    if (GLPlatform::instance()->isGLES()) {
+        if (!hasGLVersion(3, 0)) {
+            return false;
+        }
+    } else if (!hasGLVersion(4, 1) && !hasGLExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+        return false;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+QByteArray ShaderProgramCache::key(const QByteArray &bindings, const QByteArray &vertexSource, const QByteArray &fragmentSource) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(m_driver);
+    hash.addData(bindings);
+    hash.addData(vertexSource);
+    hash.addData(QByteArrayLiteral("\n\n"));
+    hash.addData(fragmentSource);
+    return hash.result().toHex();
+}
+
+QString ShaderProgramCache::filePath(const QByteArray &key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key);
+}
+
+bool ShaderProgramCache::load(const QByteArray &key, GLenum *format, QByteArray *binary) const
+{
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 binaryFormat;
+    stream >> binaryFormat >> *binary;
+    if (stream.status() != QDataStream::Ok || binary->isEmpty()) {
+        return false;
+    }
+
+    *format = binaryFormat;
+    return true;
+}
+
+void ShaderProgramCache::store(const QByteArray &key, GLenum format, const QByteArray &binary) const
+{
+    QSaveFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << quint32(format) << binary;
+    if (!file.commit()) {
+        qCDebug(LIBKWINGLUTILS) << "Failed to store the shader program binary in" << file.fileName();
+    }
+}
+
+void ShaderProgramCache::remove(const QByteArray &key) const
+{
+    QFile::remove(filePath(key));
+}
+
 //****************************************
 // ShaderManager
 //****************************************
@@ -642,6 +1002,9 @@ void ShaderManager::cleanup()
 
 ShaderManager::ShaderManager()
 {
+    if (ShaderProgramCache::isSupported()) {
+        m_programCache = std::make_unique<ShaderProgramCache>();
+    }
 }
 
 ShaderManager::~ShaderManager()
@@ -651,6 +1014,16 @@ ShaderManager::~ShaderManager()
     }
 }
 
+// Must match the layout of the entries written by GLNodeBuffer.
+static const char s_nodeDataBlock[] =
+    "layout(std140) uniform NodeData {\n"
+    "    mat4 modelViewProjectionMatrix;\n"
+    "    vec4 modulation;\n"
+    "    float saturation;\n"
+    "};\n\n";
+
+static const GLuint s_nodeDataBinding = 0;
+
 QByteArray ShaderManager::generateVertexSource(ShaderTraits traits) const
 {
     QByteArray source;
@@ -687,7 +1060,11 @@ QByteArray ShaderManager::generateVertexSource(ShaderTraits traits) const
         stream << "\n";
     }
 
-    stream << "uniform mat4 modelViewProjectionMatrix;\n\n";
+    if (traits & ShaderTrait::NodeBuffer) {
+        stream << s_nodeDataBlock;
+    } else {
+        stream << "uniform mat4 modelViewProjectionMatrix;\n\n";
+    }
 
     stream << "void main()\n{\n";
     if (traits & ShaderTrait::MapTexture) {
@@ -736,14 +1113,20 @@ QByteArray ShaderManager::generateFragmentSource(ShaderTraits traits) const
         output = glsl_es_300 ? QByteArrayLiteral("fragColor") : QByteArrayLiteral("gl_FragColor");
     }
 
+    if (traits & ShaderTrait::NodeBuffer) {
+        stream << s_nodeDataBlock;
+    }
+
     if (traits & ShaderTrait::MapTexture) {
         stream << "uniform sampler2D sampler;\n";
 
-        if (traits & ShaderTrait::Modulate) {
-            stream << "uniform vec4 modulation;\n";
-        }
-        if (traits & ShaderTrait::AdjustSaturation) {
-            stream << "uniform float saturation;\n";
+        if (!(traits & ShaderTrait::NodeBuffer)) {
+            if (traits & ShaderTrait::Modulate) {
+                stream << "uniform vec4 modulation;\n";
+            }
+            if (traits & ShaderTrait::AdjustSaturation) {
+                stream << "uniform float saturation;\n";
+            }
         }
 
         stream << "\n"
@@ -802,13 +1185,24 @@ std::unique_ptr<GLShader> ShaderManager::generateCustomShader(ShaderTraits trait
 #endif
 
     std::unique_ptr<GLShader> shader{new GLShader(GLShader::ExplicitLinking)};
-    shader->load(vertex, fragment);
+    const QByteArray key = programCacheKey(QByteArrayLiteral("position,texcoord"), vertex, fragment);
+    if (!loadProgramBinary(shader.get(), key)) {
+        shader->load(vertex, fragment);
 
-    shader->bindAttributeLocation("position", VA_Position);
-    shader->bindAttributeLocation("texcoord", VA_TexCoord);
-    shader->bindFragDataLocation("fragColor", 0);
+        shader->bindAttributeLocation("position", VA_Position);
+        shader->bindAttributeLocation("texcoord", VA_TexCoord);
+        shader->bindFragDataLocation("fragColor", 0);
 
-    shader->link();
+        shader->link();
+        storeProgramBinary(shader.get(), key);
+    }
+
+    if ((traits & ShaderTrait::NodeBuffer) && shader->isValid()) {
+        const GLuint blockIndex = glGetUniformBlockIndex(shader->mProgram, "NodeData");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader->mProgram, blockIndex, s_nodeDataBinding);
+        }
+    }
     return shader;
 }
 
@@ -930,13 +1324,165 @@ void ShaderManager::bindAttributeLocations(GLShader *shader) const
 std::unique_ptr<GLShader> ShaderManager::loadShaderFromCode(const QByteArray &vertexSource, const QByteArray &fragmentSource)
 {
     std::unique_ptr<GLShader> shader{new GLShader(GLShader::ExplicitLinking)};
+    const QByteArray key = programCacheKey(QByteArrayLiteral("vertex,texCoord"), vertexSource, fragmentSource);
+    if (loadProgramBinary(shader.get(), key)) {
+        return shader;
+    }
+
     shader->load(vertexSource, fragmentSource);
     bindAttributeLocations(shader.get());
     bindFragDataLocations(shader.get());
     shader->link();
+    storeProgramBinary(shader.get(), key);
     return shader;
 }
 
+void ShaderManager::warmUp()
+{
+    const ShaderTraits commonTraits[] = {
+        ShaderTrait::MapTexture,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation,
+        ShaderTrait::UniformColor,
+    };
+    // The scene reads the state of its draws from a node buffer when it can.
+    const ShaderTraits sceneTraits = GLNodeBuffer::supported() ? ShaderTraits(ShaderTrait::NodeBuffer) : ShaderTraits();
+    for (const ShaderTraits &traits : commonTraits) {
+        shader(traits | ((traits & ShaderTrait::MapTexture) ? sceneTraits : ShaderTraits()));
+    }
+}
+
+QByteArray ShaderManager::programCacheKey(const QByteArray &bindings, const QByteArray &vertexSource, const QByteArray &fragmentSource) const
+{
+    if (!m_programCache) {
+        return QByteArray();
+    }
+    return m_programCache->key(bindings, vertexSource, fragmentSource);
+}
+
+bool ShaderManager::loadProgramBinary(GLShader *shader, const QByteArray &key)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    GLenum format;
+    QByteArray binary;
+    if (!m_programCache->load(key, &format, &binary)) {
+        // The binary has to be requested before the program is linked.
+        glProgramParameteri(shader->mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        return false;
+    }
+
+    glProgramBinary(shader->mProgram, format, binary.constData(), binary.size());
+
+    // The driver may reject binaries of an older version of itself, build the program then.
+    int status;
+    glGetProgramiv(shader->mProgram, GL_LINK_STATUS, &status);
+    if (status == 0) {
+        m_programCache->remove(key);
+        glProgramParameteri(shader->mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        return false;
+    }
+
+    shader->mValid = true;
+    return true;
+}
+
+void ShaderManager::storeProgramBinary(GLShader *shader, const QByteArray &key)
+{
+    if (key.isEmpty() || !shader->isValid()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(shader->mProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray binary(length, 0);
+    GLenum format;
+    glGetProgramBinary(shader->mProgram, length, nullptr, &format, binary.data());
+    m_programCache->store(key, format, binary);
+}
+
+//****************************************
+// GLNodeBuffer
+//****************************************
+
+// The std140 layout of the NodeData block, the block is padded to a multiple of a vec4.
+struct NodeData
+{
+    float modelViewProjectionMatrix[16];
+    float modulation[4];
+    float saturation;
+    float padding[3];
+};
+
+GLNodeBuffer::GLNodeBuffer()
+{
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_stride = (sizeof(NodeData) + alignment - 1) / alignment * alignment;
+    glGenBuffers(1, &m_buffer);
+}
+
+GLNodeBuffer::~GLNodeBuffer()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+bool GLNodeBuffer::supported()
+{
+    const GLPlatform *platform = GLPlatform::instance();
+    if (platform->isGLES()) {
+        return platform->glslVersion() >= kVersionNumber(3, 0);
+    }
+    return platform->glslVersion() >= kVersionNumber(1, 40)
+        && (hasGLVersion(3, 1) || hasGLExtension(QByteArrayLiteral("GL_ARB_uniform_buffer_object")));
+}
+
+void GLNodeBuffer::reset()
+{
+    m_count = 0;
+}
+
+int GLNodeBuffer::append(const QMatrix4x4 &modelViewProjectionMatrix, const QVector4D &modulation, float saturation)
+{
+    const int offset = m_count * m_stride;
+    if (m_data.size() < offset + m_stride) {
+        m_data.resize(std::max(offset + m_stride, m_data.size() * 2));
+    }
+
+    NodeData *data = reinterpret_cast<NodeData *>(m_data.data() + offset);
+    std::copy_n(modelViewProjectionMatrix.constData(), 16, data->modelViewProjectionMatrix);
+    data->modulation[0] = modulation.x();
+    data->modulation[1] = modulation.y();
+    data->modulation[2] = modulation.z();
+    data->modulation[3] = modulation.w();
+    data->saturation = saturation;
+
+    return m_count++;
+}
+
+void GLNodeBuffer::upload()
+{
+    if (!m_count) {
+        return;
+    }
+
+    // Orphan the previous contents, they may still be used by draws in flight.
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_count * m_stride, m_data.constData(), GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void GLNodeBuffer::bind(int index)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, s_nodeDataBinding, m_buffer, index * m_stride, sizeof(NodeData));
+}
+
 /***  GLFramebuffer  ***/
 bool GLFramebuffer::sSupported = false;
 bool GLFramebuffer::s_blitSupported = false;
@@ -1019,6 +1565,7 @@ GLFramebuffer::GLFramebuffer(GLuint handle, const QSize &size)
 GLFramebuffer::~GLFramebuffer()
 {
     if (!mForeign && mValid) {
+        GLState::forgetFramebuffer(mFramebuffer);
         glDeleteFramebuffers(1, &mFramebuffer);
     }
 }
@@ -1030,8 +1577,8 @@ bool GLFramebuffer::bind()
         return false;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, handle());
-    glViewport(0, 0, mSize.width(), mSize.height());
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, handle());
+    GLState::setViewport(QRect(QPoint(0, 0), mSize));
 
     return true;
 }
@@ -1090,7 +1637,7 @@ void GLFramebuffer::initFBO(GLTexture *colorAttachment)
     }
 #endif
 
-    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
 
 #if DEBUG_GLFRAMEBUFFER
     if ((err = glGetError()) != GL_NO_ERROR) {
@@ -1106,7 +1653,8 @@ void GLFramebuffer::initFBO(GLTexture *colorAttachment)
 #if DEBUG_GLFRAMEBUFFER
     if ((err = glGetError()) != GL_NO_ERROR) {
         qCCritical(LIBKWINGLUTILS) << "glFramebufferTexture2D failed: " << formatGLError(err);
-        glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+        GLState::forgetFramebuffer(mFramebuffer);
         glDeleteFramebuffers(1, &mFramebuffer);
         return;
     }
@@ -1114,7 +1662,7 @@ void GLFramebuffer::initFBO(GLTexture *colorAttachment)
 
     const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, prevFbo);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, prevFbo);
 
     if (status != GL_FRAMEBUFFER_COMPLETE) {
         // We have an incomplete framebuffer, consider it invalid
@@ -1123,6 +1671,7 @@ void GLFramebuffer::initFBO(GLTexture *colorAttachment)
         } else {
             qCCritical(LIBKWINGLUTILS) << "Invalid framebuffer status: " << formatFramebufferStatus(status);
         }
+        GLState::forgetFramebuffer(mFramebuffer);
         glDeleteFramebuffers(1, &mFramebuffer);
         return;
     }
@@ -1139,8 +1688,8 @@ void GLFramebuffer::blitFromFramebuffer(const QRect &source, const QRect &destin
     const GLFramebuffer *top = currentFramebuffer();
     GLFramebuffer::pushFramebuffer(this);
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, handle());
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, top->handle());
+    GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, handle());
+    GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, top->handle());
 
     const QRect s = source.isNull() ? QRect(QPoint(0, 0), top->size()) : source;
     const QRect d = destination.isNull() ? QRect(QPoint(0, 0), size()) : destination;
@@ -1584,6 +2133,7 @@ public:
     GLVertexBufferPrivate(GLVertexBuffer::UsageHint usageHint)
         : vertexCount(0)
         , persistent(false)
+        , fenced(false)
         , useColor(false)
         , color(0, 0, 0, 255)
         , bufferSize(0)
@@ -1624,9 +2174,9 @@ public:
     void unbindArrays();
     void reallocateBuffer(size_t size);
     GLvoid *mapNextFreeRange(size_t size);
-    void reallocatePersistentBuffer(size_t size);
+    void reallocateRingBuffer(size_t size);
     bool awaitFence(intptr_t offset);
-    GLvoid *getIdleRange(size_t size);
+    intptr_t getIdleRange(size_t size);
 
     GLuint buffer;
     GLenum usage;
@@ -1639,6 +2189,9 @@ public:
     static bool supportsIndexedQuads;
     QByteArray dataStore;
     bool persistent;
+    // whether the buffer is used as a ring, whose ranges are only reused once a fence says
+    // the GPU is done with them
+    bool fenced;
     bool useColor;
     QVector4D color;
     size_t bufferSize;
@@ -1729,7 +2282,7 @@ void GLVertexBufferPrivate::unbindArrays()
     }
 }
 
-void GLVertexBufferPrivate::reallocatePersistentBuffer(size_t size)
+void GLVertexBufferPrivate::reallocateRingBuffer(size_t size)
 {
     if (buffer != 0) {
         // This also unmaps and unbinds the buffer
@@ -1747,13 +2300,18 @@ void GLVertexBufferPrivate::reallocatePersistentBuffer(size_t size)
     size_t minSize = qMax<size_t>(frameSizes.average() * 3, 128 * 1024);
     bufferSize = qMax(size, minSize);
 
-    const GLbitfield storage = GL_DYNAMIC_STORAGE_BIT;
-    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
-
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, storage | access);
+    if (persistent) {
+        const GLbitfield storage = GL_DYNAMIC_STORAGE_BIT;
+        const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
 
-    map = (uint8_t *)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, access);
+        glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, storage | access);
+        map = (uint8_t *)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, access);
+    } else {
+        // Without immutable storage the ranges are mapped one by one in map()
+        glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, usage);
+        map = nullptr;
+    }
 
     nextOffset = 0;
     bufferEnd = bufferSize;
@@ -1791,10 +2349,10 @@ bool GLVertexBufferPrivate::awaitFence(intptr_t end)
     return true;
 }
 
-GLvoid *GLVertexBufferPrivate::getIdleRange(size_t size)
+intptr_t GLVertexBufferPrivate::getIdleRange(size_t size)
 {
     if (unlikely(size > bufferSize)) {
-        reallocatePersistentBuffer(size * 2);
+        reallocateRingBuffer(size * 2);
     }
 
     // Handle wrap-around
@@ -1816,11 +2374,11 @@ GLvoid *GLVertexBufferPrivate::getIdleRange(size_t size)
 
     if (unlikely(nextOffset + intptr_t(size) > bufferEnd)) {
         if (!awaitFence(nextOffset + size)) {
-            return nullptr;
+            return -1;
         }
     }
 
-    return map + nextOffset;
+    return nextOffset;
 }
 
 void GLVertexBufferPrivate::reallocateBuffer(size_t size)
@@ -1896,8 +2454,18 @@ GLvoid *GLVertexBuffer::map(size_t size)
     d->mappedSize = size;
     d->frameSize += size;
 
-    if (d->persistent) {
-        return d->getIdleRange(size);
+    if (d->fenced) {
+        const intptr_t offset = d->getIdleRange(size);
+        if (offset < 0) {
+            return nullptr;
+        }
+        if (d->persistent) {
+            return d->map + offset;
+        }
+        // The fences guarantee that the GPU doesn't read the range anymore, so the driver
+        // doesn't have to synchronize or orphan the buffer
+        glBindBuffer(GL_ARRAY_BUFFER, d->buffer);
+        return glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, d->buffer);
@@ -1920,7 +2488,10 @@ GLvoid *GLVertexBuffer::map(size_t size)
 
 void GLVertexBuffer::unmap()
 {
-    if (d->persistent) {
+    if (d->fenced) {
+        if (!d->persistent) {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
         d->baseAddress = d->nextOffset;
         d->nextOffset += align(d->mappedSize, 8);
         d->mappedSize = 0;
@@ -2082,7 +2653,7 @@ void GLVertexBuffer::reset()
 
 void GLVertexBuffer::endOfFrame()
 {
-    if (!d->persistent) {
+    if (!d->fenced) {
         return;
     }
 
@@ -2114,7 +2685,7 @@ void GLVertexBuffer::endOfFrame()
 
 void GLVertexBuffer::beginFrame()
 {
-    if (!d->persistent) {
+    if (!d->fenced) {
         return;
     }
 
@@ -2152,9 +2723,15 @@ void GLVertexBuffer::initStatic()
     GLVertexBufferPrivate::s_indexBuffer = nullptr;
     GLVertexBufferPrivate::streamingBuffer = new GLVertexBuffer(GLVertexBuffer::Stream);
 
-    if (GLVertexBufferPrivate::haveBufferStorage && GLVertexBufferPrivate::haveSyncFences) {
-        if (qgetenv("KWIN_PERSISTENT_VBO") != QByteArrayLiteral("0")) {
-            GLVertexBufferPrivate::streamingBuffer->d->persistent = true;
+    // The streaming buffer is used as a ring guarded by fences, persistently mapped if the
+    // storage can be made immutable. GLES 2 has no fences and keeps mapping or uploading.
+    if (GLVertexBufferPrivate::haveSyncFences && qgetenv("KWIN_PERSISTENT_VBO") != QByteArrayLiteral("0")) {
+        GLVertexBufferPrivate *d = GLVertexBufferPrivate::streamingBuffer->d;
+        if (GLVertexBufferPrivate::haveBufferStorage) {
+            d->persistent = true;
+            d->fenced = true;
+        } else if (GLVertexBufferPrivate::hasMapBufferRange && !GLPlatform::instance()->preferBufferSubData()) {
+            d->fenced = true;
         }
     }
 }
@@ -2174,4 +2751,105 @@ GLVertexBuffer *GLVertexBuffer::streamingBuffer()
     return GLVertexBufferPrivate::streamingBuffer;
 }
 
+//*********************************
+// GLRenderTimeQuery
+//*********************************
+
+bool GLRenderTimeQuery::s_supported = false;
+
+void GLRenderTimeQuery::initStatic()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        s_supported = hasGLExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"));
+    } else {
+        s_supported = hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query"));
+    }
+}
+
+void GLRenderTimeQuery::cleanup()
+{
+    s_supported = false;
+}
+
+bool GLRenderTimeQuery::supported()
+{
+    return s_supported;
+}
+
+GLRenderTimeQuery::GLRenderTimeQuery()
+{
+    if (s_supported) {
+        glGenQueries(1, &m_query);
+    }
+}
+
+GLRenderTimeQuery::~GLRenderTimeQuery()
+{
+    if (m_query) {
+        glDeleteQueries(1, &m_query);
+    }
+}
+
+void GLRenderTimeQuery::begin()
+{
+    if (!m_query) {
+        return;
+    }
+    // If the previous result hasn't been fetched by now, drop it.
+    m_pending = false;
+    glGetInteger64v(GL_TIMESTAMP, &m_beginTimestamp);
+    m_cpuBeginTimestamp = std::chrono::steady_clock::now().time_since_epoch();
+}
+
+void GLRenderTimeQuery::end()
+{
+    if (!m_query) {
+        return;
+    }
+    glQueryCounter(m_query, GL_TIMESTAMP);
+    m_pending = true;
+}
+
+std::chrono::nanoseconds GLRenderTimeQuery::beginTimestamp() const
+{
+    return m_cpuBeginTimestamp;
+}
+
+bool GLRenderTimeQuery::isPending() const
+{
+    return m_pending;
+}
+
+std::optional<std::chrono::nanoseconds> GLRenderTimeQuery::result()
+{
+    if (!m_pending) {
+        return std::nullopt;
+    }
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return std::nullopt;
+    }
+
+    GLuint64 endTimestamp = 0;
+    glGetQueryObjectui64v(m_query, GL_QUERY_RESULT, &endTimestamp);
+    m_pending = false;
+
+    if (GLPlatform::instance()->isGLES()) {
+        // The timer values are undefined if a disjoint operation has happened, e.g. the
+        // GPU changed its frequency. The flag is reset when it's queried.
+        GLint disjoint = GL_FALSE;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            return std::nullopt;
+        }
+    }
+
+    if (endTimestamp < GLuint64(m_beginTimestamp)) {
+        return std::nullopt;
+    }
+    return std::chrono::nanoseconds(endTimestamp - m_beginTimestamp);
+}
+
 } // namespace
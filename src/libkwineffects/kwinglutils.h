@@ -17,9 +17,14 @@
 #include <kwinglutils_export.h>
 
 // Qt
+#include <QRect>
 #include <QSize>
 #include <QStack>
 
+// std
+#include <chrono>
+#include <optional>
+
 /** @addtogroup kwineffects */
 /** @{ */
 
@@ -54,6 +59,63 @@ bool KWINGLUTILS_EXPORT checkGLError(const char *txt);
 
 QList<QByteArray> KWINGLUTILS_EXPORT openGLExtensions();
 
+/**
+ * The GLState class remembers the state of the current OpenGL context, so that changes that
+ * wouldn't change anything aren't passed on to the driver. The texture bindings per unit, the
+ * program, the framebuffers, the viewport, blending and the scissor test are tracked.
+ *
+ * Everything that renders with the compositor's context must change this state through
+ * GLState, or call invalidate() after having changed it directly. The cache is forgotten
+ * whenever the compositor makes its context current, and for each frame.
+ *
+ * The cache can be disabled with the KWIN_GL_NO_STATE_CACHE environment variable, in which case
+ * all the calls are passed on, but still counted.
+ *
+ * @since 5.27
+ */
+class KWINGLUTILS_EXPORT GLState
+{
+public:
+    static void activeTexture(GLenum unit);
+    /**
+     * Binds @a texture to @a target on the active texture unit.
+     */
+    static void bindTexture(GLenum target, GLuint texture);
+    static void useProgram(GLuint program);
+    /**
+     * Binds @a framebuffer, @a target is GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER.
+     */
+    static void bindFramebuffer(GLenum target, GLuint framebuffer);
+    static GLuint drawFramebuffer();
+    static GLuint readFramebuffer();
+    static void setViewport(const QRect &viewport);
+    static void setBlendEnabled(bool enabled);
+    static void setBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    static void setScissorEnabled(bool enabled);
+
+    /**
+     * Notifies that the objects are about to be deleted, their names may be reused afterwards.
+     */
+    static void forgetTexture(GLuint texture);
+    static void forgetProgram(GLuint program);
+    static void forgetFramebuffer(GLuint framebuffer);
+
+    /**
+     * Forgets the cached state, the next change of each kind is passed on to the driver.
+     */
+    static void invalidate();
+
+    /**
+     * Returns the number of state changes that have been passed on to the driver.
+     */
+    static quint64 issuedCalls();
+    /**
+     * Returns the number of state changes that have been skipped because they were redundant.
+     */
+    static quint64 skippedCalls();
+    static void resetStatistics();
+};
+
 class KWINGLUTILS_EXPORT GLShader
 {
 public:
@@ -176,6 +238,11 @@ enum class ShaderTrait {
     UniformColor = (1 << 1),
     Modulate = (1 << 2),
     AdjustSaturation = (1 << 3),
+    /**
+     * The per draw state is read from a GLNodeBuffer instead of plain uniforms.
+     * @see GLNodeBuffer
+     */
+    NodeBuffer = (1 << 4),
 };
 
 Q_DECLARE_FLAGS(ShaderTraits, ShaderTrait)
@@ -191,6 +258,8 @@ Q_DECLARE_FLAGS(ShaderTraits, ShaderTrait)
  * @author Martin Gräßlin <mgraesslin@kde.org>
  * @since 4.7
  */
+class ShaderProgramCache;
+
 class KWINGLUTILS_EXPORT ShaderManager
 {
 public:
@@ -282,6 +351,12 @@ public:
      */
     std::unique_ptr<GLShader> generateShaderFromFile(ShaderTraits traits, const QString &vertexFile = QString(), const QString &fragmentFile = QString());
 
+    /**
+     * Creates the shaders for the most commonly used traits in advance, so they aren't
+     * created while a frame is being painted.
+     */
+    void warmUp();
+
     /**
      * @return a pointer to the ShaderManager instance
      */
@@ -303,8 +378,13 @@ private:
     QByteArray generateFragmentSource(ShaderTraits traits) const;
     std::unique_ptr<GLShader> generateShader(ShaderTraits traits);
 
+    QByteArray programCacheKey(const QByteArray &bindings, const QByteArray &vertexSource, const QByteArray &fragmentSource) const;
+    bool loadProgramBinary(GLShader *shader, const QByteArray &key);
+    void storeProgramBinary(GLShader *shader, const QByteArray &key);
+
     QStack<GLShader *> m_boundShaders;
     std::map<ShaderTraits, std::unique_ptr<GLShader>> m_shaderHash;
+    std::unique_ptr<ShaderProgramCache> m_programCache;
     static ShaderManager *s_shaderManager;
 };
 
@@ -375,6 +455,52 @@ inline GLShader *ShaderBinder::shader()
     return m_shader;
 }
 
+/**
+ * @short Uniform buffer with the per draw state of shaders.
+ *
+ * The GLNodeBuffer collects the state of all draws of a render pass, i.e. the model view
+ * projection matrix, the modulation constant and the saturation, in one uniform buffer that
+ * is uploaded at once. Shaders created with ShaderTrait::NodeBuffer read their state from
+ * the std140 uniform block NodeData and a draw only has to select its entry with bind().
+ */
+class KWINGLUTILS_EXPORT GLNodeBuffer
+{
+public:
+    GLNodeBuffer();
+    ~GLNodeBuffer();
+
+    /**
+     * Returns @c true if uniform buffers can be used with the generated shaders.
+     */
+    static bool supported();
+
+    /**
+     * Removes all entries.
+     */
+    void reset();
+
+    /**
+     * Adds an entry and returns its index.
+     */
+    int append(const QMatrix4x4 &modelViewProjectionMatrix, const QVector4D &modulation, float saturation);
+
+    /**
+     * Uploads the entries to the GPU, must be called after all entries have been added.
+     */
+    void upload();
+
+    /**
+     * Makes the entry with the given @p index the state of the following draws.
+     */
+    void bind(int index);
+
+private:
+    GLuint m_buffer = 0;
+    int m_stride = 0;
+    int m_count = 0;
+    QByteArray m_data;
+};
+
 /**
  * @short OpenGL framebuffer object
  *
@@ -715,6 +841,75 @@ private:
     GLVertexBufferPrivate *const d;
 };
 
+/**
+ * @short GPU render time query
+ *
+ * The GLRenderTimeQuery class measures how long it takes the GPU to finish the rendering
+ * commands that have been submitted between begin() and end(). The measurement starts at the
+ * moment begin() is called, so the result also includes the time the commands spent waiting
+ * in the GPU queue, i.e. it's the time until the rendered frame is actually ready.
+ *
+ * The result is retrieved asynchronously without stalling the pipeline, typically while
+ * rendering one of the next frames.
+ *
+ * The query uses the GL_ARB_timer_query or GL_EXT_disjoint_timer_query extension. Use
+ * supported() to check whether it's available.
+ */
+class KWINGLUTILS_EXPORT GLRenderTimeQuery
+{
+public:
+    explicit GLRenderTimeQuery();
+    ~GLRenderTimeQuery();
+
+    /**
+     * Starts measuring the render time. This must be called before any rendering command.
+     */
+    void begin();
+    /**
+     * Finishes measuring the render time. This must be called after the last rendering command.
+     */
+    void end();
+
+    /**
+     * Returns the measured render time if the GPU has finished executing the commands between
+     * begin() and end(), otherwise returns an empty optional. A result is returned only once.
+     */
+    std::optional<std::chrono::nanoseconds> result();
+
+    /**
+     * Returns the time on the steady clock when begin() was called. Together with result(), it
+     * tells when the GPU finished the work on the CPU timeline.
+     */
+    std::chrono::nanoseconds beginTimestamp() const;
+
+    /**
+     * Returns @c true if the query has ended but its result hasn't been fetched yet.
+     */
+    bool isPending() const;
+
+    /**
+     * @internal
+     */
+    static void initStatic();
+
+    /**
+     * @internal
+     */
+    static void cleanup();
+
+    /**
+     * Returns @c true if GPU timer queries are supported by the OpenGL implementation.
+     */
+    static bool supported();
+
+private:
+    GLuint m_query = 0;
+    GLint64 m_beginTimestamp = 0;
+    std::chrono::nanoseconds m_cpuBeginTimestamp = std::chrono::nanoseconds::zero();
+    bool m_pending = false;
+    static bool s_supported;
+};
+
 } // namespace
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(KWin::ShaderTraits)
@@ -8,9 +8,124 @@
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 
+#include <deque>
+
 namespace KWin
 {
 
+struct OffscreenTarget
+{
+    std::unique_ptr<GLTexture> texture;
+    std::unique_ptr<GLFramebuffer> framebuffer;
+
+    qint64 byteCount() const
+    {
+        return qint64(texture->width()) * texture->height() * 4;
+    }
+};
+
+/**
+ * The OffscreenTexturePool keeps the offscreen textures of unredirected windows around for
+ * the next window of the same size, so opening and closing animations don't allocate a new
+ * texture every time. It's shared by all offscreen and crossfade effects.
+ *
+ * The textures are matched by their exact size because the normalized texture coordinates
+ * are visible to the custom shaders of animations. Maximized windows and dialogs that are
+ * opened repeatedly are the common hits. The idle textures are evicted in least recently
+ * used order once they exceed the budget, which can be set in MiB with the
+ * KWIN_OFFSCREEN_TEXTURE_POOL_BUDGET environment variable.
+ */
+class OffscreenTexturePool
+{
+public:
+    OffscreenTexturePool();
+
+    static OffscreenTexturePool *self();
+    static void ref();
+    static void deref();
+
+    std::unique_ptr<OffscreenTarget> acquire(const QSize &size);
+    void release(std::unique_ptr<OffscreenTarget> &&target);
+
+private:
+    void evict();
+
+    std::deque<std::unique_ptr<OffscreenTarget>> m_idle; // most recently used first
+    qint64 m_idleBytes = 0;
+    qint64 m_budget;
+
+    static OffscreenTexturePool *s_self;
+    static int s_refCount;
+};
+
+OffscreenTexturePool *OffscreenTexturePool::s_self = nullptr;
+int OffscreenTexturePool::s_refCount = 0;
+
+OffscreenTexturePool::OffscreenTexturePool()
+{
+    bool ok = false;
+    const qint64 budget = qEnvironmentVariableIntValue("KWIN_OFFSCREEN_TEXTURE_POOL_BUDGET", &ok);
+    m_budget = (ok ? budget : 256) * 1024 * 1024;
+}
+
+OffscreenTexturePool *OffscreenTexturePool::self()
+{
+    return s_self;
+}
+
+void OffscreenTexturePool::ref()
+{
+    if (!s_refCount++) {
+        s_self = new OffscreenTexturePool;
+    }
+}
+
+void OffscreenTexturePool::deref()
+{
+    if (!--s_refCount) {
+        delete s_self;
+        s_self = nullptr;
+    }
+}
+
+std::unique_ptr<OffscreenTarget> OffscreenTexturePool::acquire(const QSize &size)
+{
+    for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+        if ((*it)->texture->size() == size) {
+            std::unique_ptr<OffscreenTarget> target = std::move(*it);
+            m_idle.erase(it);
+            m_idleBytes -= target->byteCount();
+            return target;
+        }
+    }
+
+    auto target = std::make_unique<OffscreenTarget>();
+    target->texture.reset(new GLTexture(GL_RGBA8, size));
+    target->texture->setMemoryCategory(GLTexture::MemoryCategory::Effect);
+    target->texture->setFilter(GL_LINEAR);
+    target->texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    target->framebuffer.reset(new GLFramebuffer(target->texture.get()));
+    return target;
+}
+
+void OffscreenTexturePool::release(std::unique_ptr<OffscreenTarget> &&target)
+{
+    if (!target->framebuffer->valid()) {
+        return;
+    }
+    m_idleBytes += target->byteCount();
+    m_idle.push_front(std::move(target));
+    evict();
+}
+
+void OffscreenTexturePool::evict()
+{
+    while (m_idleBytes > m_budget && !m_idle.empty()) {
+        m_idleBytes -= m_idle.back()->byteCount();
+        m_idle.pop_back();
+    }
+}
+
 struct OffscreenData
 {
 public:
@@ -24,8 +139,7 @@ public:
     void maybeRender(EffectWindow *window);
 
 private:
-    std::unique_ptr<GLTexture> m_texture;
-    std::unique_ptr<GLFramebuffer> m_fbo;
+    std::unique_ptr<OffscreenTarget> m_target;
     bool m_isDirty = true;
     GLShader *m_shader = nullptr;
 };
@@ -42,11 +156,13 @@ OffscreenEffect::OffscreenEffect(QObject *parent)
     : Effect(parent)
     , d(new OffscreenEffectPrivate)
 {
+    OffscreenTexturePool::ref();
 }
 
 OffscreenEffect::~OffscreenEffect()
 {
     qDeleteAll(d->windows);
+    OffscreenTexturePool::deref();
 }
 
 bool OffscreenEffect::supported()
@@ -92,16 +208,16 @@ void OffscreenData::maybeRender(EffectWindow *window)
         textureSize *= screen->devicePixelRatio();
     }
 
-    if (!m_texture || m_texture->size() != textureSize) {
-        m_texture.reset(new GLTexture(GL_RGBA8, textureSize));
-        m_texture->setFilter(GL_LINEAR);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_fbo.reset(new GLFramebuffer(m_texture.get()));
+    if (!m_target || m_target->texture->size() != textureSize) {
+        if (m_target) {
+            OffscreenTexturePool::self()->release(std::move(m_target));
+        }
+        m_target = OffscreenTexturePool::self()->acquire(textureSize);
         m_isDirty = true;
     }
 
     if (m_isDirty) {
-        GLFramebuffer::pushFramebuffer(m_fbo.get());
+        GLFramebuffer::pushFramebuffer(m_target->framebuffer.get());
         glClearColor(0.0, 0.0, 0.0, 0.0);
         glClear(GL_COLOR_BUFFER_BIT);
 
@@ -124,6 +240,9 @@ void OffscreenData::maybeRender(EffectWindow *window)
 
 OffscreenData::~OffscreenData()
 {
+    if (m_target) {
+        OffscreenTexturePool::self()->release(std::move(m_target));
+    }
 }
 
 void OffscreenData::setDirty()
@@ -157,7 +276,7 @@ void OffscreenData::paint(EffectWindow *window, const QRegion &region,
     const size_t size = verticesPerQuad * quads.count() * sizeof(GLVertex2D);
     GLVertex2D *map = static_cast<GLVertex2D *>(vbo->map(size));
 
-    quads.makeInterleavedArrays(primitiveType, map, m_texture->matrix(NormalizedCoordinates));
+    quads.makeInterleavedArrays(primitiveType, map, m_target->texture->matrix(NormalizedCoordinates));
     vbo->unmap();
     vbo->bindArrays();
 
@@ -170,26 +289,26 @@ void OffscreenData::paint(EffectWindow *window, const QRegion &region,
     shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp * data.toMatrix());
     shader->setUniform(GLShader::ModulationConstant, QVector4D(rgb, rgb, rgb, a));
     shader->setUniform(GLShader::Saturation, data.saturation());
-    shader->setUniform(GLShader::TextureWidth, m_texture->width());
-    shader->setUniform(GLShader::TextureHeight, m_texture->height());
+    shader->setUniform(GLShader::TextureWidth, m_target->texture->width());
+    shader->setUniform(GLShader::TextureHeight, m_target->texture->height());
 
     const bool clipping = region != infiniteRegion();
     const QRegion clipRegion = clipping ? effects->mapToRenderTarget(region) : infiniteRegion();
 
     if (clipping) {
-        glEnable(GL_SCISSOR_TEST);
+        GLState::setScissorEnabled(true);
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-    m_texture->bind();
+    m_target->texture->bind();
     vbo->draw(clipRegion, primitiveType, 0, verticesPerQuad * quads.count(), clipping);
-    m_texture->unbind();
+    m_target->texture->unbind();
 
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
     if (clipping) {
-        glDisable(GL_SCISSOR_TEST);
+        GLState::setScissorEnabled(false);
     }
     vbo->unbindArrays();
 }
@@ -269,11 +388,13 @@ CrossFadeEffect::CrossFadeEffect(QObject *parent)
     : Effect(parent)
     , d(new CrossFadeEffectPrivate)
 {
+    OffscreenTexturePool::ref();
 }
 
 CrossFadeEffect::~CrossFadeEffect()
 {
     qDeleteAll(d->windows);
+    OffscreenTexturePool::deref();
 }
 
 void CrossFadeEffect::drawWindow(EffectWindow *window, int mask, const QRegion &region, WindowPaintData &data)
@@ -26,6 +26,8 @@
 #include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
 #include <QTimer>
+#include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <QQuickGraphicsDevice>
 #include <QQuickOpenGLUtils>
@@ -95,7 +97,14 @@ public:
     ulong lastMousePressTime = 0;
     Qt::MouseButton lastMousePressButton = Qt::NoButton;
 
+    // The scene rects of the items that have changed before, to damage what they covered.
+    QHash<QQuickItem *, QRectF> m_itemRects;
+    QRegion m_damage;
+    bool m_fullDamage = true;
+
     void releaseResources();
+    void collectDamage();
+    QRectF sceneRect(QQuickItem *item, bool forgetChildren);
 
     void updateTouchState(Qt::TouchPointState state, qint32 id, const QPointF &pos);
 };
@@ -279,6 +288,7 @@ void OffscreenQuickView::update()
         if (!d->m_fbo || d->m_fbo->size() != nativeSize) {
             d->m_textureExport.reset(nullptr);
             d->m_fbo.reset(new QOpenGLFramebufferObject(nativeSize, QOpenGLFramebufferObject::CombinedDepthStencil));
+            d->m_fullDamage = true;
             if (!d->m_fbo->isValid()) {
                 d->m_fbo.reset();
                 d->m_glcontext->doneCurrent();
@@ -293,6 +303,7 @@ void OffscreenQuickView::update()
     }
 
     d->m_renderControl->polishItems();
+    d->collectDamage();
     d->m_renderControl->sync();
 
     d->m_renderControl->render();
@@ -319,6 +330,11 @@ void OffscreenQuickView::update()
     Q_EMIT repaintNeeded();
 }
 
+QRegion OffscreenQuickView::damage() const
+{
+    return d->m_damage;
+}
+
 void OffscreenQuickView::forwardMouseEvent(QEvent *e)
 {
     if (!d->m_visible) {
@@ -457,6 +473,7 @@ void OffscreenQuickView::setVisible(bool visible)
         return;
     }
     d->m_visible = visible;
+    d->m_fullDamage = true;
 
     if (visible) {
         Q_EMIT d->m_renderControl->renderRequested();
@@ -515,6 +532,7 @@ void OffscreenQuickView::setGeometry(const QRect &rect)
 {
     const QRect oldGeometry = d->m_view->geometry();
     d->m_view->setGeometry(rect);
+    d->m_fullDamage = true;
     Q_EMIT geometryChanged(oldGeometry, rect);
 }
 
@@ -529,6 +547,69 @@ void OffscreenQuickView::Private::releaseResources()
     }
 }
 
+QRectF OffscreenQuickView::Private::sceneRect(QQuickItem *item, bool forgetChildren)
+{
+    QRectF rect;
+    if (item->isVisible()) {
+        rect = item->mapRectToScene(item->boundingRect());
+    }
+
+    const auto children = item->childItems();
+    for (QQuickItem *child : children) {
+        if (forgetChildren) {
+            // The child has moved along with its parent, what it covered before is unknown.
+            m_itemRects.remove(child);
+        }
+        if (item->isVisible() && !item->clip()) {
+            rect |= sceneRect(child, forgetChildren);
+        } else if (forgetChildren) {
+            sceneRect(child, forgetChildren);
+        }
+    }
+
+    return rect;
+}
+
+void OffscreenQuickView::Private::collectDamage()
+{
+    // QtQuick always renders the whole scene, but the compositor only has to repaint what has
+    // changed. That's the area covered by the dirty items, before and after the change. The
+    // previous area of an item is known only if it has changed before, so the view is damaged
+    // as a whole if an item that hasn't been seen so far is moved, resized, shown or hidden.
+    const quint32 contentChanges = QQuickItemPrivate::Content | QQuickItemPrivate::OpacityValue;
+
+    bool fullDamage = std::exchange(m_fullDamage, false);
+    QRegion damage;
+
+    QQuickWindowPrivate *windowPrivate = QQuickWindowPrivate::get(m_view);
+    for (QQuickItem *item = windowPrivate->dirtyItemList; item; item = QQuickItemPrivate::get(item)->nextDirtyItem) {
+        const quint32 dirtyAttributes = QQuickItemPrivate::get(item)->dirtyAttributes;
+        if (item == m_view->contentItem()) {
+            fullDamage = true;
+            continue;
+        }
+
+        const QRectF rect = sceneRect(item, dirtyAttributes & ~contentChanges);
+        auto it = m_itemRects.find(item);
+        if (it != m_itemRects.end()) {
+            damage += it->toAlignedRect();
+            *it = rect;
+        } else {
+            if (dirtyAttributes & ~contentChanges) {
+                fullDamage = true;
+            }
+            m_itemRects.insert(item, rect);
+            QObject::connect(item, &QObject::destroyed, m_view, [this, item]() {
+                m_itemRects.remove(item);
+            });
+        }
+        damage += rect.toAlignedRect();
+    }
+
+    const QRect viewRect(QPoint(0, 0), m_view->size());
+    m_damage = fullDamage ? QRegion(viewRect) : damage & viewRect;
+}
+
 void OffscreenQuickView::Private::updateTouchState(Qt::TouchPointState state, qint32 id, const QPointF &pos)
 {
     // Remove the points that were previously in a released state, since they
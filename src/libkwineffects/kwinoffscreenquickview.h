@@ -108,6 +108,12 @@ public:
      */
     void update();
 
+    /**
+     * Returns the part of the view that has changed in the last update(), in the
+     * coordinates of the view.
+     */
+    QRegion damage() const;
+
     /** The invisble root item of the window*/
     QQuickItem *contentItem() const;
     QQuickWindow *window() const;
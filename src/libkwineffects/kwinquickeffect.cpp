@@ -8,9 +8,11 @@
 
 #include "sharedqmlengine.h"
 
+#include <QQmlComponent>
 #include <QQmlEngine>
 #include <QQuickItem>
 #include <QQuickWindow>
+#include <QTimer>
 #include <QWindow>
 
 namespace KWin
@@ -31,6 +33,9 @@ public:
     QHash<EffectScreen *, QuickSceneView *> views;
     QPointer<QuickSceneView> mouseImplicitGrab;
     bool running = false;
+    // set while the effect waits for the asynchronously loaded component to become ready
+    bool startPending = false;
+    QTimer preloadTimer;
     std::unique_ptr<QWindow> dummyWindow;
 };
 
@@ -113,6 +118,11 @@ QuickSceneEffect::QuickSceneEffect(QObject *parent)
     : Effect(parent)
     , d(new QuickSceneEffectPrivate)
 {
+    // Compiling the QML takes a good while, do it once things have settled down after the
+    // effect got loaded rather than when the user activates the effect for the first time.
+    d->preloadTimer.setSingleShot(true);
+    d->preloadTimer.setInterval(5000);
+    connect(&d->preloadTimer, &QTimer::timeout, this, &QuickSceneEffect::preloadComponent);
 }
 
 QuickSceneEffect::~QuickSceneEffect()
@@ -170,6 +180,9 @@ bool QuickSceneEffect::isRunning() const
 
 void QuickSceneEffect::setRunning(bool running)
 {
+    if (!running) {
+        d->startPending = false;
+    }
     if (d->running != running) {
         if (running) {
             startInternal();
@@ -193,7 +206,29 @@ void QuickSceneEffect::setSource(const QUrl &url)
     if (d->source != url) {
         d->source = url;
         d->qmlComponent.reset();
+        d->startPending = false;
+        if (!url.isEmpty()) {
+            d->preloadTimer.start();
+        }
+    }
+}
+
+void QuickSceneEffect::preloadComponent()
+{
+    if (d->qmlComponent || d->source.isEmpty()) {
+        return;
+    }
+    if (!d->qmlEngine) {
+        d->qmlEngine = SharedQmlEngine::engine();
     }
+    // the QML gets loaded and compiled in the type loader thread
+    d->qmlComponent.reset(new QQmlComponent(d->qmlEngine.get(), d->source, QQmlComponent::Asynchronous));
+    connect(d->qmlComponent.get(), &QQmlComponent::statusChanged, this, [this](QQmlComponent::Status status) {
+        if (status != QQmlComponent::Loading && d->startPending) {
+            d->startPending = false;
+            startInternal();
+        }
+    });
 }
 
 QHash<EffectScreen *, QuickSceneView *> QuickSceneEffect::views() const
@@ -369,7 +404,7 @@ void QuickSceneEffect::addScreen(EffectScreen *screen)
     view->setAutomaticRepaint(false);
 
     connect(view, &QuickSceneView::repaintNeeded, this, [view]() {
-        effects->addRepaint(view->geometry());
+        effects->addRepaint(view->damage().translated(view->geometry().topLeft()));
     });
     connect(view, &QuickSceneView::renderRequested, view, &QuickSceneView::scheduleRepaint);
     connect(view, &QuickSceneView::sceneChanged, view, &QuickSceneView::scheduleRepaint);
@@ -393,14 +428,19 @@ void QuickSceneEffect::startInternal()
         d->qmlEngine = SharedQmlEngine::engine();
     }
 
+    d->preloadTimer.stop();
     if (!d->qmlComponent) {
         d->qmlComponent.reset(new QQmlComponent(d->qmlEngine.get()));
         d->qmlComponent->loadUrl(d->source);
-        if (d->qmlComponent->isError()) {
-            qWarning().nospace() << "Failed to load " << d->source << ": " << d->qmlComponent->errors();
-            d->qmlComponent.reset();
-            return;
-        }
+    } else if (d->qmlComponent->isLoading()) {
+        // the preloaded component isn't ready yet, start as soon as it is
+        d->startPending = true;
+        return;
+    }
+    if (d->qmlComponent->isError()) {
+        qWarning().nospace() << "Failed to load " << d->source << ": " << d->qmlComponent->errors();
+        d->qmlComponent.reset();
+        return;
     }
 
     effects->setActiveFullScreenEffect(this);
@@ -159,6 +159,7 @@ private:
     void handleScreenRemoved(EffectScreen *screen);
 
     void addScreen(EffectScreen *screen);
+    void preloadComponent();
     void startInternal();
     void stopInternal();
 
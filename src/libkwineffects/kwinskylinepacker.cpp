@@ -0,0 +1,137 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwinskylinepacker.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace KWin
+{
+
+SkylinePacker::SkylinePacker(const QSize &size)
+    : m_size(size)
+{
+    clear();
+}
+
+QSize SkylinePacker::size() const
+{
+    return m_size;
+}
+
+QRect SkylinePacker::allocate(const QSize &size)
+{
+    if (size.isEmpty() || size.width() > m_size.width() || size.height() > m_size.height()) {
+        return QRect();
+    }
+
+    int bestX = 0;
+    int bestY = std::numeric_limits<int>::max();
+    for (int i = 0; i < m_skyline.count(); ++i) {
+        const int x = m_skyline[i].x;
+        if (x + size.width() > m_size.width()) {
+            break;
+        }
+        // the rectangle has to sit on the highest segment underneath it
+        int y = 0;
+        for (int j = i; j < m_skyline.count() && m_skyline[j].x < x + size.width(); ++j) {
+            y = std::max(y, m_skyline[j].y);
+        }
+        if (y + size.height() <= m_size.height() && y < bestY) {
+            bestX = x;
+            bestY = y;
+        }
+    }
+    if (bestY == std::numeric_limits<int>::max()) {
+        return QRect();
+    }
+
+    const QRect rect(QPoint(bestX, bestY), size);
+    setHeight(rect.x(), rect.width(), rect.y() + rect.height());
+    ++m_allocationCount;
+    m_allocatedArea += qint64(size.width()) * size.height();
+    return rect;
+}
+
+void SkylinePacker::release(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    --m_allocationCount;
+    m_allocatedArea -= qint64(rect.width()) * rect.height();
+    if (m_allocationCount <= 0) {
+        clear();
+        return;
+    }
+
+    // The space can be reused right away if nothing has been put on top of the rectangle,
+    // otherwise it's wasted until everything has been released.
+    const int top = rect.y() + rect.height();
+    const bool uncovered = std::all_of(m_skyline.cbegin(), m_skyline.cend(), [&rect, top](const Segment &segment) {
+        return segment.x + segment.width <= rect.x() || segment.x >= rect.x() + rect.width() || segment.y == top;
+    });
+    if (uncovered) {
+        setHeight(rect.x(), rect.width(), rect.y());
+    }
+}
+
+void SkylinePacker::clear()
+{
+    m_skyline = {Segment{0, 0, m_size.width()}};
+    m_allocationCount = 0;
+    m_allocatedArea = 0;
+}
+
+int SkylinePacker::allocationCount() const
+{
+    return m_allocationCount;
+}
+
+qreal SkylinePacker::occupancy() const
+{
+    const qint64 area = qint64(m_size.width()) * m_size.height();
+    return area ? qreal(m_allocatedArea) / area : 0;
+}
+
+void SkylinePacker::setHeight(int x, int width, int y)
+{
+    const int end = x + width;
+    QVector<Segment> skyline;
+    skyline.reserve(m_skyline.count() + 2);
+
+    const auto append = [&skyline](const Segment &segment) {
+        if (!skyline.isEmpty() && skyline.last().y == segment.y) {
+            skyline.last().width += segment.width;
+        } else {
+            skyline.append(segment);
+        }
+    };
+
+    bool inserted = false;
+    for (const Segment &segment : std::as_const(m_skyline)) {
+        const int segmentEnd = segment.x + segment.width;
+        if (segmentEnd <= x || segment.x >= end) {
+            append(segment);
+            continue;
+        }
+        if (segment.x < x) {
+            append(Segment{segment.x, segment.y, x - segment.x});
+        }
+        if (!inserted) {
+            append(Segment{x, y, width});
+            inserted = true;
+        }
+        if (segmentEnd > end) {
+            append(Segment{end, segment.y, segmentEnd - end});
+        }
+    }
+    m_skyline = skyline;
+}
+
+} // namespace KWin
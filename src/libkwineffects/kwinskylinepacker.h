@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglutils_export.h>
+
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The SkylinePacker class finds space for rectangles in a larger rectangle, e.g. for the
+ * entries of a texture atlas.
+ *
+ * It keeps track of the skyline, the top edge of everything that has been allocated so far,
+ * and puts a new rectangle where it ends up as high as possible. Space can only be reused
+ * once the rectangle above it has been released, or once everything has been released.
+ */
+class KWINGLUTILS_EXPORT SkylinePacker
+{
+public:
+    explicit SkylinePacker(const QSize &size);
+
+    QSize size() const;
+
+    /**
+     * Returns where a rectangle of the given @a size has been put, or a null rectangle if
+     * there's no space left for it.
+     */
+    QRect allocate(const QSize &size);
+    /**
+     * Gives the space of the @a rect, which has been returned by allocate(), back.
+     */
+    void release(const QRect &rect);
+    void clear();
+
+    int allocationCount() const;
+    /**
+     * Returns the share of the area that is allocated.
+     */
+    qreal occupancy() const;
+
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    void setHeight(int x, int width, int y);
+
+    QSize m_size;
+    // the segments are sorted and cover the entire width
+    QVector<Segment> m_skyline;
+    int m_allocationCount = 0;
+    qint64 m_allocatedArea = 0;
+};
+
+} // namespace KWin
@@ -323,12 +323,28 @@ void Application::destroyInputMethod()
     m_inputMethod.reset();
 }
 
+static quint32 genericEventKey(int extension, int eventType)
+{
+    return (quint32(extension) << 16) | quint32(eventType & 0xffff);
+}
+
 void Application::registerEventFilter(X11EventFilter *filter)
 {
+    auto container = new X11EventFilterContainer(filter);
     if (filter->isGenericEvent()) {
-        m_genericEventFilters.append(new X11EventFilterContainer(filter));
+        m_genericEventFilters.append(container);
+        const auto genericEventTypes = filter->genericEventTypes();
+        for (int eventType : genericEventTypes) {
+            m_genericEventFiltersByType[genericEventKey(filter->extension(), eventType)].append(container);
+        }
     } else {
-        m_eventFilters.append(new X11EventFilterContainer(filter));
+        m_eventFilters.append(container);
+        const auto eventTypes = filter->eventTypes();
+        for (int eventType : eventTypes) {
+            if (eventType >= 0 && eventType < int(m_eventFiltersByType.size())) {
+                m_eventFiltersByType[eventType].append(container);
+            }
+        }
     }
 }
 
@@ -357,13 +373,35 @@ void Application::unregisterEventFilter(X11EventFilter *filter)
     X11EventFilterContainer *container = nullptr;
     if (filter->isGenericEvent()) {
         container = takeEventFilter(filter, m_genericEventFilters);
+        for (auto it = m_genericEventFiltersByType.begin(); it != m_genericEventFiltersByType.end();) {
+            it->removeAll(container);
+            if (it->isEmpty()) {
+                it = m_genericEventFiltersByType.erase(it);
+            } else {
+                ++it;
+            }
+        }
     } else {
         container = takeEventFilter(filter, m_eventFilters);
+        for (auto &filters : m_eventFiltersByType) {
+            filters.removeAll(container);
+        }
     }
     delete container;
 }
 
 bool Application::dispatchEvent(xcb_generic_event_t *event)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const bool ret = dispatchEventInternal(event);
+
+    X11EventStatistics &statistics = m_x11EventStatistics[event->response_type & ~0x80];
+    statistics.count++;
+    statistics.time += std::chrono::steady_clock::now() - start;
+    return ret;
+}
+
+bool Application::dispatchEventInternal(xcb_generic_event_t *event)
 {
     static const QVector<QByteArray> s_xcbEerrors({QByteArrayLiteral("Success"),
                                                    QByteArrayLiteral("BadRequest"),
@@ -423,28 +461,26 @@ bool Application::dispatchEvent(xcb_generic_event_t *event)
 
         // We need to make a shadow copy of the event filter list because an activated event
         // filter may mutate it by removing or installing another event filter.
-        const auto eventFilters = m_genericEventFilters;
+        const auto eventFilters = m_genericEventFiltersByType.value(genericEventKey(ge->extension, ge->event_type));
 
         for (X11EventFilterContainer *container : eventFilters) {
             if (!container) {
                 continue;
             }
-            X11EventFilter *filter = container->filter();
-            if (filter->extension() == ge->extension && filter->genericEventTypes().contains(ge->event_type) && filter->event(event)) {
+            if (container->filter()->event(event)) {
                 return true;
             }
         }
     } else {
         // We need to make a shadow copy of the event filter list because an activated event
         // filter may mutate it by removing or installing another event filter.
-        const auto eventFilters = m_eventFilters;
+        const auto eventFilters = m_eventFiltersByType[x11EventType];
 
         for (X11EventFilterContainer *container : eventFilters) {
             if (!container) {
                 continue;
             }
-            X11EventFilter *filter = container->filter();
-            if (filter->eventTypes().contains(x11EventType) && filter->event(event)) {
+            if (container->filter()->event(event)) {
                 return true;
             }
         }
@@ -15,10 +15,13 @@
 #include <kwinglobals.h>
 
 #include <KSharedConfig>
+#include <array>
+#include <chrono>
 #include <memory>
 // Qt
 #include <QAbstractNativeEventFilter>
 #include <QApplication>
+#include <QHash>
 #include <QProcessEnvironment>
 
 class KPluginMetaData;
@@ -130,6 +133,23 @@ public:
     void unregisterEventFilter(X11EventFilter *filter);
     bool dispatchEvent(xcb_generic_event_t *event);
 
+    /**
+     * How many X11 events of a type have been dispatched, and how long it took.
+     */
+    struct X11EventStatistics
+    {
+        quint64 count = 0;
+        std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    };
+    /**
+     * The statistics of all X11 events, indexed by the event type. Errors are counted as type 0,
+     * all generic events as XCB_GE_GENERIC.
+     */
+    const std::array<X11EventStatistics, 128> &x11EventStatistics() const
+    {
+        return m_x11EventStatistics;
+    }
+
     xcb_timestamp_t x11Time() const
     {
         return m_x11Time;
@@ -282,8 +302,16 @@ protected:
     static int crashes;
 
 private:
+    bool dispatchEventInternal(xcb_generic_event_t *event);
+
     QList<QPointer<X11EventFilterContainer>> m_eventFilters;
     QList<QPointer<X11EventFilterContainer>> m_genericEventFilters;
+    // the filters by event type, so an event only visits the filters that are interested in it
+    std::array<QList<QPointer<X11EventFilterContainer>>, 128> m_eventFiltersByType;
+    // the generic filters by the extension's major opcode in the upper and the event type in
+    // the lower 16 bits
+    QHash<quint32, QList<QPointer<X11EventFilterContainer>>> m_genericEventFiltersByType;
+    std::array<X11EventStatistics, 128> m_x11EventStatistics;
     std::unique_ptr<XcbEventFilter> m_eventFilter;
     bool m_configLock;
     KSharedConfigPtr m_config;
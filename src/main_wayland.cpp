@@ -19,6 +19,7 @@
 #include "core/session.h"
 #include "effects.h"
 #include "inputmethod.h"
+#include "startuptracer.h"
 #include "tabletmodemanager.h"
 #include "utils/realtime.h"
 #include "wayland/display.h"
@@ -136,17 +137,31 @@ void ApplicationWayland::performStartup()
         setOperationMode(OperationModeXwayland);
         setXwaylandScale(config()->group("Xwayland").readEntry("Scale", 1.0));
     }
+    StartupTracer::endPhase("launch");
+
     // first load options - done internally by a different thread
+    StartupTracer::beginPhase("options", {"launch"});
     createOptions();
+    StartupTracer::endPhase("options");
 
+    StartupTracer::beginPhase("backend", {"options"});
     if (!platform()->initialize()) {
         std::exit(1);
     }
+    StartupTracer::endPhase("backend");
 
+    StartupTracer::beginPhase("input", {"backend"});
     createInput();
+    StartupTracer::endPhase("input");
+    StartupTracer::beginPhase("inputmethod", {"input"});
     createInputMethod();
+    StartupTracer::endPhase("inputmethod");
+    StartupTracer::beginPhase("tabletmode", {"input"});
     createTabletModeManager();
+    StartupTracer::endPhase("tabletmode");
 
+    // ends once the scene has been created
+    StartupTracer::beginPhase("compositor", {"backend", "options"});
     WaylandCompositor::create();
 
     connect(Compositor::self(), &Compositor::sceneCreated, platform(), &Platform::sceneInitialized);
@@ -156,15 +171,24 @@ void ApplicationWayland::performStartup()
 void ApplicationWayland::continueStartupWithScene()
 {
     disconnect(Compositor::self(), &Compositor::sceneCreated, this, &ApplicationWayland::continueStartupWithScene);
+    StartupTracer::endPhase("compositor");
 
     // Note that we start accepting client connections after creating the Workspace.
+    StartupTracer::beginPhase("workspace", {"compositor", "input", "inputmethod", "tabletmode"});
     createWorkspace();
+    StartupTracer::endPhase("workspace");
+    StartupTracer::beginPhase("colormanager", {"workspace"});
     createColorManager();
+    StartupTracer::endPhase("colormanager");
+    StartupTracer::beginPhase("plugins", {"workspace"});
     createPlugins();
+    StartupTracer::endPhase("plugins");
 
+    StartupTracer::beginPhase("waylandserver", {"workspace", "colormanager", "plugins"});
     if (!waylandServer()->start()) {
         qFatal("Failed to initialze the Wayland server, exiting now");
     }
+    StartupTracer::endPhase("waylandserver");
 
     if (operationMode() == OperationModeWaylandOnly) {
         finalizeStartup();
@@ -175,8 +199,16 @@ void ApplicationWayland::continueStartupWithScene()
     m_xwayland->xwaylandLauncher()->setListenFDs(m_xwaylandListenFds);
     m_xwayland->xwaylandLauncher()->setDisplayName(m_xwaylandDisplay);
     m_xwayland->xwaylandLauncher()->setXauthority(m_xwaylandXauthority);
+    // Saves the startup time and memory of Xwayland in sessions without X11 apps
+    static const bool onDemand = qEnvironmentVariableIntValue("KWIN_XWAYLAND_ON_DEMAND");
+    if (onDemand) {
+        m_xwayland->start(Xwl::Xwayland::StartMode::OnDemand);
+        finalizeStartup();
+        return;
+    }
     connect(m_xwayland.get(), &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
     connect(m_xwayland.get(), &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+    StartupTracer::beginPhase("xwayland", {"waylandserver"});
     m_xwayland->start();
 }
 
@@ -185,9 +217,13 @@ void ApplicationWayland::finalizeStartup()
     if (m_xwayland) {
         disconnect(m_xwayland.get(), &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
         disconnect(m_xwayland.get(), &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+        StartupTracer::endPhase("xwayland");
     }
+    StartupTracer::beginPhase("session", {"waylandserver", "xwayland"});
     startSession();
+    StartupTracer::endPhase("session");
     notifyStarted();
+    StartupTracer::finish();
 }
 
 void ApplicationWayland::refreshSettings(const KConfigGroup &group, const QByteArrayList &names)
@@ -280,6 +316,7 @@ XwaylandInterface *ApplicationWayland::xwayland() const
 
 int main(int argc, char *argv[])
 {
+    KWin::StartupTracer::beginPhase("launch");
     KWin::Application::setupMalloc();
     KWin::Application::setupLocalizedString();
     KWin::gainRealTime();
@@ -66,6 +66,8 @@ Options::Options(QObject *parent)
     , m_glPreferBufferSwap(Options::defaultGlPreferBufferSwap())
     , m_glPlatformInterface(Options::defaultGlPlatformInterface())
     , m_windowsBlockCompositing(true)
+    , m_unredirectFullscreen(false)
+    , m_allowTearing(true)
     , m_MoveMinimizedWindowsToEndOfTabBoxFocusChain(false)
     , OpTitlebarDblClick(Options::defaultOperationTitlebarDblClick())
     , CmdActiveTitlebar1(Options::defaultCommandActiveTitlebar1())
@@ -598,6 +600,24 @@ void Options::setWindowsBlockCompositing(bool value)
     Q_EMIT windowsBlockCompositingChanged();
 }
 
+void Options::setUnredirectFullscreen(bool set)
+{
+    if (m_unredirectFullscreen == set) {
+        return;
+    }
+    m_unredirectFullscreen = set;
+    Q_EMIT unredirectFullscreenChanged();
+}
+
+void Options::setAllowTearing(bool allow)
+{
+    if (m_allowTearing == allow) {
+        return;
+    }
+    m_allowTearing = allow;
+    Q_EMIT allowTearingChanged();
+}
+
 void Options::setMoveMinimizedWindowsToEndOfTabBoxFocusChain(bool value)
 {
     if (m_MoveMinimizedWindowsToEndOfTabBoxFocusChain == value) {
@@ -790,6 +810,8 @@ void Options::syncFromKcfgc()
     setElectricBorderTiling(m_settings->electricBorderTiling());
     setElectricBorderCornerRatio(m_settings->electricBorderCornerRatio());
     setWindowsBlockCompositing(m_settings->windowsBlockCompositing());
+    setUnredirectFullscreen(m_settings->unredirectFullscreen());
+    setAllowTearing(m_settings->allowTearing());
     setMoveMinimizedWindowsToEndOfTabBoxFocusChain(m_settings->moveMinimizedWindowsToEndOfTabBoxFocusChain());
     setLatencyPolicy(m_settings->latencyPolicy());
     setRenderTimeEstimator(m_settings->renderTimeEstimator());
@@ -59,6 +59,8 @@ enum RenderTimeEstimator {
     RenderTimeEstimatorMinimum,
     RenderTimeEstimatorMaximum,
     RenderTimeEstimatorAverage,
+    RenderTimeEstimatorPercentile90,
+    RenderTimeEstimatorPercentile99,
 };
 
 /**
@@ -213,6 +215,11 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(GlSwapStrategy glPreferBufferSwap READ glPreferBufferSwap WRITE setGlPreferBufferSwap NOTIFY glPreferBufferSwapChanged)
     Q_PROPERTY(KWin::OpenGLPlatformInterface glPlatformInterface READ glPlatformInterface WRITE setGlPlatformInterface NOTIFY glPlatformInterfaceChanged)
     Q_PROPERTY(bool windowsBlockCompositing READ windowsBlockCompositing WRITE setWindowsBlockCompositing NOTIFY windowsBlockCompositingChanged)
+    /**
+     * Whether compositing is suspended while an opaque fullscreen X11 window covers the screen.
+     */
+    Q_PROPERTY(bool unredirectFullscreen READ unredirectFullscreen WRITE setUnredirectFullscreen NOTIFY unredirectFullscreenChanged)
+    Q_PROPERTY(bool allowTearing READ allowTearing WRITE setAllowTearing NOTIFY allowTearingChanged)
     Q_PROPERTY(LatencyPolicy latencyPolicy READ latencyPolicy WRITE setLatencyPolicy NOTIFY latencyPolicyChanged)
     Q_PROPERTY(RenderTimeEstimator renderTimeEstimator READ renderTimeEstimator WRITE setRenderTimeEstimator NOTIFY renderTimeEstimatorChanged)
 public:
@@ -697,6 +704,20 @@ public:
         return m_windowsBlockCompositing;
     }
 
+    bool unredirectFullscreen() const
+    {
+        return m_unredirectFullscreen;
+    }
+
+    /**
+     * Whether fullscreen windows that ask for it, e.g. via the tearing-control protocol,
+     * may be presented without waiting for the vertical blank.
+     */
+    bool allowTearing() const
+    {
+        return m_allowTearing;
+    }
+
     bool moveMinimizedWindowsToEndOfTabBoxFocusChain() const
     {
         return m_MoveMinimizedWindowsToEndOfTabBoxFocusChain;
@@ -761,6 +782,8 @@ public:
     void setGlPreferBufferSwap(char glPreferBufferSwap);
     void setGlPlatformInterface(OpenGLPlatformInterface interface);
     void setWindowsBlockCompositing(bool set);
+    void setUnredirectFullscreen(bool set);
+    void setAllowTearing(bool allow);
     void setMoveMinimizedWindowsToEndOfTabBoxFocusChain(bool set);
     void setLatencyPolicy(LatencyPolicy policy);
     void setRenderTimeEstimator(RenderTimeEstimator estimator);
@@ -966,6 +989,8 @@ Q_SIGNALS:
     void glPreferBufferSwapChanged();
     void glPlatformInterfaceChanged();
     void windowsBlockCompositingChanged();
+    void unredirectFullscreenChanged();
+    void allowTearingChanged();
     void animationSpeedChanged();
     void latencyPolicyChanged();
     void configChanged();
@@ -1012,6 +1037,8 @@ private:
     GlSwapStrategy m_glPreferBufferSwap;
     OpenGLPlatformInterface m_glPlatformInterface;
     bool m_windowsBlockCompositing;
+    bool m_unredirectFullscreen;
+    bool m_allowTearing;
     bool m_MoveMinimizedWindowsToEndOfTabBoxFocusChain;
 
     WindowOperation OpTitlebarDblClick;
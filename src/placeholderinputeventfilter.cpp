@@ -12,6 +12,11 @@
 namespace KWin
 {
 
+PlaceholderInputEventFilter::PlaceholderInputEventFilter()
+    : InputEventFilter(InputEventType::Pointer | InputEventType::Wheel | InputEventType::Key | InputEventType::Touch)
+{
+}
+
 bool PlaceholderInputEventFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
     Q_UNUSED(event)
@@ -22,6 +22,7 @@
 
 #include <QTextStream>
 #include <QTimer>
+#include <QVarLengthArray>
 
 namespace KWin
 {
@@ -209,6 +210,31 @@ void Placement::placeSmart(Window *c, const QRectF &area, PlacementPolicy /*next
 
     bool first_pass = true; // CT lame flag. Don't like it. What else would do?
 
+    // Gather the other windows once, the loop below visits them for every candidate position.
+    struct Obstacle
+    {
+        int left;
+        int top;
+        int right;
+        int bottom;
+        int weight;
+    };
+    QVarLengthArray<Obstacle, 32> obstacles;
+    for (const Window *client : workspace()->stackingOrder()) {
+        if (isIrrelevant(client, c, desktop)) {
+            continue;
+        }
+        int weight = 1;
+        if (client->keepAbove()) {
+            weight = 16;
+        } else if (client->keepBelow() && !client->isDock()) { // ignore KeepBelow windows
+            weight = 0; // for placement (see X11Window::belongsToLayer() for Dock)
+        }
+        const int left = client->x();
+        const int top = client->y();
+        obstacles.append(Obstacle{left, top, int(left + client->width()), int(top + client->height()), weight});
+    }
+
     // loop over possible positions
     do {
         // test if enough room in x and y directions
@@ -223,15 +249,11 @@ void Placement::placeSmart(Window *c, const QRectF &area, PlacementPolicy /*next
             cxr = x + cw;
             cyt = y;
             cyb = y + ch;
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            for (const Obstacle &obstacle : obstacles) {
+                xl = obstacle.left;
+                yt = obstacle.top;
+                xr = obstacle.right;
+                yb = obstacle.bottom;
 
                 // if windows overlap, calc the overall overlapping
                 if ((cxl < xr) && (cxr > xl) && (cyt < yb) && (cyb > yt)) {
@@ -239,13 +261,7 @@ void Placement::placeSmart(Window *c, const QRectF &area, PlacementPolicy /*next
                     xr = qMin(cxr, xr);
                     yt = qMax(cyt, yt);
                     yb = qMin(cyb, yb);
-                    if (client->keepAbove()) {
-                        overlap += 16 * (xr - xl) * (yb - yt);
-                    } else if (client->keepBelow() && !client->isDock()) { // ignore KeepBelow windows
-                        overlap += 0; // for placement (see X11Window::belongsToLayer() for Dock)
-                    } else {
-                        overlap += (xr - xl) * (yb - yt);
-                    }
+                    overlap += obstacle.weight * (xr - xl) * (yb - yt);
                 }
             }
         }
@@ -277,16 +293,11 @@ void Placement::placeSmart(Window *c, const QRectF &area, PlacementPolicy /*next
             }
 
             // compare to the position of each client on the same desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            for (const Obstacle &obstacle : obstacles) {
+                xl = obstacle.left;
+                yt = obstacle.top;
+                xr = obstacle.right;
+                yb = obstacle.bottom;
 
                 // if not enough room above or under the current tested client
                 // determine the first non-overlapped x position
@@ -315,16 +326,11 @@ void Placement::placeSmart(Window *c, const QRectF &area, PlacementPolicy /*next
             }
 
             // test the position of each window on the desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            for (const Obstacle &obstacle : obstacles) {
+                xl = obstacle.left;
+                yt = obstacle.top;
+                xr = obstacle.right;
+                yb = obstacle.bottom;
 
                 // if not enough room to the left or right of the current tested client
                 // determine the first non-overlapped y position
@@ -623,6 +629,7 @@ void Placement::cascadeDesktop()
     Workspace *ws = Workspace::self();
     const int desktop = VirtualDesktopManager::self()->current();
     reinitCascading(desktop);
+    GeometryTransaction transaction(ws);
     const auto stackingOrder = ws->stackingOrder();
     for (Window *window : stackingOrder) {
         if (!window->isClient() || (!window->isOnCurrentDesktop()) || (window->isMinimized()) || (window->isOnAllDesktops()) || (!window->isMovable())) {
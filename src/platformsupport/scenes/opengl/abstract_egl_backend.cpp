@@ -23,9 +23,19 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 // Qt
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <optional>
 
 #include <drm_fourcc.h>
 
@@ -42,6 +52,86 @@ static bool isOpenGLES_helper()
     return QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES;
 }
 
+/**
+ * Remembers which context attributes the EGL implementation accepted the last time, so that
+ * the contexts created later on, and on the next start, don't go through all the candidates
+ * that are known to fail first. It's keyed by the EGL implementation and its extensions, as
+ * they decide both the list of candidates and which of them succeed.
+ */
+class EglContextCache
+{
+public:
+    EglContextCache(EGLDisplay display, bool gles)
+        : m_filePath(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/kwin/eglcontext"))
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(eglQueryString(display, EGL_VENDOR));
+        hash.addData(QByteArrayLiteral("\n"));
+        hash.addData(eglQueryString(display, EGL_VERSION));
+        hash.addData(QByteArrayLiteral("\n"));
+        hash.addData(eglQueryString(display, EGL_EXTENSIONS));
+        hash.addData(gles ? QByteArrayLiteral("\nGLES") : QByteArrayLiteral("\nGL"));
+        m_key = hash.result();
+    }
+
+    static bool isSupported()
+    {
+        static const bool disabled = qEnvironmentVariableIntValue("KWIN_EGL_NO_CONTEXT_CACHE");
+        return !disabled;
+    }
+
+    int load() const
+    {
+        if (s_key == m_key) {
+            return s_candidate;
+        }
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return -1;
+        }
+        QDataStream stream(&file);
+        QByteArray key;
+        qint32 candidate;
+        stream >> key >> candidate;
+        if (stream.status() != QDataStream::Ok || key != m_key) {
+            return -1;
+        }
+        s_key = m_key;
+        s_candidate = candidate;
+        return candidate;
+    }
+
+    void store(int candidate) const
+    {
+        if (s_key == m_key && s_candidate == candidate) {
+            return;
+        }
+        s_key = m_key;
+        s_candidate = candidate;
+
+        QDir().mkpath(QFileInfo(m_filePath).path());
+        QSaveFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return;
+        }
+        QDataStream stream(&file);
+        stream << m_key << qint32(candidate);
+        if (!file.commit()) {
+            qCDebug(KWIN_OPENGL) << "Failed to store the EGL context attributes in" << file.fileName();
+        }
+    }
+
+private:
+    QString m_filePath;
+    QByteArray m_key;
+
+    static QByteArray s_key;
+    static int s_candidate;
+};
+
+QByteArray EglContextCache::s_key;
+int EglContextCache::s_candidate = -1;
+
 AbstractEglBackend::AbstractEglBackend(dev_t deviceId)
     : m_deviceId(deviceId)
 {
@@ -229,6 +319,8 @@ bool AbstractEglBackend::makeCurrent()
         context->doneCurrent();
     }
     const bool current = eglMakeCurrent(m_display, m_surface, m_surface, m_context);
+    // Qt or a client may have rendered with the context meanwhile
+    GLState::invalidate();
     return current;
 }
 
@@ -342,12 +434,26 @@ EGLContext AbstractEglBackend::createContextInternal(EGLContext sharedContext)
         candidates.emplace_back(new EglContextAttributeBuilder);
     }
 
+    std::optional<EglContextCache> cache;
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (EglContextCache::isSupported()) {
+        cache.emplace(m_display, isOpenGLES());
+        const int cached = cache->load();
+        if (cached > 0 && cached < int(candidates.size())) {
+            std::rotate(order.begin(), order.begin() + cached, order.begin() + cached + 1);
+        }
+    }
+
     EGLContext ctx = EGL_NO_CONTEXT;
-    for (auto it = candidates.begin(); it != candidates.end(); it++) {
-        const auto attribs = (*it)->build();
+    for (const int index : order) {
+        const auto attribs = candidates[index]->build();
         ctx = eglCreateContext(m_display, config(), sharedContext, attribs.data());
         if (ctx != EGL_NO_CONTEXT) {
-            qCDebug(KWIN_OPENGL) << "Created EGL context with attributes:" << (*it).get();
+            qCDebug(KWIN_OPENGL) << "Created EGL context with attributes:" << candidates[index].get();
+            if (cache) {
+                cache->store(index);
+            }
             break;
         }
     }
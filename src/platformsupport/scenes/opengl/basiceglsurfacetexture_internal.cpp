@@ -43,6 +43,16 @@ void BasicEGLSurfaceTextureInternal::update(const QRegion &region)
     }
 }
 
+bool BasicEGLSurfaceTextureInternal::evict()
+{
+    // a texture wrapping the framebuffer object of the window doesn't own its memory
+    if (!m_texture || m_pixmap->fbo() || m_pixmap->image().isNull()) {
+        return false;
+    }
+    m_texture.reset();
+    return true;
+}
+
 bool BasicEGLSurfaceTextureInternal::updateFromFramebuffer()
 {
     const QOpenGLFramebufferObject *fbo = m_pixmap->fbo();
@@ -78,6 +88,7 @@ bool BasicEGLSurfaceTextureInternal::updateFromImage(const QRegion &region)
 
     if (!m_texture) {
         m_texture.reset(new GLTexture(image));
+        m_texture->setMemoryCategory(GLTexture::MemoryCategory::Window);
     } else {
         const QRegion nativeRegion = scale(region, image.devicePixelRatio());
         for (const QRect &rect : nativeRegion) {
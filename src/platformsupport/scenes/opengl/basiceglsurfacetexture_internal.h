@@ -18,6 +18,7 @@ public:
 
     bool create() override;
     void update(const QRegion &region) override;
+    bool evict() override;
 
 private:
     bool updateFromFramebuffer();
@@ -6,13 +6,17 @@
 
 #include "basiceglsurfacetexture_wayland.h"
 #include "egl_dmabuf.h"
+#include "eglnativefence.h"
 #include "kwineglext.h"
 #include "kwingltexture.h"
+#include "kwingltextureatlas.h"
 #include "surfaceitem_wayland.h"
 #include "utils/common.h"
+#include "utils/filedescriptor.h"
 #include "wayland/drmclientbuffer.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/shmclientbuffer.h"
+#include "wayland/surface_interface.h"
 
 namespace KWin
 {
@@ -52,7 +56,11 @@ void BasicEGLSurfaceTextureWayland::destroy()
         eglDestroyImageKHR(backend()->eglDisplay(), m_image);
         m_image = EGL_NO_IMAGE_KHR;
     }
+    if (m_bufferType == BufferType::DmaBuf && m_dmabuf) {
+        static_cast<EglDmabufBuffer *>(m_dmabuf.data())->setTexture(std::move(m_texture));
+    }
     m_texture.reset();
+    m_dmabuf.clear();
     m_bufferType = BufferType::None;
 }
 
@@ -67,6 +75,17 @@ void BasicEGLSurfaceTextureWayland::update(const QRegion &region)
     }
 }
 
+bool BasicEGLSurfaceTextureWayland::evict()
+{
+    // Only the shm textures hold a copy of the buffer, the others import the client's memory.
+    // The copy can be made again as long as the client hasn't been allowed to reuse the buffer.
+    if (m_bufferType != BufferType::Shm || !m_pixmap->buffer() || m_pixmap->buffer()->isReleased()) {
+        return false;
+    }
+    destroy();
+    return true;
+}
+
 bool BasicEGLSurfaceTextureWayland::loadShmTexture(KWaylandServer::ShmClientBuffer *buffer)
 {
     const QImage &image = buffer->data();
@@ -74,12 +93,22 @@ bool BasicEGLSurfaceTextureWayland::loadShmTexture(KWaylandServer::ShmClientBuff
         return false;
     }
 
-    m_texture.reset(new GLTexture(image));
+    // small surfaces such as menus and tooltips share textures so they can be batched
+    if (GLTextureAtlas *atlas = GLTextureAtlas::instance()) {
+        m_texture = atlas->upload(image);
+    }
+    if (!m_texture) {
+        m_texture.reset(new GLTexture(image));
+    }
+    m_texture->setMemoryCategory(GLTexture::MemoryCategory::Window);
     m_texture->setFilter(GL_LINEAR);
     m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
     m_texture->setYInverted(true);
     m_bufferType = BufferType::Shm;
 
+    // The pixels have been copied by glTexImage2D() when it returns.
+    m_pixmap->releaseShmBuffer();
+
     return true;
 }
 
@@ -97,9 +126,9 @@ void BasicEGLSurfaceTextureWayland::updateShmTexture(KWaylandServer::ShmClientBu
     }
 
     const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region);
-    for (const QRect &rect : damage) {
-        m_texture->update(image, rect.topLeft(), rect);
-    }
+    m_texture->update(image, damage);
+
+    m_pixmap->releaseShmBuffer();
 }
 
 bool BasicEGLSurfaceTextureWayland::loadEglTexture(KWaylandServer::DrmClientBuffer *buffer)
@@ -156,21 +185,19 @@ void BasicEGLSurfaceTextureWayland::updateEglTexture(KWaylandServer::DrmClientBu
 bool BasicEGLSurfaceTextureWayland::loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
 {
     auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    if (Q_UNLIKELY(dmabuf->images().constFirst() == EGL_NO_IMAGE_KHR)) {
+    if (Q_UNLIKELY(!dmabuf->ensureImported())) {
         qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
         return false;
     }
 
-    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
-    m_texture->setSize(dmabuf->size());
-    m_texture->create();
-    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-    m_texture->setFilter(GL_NEAREST);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
+    m_texture = dmabuf->takeTexture();
+    if (!m_texture) {
+        m_texture = createDmabufTexture(dmabuf);
+    }
     m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
     m_bufferType = BufferType::DmaBuf;
+    m_dmabuf = buffer;
+    waitForAcquireFence();
 
     return true;
 }
@@ -183,13 +210,59 @@ void BasicEGLSurfaceTextureWayland::updateDmabufTexture(KWaylandServer::LinuxDma
         return;
     }
 
+    // The texture samples the memory of the dma-buf, so it only has to be changed if the
+    // client has attached another buffer. Clients cycle through a few buffers, each of them
+    // keeps its own texture so the images don't have to be bound again on every frame.
     auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
+    if (m_dmabuf != buffer) {
+        if (Q_UNLIKELY(!dmabuf->ensureImported())) {
+            qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
+            return;
+        }
+        std::unique_ptr<GLTexture> texture = dmabuf->takeTexture();
+        if (!texture && !m_dmabuf) {
+            m_texture->bind();
+            glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
+            m_texture->unbind();
+        } else {
+            if (m_dmabuf) {
+                static_cast<EglDmabufBuffer *>(m_dmabuf.data())->setTexture(std::move(m_texture));
+            }
+            m_texture = texture ? std::move(texture) : createDmabufTexture(dmabuf);
+        }
+        m_dmabuf = buffer;
+    }
     // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
     // of Y-inverted is the inverse of OpenGL.
     m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    waitForAcquireFence();
+}
+
+std::unique_ptr<GLTexture> BasicEGLSurfaceTextureWayland::createDmabufTexture(EglDmabufBuffer *buffer)
+{
+    auto texture = std::make_unique<GLTexture>(GL_TEXTURE_2D);
+    texture->setSize(buffer->size());
+    texture->create();
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    texture->setFilter(GL_NEAREST);
+    texture->bind();
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(buffer->images().constFirst()));
+    texture->unbind();
+    return texture;
+}
+
+void BasicEGLSurfaceTextureWayland::waitForAcquireFence()
+{
+    // If the buffer is synchronized explicitly, make the GPU wait until the client has
+    // finished rendering it, the compositor itself doesn't have to block.
+    KWaylandServer::SurfaceInterface *surface = m_pixmap->surface();
+    if (!surface || !surface->acquireFence().isValid()) {
+        return;
+    }
+    const EGLNativeFence fence(backend()->eglDisplay(), surface->acquireFence());
+    if (!fence.waitSync()) {
+        qCWarning(KWIN_OPENGL) << "Failed to wait for the acquire fence of a dma-buf buffer";
+    }
 }
 
 EGLImageKHR BasicEGLSurfaceTextureWayland::attach(KWaylandServer::DrmClientBuffer *buffer)
@@ -8,6 +8,8 @@
 
 #include "openglsurfacetexture_wayland.h"
 
+#include <QPointer>
+
 #include <epoxy/egl.h>
 
 namespace KWaylandServer
@@ -21,6 +23,7 @@ namespace KWin
 {
 
 class AbstractEglBackend;
+class EglDmabufBuffer;
 
 class KWIN_EXPORT BasicEGLSurfaceTextureWayland : public OpenGLSurfaceTextureWayland
 {
@@ -32,6 +35,7 @@ public:
 
     bool create() override;
     void update(const QRegion &region) override;
+    bool evict() override;
 
 private:
     bool loadShmTexture(KWaylandServer::ShmClientBuffer *buffer);
@@ -40,6 +44,8 @@ private:
     void updateEglTexture(KWaylandServer::DrmClientBuffer *buffer);
     bool loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
     void updateDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
+    std::unique_ptr<GLTexture> createDmabufTexture(EglDmabufBuffer *buffer);
+    void waitForAcquireFence();
     EGLImageKHR attach(KWaylandServer::DrmClientBuffer *buffer);
     void destroy();
 
@@ -51,6 +57,8 @@ private:
     };
 
     EGLImageKHR m_image = EGL_NO_IMAGE_KHR;
+    // the dma-buf buffer that the texture is bound to
+    QPointer<KWaylandServer::LinuxDmaBufV1ClientBuffer> m_dmabuf;
     BufferType m_bufferType = BufferType::None;
 };
 
@@ -10,11 +10,16 @@
 #include "egl_dmabuf.h"
 #include "kwineglext.h"
 #include "kwineglutils_p.h"
+#include "kwingltexture.h"
 
 #include "utils/common.h"
 #include "wayland_server.h"
 
+#include <QtConcurrent>
+
+#include <algorithm>
 #include <drm_fourcc.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace KWin
@@ -112,6 +117,12 @@ EglDmabufBuffer::EglDmabufBuffer(const QVector<EGLImage> &images,
 
 EglDmabufBuffer::~EglDmabufBuffer()
 {
+    // The client may create a buffer for the same dma-buf again, e.g. when it resizes its
+    // swapchain or hands the buffer over to another surface.
+    if (m_importType == ImportType::Direct && m_images.count() == 1 && m_images.constFirst() != EGL_NO_IMAGE_KHR) {
+        m_interfaceImpl->recycleImage(attributes(), m_images.constFirst(), std::move(m_texture));
+        m_images.clear();
+    }
     removeImages();
 }
 
@@ -128,15 +139,70 @@ void EglDmabufBuffer::setImages(const QVector<EGLImage> &images)
 void EglDmabufBuffer::removeImages()
 {
     for (auto image : qAsConst(m_images)) {
-        eglDestroyImageKHR(m_interfaceImpl->m_backend->eglDisplay(), image);
+        if (image != EGL_NO_IMAGE_KHR) {
+            eglDestroyImageKHR(m_interfaceImpl->m_backend->eglDisplay(), image);
+        }
     }
     m_images.clear();
+    if (m_texture) {
+        m_interfaceImpl->m_backend->makeCurrent();
+        m_texture.reset();
+    }
+}
+
+bool EglDmabufBuffer::ensureImported()
+{
+    if (!m_images.isEmpty() && m_images.constFirst() != EGL_NO_IMAGE_KHR) {
+        return true;
+    }
+    if (m_importFailed) {
+        return false;
+    }
+    const EGLImage image = m_interfaceImpl->m_backend->importDmaBufAsImage(attributes());
+    if (image == EGL_NO_IMAGE_KHR) {
+        m_importFailed = true;
+        return false;
+    }
+    m_images = {image};
+    return true;
+}
+
+std::unique_ptr<GLTexture> EglDmabufBuffer::takeTexture()
+{
+    return std::move(m_texture);
+}
+
+void EglDmabufBuffer::setTexture(std::unique_ptr<GLTexture> &&texture)
+{
+    m_texture = std::move(texture);
+}
+
+KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::takeCachedImport(DmaBufAttributes &attrs, quint32 flags)
+{
+    ImportKey key;
+    if (!makeImportKey(attrs, &key)) {
+        return nullptr;
+    }
+    auto it = std::find_if(m_importCache.begin(), m_importCache.end(), [&key](const CachedImport &import) {
+        return import.key == key;
+    });
+    if (it == m_importCache.end()) {
+        return nullptr;
+    }
+    auto buffer = new EglDmabufBuffer(it->image, std::move(attrs), flags, this);
+    buffer->setTexture(std::move(it->texture));
+    m_importCache.erase(it);
+    return buffer;
 }
 
 KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::importBuffer(DmaBufAttributes &&attrs, quint32 flags)
 {
     Q_ASSERT(attrs.planeCount > 0);
 
+    if (auto buffer = takeCachedImport(attrs, flags)) {
+        return buffer;
+    }
+
     // Try first to import as a single image
     if (auto *img = m_backend->importDmaBufAsImage(attrs)) {
         return new EglDmabufBuffer(img, std::move(attrs), flags, this);
@@ -150,6 +216,121 @@ KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::importBuffer(DmaBufAttribu
     return nullptr;
 }
 
+void EglDmabuf::importBufferAsync(DmaBufAttributes &&attrs, quint32 flags, ImportCallback callback)
+{
+    Q_ASSERT(attrs.planeCount > 0);
+
+    if (auto buffer = takeCachedImport(attrs, flags)) {
+        callback(buffer);
+        return;
+    }
+
+    // Images of dma-bufs are created without a context, so the thread pool can create them,
+    // EGL displays are thread safe.
+    auto sharedAttrs = std::make_shared<DmaBufAttributes>(std::move(attrs));
+    AbstractEglBackend *backend = m_backend;
+    auto watcher = std::make_unique<QFutureWatcher<EGLImage>>();
+    QFutureWatcher<EGLImage> *rawWatcher = watcher.get();
+    QObject::connect(rawWatcher, &QFutureWatcher<EGLImage>::finished, rawWatcher, [this, rawWatcher, sharedAttrs, flags, callback]() {
+        const EGLImage image = rawWatcher->result();
+        auto it = std::find_if(m_pendingImports.begin(), m_pendingImports.end(), [rawWatcher](const auto &watcher) {
+            return watcher.get() == rawWatcher;
+        });
+        // The watcher can't be destroyed while it emits the signal.
+        it->release()->deleteLater();
+        m_pendingImports.erase(it);
+
+        if (image == EGL_NO_IMAGE_KHR) {
+            callback(nullptr);
+        } else {
+            callback(new EglDmabufBuffer(image, std::move(*sharedAttrs), flags, this));
+        }
+    });
+    rawWatcher->setFuture(QtConcurrent::run([backend, sharedAttrs]() {
+        return backend->importDmaBufAsImage(*sharedAttrs);
+    }));
+    m_pendingImports.push_back(std::move(watcher));
+}
+
+KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::createBuffer(DmaBufAttributes &&attrs, quint32 flags)
+{
+    Q_ASSERT(attrs.planeCount > 0);
+
+    if (auto buffer = takeCachedImport(attrs, flags)) {
+        return buffer;
+    }
+    return new EglDmabufBuffer(EGL_NO_IMAGE_KHR, std::move(attrs), flags, this);
+}
+
+bool EglDmabuf::ImportKey::operator==(const ImportKey &other) const
+{
+    return inodes == other.inodes
+        && offsets == other.offsets
+        && pitches == other.pitches
+        && modifier == other.modifier
+        && format == other.format
+        && width == other.width
+        && height == other.height
+        && planeCount == other.planeCount;
+}
+
+bool EglDmabuf::makeImportKey(const DmaBufAttributes &attrs, ImportKey *key)
+{
+    for (int i = 0; i < attrs.planeCount; ++i) {
+        struct stat info;
+        if (fstat(attrs.fd[i].get(), &info) != 0) {
+            return false;
+        }
+        key->inodes[i] = info.st_ino;
+        key->offsets[i] = attrs.offset[i];
+        key->pitches[i] = attrs.pitch[i];
+    }
+    key->modifier = attrs.modifier;
+    key->format = attrs.format;
+    key->width = attrs.width;
+    key->height = attrs.height;
+    key->planeCount = attrs.planeCount;
+    return true;
+}
+
+void EglDmabuf::recycleImage(const DmaBufAttributes &attrs, EGLImage image, std::unique_ptr<GLTexture> &&texture)
+{
+    CachedImport import{ImportKey(), image, std::move(texture)};
+    if (!makeImportKey(attrs, &import.key)) {
+        destroyCachedImport(import);
+        return;
+    }
+    m_importCache.push_back(std::move(import));
+
+    static const int maxCount = [] {
+        bool ok = false;
+        const int count = qEnvironmentVariableIntValue("KWIN_DMABUF_IMPORT_CACHE_SIZE", &ok);
+        return ok ? std::max(count, 0) : 16;
+    }();
+    while (int(m_importCache.size()) > maxCount) {
+        destroyCachedImport(m_importCache.front());
+        m_importCache.erase(m_importCache.begin());
+    }
+}
+
+void EglDmabuf::destroyCachedImport(CachedImport &import)
+{
+    if (import.texture) {
+        // buffers are destroyed while dispatching client requests, not while rendering
+        m_backend->makeCurrent();
+        import.texture.reset();
+    }
+    eglDestroyImageKHR(m_backend->eglDisplay(), import.image);
+}
+
+void EglDmabuf::clearImportCache()
+{
+    for (CachedImport &import : m_importCache) {
+        destroyCachedImport(import);
+    }
+    m_importCache.clear();
+}
+
 KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::yuvImport(DmaBufAttributes &&attrs, quint32 flags)
 {
     YuvFormat yuvFormat;
@@ -221,11 +402,21 @@ EglDmabuf::EglDmabuf(AbstractEglBackend *backend)
 
 EglDmabuf::~EglDmabuf()
 {
+    for (const auto &watcher : m_pendingImports) {
+        watcher->disconnect();
+        watcher->waitForFinished();
+        if (watcher->result() != EGL_NO_IMAGE_KHR) {
+            eglDestroyImageKHR(m_backend->eglDisplay(), watcher->result());
+        }
+    }
+    m_pendingImports.clear();
+
     auto curBuffers = waylandServer()->linuxDmabufBuffers();
     for (auto *buffer : curBuffers) {
         auto *buf = static_cast<EglDmabufBuffer *>(buffer);
         buf->removeImages();
     }
+    clearImportCache();
 }
 
 const uint32_t s_multiPlaneFormats[] = {
@@ -13,11 +13,18 @@
 
 #include "linux_dmabuf.h"
 
+#include <QFutureWatcher>
 #include <QVector>
 
+#include <array>
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
 namespace KWin
 {
 class EglDmabuf;
+class GLTexture;
 
 class EglDmabufBuffer : public LinuxDmaBufV1ClientBuffer
 {
@@ -43,15 +50,33 @@ public:
     void setImages(const QVector<EGLImage> &images);
     void removeImages();
 
+    /**
+     * Imports the dma-buf if that has been put off until the buffer is used, and returns
+     * whether the buffer has a valid image.
+     */
+    bool ensureImported();
+
     QVector<EGLImage> images() const
     {
         return m_images;
     }
 
+    /**
+     * Takes the texture that has been bound to the image of this buffer before, if any.
+     */
+    std::unique_ptr<GLTexture> takeTexture();
+    /**
+     * Keeps the @a texture bound to the image of this buffer, so the next time the buffer is
+     * attached it doesn't have to be bound again.
+     */
+    void setTexture(std::unique_ptr<GLTexture> &&texture);
+
 private:
     QVector<EGLImage> m_images;
+    std::unique_ptr<GLTexture> m_texture;
     EglDmabuf *m_interfaceImpl;
     ImportType m_importType;
+    bool m_importFailed = false;
 };
 
 class KWIN_EXPORT EglDmabuf : public LinuxDmaBufV1RendererInterface
@@ -63,16 +88,53 @@ public:
     ~EglDmabuf() override;
 
     KWaylandServer::LinuxDmaBufV1ClientBuffer *importBuffer(DmaBufAttributes &&attrs, quint32 flags) override;
+    void importBufferAsync(DmaBufAttributes &&attrs, quint32 flags, ImportCallback callback) override;
+    KWaylandServer::LinuxDmaBufV1ClientBuffer *createBuffer(DmaBufAttributes &&attrs, quint32 flags) override;
 
     QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> tranches() const;
     QHash<uint32_t, QVector<uint64_t>> supportedFormats() const;
 
 private:
+    /**
+     * Identifies the memory and the layout of an imported dma-buf. Every dma-buf has its own
+     * inode, which the driver pins for as long as the image exists.
+     */
+    struct ImportKey
+    {
+        std::array<ino_t, 4> inodes = {};
+        std::array<uint32_t, 4> offsets = {};
+        std::array<uint32_t, 4> pitches = {};
+        uint64_t modifier = 0;
+        uint32_t format = 0;
+        int width = 0;
+        int height = 0;
+        int planeCount = 0;
+
+        bool operator==(const ImportKey &other) const;
+    };
+
+    struct CachedImport
+    {
+        ImportKey key;
+        EGLImage image;
+        std::unique_ptr<GLTexture> texture;
+    };
+
+    static bool makeImportKey(const DmaBufAttributes &attrs, ImportKey *key);
+    KWaylandServer::LinuxDmaBufV1ClientBuffer *takeCachedImport(DmaBufAttributes &attrs, quint32 flags);
+
     KWaylandServer::LinuxDmaBufV1ClientBuffer *yuvImport(DmaBufAttributes &&attrs, quint32 flags);
+    void recycleImage(const DmaBufAttributes &attrs, EGLImage image, std::unique_ptr<GLTexture> &&texture);
+    void destroyCachedImport(CachedImport &import);
+    void clearImportCache();
 
     void setSupportedFormatsAndModifiers();
 
     AbstractEglBackend *m_backend;
+    // the images of recently destroyed buffers, the most recent one comes last
+    std::vector<CachedImport> m_importCache;
+    // the test imports that run on the thread pool
+    std::vector<std::unique_ptr<QFutureWatcher<EGLImage>>> m_pendingImports;
     QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> m_tranches;
     QHash<uint32_t, QVector<uint64_t>> m_supportedFormats;
 
@@ -5,6 +5,7 @@
 */
 
 #include "eglnativefence.h"
+#include "utils/filedescriptor.h"
 
 #include <unistd.h>
 
@@ -13,6 +14,7 @@ namespace KWin
 
 #ifndef EGL_ANDROID_native_fence_sync
 #define EGL_SYNC_NATIVE_FENCE_ANDROID 0x3144
+#define EGL_SYNC_NATIVE_FENCE_FD_ANDROID 0x3145
 #define EGL_NO_NATIVE_FENCE_FD_ANDROID -1
 #endif // EGL_ANDROID_native_fence_sync
 
@@ -27,6 +29,23 @@ EGLNativeFence::EGLNativeFence(EGLDisplay display)
     }
 }
 
+EGLNativeFence::EGLNativeFence(EGLDisplay display, const FileDescriptor &fileDescriptor)
+    : m_display(display)
+{
+    m_fileDescriptor = dup(fileDescriptor.get());
+    const EGLint attributes[] = {
+        EGL_SYNC_NATIVE_FENCE_FD_ANDROID, m_fileDescriptor,
+        EGL_NONE};
+    m_sync = eglCreateSyncKHR(m_display, EGL_SYNC_NATIVE_FENCE_ANDROID, attributes);
+    if (m_sync != EGL_NO_SYNC_KHR) {
+        // The sync object owns the file descriptor now.
+        m_fileDescriptor = eglDupNativeFenceFDANDROID(m_display, m_sync);
+    } else {
+        close(m_fileDescriptor);
+        m_fileDescriptor = EGL_NO_NATIVE_FENCE_FD_ANDROID;
+    }
+}
+
 EGLNativeFence::~EGLNativeFence()
 {
     if (m_fileDescriptor != EGL_NO_NATIVE_FENCE_FD_ANDROID) {
@@ -47,4 +66,12 @@ int EGLNativeFence::fileDescriptor() const
     return m_fileDescriptor;
 }
 
+bool EGLNativeFence::waitSync() const
+{
+    if (m_sync == EGL_NO_SYNC_KHR) {
+        return false;
+    }
+    return eglWaitSyncKHR(m_display, m_sync, 0) == EGL_TRUE;
+}
+
 } // namespace KWin
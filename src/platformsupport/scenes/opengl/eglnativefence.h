@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "kwin_export.h"
+
 #include <QtGlobal>
 
 #include <epoxy/egl.h>
@@ -13,15 +15,30 @@
 namespace KWin
 {
 
-class EGLNativeFence
+class FileDescriptor;
+
+class KWIN_EXPORT EGLNativeFence
 {
 public:
+    /**
+     * Creates a fence for the rendering commands that have been submitted so far.
+     */
     explicit EGLNativeFence(EGLDisplay display);
+    /**
+     * Imports the sync file @a fileDescriptor, e.g. a client's acquire fence.
+     */
+    EGLNativeFence(EGLDisplay display, const FileDescriptor &fileDescriptor);
     ~EGLNativeFence();
 
     bool isValid() const;
     int fileDescriptor() const;
 
+    /**
+     * Makes the GPU wait for the fence before executing the commands submitted afterwards.
+     * The CPU is not blocked.
+     */
+    bool waitSync() const;
+
 private:
     EGLSyncKHR m_sync = EGL_NO_SYNC_KHR;
     EGLDisplay m_display = EGL_NO_DISPLAY;
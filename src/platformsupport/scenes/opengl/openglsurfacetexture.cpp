@@ -6,6 +6,9 @@
 
 #include "openglsurfacetexture.h"
 #include "kwingltexture.h"
+#include "kwinglutils.h"
+
+#include <cmath>
 
 namespace KWin
 {
@@ -34,4 +37,86 @@ GLTexture *OpenGLSurfaceTexture::texture() const
     return m_texture.get();
 }
 
+bool OpenGLSurfaceTexture::evict()
+{
+    return false;
+}
+
+std::chrono::steady_clock::time_point OpenGLSurfaceTexture::lastUsed() const
+{
+    return m_lastUsed;
+}
+
+void OpenGLSurfaceTexture::setLastUsed(std::chrono::steady_clock::time_point timestamp)
+{
+    m_lastUsed = timestamp;
+}
+
+GLTexture *OpenGLSurfaceTexture::downscaledTexture()
+{
+    // External textures would need a shader of their own, rectangle textures can't have mipmaps.
+    if (!m_texture || m_texture->target() != GL_TEXTURE_2D || !GLTexture::framebufferObjectSupported()) {
+        return nullptr;
+    }
+
+    const QSize size((m_texture->width() + 1) / 2, (m_texture->height() + 1) / 2);
+    if (size.width() < 2 || size.height() < 2) {
+        return nullptr;
+    }
+
+    if (!m_downscaledTexture || m_downscaledTexture->size() != size) {
+        m_downscaledFramebuffer.reset();
+        const int levels = std::floor(std::log2(std::max(size.width(), size.height()))) + 1;
+        m_downscaledTexture = std::make_unique<GLTexture>(GL_RGBA8, size, levels);
+        m_downscaledTexture->setMemoryCategory(GLTexture::MemoryCategory::Window);
+        m_downscaledTexture->setFilter(GL_LINEAR_MIPMAP_LINEAR);
+        m_downscaledTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_downscaledFramebuffer = std::make_unique<GLFramebuffer>(m_downscaledTexture.get());
+        m_downscaledTextureDirty = true;
+    }
+    if (!m_downscaledFramebuffer->valid()) {
+        return nullptr;
+    }
+
+    if (m_downscaledTextureDirty) {
+        // At half the size, each pixel samples the middle of four texels, so linear filtering
+        // averages them. The smaller levels are made from this one by the driver.
+        GLFramebuffer::pushFramebuffer(m_downscaledFramebuffer.get());
+        GLState::setBlendEnabled(false);
+
+        QMatrix4x4 projectionMatrix;
+        projectionMatrix.ortho(QRect(QPoint(0, 0), size));
+
+        ShaderBinder binder(ShaderTrait::MapTexture);
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+
+        m_texture->setFilter(GL_LINEAR);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_texture->bind();
+        m_texture->render(QRect(QPoint(0, 0), size));
+        m_texture->unbind();
+
+        GLFramebuffer::popFramebuffer();
+
+        m_downscaledTexture->bind();
+        m_downscaledTexture->generateMipmaps();
+        m_downscaledTexture->unbind();
+        m_downscaledTextureDirty = false;
+    }
+
+    return m_downscaledTexture.get();
+}
+
+void OpenGLSurfaceTexture::invalidateDownscaledTexture()
+{
+    m_downscaledTextureDirty = true;
+}
+
+void OpenGLSurfaceTexture::discardDownscaledTexture()
+{
+    m_downscaledFramebuffer.reset();
+    m_downscaledTexture.reset();
+    m_downscaledTextureDirty = true;
+}
+
 } // namespace KWin
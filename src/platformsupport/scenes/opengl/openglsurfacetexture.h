@@ -8,9 +8,12 @@
 
 #include "surfaceitem.h"
 
+#include <chrono>
+
 namespace KWin
 {
 
+class GLFramebuffer;
 class GLTexture;
 class OpenGLBackend;
 
@@ -27,10 +30,44 @@ public:
 
     virtual bool create() = 0;
     virtual void update(const QRegion &region) = 0;
+    /**
+     * Destroys the texture to free the memory that it takes, it's created again the next time
+     * the surface is painted. Returns @c false if the texture doesn't own any memory or it can't
+     * be created again, e.g. because the client buffer has already been released.
+     */
+    virtual bool evict();
+
+    /**
+     * The last time the texture has been painted.
+     */
+    std::chrono::steady_clock::time_point lastUsed() const;
+    void setLastUsed(std::chrono::steady_clock::time_point timestamp);
+
+    /**
+     * Returns a copy of the texture at half its size with a full mip chain, for drawing the
+     * surface at less than half its size, e.g. in thumbnails. The copy is made the first time
+     * it's needed after the texture has been damaged. Returns @c nullptr if the texture can't
+     * be downscaled.
+     */
+    GLTexture *downscaledTexture();
+    /**
+     * Notifies that the texture has changed, the downscaled copy is made again when it's used.
+     */
+    void invalidateDownscaledTexture();
+    /**
+     * Destroys the downscaled copy to free the memory that it takes.
+     */
+    void discardDownscaledTexture();
 
 protected:
     OpenGLBackend *m_backend;
     std::unique_ptr<GLTexture> m_texture;
+    std::chrono::steady_clock::time_point m_lastUsed;
+
+private:
+    std::unique_ptr<GLTexture> m_downscaledTexture;
+    std::unique_ptr<GLFramebuffer> m_downscaledFramebuffer;
+    bool m_downscaledTextureDirty = true;
 };
 
 } // namespace KWin
@@ -29,6 +29,7 @@ bool QPainterSurfaceTextureWayland::create()
         // The buffer data is copied as the buffer interface returns a QImage
         // which doesn't own the data of the underlying wl_shm_buffer object.
         m_image = buffer->data().copy();
+        m_pixmap->releaseShmBuffer();
     }
     return !m_image.isNull();
 }
@@ -49,6 +50,9 @@ void QPainterSurfaceTextureWayland::update(const QRegion &region)
     for (const QRect &rect : dirtyRegion) {
         painter.drawImage(rect, image, rect);
     }
+    painter.end();
+
+    m_pixmap->releaseShmBuffer();
 }
 
 } // namespace KWin
@@ -100,7 +100,7 @@ bool InputDevice::isTouchpad() const
 
 ButtonRebindsFilter::ButtonRebindsFilter()
     : KWin::Plugin()
-    , KWin::InputEventFilter()
+    , KWin::InputEventFilter(KWin::InputEventType::Pointer | KWin::InputEventType::Tablet)
     , m_configWatcher(KConfigWatcher::create(KSharedConfig::openConfig("kcminputrc")))
 {
     KWin::input()->addInputDevice(&m_inputDevice);
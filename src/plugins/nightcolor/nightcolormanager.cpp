@@ -28,6 +28,8 @@
 #include <QDBusConnection>
 #include <QTimer>
 
+#include <cmath>
+
 namespace KWin
 {
 
@@ -212,7 +214,12 @@ bool NightColorManager::isAvailable() const
 
 int NightColorManager::currentTemperature() const
 {
-    return m_currentTemp;
+    const auto elapsed = std::chrono::steady_clock::now() - m_transitionStart;
+    if (m_transitionDuration <= std::chrono::milliseconds::zero() || elapsed >= m_transitionDuration) {
+        return m_transitionTargetTemp;
+    }
+    const qreal progress = std::chrono::duration<qreal>(elapsed) / m_transitionDuration;
+    return std::round(m_transitionStartTemp + (m_transitionTargetTemp - m_transitionStartTemp) * progress);
 }
 
 int NightColorManager::targetTemperature() const
@@ -336,21 +343,20 @@ void NightColorManager::cancelAllTimers()
 
 void NightColorManager::resetQuickAdjustTimer(int targetTemp)
 {
-    int tempDiff = qAbs(targetTemp - m_currentTemp);
+    int tempDiff = qAbs(targetTemp - currentTemperature());
     // allow tolerance of one TEMPERATURE_STEP to compensate if a slow update is coincidental
     if (tempDiff > TEMPERATURE_STEP) {
         cancelAllTimers();
+        const std::chrono::milliseconds duration(QUICK_ADJUST_DURATION / (m_previewTimer && m_previewTimer->isActive() ? 8 : 1));
+        commitGammaRamps(targetTemp, duration);
+
+        // the timer only marks the end of the transition, the color devices animate it
         m_quickAdjustTimer = new QTimer(this);
-        m_quickAdjustTimer->setSingleShot(false);
+        m_quickAdjustTimer->setSingleShot(true);
         connect(m_quickAdjustTimer, &QTimer::timeout, this, [this, targetTemp]() {
             quickAdjust(targetTemp);
         });
-
-        int interval = (QUICK_ADJUST_DURATION / (m_previewTimer && m_previewTimer->isActive() ? 8 : 1)) / (tempDiff / TEMPERATURE_STEP);
-        if (interval == 0) {
-            interval = 1;
-        }
-        m_quickAdjustTimer->start(interval);
+        m_quickAdjustTimer->start(duration);
     } else {
         resetSlowUpdateStartTimer();
     }
@@ -361,22 +367,13 @@ void NightColorManager::quickAdjust(int targetTemp)
     if (!m_quickAdjustTimer) {
         return;
     }
+    Q_UNUSED(targetTemp)
 
-    int nextTemp;
-
-    if (m_currentTemp < targetTemp) {
-        nextTemp = qMin(m_currentTemp + TEMPERATURE_STEP, targetTemp);
-    } else {
-        nextTemp = qMax(m_currentTemp - TEMPERATURE_STEP, targetTemp);
-    }
-    commitGammaRamps(nextTemp);
-
-    if (nextTemp == targetTemp) {
-        // stop timer, we reached the target temp
-        delete m_quickAdjustTimer;
-        m_quickAdjustTimer = nullptr;
-        resetSlowUpdateStartTimer();
-    }
+    // we reached the target temp
+    delete m_quickAdjustTimer;
+    m_quickAdjustTimer = nullptr;
+    Q_EMIT currentTemperatureChanged();
+    resetSlowUpdateStartTimer();
 }
 
 void NightColorManager::resetSlowUpdateStartTimer()
@@ -424,31 +421,23 @@ void NightColorManager::resetSlowUpdateTimer()
     const int targetTemp = isDay ? m_dayTargetTemp : m_nightTargetTemp;
 
     // We've reached the target color temperature or the transition time is zero.
-    if (m_prev.first == m_prev.second || m_currentTemp == targetTemp) {
+    if (m_prev.first == m_prev.second || currentTemperature() == targetTemp) {
         commitGammaRamps(targetTemp);
         return;
     }
 
     if (m_prev.first <= now && now <= m_prev.second) {
-        int availTime = now.msecsTo(m_prev.second);
-        m_slowUpdateTimer = new QTimer(this);
-        m_slowUpdateTimer->setSingleShot(false);
-        if (isDay) {
-            connect(m_slowUpdateTimer, &QTimer::timeout, this, [this]() {
-                slowUpdate(m_dayTargetTemp);
-            });
-        } else {
-            connect(m_slowUpdateTimer, &QTimer::timeout, this, [this]() {
-                slowUpdate(m_nightTargetTemp);
-            });
-        }
+        // The color devices interpolate the temperature until the end of the transition,
+        // on the frames that are rendered anyway, so the timer only marks its end.
+        const std::chrono::milliseconds availTime(now.msecsTo(m_prev.second));
+        commitGammaRamps(targetTemp, availTime);
 
-        // calculate interval such as temperature is changed by TEMPERATURE_STEP K per timer timeout
-        int interval = availTime * TEMPERATURE_STEP / qAbs(targetTemp - m_currentTemp);
-        if (interval == 0) {
-            interval = 1;
-        }
-        m_slowUpdateTimer->start(interval);
+        m_slowUpdateTimer = new QTimer(this);
+        m_slowUpdateTimer->setSingleShot(true);
+        connect(m_slowUpdateTimer, &QTimer::timeout, this, [this, targetTemp]() {
+            slowUpdate(targetTemp);
+        });
+        m_slowUpdateTimer->start(availTime);
     }
 }
 
@@ -457,18 +446,12 @@ void NightColorManager::slowUpdate(int targetTemp)
     if (!m_slowUpdateTimer) {
         return;
     }
-    int nextTemp;
-    if (m_currentTemp < targetTemp) {
-        nextTemp = qMin(m_currentTemp + TEMPERATURE_STEP, targetTemp);
-    } else {
-        nextTemp = qMax(m_currentTemp - TEMPERATURE_STEP, targetTemp);
-    }
-    commitGammaRamps(nextTemp);
-    if (nextTemp == targetTemp) {
-        // stop timer, we reached the target temp
-        delete m_slowUpdateTimer;
-        m_slowUpdateTimer = nullptr;
-    }
+    Q_UNUSED(targetTemp)
+
+    // we reached the target temp
+    delete m_slowUpdateTimer;
+    m_slowUpdateTimer = nullptr;
+    Q_EMIT currentTemperatureChanged();
 }
 
 void NightColorManager::preview(uint previewTemp)
@@ -669,14 +652,23 @@ int NightColorManager::currentTargetTemp() const
     }
 }
 
-void NightColorManager::commitGammaRamps(int temperature)
+void NightColorManager::commitGammaRamps(int temperature, std::chrono::milliseconds duration)
 {
+    const int previousTemp = currentTemperature();
+
     const QVector<ColorDevice *> devices = kwinApp()->colorManager()->devices();
     for (ColorDevice *device : devices) {
-        device->setTemperature(temperature);
+        device->setTemperature(temperature, duration);
     }
 
-    setCurrentTemperature(temperature);
+    m_transitionStartTemp = previousTemp;
+    m_transitionTargetTemp = temperature;
+    m_transitionStart = std::chrono::steady_clock::now();
+    m_transitionDuration = duration;
+
+    if (previousTemp != temperature) {
+        Q_EMIT currentTemperatureChanged();
+    }
 }
 
 void NightColorManager::autoLocationUpdate(double latitude, double longitude)
@@ -722,15 +714,6 @@ void NightColorManager::setRunning(bool running)
     Q_EMIT runningChanged();
 }
 
-void NightColorManager::setCurrentTemperature(int temperature)
-{
-    if (m_currentTemp == temperature) {
-        return;
-    }
-    m_currentTemp = temperature;
-    Q_EMIT currentTemperatureChanged();
-}
-
 void NightColorManager::setMode(NightColorMode mode)
 {
     if (m_mode == mode) {
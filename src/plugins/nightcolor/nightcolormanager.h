@@ -18,6 +18,8 @@
 
 #include <KConfigWatcher>
 
+#include <chrono>
+
 class QTimer;
 
 namespace KWin
@@ -190,6 +192,9 @@ public:
 
 public Q_SLOTS:
     void resetSlowUpdateStartTimer();
+    /**
+     * Finishes the quick transition to @a targetTemp, that has been started by resetQuickAdjustTimer().
+     */
     void quickAdjust(int targetTemp);
 
 Q_SIGNALS:
@@ -236,6 +241,9 @@ Q_SIGNALS:
 private:
     void readConfig();
     void hardReset();
+    /**
+     * Finishes the slow transition to @a targetTemp, that has been started by resetSlowUpdateTimer().
+     */
     void slowUpdate(int targetTemp);
     void resetAllTimers();
     int currentTargetTemp() const;
@@ -255,11 +263,14 @@ private:
     bool checkAutomaticSunTimings() const;
     bool daylight() const;
 
-    void commitGammaRamps(int temperature);
+    /**
+     * Moves the color devices to @a temperature. The devices animate the change over
+     * @a duration themselves, a zero duration applies it right away.
+     */
+    void commitGammaRamps(int temperature, std::chrono::milliseconds duration = std::chrono::milliseconds::zero());
 
     void setEnabled(bool enabled);
     void setRunning(bool running);
-    void setCurrentTemperature(int temperature);
     void setMode(NightColorMode mode);
 
     NightColorDBusInterface *m_iface;
@@ -300,7 +311,11 @@ private:
     QTimer *m_quickAdjustTimer = nullptr;
     QTimer *m_previewTimer = nullptr;
 
-    int m_currentTemp = DEFAULT_DAY_TEMPERATURE;
+    // the transition the color devices are running, the current temperature is derived from it
+    int m_transitionStartTemp = DEFAULT_DAY_TEMPERATURE;
+    int m_transitionTargetTemp = DEFAULT_DAY_TEMPERATURE;
+    std::chrono::steady_clock::time_point m_transitionStart;
+    std::chrono::milliseconds m_transitionDuration = std::chrono::milliseconds::zero();
     int m_targetTemperature = DEFAULT_DAY_TEMPERATURE;
     int m_dayTargetTemp = DEFAULT_DAY_TEMPERATURE;
     int m_nightTargetTemp = DEFAULT_NIGHT_TEMPERATURE;
@@ -112,6 +112,13 @@ std::shared_ptr<QOpenGLFramebufferObject> Window::swapFBO()
 {
     std::shared_ptr<QOpenGLFramebufferObject> fbo;
     m_contentFBO.swap(fbo);
+    if (fbo) {
+        m_presentedFBOs.push_back(fbo);
+        // two frames in flight are enough, anything older only wastes memory
+        if (m_presentedFBOs.size() > 2) {
+            m_presentedFBOs.erase(m_presentedFBOs.begin());
+        }
+    }
     return fbo;
 }
 
@@ -127,6 +134,21 @@ void Window::createFBO()
         return;
     }
     const QSize nativeSize = r.size() * m_scale;
+
+    // Reuse a framebuffer object that the scene doesn't hold onto anymore, allocating a new
+    // one every frame is expensive
+    std::erase_if(m_presentedFBOs, [&nativeSize](const auto &fbo) {
+        return fbo->size() != nativeSize;
+    });
+    for (auto it = m_presentedFBOs.begin(); it != m_presentedFBOs.end(); ++it) {
+        if (it->use_count() == 1) {
+            m_contentFBO = *it;
+            m_presentedFBOs.erase(it);
+            m_resized = false;
+            return;
+        }
+    }
+
     m_contentFBO.reset(new QOpenGLFramebufferObject(nativeSize.width(), nativeSize.height(), QOpenGLFramebufferObject::CombinedDepthStencil));
     if (!m_contentFBO->isValid()) {
         qCWarning(KWIN_QPA) << "Content FBO is not valid";
@@ -153,6 +175,7 @@ void Window::unmap()
     m_handle = nullptr;
 
     m_contentFBO = nullptr;
+    m_presentedFBOs.clear();
 }
 
 EGLSurface Window::eglSurface() const
@@ -15,6 +15,8 @@
 #include <QPointer>
 #include <qpa/qplatformwindow.h>
 
+#include <vector>
+
 class QOpenGLFramebufferObject;
 
 namespace KWin
@@ -53,6 +55,8 @@ private:
     QSurfaceFormat m_format;
     QPointer<InternalWindow> m_handle;
     std::shared_ptr<QOpenGLFramebufferObject> m_contentFBO;
+    // presented framebuffer objects, they are reused once the scene is done with them
+    std::vector<std::shared_ptr<QOpenGLFramebufferObject>> m_presentedFBOs;
     EGLDisplay m_eglDisplay = EGL_NO_DISPLAY;
     quint32 m_windowId;
     bool m_resized = false;
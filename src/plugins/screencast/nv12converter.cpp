@@ -0,0 +1,121 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "nv12converter.h"
+#include "kwinscreencast_logging.h"
+
+#include "kwinglplatform.h"
+#include "kwingltexture.h"
+#include "kwinglutils.h"
+
+#include <QMatrix4x4>
+#include <QTextStream>
+#include <QVector2D>
+
+namespace KWin
+{
+
+Nv12Converter::Nv12Converter()
+{
+    const bool gles = GLPlatform::instance()->isGLES();
+    const bool glsl_140 = !gles && GLPlatform::instance()->glslVersion() >= kVersionNumber(1, 40);
+    const bool core = glsl_140 || (gles && GLPlatform::instance()->glslVersion() >= kVersionNumber(3, 0));
+
+    const QByteArray attribute = core ? "in" : "attribute";
+    const QByteArray texture2D = core ? "texture" : "texture2D";
+    const QByteArray fragColor = core ? "fragColor" : "gl_FragColor";
+
+    QByteArray header;
+    if (gles) {
+        if (core) {
+            header = "#version 300 es\n\n";
+        }
+        header += "precision highp float;\n";
+    } else if (glsl_140) {
+        header = "#version 140\n\n";
+    }
+
+    QByteArray vertexSource;
+    QTextStream stream(&vertexSource);
+    stream << header;
+    stream << "uniform mat4 modelViewProjectionMatrix;\n";
+    stream << attribute << " vec4 vertex;\n\n";
+    stream << "void main(void)\n";
+    stream << "{\n";
+    stream << "    gl_Position = modelViewProjectionMatrix * vertex;\n";
+    stream << "}\n";
+    stream.flush();
+
+    // The fragment coordinates address the rows of the buffer directly. The chroma of a 2x2
+    // block is sampled in its center, the linear filter of the source averages the block.
+    QByteArray fragmentSource;
+    QTextStream stream2(&fragmentSource);
+    stream2 << header;
+    stream2 << "uniform sampler2D sampler;\n";
+    stream2 << "uniform vec2 frameSize;\n";
+    if (core) {
+        stream2 << "out vec4 fragColor;\n";
+    }
+    stream2 << "\n";
+    stream2 << "void main(void)\n";
+    stream2 << "{\n";
+    stream2 << "    float value;\n";
+    stream2 << "    if (gl_FragCoord.y < frameSize.y) {\n";
+    stream2 << "        vec3 rgb = " << texture2D << "(sampler, gl_FragCoord.xy / frameSize).rgb;\n";
+    stream2 << "        value = 0.0625 + dot(rgb, vec3(0.1826, 0.6142, 0.0620));\n";
+    stream2 << "    } else {\n";
+    stream2 << "        float column = floor(gl_FragCoord.x * 0.5);\n";
+    stream2 << "        vec2 center = vec2(2.0 * column + 1.0, 2.0 * (gl_FragCoord.y - frameSize.y));\n";
+    stream2 << "        vec3 rgb = " << texture2D << "(sampler, center / frameSize).rgb;\n";
+    stream2 << "        if (gl_FragCoord.x - 2.0 * column < 1.0) {\n";
+    stream2 << "            value = 0.5 + dot(rgb, vec3(-0.1006, -0.3386, 0.4392));\n";
+    stream2 << "        } else {\n";
+    stream2 << "            value = 0.5 + dot(rgb, vec3(0.4392, -0.3989, -0.0403));\n";
+    stream2 << "        }\n";
+    stream2 << "    }\n";
+    stream2 << "    " << fragColor << " = vec4(value, 0.0, 0.0, 1.0);\n";
+    stream2 << "}\n";
+    stream2.flush();
+
+    m_shader = ShaderManager::instance()->loadShaderFromCode(vertexSource, fragmentSource);
+    if (m_shader->isValid()) {
+        m_frameSizeLocation = m_shader->uniformLocation("frameSize");
+    } else {
+        qCWarning(KWIN_SCREENCAST) << "Failed to compile the NV12 conversion shader";
+    }
+}
+
+Nv12Converter::~Nv12Converter() = default;
+
+bool Nv12Converter::isValid() const
+{
+    return m_shader->isValid();
+}
+
+QSize Nv12Converter::bufferSize(const QSize &frameSize)
+{
+    return QSize(frameSize.width(), frameSize.height() * 3 / 2);
+}
+
+void Nv12Converter::convert(GLTexture *source, GLFramebuffer *target)
+{
+    const QRect geometry(QPoint(), target->size());
+
+    ShaderManager::instance()->pushShader(m_shader.get());
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(geometry);
+    m_shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+    m_shader->setUniform(m_frameSizeLocation, QVector2D(source->width(), source->height()));
+
+    GLFramebuffer::pushFramebuffer(target);
+    source->bind();
+    source->setFilter(GL_LINEAR);
+    source->render(geometry);
+    source->unbind();
+    GLFramebuffer::popFramebuffer();
+
+    ShaderManager::instance()->popShader();
+}
+
+} // namespace KWin
@@ -0,0 +1,50 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QSize>
+
+#include <memory>
+
+namespace KWin
+{
+
+class GLFramebuffer;
+class GLShader;
+class GLTexture;
+
+/**
+ * The Nv12Converter converts RGB textures to NV12 on the GPU.
+ *
+ * Both planes are written in a single pass into an 8 bit single channel framebuffer that
+ * is as wide as the frame and one and a half times as high. The luma plane occupies the
+ * first rows, the interleaved and subsampled chroma plane the remaining ones. The colors
+ * are encoded with BT.709 coefficients in limited range, which is what hardware encoders
+ * expect by default.
+ */
+class Nv12Converter
+{
+public:
+    Nv12Converter();
+    ~Nv12Converter();
+
+    bool isValid() const;
+
+    /**
+     * Returns the size of the framebuffer that holds both planes of a @a frameSize frame.
+     */
+    static QSize bufferSize(const QSize &frameSize);
+
+    /**
+     * Converts @a source into @a target, which must have been created with bufferSize().
+     */
+    void convert(GLTexture *source, GLFramebuffer *target);
+
+private:
+    std::unique_ptr<GLShader> m_shader;
+    int m_frameSizeLocation = -1;
+};
+
+} // namespace KWin
@@ -43,6 +43,11 @@ void OutputScreenCastSource::render(QImage *image)
 }
 
 void OutputScreenCastSource::render(GLFramebuffer *target)
+{
+    renderDamage(target, infiniteRegion());
+}
+
+void OutputScreenCastSource::renderDamage(GLFramebuffer *target, const QRegion &damage)
 {
     const std::shared_ptr<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
     if (!outputTexture) {
@@ -50,6 +55,7 @@ void OutputScreenCastSource::render(GLFramebuffer *target)
     }
 
     const QRect geometry(QPoint(), textureSize());
+    const bool partial = damage != infiniteRegion();
 
     ShaderBinder shaderBinder(ShaderTrait::MapTexture);
     QMatrix4x4 projectionMatrix;
@@ -57,12 +63,23 @@ void OutputScreenCastSource::render(GLFramebuffer *target)
     shaderBinder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
 
     GLFramebuffer::pushFramebuffer(target);
+    if (partial) {
+        GLState::setScissorEnabled(true);
+    }
     outputTexture->bind();
-    outputTexture->render(geometry);
+    outputTexture->render(damage, geometry, partial);
     outputTexture->unbind();
+    if (partial) {
+        GLState::setScissorEnabled(false);
+    }
     GLFramebuffer::popFramebuffer();
 }
 
+std::shared_ptr<GLTexture> OutputScreenCastSource::texture() const
+{
+    return Compositor::self()->scene()->textureForOutput(m_output);
+}
+
 std::chrono::nanoseconds OutputScreenCastSource::clock() const
 {
     return m_output->renderLoop()->lastPresentationTimestamp();
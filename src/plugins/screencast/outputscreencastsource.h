@@ -27,6 +27,8 @@ public:
 
     void render(GLFramebuffer *target) override;
     void render(QImage *image) override;
+    void renderDamage(GLFramebuffer *target, const QRegion &damage) override;
+    std::shared_ptr<GLTexture> texture() const override;
     std::chrono::nanoseconds clock() const override;
 
 private:
@@ -12,8 +12,6 @@
 
 #include <KLocalizedString>
 
-#include <QSocketNotifier>
-
 namespace KWin
 {
 
@@ -26,8 +24,8 @@ PipeWireCore::PipeWireCore()
 
 PipeWireCore::~PipeWireCore()
 {
-    if (pwMainLoop) {
-        pw_loop_leave(pwMainLoop);
+    if (pwThreadLoop) {
+        pw_thread_loop_stop(pwThreadLoop);
     }
 
     if (pwCore) {
@@ -38,8 +36,8 @@ PipeWireCore::~PipeWireCore()
         pw_context_destroy(pwContext);
     }
 
-    if (pwMainLoop) {
-        pw_loop_destroy(pwMainLoop);
+    if (pwThreadLoop) {
+        pw_thread_loop_destroy(pwThreadLoop);
     }
 }
 
@@ -50,29 +48,25 @@ void PipeWireCore::onCoreError(void *data, uint32_t id, int seq, int res, const
     qCWarning(KWIN_SCREENCAST) << "PipeWire remote error: " << message;
     if (id == PW_ID_CORE && res == -EPIPE) {
         PipeWireCore *pw = static_cast<PipeWireCore *>(data);
-        Q_EMIT pw->pipewireFailed(QString::fromUtf8(message));
+        const QString errorMessage = QString::fromUtf8(message);
+        QMetaObject::invokeMethod(
+            pw, [pw, errorMessage]() {
+                Q_EMIT pw->pipewireFailed(errorMessage);
+            },
+            Qt::QueuedConnection);
     }
 }
 
 bool PipeWireCore::init()
 {
-    pwMainLoop = pw_loop_new(nullptr);
-    if (!pwMainLoop) {
+    pwThreadLoop = pw_thread_loop_new("kwin-pipewire", nullptr);
+    if (!pwThreadLoop) {
         qCWarning(KWIN_SCREENCAST, "Failed to create PipeWire loop: %s", strerror(errno));
         m_error = i18n("Failed to start main PipeWire loop");
         return false;
     }
-    pw_loop_enter(pwMainLoop);
-
-    QSocketNotifier *notifier = new QSocketNotifier(pw_loop_get_fd(pwMainLoop), QSocketNotifier::Read, this);
-    connect(notifier, &QSocketNotifier::activated, this, [this] {
-        int result = pw_loop_iterate(pwMainLoop, 0);
-        if (result < 0) {
-            qCWarning(KWIN_SCREENCAST) << "pipewire_loop_iterate failed: " << result;
-        }
-    });
 
-    pwContext = pw_context_new(pwMainLoop, nullptr, 0);
+    pwContext = pw_context_new(pw_thread_loop_get_loop(pwThreadLoop), nullptr, 0);
     if (!pwContext) {
         qCWarning(KWIN_SCREENCAST) << "Failed to create PipeWire context";
         m_error = i18n("Failed to create PipeWire context");
@@ -86,16 +80,37 @@ bool PipeWireCore::init()
         return false;
     }
 
-    if (pw_loop_iterate(pwMainLoop, 0) < 0) {
+    pw_core_add_listener(pwCore, &coreListener, &pwCoreEvents, this);
+
+    if (pw_thread_loop_start(pwThreadLoop) < 0) {
         qCWarning(KWIN_SCREENCAST) << "Failed to start main PipeWire loop";
         m_error = i18n("Failed to start main PipeWire loop");
         return false;
     }
 
-    pw_core_add_listener(pwCore, &coreListener, &pwCoreEvents, this);
     return true;
 }
 
+void PipeWireCore::lock()
+{
+    pw_thread_loop_lock(pwThreadLoop);
+}
+
+void PipeWireCore::unlock()
+{
+    pw_thread_loop_unlock(pwThreadLoop);
+}
+
+void PipeWireCore::wait()
+{
+    pw_thread_loop_wait(pwThreadLoop);
+}
+
+void PipeWireCore::signal()
+{
+    pw_thread_loop_signal(pwThreadLoop, false);
+}
+
 std::shared_ptr<PipeWireCore> PipeWireCore::self()
 {
     static std::weak_ptr<PipeWireCore> global;
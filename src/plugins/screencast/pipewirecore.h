@@ -17,6 +17,13 @@
 namespace KWin
 {
 
+/**
+ * The PipeWire connection is served by a PipeWire thread loop, so that negotiating formats,
+ * allocating buffers and the PipeWire protocol don't compete with compositing.
+ *
+ * The PipeWire objects may be used on the main thread only with the loop locked, see
+ * PipeWireLocker. The callbacks run on the PipeWire thread with the loop locked.
+ */
 class PipeWireCore : public QObject
 {
     Q_OBJECT
@@ -29,11 +36,19 @@ public:
 
     bool init();
 
+    void lock();
+    void unlock();
+    /**
+     * Releases the lock until signal() is called. It must only be called on the PipeWire thread.
+     */
+    void wait();
+    void signal();
+
     static std::shared_ptr<PipeWireCore> self();
 
     struct pw_core *pwCore = nullptr;
     struct pw_context *pwContext = nullptr;
-    struct pw_loop *pwMainLoop = nullptr;
+    struct pw_thread_loop *pwThreadLoop = nullptr;
     spa_hook coreListener;
     QString m_error;
 
@@ -43,4 +58,24 @@ Q_SIGNALS:
     void pipewireFailed(const QString &message);
 };
 
+/**
+ * Locks the PipeWire thread loop for its lifetime. The lock is recursive.
+ */
+class PipeWireLocker
+{
+public:
+    explicit PipeWireLocker(PipeWireCore *core)
+        : m_core(core)
+    {
+        m_core->lock();
+    }
+    ~PipeWireLocker()
+    {
+        m_core->unlock();
+    }
+
+private:
+    PipeWireCore *m_core;
+};
+
 } // namespace KWin
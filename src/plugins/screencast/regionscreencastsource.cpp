@@ -19,38 +19,75 @@
 namespace KWin
 {
 
-RegionScreenCastSource::RegionScreenCastSource(const QRect &region, qreal scale, QObject *parent)
-    : ScreenCastSource(parent)
-    , m_region(region)
+RegionScreenCastCapture::RegionScreenCastCapture(const QRect &region, qreal scale)
+    : m_region(region)
     , m_scale(scale)
 {
     Q_ASSERT(m_region.isValid());
     Q_ASSERT(m_scale > 0);
 }
 
-QSize RegionScreenCastSource::textureSize() const
+QSize RegionScreenCastCapture::textureSize() const
 {
     return m_region.size() * m_scale;
 }
 
-bool RegionScreenCastSource::hasAlphaChannel() const
+std::chrono::nanoseconds RegionScreenCastCapture::clock() const
 {
-    return true;
+    return m_last;
+}
+
+void RegionScreenCastCapture::start()
+{
+    if (m_started) {
+        return;
+    }
+    m_started = true;
+
+    const auto allOutputs = workspace()->outputs();
+    for (auto output : allOutputs) {
+        if (output->geometry().intersects(m_region)) {
+            connect(output, &Output::outputChange, this, [this, output](const QRegion &damage) {
+                handleOutputChange(output, damage);
+            });
+        }
+    }
+}
+
+void RegionScreenCastCapture::handleOutputChange(Output *output, const QRegion &damagedRegion)
+{
+    // Frames of the output that don't change anything in the region are of no interest.
+    const QRegion region = (output->pixelSize() != output->modeSize() ? output->geometry() : damagedRegion) & m_region;
+    if (region.isEmpty()) {
+        return;
+    }
+
+    updateOutput(output, region);
+    Q_EMIT damaged(scaleRegion(region.translated(-m_region.topLeft()), m_scale));
 }
 
-void RegionScreenCastSource::updateOutput(Output *output)
+void RegionScreenCastCapture::updateOutput(Output *output, const QRegion &damagedRegion)
 {
     m_last = output->renderLoop()->lastPresentationTimestamp();
 
     if (m_renderedTexture) {
         const std::shared_ptr<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(output);
         const auto outputGeometry = output->geometry();
-        if (!outputTexture || !m_region.intersects(output->geometry())) {
+        const QRect dirtyRect = (damagedRegion & m_region & outputGeometry).boundingRect();
+        if (!outputTexture || dirtyRect.isEmpty()) {
             return;
         }
 
+        // Only the damaged part of the region is copied from the output texture, the rest of
+        // the region keeps its contents. The framebuffer has its origin in the bottom left.
+        const QRect targetRect(std::floor((dirtyRect.x() - m_region.x()) * m_scale),
+                               std::floor((dirtyRect.y() - m_region.y()) * m_scale),
+                               std::ceil(dirtyRect.width() * m_scale),
+                               std::ceil(dirtyRect.height() * m_scale));
+
         GLFramebuffer::pushFramebuffer(m_target.get());
-        const QRect geometry({0, 0}, m_target->size());
+        GLState::setScissorEnabled(true);
+        glScissor(targetRect.x(), m_target->size().height() - targetRect.y() - targetRect.height(), targetRect.width(), targetRect.height());
 
         ShaderBinder shaderBinder(ShaderTrait::MapTexture);
         QMatrix4x4 projectionMatrix;
@@ -64,27 +101,55 @@ void RegionScreenCastSource::updateOutput(Output *output)
         outputTexture->bind();
         outputTexture->render(output->geometry());
         outputTexture->unbind();
+        GLState::setScissorEnabled(false);
         GLFramebuffer::popFramebuffer();
     }
 }
 
-std::chrono::nanoseconds RegionScreenCastSource::clock() const
-{
-    return m_last;
-}
-
-void RegionScreenCastSource::render(GLFramebuffer *target)
+std::shared_ptr<GLTexture> RegionScreenCastCapture::texture()
 {
     if (!m_renderedTexture) {
-        m_renderedTexture.reset(new GLTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize()));
+        m_renderedTexture = std::make_shared<GLTexture>(GL_RGBA8, textureSize());
         m_target.reset(new GLFramebuffer(m_renderedTexture.get()));
         const auto allOutputs = workspace()->outputs();
         for (auto output : allOutputs) {
             if (output->geometry().intersects(m_region)) {
-                updateOutput(output);
+                updateOutput(output, output->geometry());
             }
         }
     }
+    return m_renderedTexture;
+}
+
+RegionScreenCastSource::RegionScreenCastSource(const std::shared_ptr<RegionScreenCastCapture> &capture, QObject *parent)
+    : ScreenCastSource(parent)
+    , m_capture(capture)
+{
+}
+
+QSize RegionScreenCastSource::textureSize() const
+{
+    return m_capture->textureSize();
+}
+
+bool RegionScreenCastSource::hasAlphaChannel() const
+{
+    return true;
+}
+
+std::chrono::nanoseconds RegionScreenCastSource::clock() const
+{
+    return m_capture->clock();
+}
+
+std::shared_ptr<GLTexture> RegionScreenCastSource::texture() const
+{
+    return m_capture->texture();
+}
+
+void RegionScreenCastSource::render(GLFramebuffer *target)
+{
+    const std::shared_ptr<GLTexture> texture = m_capture->texture();
 
     GLFramebuffer::pushFramebuffer(target);
     QRect r(QPoint(), target->size());
@@ -94,9 +159,9 @@ void RegionScreenCastSource::render(GLFramebuffer *target)
     projectionMatrix.ortho(r);
     shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
 
-    m_renderedTexture->bind();
-    m_renderedTexture->render(r);
-    m_renderedTexture->unbind();
+    texture->bind();
+    texture->render(r);
+    texture->unbind();
 
     ShaderManager::instance()->popShader();
     GLFramebuffer::popFramebuffer();
@@ -104,11 +169,7 @@ void RegionScreenCastSource::render(GLFramebuffer *target)
 
 void RegionScreenCastSource::render(QImage *image)
 {
-    GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
-    GLFramebuffer offscreenTarget(&offscreenTexture);
-
-    render(&offscreenTarget);
-    grabTexture(&offscreenTexture, image);
+    grabTexture(m_capture->texture().get(), image);
 }
 
 }
@@ -16,19 +16,17 @@ namespace KWin
 {
 class Output;
 
-class RegionScreenCastSource : public ScreenCastSource
+/**
+ * The RegionScreenCastCapture composes the contents of a region of the screen from the
+ * outputs that intersect it. It's shared by all streams that cast the same region at the
+ * same scale, so the region is composed once per frame regardless of the number of streams.
+ */
+class RegionScreenCastCapture : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit RegionScreenCastSource(const QRect &region, qreal scale, QObject *parent = nullptr);
-
-    bool hasAlphaChannel() const override;
-    QSize textureSize() const override;
-
-    void render(GLFramebuffer *target) override;
-    void render(QImage *image) override;
-    std::chrono::nanoseconds clock() const override;
+    explicit RegionScreenCastCapture(const QRect &region, qreal scale);
 
     QRect region() const
     {
@@ -38,14 +36,55 @@ public:
     {
         return m_scale;
     }
-    void updateOutput(Output *output);
+    QSize textureSize() const;
+    std::chrono::nanoseconds clock() const;
+
+    /**
+     * Returns the texture with the contents of the region. It's composed when it's needed
+     * for the first time and kept up to date afterwards.
+     */
+    std::shared_ptr<GLTexture> texture();
+
+    /**
+     * Starts tracking the outputs, it's fine to call it several times.
+     */
+    void start();
+
+Q_SIGNALS:
+    /**
+     * Emitted when the region has been updated, the @a damage is in texture coordinates.
+     */
+    void damaged(const QRegion &damage);
 
 private:
+    void updateOutput(Output *output, const QRegion &damagedRegion);
+    void handleOutputChange(Output *output, const QRegion &damage);
+
     const QRect m_region;
     const qreal m_scale;
     std::unique_ptr<GLFramebuffer> m_target;
-    std::unique_ptr<GLTexture> m_renderedTexture;
+    std::shared_ptr<GLTexture> m_renderedTexture;
     std::chrono::nanoseconds m_last;
+    bool m_started = false;
+};
+
+class RegionScreenCastSource : public ScreenCastSource
+{
+    Q_OBJECT
+
+public:
+    explicit RegionScreenCastSource(const std::shared_ptr<RegionScreenCastCapture> &capture, QObject *parent = nullptr);
+
+    bool hasAlphaChannel() const override;
+    QSize textureSize() const override;
+
+    void render(GLFramebuffer *target) override;
+    void render(QImage *image) override;
+    std::shared_ptr<GLTexture> texture() const override;
+    std::chrono::nanoseconds clock() const override;
+
+private:
+    const std::shared_ptr<RegionScreenCastCapture> m_capture;
 };
 
 } // namespace KWin
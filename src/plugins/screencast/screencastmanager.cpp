@@ -17,6 +17,7 @@
 #include "regionscreencastsource.h"
 #include "scene.h"
 #include "screencaststream.h"
+#include "screencastutils.h"
 #include "wayland/display.h"
 #include "wayland/output_interface.h"
 #include "wayland_server.h"
@@ -26,6 +27,10 @@
 
 #include <KLocalizedString>
 
+#include <QPointer>
+
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -38,23 +43,6 @@ ScreencastManager::ScreencastManager()
     connect(m_screencast, &KWaylandServer::ScreencastV1Interface::regionScreencastRequested, this, &ScreencastManager::streamRegion);
 }
 
-static QRegion scaleRegion(const QRegion &_region, qreal scale)
-{
-    if (scale == 1.) {
-        return _region;
-    }
-
-    QRegion region;
-    for (auto it = _region.begin(), itEnd = _region.end(); it != itEnd; ++it) {
-        region += QRect(std::floor(it->x() * scale),
-                        std::floor(it->y() * scale),
-                        std::ceil(it->width() * scale),
-                        std::ceil(it->height() * scale));
-    }
-
-    return region;
-}
-
 class WindowStream : public ScreenCastStream
 {
 public:
@@ -158,13 +146,54 @@ void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamV1Interface
             stream->recordFrame(scaleRegion(damagedRegion, streamOutput->scale()));
         }
     };
-    connect(stream, &ScreenCastStream::startStreaming, waylandStream, [streamOutput, stream, bufferToStream] {
+    connect(stream, &ScreenCastStream::startStreaming, waylandStream, [this, streamOutput, stream, bufferToStream] {
+        const uint framerate = stream->framerate();
+        setConsumerRate(streamOutput, stream, framerate ? framerate * 1000 : streamOutput->refreshRate());
         Compositor::self()->scene()->addRepaint(streamOutput->geometry());
         connect(streamOutput, &Output::outputChange, stream, bufferToStream);
     });
+    // An output that is only streamed isn't rendered until the stream starts, e.g. a virtual one.
+    setConsumerRate(streamOutput, stream, 0);
+    QPointer<Output> guardedOutput(streamOutput);
+    connect(stream, &QObject::destroyed, this, [this, guardedOutput, stream]() {
+        if (guardedOutput) {
+            removeConsumer(guardedOutput, stream);
+        }
+    });
     integrateStreams(waylandStream, stream);
 }
 
+void ScreencastManager::setConsumerRate(Output *output, ScreenCastStream *stream, int refreshRate)
+{
+    if (!m_consumerRates.contains(output)) {
+        connect(output, &QObject::destroyed, this, [this, output]() {
+            m_consumerRates.remove(output);
+        });
+    }
+    m_consumerRates[output].insert(stream, refreshRate);
+    updateConsumerRefreshRate(output);
+}
+
+void ScreencastManager::removeConsumer(Output *output, ScreenCastStream *stream)
+{
+    auto it = m_consumerRates.find(output);
+    if (it == m_consumerRates.end()) {
+        return;
+    }
+    it->remove(stream);
+    updateConsumerRefreshRate(output);
+}
+
+void ScreencastManager::updateConsumerRefreshRate(Output *output)
+{
+    const QHash<ScreenCastStream *, int> rates = m_consumerRates.value(output);
+    if (rates.isEmpty()) {
+        output->setConsumerRefreshRate(std::nullopt);
+    } else {
+        output->setConsumerRefreshRate(*std::max_element(rates.cbegin(), rates.cend()));
+    }
+}
+
 static QString rectToString(const QRect &rect)
 {
     return QStringLiteral("%1,%2 %3x%4").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
@@ -177,34 +206,38 @@ void ScreencastManager::streamRegion(KWaylandServer::ScreencastStreamV1Interface
         return;
     }
 
-    auto source = new RegionScreenCastSource(geometry, scale);
-    auto stream = new ScreenCastStream(source, this);
+    const std::shared_ptr<RegionScreenCastCapture> capture = regionCapture(geometry, scale);
+    auto stream = new ScreenCastStream(new RegionScreenCastSource(capture), this);
     stream->setObjectName(rectToString(geometry));
     stream->setCursorMode(mode, scale, geometry);
 
-    connect(stream, &ScreenCastStream::startStreaming, waylandStream, [geometry, stream, source] {
+    connect(stream, &ScreenCastStream::startStreaming, waylandStream, [geometry, stream, capture] {
         Compositor::self()->scene()->addRepaint(geometry);
-
-        const auto allOutputs = workspace()->outputs();
-        for (auto output : allOutputs) {
-            if (output->geometry().intersects(geometry)) {
-                auto bufferToStream = [output, stream, source](const QRegion &damagedRegion) {
-                    if (damagedRegion.isEmpty()) {
-                        return;
-                    }
-
-                    const QRect streamRegion = source->region();
-                    const QRegion region = output->pixelSize() != output->modeSize() ? output->geometry() : damagedRegion;
-                    source->updateOutput(output);
-                    stream->recordFrame(scaleRegion(region.translated(-streamRegion.topLeft()).intersected(streamRegion), source->scale()));
-                };
-                connect(output, &Output::outputChange, stream, bufferToStream);
-            }
-        }
+        capture->start();
+        connect(capture.get(), &RegionScreenCastCapture::damaged, stream, &ScreenCastStream::recordFrame);
     });
     integrateStreams(waylandStream, stream);
 }
 
+std::shared_ptr<RegionScreenCastCapture> ScreencastManager::regionCapture(const QRect &geometry, qreal scale)
+{
+    m_regionCaptures.erase(std::remove_if(m_regionCaptures.begin(), m_regionCaptures.end(), [](const auto &capture) {
+                               return capture.expired();
+                           }),
+                           m_regionCaptures.end());
+
+    for (const auto &weakCapture : m_regionCaptures) {
+        const auto capture = weakCapture.lock();
+        if (capture->region() == geometry && capture->scale() == scale) {
+            return capture;
+        }
+    }
+
+    auto capture = std::make_shared<RegionScreenCastCapture>(geometry, scale);
+    m_regionCaptures.push_back(capture);
+    return capture;
+}
+
 void ScreencastManager::integrateStreams(KWaylandServer::ScreencastStreamV1Interface *waylandStream, ScreenCastStream *stream)
 {
     connect(waylandStream, &KWaylandServer::ScreencastStreamV1Interface::finished, stream, &ScreenCastStream::stop);
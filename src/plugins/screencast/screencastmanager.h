@@ -12,9 +12,15 @@
 
 #include "wayland/screencast_v1_interface.h"
 
+#include <QHash>
+
+#include <memory>
+#include <vector>
+
 namespace KWin
 {
 class Output;
+class RegionScreenCastCapture;
 class ScreenCastStream;
 
 class ScreencastManager : public Plugin
@@ -43,9 +49,24 @@ private:
                       qreal scale,
                       KWaylandServer::ScreencastV1Interface::CursorMode mode);
 
+    /**
+     * Returns the capture shared by the streams of the region @a geometry at @a scale.
+     */
+    std::shared_ptr<RegionScreenCastCapture> regionCapture(const QRect &geometry, qreal scale);
+
     void integrateStreams(KWaylandServer::ScreencastStreamV1Interface *waylandStream, ScreenCastStream *stream);
 
+    /**
+     * Paces @a output to the frame rates of the streams that consume it.
+     */
+    void setConsumerRate(Output *output, ScreenCastStream *stream, int refreshRate);
+    void removeConsumer(Output *output, ScreenCastStream *stream);
+    void updateConsumerRefreshRate(Output *output);
+
     KWaylandServer::ScreencastV1Interface *m_screencast;
+    std::vector<std::weak_ptr<RegionScreenCastCapture>> m_regionCaptures;
+    // the refresh rates the streams of an output want, 0 while they don't stream
+    QHash<Output *, QHash<ScreenCastStream *, int>> m_consumerRates;
 };
 
 } // namespace KWin
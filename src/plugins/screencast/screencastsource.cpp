@@ -14,4 +14,15 @@ ScreenCastSource::ScreenCastSource(QObject *parent)
 {
 }
 
+void ScreenCastSource::renderDamage(GLFramebuffer *target, const QRegion &damage)
+{
+    Q_UNUSED(damage)
+    render(target);
+}
+
+std::shared_ptr<GLTexture> ScreenCastSource::texture() const
+{
+    return nullptr;
+}
+
 } // namespace KWin
@@ -7,11 +7,15 @@
 #pragma once
 
 #include <QObject>
+#include <QRegion>
+
+#include <memory>
 
 namespace KWin
 {
 
 class GLFramebuffer;
+class GLTexture;
 
 class ScreenCastSource : public QObject
 {
@@ -27,6 +31,18 @@ public:
     virtual void render(QImage *image) = 0;
     virtual std::chrono::nanoseconds clock() const = 0;
 
+    /**
+     * Renders the @a damage of the source into @a target, which already contains an earlier
+     * frame. The default implementation renders everything.
+     */
+    virtual void renderDamage(GLFramebuffer *target, const QRegion &damage);
+
+    /**
+     * Returns the texture with the contents of the source if it can be read back directly,
+     * otherwise @c null. The stream uses it to read memfd frames back asynchronously.
+     */
+    virtual std::shared_ptr<GLTexture> texture() const;
+
 Q_SIGNALS:
     void closed();
 };
@@ -11,6 +11,7 @@
 #include "core/platform.h"
 #include "core/renderbackend.h"
 #include "cursor.h"
+#include "cursortexturecache.h"
 #include "dmabuftexture.h"
 #include "eglnativefence.h"
 #include "kwineffects.h"
@@ -19,6 +20,7 @@
 #include "kwinglutils.h"
 #include "kwinscreencast_logging.h"
 #include "main.h"
+#include "nv12converter.h"
 #include "pipewirecore.h"
 #include "scene.h"
 #include "screencastsource.h"
@@ -28,6 +30,7 @@
 
 #include <QLoggingCategory>
 #include <QPainter>
+#include <QThread>
 
 #include <spa/buffer/meta.h>
 
@@ -55,6 +58,8 @@ uint32_t spaVideoFormatToDrmFormat(spa_video_format spa_format)
         return DRM_FORMAT_BGR888;
     case SPA_VIDEO_FORMAT_RGB:
         return DRM_FORMAT_RGB888;
+    case SPA_VIDEO_FORMAT_NV12:
+        return DRM_FORMAT_NV12;
     default:
         qCDebug(KWIN_SCREENCAST) << "unknown format" << spa_format;
         return DRM_FORMAT_INVALID;
@@ -66,29 +71,72 @@ void ScreenCastStream::onStreamStateChanged(void *data, pw_stream_state old, pw_
     ScreenCastStream *pw = static_cast<ScreenCastStream *>(data);
     qCDebug(KWIN_SCREENCAST) << "state changed" << pw_stream_state_as_string(old) << " -> " << pw_stream_state_as_string(state) << error_message;
 
+    if (state == PW_STREAM_STATE_ERROR) {
+        qCWarning(KWIN_SCREENCAST) << "Stream error: " << error_message;
+    }
+    pw->runOnMainThread([pw, state]() {
+        pw->streamStateChanged(state);
+    });
+}
+
+void ScreenCastStream::streamStateChanged(pw_stream_state state)
+{
     switch (state) {
     case PW_STREAM_STATE_ERROR:
-        qCWarning(KWIN_SCREENCAST) << "Stream error: " << error_message;
         break;
     case PW_STREAM_STATE_PAUSED:
-        if (pw->nodeId() == 0 && pw->pwStream) {
-            pw->pwNodeId = pw_stream_get_node_id(pw->pwStream);
-            Q_EMIT pw->streamReady(pw->nodeId());
+        if (nodeId() == 0 && pwStream) {
+            pwNodeId = pw_stream_get_node_id(pwStream);
+            Q_EMIT streamReady(nodeId());
         }
         break;
     case PW_STREAM_STATE_STREAMING:
-        Q_EMIT pw->startStreaming();
+        Q_EMIT startStreaming();
         break;
     case PW_STREAM_STATE_CONNECTING:
         break;
     case PW_STREAM_STATE_UNCONNECTED:
-        if (!pw->m_stopped) {
-            Q_EMIT pw->stopStreaming();
+        if (!m_stopped) {
+            Q_EMIT stopStreaming();
         }
         break;
     }
 }
 
+/**
+ * Hands @p task over to the main thread and waits until it has run. It's called from the stream
+ * callbacks, which run on the PipeWire thread with the loop locked, or on the main thread when
+ * the stream is set up or destroyed.
+ */
+void ScreenCastStream::runOnMainThread(const std::function<void()> &task)
+{
+    if (QThread::currentThread() == thread()) {
+        task();
+        return;
+    }
+    if (m_stopped) {
+        return;
+    }
+
+    m_mainThreadTask = task;
+    m_waitingForMainThread = true;
+    QMetaObject::invokeMethod(this, &ScreenCastStream::runMainThreadTask, Qt::QueuedConnection);
+    while (m_mainThreadTask) {
+        pwCore->wait();
+    }
+    m_waitingForMainThread = false;
+}
+
+void ScreenCastStream::runMainThreadTask()
+{
+    PipeWireLocker locker(pwCore.get());
+    if (m_mainThreadTask) {
+        m_mainThreadTask();
+        m_mainThreadTask = nullptr;
+        pwCore->signal();
+    }
+}
+
 #define CURSOR_BPP 4
 #define CURSOR_META_SIZE(w, h) (sizeof(struct spa_meta_cursor) + sizeof(struct spa_meta_bitmap) + w * h * CURSOR_BPP)
 static const int videoDamageRegionCount = 16;
@@ -100,12 +148,13 @@ void ScreenCastStream::newStreamParams()
     spa_pod_builder pod_builder = SPA_POD_BUILDER_INIT(paramsBuffer, sizeof(paramsBuffer));
     const int buffertypes = m_dmabufParams ? (1 << SPA_DATA_DmaBuf) : (1 << SPA_DATA_MemFd);
     const int bpp = videoFormat.format == SPA_VIDEO_FORMAT_RGB || videoFormat.format == SPA_VIDEO_FORMAT_BGR ? 3 : 4;
-    const int stride = SPA_ROUND_UP_N(m_resolution.width() * bpp, 4);
+    const int stride = isNv12() ? SPA_ROUND_UP_N(m_resolution.width(), 4) : SPA_ROUND_UP_N(m_resolution.width() * bpp, 4);
+    const int size = isNv12() ? stride * m_resolution.height() * 3 / 2 : stride * m_resolution.height();
 
     struct spa_pod_frame f;
     spa_pod_builder_push_object(&pod_builder, &f, SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers);
     spa_pod_builder_add(&pod_builder,
-                        SPA_PARAM_BUFFERS_size, SPA_POD_Int(stride * m_resolution.height()),
+                        SPA_PARAM_BUFFERS_size, SPA_POD_Int(size),
                         SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(16, 2, 16),
                         SPA_PARAM_BUFFERS_stride, SPA_POD_Int(stride),
                         SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(buffertypes), 0);
@@ -115,7 +164,7 @@ void ScreenCastStream::newStreamParams()
                             SPA_PARAM_BUFFERS_align, SPA_POD_Int(16), 0);
     } else {
         spa_pod_builder_add(&pod_builder,
-                            SPA_PARAM_BUFFERS_blocks, SPA_POD_Int(m_dmabufParams->planeCount), 0);
+                            SPA_PARAM_BUFFERS_blocks, SPA_POD_Int(isNv12() ? 2 : m_dmabufParams->planeCount), 0);
     }
     spa_pod *bufferPod = (spa_pod *)spa_pod_builder_pop(&pod_builder, &f);
 
@@ -144,8 +193,16 @@ void ScreenCastStream::onStreamParamChanged(void *data, uint32_t id, const struc
         return;
     }
 
+    // The dmabufs that are offered are tested by the compositor.
     ScreenCastStream *pw = static_cast<ScreenCastStream *>(data);
-    spa_format_video_raw_parse(format, &pw->videoFormat);
+    pw->runOnMainThread([pw, format]() {
+        pw->streamParamChanged(format);
+    });
+}
+
+void ScreenCastStream::streamParamChanged(const struct spa_pod *format)
+{
+    spa_format_video_raw_parse(format, &videoFormat);
     auto modifierProperty = spa_pod_find_prop(format, nullptr, SPA_FORMAT_VIDEO_modifier);
     QVector<uint64_t> receivedModifiers;
     if (modifierProperty) {
@@ -155,22 +212,27 @@ void ScreenCastStream::onStreamParamChanged(void *data, uint32_t id, const struc
         uint64_t *modifiers = (uint64_t *)SPA_POD_CHOICE_VALUES(modifierPod);
         receivedModifiers = QVector<uint64_t>(modifiers, modifiers + modifiersCount);
     }
-    if (modifierProperty && (!pw->m_dmabufParams || !receivedModifiers.contains(pw->m_dmabufParams->modifier))) {
-        if (modifierProperty->flags & SPA_POD_PROP_FLAG_DONT_FIXATE) {
-            pw->m_dmabufParams = kwinApp()->platform()->testCreateDmaBuf(pw->m_resolution, spaVideoFormatToDrmFormat(pw->videoFormat.format), receivedModifiers);
+    // Both NV12 planes live in a single linear R8 buffer, see Nv12Converter.
+    const uint32_t drmFormat = isNv12() ? DRM_FORMAT_R8 : spaVideoFormatToDrmFormat(videoFormat.format);
+    const QSize bufferSize = isNv12() ? Nv12Converter::bufferSize(m_resolution) : m_resolution;
+    if (modifierProperty && (!m_dmabufParams || m_dmabufParams->format != drmFormat || !receivedModifiers.contains(m_dmabufParams->modifier))) {
+        if (isNv12()) {
+            m_dmabufParams = kwinApp()->platform()->testCreateDmaBuf(bufferSize, drmFormat, {DRM_FORMAT_MOD_LINEAR});
+        } else if (modifierProperty->flags & SPA_POD_PROP_FLAG_DONT_FIXATE) {
+            m_dmabufParams = kwinApp()->platform()->testCreateDmaBuf(bufferSize, drmFormat, receivedModifiers);
         } else {
-            pw->m_dmabufParams = kwinApp()->platform()->testCreateDmaBuf(pw->m_resolution, spaVideoFormatToDrmFormat(pw->videoFormat.format), {DRM_FORMAT_MOD_INVALID});
+            m_dmabufParams = kwinApp()->platform()->testCreateDmaBuf(bufferSize, drmFormat, {DRM_FORMAT_MOD_INVALID});
         }
 
-        qCDebug(KWIN_SCREENCAST) << "Stream dmabuf modifiers received, offering our best suited modifier" << pw->m_dmabufParams.has_value();
+        qCDebug(KWIN_SCREENCAST) << "Stream dmabuf modifiers received, offering our best suited modifier" << m_dmabufParams.has_value();
         char buffer[2048];
-        auto params = pw->buildFormats(pw->m_dmabufParams.has_value(), buffer);
-        pw_stream_update_params(pw->pwStream, params.data(), params.count());
+        auto params = buildFormats(m_dmabufParams.has_value(), buffer);
+        pw_stream_update_params(pwStream, params.data(), params.count());
         return;
     }
 
     qCDebug(KWIN_SCREENCAST) << "Stream format found, defining buffers";
-    pw->newStreamParams();
+    newStreamParams();
 }
 
 void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
@@ -181,71 +243,104 @@ void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
     spa_data->mapoffset = 0;
     spa_data->flags = SPA_DATA_FLAG_READWRITE;
 
-    std::shared_ptr<DmaBufTexture> dmabuff;
-
+    // The dmabufs are allocated by the compositor, memfds are allocated on the PipeWire thread.
     if (spa_data[0].type != SPA_ID_INVALID && spa_data[0].type & (1 << SPA_DATA_DmaBuf)) {
-        Q_ASSERT(stream->m_dmabufParams);
-        dmabuff = kwinApp()->platform()->createDmaBufTexture(*stream->m_dmabufParams);
+        bool added = false;
+        stream->runOnMainThread([stream, buffer, &added]() {
+            added = stream->addDmaBuf(buffer);
+        });
+        if (added) {
+            return;
+        }
     }
 
-    if (dmabuff) {
-        spa_data->maxsize = dmabuff->attributes().pitch[0] * stream->m_resolution.height();
-
-        const DmaBufAttributes &dmabufAttribs = dmabuff->attributes();
-        Q_ASSERT(buffer->buffer->n_datas >= uint(dmabufAttribs.planeCount));
-        for (int i = 0; i < dmabufAttribs.planeCount; ++i) {
-            buffer->buffer->datas[i].type = SPA_DATA_DmaBuf;
-            buffer->buffer->datas[i].fd = dmabufAttribs.fd[i].get();
-            buffer->buffer->datas[i].data = nullptr;
-        }
-        stream->m_dmabufDataForPwBuffer.insert(buffer, dmabuff);
 #ifdef F_SEAL_SEAL // Disable memfd on systems that don't have it, like BSD < 12
-    } else {
-        if (!(spa_data[0].type & (1 << SPA_DATA_MemFd))) {
-            qCCritical(KWIN_SCREENCAST) << "memfd: Client doesn't support memfd buffer data type";
-            return;
-        }
+    if (!(spa_data[0].type & (1 << SPA_DATA_MemFd))) {
+        qCCritical(KWIN_SCREENCAST) << "memfd: Client doesn't support memfd buffer data type";
+        return;
+    }
 
-        const int bytesPerPixel = stream->m_source->hasAlphaChannel() ? 4 : 3;
-        const int stride = SPA_ROUND_UP_N(stream->m_resolution.width() * bytesPerPixel, 4);
-        spa_data->maxsize = stride * stream->m_resolution.height();
-        spa_data->type = SPA_DATA_MemFd;
-        spa_data->fd = memfd_create("kwin-screencast-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
-        if (spa_data->fd == -1) {
-            qCCritical(KWIN_SCREENCAST) << "memfd: Can't create memfd";
-            return;
-        }
-        spa_data->mapoffset = 0;
+    const int bytesPerPixel = stream->m_source->hasAlphaChannel() ? 4 : 3;
+    const int stride = SPA_ROUND_UP_N(stream->m_resolution.width() * bytesPerPixel, 4);
+    spa_data->maxsize = stride * stream->m_resolution.height();
+    spa_data->type = SPA_DATA_MemFd;
+    spa_data->fd = memfd_create("kwin-screencast-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (spa_data->fd == -1) {
+        qCCritical(KWIN_SCREENCAST) << "memfd: Can't create memfd";
+        return;
+    }
+    spa_data->mapoffset = 0;
 
-        if (ftruncate(spa_data->fd, spa_data->maxsize) < 0) {
-            qCCritical(KWIN_SCREENCAST) << "memfd: Can't truncate to" << spa_data->maxsize;
-            return;
-        }
+    if (ftruncate(spa_data->fd, spa_data->maxsize) < 0) {
+        qCCritical(KWIN_SCREENCAST) << "memfd: Can't truncate to" << spa_data->maxsize;
+        return;
+    }
+
+    unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+    if (fcntl(spa_data->fd, F_ADD_SEALS, seals) == -1) {
+        qCWarning(KWIN_SCREENCAST) << "memfd: Failed to add seals";
+    }
+
+    spa_data->data = mmap(nullptr,
+                          spa_data->maxsize,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED,
+                          spa_data->fd,
+                          spa_data->mapoffset);
+    if (spa_data->data == MAP_FAILED) {
+        qCCritical(KWIN_SCREENCAST) << "memfd: Failed to mmap memory";
+    } else {
+        qCDebug(KWIN_SCREENCAST) << "memfd: created successfully" << spa_data->data << spa_data->maxsize;
+    }
+#endif
+}
+
+bool ScreenCastStream::addDmaBuf(pw_buffer *buffer)
+{
+    Q_ASSERT(m_dmabufParams);
+    std::shared_ptr<DmaBufTexture> dmabuff = kwinApp()->platform()->createDmaBufTexture(*m_dmabufParams);
+    if (!dmabuff) {
+        return false;
+    }
 
-        unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
-        if (fcntl(spa_data->fd, F_ADD_SEALS, seals) == -1) {
-            qCWarning(KWIN_SCREENCAST) << "memfd: Failed to add seals";
+    const DmaBufAttributes &dmabufAttribs = dmabuff->attributes();
+    if (isNv12()) {
+        const int lumaSize = dmabufAttribs.pitch[0] * m_resolution.height();
+        Q_ASSERT(buffer->buffer->n_datas >= 2);
+        for (int i = 0; i < 2; ++i) {
+            buffer->buffer->datas[i].type = SPA_DATA_DmaBuf;
+            buffer->buffer->datas[i].flags = SPA_DATA_FLAG_READWRITE;
+            buffer->buffer->datas[i].mapoffset = 0;
+            buffer->buffer->datas[i].data = nullptr;
         }
+        // The planes share the buffer, the second one gets its own descriptor so that each
+        // data block can be closed on its own.
+        buffer->buffer->datas[0].fd = dmabufAttribs.fd[0].get();
+        buffer->buffer->datas[0].maxsize = lumaSize;
+        buffer->buffer->datas[1].fd = fcntl(dmabufAttribs.fd[0].get(), F_DUPFD_CLOEXEC, 0);
+        buffer->buffer->datas[1].maxsize = lumaSize / 2;
+    } else {
+        buffer->buffer->datas[0].maxsize = dmabufAttribs.pitch[0] * m_resolution.height();
 
-        spa_data->data = mmap(nullptr,
-                              spa_data->maxsize,
-                              PROT_READ | PROT_WRITE,
-                              MAP_SHARED,
-                              spa_data->fd,
-                              spa_data->mapoffset);
-        if (spa_data->data == MAP_FAILED) {
-            qCCritical(KWIN_SCREENCAST) << "memfd: Failed to mmap memory";
-        } else {
-            qCDebug(KWIN_SCREENCAST) << "memfd: created successfully" << spa_data->data << spa_data->maxsize;
+        Q_ASSERT(buffer->buffer->n_datas >= uint(dmabufAttribs.planeCount));
+        for (int i = 0; i < dmabufAttribs.planeCount; ++i) {
+            buffer->buffer->datas[i].type = SPA_DATA_DmaBuf;
+            buffer->buffer->datas[i].fd = dmabufAttribs.fd[i].get();
+            buffer->buffer->datas[i].data = nullptr;
         }
-#endif
     }
+    m_dmabufDataForPwBuffer.insert(buffer, dmabuff);
+    m_dmabufDamageForPwBuffer.insert(buffer, QRect(QPoint(), m_resolution));
+    return true;
 }
 
 void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 {
     ScreenCastStream *stream = static_cast<ScreenCastStream *>(data);
-    stream->m_dmabufDataForPwBuffer.remove(buffer);
+    // The compositor lets go of the buffer before it's unmapped.
+    stream->runOnMainThread([stream, buffer]() {
+        stream->removeBuffer(buffer);
+    });
 
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
@@ -259,6 +354,15 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
     }
 }
 
+void ScreenCastStream::removeBuffer(pw_buffer *buffer)
+{
+    m_dmabufDataForPwBuffer.remove(buffer);
+    m_dmabufDamageForPwBuffer.remove(buffer);
+    if (buffer == m_pendingBuffer) {
+        m_pendingReadback = {};
+    }
+}
+
 ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     : QObject(parent)
     , m_source(source)
@@ -271,14 +375,46 @@ ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     pwStreamEvents.remove_buffer = &ScreenCastStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &ScreenCastStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &ScreenCastStream::onStreamParamChanged;
+
+    m_pacingTimer.setSingleShot(true);
+    m_pacingTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_pacingTimer, &QTimer::timeout, this, [this]() {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+        }
+        recordFrame({});
+    });
 }
 
 ScreenCastStream::~ScreenCastStream()
 {
     m_stopped = true;
     if (pwStream) {
+        PipeWireLocker locker(pwCore.get());
+        // A callback that waits for the main thread is let go without its task, the stream
+        // can only be destroyed after the PipeWire thread is done with it.
+        while (m_waitingForMainThread) {
+            if (m_mainThreadTask) {
+                m_mainThreadTask = nullptr;
+                pwCore->signal();
+            }
+            pwCore->unlock();
+            QThread::yieldCurrentThread();
+            pwCore->lock();
+        }
         pw_stream_destroy(pwStream);
     }
+    if (m_readbackBuffer || m_nv12Converter) {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+            if (m_readbackBuffer) {
+                glDeleteBuffers(1, &m_readbackBuffer);
+            }
+            m_nv12SourceFramebuffer.reset();
+            m_nv12Source.reset();
+            m_nv12Converter.reset();
+        }
+    }
 }
 
 bool ScreenCastStream::init()
@@ -316,6 +452,8 @@ uint ScreenCastStream::nodeId()
 
 bool ScreenCastStream::createStream()
 {
+    PipeWireLocker locker(pwCore.get());
+
     const QByteArray objname = "kwin-screencast-" + objectName().toUtf8();
     pwStream = pw_stream_new(pwCore->pwCore, objname, nullptr);
 
@@ -325,6 +463,19 @@ bool ScreenCastStream::createStream()
     m_hasDmaBuf = kwinApp()->platform()->testCreateDmaBuf(m_resolution, drmFormat, {DRM_FORMAT_MOD_INVALID}).has_value();
     m_modifiers = Compositor::self()->backend()->supportedFormats().value(drmFormat);
 
+    // Hardware encoders consume NV12, offering it spares consumers the color conversion on
+    // the CPU. The chroma planes are subsampled, so the frame size must be even.
+    static const bool nv12Disabled = qEnvironmentVariableIsSet("KWIN_SCREENCAST_NO_NV12");
+    if (!nv12Disabled && m_hasDmaBuf && m_resolution.width() % 2 == 0 && m_resolution.height() % 2 == 0) {
+        if (kwinApp()->platform()->testCreateDmaBuf(Nv12Converter::bufferSize(m_resolution), DRM_FORMAT_R8, {DRM_FORMAT_MOD_LINEAR})) {
+            if (auto scene = Compositor::self()->scene()) {
+                scene->makeOpenGLContextCurrent();
+                m_nv12Converter = std::make_unique<Nv12Converter>();
+                m_hasNv12DmaBuf = m_nv12Converter->isValid();
+            }
+        }
+    }
+
     char buffer[2048];
     QVector<const spa_pod *> params = buildFormats(false, buffer);
 
@@ -365,15 +516,29 @@ void ScreenCastStream::stop()
 
 void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
 {
-    QRegion damagedRegion = _damagedRegion;
     Q_ASSERT(!m_stopped);
 
+    // The damage is kept until a frame is actually recorded, so a frame that is skipped
+    // or dropped isn't lost but merged into the next one.
+    m_pendingDamage += _damagedRegion;
+
+    const std::chrono::nanoseconds interval = frameInterval();
+    const std::chrono::nanoseconds now = std::chrono::steady_clock::now().time_since_epoch();
+    if (m_lastFrameTimestamp && now - *m_lastFrameTimestamp < interval) {
+        if (!m_pacingTimer.isActive()) {
+            m_pacingTimer.start(std::chrono::ceil<std::chrono::milliseconds>(*m_lastFrameTimestamp + interval - now));
+        }
+        return;
+    }
+    m_pacingTimer.stop();
+
     if (m_pendingBuffer) {
-        qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
+        qCDebug(KWIN_SCREENCAST) << "Delaying a screencast frame because the compositor is slow";
         return;
     }
 
     if (m_source->textureSize() != m_resolution) {
+        PipeWireLocker locker(pwCore.get());
         m_resolution = m_source->textureSize();
         newStreamParams();
         return;
@@ -388,12 +553,17 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
         return;
     }
 
+    // Buffers are dequeued and queued without the PipeWire lock, the stream hands them over
+    // to the PipeWire thread through lock-free queues.
     struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
 
     if (!buffer) {
         return;
     }
 
+    QRegion damagedRegion = std::exchange(m_pendingDamage, QRegion());
+    m_lastFrameTimestamp = now;
+
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
 
@@ -421,31 +591,68 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
         spa_data->chunk->size = dest.sizeInBytes();
         spa_data->chunk->stride = dest.bytesPerLine();
 
-        m_source->render(&dest);
-
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+        if (!startReadback(&dest)) {
+            m_source->render(&dest);
+            paintCursor(&dest);
         }
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
         Q_ASSERT(buf);
 
         const DmaBufAttributes &dmabufAttribs = buf->attributes();
-        Q_ASSERT(buffer->buffer->n_datas >= uint(dmabufAttribs.planeCount));
-        for (int i = 0; i < dmabufAttribs.planeCount; ++i) {
-            buffer->buffer->datas[i].chunk->stride = dmabufAttribs.pitch[i];
-            buffer->buffer->datas[i].chunk->offset = dmabufAttribs.offset[i];
+        if (isNv12()) {
+            for (int i = 0; i < 2; ++i) {
+                buffer->buffer->datas[i].chunk->stride = dmabufAttribs.pitch[0];
+                buffer->buffer->datas[i].chunk->offset = dmabufAttribs.offset[0] + i * dmabufAttribs.pitch[0] * size.height();
+                buffer->buffer->datas[i].chunk->size = buffer->buffer->datas[i].maxsize;
+            }
+        } else {
+            Q_ASSERT(buffer->buffer->n_datas >= uint(dmabufAttribs.planeCount));
+            for (int i = 0; i < dmabufAttribs.planeCount; ++i) {
+                buffer->buffer->datas[i].chunk->stride = dmabufAttribs.pitch[i];
+                buffer->buffer->datas[i].chunk->offset = dmabufAttribs.offset[i];
+            }
+            spa_data->chunk->size = spa_data->maxsize;
         }
-        spa_data->chunk->size = spa_data->maxsize;
-
-        m_source->render(buf->framebuffer());
 
         auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            GLFramebuffer::pushFramebuffer(buf->framebuffer());
+        const bool cursorVisible = m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos());
+        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded) {
+            const QRect cursorRect = cursorVisible ? cursorGeometry(cursor) : QRect();
+            damagedRegion += QRegion{m_cursor.lastRect} | cursorRect;
+            m_cursor.lastRect = cursorRect;
+        }
+        damagedRegion &= QRect(QPoint(), size);
+
+        // The dmabufs are persistent, only the parts that have changed since a buffer has been
+        // filled the last time need to be rendered again. If nothing has changed, the buffer
+        // is queued again with just the new metadata.
+        for (auto it = m_dmabufDamageForPwBuffer.begin(); it != m_dmabufDamageForPwBuffer.end(); ++it) {
+            it.value() += damagedRegion;
+        }
+        const QRegion bufferDamage = std::exchange(m_dmabufDamageForPwBuffer[buffer], QRegion());
+
+        // An NV12 frame is composed in an RGB texture that is kept up to date with the damage
+        // of every frame, and then converted into the buffer as a whole.
+        GLFramebuffer *target = buf->framebuffer();
+        QRegion targetDamage = bufferDamage;
+        if (isNv12()) {
+            if (!m_nv12Source || m_nv12Source->size() != size) {
+                m_nv12Source = std::make_unique<GLTexture>(GL_RGBA8, size);
+                m_nv12SourceFramebuffer = std::make_unique<GLFramebuffer>(m_nv12Source.get());
+                targetDamage = QRect(QPoint(), size);
+            } else {
+                targetDamage = damagedRegion;
+            }
+            target = m_nv12SourceFramebuffer.get();
+        }
+
+        if (!targetDamage.isEmpty()) {
+            m_source->renderDamage(target, targetDamage);
+        }
+
+        if (cursorVisible && !targetDamage.isEmpty() && !cursor->image().isNull()) {
+            GLFramebuffer::pushFramebuffer(target);
 
             QRect r(QPoint(), size);
             auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
@@ -454,27 +661,30 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
             mvp.ortho(r);
             shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
-            if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey()) {
-                m_cursor.texture.reset(new GLTexture(cursor->image()));
-            }
+            // The texture is shared with the cursor layers, it's only uploaded when the cursor
+            // shows an image that none of them has shown recently.
+            m_cursor.texture = CursorTextureCache::self()->texture(cursor->image());
 
+            const bool yInverted = m_cursor.texture->isYInverted();
             m_cursor.texture->setYInverted(false);
             m_cursor.texture->bind();
             const auto cursorRect = cursorGeometry(cursor);
             mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height());
             shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            GLState::setBlendEnabled(true);
+            GLState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             m_cursor.texture->render(cursorRect);
-            glDisable(GL_BLEND);
+            GLState::setBlendEnabled(false);
             m_cursor.texture->unbind();
+            m_cursor.texture->setYInverted(yInverted);
 
             ShaderManager::instance()->popShader();
             GLFramebuffer::popFramebuffer();
+        }
 
-            damagedRegion += QRegion{m_cursor.lastRect} | cursorRect;
-            m_cursor.lastRect = cursorRect;
+        if (isNv12() && !bufferDamage.isEmpty()) {
+            m_nv12Converter->convert(m_nv12Source.get(), buf->framebuffer());
         }
     }
 
@@ -488,6 +698,94 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
     tryEnqueue(buffer);
 }
 
+void ScreenCastStream::paintCursor(QImage *image)
+{
+    auto cursor = Cursors::self()->currentCursor();
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
+        QPainter painter(image);
+        const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+        painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+    }
+}
+
+bool ScreenCastStream::startReadback(QImage *image)
+{
+    static const bool asyncReadbackDisabled = qEnvironmentVariableIsSet("KWIN_SCREENCAST_NO_ASYNC_READBACK");
+    if (asyncReadbackDisabled || !hasGLVersion(3, 0)) {
+        return false;
+    }
+    const std::shared_ptr<GLTexture> texture = m_source->texture();
+    if (!texture || texture->size() != image->size()) {
+        return false;
+    }
+
+    if (!m_readbackBuffer) {
+        glGenBuffers(1, &m_readbackBuffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffer);
+    if (m_readbackBufferSize != image->sizeInBytes()) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, image->sizeInBytes(), nullptr, GL_STREAM_READ);
+        m_readbackBufferSize = image->sizeInBytes();
+    }
+
+    // The rows are packed with the default alignment of 4 bytes, like in the memfd.
+    GLFramebuffer framebuffer(texture.get());
+    GLFramebuffer::pushFramebuffer(&framebuffer);
+    glReadPixels(0, 0, image->width(), image->height(), image->hasAlphaChannel() ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    GLFramebuffer::popFramebuffer();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_pendingReadback.data = image->bits();
+    m_pendingReadback.size = image->size();
+    m_pendingReadback.stride = image->bytesPerLine();
+    m_pendingReadback.format = image->format();
+    m_pendingReadback.mirror = texture->isYInverted();
+    return true;
+}
+
+void ScreenCastStream::finishReadback()
+{
+    if (!m_pendingReadback.data) {
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffer);
+    const auto pixels = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_readbackBufferSize, GL_MAP_READ_BIT));
+    if (pixels) {
+        const int height = m_pendingReadback.size.height();
+        const int stride = m_pendingReadback.stride;
+        if (m_pendingReadback.mirror) {
+            for (int y = 0; y < height; ++y) {
+                memcpy(m_pendingReadback.data + y * stride, pixels + (height - y - 1) * stride, stride);
+            }
+        } else {
+            memcpy(m_pendingReadback.data, pixels, height * stride);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        qCWarning(KWIN_SCREENCAST) << "Failed to map the screencast readback buffer";
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    QImage image(m_pendingReadback.data, m_pendingReadback.size.width(), m_pendingReadback.size.height(), m_pendingReadback.stride, m_pendingReadback.format);
+    paintCursor(&image);
+
+    m_pendingReadback = {};
+}
+
+std::chrono::nanoseconds ScreenCastStream::frameInterval() const
+{
+    if (!pwStream || videoFormat.max_framerate.num == 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::nanoseconds(1'000'000'000ull * videoFormat.max_framerate.denom / videoFormat.max_framerate.num);
+}
+
+bool ScreenCastStream::isNv12() const
+{
+    return videoFormat.format == SPA_VIDEO_FORMAT_NV12;
+}
+
 void ScreenCastStream::addHeader(spa_buffer *spaBuffer)
 {
     spa_meta_header *spaHeader = (spa_meta_header *)spa_buffer_find_meta_data(spaBuffer, SPA_META_Header, sizeof(spaHeader));
@@ -600,6 +898,13 @@ void ScreenCastStream::enqueue()
 {
     Q_ASSERT_X(m_pendingBuffer, "enqueue", "pending buffer must be valid");
 
+    if (m_pendingReadback.data) {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+        }
+        finishReadback();
+    }
+
     delete m_pendingFence;
     delete m_pendingNotifier;
 
@@ -608,6 +913,11 @@ void ScreenCastStream::enqueue()
     m_pendingBuffer = nullptr;
     m_pendingFence = nullptr;
     m_pendingNotifier = nullptr;
+
+    // A frame that has been delayed while the buffer was pending is recorded now.
+    if (!m_pendingDamage.isEmpty() && !m_pacingTimer.isActive()) {
+        m_pacingTimer.start(0);
+    }
 }
 
 QVector<const spa_pod *> ScreenCastStream::buildFormats(bool fixate, char buffer[2048])
@@ -621,9 +931,13 @@ QVector<const spa_pod *> ScreenCastStream::buildFormats(bool fixate, char buffer
     spa_rectangle resolution = SPA_RECTANGLE(uint32_t(m_resolution.width()), uint32_t(m_resolution.height()));
 
     QVector<const spa_pod *> params;
-    params.reserve(fixate + m_hasDmaBuf + 1);
+    params.reserve(fixate + m_hasNv12DmaBuf + m_hasDmaBuf + 1);
     if (fixate) {
-        params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_BGRA, &resolution, &defaultFramerate, &minFramerate, &maxFramerate, {m_dmabufParams->modifier}, SPA_POD_PROP_FLAG_MANDATORY));
+        const auto fixatedFormat = isNv12() ? SPA_VIDEO_FORMAT_NV12 : SPA_VIDEO_FORMAT_BGRA;
+        params.append(buildFormat(&podBuilder, fixatedFormat, &resolution, &defaultFramerate, &minFramerate, &maxFramerate, {m_dmabufParams->modifier}, SPA_POD_PROP_FLAG_MANDATORY));
+    }
+    if (m_hasNv12DmaBuf) {
+        params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_NV12, &resolution, &defaultFramerate, &minFramerate, &maxFramerate, {DRM_FORMAT_MOD_LINEAR}, SPA_POD_PROP_FLAG_MANDATORY));
     }
     if (m_hasDmaBuf) {
         params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_BGRA, &resolution, &defaultFramerate, &minFramerate, &maxFramerate, m_modifiers, SPA_POD_PROP_FLAG_MANDATORY | SPA_POD_PROP_FLAG_DONT_FIXATE));
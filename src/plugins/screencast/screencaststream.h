@@ -15,10 +15,13 @@
 #include "wayland/screencast_v1_interface.h"
 
 #include <QHash>
+#include <QImage>
 #include <QObject>
 #include <QSize>
 #include <QSocketNotifier>
+#include <QTimer>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <optional>
 
@@ -32,7 +35,9 @@ namespace KWin
 
 class Cursor;
 class EGLNativeFence;
+class GLFramebuffer;
 class GLTexture;
+class Nv12Converter;
 class PipeWireCore;
 class ScreenCastSource;
 
@@ -75,6 +80,13 @@ private:
     static void onStreamAddBuffer(void *data, pw_buffer *buffer);
     static void onStreamRemoveBuffer(void *data, pw_buffer *buffer);
 
+    void runOnMainThread(const std::function<void()> &task);
+    void runMainThreadTask();
+    void streamStateChanged(pw_stream_state state);
+    void streamParamChanged(const struct spa_pod *format);
+    bool addDmaBuf(pw_buffer *buffer);
+    void removeBuffer(pw_buffer *buffer);
+
     bool createStream();
     QVector<const spa_pod *> buildFormats(bool fixate, char buffer[2048]);
     void updateParams();
@@ -85,6 +97,11 @@ private:
     void newStreamParams();
     void tryEnqueue(pw_buffer *buffer);
     void enqueue();
+    bool startReadback(QImage *image);
+    void finishReadback();
+    void paintCursor(QImage *image);
+    bool isNv12() const;
+    std::chrono::nanoseconds frameInterval() const;
     spa_pod *buildFormat(struct spa_pod_builder *b, enum spa_video_format format, struct spa_rectangle *resolution,
                          struct spa_fraction *defaultFramerate, struct spa_fraction *minFramerate, struct spa_fraction *maxFramerate,
                          const QVector<uint64_t> &modifiers, quint32 modifiersFlags);
@@ -100,6 +117,11 @@ private:
     QSize m_resolution;
     bool m_stopped = false;
 
+    // The stream callbacks run on the PipeWire thread, the ones that need the compositor hand
+    // a task over to the main thread and wait for it. Both are guarded by the PipeWire lock.
+    std::function<void()> m_mainThreadTask;
+    bool m_waitingForMainThread = false;
+
     spa_video_info_raw videoFormat;
     QString m_error;
     QVector<uint64_t> m_modifiers;
@@ -113,12 +135,38 @@ private:
         QRect viewport;
         qint64 lastKey = 0;
         QRect lastRect;
-        std::unique_ptr<GLTexture> texture;
+        std::shared_ptr<GLTexture> texture;
         bool visible = false;
     } m_cursor;
     QRect cursorGeometry(Cursor *cursor) const;
 
     QHash<struct pw_buffer *, std::shared_ptr<DmaBufTexture>> m_dmabufDataForPwBuffer;
+    // The parts of the dmabufs that are out of date, they are kept across frames.
+    QHash<struct pw_buffer *, QRegion> m_dmabufDamageForPwBuffer;
+
+    // Memfd frames are read back into a pixel pack buffer and copied into the memfd once
+    // the GPU is done with it.
+    uint m_readbackBuffer = 0;
+    qsizetype m_readbackBufferSize = 0;
+    struct
+    {
+        uchar *data = nullptr;
+        QSize size;
+        int stride = 0;
+        QImage::Format format = QImage::Format_Invalid;
+        bool mirror = false;
+    } m_pendingReadback;
+
+    // NV12 frames are composed in an RGB texture and converted into the dmabufs on the GPU.
+    std::unique_ptr<Nv12Converter> m_nv12Converter;
+    std::unique_ptr<GLTexture> m_nv12Source;
+    std::unique_ptr<GLFramebuffer> m_nv12SourceFramebuffer;
+
+    // Frames are paced to the maximum framerate negotiated with the consumer. The damage of
+    // the frames in between is accumulated and sent with the next frame.
+    QTimer m_pacingTimer;
+    QRegion m_pendingDamage;
+    std::optional<std::chrono::nanoseconds> m_lastFrameTimestamp;
 
     pw_buffer *m_pendingBuffer = nullptr;
     QSocketNotifier *m_pendingNotifier = nullptr;
@@ -126,6 +174,7 @@ private:
     std::optional<std::chrono::nanoseconds> m_start;
     quint64 m_sequential = 0;
     bool m_hasDmaBuf = false;
+    bool m_hasNv12DmaBuf = false;
 };
 
 } // namespace KWin
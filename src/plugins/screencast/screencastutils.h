@@ -9,9 +9,30 @@
 #include "kwinglplatform.h"
 #include "kwingltexture.h"
 
+#include <QRegion>
+
+#include <cmath>
+
 namespace KWin
 {
 
+static inline QRegion scaleRegion(const QRegion &_region, qreal scale)
+{
+    if (scale == 1.) {
+        return _region;
+    }
+
+    QRegion region;
+    for (auto it = _region.begin(), itEnd = _region.end(); it != itEnd; ++it) {
+        region += QRect(std::floor(it->x() * scale),
+                        std::floor(it->y() * scale),
+                        std::ceil(it->width() * scale),
+                        std::ceil(it->height() * scale));
+    }
+
+    return region;
+}
+
 // in-place vertical mirroring
 static void mirrorVertically(uchar *data, int height, int stride)
 {
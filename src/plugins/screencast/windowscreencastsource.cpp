@@ -15,7 +15,9 @@
 #include "kwineffects.h"
 #include "kwingltexture.h"
 #include "kwinglutils.h"
+#include "platformsupport/scenes/opengl/openglsurfacetexture.h"
 #include "scene.h"
+#include "surfaceitem.h"
 #include "window.h"
 #include "windowitem.h"
 
@@ -39,8 +41,61 @@ QSize WindowScreenCastSource::textureSize() const
     return m_window->clientGeometry().size().toSize();
 }
 
+GLTexture *WindowScreenCastSource::clientTexture() const
+{
+    // The contents of the window can be taken straight from the client buffer only if the
+    // buffer is all there is to it, i.e. there is no decoration, no sub-surfaces, and the
+    // buffer is neither transformed nor cropped.
+    WindowItem *windowItem = m_window->windowItem();
+    if (!windowItem || windowItem->decorationItem()) {
+        return nullptr;
+    }
+    SurfaceItem *surfaceItem = windowItem->surfaceItem();
+    if (!surfaceItem || !surfaceItem->childItems().isEmpty()) {
+        return nullptr;
+    }
+    if (surfaceItem->mapToGlobal(surfaceItem->rect()) != m_window->clientGeometry()) {
+        return nullptr;
+    }
+
+    const QMatrix4x4 matrix = surfaceItem->surfaceToBufferMatrix();
+    if (matrix(0, 1) != 0 || matrix(1, 0) != 0 || matrix(0, 3) != 0 || matrix(1, 3) != 0
+        || matrix(0, 0) <= 0 || matrix(1, 1) <= 0) {
+        return nullptr;
+    }
+
+    SurfacePixmap *pixmap = surfaceItem->pixmap();
+    if (!pixmap) {
+        return nullptr;
+    }
+    const QRectF contentsRect = pixmap->contentsRect();
+    if (!contentsRect.isEmpty() && contentsRect != QRectF(QPointF(), pixmap->size())) {
+        return nullptr;
+    }
+
+    auto surfaceTexture = static_cast<OpenGLSurfaceTexture *>(pixmap->texture());
+    if (!surfaceTexture || !surfaceTexture->texture()) {
+        return nullptr;
+    }
+    if (!pixmap->isDiscarded()) {
+        // The window may not have been painted since its last commit, e.g. if it's on
+        // another virtual desktop, bring the texture up to date the same way the scene does.
+        const QRegion damage = surfaceItem->damage();
+        if (!damage.isEmpty()) {
+            surfaceTexture->update(damage);
+            surfaceItem->resetDamage();
+        }
+    }
+    return surfaceTexture->texture();
+}
+
 void WindowScreenCastSource::render(QImage *image)
 {
+    if (GLTexture *texture = clientTexture(); texture && texture->size() == image->size()) {
+        grabTexture(texture, image);
+        return;
+    }
+
     GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
     GLFramebuffer offscreenTarget(&offscreenTexture);
 
@@ -50,6 +105,23 @@ void WindowScreenCastSource::render(QImage *image)
 
 void WindowScreenCastSource::render(GLFramebuffer *target)
 {
+    if (GLTexture *texture = clientTexture()) {
+        const QRect geometry(QPoint(), target->size());
+        QMatrix4x4 projectionMatrix;
+        projectionMatrix.ortho(geometry);
+
+        GLFramebuffer::pushFramebuffer(target);
+        auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+        shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+        texture->bind();
+        texture->setFilter(GL_LINEAR);
+        texture->render(geometry);
+        texture->unbind();
+        ShaderManager::instance()->popShader();
+        GLFramebuffer::popFramebuffer();
+        return;
+    }
+
     const QRectF geometry = m_window->clientGeometry();
     QMatrix4x4 projectionMatrix;
     projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
@@ -13,6 +13,7 @@
 namespace KWin
 {
 
+class GLTexture;
 class Window;
 
 class WindowScreenCastSource : public ScreenCastSource
@@ -30,6 +31,11 @@ public:
     std::chrono::nanoseconds clock() const override;
 
 private:
+    /**
+     * Returns the texture of the client buffer if it can be cast as is, otherwise @c null.
+     */
+    GLTexture *clientTexture() const;
+
     QPointer<Window> m_window;
 };
 
@@ -12,6 +12,7 @@
 
 #include <config-kwin.h>
 
+#include "core/cursorfastpath.h"
 #include "core/output.h"
 #include "core/platform.h"
 #include "decorations/decoratedclient.h"
@@ -42,6 +43,7 @@
 
 #include <QHoverEvent>
 #include <QPainter>
+#include <QScopeGuard>
 #include <QWindow>
 
 #include <linux/input.h>
@@ -186,7 +188,7 @@ public:
         if (s_counter == 0) {
             if (!s_scheduledPositions.isEmpty()) {
                 const auto pos = s_scheduledPositions.takeFirst();
-                m_pointer->processMotionInternal(pos.pos, pos.delta, pos.deltaNonAccelerated, pos.time, pos.timeUsec, nullptr);
+                m_pointer->processMotionInternal(pos.pos, pos.delta, pos.deltaNonAccelerated, pos.time, pos.timeUsec, nullptr, pos.relativeMotions);
             }
         }
     }
@@ -196,9 +198,9 @@ public:
         return s_counter > 0;
     }
 
-    static void schedulePosition(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec)
+    static void schedulePosition(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, const QVector<RelativePointerMotion> &relativeMotions)
     {
-        s_scheduledPositions.append({pos, delta, deltaNonAccelerated, time, timeUsec});
+        s_scheduledPositions.append({pos, delta, deltaNonAccelerated, time, timeUsec, relativeMotions});
     }
 
 private:
@@ -210,6 +212,7 @@ private:
         QPointF deltaNonAccelerated;
         quint32 time;
         quint64 timeUsec;
+        QVector<RelativePointerMotion> relativeMotions;
     };
     static QVector<ScheduledPosition> s_scheduledPositions;
 
@@ -229,14 +232,31 @@ void PointerInputRedirection::processMotion(const QPointF &delta, const QPointF
     processMotionInternal(m_pos + delta, delta, deltaNonAccelerated, time, timeUsec, device);
 }
 
-void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device)
+void PointerInputRedirection::processCoalescedMotion(const QVector<RelativePointerMotion> &motions, uint32_t time, InputDevice *device)
+{
+    if (motions.isEmpty()) {
+        return;
+    }
+    // The filters and spies only get to see the accumulated motion, running them and
+    // updating the focus for every sample of a high rate mouse would be wasted work
+    QPointF delta;
+    QPointF deltaNonAccelerated;
+    for (const RelativePointerMotion &motion : motions) {
+        delta += motion.delta;
+        deltaNonAccelerated += motion.deltaNonAccelerated;
+    }
+    processMotionInternal(m_pos + delta, delta, deltaNonAccelerated, time, motions.last().timeMicroseconds, device, motions);
+}
+
+void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device,
+                                                    const QVector<RelativePointerMotion> &relativeMotions)
 {
     input()->setLastInputHandler(this);
     if (!inited()) {
         return;
     }
     if (PositionUpdateBlocker::isPositionBlocked()) {
-        PositionUpdateBlocker::schedulePosition(pos, delta, deltaNonAccelerated, time, timeUsec);
+        PositionUpdateBlocker::schedulePosition(pos, delta, deltaNonAccelerated, time, timeUsec, relativeMotions);
         return;
     }
 
@@ -246,10 +266,11 @@ void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QP
                      input()->keyboardModifiers(), time,
                      delta, deltaNonAccelerated, timeUsec, device);
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
+    event.setRelativeMotions(relativeMotions);
 
     update();
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+    input()->processFilters(InputEventType::Pointer, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
 }
 
 void PointerInputRedirection::processButton(uint32_t button, InputRedirection::PointerButtonState state, uint32_t time, InputDevice *device)
@@ -282,7 +303,7 @@ void PointerInputRedirection::processButton(uint32_t button, InputRedirection::P
         return;
     }
 
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
+    input()->processFilters(InputEventType::Pointer, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
 
     if (state == InputRedirection::PointerButtonReleased) {
         update();
@@ -307,7 +328,7 @@ void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qr
     if (!inited()) {
         return;
     }
-    input()->processFilters(std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
+    input()->processFilters(InputEventType::Wheel, std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
 }
 
 void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -319,7 +340,7 @@ void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32
     }
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processSwipeGestureUpdate(const QPointF &delta, quint32 time, KWin::InputDevice *device)
@@ -332,7 +353,7 @@ void PointerInputRedirection::processSwipeGestureUpdate(const QPointF &delta, qu
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureUpdate, std::placeholders::_1, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
 }
 
 void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -345,7 +366,7 @@ void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -358,7 +379,7 @@ void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -371,7 +392,7 @@ void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angleDelta, const QPointF &delta, quint32 time, KWin::InputDevice *device)
@@ -384,7 +405,7 @@ void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angle
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
 }
 
 void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -397,7 +418,7 @@ void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -410,7 +431,7 @@ void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -422,7 +443,7 @@ void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 t
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -434,7 +455,7 @@ void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDev
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -446,7 +467,7 @@ void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::In
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputEventType::Gesture, std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
 }
 
 bool PointerInputRedirection::areButtonsPressed() const
@@ -581,6 +602,7 @@ void PointerInputRedirection::breakPointerConstraints(KWaylandServer::SurfaceInt
     disconnectConfinedPointerRegionConnection();
     m_confined = false;
     m_locked = false;
+    CursorFastPath::self()->setEnabled(true);
 }
 
 void PointerInputRedirection::disconnectConfinedPointerRegionConnection()
@@ -623,6 +645,10 @@ void PointerInputRedirection::setEnableConstraints(bool set)
 
 void PointerInputRedirection::updatePointerConstraints()
 {
+    auto fastPathScope = qScopeGuard([this]() {
+        // the input thread doesn't know about the constraints, it must not move the cursor past them
+        CursorFastPath::self()->setEnabled(!isConstrained());
+    });
     if (!focus()) {
         return;
     }
@@ -756,6 +782,10 @@ QPointF PointerInputRedirection::applyPointerConfinement(const QPointF &pos) con
 
 void PointerInputRedirection::updatePosition(const QPointF &pos)
 {
+    auto fastPathScope = qScopeGuard([this]() {
+        // also if the position didn't change, so motions that have been swallowed count as processed
+        CursorFastPath::self()->setPosition(m_pos);
+    });
     if (m_locked) {
         // locked pointer should not move
         return;
@@ -89,6 +89,10 @@ public:
      * @internal
      */
     void processMotion(const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device);
+    /**
+     * @internal
+     */
+    void processCoalescedMotion(const QVector<KWin::RelativePointerMotion> &motions, uint32_t time, InputDevice *device);
     /**
      * @internal
      */
@@ -143,7 +147,8 @@ public:
     void processHoldGestureCancelled(quint32 time, KWin::InputDevice *device = nullptr);
 
 private:
-    void processMotionInternal(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device);
+    void processMotionInternal(const QPointF &pos, const QPointF &delta, const QPointF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, InputDevice *device,
+                               const QVector<RelativePointerMotion> &relativeMotions = {});
     void cleanupDecoration(Decoration::DecoratedClientImpl *old, Decoration::DecoratedClientImpl *now) override;
 
     void focusUpdate(Window *focusOld, Window *focusNow) override;
@@ -19,6 +19,7 @@ namespace KWin
 
 PopupInputFilter::PopupInputFilter()
     : QObject()
+    , InputEventFilter(InputEventTypes())
 {
     connect(workspace(), &Workspace::windowAdded, this, &PopupInputFilter::handleWindowAdded);
     connect(workspace(), &Workspace::internalWindowAdded, this, &PopupInputFilter::handleWindowAdded);
@@ -34,12 +35,24 @@ void PopupInputFilter::handleWindowAdded(Window *window)
         connect(window, &Window::windowShown, this, &PopupInputFilter::handleWindowAdded, Qt::UniqueConnection);
         connect(window, &Window::windowClosed, this, &PopupInputFilter::handleWindowRemoved, Qt::UniqueConnection);
         m_popupWindows << window;
+        updateEventTypes();
     }
 }
 
 void PopupInputFilter::handleWindowRemoved(Window *window)
 {
     m_popupWindows.removeOne(window);
+    updateEventTypes();
+}
+
+void PopupInputFilter::updateEventTypes()
+{
+    // without a popup the filter lets everything pass
+    if (m_popupWindows.isEmpty()) {
+        setEventTypes(InputEventTypes());
+    } else {
+        setEventTypes(InputEventType::Pointer | InputEventType::Key | InputEventType::Touch);
+    }
 }
 bool PopupInputFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
@@ -120,6 +133,7 @@ void PopupInputFilter::cancelPopups()
         auto c = m_popupWindows.takeLast();
         c->popupDone();
     }
+    updateEventTypes();
 }
 
 }
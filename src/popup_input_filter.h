@@ -30,6 +30,7 @@ private:
     void handleWindowRemoved(Window *client);
     void disconnectClient(Window *client);
     void cancelPopups();
+    void updateEventTypes();
 
     QVector<Window *> m_popupWindows;
 };
@@ -18,6 +18,8 @@
 #include <QTemporaryFile>
 #include <kconfig.h>
 
+#include <algorithm>
+
 #ifndef KCMRULES
 #include "client_machine.h"
 #include "main.h"
@@ -125,6 +127,7 @@ void Rules::readFromSettings(const RuleSettings *settings)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title, );
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    compileRegExps();
     types = NET::WindowTypeMask(settings->types());
     READ_FORCE_RULE(placement, );
     READ_SET_RULE(position);
@@ -322,6 +325,14 @@ QString Rules::getDecoColor(const QString &themeName)
                                   QLatin1String("color-schemes/") + themeName + QLatin1String(".colors"));
 }
 
+void Rules::compileRegExps()
+{
+    wmclassregexp = wmclassmatch == RegExpMatch ? QRegularExpression(QString::fromUtf8(wmclass)) : QRegularExpression();
+    windowroleregexp = windowrolematch == RegExpMatch ? QRegularExpression(QString::fromUtf8(windowrole)) : QRegularExpression();
+    titleregexp = titlematch == RegExpMatch ? QRegularExpression(title) : QRegularExpression();
+    clientmachineregexp = clientmachinematch == RegExpMatch ? QRegularExpression(QString::fromUtf8(clientmachine)) : QRegularExpression();
+}
+
 bool Rules::matchType(NET::WindowType match_type) const
 {
     if (types != NET::AllTypesMask) {
@@ -338,11 +349,10 @@ bool Rules::matchType(NET::WindowType match_type) const
 bool Rules::matchWMClass(const QByteArray &match_class, const QByteArray &match_name) const
 {
     if (wmclassmatch != UnimportantMatch) {
-        // TODO optimize?
-        QByteArray cwmclass = wmclasscomplete
+        const QByteArray cwmclass = wmclasscomplete
             ? match_name + ' ' + match_class
             : match_class;
-        if (wmclassmatch == RegExpMatch && !QRegularExpression(QString::fromUtf8(wmclass)).match(QString::fromUtf8(cwmclass)).hasMatch()) {
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch()) {
             return false;
         }
         if (wmclassmatch == ExactMatch && wmclass != cwmclass) {
@@ -358,7 +368,7 @@ bool Rules::matchWMClass(const QByteArray &match_class, const QByteArray &match_
 bool Rules::matchRole(const QByteArray &match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && !QRegularExpression(QString::fromUtf8(windowrole)).match(QString::fromUtf8(match_role)).hasMatch()) {
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch()) {
             return false;
         }
         if (windowrolematch == ExactMatch && windowrole != match_role) {
@@ -374,7 +384,7 @@ bool Rules::matchRole(const QByteArray &match_role) const
 bool Rules::matchTitle(const QString &match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && !QRegularExpression(title).match(match_title).hasMatch()) {
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch()) {
             return false;
         }
         if (titlematch == ExactMatch && title != match_title) {
@@ -396,7 +406,7 @@ bool Rules::matchClientMachine(const QByteArray &match_machine, bool local) cons
             return true;
         }
         if (clientmachinematch == RegExpMatch
-            && !QRegularExpression(QString::fromUtf8(clientmachine)).match(QString::fromUtf8(match_machine)).hasMatch()) {
+            && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch()) {
             return false;
         }
         if (clientmachinematch == ExactMatch
@@ -427,7 +437,7 @@ bool Rules::match(const Window *c) const
         return false;
     }
     if (titlematch != UnimportantMatch) { // track title changes to rematch rules
-        QObject::connect(c, &Window::captionChanged, c, &Window::evaluateWindowRules,
+        QObject::connect(c, &Window::captionChanged, c, &Window::evaluateTitleWindowRules,
                          // QueuedConnection, because title may change before
                          // the client is ready (could segfault!)
                          static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::UniqueConnection));
@@ -438,6 +448,14 @@ bool Rules::match(const Window *c) const
     return true;
 }
 
+QByteArray Rules::exactWMClass() const
+{
+    if (wmclassmatch != ExactMatch) {
+        return QByteArray();
+    }
+    return wmclass;
+}
+
 #define NOW_REMEMBER(_T_, _V_) ((selection & _T_) && (_V_##rule == (SetRule)Remember))
 
 bool Rules::update(Window *c, int selection)
@@ -916,29 +934,62 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    m_indexDirty = true;
+}
+
+void RuleBook::updateIndex()
+{
+    m_exactWMClassIndex.clear();
+    m_unindexedRules.clear();
+    for (int i = 0; i < m_rules.count(); ++i) {
+        const QByteArray wmclass = m_rules[i]->exactWMClass();
+        if (wmclass.isEmpty()) {
+            m_unindexedRules.append(i);
+        } else {
+            m_exactWMClassIndex[wmclass].append(i);
+        }
+    }
+    m_indexDirty = false;
 }
 
 WindowRules RuleBook::find(const Window *c, bool ignore_temporary)
 {
+    if (m_indexDirty) {
+        updateIndex();
+    }
+
+    // Only the rules for the window class of the window and the ones that can't be looked up
+    // by a window class need to be matched, in the order of their priority.
+    QVector<int> candidates = m_unindexedRules;
+    const QByteArray wmclass = c->resourceClass();
+    candidates += m_exactWMClassIndex.value(wmclass);
+    candidates += m_exactWMClassIndex.value(c->resourceName() + ' ' + wmclass);
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
     QVector<Rules *> ret;
-    for (QList<Rules *>::Iterator it = m_rules.begin();
-         it != m_rules.end();) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    bool foundTemporary = false;
+    for (int index : qAsConst(candidates)) {
+        Rules *rule = m_rules[index];
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules *rule = *it;
+        if (rule->match(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary()) {
-                it = m_rules.erase(it);
-            } else {
-                ++it;
+                foundTemporary = true;
             }
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    // temporary rules apply only to one window
+    if (foundTemporary) {
+        for (Rules *rule : qAsConst(ret)) {
+            if (rule->isTemporary()) {
+                m_rules.removeOne(rule);
+            }
+        }
+        m_indexDirty = true;
     }
     return WindowRules(ret);
 }
@@ -977,6 +1028,7 @@ void RuleBook::load()
     RuleBookSettings book(m_config);
     book.load();
     m_rules = book.rules().toList();
+    m_indexDirty = true;
 }
 
 void RuleBook::save()
@@ -1009,6 +1061,7 @@ void RuleBook::temporaryRulesMessage(const QString &message)
     }
     Rules *rule = new Rules(message, true);
     m_rules.prepend(rule); // highest priority first
+    m_indexDirty = true;
     if (!was_temporary) {
         QTimer::singleShot(60000, this, &RuleBook::cleanupTemporaryRules);
     }
@@ -1021,6 +1074,7 @@ void RuleBook::cleanupTemporaryRules()
          it != m_rules.end();) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            m_indexDirty = true;
         } else {
             if ((*it)->isTemporary()) {
                 has_temporary = true;
@@ -1046,6 +1100,7 @@ void RuleBook::discardUsed(Window *c, bool withdrawn)
                 c->removeRule(*it);
                 Rules *r = *it;
                 it = m_rules.erase(it);
+                m_indexDirty = true;
                 delete r;
                 continue;
             }
@@ -11,6 +11,7 @@
 #define KWIN_RULES_H
 
 #include <QRectF>
+#include <QRegularExpression>
 #include <QVector>
 #include <netwm_def.h>
 
@@ -40,6 +41,7 @@ public:
     void update(Window *, int selection);
     void discardTemporary();
     bool contains(const Rules *rule) const;
+    bool isEmpty() const;
     void remove(Rules *rule);
     PlacementPolicy checkPlacement(PlacementPolicy placement) const;
     QRectF checkGeometry(QRectF rect, bool init = false) const;
@@ -147,6 +149,11 @@ public:
 #ifndef KCMRULES
     bool discardUsed(bool withdrawn);
     bool match(const Window *c) const;
+    /**
+     * Returns the window class a window must have for this rule to match,
+     * or an empty array if the rule doesn't require an exact one.
+     */
+    QByteArray exactWMClass() const;
     bool update(Window *, int selection);
     bool isTemporary() const;
     bool discardTemporary(bool force); // removes if temporary and forced or too old
@@ -200,6 +207,7 @@ private:
 private:
 #endif
     void readFromSettings(const RuleSettings *settings);
+    void compileRegExps();
     static ForceRule convertForceRule(int v);
     static QString getDecoColor(const QString &themeName);
 #ifndef KCMRULES
@@ -219,6 +227,11 @@ private:
     StringMatch titlematch;
     QByteArray clientmachine;
     StringMatch clientmachinematch;
+    // compiled once, the patterns are matched against every window
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     NET::WindowTypes types; // types for matching
     PlacementPolicy placement;
     ForceRule placementrule;
@@ -324,9 +337,14 @@ private:
     void deleteAll();
     void initializeX11();
     void cleanupX11();
+    void updateIndex();
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules *> m_rules;
+    // Positions in m_rules of the rules requiring a specific window class, and of all others.
+    QHash<QByteArray, QVector<int>> m_exactWMClassIndex;
+    QVector<int> m_unindexedRules;
+    bool m_indexDirty = true;
     std::unique_ptr<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 };
@@ -376,6 +394,11 @@ inline bool WindowRules::contains(const Rules *rule) const
     return rules.contains(const_cast<Rules *>(rule));
 }
 
+inline bool WindowRules::isEmpty() const
+{
+    return rules.isEmpty();
+}
+
 inline void WindowRules::remove(Rules *rule)
 {
     rules.removeOne(rule);
@@ -56,23 +56,32 @@
 #include "composite.h"
 #include "core/output.h"
 #include "core/renderlayer.h"
-#include "core/renderloop.h"
+#include "core/renderloop_p.h"
+#include "damageaudit.h"
 #include "deleted.h"
 #include "effects.h"
+#include "ftrace.h"
 #include "internalwindow.h"
 #include "shadow.h"
 #include "shadowitem.h"
-#include "surfaceitem.h"
+#include "surfaceitem_wayland.h"
 #include "unmanaged.h"
+#include "wayland/display.h"
+#include "wayland/output_interface.h"
+#include "wayland/presentationtime_interface.h"
 #include "wayland/surface_interface.h"
 #include "wayland_server.h"
 #include "waylandwindow.h"
 #include "windowitem.h"
 #include "workspace.h"
 #include "x11window.h"
+#include "xdgshellwindow.h"
 
+#include <QSet>
 #include <QtMath>
 
+#include <limits>
+
 namespace KWin
 {
 
@@ -101,14 +110,20 @@ QRegion SceneDelegate::repaints() const
     return m_scene->damage().translated(-viewport().topLeft());
 }
 
-SurfaceItem *SceneDelegate::scanoutCandidate() const
+SurfaceItem *SceneDelegate::scanoutCandidate(ScanoutRefusal *refusal) const
 {
-    return m_scene->scanoutCandidate();
+    return m_scene->scanoutCandidate(refusal);
+}
+
+SurfaceItem *SceneDelegate::overlayCandidate() const
+{
+    return m_scene->overlayCandidate();
 }
 
 void SceneDelegate::prePaint()
 {
-    m_scene->prePaint(m_output);
+    const QRegion layerRepaints = layer() ? layer()->repaints().translated(viewport().topLeft()) : QRegion();
+    m_scene->prePaint(m_output, layerRepaints);
 }
 
 void SceneDelegate::postPaint()
@@ -126,6 +141,11 @@ QRect SceneDelegate::viewport() const
     return m_output ? m_output->geometry() : m_scene->geometry();
 }
 
+Output *SceneDelegate::output() const
+{
+    return m_output;
+}
+
 //****************************************
 // Scene
 //****************************************
@@ -144,6 +164,12 @@ void Scene::initialize()
     connect(workspace(), &Workspace::geometryChanged, this, [this]() {
         setGeometry(workspace()->geometry());
     });
+    connect(workspace(), &Workspace::outputRemoved, this, [this](Output *output) {
+        discardStaticWindows(output);
+        m_transformedWindows.erase(output);
+        Item::removeOutput(output);
+    });
+    connect(workspace(), &Workspace::outputsChanged, this, &Item::invalidateOutputs);
 }
 
 void Scene::addRepaintFull()
@@ -158,9 +184,13 @@ void Scene::addRepaint(int x, int y, int width, int height)
 
 void Scene::addRepaint(const QRegion &region)
 {
+    DamageAudit *audit = DamageAudit::self();
     for (const auto &delegate : std::as_const(m_delegates)) {
         const QRect viewport = delegate->viewport();
         QRegion dirtyRegion = region & viewport;
+        if (!dirtyRegion.isEmpty() && audit && audit->isAuditing()) {
+            audit->recordScene(delegate->output() ? delegate->output() : workspace()->outputs().constFirst(), dirtyRegion);
+        }
         dirtyRegion.translate(-viewport.topLeft());
         if (!dirtyRegion.isEmpty()) {
             delegate->layer()->addRepaint(dirtyRegion);
@@ -173,6 +203,11 @@ QRegion Scene::damage() const
     return m_paintContext.damage;
 }
 
+QRegion Scene::renderTargetChanges() const
+{
+    return m_paintContext.changes;
+}
+
 QRect Scene::geometry() const
 {
     return m_geometry;
@@ -211,18 +246,30 @@ static SurfaceItem *findTopMostSurface(SurfaceItem *item)
     }
 }
 
-SurfaceItem *Scene::scanoutCandidate() const
+SurfaceItem *Scene::scanoutCandidate(ScanoutRefusal *refusal) const
 {
+    *refusal = ScanoutRefusal::NoCandidate;
     if (!waylandServer()) {
         return nullptr;
     }
     SurfaceItem *candidate = nullptr;
-    if (!static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+    Window *refusedWindow = nullptr;
+    const auto refuse = [&refusedWindow, refusal](Window *window, ScanoutRefusal reason) {
+        refusedWindow = window;
+        *refusal = reason;
+    };
+    if (static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        *refusal = ScanoutRefusal::BlockedByEffect;
+    } else {
         for (int i = stacking_order.count() - 1; i >= 0; i--) {
             WindowItem *windowItem = stacking_order[i];
             Window *window = windowItem->window();
             if (window->isOnOutput(painted_screen) && window->opacity() > 0) {
-                if (!window->isClient() || !window->isFullScreen() || window->opacity() != 1.0) {
+                if (!window->isClient() || !window->isFullScreen()) {
+                    break;
+                }
+                if (window->opacity() != 1.0) {
+                    refuse(window, ScanoutRefusal::Translucent);
                     break;
                 }
                 if (!windowItem->surfaceItem()) {
@@ -236,10 +283,18 @@ SurfaceItem *Scene::scanoutCandidate() const
                 pixmap->update();
                 // the subsurface has to be able to cover the whole window
                 if (topMost->position() != QPoint(0, 0)) {
+                    refuse(window, ScanoutRefusal::NotCovered);
+                    break;
+                }
+                // the plane shows the whole buffer, clipping away parts of it isn't possible
+                const QRect surfaceRect = topMost->rect().toRect();
+                if (!topMost->shape().contains(surfaceRect)) {
+                    refuse(window, ScanoutRefusal::Shaped);
                     break;
                 }
                 // and it has to be completely opaque
                 if (pixmap->hasAlphaChannel() && !topMost->opaque().contains(QRect(0, 0, window->width(), window->height()))) {
+                    refuse(window, ScanoutRefusal::NotOpaque);
                     break;
                 }
                 candidate = topMost;
@@ -247,10 +302,59 @@ SurfaceItem *Scene::scanoutCandidate() const
             }
         }
     }
+
+    // tell why a fullscreen window isn't scanned out, once
+    if (refusedWindow && (m_scanoutRefusedWindow != refusedWindow || m_scanoutRefusal != *refusal)) {
+        qCDebug(KWIN_CORE) << "Not scanning out" << refusedWindow << "because of" << FrameStatistics::scanoutRefusalName(*refusal);
+    }
+    m_scanoutRefusedWindow = refusedWindow;
+    m_scanoutRefusal = *refusal;
     return candidate;
 }
 
-void Scene::prePaint(Output *output)
+SurfaceItem *Scene::overlayCandidate() const
+{
+    if (!waylandServer() || static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return nullptr;
+    }
+    if (m_paintContext.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
+        return nullptr;
+    }
+    for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; i--) {
+        const Phase2Data &paintData = m_paintContext.phase2Data.at(i);
+        Window *window = paintData.item->window();
+        if (!window->isOnOutput(painted_screen) || window->opacity() == 0) {
+            continue;
+        }
+        // only the topmost window can be put on an overlay, nothing else may be painted on top of it
+        if (!window->isClient() || window->opacity() != 1.0 || (paintData.mask & (PAINT_WINDOW_TRANSLUCENT | PAINT_WINDOW_TRANSFORMED))) {
+            return nullptr;
+        }
+        if (!paintData.item->surfaceItem()) {
+            return nullptr;
+        }
+        SurfaceItem *topMost = findTopMostSurface(paintData.item->surfaceItem());
+        if (!topMost->isVisible() || topMost->opacity() != 1.0) {
+            return nullptr;
+        }
+        auto pixmap = topMost->pixmap();
+        if (!pixmap) {
+            return nullptr;
+        }
+        pixmap->update();
+        // the overlay is drawn without blending with what's below it
+        if (pixmap->hasAlphaChannel() && !topMost->opaque().contains(topMost->rect().toRect())) {
+            return nullptr;
+        }
+        if (!painted_screen->geometry().contains(topMost->mapToGlobal(topMost->rect()).toAlignedRect())) {
+            return nullptr;
+        }
+        return topMost;
+    }
+    return nullptr;
+}
+
+void Scene::prePaint(Output *output, const QRegion &layerRepaints)
 {
     createStackingOrder();
 
@@ -290,26 +394,17 @@ void Scene::prePaint(Output *output)
 
     effects->prePaintScreen(prePaintData, m_expectedPresentTimestamp);
     m_paintContext.damage = prePaintData.paint;
+    m_paintContext.changes = (layerRepaints | prePaintData.paint) & renderTargetRect();
     m_paintContext.mask = prePaintData.mask;
     m_paintContext.phase2Data.clear();
 
-    if (m_paintContext.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
+    if (paintsGenericScreen(m_paintContext.mask)) {
         preparePaintGenericScreen();
     } else {
         preparePaintSimpleScreen();
     }
 }
 
-static void resetRepaintsHelper(Item *item, Output *output)
-{
-    item->resetRepaints(output);
-
-    const auto childItems = item->childItems();
-    for (Item *childItem : childItems) {
-        resetRepaintsHelper(childItem, output);
-    }
-}
-
 static void accumulateRepaints(Item *item, Output *output, QRegion *repaints)
 {
     *repaints += item->repaints(output);
@@ -323,27 +418,58 @@ static void accumulateRepaints(Item *item, Output *output, QRegion *repaints)
 
 void Scene::preparePaintGenericScreen()
 {
+    // Everything is repainted, there's nothing transformed windows could leave behind.
+    m_transformedWindows.erase(painted_screen);
+
+    // The damage is the whole render target, but effects that keep what they painted, like
+    // the zoom effect, only need to update what actually changed. Transformed windows can
+    // end up anywhere, so they change everything.
+    bool transformed = false;
     for (WindowItem *windowItem : std::as_const(stacking_order)) {
-        resetRepaintsHelper(windowItem, painted_screen);
+        QRegion repaints;
+        accumulateRepaints(windowItem, painted_screen, &repaints);
 
         WindowPrePaintData data;
         data.mask = m_paintContext.mask;
         data.paint = infiniteRegion(); // no clipping, so doesn't really matter
 
         effects->prePaintWindow(windowItem->window()->effectWindow(), data, m_expectedPresentTimestamp);
+        transformed |= (data.mask & PAINT_WINDOW_TRANSFORMED) != 0;
+        if (!transformed) {
+            m_paintContext.changes += repaints & renderTargetRect();
+        }
         m_paintContext.phase2Data.append(Phase2Data{
             .item = windowItem,
             .region = infiniteRegion(),
             .opaque = data.opaque,
             .mask = data.mask,
+            .damaged = !repaints.isEmpty(),
         });
     }
 
     m_paintContext.damage = renderTargetRect();
+    if (transformed) {
+        m_paintContext.changes = renderTargetRect();
+    }
+}
+
+static QRegion opaqueRegion(const Item *item)
+{
+    if (!item->isVisible() || item->opacity() != 1.0) {
+        return QRegion();
+    }
+
+    QRegion opaque = item->mapToGlobal(item->opaque());
+    const auto childItems = item->childItems();
+    for (const Item *childItem : childItems) {
+        opaque += opaqueRegion(childItem);
+    }
+    return opaque;
 }
 
 void Scene::preparePaintSimpleScreen()
 {
+    QSet<WindowItem *> transformedItems;
     for (WindowItem *windowItem : std::as_const(stacking_order)) {
         Window *window = windowItem->window();
         WindowPrePaintData data;
@@ -351,10 +477,11 @@ void Scene::preparePaintSimpleScreen()
         accumulateRepaints(windowItem, painted_screen, &data.paint);
 
         // Clip out the decoration for opaque windows; the decoration is drawn in the second pass.
+        // Opaque subsurfaces occlude the windows below as well.
         if (window->opacity() == 1.0) {
             const SurfaceItem *surfaceItem = windowItem->surfaceItem();
             if (Q_LIKELY(surfaceItem)) {
-                data.opaque = surfaceItem->mapToGlobal(surfaceItem->opaque());
+                data.opaque = opaqueRegion(surfaceItem);
             }
 
             const DecorationItem *decorationItem = windowItem->decorationItem();
@@ -364,23 +491,85 @@ void Scene::preparePaintSimpleScreen()
         }
 
         effects->prePaintWindow(window->effectWindow(), data, m_expectedPresentTimestamp);
+        if (data.mask & PAINT_WINDOW_TRANSFORMED) {
+            data.paint += expectedTransformedRegion(windowItem);
+            transformedItems.insert(windowItem);
+        }
         m_paintContext.phase2Data.append(Phase2Data{
             .item = windowItem,
             .region = data.paint,
             .opaque = data.opaque,
             .mask = data.mask,
+            .damaged = !data.paint.isEmpty(),
         });
     }
 
+    // The windows that aren't transformed anymore, or gone, leave behind what they painted last.
+    QHash<WindowItem *, TransformedWindow> &transformedWindows = m_transformedWindows[painted_screen];
+    for (auto it = transformedWindows.begin(); it != transformedWindows.end();) {
+        if (transformedItems.contains(it.key())) {
+            ++it;
+        } else {
+            m_paintContext.damage += it->bounds;
+            it = transformedWindows.erase(it);
+        }
+    }
+
     // Perform an occlusion cull pass, remove surface damage occluded by opaque windows.
     QRegion opaque;
     for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
-        const auto &paintData = m_paintContext.phase2Data.at(i);
+        auto &paintData = m_paintContext.phase2Data[i];
         m_paintContext.damage += paintData.region - opaque;
+        if (const SurfaceItem *surfaceItem = paintData.item->surfaceItem(); surfaceItem && !(paintData.mask & PAINT_WINDOW_TRANSFORMED)) {
+            const QRect surfaceRect = surfaceItem->mapToGlobal(surfaceItem->boundingRect()).toAlignedRect();
+            paintData.occluded = (QRegion(surfaceRect) - opaque).isEmpty();
+        }
         if (!(paintData.mask & (PAINT_WINDOW_TRANSLUCENT | PAINT_WINDOW_TRANSFORMED))) {
             opaque += paintData.opaque;
         }
     }
+    m_paintContext.changes |= m_paintContext.damage;
+}
+
+static void collectCommitTraceContexts(Item *item, QVector<quint32> &contexts)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItemWayland *>(item)) {
+        contexts += surfaceItem->takeCommitTraceContexts();
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectCommitTraceContexts(childItem, contexts);
+    }
+}
+
+static void collectCommitInputTimestamps(Item *item, QVector<std::chrono::microseconds> &timestamps)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItemWayland *>(item)) {
+        timestamps += surfaceItem->takeCommitInputTimestamps();
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectCommitInputTimestamps(childItem, timestamps);
+    }
+}
+
+static void collectPresentationFeedbacks(Item *item, KWaylandServer::OutputInterface *output, RenderLoopPrivate::PendingFrame &frame, Item *scanoutItem)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItemWayland *>(item)) {
+        if (surfaceItem->surface()) {
+            if (auto feedback = surfaceItem->surface()->takePresentationFeedback(output)) {
+                if (frame.directScanout && item == scanoutItem) {
+                    frame.zeroCopyPresentationFeedbacks.push_back(std::move(feedback));
+                } else {
+                    frame.presentationFeedbacks.push_back(std::move(feedback));
+                }
+            }
+        }
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectPresentationFeedbacks(childItem, output, frame, scanoutItem);
+    }
 }
 
 void Scene::postPaint()
@@ -390,18 +579,64 @@ void Scene::postPaint()
     }
 
     effects->postPaintScreen();
+    static_cast<EffectsHandlerImpl *>(effects)->endPaint(painted_screen);
+
+    for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+        if (auto x11Window = qobject_cast<X11Window *>(paintData.item->window())) {
+            if (x11Window->isOnOutput(painted_screen)) {
+                x11Window->framePainted(painted_screen);
+            }
+        } else if (auto xdgWindow = qobject_cast<XdgSurfaceWindow *>(paintData.item->window())) {
+            if (xdgWindow->isOnOutput(painted_screen)) {
+                xdgWindow->framePainted(painted_screen);
+            }
+        }
+    }
 
     if (waylandServer()) {
         const std::chrono::milliseconds frameTime =
             std::chrono::duration_cast<std::chrono::milliseconds>(painted_screen->renderLoop()->lastPresentationTimestamp());
 
-        for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        // Occluded windows still get a frame callback once in a while, so clients that wait
+        // for one before doing anything else, e.g. handling input, don't get stuck.
+        static const bool throttleOccluded = !qEnvironmentVariableIsSet("KWIN_WAYLAND_NO_FRAME_CALLBACK_THROTTLING");
+        static const std::chrono::milliseconds occludedFrameCallbackInterval(1000);
+
+        for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+            WindowItem *windowItem = paintData.item;
             Window *window = windowItem->window();
             if (!window->isOnOutput(painted_screen)) {
                 continue;
             }
             if (auto surface = window->surface()) {
+                if (throttleOccluded && paintData.occluded && frameTime - windowItem->lastFrameCallbackTimestamp() < occludedFrameCallbackInterval) {
+                    continue;
+                }
                 surface->frameRendered(frameTime.count());
+                windowItem->setLastFrameCallbackTimestamp(frameTime);
+            }
+        }
+
+        RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(painted_screen->renderLoop());
+        if (!renderLoopPrivate->pendingFrames.empty()) {
+            RenderLoopPrivate::PendingFrame &frame = renderLoopPrivate->pendingFrames.back();
+
+            const auto outputs = waylandServer()->display()->outputs();
+            auto outputIt = std::find_if(outputs.begin(), outputs.end(), [this](KWaylandServer::OutputInterface *output) {
+                return output->handle() == painted_screen;
+            });
+            KWaylandServer::OutputInterface *outputInterface = outputIt != outputs.end() ? *outputIt : nullptr;
+
+            const bool tracing = FTraceLogger::self()->isEnabled();
+            for (WindowItem *windowItem : std::as_const(stacking_order)) {
+                if (!windowItem->window()->isOnOutput(painted_screen) || !windowItem->surfaceItem()) {
+                    continue;
+                }
+                collectPresentationFeedbacks(windowItem->surfaceItem(), outputInterface, frame, renderLoopPrivate->fullscreenItem);
+                collectCommitInputTimestamps(windowItem->surfaceItem(), frame.inputTimestamps);
+                if (tracing) {
+                    collectCommitTraceContexts(windowItem->surfaceItem(), frame.surfaceTraceContexts);
+                }
             }
         }
     }
@@ -487,7 +722,7 @@ void Scene::paintScreen(const QRegion &region)
 void Scene::finalPaintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
     m_paintScreenCount++;
-    if (mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
+    if (paintsGenericScreen(mask)) {
         paintGenericScreen(mask, data);
     } else {
         paintSimpleScreen(mask, region);
@@ -496,25 +731,114 @@ void Scene::finalPaintScreen(int mask, const QRegion &region, ScreenPaintData &d
 
 // The generic painting code that can handle even transformations.
 // It simply paints bottom-to-top.
-void Scene::paintGenericScreen(int, const ScreenPaintData &)
+void Scene::paintGenericScreen(int mask, const ScreenPaintData &)
 {
-    if (m_paintContext.mask & PAINT_SCREEN_BACKGROUND_FIRST) {
-        if (m_paintScreenCount == 1) {
+    const int staticCount = paintStaticWindows(mask, infiniteRegion());
+    if (staticCount == 0) {
+        if (m_paintContext.mask & PAINT_SCREEN_BACKGROUND_FIRST) {
+            if (m_paintScreenCount == 1) {
+                paintBackground(infiniteRegion());
+            }
+        } else {
             paintBackground(infiniteRegion());
         }
-    } else {
-        paintBackground(infiniteRegion());
     }
 
-    for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+    for (int i = staticCount; i < m_paintContext.phase2Data.size(); ++i) {
+        const Phase2Data &paintData = m_paintContext.phase2Data[i];
         paintWindow(paintData.item, paintData.mask, paintData.region);
     }
 }
 
+// While some windows are animated, e.g. a window being minimized or a panel sliding in, the
+// windows below them usually stay as they are. Those are painted once into a layer of their
+// own, which is copied onto the render target until one of them changes. Returns how many
+// windows at the bottom of the stack have been painted that way in @a region, along with the
+// background.
+//
+// The windows must be repainted whenever they would be painted differently, like in the
+// optimized path. The layer is only made after they have been unchanged for a frame, so short
+// changes don't cost an additional copy. KWIN_NO_LAYER_PROMOTION=1 turns this off.
+int Scene::paintStaticWindows(int mask, const QRegion &region)
+{
+    static const bool enabled = qEnvironmentVariableIntValue("KWIN_NO_LAYER_PROMOTION") == 0;
+    if (!enabled || m_paintScreenCount != 1 || (mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_BACKGROUND_FIRST))) {
+        discardStaticWindows(painted_screen);
+        return 0;
+    }
+
+    StaticWindows candidate{
+        .renderTargetRect = renderTargetRect(),
+        .renderTargetScale = renderTargetScale(),
+    };
+    bool damaged = false;
+    for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+        if (paintData.mask & PAINT_WINDOW_TRANSFORMED) {
+            break;
+        }
+        candidate.items.append(paintData.item);
+        candidate.masks.append(paintData.mask);
+        damaged |= paintData.damaged;
+    }
+    const int count = candidate.items.count();
+    if (count == 0 || count == m_paintContext.phase2Data.count()) {
+        discardStaticWindows(painted_screen);
+        return 0;
+    }
+
+    StaticWindows &current = m_staticWindows[painted_screen];
+    if (damaged || !(current == candidate)) {
+        current = candidate;
+        return 0;
+    }
+
+    if (!current.painted) {
+        const bool updated = updateStaticLayer(painted_screen, [this, count]() {
+            paintBackground(infiniteRegion());
+            for (int i = 0; i < count; ++i) {
+                const Phase2Data &paintData = m_paintContext.phase2Data[i];
+                paintWindow(paintData.item, paintData.mask, infiniteRegion());
+            }
+        });
+        if (!updated) {
+            return 0;
+        }
+        current.painted = true;
+    }
+
+    paintStaticLayer(painted_screen, region);
+    return count;
+}
+
+void Scene::discardStaticWindows(Output *output)
+{
+    if (m_staticWindows.erase(output)) {
+        discardStaticLayer(output);
+    }
+}
+
+bool Scene::updateStaticLayer(Output *output, const std::function<void()> &paint)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(paint)
+    return false;
+}
+
+void Scene::paintStaticLayer(Output *output, const QRegion &region)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(region)
+}
+
+void Scene::discardStaticLayer(Output *output)
+{
+    Q_UNUSED(output)
+}
+
 // The optimized case without any transformations at all.
 // It can paint only the requested region and can use clipping
 // to reduce painting and improve performance.
-void Scene::paintSimpleScreen(int, const QRegion &region)
+void Scene::paintSimpleScreen(int mask, const QRegion &region)
 {
     // This is the occlusion culling pass
     QRegion visible = region;
@@ -531,15 +855,100 @@ void Scene::paintSimpleScreen(int, const QRegion &region)
         }
     }
 
-    paintBackground(visible);
+    const int staticCount = paintStaticWindows(mask, region);
+    if (staticCount == 0) {
+        paintBackground(visible);
+    }
 
-    for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+    m_recordTransformedWindows = m_paintScreenCount == 1;
+    for (int i = staticCount; i < m_paintContext.phase2Data.size(); ++i) {
+        const Phase2Data &paintData = m_paintContext.phase2Data[i];
         paintWindow(paintData.item, paintData.mask, paintData.region);
     }
+    m_recordTransformedWindows = false;
+}
+
+// Whether the whole screen is painted bottom to top, without clipping. Transformed windows
+// are painted in the optimized path as well, only in the area they're expected to cover, unless
+// KWIN_GENERIC_TRANSFORMED_WINDOWS=1 is set.
+bool Scene::paintsGenericScreen(int mask)
+{
+    static const bool genericTransformedWindows = qEnvironmentVariableIntValue("KWIN_GENERIC_TRANSFORMED_WINDOWS") != 0;
+    if (mask & PAINT_SCREEN_TRANSFORMED) {
+        return true;
+    }
+    return genericTransformedWindows && (mask & PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS);
+}
+
+// Returns the area of the render target that @a item covers when it's painted with @a data.
+QRect Scene::transformedBounds(const WindowItem *item, const WindowPaintData &data) const
+{
+    QMatrix4x4 matrix = m_renderTargetProjectionMatrix;
+    matrix.translate(item->position().x(), item->position().y());
+    matrix *= data.toMatrix();
+
+    const QRectF rect = item->boundingRect();
+    const QPointF corners[] = {rect.topLeft(), rect.topRight(), rect.bottomLeft(), rect.bottomRight()};
+    qreal left = std::numeric_limits<qreal>::max();
+    qreal top = std::numeric_limits<qreal>::max();
+    qreal right = std::numeric_limits<qreal>::lowest();
+    qreal bottom = std::numeric_limits<qreal>::lowest();
+    for (const QPointF &corner : corners) {
+        const QVector4D position = matrix * QVector4D(corner.x(), corner.y(), 0, 1);
+        if (position.w() <= 0) {
+            // behind the viewer, the projection doesn't tell where the window ends up
+            return m_renderTargetRect;
+        }
+        const qreal x = m_renderTargetRect.x() + (position.x() / position.w() + 1) * m_renderTargetRect.width() / 2;
+        const qreal y = m_renderTargetRect.y() + (1 - position.y() / position.w()) * m_renderTargetRect.height() / 2;
+        left = std::min(left, x);
+        top = std::min(top, y);
+        right = std::max(right, x);
+        bottom = std::max(bottom, y);
+    }
+    // one more pixel on each side covers antialiasing and rounding
+    return QRectF(QPointF(left, top), QPointF(right, bottom)).toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+// Returns where @a item is going to be painted, going by where it has been painted before.
+QRegion Scene::expectedTransformedRegion(WindowItem *item) const
+{
+    const auto output = m_transformedWindows.find(painted_screen);
+    if (output != m_transformedWindows.end()) {
+        const auto it = output->second.constFind(item);
+        if (it != output->second.constEnd()) {
+            const QRect &bounds = it->bounds;
+            const QRect &previousBounds = it->previousBounds;
+            if (previousBounds.isNull()) {
+                return bounds;
+            }
+            // The window most likely keeps moving the way it did in the last frame.
+            const QRect extrapolated(bounds.topLeft() * 2 - previousBounds.topLeft(),
+                                     bounds.bottomRight() * 2 - previousBounds.bottomRight());
+            return QRegion(bounds) | extrapolated.normalized();
+        }
+    }
+    return item->mapToGlobal(item->boundingRect()).toAlignedRect();
+}
+
+void Scene::recordTransformedWindow(WindowItem *item, const WindowPaintData &data)
+{
+    const QRect bounds = transformedBounds(item, data);
+    TransformedWindow &window = m_transformedWindows[painted_screen][item];
+    window.previousBounds = window.bounds;
+    window.bounds = bounds;
+
+    // What's outside of the repainted area has been clipped, it's painted in the next frame.
+    const QRegion missed = QRegion(bounds & m_renderTargetRect) - m_paintContext.damage;
+    if (!missed.isEmpty()) {
+        addRepaint(missed);
+    }
 }
 
 void Scene::createStackingOrder()
 {
+    fTraceDuration("Create stacking order");
+
     // Create a list of all windows in the stacking order
     QList<Window *> windows = workspace()->stackingOrder();
 
@@ -586,6 +995,9 @@ void Scene::paintWindow(WindowItem *item, int mask, const QRegion &region)
 // the function that'll be eventually called by paintWindow() above
 void Scene::finalPaintWindow(EffectWindowImpl *w, int mask, const QRegion &region, WindowPaintData &data)
 {
+    if (m_recordTransformedWindows && (mask & PAINT_WINDOW_TRANSFORMED) && data.projectionMatrix().isIdentity()) {
+        recordTransformedWindow(w->windowItem(), data);
+    }
     effects->drawWindow(w, mask, region, data);
 }
 
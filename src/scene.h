@@ -15,10 +15,14 @@
 #include "utils/common.h"
 #include "window.h"
 
+#include <functional>
+#include <map>
 #include <optional>
 
 #include <QElapsedTimer>
+#include <QHash>
 #include <QMatrix4x4>
+#include <QPointer>
 
 namespace KWin
 {
@@ -55,9 +59,14 @@ public:
     ~SceneDelegate() override;
 
     QRect viewport() const;
+    /**
+     * Returns the output that the delegate paints, or null if it paints the whole scene.
+     */
+    Output *output() const;
 
     QRegion repaints() const override;
-    SurfaceItem *scanoutCandidate() const override;
+    SurfaceItem *scanoutCandidate(ScanoutRefusal *refusal) const override;
+    SurfaceItem *overlayCandidate() const override;
     void prePaint() override;
     void postPaint() override;
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
@@ -95,8 +104,9 @@ public:
     // Returns true if the ctor failed to properly initialize.
     virtual bool initFailed() const = 0;
 
-    SurfaceItem *scanoutCandidate() const;
-    void prePaint(Output *output);
+    SurfaceItem *scanoutCandidate(ScanoutRefusal *refusal) const;
+    SurfaceItem *overlayCandidate() const;
+    void prePaint(Output *output, const QRegion &layerRepaints);
     void postPaint();
     virtual void paint(RenderTarget *renderTarget, const QRegion &region) = 0;
 
@@ -172,6 +182,7 @@ public:
     void setRenderTargetRect(const QRect &rect);
     qreal renderTargetScale() const;
     void setRenderTargetScale(qreal scale);
+    QRegion renderTargetChanges() const;
 
     QRegion mapToRenderTarget(const QRegion &region) const;
 
@@ -207,6 +218,21 @@ protected:
 
     virtual void paintOffscreenQuickView(OffscreenQuickView *w) = 0;
 
+    /**
+     * Paints what @a paint paints into the static layer of @a output instead of the render
+     * target. The layer has the size of the render target. Returns @c false if the scene
+     * doesn't support static layers, the default implementation does nothing.
+     */
+    virtual bool updateStaticLayer(Output *output, const std::function<void()> &paint);
+    /**
+     * Copies the static layer of @a output onto the render target, in @a region.
+     */
+    virtual void paintStaticLayer(Output *output, const QRegion &region);
+    /**
+     * Destroys the static layer of @a output to free the memory that it takes.
+     */
+    virtual void discardStaticLayer(Output *output);
+
     // saved data for 2nd pass of optimized screen painting
     struct Phase2Data
     {
@@ -214,11 +240,18 @@ protected:
         QRegion region;
         QRegion opaque;
         int mask = 0;
+        // Whether the window is completely covered by the opaque windows above it.
+        bool occluded = false;
+        // Whether the window has been repainted since the last frame.
+        bool damaged = false;
     };
 
     struct PaintContext
     {
         QRegion damage;
+        // What changed since the previous frame, which is less than the damage when the
+        // whole screen is repainted.
+        QRegion changes;
         int mask = 0;
         QVector<Phase2Data> phase2Data;
     };
@@ -230,6 +263,37 @@ protected:
     QVector<WindowItem *> stacking_order;
 
 private:
+    // The windows at the bottom of the stack that are painted from the static layer of an output.
+    struct StaticWindows
+    {
+        QVector<WindowItem *> items;
+        QVector<int> masks;
+        QRect renderTargetRect;
+        qreal renderTargetScale = 1;
+        // Whether the static layer contains the windows.
+        bool painted = false;
+
+        bool operator==(const StaticWindows &other) const
+        {
+            return items == other.items && masks == other.masks && renderTargetRect == other.renderTargetRect && renderTargetScale == other.renderTargetScale;
+        }
+    };
+
+    int paintStaticWindows(int mask, const QRegion &region);
+    void discardStaticWindows(Output *output);
+
+    // Where a transformed window has been painted in the last two frames.
+    struct TransformedWindow
+    {
+        QRect bounds;
+        QRect previousBounds;
+    };
+
+    static bool paintsGenericScreen(int mask);
+    QRect transformedBounds(const WindowItem *item, const WindowPaintData &data) const;
+    QRegion expectedTransformedRegion(WindowItem *item) const;
+    void recordTransformedWindow(WindowItem *item, const WindowPaintData &data);
+
     std::chrono::milliseconds m_expectedPresentTimestamp = std::chrono::milliseconds::zero();
     QList<SceneDelegate *> m_delegates;
     QRect m_geometry;
@@ -239,6 +303,12 @@ private:
     // how many times finalPaintScreen() has been called
     int m_paintScreenCount = 0;
     PaintContext m_paintContext;
+    // the fullscreen window that has been refused direct scanout last, and why
+    mutable QPointer<Window> m_scanoutRefusedWindow;
+    mutable ScanoutRefusal m_scanoutRefusal = ScanoutRefusal::NoCandidate;
+    std::map<Output *, StaticWindows> m_staticWindows;
+    std::map<Output *, QHash<WindowItem *, TransformedWindow>> m_transformedWindows;
+    bool m_recordTransformedWindows = false;
 };
 
 } // namespace
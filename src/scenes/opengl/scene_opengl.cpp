@@ -15,25 +15,42 @@
 #include "openglsurfacetexture.h"
 
 #include <kwinglplatform.h>
+#include <kwingltextureatlas.h>
 #include <kwinoffscreenquickview.h>
 
 #include "composite.h"
 #include "core/output.h"
+#include "core/platform.h"
+#include "core/renderloop_p.h"
+#include "core/syncobjtimeline.h"
+#include "cursortexturecache.h"
 #include "decorations/decoratedclient.h"
+#include "decorations/decorationbridge.h"
 #include "effects.h"
+#include "eglnativefence.h"
+#include "ftrace.h"
 #include "main.h"
 #include "shadowitem.h"
-#include "surfaceitem.h"
+#include "surfaceitem_wayland.h"
 #include "utils/common.h"
+#include "utils/filedescriptor.h"
+#include "wayland_server.h"
 #include "window.h"
 #include "windowitem.h"
+#include "workspace.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <optional>
+#include <unistd.h>
 
+#include <QDataStream>
 #include <QMatrix4x4>
 #include <QPainter>
 #include <QStringList>
+#include <QTimer>
+#include <QVarLengthArray>
 #include <QVector2D>
 #include <QVector4D>
 #include <QtMath>
@@ -47,6 +64,7 @@ namespace KWin
 
 SceneOpenGL::SceneOpenGL(OpenGLBackend *backend)
     : m_backend(backend)
+    , m_decorationPartCache(32 * 1024)
 {
     // We only support the OpenGL 2+ shader API, not GL_ARB_shader_objects
     if (!hasGLVersion(2, 0)) {
@@ -60,6 +78,23 @@ SceneOpenGL::SceneOpenGL(OpenGLBackend *backend)
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
     }
+
+    m_cursorTextureCache = std::make_unique<CursorTextureCache>();
+    m_textureBudget = qint64(std::max(qEnvironmentVariableIntValue("KWIN_TEXTURE_BUDGET"), 0)) * 1024 * 1024;
+    m_downscaledTextures = qEnvironmentVariableIntValue("KWIN_GL_NO_DOWNSCALED_TEXTURES") == 0;
+
+    if (GLNodeBuffer::supported()) {
+        m_nodeBuffer = std::make_unique<GLNodeBuffer>();
+    }
+
+    // Create the common shaders once the compositor is up and running, rather than in the
+    // middle of painting the first frame that needs them.
+    QTimer::singleShot(0, this, [this]() {
+        if (makeOpenGLContextCurrent()) {
+            ShaderManager::instance()->warmUp();
+            doneOpenGLContextCurrent();
+        }
+    });
 }
 
 SceneOpenGL::~SceneOpenGL()
@@ -67,6 +102,9 @@ SceneOpenGL::~SceneOpenGL()
     if (init_ok) {
         makeOpenGLContextCurrent();
     }
+    m_cursorTextureCache.reset();
+    m_nodeBuffer.reset();
+    m_staticLayers.clear();
 }
 
 std::unique_ptr<SceneOpenGL> SceneOpenGL::createScene(OpenGLBackend *backend)
@@ -83,12 +121,228 @@ bool SceneOpenGL::initFailed() const
     return !init_ok;
 }
 
+GLRenderTimeQuery *SceneOpenGL::beginRenderTimeQuery(Output *output)
+{
+    if (!GLRenderTimeQuery::supported()) {
+        return nullptr;
+    }
+
+    RenderLoop *renderLoop = output->renderLoop();
+    auto it = m_renderTimeQueries.find(renderLoop);
+    if (it == m_renderTimeQueries.end()) {
+        it = m_renderTimeQueries.emplace(renderLoop, std::vector<RenderTimeQuery>()).first;
+        connect(renderLoop, &QObject::destroyed, this, [this, renderLoop]() {
+            makeOpenGLContextCurrent();
+            m_renderTimeQueries.erase(renderLoop);
+        });
+    }
+
+    // Collect the results of previous frames. If the GPU is the bottleneck, several frames
+    // can be in flight, so a few queries are kept around.
+    RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(renderLoop);
+    std::vector<RenderTimeQuery> &queries = it->second;
+    RenderTimeQuery *query = nullptr;
+    for (RenderTimeQuery &candidate : queries) {
+        if (const auto renderTime = candidate.query->result()) {
+            renderLoopPrivate->renderJournal.addGpuTime(*renderTime);
+            // The GPU work is over by now, so its begin and end are reported as timestamps
+            // on the steady clock rather than by the time of the marker itself.
+            fTrace("GPU (", output->name(), ") frame=", candidate.frameTraceContext,
+                   " begin_ts=", candidate.query->beginTimestamp().count(),
+                   " end_ts=", (candidate.query->beginTimestamp() + *renderTime).count());
+        }
+        if (!query && !candidate.query->isPending()) {
+            query = &candidate;
+        }
+    }
+
+    if (!query) {
+        static const size_t maxQueryCount = 3;
+        if (queries.size() < maxQueryCount) {
+            queries.push_back(RenderTimeQuery{std::make_unique<GLRenderTimeQuery>()});
+            query = &queries.back();
+        } else {
+            query = &queries.front();
+        }
+    }
+
+    if (!renderLoopPrivate->pendingFrames.empty()) {
+        query->frameTraceContext = renderLoopPrivate->pendingFrames.back().traceContext;
+    }
+    query->query->begin();
+    return query->query.get();
+}
+
+static void collectReleasePoints(Item *item, QVector<SyncReleasePoint *> &releasePoints)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItemWayland *>(item)) {
+        if (auto pixmap = qobject_cast<SurfacePixmapWayland *>(surfaceItem->pixmap())) {
+            if (SyncReleasePoint *releasePoint = pixmap->releasePoint()) {
+                releasePoints.append(releasePoint);
+            }
+        }
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectReleasePoints(childItem, releasePoints);
+    }
+}
+
+static void collectSurfaceTextures(Item *item, QVector<OpenGLSurfaceTexture *> &textures)
+{
+    if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+        // discarded pixmaps aren't created again, they only live on for closing animations
+        SurfacePixmap *pixmap = surfaceItem->pixmap();
+        if (pixmap && !pixmap->isDiscarded()) {
+            auto texture = static_cast<OpenGLSurfaceTexture *>(pixmap->texture());
+            if (texture->texture()) {
+                textures.append(texture);
+            }
+        }
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectSurfaceTextures(childItem, textures);
+    }
+}
+
+static void collectPendingSurfaces(Item *item, QVector<SurfaceItem *> &surfaceItems)
+{
+    if (!item->isVisible()) {
+        return;
+    }
+    if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+        surfaceItems.append(surfaceItem);
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        collectPendingSurfaces(childItem, surfaceItems);
+    }
+}
+
+static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem);
+
+void SceneOpenGL::uploadSurfaceTextures()
+{
+    fTraceDuration("Upload surface textures (", painted_screen->name(), ")");
+
+    QVector<SurfaceItem *> surfaceItems;
+    for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        if (windowItem->window()->isOnOutput(painted_screen)) {
+            collectPendingSurfaces(windowItem, surfaceItems);
+        }
+    }
+
+    // Attach the new buffers first, then upload or import all of them back to back, so that
+    // the transfers aren't interleaved with draw calls and drawing finds up to date textures.
+    for (SurfaceItem *surfaceItem : std::as_const(surfaceItems)) {
+        surfaceItem->preprocess();
+    }
+    for (SurfaceItem *surfaceItem : std::as_const(surfaceItems)) {
+        SurfacePixmap *pixmap = surfaceItem->pixmap();
+        if (!pixmap || pixmap->isDiscarded()) {
+            continue;
+        }
+        auto platformSurfaceTexture = static_cast<OpenGLSurfaceTexture *>(pixmap->texture());
+        if (!platformSurfaceTexture->texture() || !surfaceItem->damage().isEmpty()) {
+            bindSurfaceTexture(surfaceItem);
+        }
+    }
+}
+
+void SceneOpenGL::enforceTextureBudget()
+{
+    // How often the budget is enforced, walking all windows isn't free.
+    static const std::chrono::seconds evictionInterval(1);
+    // Textures that have been painted more recently than this are kept, otherwise windows
+    // that are shown in thumbnails would be uploaded again in every frame.
+    static const std::chrono::seconds idleTime(5);
+
+    if (m_textureBudget <= 0 || GLTexture::totalAllocatedBytes() <= m_textureBudget) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_lastEviction < evictionInterval) {
+        return;
+    }
+    m_lastEviction = now;
+
+    // the effects drop their unused caches first
+    if (effects) {
+        Q_EMIT effects->textureMemoryLow();
+    }
+
+    QVector<OpenGLSurfaceTexture *> hiddenTextures;
+    QVector<OpenGLSurfaceTexture *> shownTextures;
+    for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        Window *window = windowItem->window();
+        if (window->isDeleted() || !windowItem->surfaceItem()) {
+            continue;
+        }
+        const bool hidden = window->isMinimized() || !window->isOnCurrentDesktop() || !window->isOnCurrentActivity();
+        collectSurfaceTextures(windowItem->surfaceItem(), hidden ? hiddenTextures : shownTextures);
+    }
+
+    const auto leastRecentlyUsed = [](const OpenGLSurfaceTexture *a, const OpenGLSurfaceTexture *b) {
+        return a->lastUsed() < b->lastUsed();
+    };
+    std::sort(hiddenTextures.begin(), hiddenTextures.end(), leastRecentlyUsed);
+    std::sort(shownTextures.begin(), shownTextures.end(), leastRecentlyUsed);
+
+    int evicted = 0;
+    for (const QVector<OpenGLSurfaceTexture *> *textures : {&hiddenTextures, &shownTextures}) {
+        for (OpenGLSurfaceTexture *texture : *textures) {
+            if (GLTexture::totalAllocatedBytes() <= m_textureBudget || now - texture->lastUsed() < idleTime) {
+                break;
+            }
+            texture->discardDownscaledTexture();
+            if (texture->evict()) {
+                ++evicted;
+            }
+        }
+    }
+    m_evictedTextures += evicted;
+
+    qCDebug(KWIN_OPENGL) << "Evicted" << evicted << "window textures, textures take"
+                         << GLTexture::totalAllocatedBytes() << "of" << m_textureBudget << "bytes";
+}
+
 void SceneOpenGL::paint(RenderTarget *renderTarget, const QRegion &region)
 {
     Q_UNUSED(renderTarget)
+    GLRenderTimeQuery *renderTimeQuery = beginRenderTimeQuery(painted_screen);
+
+    uploadSurfaceTextures();
+
     GLVertexBuffer::streamingBuffer()->beginFrame();
     paintScreen(region);
     GLVertexBuffer::streamingBuffer()->endOfFrame();
+
+    if (renderTimeQuery) {
+        renderTimeQuery->end();
+    }
+
+    // The explicitly synchronized buffers that have been sampled in this frame must not be
+    // released to the clients before the GPU has finished rendering it.
+    if (waylandServer() && supportsNativeFence()) {
+        QVector<SyncReleasePoint *> releasePoints;
+        for (WindowItem *windowItem : std::as_const(stacking_order)) {
+            if (windowItem->window()->isOnOutput(painted_screen) && windowItem->surfaceItem()) {
+                collectReleasePoints(windowItem->surfaceItem(), releasePoints);
+            }
+        }
+        if (!releasePoints.isEmpty()) {
+            const EGLNativeFence fence(kwinApp()->platform()->sceneEglDisplay());
+            if (fence.isValid()) {
+                const FileDescriptor fileDescriptor(dup(fence.fileDescriptor()));
+                for (SyncReleasePoint *releasePoint : std::as_const(releasePoints)) {
+                    releasePoint->addReleaseFence(fileDescriptor);
+                }
+            }
+        }
+    }
+
+    enforceTextureBudget();
 }
 
 void SceneOpenGL::paintBackground(const QRegion &region)
@@ -136,12 +390,12 @@ void SceneOpenGL::paintOffscreenQuickView(OffscreenQuickView *w)
         shader->setUniform(GLShader::ModulationConstant, QVector4D(a, a, a, a));
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendEnabled(true);
+    GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     t->bind();
     t->render(w->geometry());
     t->unbind();
-    glDisable(GL_BLEND);
+    GLState::setBlendEnabled(false);
 
     ShaderManager::instance()->popShader();
 }
@@ -186,6 +440,66 @@ std::shared_ptr<GLTexture> SceneOpenGL::textureForOutput(Output *output) const
     return m_backend->textureForOutput(output);
 }
 
+bool SceneOpenGL::updateStaticLayer(Output *output, const std::function<void()> &paint)
+{
+    if (!GLTexture::framebufferObjectSupported()) {
+        return false;
+    }
+
+    const QSize size = (QSizeF(renderTargetRect().size()) * renderTargetScale()).toSize();
+    StaticLayer &layer = m_staticLayers[output];
+    if (!layer.texture || layer.texture->size() != size) {
+        layer.framebuffer.reset();
+        layer.texture = std::make_unique<GLTexture>(GL_RGBA8, size);
+        layer.texture->setMemoryCategory(GLTexture::MemoryCategory::Window);
+        layer.texture->setFilter(GL_NEAREST);
+        layer.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        layer.framebuffer = std::make_unique<GLFramebuffer>(layer.texture.get());
+    }
+    if (!layer.framebuffer->valid()) {
+        m_staticLayers.erase(output);
+        return false;
+    }
+
+    GLFramebuffer::pushFramebuffer(layer.framebuffer.get());
+    paint();
+    GLFramebuffer::popFramebuffer();
+    return true;
+}
+
+void SceneOpenGL::paintStaticLayer(Output *output, const QRegion &region)
+{
+    const auto it = m_staticLayers.find(output);
+    if (it == m_staticLayers.end()) {
+        return;
+    }
+    GLTexture *texture = it->second.texture.get();
+
+    // The layer has the size of the render target, so it's copied pixel by pixel.
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(QRect(QPoint(0, 0), texture->size()));
+
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+
+    const bool clipping = region != infiniteRegion();
+    if (clipping) {
+        GLState::setScissorEnabled(true);
+    }
+    GLState::setBlendEnabled(false);
+    texture->bind();
+    texture->render(clipping ? mapToRenderTarget(region) : infiniteRegion(), QRect(QPoint(0, 0), texture->size()), clipping);
+    texture->unbind();
+    if (clipping) {
+        GLState::setScissorEnabled(false);
+    }
+}
+
+void SceneOpenGL::discardStaticLayer(Output *output)
+{
+    m_staticLayers.erase(output);
+}
+
 std::unique_ptr<SurfaceTexture> SceneOpenGL::createSurfaceTextureInternal(SurfacePixmapInternal *pixmap)
 {
     return m_backend->createSurfaceTextureInternal(pixmap);
@@ -246,13 +560,7 @@ QVector4D SceneOpenGL::modulate(float opacity, float brightness) const
 
 void SceneOpenGL::setBlendEnabled(bool enabled)
 {
-    if (enabled && !m_blendingEnabled) {
-        glEnable(GL_BLEND);
-    } else if (!enabled && m_blendingEnabled) {
-        glDisable(GL_BLEND);
-    }
-
-    m_blendingEnabled = enabled;
+    GLState::setBlendEnabled(enabled);
 }
 
 static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
@@ -260,6 +568,7 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
     SurfacePixmap *surfacePixmap = surfaceItem->pixmap();
     auto platformSurfaceTexture =
         static_cast<OpenGLSurfaceTexture *>(surfacePixmap->texture());
+    platformSurfaceTexture->setLastUsed(std::chrono::steady_clock::now());
     if (surfacePixmap->isDiscarded()) {
         return platformSurfaceTexture->texture();
     }
@@ -268,6 +577,7 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
         const QRegion region = surfaceItem->damage();
         if (!region.isEmpty()) {
             platformSurfaceTexture->update(region);
+            platformSurfaceTexture->invalidateDownscaledTexture();
             surfaceItem->resetDamage();
         }
     } else {
@@ -278,40 +588,87 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
             qCDebug(KWIN_OPENGL) << "Failed to bind window";
             return nullptr;
         }
+        platformSurfaceTexture->invalidateDownscaledTexture();
         surfaceItem->resetDamage();
     }
 
     return platformSurfaceTexture->texture();
 }
 
+// Returns how many pixels of the current render target a texel of the texture of @a surfaceItem
+// covers along each axis, roughly, when the item is drawn with @a transform.
+static qreal surfaceTextureScale(const SurfaceItem *surfaceItem, const GLTexture *texture, const QMatrix4x4 &transform)
+{
+    const GLFramebuffer *framebuffer = GLFramebuffer::currentFramebuffer();
+    if (!framebuffer || surfaceItem->size().isEmpty()) {
+        return 1.0;
+    }
+    const QSize viewportSize = framebuffer->size();
+    const qreal xScale = std::hypot(transform(0, 0) * viewportSize.width(), transform(1, 0) * viewportSize.height()) / 2;
+    const qreal yScale = std::hypot(transform(0, 1) * viewportSize.width(), transform(1, 1) * viewportSize.height()) / 2;
+    const qreal texelsPerUnit = std::sqrt(qreal(texture->width()) * texture->height() / (surfaceItem->width() * surfaceItem->height()));
+    return std::max(xScale, yScale) / texelsPerUnit;
+}
+
 static WindowQuadList clipQuads(const Item *item, const SceneOpenGL::RenderContext *context)
 {
     const WindowQuadList quads = item->quads();
-    if (context->clip != infiniteRegion() && !context->hardwareClipping) {
-        const QPointF offset = context->transformStack.top().map(QPointF(0, 0));
-        WindowQuadList ret;
-        ret.reserve(quads.count());
-
-        // split all quads in bounding rect with the actual rects in the region
-        for (const WindowQuad &quad : qAsConst(quads)) {
-            for (const QRect &r : qAsConst(context->clip)) {
-                const QRectF rf(QRectF(r).translated(-offset));
-                const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
-                const QRectF &intersected = rf.intersected(quadRect);
-                if (intersected.isValid()) {
-                    if (quadRect == intersected) {
-                        // case 1: completely contains, include and do not check other rects
-                        ret << quad;
-                        break;
-                    }
-                    // case 2: intersection
-                    ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
-                }
+    if (quads.isEmpty() || context->clip == infiniteRegion() || context->hardwareClipping) {
+        return quads;
+    }
+
+    const QPointF offset = context->transformStack.top().map(QPointF(0, 0));
+
+    QRectF quadsRect;
+    for (const WindowQuad &quad : qAsConst(quads)) {
+        quadsRect |= QRectF(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
+    }
+    quadsRect.translate(offset);
+
+    // Damage regions can consist of many rects, but usually only a few of them touch the item.
+    // Those are collected once in item coordinates, rather than mapping every rect per quad.
+    QVarLengthArray<QRectF, 16> clipRects;
+    for (const QRect &r : qAsConst(context->clip)) {
+        const QRectF rf(r);
+        if (rf.contains(quadsRect)) {
+            // If the item is not clipped at all, reuse its cached quads rather than splitting them.
+            return quads;
+        }
+        if (rf.intersects(quadsRect)) {
+            clipRects.append(rf.translated(-offset));
+        }
+    }
+    if (clipRects.isEmpty()) {
+        return WindowQuadList();
+    }
+
+    WindowQuadList ret;
+    ret.reserve(quads.count());
+
+    // split all quads in bounding rect with the actual rects in the region
+    for (const WindowQuad &quad : qAsConst(quads)) {
+        const qreal quadLeft = quad.left();
+        const qreal quadTop = quad.top();
+        const qreal quadRight = quad.right();
+        const qreal quadBottom = quad.bottom();
+        for (const QRectF &rf : qAsConst(clipRects)) {
+            const qreal left = std::max(rf.left(), quadLeft);
+            const qreal top = std::max(rf.top(), quadTop);
+            const qreal right = std::min(rf.right(), quadRight);
+            const qreal bottom = std::min(rf.bottom(), quadBottom);
+            if (left >= right || top >= bottom) {
+                continue;
             }
+            if (left == quadLeft && top == quadTop && right == quadRight && bottom == quadBottom) {
+                // case 1: completely contains, include and do not check other rects
+                ret << quad;
+                break;
+            }
+            // case 2: intersection
+            ret << quad.makeSubQuad(left, top, right, bottom);
         }
-        return ret;
     }
-    return quads;
+    return ret;
 }
 
 void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
@@ -325,11 +682,17 @@ void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
 
     context->opacityStack.push(context->opacityStack.top() * item->opacity());
 
+    // Translucent items let what's underneath shine through, so only cull if everything is opaque
+    const QList<Item *> occludedChildItems = context->opacityStack.top() == 1.0 ? item->occludedChildItems() : QList<Item *>();
+    const auto isCulled = [&occludedChildItems](Item *childItem) {
+        return childItem->opacity() == 0.0 || childItem->boundingRect().isEmpty() || occludedChildItems.contains(childItem);
+    };
+
     for (Item *childItem : sortedChildItems) {
         if (childItem->z() >= 0) {
             break;
         }
-        if (childItem->explicitVisible()) {
+        if (childItem->explicitVisible() && !isCulled(childItem)) {
             createRenderNode(childItem, context);
         }
     }
@@ -368,13 +731,38 @@ void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
             if (!quads.isEmpty()) {
                 // Don't bother with blending if the entire surface is opaque
                 bool hasAlpha = pixmap->hasAlphaChannel() && !surfaceItem->shape().subtracted(surfaceItem->opaque()).isEmpty();
+                // A surface whose buffer matches its size on the render target is moved onto the
+                // pixel grid, so linear filtering samples texel centers and it stays sharp at
+                // fractional scales.
+                std::optional<QMatrix4x4> alignedTransform;
+                if (context->untransformed) {
+                    alignedTransform = pixelAlignedTransform(surfaceItem, context->transformStack.top());
+                }
+                if (alignedTransform) {
+                    ++m_exactSurfaceDraws;
+                } else {
+                    ++m_resampledSurfaceDraws;
+                }
+                GLTexture *texture = bindSurfaceTexture(surfaceItem);
+                GLenum filter = GL_LINEAR;
+                // A surface drawn at less than half its size, e.g. in a thumbnail, samples a
+                // mipmapped copy, otherwise most texels are skipped and it looks aliased.
+                if (texture && !alignedTransform && m_downscaledTextures
+                    && surfaceTextureScale(surfaceItem, texture, context->projectionMatrix * context->transformStack.top()) < 0.5) {
+                    auto platformSurfaceTexture = static_cast<OpenGLSurfaceTexture *>(pixmap->texture());
+                    if (GLTexture *downscaledTexture = platformSurfaceTexture->downscaledTexture()) {
+                        texture = downscaledTexture;
+                        filter = GL_LINEAR_MIPMAP_LINEAR;
+                    }
+                }
                 context->renderNodes.append(RenderNode{
-                    .texture = bindSurfaceTexture(surfaceItem),
+                    .texture = texture,
                     .quads = quads,
-                    .transformMatrix = context->transformStack.top(),
+                    .transformMatrix = alignedTransform.value_or(context->transformStack.top()),
                     .opacity = context->opacityStack.top(),
                     .hasAlpha = hasAlpha,
                     .coordinateType = NormalizedCoordinates,
+                    .filter = filter,
                 });
             }
         }
@@ -384,7 +772,7 @@ void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
         if (childItem->z() < 0) {
             continue;
         }
-        if (childItem->explicitVisible()) {
+        if (childItem->explicitVisible() && !isCulled(childItem)) {
             createRenderNode(childItem, context);
         }
     }
@@ -393,6 +781,59 @@ void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
     context->opacityStack.pop();
 }
 
+// Returns the offset in the coordinate system of @a base that turns it into @a matrix, if the
+// two matrices differ by nothing but a translation and @a base only scales and translates.
+static std::optional<QVector2D> relativeTranslation(const QMatrix4x4 &base, const QMatrix4x4 &matrix)
+{
+    if (base == matrix) {
+        return QVector2D();
+    }
+    const QVector4D x = base.column(0);
+    const QVector4D y = base.column(1);
+    if (x != matrix.column(0) || y != matrix.column(1) || base.column(2) != matrix.column(2)) {
+        return std::nullopt;
+    }
+    if (x.y() != 0 || x.z() != 0 || x.w() != 0 || y.x() != 0 || y.z() != 0 || y.w() != 0 || x.x() == 0 || y.y() == 0) {
+        return std::nullopt;
+    }
+    const QVector4D delta = matrix.column(3) - base.column(3);
+    if (delta.z() != 0 || delta.w() != 0) {
+        return std::nullopt;
+    }
+    return QVector2D(delta.x() / x.x(), delta.y() / y.y());
+}
+
+static bool isIntegral(qreal value)
+{
+    return std::abs(value - std::round(value)) < 0.01;
+}
+
+// Returns the @a transform with the surface moved onto the pixel grid of the render target, if
+// every pixel of the buffer ends up on exactly one pixel of the render target.
+std::optional<QMatrix4x4> SceneOpenGL::pixelAlignedTransform(SurfaceItem *surfaceItem, const QMatrix4x4 &transform) const
+{
+    const auto translation = relativeTranslation(QMatrix4x4(), transform);
+    if (!translation) {
+        return std::nullopt;
+    }
+
+    const qreal scale = renderTargetScale();
+    const QRectF sourceRect = surfaceItem->surfaceToBufferMatrix().mapRect(surfaceItem->rect());
+    const QSizeF targetSize = surfaceItem->size() * scale;
+    if (!isIntegral(sourceRect.x()) || !isIntegral(sourceRect.y())
+        || std::abs(sourceRect.width() - targetSize.width()) > 0.01 || std::abs(sourceRect.height() - targetSize.height()) > 0.01) {
+        return std::nullopt;
+    }
+
+    const QPointF origin = renderTargetRect().topLeft();
+    const QPointF position = (translation->toPointF() - origin) * scale;
+    const QPointF snapped(std::round(position.x()), std::round(position.y()));
+
+    QMatrix4x4 aligned;
+    aligned.translate(snapped.x() / scale + origin.x(), snapped.y() / scale + origin.y());
+    return aligned;
+}
+
 QMatrix4x4 SceneOpenGL::modelViewProjectionMatrix(const WindowPaintData &data) const
 {
     // An effect may want to override the default projection matrix in some cases,
@@ -417,6 +858,8 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
     RenderContext renderContext{
         .clip = region,
         .hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED)),
+        .untransformed = !(mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED)) && data.projectionMatrix().isIdentity(),
+        .projectionMatrix = modelViewProjectionMatrix(data),
     };
 
     renderContext.transformStack.push(QMatrix4x4());
@@ -448,6 +891,12 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
         shaderTraits |= ShaderTrait::AdjustSaturation;
     }
 
+    // Effects that provide their own shader expect the state in plain uniforms.
+    GLNodeBuffer *nodeBuffer = data.shader ? nullptr : m_nodeBuffer.get();
+    if (nodeBuffer) {
+        shaderTraits |= ShaderTrait::NodeBuffer;
+    }
+
     const GLVertexAttrib attribs[] = {
         {VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position)},
         {VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord)},
@@ -457,42 +906,94 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
     vbo->reset();
     vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
 
-    GLVertex2D *map = (GLVertex2D *)vbo->map(size);
-
-    for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
+    // Consecutive nodes that share all their state are drawn with a single draw call, as
+    // their vertices are stored back to back. Nodes that only differ in their position, e.g.
+    // a popup and its shadow in a texture atlas, have the offset baked into their vertices.
+    struct Draw
+    {
+        const RenderNode *node;
+        int vertexCount;
+        int nodeIndex;
+    };
+    QVarLengthArray<Draw, 32> draws;
+    QVarLengthArray<QVector2D, 32> offsets(renderContext.renderNodes.count());
+    for (int i = 0; i < renderContext.renderNodes.count(); i++) {
         RenderNode &renderNode = renderContext.renderNodes[i];
         if (renderNode.quads.isEmpty() || !renderNode.texture) {
             continue;
         }
-
         if (renderNode.opacity != 1.0) {
             shaderTraits |= ShaderTrait::Modulate;
         }
+        renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
+
+        if (!draws.isEmpty()) {
+            Draw &draw = draws.last();
+            const RenderNode &head = *draw.node;
+            if (head.texture->texture() == renderNode.texture->texture()
+                && head.opacity == renderNode.opacity
+                && head.hasAlpha == renderNode.hasAlpha) {
+                if (const auto offset = relativeTranslation(head.transformMatrix, renderNode.transformMatrix)) {
+                    offsets[i] = *offset;
+                    draw.vertexCount += renderNode.vertexCount;
+                    continue;
+                }
+            }
+        }
+        draws.append(Draw{&renderNode, renderNode.vertexCount, -1});
+    }
+
+    GLVertex2D *map = (GLVertex2D *)vbo->map(size);
+
+    for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
+        RenderNode &renderNode = renderContext.renderNodes[i];
+        if (renderNode.vertexCount == 0) {
+            continue;
+        }
 
         renderNode.firstVertex = v;
-        renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
 
         const QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
 
         renderNode.quads.makeInterleavedArrays(primitiveType, &map[v], matrix);
-        v += renderNode.quads.count() * verticesPerQuad;
+        if (!offsets[i].isNull()) {
+            for (int j = v; j < v + renderNode.vertexCount; j++) {
+                map[j].position += offsets[i];
+            }
+        }
+        v += renderNode.vertexCount;
     }
 
     vbo->unmap();
     vbo->bindArrays();
 
+    const QMatrix4x4 &projectionMatrix = renderContext.projectionMatrix;
+
+    // The state of all draws is uploaded at once, the draws only select their entry.
+    if (nodeBuffer) {
+        nodeBuffer->reset();
+        for (Draw &draw : draws) {
+            draw.nodeIndex = nodeBuffer->append(projectionMatrix * draw.node->transformMatrix,
+                                                modulate(draw.node->opacity, data.brightness()),
+                                                data.saturation());
+        }
+        nodeBuffer->upload();
+    }
+
     GLShader *shader = data.shader;
     if (!shader) {
         shader = ShaderManager::instance()->pushShader(shaderTraits);
     }
-    shader->setUniform(GLShader::Saturation, data.saturation());
+    if (!nodeBuffer) {
+        shader->setUniform(GLShader::Saturation, data.saturation());
+    }
 
     if (renderContext.hardwareClipping) {
-        glEnable(GL_SCISSOR_TEST);
+        GLState::setScissorEnabled(true);
     }
 
     // Make sure the blend function is set up correctly in case we will be doing blending
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
     float opacity = -1.0;
 
@@ -502,28 +1003,34 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
         scissorRegion = mapToRenderTarget(region);
     }
 
-    const QMatrix4x4 projectionMatrix = modelViewProjectionMatrix(data);
-    for (int i = 0; i < renderContext.renderNodes.count(); i++) {
-        const RenderNode &renderNode = renderContext.renderNodes[i];
-        if (renderNode.vertexCount == 0) {
-            continue;
-        }
+    const RenderNode *previousNode = nullptr;
+    for (const Draw &draw : qAsConst(draws)) {
+        const RenderNode &renderNode = *draw.node;
 
         setBlendEnabled(renderNode.hasAlpha || renderNode.opacity < 1.0);
 
-        shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix * renderNode.transformMatrix);
-        if (opacity != renderNode.opacity) {
-            shader->setUniform(GLShader::ModulationConstant,
-                               modulate(renderNode.opacity, data.brightness()));
-            opacity = renderNode.opacity;
+        if (nodeBuffer) {
+            nodeBuffer->bind(draw.nodeIndex);
+        } else {
+            if (!previousNode || previousNode->transformMatrix != renderNode.transformMatrix) {
+                shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix * renderNode.transformMatrix);
+            }
+            if (opacity != renderNode.opacity) {
+                shader->setUniform(GLShader::ModulationConstant,
+                                   modulate(renderNode.opacity, data.brightness()));
+                opacity = renderNode.opacity;
+            }
         }
 
-        renderNode.texture->setFilter(GL_LINEAR);
-        renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        renderNode.texture->bind();
+        if (!previousNode || previousNode->texture->texture() != renderNode.texture->texture()) {
+            renderNode.texture->setFilter(renderNode.filter);
+            renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+            renderNode.texture->bind();
+        }
 
         vbo->draw(scissorRegion, primitiveType, renderNode.firstVertex,
-                  renderNode.vertexCount, renderContext.hardwareClipping);
+                  draw.vertexCount, renderContext.hardwareClipping);
+        previousNode = &renderNode;
     }
 
     vbo->unbindArrays();
@@ -535,13 +1042,26 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
     }
 
     if (renderContext.hardwareClipping) {
-        glDisable(GL_SCISSOR_TEST);
+        GLState::setScissorEnabled(false);
     }
 }
 
 //****************************************
 // SceneOpenGL::Shadow
 //****************************************
+static std::shared_ptr<GLTexture> createShadowTexture(const QImage &image)
+{
+    std::shared_ptr<GLTexture> texture;
+    if (GLTextureAtlas *atlas = GLTextureAtlas::instance()) {
+        texture = atlas->upload(image);
+    }
+    if (!texture) {
+        texture = std::make_shared<GLTexture>(image);
+    }
+    texture->setMemoryCategory(GLTexture::MemoryCategory::Shadow);
+    return texture;
+}
+
 class DecorationShadowTextureCache
 {
 public:
@@ -610,11 +1130,72 @@ std::shared_ptr<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLS
     }
     Data d;
     d.shadows << shadow;
-    d.texture = std::make_shared<GLTexture>(shadow->decorationShadowImage());
+    d.texture = createShadowTexture(shadow->decorationShadowImage());
     m_cache.insert(decoShadow.data(), d);
     return d.texture;
 }
 
+/**
+ * Shares the textures of client and X11 shadows between windows whose shadows look the same,
+ * e.g. all windows of an application. The textures are looked up by the contents of the
+ * assembled shadow image and stay alive as long as a shadow uses them.
+ */
+class ShadowTextureCache
+{
+public:
+    static ShadowTextureCache &instance();
+
+    std::shared_ptr<GLTexture> texture(const QImage &image);
+
+private:
+    struct Entry
+    {
+        QImage image;
+        std::weak_ptr<GLTexture> texture;
+    };
+    QMultiHash<size_t, Entry> m_entries;
+};
+
+ShadowTextureCache &ShadowTextureCache::instance()
+{
+    static ShadowTextureCache s_instance;
+    return s_instance;
+}
+
+std::shared_ptr<GLTexture> ShadowTextureCache::texture(const QImage &image)
+{
+    const size_t key = qHashBits(image.constBits(), image.sizeInBytes(), image.width() ^ (image.height() << 16));
+
+    for (auto it = m_entries.find(key); it != m_entries.end() && it.key() == key;) {
+        if (std::shared_ptr<GLTexture> texture = it->texture.lock()) {
+            if (it->image == image) {
+                return texture;
+            }
+            ++it;
+        } else {
+            it = m_entries.erase(it);
+        }
+    }
+
+    std::shared_ptr<GLTexture> texture = createShadowTexture(image);
+    if (texture->internalFormat() == GL_R8) {
+        // Swizzle red to alpha and all other channels to zero
+        texture->bind();
+        texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
+    }
+
+    // drop the entries of textures that have been destroyed in the meantime
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->texture.expired()) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_entries.insert(key, Entry{image, texture});
+    return texture;
+}
+
 SceneOpenGLShadow::SceneOpenGLShadow(Window *window)
     : Shadow(window)
 {
@@ -703,13 +1284,7 @@ bool SceneOpenGLShadow::prepareBackend()
 
     Scene *scene = Compositor::self()->scene();
     scene->makeOpenGLContextCurrent();
-    m_texture = std::make_shared<GLTexture>(image);
-
-    if (m_texture->internalFormat() == GL_R8) {
-        // Swizzle red to alpha and all other channels to zero
-        m_texture->bind();
-        m_texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
-    }
+    m_texture = ShadowTextureCache::instance().texture(image);
 
     return true;
 }
@@ -804,19 +1379,65 @@ void SceneOpenGLDecorationRenderer::render(const QRegion &region)
 
     const QRect dirtyRect = region.boundingRect();
 
-    renderPart(top.toRect().intersected(dirtyRect), top.toRect(), topPosition, devicePixelRatio);
-    renderPart(bottom.toRect().intersected(dirtyRect), bottom.toRect(), bottomPosition, devicePixelRatio);
-    renderPart(left.toRect().intersected(dirtyRect), left.toRect(), leftPosition, devicePixelRatio, true);
-    renderPart(right.toRect().intersected(dirtyRect), right.toRect(), rightPosition, devicePixelRatio, true);
+    renderPart(DecorationPart::Top, top.toRect().intersected(dirtyRect), top.toRect(), topPosition, devicePixelRatio);
+    renderPart(DecorationPart::Bottom, bottom.toRect().intersected(dirtyRect), bottom.toRect(), bottomPosition, devicePixelRatio);
+    renderPart(DecorationPart::Left, left.toRect().intersected(dirtyRect), left.toRect(), leftPosition, devicePixelRatio, true);
+    renderPart(DecorationPart::Right, right.toRect().intersected(dirtyRect), right.toRect(), rightPosition, devicePixelRatio, true);
+}
+
+QByteArray SceneOpenGLDecorationRenderer::partCacheKey(DecorationPart part, const QSize &size, qreal devicePixelRatio) const
+{
+    const Decoration::DecorationBridge *bridge = workspace()->decorationBridge();
+    const Window *window = client()->window();
+
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << bridge->plugin() << bridge->theme() << int(part) << size << devicePixelRatio
+           << window->colorScheme() << client()->isActive() << client()->isMaximizedHorizontally()
+           << client()->isMaximizedVertically() << client()->isShaded() << int(client()->adjacentScreenEdges());
+    return key;
 }
 
-void SceneOpenGLDecorationRenderer::renderPart(const QRect &rect, const QRect &partRect,
+void SceneOpenGLDecorationRenderer::renderPart(DecorationPart part, const QRect &rect, const QRect &partRect,
                                                const QPoint &textureOffset,
                                                qreal devicePixelRatio, bool rotated)
 {
     if (!rect.isValid()) {
         return;
     }
+
+    // The borders of windows with the same decoration theme, state and size look the same,
+    // so they're painted once and shared. The contents of the title bar can't be shared.
+    static const bool cacheParts = qEnvironmentVariable("KWIN_DECORATION_PART_CACHE") != QLatin1String("0");
+    QCache<QByteArray, QImage> *cache = static_cast<SceneOpenGL *>(Compositor::self()->scene())->decorationPartCache();
+    QByteArray cacheKey;
+    if (cacheParts && part != DecorationPart::Top && rect == partRect) {
+        cacheKey = partCacheKey(part, rect.size(), devicePixelRatio);
+        if (const QImage *image = cache->object(cacheKey)) {
+            m_texture->update(*image, textureOffset);
+            return;
+        }
+    }
+
+    const QImage image = paintPart(rect, partRect, devicePixelRatio, rotated);
+
+    QPoint dirtyOffset = (rect.topLeft() - partRect.topLeft()) * devicePixelRatio;
+    const QMargins padding = texturePadForPart(rect, partRect);
+    if (padding.top() == 0) {
+        dirtyOffset.ry() += TexturePad;
+    }
+    if (padding.left() == 0) {
+        dirtyOffset.rx() += TexturePad;
+    }
+    m_texture->update(image, textureOffset + dirtyOffset);
+
+    if (!cacheKey.isEmpty()) {
+        cache->insert(cacheKey, new QImage(image), std::max<int>(image.sizeInBytes() / 1024, 1));
+    }
+}
+
+QImage SceneOpenGLDecorationRenderer::paintPart(const QRect &rect, const QRect &partRect, qreal devicePixelRatio, bool rotated)
+{
     // We allow partial decoration updates and it might just so happen that the
     // dirty region is completely contained inside the decoration part, i.e.
     // the dirty region doesn't touch any of the decoration's edges. In that
@@ -854,15 +1475,7 @@ void SceneOpenGLDecorationRenderer::renderPart(const QRect &rect, const QRect &p
 
     // fill padding pixels by copying from the neighbour row
     clamp(image, padClip);
-
-    QPoint dirtyOffset = (rect.topLeft() - partRect.topLeft()) * devicePixelRatio;
-    if (padding.top() == 0) {
-        dirtyOffset.ry() += TexturePad;
-    }
-    if (padding.left() == 0) {
-        dirtyOffset.rx() += TexturePad;
-    }
-    m_texture->update(image, textureOffset + dirtyOffset);
+    return image;
 }
 
 const QMargins SceneOpenGLDecorationRenderer::texturePadForPart(
@@ -909,6 +1522,7 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
 
     if (!size.isEmpty()) {
         m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
+        m_texture->setMemoryCategory(GLTexture::MemoryCategory::Decoration);
         m_texture->setYInverted(true);
         m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
         m_texture->clear();
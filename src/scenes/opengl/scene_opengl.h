@@ -19,9 +19,19 @@
 
 #include "kwinglutils.h"
 
+#include <QCache>
+#include <QImage>
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <vector>
+
 namespace KWin
 {
+class CursorTextureCache;
 class OpenGLBackend;
+class SurfaceItem;
 
 class KWIN_EXPORT SceneOpenGL
     : public Scene
@@ -38,6 +48,7 @@ public:
         qreal opacity = 1;
         bool hasAlpha = false;
         TextureCoordinateType coordinateType = UnnormalizedCoordinates;
+        GLenum filter = GL_LINEAR;
     };
 
     struct RenderContext
@@ -47,6 +58,9 @@ public:
         QStack<qreal> opacityStack;
         const QRegion clip;
         const bool hardwareClipping;
+        // whether the items end up on the render target without being scaled or rotated
+        const bool untransformed;
+        const QMatrix4x4 projectionMatrix;
     };
 
     explicit SceneOpenGL(OpenGLBackend *backend);
@@ -69,6 +83,48 @@ public:
         return m_backend;
     }
 
+    /**
+     * Returns the rendered decoration borders that are shared by the windows with the same
+     * decoration theme, state and size. The cost of an image is its size in kilobytes.
+     */
+    QCache<QByteArray, QImage> *decorationPartCache()
+    {
+        return &m_decorationPartCache;
+    }
+
+    /**
+     * Returns how much memory textures may take in bytes before the ones that aren't needed
+     * right now are evicted, or 0 if there's no budget. It's set in mebibytes with the
+     * KWIN_TEXTURE_BUDGET environment variable.
+     */
+    qint64 textureBudget() const
+    {
+        return m_textureBudget;
+    }
+    /**
+     * Returns how many window textures have been evicted to stay within the budget.
+     */
+    quint64 evictedTextureCount() const
+    {
+        return m_evictedTextures;
+    }
+
+    /**
+     * Returns how many surfaces have been drawn with one buffer pixel per pixel of the render
+     * target, so they didn't have to be resampled.
+     */
+    quint64 exactSurfaceDrawCount() const
+    {
+        return m_exactSurfaceDraws;
+    }
+    /**
+     * Returns how many surfaces had to be scaled while drawing them.
+     */
+    quint64 resampledSurfaceDrawCount() const
+    {
+        return m_resampledSurfaceDraws;
+    }
+
     QVector<QByteArray> openGLPlatformInterfaceExtensions() const override;
     std::shared_ptr<GLTexture> textureForOutput(Output *output) const override;
 
@@ -78,6 +134,9 @@ public:
 protected:
     void paintBackground(const QRegion &region) override;
     void paintOffscreenQuickView(OffscreenQuickView *w) override;
+    bool updateStaticLayer(Output *output, const std::function<void()> &paint) override;
+    void paintStaticLayer(Output *output, const QRegion &region) override;
+    void discardStaticLayer(Output *output) override;
 
 private:
     void doPaintBackground(const QVector<float> &vertices);
@@ -85,11 +144,37 @@ private:
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
     void createRenderNode(Item *item, RenderContext *context);
+    std::optional<QMatrix4x4> pixelAlignedTransform(SurfaceItem *surfaceItem, const QMatrix4x4 &transform) const;
+    GLRenderTimeQuery *beginRenderTimeQuery(Output *output);
+    void enforceTextureBudget();
+    void uploadSurfaceTextures();
+
+    struct RenderTimeQuery
+    {
+        std::unique_ptr<GLRenderTimeQuery> query;
+        quint32 frameTraceContext = 0;
+    };
+
+    struct StaticLayer
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+    };
 
     bool init_ok = true;
     OpenGLBackend *m_backend;
     GLuint vao = 0;
-    bool m_blendingEnabled = false;
+    std::map<RenderLoop *, std::vector<RenderTimeQuery>> m_renderTimeQueries;
+    std::map<Output *, StaticLayer> m_staticLayers;
+    std::unique_ptr<CursorTextureCache> m_cursorTextureCache;
+    std::unique_ptr<GLNodeBuffer> m_nodeBuffer;
+    QCache<QByteArray, QImage> m_decorationPartCache;
+    qint64 m_textureBudget = 0;
+    quint64 m_evictedTextures = 0;
+    bool m_downscaledTextures = true;
+    quint64 m_exactSurfaceDraws = 0;
+    quint64 m_resampledSurfaceDraws = 0;
+    std::chrono::steady_clock::time_point m_lastEviction;
 };
 
 /**
@@ -143,7 +228,9 @@ public:
     }
 
 private:
-    void renderPart(const QRect &rect, const QRect &partRect, const QPoint &textureOffset, qreal devicePixelRatio, bool rotated = false);
+    void renderPart(DecorationPart part, const QRect &rect, const QRect &partRect, const QPoint &textureOffset, qreal devicePixelRatio, bool rotated = false);
+    QImage paintPart(const QRect &rect, const QRect &partRect, qreal devicePixelRatio, bool rotated);
+    QByteArray partCacheKey(DecorationPart part, const QSize &size, qreal devicePixelRatio) const;
     static const QMargins texturePadForPart(const QRect &rect, const QRect &partRect);
     void resizeTexture();
     int toNativeSize(int size) const;
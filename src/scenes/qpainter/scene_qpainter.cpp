@@ -123,11 +123,16 @@ void SceneQPainter::renderItem(QPainter *painter, Item *item) const
     painter->translate(item->position());
     painter->setOpacity(painter->opacity() * item->opacity());
 
+    const QList<Item *> occludedChildItems = painter->opacity() == 1.0 ? item->occludedChildItems() : QList<Item *>();
+    const auto isCulled = [&occludedChildItems](Item *childItem) {
+        return childItem->opacity() == 0.0 || childItem->boundingRect().isEmpty() || occludedChildItems.contains(childItem);
+    };
+
     for (Item *childItem : sortedChildItems) {
         if (childItem->z() >= 0) {
             break;
         }
-        if (childItem->explicitVisible()) {
+        if (childItem->explicitVisible() && !isCulled(childItem)) {
             renderItem(painter, childItem);
         }
     }
@@ -143,7 +148,7 @@ void SceneQPainter::renderItem(QPainter *painter, Item *item) const
         if (childItem->z() < 0) {
             continue;
         }
-        if (childItem->explicitVisible()) {
+        if (childItem->explicitVisible() && !isCulled(childItem)) {
             renderItem(painter, childItem);
         }
     }
@@ -167,14 +172,18 @@ void SceneQPainter::renderSurfaceItem(QPainter *painter, SurfaceItem *surfaceIte
     }
     surfaceItem->resetDamage();
 
+    const QImage image = platformSurfaceTexture->image();
     const QRegion shape = surfaceItem->shape();
+    const QRegion opaque = surfaceItem->opaque();
     for (const QRectF rect : shape) {
         const QMatrix4x4 matrix = surfaceItem->surfaceToBufferMatrix();
         const QPointF bufferTopLeft = matrix.map(rect.topLeft());
         const QPointF bufferBottomRight = matrix.map(rect.bottomRight());
+        const QRectF sourceRect(bufferTopLeft, bufferBottomRight);
 
-        painter->drawImage(rect, platformSurfaceTexture->image(),
-                           QRectF(bufferTopLeft, bufferBottomRight));
+        if (!m_blitter.blit(painter, rect, image, sourceRect, opaque)) {
+            painter->drawImage(rect, image, sourceRect);
+        }
     }
 }
 
@@ -184,10 +193,16 @@ void SceneQPainter::renderDecorationItem(QPainter *painter, DecorationItem *deco
     QRectF dtr, dlr, drr, dbr;
     decorationItem->window()->layoutDecorationRects(dlr, dtr, drr, dbr);
 
-    painter->drawImage(dtr, renderer->image(SceneQPainterDecorationRenderer::DecorationPart::Top));
-    painter->drawImage(dlr, renderer->image(SceneQPainterDecorationRenderer::DecorationPart::Left));
-    painter->drawImage(drr, renderer->image(SceneQPainterDecorationRenderer::DecorationPart::Right));
-    painter->drawImage(dbr, renderer->image(SceneQPainterDecorationRenderer::DecorationPart::Bottom));
+    const auto drawPart = [this, painter, renderer](const QRectF &rect, SceneQPainterDecorationRenderer::DecorationPart part) {
+        const QImage image = renderer->image(part);
+        if (!m_blitter.blit(painter, rect, image, image.rect())) {
+            painter->drawImage(rect, image);
+        }
+    };
+    drawPart(dtr, SceneQPainterDecorationRenderer::DecorationPart::Top);
+    drawPart(dlr, SceneQPainterDecorationRenderer::DecorationPart::Left);
+    drawPart(drr, SceneQPainterDecorationRenderer::DecorationPart::Right);
+    drawPart(dbr, SceneQPainterDecorationRenderer::DecorationPart::Bottom);
 }
 
 DecorationRenderer *SceneQPainter::createDecorationRenderer(Decoration::DecoratedClientImpl *impl)
@@ -14,6 +14,7 @@
 #include "decorationitem.h"
 #include "scene.h"
 #include "shadow.h"
+#include "softwareblitter.h"
 
 namespace KWin
 {
@@ -59,6 +60,7 @@ private:
 
     QPainterBackend *m_backend;
     std::unique_ptr<QPainter> m_painter;
+    SoftwareBlitter m_blitter;
 };
 
 class SceneQPainterShadow : public Shadow
@@ -0,0 +1,252 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "softwareblitter.h"
+
+#include <QImage>
+#include <QPainter>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace KWin
+{
+
+// the height of the bands the visible area is split into
+static const int s_bandHeight = 32;
+// the number of pixels below which another thread isn't worth waking up
+static const int s_minimumAreaPerThread = 128 * 128;
+
+static inline uint32_t multiply(uint32_t x, uint32_t a)
+{
+    // multiplies every channel by a / 255, two channels at a time
+    uint32_t t = (x & 0xff00ff) * a;
+    t = ((t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8) & 0xff00ff;
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080) & 0xff00ff00;
+    return x | t;
+}
+
+static inline uint32_t blendPixel(uint32_t destination, uint32_t source, int alpha)
+{
+    if (alpha != 255) {
+        source = multiply(source, alpha);
+    }
+    return source + multiply(destination, 255 - (source >> 24));
+}
+
+#if defined(__SSE2__)
+static inline __m128i multiply(__m128i x, __m128i a)
+{
+    // the same as above, but on 16 bit lanes
+    const __m128i t = _mm_mullo_epi16(x, a);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), _mm_set1_epi16(0x80)), 8);
+}
+
+static inline __m128i blendPixels(__m128i destination, __m128i source, __m128i alpha, bool translucent)
+{
+    if (translucent) {
+        source = multiply(source, alpha);
+    }
+    __m128i sourceAlpha = _mm_shufflelo_epi16(source, _MM_SHUFFLE(3, 3, 3, 3));
+    sourceAlpha = _mm_shufflehi_epi16(sourceAlpha, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inverseAlpha = _mm_sub_epi16(_mm_set1_epi16(0xff), sourceAlpha);
+    return _mm_add_epi16(source, multiply(destination, inverseAlpha));
+}
+#endif
+
+void SoftwareBlitter::blend(uint32_t *destination, const uint32_t *source, int count, int alpha)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+    const __m128i constantAlpha = _mm_set1_epi16(alpha);
+    const bool translucent = alpha != 255;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff) {
+            continue;
+        }
+        if (!translucent && _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask)) == 0xffff) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), s);
+            continue;
+        }
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(destination + i));
+        const __m128i low = blendPixels(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), constantAlpha, translucent);
+        const __m128i high = blendPixels(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), constantAlpha, translucent);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < count; ++i) {
+        destination[i] = blendPixel(destination[i], source[i], alpha);
+    }
+}
+
+static bool isIntegral(qreal value)
+{
+    return std::abs(value - std::round(value)) < 0.001;
+}
+
+static bool isIntegral(const QRectF &rect)
+{
+    return isIntegral(rect.x()) && isIntegral(rect.y()) && isIntegral(rect.width()) && isIntegral(rect.height());
+}
+
+SoftwareBlitter::SoftwareBlitter()
+    : m_threadCount(QThread::idealThreadCount())
+{
+    bool ok = false;
+    const int count = qEnvironmentVariableIntValue("KWIN_QPAINTER_THREADS", &ok);
+    if (ok) {
+        m_threadCount = count;
+    }
+}
+
+int SoftwareBlitter::threadCount() const
+{
+    return m_threadCount;
+}
+
+void SoftwareBlitter::setThreadCount(int count)
+{
+    m_threadCount = count;
+}
+
+bool SoftwareBlitter::blit(QPainter *painter, const QRectF &target, const QImage &image, const QRectF &sourceRect, const QRegion &opaque) const
+{
+    if (m_threadCount <= 0 || painter->compositionMode() != QPainter::CompositionMode_SourceOver) {
+        return false;
+    }
+
+    QPaintDevice *device = painter->device();
+    if (!device || device->devType() != QInternal::Image) {
+        return false;
+    }
+    QImage *buffer = static_cast<QImage *>(device);
+    switch (buffer->format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+    default:
+        return false;
+    }
+    // writing to a shared image would detach it from the painter
+    if (!buffer->isDetached()) {
+        return false;
+    }
+
+    bool hasAlphaChannel;
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+        hasAlphaChannel = false;
+        break;
+    case QImage::Format_ARGB32_Premultiplied:
+        hasAlphaChannel = true;
+        break;
+    default:
+        return false;
+    }
+
+    const QTransform transform = painter->deviceTransform();
+    if (transform.type() > QTransform::TxTranslate) {
+        return false;
+    }
+    const QRectF deviceTargetF = transform.mapRect(target);
+    if (!isIntegral(deviceTargetF) || !isIntegral(sourceRect)) {
+        return false;
+    }
+    const QRect deviceTarget = deviceTargetF.toRect();
+    const QRect source = sourceRect.toRect();
+    if (deviceTarget.size() != source.size() || !image.rect().contains(source)) {
+        return false;
+    }
+
+    const int alpha = std::round(painter->opacity() * 255);
+    if (alpha <= 0) {
+        return true;
+    }
+
+    QRegion region = QRegion(deviceTarget) & buffer->rect();
+    if (painter->hasClipping()) {
+        region &= transform.map(painter->clipRegion());
+    }
+    if (region.isEmpty()) {
+        return true;
+    }
+
+    QRegion copyRegion;
+    if (alpha == 255) {
+        copyRegion = hasAlphaChannel ? transform.map(opaque) & region : region;
+    }
+    const QRegion blendRegion = region - copyRegion;
+
+    struct Band
+    {
+        QRect rect;
+        bool copy;
+    };
+    std::vector<Band> bands;
+    int area = 0;
+    const auto split = [&bands, &area](const QRegion &region, bool copy) {
+        for (const QRect &rect : region) {
+            for (int y = rect.top(); y <= rect.bottom(); y += s_bandHeight) {
+                bands.push_back(Band{QRect(rect.x(), y, rect.width(), std::min(s_bandHeight, rect.bottom() - y + 1)), copy});
+            }
+            area += rect.width() * rect.height();
+        }
+    };
+    split(copyRegion, true);
+    split(blendRegion, false);
+
+    uchar *destinationBits = buffer->bits();
+    const qsizetype destinationStride = buffer->bytesPerLine();
+    const uchar *sourceBits = image.constBits();
+    const qsizetype sourceStride = image.bytesPerLine();
+    const QPoint offset = source.topLeft() - deviceTarget.topLeft();
+
+    const auto draw = [&](const Band &band) {
+        for (int y = band.rect.top(); y <= band.rect.bottom(); ++y) {
+            uint32_t *destination = reinterpret_cast<uint32_t *>(destinationBits + y * destinationStride) + band.rect.x();
+            const uint32_t *source = reinterpret_cast<const uint32_t *>(sourceBits + (y + offset.y()) * sourceStride) + band.rect.x() + offset.x();
+            if (band.copy) {
+                std::memcpy(destination, source, band.rect.width() * sizeof(uint32_t));
+            } else {
+                blend(destination, source, band.rect.width(), alpha);
+            }
+        }
+    };
+
+    const int threadCount = std::min({m_threadCount, int(bands.size()), area / s_minimumAreaPerThread});
+    if (threadCount <= 1) {
+        for (const Band &band : bands) {
+            draw(band);
+        }
+    } else {
+        // every job takes every n-th band, so the work of a big window is spread evenly
+        std::vector<int> jobs(threadCount);
+        std::iota(jobs.begin(), jobs.end(), 0);
+        QtConcurrent::blockingMap(jobs, [&](int &job) {
+            for (size_t i = job; i < bands.size(); i += threadCount) {
+                draw(bands[i]);
+            }
+        });
+    }
+
+    return true;
+}
+
+} // namespace KWin
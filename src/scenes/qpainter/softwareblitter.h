@@ -0,0 +1,64 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QRegion>
+
+#include <cstdint>
+
+class QImage;
+class QPainter;
+
+namespace KWin
+{
+
+/**
+ * The SoftwareBlitter class draws images in the QPainter scene without going through
+ * QPainter::drawImage().
+ *
+ * Most of what the QPainter scene draws are untransformed window surfaces, which only have to
+ * be copied or blended onto the buffer. The blitter splits the visible part of such an image
+ * into bands and blends them on a few threads at once. Opaque parts are copied with memcpy(),
+ * translucent parts are blended with a kernel that handles four premultiplied pixels at once
+ * where SSE2 is available.
+ *
+ * Anything else, e.g. a scaled image or a target that's not a 32 bit RGB image, is left to
+ * QPainter. The number of threads can be set with the KWIN_QPAINTER_THREADS environment
+ * variable, 1 blends everything on the calling thread and 0 disables the blitter entirely.
+ */
+class KWIN_EXPORT SoftwareBlitter
+{
+public:
+    SoftwareBlitter();
+
+    /**
+     * Draws the @a sourceRect of the @a image to the @a target rectangle of the @a painter,
+     * with the painter's opacity and clip. @a opaque is the region of the target that is
+     * known to be opaque, in the same coordinates as @a target.
+     *
+     * Returns @c false if the blitter can't draw the image, the caller has to draw it with
+     * the painter then.
+     */
+    bool blit(QPainter *painter, const QRectF &target, const QImage &image, const QRectF &sourceRect, const QRegion &opaque = QRegion()) const;
+
+    int threadCount() const;
+    void setThreadCount(int count);
+
+    /**
+     * Blends @a count premultiplied ARGB32 pixels from @a source over @a destination, with
+     * the source multiplied by @a alpha, which goes from 0 to 255.
+     */
+    static void blend(uint32_t *destination, const uint32_t *source, int count, int alpha);
+
+private:
+    int m_threadCount;
+};
+
+} // namespace KWin
@@ -1120,6 +1120,19 @@ void ScreenEdges::recreateEdges()
         }
     }
     qDeleteAll(oldEdges);
+    updateEdgeRegion();
+}
+
+void ScreenEdges::updateEdgeRegion()
+{
+    // The edges only ever sit along the outer boundary of the outputs, so most pointer motion
+    // happens far away from all of them. Keeping the area they cover around lets the motion
+    // handling bail out with a single lookup instead of asking every edge.
+    m_edgeRegion = QRegion();
+    for (const Edge *edge : std::as_const(m_edges)) {
+        m_edgeRegion += edge->geometry();
+        m_edgeRegion += edge->approachGeometry();
+    }
 }
 
 void ScreenEdges::createVerticalEdge(ElectricBorder border, const QRect &screen, const QRect &fullArea, Output *output)
@@ -1312,6 +1325,7 @@ void ScreenEdges::reserve(Window *client, ElectricBorder border)
     } else {
         if (hadBorder) { // show again
             client->showOnScreenEdge();
+            updateEdgeRegion();
         }
     }
 }
@@ -1405,6 +1419,7 @@ void ScreenEdges::createEdgeForClient(Window *client, ElectricBorder border)
         edge->setClient(client);
         m_edges.append(edge);
         edge->reserve();
+        updateEdgeRegion();
     } else {
         // we could not create an edge window, so don't allow the window to hide
         client->showOnScreenEdge();
@@ -1413,19 +1428,28 @@ void ScreenEdges::createEdgeForClient(Window *client, ElectricBorder border)
 
 void ScreenEdges::deleteEdgeForClient(Window *c)
 {
+    bool removed = false;
     auto it = m_edges.begin();
     while (it != m_edges.end()) {
         if ((*it)->client() == c) {
             delete *it;
             it = m_edges.erase(it);
+            removed = true;
         } else {
             it++;
         }
     }
+    if (removed) {
+        updateEdgeRegion();
+    }
 }
 
 void ScreenEdges::check(const QPoint &pos, const QDateTime &now, bool forceNoPushBack)
 {
+    if (!m_edgeRegion.contains(pos)) {
+        return;
+    }
+    m_pointerInEdgeRegion = true;
     bool activatedForClient = false;
     for (auto it = m_edges.begin(); it != m_edges.end(); ++it) {
         if (!(*it)->isReserved() || (*it)->isBlocked()) {
@@ -1454,6 +1478,13 @@ bool ScreenEdges::isEntered(QMouseEvent *event)
     if (event->type() != QEvent::MouseMove) {
         return false;
     }
+    // Away from all edges there is nothing to trigger, the edges only need to be told once
+    // that the pointer left so that they stop approaching.
+    const bool inEdgeRegion = m_edgeRegion.contains(event->globalPos());
+    if (!inEdgeRegion && !m_pointerInEdgeRegion) {
+        return false;
+    }
+    m_pointerInEdgeRegion = inEdgeRegion;
     bool activated = false;
     bool activatedForClient = false;
     for (auto it = m_edges.begin(); it != m_edges.end(); ++it) {
@@ -26,6 +26,7 @@
 #include <QDateTime>
 #include <QObject>
 #include <QRect>
+#include <QRegion>
 #include <QVector>
 
 class QAction;
@@ -411,6 +412,7 @@ private:
     ElectricBorderAction actionForTouchEdge(Edge *edge) const;
     void createEdgeForClient(Window *client, ElectricBorder border);
     void deleteEdgeForClient(Window *client);
+    void updateEdgeRegion();
     bool m_desktopSwitching;
     bool m_desktopSwitchingMovingClients;
     QSize m_cursorPushBackDistance;
@@ -418,6 +420,9 @@ private:
     int m_reactivateThreshold;
     Qt::Orientations m_virtualDesktopLayout;
     QList<Edge *> m_edges;
+    // the area covered by the geometry and approach geometry of all edges
+    QRegion m_edgeRegion;
+    bool m_pointerInEdgeRegion = false;
     KSharedConfig::Ptr m_config;
     ElectricBorderAction m_actionTopLeft;
     ElectricBorderAction m_actionTop;
@@ -11,8 +11,10 @@
 #include "scriptedeffect.h"
 #include "scripting_logging.h"
 #include "scriptingutils.h"
+#include "scriptwatchdog.h"
 #include "workspace_wrapper.h"
 
+#include "effects.h"
 #include "input.h"
 #include "screenedge.h"
 #include "workspace.h"
@@ -287,7 +289,10 @@ bool ScriptedEffect::init(const QString &effectName, const QString &pathToScript
         globalObject.setProperty(propertyName, selfObject.property(propertyName));
     }
 
+    ScriptWatchdog::self()->reset(m_effectName);
+    ScriptWatchdog::Guard guard(m_engine);
     const QJSValue result = m_engine->evaluate(QString::fromUtf8(scriptFile.readAll()));
+    ScriptWatchdog::self()->account(m_effectName, guard.finish(), guard.wasInterrupted());
 
     if (result.isError()) {
         qCWarning(KWIN_SCRIPTING, "%s:%d: error: %s", qPrintable(scriptFile.fileName()),
@@ -660,7 +665,7 @@ void ScriptedEffect::registerShortcut(const QString &objectName, const QString &
     connect(action, &QAction::triggered, this, [this, action, callback]() {
         QJSValue actionObject = m_engine->newQObject(action);
         QQmlEngine::setObjectOwnership(action, QQmlEngine::CppOwnership);
-        QJSValue(callback).call(QJSValueList{actionObject});
+        call(callback, QJSValueList{actionObject});
     });
 }
 
@@ -669,12 +674,30 @@ bool ScriptedEffect::borderActivated(ElectricBorder edge)
     auto it = screenEdgeCallbacks().constFind(edge);
     if (it != screenEdgeCallbacks().constEnd()) {
         for (const QJSValue &callback : it.value()) {
-            QJSValue(callback).call();
+            call(callback);
         }
     }
     return true;
 }
 
+QJSValue ScriptedEffect::call(QJSValue callback, const QJSValueList &arguments)
+{
+    if (m_suspended) {
+        return QJSValue();
+    }
+    ScriptWatchdog::Guard guard(m_engine);
+    const QJSValue result = callback.call(arguments);
+    if (ScriptWatchdog::self()->account(m_effectName, guard.finish(), guard.wasInterrupted())) {
+        m_suspended = true;
+        QMetaObject::invokeMethod(
+            effects, [name = m_effectName]() {
+                static_cast<EffectsHandlerImpl *>(effects)->unloadEffect(name);
+            },
+            Qt::QueuedConnection);
+    }
+    return result;
+}
+
 QJSValue ScriptedEffect::readConfig(const QString &key, const QJSValue &defaultValue)
 {
     if (!m_config) {
@@ -730,7 +753,7 @@ bool ScriptedEffect::registerRealtimeScreenEdge(int edge, const QJSValue &callba
             auto it = realtimeScreenEdgeCallbacks().constFind(edge);
             if (it != realtimeScreenEdgeCallbacks().constEnd()) {
                 for (const QJSValue &callback : it.value()) {
-                    QJSValue(callback).call({edge});
+                    call(callback, {edge});
                 }
             }
         });
@@ -742,7 +765,7 @@ bool ScriptedEffect::registerRealtimeScreenEdge(int edge, const QJSValue &callba
                     delta.setProperty("width", deltaProgress.x());
                     delta.setProperty("height", deltaProgress.y());
 
-                    QJSValue(callback).call({border, QJSValue(delta), m_engine->newQObject(screen)});
+                    call(callback, {border, QJSValue(delta), m_engine->newQObject(screen)});
                 }
             }
         });
@@ -774,8 +797,8 @@ bool ScriptedEffect::registerTouchScreenEdge(int edge, const QJSValue &callback)
         return false;
     }
     QAction *action = new QAction(this);
-    connect(action, &QAction::triggered, this, [callback]() {
-        QJSValue(callback).call();
+    connect(action, &QAction::triggered, this, [this, callback]() {
+        call(callback);
     });
     workspace()->screenEdges()->reserveTouch(KWin::ElectricBorder(edge), action);
     m_touchScreenEdgeCallbacks.insert(edge, action);
@@ -205,6 +205,11 @@ private:
     };
 
     QJSValue animate_helper(const QJSValue &object, AnimationType animationType);
+    /**
+     * Invokes @p callback with @p arguments under the ScriptWatchdog, the effect gets unloaded
+     * if it slows down the desktop.
+     */
+    QJSValue call(QJSValue callback, const QJSValueList &arguments = QJSValueList());
 
     GLShader *findShader(uint shaderId) const;
 
@@ -218,6 +223,7 @@ private:
     int m_chainPosition;
     QHash<int, QAction *> m_touchScreenEdgeCallbacks;
     Effect *m_activeFullScreenEffect = nullptr;
+    bool m_suspended = false;
     std::map<uint, std::unique_ptr<GLShader>> m_shaders;
     uint m_nextShaderId{1u};
 };
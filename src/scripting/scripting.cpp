@@ -17,6 +17,8 @@
 #include "screenedgeitem.h"
 #include "scripting_logging.h"
 #include "scriptingutils.h"
+#include "scriptwatchdog.h"
+#include "windowchangecoalescer.h"
 #include "windowthumbnailitem.h"
 #include "workspace_wrapper.h"
 
@@ -90,6 +92,70 @@ static QSizeF scriptValueToSizeF(const QJSValue &value)
                   value.property(QStringLiteral("height")).toNumber());
 }
 
+// The functions that are bound to a script, they are globals in the script.
+static const QStringList s_scriptFunctions{
+    QStringLiteral("readConfig"),
+    QStringLiteral("callDBus"),
+
+    QStringLiteral("registerShortcut"),
+    QStringLiteral("registerScreenEdge"),
+    QStringLiteral("unregisterScreenEdge"),
+    QStringLiteral("registerTouchScreenEdge"),
+    QStringLiteral("unregisterTouchScreenEdge"),
+    QStringLiteral("registerUserActionsMenu"),
+    QStringLiteral("registerWindowChangesCallback"),
+};
+
+/**
+ * Installs the globals that don't depend on the script in the given @a engine.
+ */
+static void installGlobals(QJSEngine *engine)
+{
+    // Install console functions (e.g. console.assert(), console.log(), etc).
+    engine->installExtensions(QJSEngine::ConsoleExtension);
+
+    // Make the timer visible to QJSEngine.
+    QJSValue timerMetaObject = engine->newQMetaObject(&KWin::ScriptTimer::staticMetaObject);
+    engine->globalObject().setProperty("QTimer", timerMetaObject);
+
+    // Expose enums.
+    engine->globalObject().setProperty(QStringLiteral("KWin"), engine->newQMetaObject(&KWin::QtScriptWorkspaceWrapper::staticMetaObject));
+
+    // Make the options object visible to QJSEngine.
+    QJSValue optionsObject = engine->newQObject(KWin::options);
+    QQmlEngine::setObjectOwnership(KWin::options, QQmlEngine::CppOwnership);
+    engine->globalObject().setProperty(QStringLiteral("options"), optionsObject);
+
+    // Make the workspace visible to QJSEngine.
+    QJSValue workspaceObject = engine->newQObject(KWin::Scripting::self()->workspaceWrapper());
+    QQmlEngine::setObjectOwnership(KWin::Scripting::self()->workspaceWrapper(), QQmlEngine::CppOwnership);
+    engine->globalObject().setProperty(QStringLiteral("workspace"), workspaceObject);
+
+    // Inject assertion functions. It would be better to create a module with all
+    // this assert functions or just deprecate them in favor of console.assert().
+    QJSValue result = engine->evaluate(QStringLiteral(R"(
+        function assert(condition, message) {
+            console.assert(condition, message || 'Assertion failed');
+        }
+        function assertTrue(condition, message) {
+            console.assert(condition, message || 'Assertion failed');
+        }
+        function assertFalse(condition, message) {
+            console.assert(!condition, message || 'Assertion failed');
+        }
+        function assertNull(value, message) {
+            console.assert(value === null, message || 'Assertion failed');
+        }
+        function assertNotNull(value, message) {
+            console.assert(value !== null, message || 'Assertion failed');
+        }
+        function assertEquals(expected, actual, message) {
+            console.assert(expected === actual, message || 'Assertion failed');
+        }
+    )"));
+    Q_ASSERT(!result.isError());
+}
+
 KWin::AbstractScript::AbstractScript(int id, QString scriptName, QString pluginName, QObject *parent)
     : QObject(parent)
     , m_scriptId(id)
@@ -126,9 +192,14 @@ KWin::ScriptTimer::ScriptTimer(QObject *parent)
 
 KWin::Script::Script(int id, QString scriptName, QString pluginName, QObject *parent)
     : AbstractScript(id, scriptName, pluginName, parent)
-    , m_engine(new QJSEngine(this))
+    , m_engine(Scripting::self()->sharedScriptEngine())
     , m_starting(false)
 {
+    m_sharedEngine = m_engine != nullptr;
+    if (!m_sharedEngine) {
+        m_engine = new QJSEngine(this);
+    }
+
     // TODO: Remove in kwin 6. We have these converters only for compatibility reasons.
     if (!QMetaType::hasRegisteredConverterFunction<QJSValue, QRect>()) {
         QMetaType::registerConverter<QJSValue, QRect>(scriptValueToRect);
@@ -210,70 +281,40 @@ void KWin::Script::slotScriptLoadedFromFile()
         return;
     }
 
-    // Install console functions (e.g. console.assert(), console.log(), etc).
-    m_engine->installExtensions(QJSEngine::ConsoleExtension);
-
-    // Make the timer visible to QJSEngine.
-    QJSValue timerMetaObject = m_engine->newQMetaObject(&ScriptTimer::staticMetaObject);
-    m_engine->globalObject().setProperty("QTimer", timerMetaObject);
-
-    // Expose enums.
-    m_engine->globalObject().setProperty(QStringLiteral("KWin"), m_engine->newQMetaObject(&QtScriptWorkspaceWrapper::staticMetaObject));
-
-    // Make the options object visible to QJSEngine.
-    QJSValue optionsObject = m_engine->newQObject(options);
-    QQmlEngine::setObjectOwnership(options, QQmlEngine::CppOwnership);
-    m_engine->globalObject().setProperty(QStringLiteral("options"), optionsObject);
-
-    // Make the workspace visible to QJSEngine.
-    QJSValue workspaceObject = m_engine->newQObject(Scripting::self()->workspaceWrapper());
-    QQmlEngine::setObjectOwnership(Scripting::self()->workspaceWrapper(), QQmlEngine::CppOwnership);
-    m_engine->globalObject().setProperty(QStringLiteral("workspace"), workspaceObject);
+    if (!m_sharedEngine) {
+        installGlobals(m_engine);
+    }
 
     QJSValue self = m_engine->newQObject(this);
     QQmlEngine::setObjectOwnership(this, QQmlEngine::CppOwnership);
 
-    static const QStringList globalProperties{
-        QStringLiteral("readConfig"),
-        QStringLiteral("callDBus"),
-
-        QStringLiteral("registerShortcut"),
-        QStringLiteral("registerScreenEdge"),
-        QStringLiteral("unregisterScreenEdge"),
-        QStringLiteral("registerTouchScreenEdge"),
-        QStringLiteral("unregisterTouchScreenEdge"),
-        QStringLiteral("registerUserActionsMenu"),
-    };
-
-    for (const QString &propertyName : globalProperties) {
-        m_engine->globalObject().setProperty(propertyName, self.property(propertyName));
-    }
-
-    // Inject assertion functions. It would be better to create a module with all
-    // this assert functions or just deprecate them in favor of console.assert().
-    QJSValue result = m_engine->evaluate(QStringLiteral(R"(
-        function assert(condition, message) {
-            console.assert(condition, message || 'Assertion failed');
-        }
-        function assertTrue(condition, message) {
-            console.assert(condition, message || 'Assertion failed');
-        }
-        function assertFalse(condition, message) {
-            console.assert(!condition, message || 'Assertion failed');
-        }
-        function assertNull(value, message) {
-            console.assert(value === null, message || 'Assertion failed');
-        }
-        function assertNotNull(value, message) {
-            console.assert(value !== null, message || 'Assertion failed');
+    QString source = QString::fromUtf8(watcher->result());
+    QJSValueList arguments;
+    if (m_sharedEngine) {
+        // In the shared engine, the script runs in a function of its own, so its variables and
+        // functions don't clash with the ones of other scripts. The functions that are bound to
+        // the script are passed as arguments. The source starts on the first line of the
+        // function to keep the line numbers in errors.
+        for (const QString &functionName : s_scriptFunctions) {
+            arguments << self.property(functionName);
         }
-        function assertEquals(expected, actual, message) {
-            console.assert(expected === actual, message || 'Assertion failed');
+        source = QLatin1String("(function (") + s_scriptFunctions.join(QLatin1Char(',')) + QLatin1String(") {") + source + QLatin1String("\n})");
+    } else {
+        for (const QString &functionName : s_scriptFunctions) {
+            m_engine->globalObject().setProperty(functionName, self.property(functionName));
         }
-    )"));
-    Q_ASSERT(!result.isError());
+    }
 
-    result = m_engine->evaluate(QString::fromUtf8(watcher->result()), fileName());
+    // a script that got reloaded deserves another chance
+    ScriptWatchdog::self()->reset(pluginName());
+    ScriptWatchdog::Guard guard(m_engine);
+    QJSValue result = m_engine->evaluate(source, fileName());
+    if (m_sharedEngine && !result.isError()) {
+        result = result.call(arguments);
+    }
+    const std::chrono::nanoseconds time = guard.finish();
+    addRunningTime(time);
+    ScriptWatchdog::self()->account(pluginName(), time, guard.wasInterrupted());
     if (result.isError()) {
         qCWarning(KWIN_SCRIPTING, "%s:%d: error: %s", qPrintable(fileName()),
                   result.property(QStringLiteral("lineNumber")).toInt(),
@@ -368,7 +409,7 @@ void KWin::Script::callDBus(const QString &service, const QString &path, const Q
             arguments << m_engine->toScriptValue(dbusToVariant(variant));
         }
 
-        QJSValue(callback).call(arguments);
+        call(callback, arguments);
     });
 }
 
@@ -388,7 +429,7 @@ bool KWin::Script::registerShortcut(const QString &objectName, const QString &te
     input()->registerShortcut(shortcut, action);
 
     connect(action, &QAction::triggered, this, [this, action, callback]() {
-        QJSValue(callback).call({m_engine->toScriptValue(action)});
+        call(callback, {m_engine->toScriptValue(action)});
     });
 
     return true;
@@ -438,8 +479,8 @@ bool KWin::Script::registerTouchScreenEdge(int edge, const QJSValue &callback)
     workspace()->screenEdges()->reserveTouch(KWin::ElectricBorder(edge), action);
     m_touchScreenEdgeCallbacks.insert(edge, action);
 
-    connect(action, &QAction::triggered, this, [callback]() {
-        QJSValue(callback).call();
+    connect(action, &QAction::triggered, this, [this, callback]() {
+        call(callback);
     });
 
     return true;
@@ -467,13 +508,48 @@ void KWin::Script::registerUserActionsMenu(const QJSValue &callback)
     m_userActionsMenuCallbacks.append(callback);
 }
 
+void KWin::Script::registerWindowChangesCallback(const QJSValue &callback)
+{
+    if (!callback.isCallable()) {
+        m_engine->throwError(QStringLiteral("Window changes handler must be callable"));
+        return;
+    }
+    if (m_windowChangesCallbacks.isEmpty()) {
+        connect(Scripting::self()->windowChangeCoalescer(), &WindowChangeCoalescer::windowsChanged, this,
+                [this](const QList<KWin::Window *> &windows, const QStringList &removedIds) {
+                    const QJSValueList arguments{m_engine->toScriptValue(windows), m_engine->toScriptValue(removedIds)};
+                    for (const QJSValue &callback : qAsConst(m_windowChangesCallbacks)) {
+                        call(callback, arguments);
+                    }
+                });
+    }
+    m_windowChangesCallbacks.append(callback);
+}
+
+QJSValue KWin::Script::call(QJSValue callback, const QJSValueList &arguments)
+{
+    if (m_suspended) {
+        return QJSValue();
+    }
+    ScriptWatchdog::Guard guard(m_engine);
+    const QJSValue result = callback.call(arguments);
+    const std::chrono::nanoseconds time = guard.finish();
+    addRunningTime(time);
+    if (ScriptWatchdog::self()->account(pluginName(), time, guard.wasInterrupted())) {
+        // the script may be in the middle of something, so it's unloaded once that is over
+        m_suspended = true;
+        QMetaObject::invokeMethod(this, &AbstractScript::stop, Qt::QueuedConnection);
+    }
+    return result;
+}
+
 QList<QAction *> KWin::Script::actionsForUserActionMenu(KWin::Window *client, QMenu *parent)
 {
     QList<QAction *> actions;
     actions.reserve(m_userActionsMenuCallbacks.count());
 
     for (QJSValue callback : qAsConst(m_userActionsMenuCallbacks)) {
-        const QJSValue result = callback.call({m_engine->toScriptValue(client)});
+        const QJSValue result = call(callback, {m_engine->toScriptValue(client)});
         if (result.isError()) {
             continue;
         }
@@ -494,9 +570,9 @@ bool KWin::Script::slotBorderActivated(ElectricBorder border)
     if (callbacks.isEmpty()) {
         return false;
     }
-    std::for_each(callbacks.begin(), callbacks.end(), [](QJSValue callback) {
-        callback.call();
-    });
+    for (const QJSValue &callback : callbacks) {
+        call(callback);
+    }
     return true;
 }
 
@@ -531,7 +607,7 @@ QAction *KWin::Script::createAction(const QString &title, const QJSValue &item,
     action->setChecked(checked);
 
     connect(action, &QAction::triggered, this, [this, action, callback]() {
-        QJSValue(callback).call({m_engine->toScriptValue(action)});
+        call(callback, {m_engine->toScriptValue(action)});
     });
 
     return action;
@@ -824,6 +900,20 @@ KWin::AbstractScript *KWin::Scripting::findScript(const QString &pluginName) con
     return nullptr;
 }
 
+QList<KWin::AbstractScript *> KWin::Scripting::loadedScripts() const
+{
+    QMutexLocker locker(m_scriptsLock.get());
+    return scripts;
+}
+
+KWin::WindowChangeCoalescer *KWin::Scripting::windowChangeCoalescer()
+{
+    if (!m_windowChangeCoalescer) {
+        m_windowChangeCoalescer = new WindowChangeCoalescer(this);
+    }
+    return m_windowChangeCoalescer;
+}
+
 bool KWin::Scripting::unloadScript(const QString &pluginName)
 {
     QMutexLocker locker(m_scriptsLock.get());
@@ -836,6 +926,16 @@ bool KWin::Scripting::unloadScript(const QString &pluginName)
     return false;
 }
 
+QVariantMap KWin::Scripting::suspendedScripts() const
+{
+    QVariantMap ret;
+    const auto reports = ScriptWatchdog::self()->reports();
+    for (const ScriptWatchdog::Report &report : reports) {
+        ret.insert(report.name, report.reason);
+    }
+    return ret;
+}
+
 void KWin::Scripting::runScripts()
 {
     QMutexLocker locker(m_scriptsLock.get());
@@ -878,10 +978,28 @@ int KWin::Scripting::loadDeclarativeScript(const QString &filePath, const QStrin
 
 KWin::Scripting::~Scripting()
 {
+    // The scripts hold values of the shared engine, so they have to go first.
+    if (m_sharedScriptEngine) {
+        qDeleteAll(findChildren<Script *>(QString(), Qt::FindDirectChildrenOnly));
+        delete m_sharedScriptEngine;
+    }
     QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/Scripting"));
     s_self = nullptr;
 }
 
+QJSEngine *KWin::Scripting::sharedScriptEngine()
+{
+    const KConfigGroup group = kwinApp()->config()->group(QStringLiteral("Scripting"));
+    if (!group.readEntry("SharedEngine", false)) {
+        return nullptr;
+    }
+    if (!m_sharedScriptEngine) {
+        m_sharedScriptEngine = new QJSEngine(this);
+        installGlobals(m_sharedScriptEngine);
+    }
+    return m_sharedScriptEngine;
+}
+
 QList<QAction *> KWin::Scripting::actionsForUserActionMenu(KWin::Window *c, QMenu *parent)
 {
     QList<QAction *> actions;
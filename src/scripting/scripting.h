@@ -23,6 +23,8 @@
 #include <QDBusContext>
 #include <QDBusMessage>
 
+#include <chrono>
+
 class QQmlComponent;
 class QQmlContext;
 class QQmlEngine;
@@ -39,6 +41,7 @@ namespace KWin
 {
 class Window;
 class QtScriptWorkspaceWrapper;
+class WindowChangeCoalescer;
 
 class KWIN_EXPORT AbstractScript : public QObject
 {
@@ -65,6 +68,20 @@ public:
 
     KConfigGroup config() const;
 
+    /**
+     * The time the script spent running its code and the callbacks that KWin invoked, and how
+     * many calls that were. Handlers that the script connected to signals by itself are run
+     * by the JavaScript engine and aren't included.
+     */
+    std::chrono::nanoseconds runningTime() const
+    {
+        return m_runningTime;
+    }
+    quint64 callCount() const
+    {
+        return m_callCount;
+    }
+
 public Q_SLOTS:
     void stop();
     virtual void run() = 0;
@@ -81,12 +98,19 @@ protected:
         m_running = running;
         Q_EMIT runningChanged(m_running);
     }
+    void addRunningTime(std::chrono::nanoseconds time)
+    {
+        m_runningTime += time;
+        ++m_callCount;
+    }
 
 private:
     int m_scriptId;
     QString m_fileName;
     QString m_pluginName;
     bool m_running;
+    std::chrono::nanoseconds m_runningTime = std::chrono::nanoseconds::zero();
+    quint64 m_callCount = 0;
 };
 
 /**
@@ -142,6 +166,18 @@ public:
      */
     Q_INVOKABLE void registerUserActionsMenu(const QJSValue &callback);
 
+    /**
+     * @brief Registers the given @p callback to be invoked with the windows that changed.
+     *
+     * Instead of being invoked for every change, the callback is invoked at most once per frame
+     * with an array of the windows that were added, moved, resized, minimized, maximized, made
+     * fullscreen or sent to other desktops or activities in the meantime, and an array with the
+     * internal ids of the windows that have been removed.
+     *
+     * @param callback Script method to execute when windows changed.
+     */
+    Q_INVOKABLE void registerWindowChangesCallback(const QJSValue &callback);
+
     /**
      * @brief Creates actions for the UserActionsMenu by invoking the registered callbacks.
      *
@@ -242,12 +278,21 @@ private:
      */
     QAction *createMenu(const QString &title, const QJSValue &items, QMenu *parent);
 
+    /**
+     * Invokes @p callback with @p arguments and accounts the time it took to the script. If
+     * the ScriptWatchdog finds that the script slows down the desktop, it gets unloaded.
+     */
+    QJSValue call(QJSValue callback, const QJSValueList &arguments = QJSValueList());
+
     QJSEngine *m_engine;
     QDBusMessage m_invocationContext;
     bool m_starting;
+    bool m_sharedEngine = false;
+    bool m_suspended = false;
     QHash<int, QJSValueList> m_screenEdgeCallbacks;
     QHash<int, QAction *> m_touchScreenEdgeCallbacks;
     QJSValueList m_userActionsMenuCallbacks;
+    QJSValueList m_windowChangesCallbacks;
 };
 
 class DeclarativeScript : public AbstractScript
@@ -331,6 +376,11 @@ public:
     Q_SCRIPTABLE Q_INVOKABLE int loadDeclarativeScript(const QString &filePath, const QString &pluginName = QString());
     Q_SCRIPTABLE Q_INVOKABLE bool isScriptLoaded(const QString &pluginName) const;
     Q_SCRIPTABLE Q_INVOKABLE bool unloadScript(const QString &pluginName);
+    /**
+     * Returns the scripts and scripted effects that have been suspended by the ScriptWatchdog,
+     * mapped to the reason.
+     */
+    Q_SCRIPTABLE QVariantMap suspendedScripts() const;
 
     /**
      * @brief Invokes all registered callbacks to add actions to the UserActionsMenu.
@@ -346,8 +396,20 @@ public:
     QQmlContext *declarativeScriptSharedContext() const;
     QQmlContext *declarativeScriptSharedContext();
     QtScriptWorkspaceWrapper *workspaceWrapper() const;
+    /**
+     * Returns the engine that the JavaScript scripts share if the SharedEngine option in the
+     * Scripting group is set, or null if every script gets an engine of its own.
+     */
+    QJSEngine *sharedScriptEngine();
 
     AbstractScript *findScript(const QString &pluginName) const;
+    QList<AbstractScript *> loadedScripts() const;
+
+    /**
+     * Returns the coalescer that tells scripts about changed windows once per frame, it's
+     * created when a script asks for it the first time.
+     */
+    WindowChangeCoalescer *windowChangeCoalescer();
 
     static Scripting *self();
     static Scripting *create(QObject *parent);
@@ -366,6 +428,8 @@ private:
     QQmlEngine *m_qmlEngine;
     QQmlContext *m_declarativeScriptSharedContext;
     QtScriptWorkspaceWrapper *m_workspaceWrapper;
+    QJSEngine *m_sharedScriptEngine = nullptr;
+    WindowChangeCoalescer *m_windowChangeCoalescer = nullptr;
 };
 
 inline QQmlEngine *Scripting::qmlEngine() const
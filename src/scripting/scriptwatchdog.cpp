@@ -0,0 +1,206 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scriptwatchdog.h"
+#include "scripting_logging.h"
+
+#include <config-kwin.h>
+
+#include <KLocalizedString>
+#if KWIN_BUILD_NOTIFICATIONS
+#include <KNotification>
+#endif
+
+#include <QJSEngine>
+
+#include <algorithm>
+#include <memory>
+#include <pthread.h>
+
+namespace KWin
+{
+
+// a script is suspended once it has used more than its budget for this many windows in a row
+static const int s_maxStrikes = 3;
+static const std::chrono::seconds s_window(1);
+
+ScriptWatchdog::Guard::Guard(QJSEngine *engine, ScriptWatchdog *watchdog)
+    : m_watchdog(watchdog)
+    , m_engine(engine)
+    , m_start(std::chrono::steady_clock::now())
+{
+    if (m_watchdog->m_timeout > std::chrono::milliseconds::zero()) {
+        m_deadline = m_start + m_watchdog->m_timeout;
+        m_watchdog->watch(this);
+    }
+}
+
+ScriptWatchdog::Guard::~Guard()
+{
+    finish();
+}
+
+std::chrono::nanoseconds ScriptWatchdog::Guard::finish()
+{
+    if (!m_finished) {
+        m_finished = true;
+        if (m_watchdog->m_timeout > std::chrono::milliseconds::zero()) {
+            m_watchdog->unwatch(this);
+        }
+    }
+    return std::chrono::steady_clock::now() - m_start;
+}
+
+bool ScriptWatchdog::Guard::wasInterrupted() const
+{
+    return m_interrupted;
+}
+
+ScriptWatchdog::ScriptWatchdog(std::chrono::milliseconds timeout, qreal budget)
+    : m_timeout(timeout)
+    , m_budget(budget)
+{
+    if (m_timeout > std::chrono::milliseconds::zero()) {
+        m_thread = std::thread(&ScriptWatchdog::run, this);
+        pthread_setname_np(m_thread.native_handle(), "kwin_script_wd");
+    }
+}
+
+ScriptWatchdog::~ScriptWatchdog()
+{
+    if (m_thread.joinable()) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_quit = true;
+        }
+        m_changed.notify_all();
+        m_thread.join();
+    }
+}
+
+ScriptWatchdog *ScriptWatchdog::self()
+{
+    static const std::unique_ptr<ScriptWatchdog> watchdog = [] {
+        bool ok = false;
+        int timeout = qEnvironmentVariableIntValue("KWIN_SCRIPT_WATCHDOG_TIMEOUT", &ok);
+        if (!ok) {
+            timeout = 1000;
+        }
+        int budget = qEnvironmentVariableIntValue("KWIN_SCRIPT_WATCHDOG_BUDGET", &ok);
+        if (!ok) {
+            budget = 50;
+        }
+        return std::make_unique<ScriptWatchdog>(std::chrono::milliseconds(std::max(timeout, 0)), std::max(budget, 0) / 100.0);
+    }();
+    return watchdog.get();
+}
+
+void ScriptWatchdog::watch(Guard *guard)
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_guards.push_back(guard);
+    }
+    m_changed.notify_all();
+}
+
+void ScriptWatchdog::unwatch(Guard *guard)
+{
+    std::unique_lock lock(m_mutex);
+    m_guards.erase(std::remove(m_guards.begin(), m_guards.end(), guard), m_guards.end());
+    if (guard->m_interrupted) {
+        // an outer call into the same engine that timed out has to stay interrupted
+        const bool stillInterrupted = std::any_of(m_guards.cbegin(), m_guards.cend(), [guard](const Guard *other) {
+            return other->m_engine == guard->m_engine && other->m_interrupted;
+        });
+        if (!stillInterrupted) {
+            guard->m_engine->setInterrupted(false);
+        }
+    }
+}
+
+void ScriptWatchdog::run()
+{
+    std::unique_lock lock(m_mutex);
+    while (!m_quit) {
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        for (const Guard *guard : m_guards) {
+            if (!guard->m_interrupted) {
+                deadline = std::min(deadline, guard->m_deadline);
+            }
+        }
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            m_changed.wait(lock);
+            continue;
+        }
+        m_changed.wait_until(lock, deadline);
+
+        const auto now = std::chrono::steady_clock::now();
+        for (Guard *guard : m_guards) {
+            if (!guard->m_interrupted && guard->m_deadline <= now) {
+                // QJSEngine::setInterrupted() is safe to call from any thread
+                guard->m_engine->setInterrupted(true);
+                guard->m_interrupted = true;
+            }
+        }
+    }
+}
+
+bool ScriptWatchdog::account(const QString &name, std::chrono::nanoseconds time, bool interrupted, std::chrono::steady_clock::time_point now)
+{
+    Usage &usage = m_usage[name];
+    if (usage.suspended) {
+        return false;
+    }
+    if (interrupted) {
+        suspend(name, i18n("A call did not finish within %1 ms", m_timeout.count()));
+        return true;
+    }
+    if (m_budget <= 0) {
+        return false;
+    }
+
+    if (usage.windowStart == std::chrono::steady_clock::time_point()) {
+        usage.windowStart = now - time;
+    }
+    const std::chrono::nanoseconds window = now - time - usage.windowStart;
+    if (window >= s_window) {
+        const qreal share = qreal(usage.windowTime.count()) / window.count();
+        usage.strikes = share > m_budget ? usage.strikes + 1 : 0;
+        usage.windowStart = now - time;
+        usage.windowTime = std::chrono::nanoseconds::zero();
+        if (usage.strikes >= s_maxStrikes) {
+            suspend(name, i18n("It used %1% of the main thread for %2 seconds", qRound(share * 100), s_maxStrikes));
+            return true;
+        }
+    }
+    usage.windowTime += time;
+    return false;
+}
+
+void ScriptWatchdog::reset(const QString &name)
+{
+    m_usage.remove(name);
+}
+
+void ScriptWatchdog::suspend(const QString &name, const QString &reason)
+{
+    m_usage[name].suspended = true;
+    m_reports.append(Report{name, reason});
+    qCWarning(KWIN_SCRIPTING) << "Suspending" << name << "because it slows down the desktop:" << reason;
+#if KWIN_BUILD_NOTIFICATIONS
+    KNotification::event(QStringLiteral("scriptsuspended"),
+                         i18n("The script %1 has been suspended because it slowed down the desktop.<br/>%2", name, reason));
+#endif
+}
+
+QVector<ScriptWatchdog::Report> ScriptWatchdog::reports() const
+{
+    return m_reports;
+}
+
+} // namespace KWin
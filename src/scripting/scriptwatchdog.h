@@ -0,0 +1,126 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QJSEngine;
+
+namespace KWin
+{
+
+/**
+ * The ScriptWatchdog keeps scripts and scripted effects from making the whole desktop
+ * sluggish, they run their JavaScript on the main thread.
+ *
+ * A call into a script that doesn't return within the timeout is interrupted from a separate
+ * thread. A script that keeps using more than its budget of the main thread, measured over
+ * one second windows, is reported as well. Either way the owner is told to suspend the script,
+ * which gets logged, shown in a notification and listed over D-Bus by Scripting.
+ *
+ * The timeout and the budget can be changed with the KWIN_SCRIPT_WATCHDOG_TIMEOUT (in
+ * milliseconds) and KWIN_SCRIPT_WATCHDOG_BUDGET (in percent) environment variables, 0
+ * disables the respective check.
+ */
+class KWIN_EXPORT ScriptWatchdog
+{
+public:
+    struct Report
+    {
+        QString name;
+        QString reason;
+    };
+
+    /**
+     * Watches a call into @a engine for as long as it's alive.
+     */
+    class KWIN_EXPORT Guard
+    {
+    public:
+        explicit Guard(QJSEngine *engine, ScriptWatchdog *watchdog = ScriptWatchdog::self());
+        ~Guard();
+
+        /**
+         * Stops watching the call and returns how long it took.
+         */
+        std::chrono::nanoseconds finish();
+        /**
+         * Returns @c true if the call has been interrupted for taking too long.
+         */
+        bool wasInterrupted() const;
+
+    private:
+        friend class ScriptWatchdog;
+        ScriptWatchdog *m_watchdog;
+        QJSEngine *m_engine;
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::steady_clock::time_point m_deadline;
+        bool m_finished = false;
+        bool m_interrupted = false;
+    };
+
+    ScriptWatchdog(std::chrono::milliseconds timeout, qreal budget);
+    ~ScriptWatchdog();
+
+    static ScriptWatchdog *self();
+
+    /**
+     * Adds @a time spent in a call of the script called @a name, which happened @a now.
+     * Returns @c true if the script should be suspended, which is the case once it has been
+     * interrupted or used more than the budget for three windows in a row.
+     */
+    bool account(const QString &name, std::chrono::nanoseconds time, bool interrupted,
+                 std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    /**
+     * Forgets the accounting of the script called @a name, e.g. because it has been reloaded.
+     */
+    void reset(const QString &name);
+
+    /**
+     * Returns the scripts that have been suspended so far and why.
+     */
+    QVector<Report> reports() const;
+
+private:
+    struct Usage
+    {
+        std::chrono::steady_clock::time_point windowStart;
+        std::chrono::nanoseconds windowTime = std::chrono::nanoseconds::zero();
+        int strikes = 0;
+        bool suspended = false;
+    };
+
+    void watch(Guard *guard);
+    void unwatch(Guard *guard);
+    void run();
+    void suspend(const QString &name, const QString &reason);
+
+    const std::chrono::milliseconds m_timeout;
+    const qreal m_budget;
+    QHash<QString, Usage> m_usage;
+    QVector<Report> m_reports;
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    // the calls that are being watched, nested calls are appended
+    std::vector<Guard *> m_guards;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+} // namespace KWin
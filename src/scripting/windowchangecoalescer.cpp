@@ -0,0 +1,91 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "windowchangecoalescer.h"
+#include "core/output.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace KWin
+{
+
+WindowChangeCoalescer::WindowChangeCoalescer(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &WindowChangeCoalescer::flush);
+
+    connect(workspace(), &Workspace::windowAdded, this, [this](Window *window) {
+        setupConnections(window);
+        markChanged(window);
+    });
+    connect(workspace(), &Workspace::windowRemoved, this, &WindowChangeCoalescer::markRemoved);
+
+    const QList<Window *> windows = workspace()->allClientList();
+    for (Window *window : windows) {
+        setupConnections(window);
+    }
+}
+
+void WindowChangeCoalescer::setupConnections(Window *window)
+{
+    auto changed = [this, window]() {
+        markChanged(window);
+    };
+    connect(window, &Window::frameGeometryChanged, this, changed);
+    connect(window, &Window::desktopChanged, this, changed);
+    connect(window, &Window::activitiesChanged, this, changed);
+    connect(window, &Window::minimizedChanged, this, changed);
+    connect(window, &Window::fullScreenChanged, this, changed);
+    connect(window, qOverload<Window *, MaximizeMode>(&Window::clientMaximizedStateChanged), this, changed);
+}
+
+void WindowChangeCoalescer::markChanged(Window *window)
+{
+    if (m_changedSet.contains(window)) {
+        return;
+    }
+    m_changedSet.insert(window);
+    m_changed.append(window);
+    if (!m_timer.isActive()) {
+        // deliver with the next frame of the fastest output
+        int refreshRate = 0;
+        const QList<Output *> outputs = workspace()->outputs();
+        for (const Output *output : outputs) {
+            refreshRate = std::max(refreshRate, output->refreshRate());
+        }
+        if (refreshRate <= 0) {
+            refreshRate = 60000;
+        }
+        m_timer.start(std::max(1, 1000000 / refreshRate));
+    }
+}
+
+void WindowChangeCoalescer::markRemoved(Window *window)
+{
+    disconnect(window, nullptr, this, nullptr);
+    if (m_changedSet.remove(window)) {
+        m_changed.removeOne(window);
+    }
+    m_removed.append(window->internalId().toString());
+    if (!m_timer.isActive()) {
+        m_timer.start(0);
+    }
+}
+
+void WindowChangeCoalescer::flush()
+{
+    const QList<Window *> changed = std::exchange(m_changed, {});
+    const QStringList removed = std::exchange(m_removed, {});
+    m_changedSet.clear();
+    Q_EMIT windowsChanged(changed, removed);
+}
+
+} // namespace KWin
@@ -0,0 +1,52 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+namespace KWin
+{
+class Window;
+
+/**
+ * The WindowChangeCoalescer collects the windows that got added, moved, resized, minimized,
+ * sent to another desktop or activity and so on, and reports them at most once per frame.
+ *
+ * An interactive resize changes the geometry of a window with every pointer motion, scripts
+ * that lay out windows in response only need to do that once for every frame that is shown.
+ */
+class WindowChangeCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WindowChangeCoalescer(QObject *parent = nullptr);
+
+Q_SIGNALS:
+    /**
+     * Emitted with the @p windows that changed since the last time, and the internal ids of
+     * the windows that have been removed in the meantime.
+     */
+    void windowsChanged(const QList<KWin::Window *> &windows, const QStringList &removedIds);
+
+private:
+    void setupConnections(Window *window);
+    void markChanged(Window *window);
+    void markRemoved(Window *window);
+    void flush();
+
+    QList<Window *> m_changed;
+    QSet<Window *> m_changedSet;
+    QStringList m_removed;
+    QTimer m_timer;
+};
+
+} // namespace KWin
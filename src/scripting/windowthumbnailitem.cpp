@@ -20,10 +20,14 @@
 #include <kwingltexture.h>
 #include <kwinglutils.h>
 
+#include <QElapsedTimer>
 #include <QQuickWindow>
 #include <QRunnable>
 #include <QSGImageNode>
 #include <QSGTextureProvider>
+#include <QTimer>
+
+#include <cmath>
 
 namespace KWin
 {
@@ -61,13 +65,14 @@ void ThumbnailTextureProvider::setTexture(const std::shared_ptr<GLTexture> &nati
         m_texture.reset(m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture,
                                                                 &textureId, 0,
                                                                 nativeTexture->size(),
-                                                                QQuickWindow::TextureHasAlphaChannel));
+                                                                QQuickWindow::TextureHasAlphaChannel | QQuickWindow::TextureHasMipmaps));
 #else
         m_texture.reset(QNativeInterface::QSGOpenGLTexture::fromNative(textureId, m_window,
                                                                        nativeTexture->size(),
-                                                                       QQuickWindow::TextureHasAlphaChannel));
+                                                                       QQuickWindow::TextureHasAlphaChannel | QQuickWindow::TextureHasMipmaps));
 #endif
         m_texture->setFiltering(QSGTexture::Linear);
+        m_texture->setMipmapFiltering(QSGTexture::Linear);
         m_texture->setHorizontalWrapMode(QSGTexture::ClampToEdge);
         m_texture->setVerticalWrapMode(QSGTexture::ClampToEdge);
     }
@@ -100,23 +105,301 @@ private:
     std::unique_ptr<ThumbnailTextureProvider> m_provider;
 };
 
-WindowThumbnailItem::WindowThumbnailItem(QQuickItem *parent)
-    : QQuickItem(parent)
+/**
+ * The WindowThumbnailSource keeps a downscaled copy of a window for all thumbnails that show
+ * it, e.g. the tabbox, the task manager tooltips and the overview. The copy is as large as
+ * the largest thumbnail needs, rounded up to an eighth of the window size so it's not
+ * reallocated on every frame of a resize animation, and mipmapped so smaller thumbnails are
+ * sampled without aliasing. It's updated only when the window is damaged, at most once per
+ * update interval.
+ */
+class WindowThumbnailSource : public QObject
 {
-    setFlag(ItemHasContents);
-    updateFrameRenderingConnection();
+    Q_OBJECT
+
+public:
+    WindowThumbnailSource(Window *window, const QSize &sourceSize);
+    ~WindowThumbnailSource() override;
+
+    static std::shared_ptr<WindowThumbnailSource> get(Window *window, const QSize &sourceSize);
+
+    std::shared_ptr<GLTexture> texture() const;
+
+    /**
+     * Waits until the rendering commands to the texture complete.
+     */
+    void acquire();
+
+    void addConsumer(QQuickItem *item);
+    void removeConsumer(QQuickItem *item);
+
+Q_SIGNALS:
+    /**
+     * Emitted when the consumers need to be repainted, either because the texture has
+     * changed or to get a frame in which the texture can be updated.
+     */
+    void changed();
+
+private:
+    qreal textureScale() const;
+    void invalidate();
+    void scheduleUpdate();
+    void updateTexture();
+    void destroyTexture();
+    void updateFrameRenderingConnection();
+
+    QPointer<Window> m_window;
+    const QSize m_sourceSize;
+    QVector<QQuickItem *> m_consumers;
+
+    std::shared_ptr<GLTexture> m_texture;
+    std::unique_ptr<GLFramebuffer> m_target;
+    GLsync m_acquireFence = 0;
+    bool m_dirty = true;
+
+    QElapsedTimer m_lastUpdate;
+    QTimer m_updateTimer;
+    QMetaObject::Connection m_frameRenderingConnection;
+};
+
+static int thumbnailUpdateInterval()
+{
+    // Live thumbnails don't need to be updated at the refresh rate, repainting many of
+    // them at full rate is too much for older hardware.
+    static const int interval = qEnvironmentVariableIsSet("KWIN_THUMBNAIL_UPDATE_INTERVAL")
+        ? qEnvironmentVariableIntValue("KWIN_THUMBNAIL_UPDATE_INTERVAL")
+        : 33;
+    return interval;
+}
+
+static std::vector<std::weak_ptr<WindowThumbnailSource>> s_thumbnailSources;
+
+WindowThumbnailSource::WindowThumbnailSource(Window *window, const QSize &sourceSize)
+    : m_window(window)
+    , m_sourceSize(sourceSize)
+{
+    m_updateTimer.setSingleShot(true);
+    connect(&m_updateTimer, &QTimer::timeout, this, &WindowThumbnailSource::changed);
+
+    connect(window, &Window::frameGeometryChanged, this, &WindowThumbnailSource::invalidate);
+    connect(window, &Window::damaged, this, &WindowThumbnailSource::invalidate);
 
     connect(Compositor::self(), &Compositor::aboutToToggleCompositing,
-            this, &WindowThumbnailItem::destroyOffscreenTexture);
+            this, &WindowThumbnailSource::destroyTexture);
     connect(Compositor::self(), &Compositor::compositingToggled,
-            this, &WindowThumbnailItem::updateFrameRenderingConnection);
-    connect(this, &QQuickItem::windowChanged,
-            this, &WindowThumbnailItem::updateFrameRenderingConnection);
+            this, &WindowThumbnailSource::updateFrameRenderingConnection);
+    updateFrameRenderingConnection();
+}
+
+WindowThumbnailSource::~WindowThumbnailSource()
+{
+    destroyTexture();
+}
+
+std::shared_ptr<WindowThumbnailSource> WindowThumbnailSource::get(Window *window, const QSize &sourceSize)
+{
+    s_thumbnailSources.erase(std::remove_if(s_thumbnailSources.begin(), s_thumbnailSources.end(), [](const auto &source) {
+                                 return source.expired();
+                             }),
+                             s_thumbnailSources.end());
+
+    for (const auto &weakSource : s_thumbnailSources) {
+        auto source = weakSource.lock();
+        if (source->m_window == window && source->m_sourceSize == sourceSize) {
+            return source;
+        }
+    }
+
+    auto source = std::make_shared<WindowThumbnailSource>(window, sourceSize);
+    s_thumbnailSources.push_back(source);
+    return source;
+}
+
+std::shared_ptr<GLTexture> WindowThumbnailSource::texture() const
+{
+    return m_texture;
+}
+
+void WindowThumbnailSource::acquire()
+{
+    if (m_acquireFence) {
+        glClientWaitSync(m_acquireFence, GL_SYNC_FLUSH_COMMANDS_BIT, 5000);
+        glDeleteSync(m_acquireFence);
+        m_acquireFence = 0;
+    }
+}
+
+void WindowThumbnailSource::addConsumer(QQuickItem *item)
+{
+    if (!m_consumers.contains(item)) {
+        m_consumers.append(item);
+    }
+}
+
+void WindowThumbnailSource::removeConsumer(QQuickItem *item)
+{
+    m_consumers.removeOne(item);
+}
+
+void WindowThumbnailSource::updateFrameRenderingConnection()
+{
+    disconnect(m_frameRenderingConnection);
+
+    if (!Compositor::compositing()) {
+        return;
+    }
+
+    if (Compositor::self()->backend()->compositingType() == OpenGLCompositing) {
+        m_frameRenderingConnection = connect(Compositor::self()->scene(), &Scene::preFrameRender, this, &WindowThumbnailSource::updateTexture);
+    }
+}
+
+void WindowThumbnailSource::destroyTexture()
+{
+    if (!Compositor::compositing()) {
+        return;
+    }
+    if (Compositor::self()->backend()->compositingType() != OpenGLCompositing) {
+        return;
+    }
+
+    if (m_texture) {
+        Scene *scene = Compositor::self()->scene();
+        scene->makeOpenGLContextCurrent();
+        m_target.reset();
+        m_texture.reset();
+
+        if (m_acquireFence) {
+            glDeleteSync(m_acquireFence);
+            m_acquireFence = 0;
+        }
+        scene->doneOpenGLContextCurrent();
+    }
+    m_dirty = true;
+}
+
+qreal WindowThumbnailSource::textureScale() const
+{
+    qreal scale = 0;
+    for (const QQuickItem *item : m_consumers) {
+        if (!item->window()) {
+            continue;
+        }
+        const qreal devicePixelRatio = item->window()->devicePixelRatio();
+        const QRectF frameGeometry = m_window->frameGeometry();
+        if (m_sourceSize.width() > 0 || m_sourceSize.height() > 0 || frameGeometry.isEmpty()) {
+            scale = std::max(scale, devicePixelRatio);
+        } else {
+            const QSizeF scaled = frameGeometry.size().scaled(item->size(), Qt::KeepAspectRatio);
+            scale = std::max(scale, std::min<qreal>(1, scaled.width() / frameGeometry.width()) * devicePixelRatio);
+        }
+    }
+    if (scale == 0) {
+        return 0;
+    }
+    return std::max(1.0, std::ceil(scale * 8)) / 8;
+}
+
+void WindowThumbnailSource::invalidate()
+{
+    m_dirty = true;
+    scheduleUpdate();
+}
+
+void WindowThumbnailSource::scheduleUpdate()
+{
+    if (m_updateTimer.isActive()) {
+        return;
+    }
+    const qint64 remaining = m_lastUpdate.isValid() ? thumbnailUpdateInterval() - m_lastUpdate.elapsed() : 0;
+    if (remaining > 0) {
+        m_updateTimer.start(remaining);
+    } else {
+        Q_EMIT changed();
+    }
+}
+
+void WindowThumbnailSource::updateTexture()
+{
+    if (m_acquireFence || !m_window) {
+        return;
+    }
+
+    const qreal scale = textureScale();
+    if (scale == 0) {
+        return;
+    }
+
+    const QRectF geometry = m_window->visibleGeometry();
+    QSize size = geometry.toAlignedRect().size();
+    if (m_sourceSize.width() > 0) {
+        size.setWidth(m_sourceSize.width());
+    }
+    if (m_sourceSize.height() > 0) {
+        size.setHeight(m_sourceSize.height());
+    }
+    const QSize textureSize = (QSizeF(size) * scale).toSize().expandedTo(QSize(1, 1));
+
+    if (m_texture && m_texture->size() == textureSize && !m_dirty) {
+        return;
+    }
+    if (m_lastUpdate.isValid() && m_lastUpdate.elapsed() < thumbnailUpdateInterval()) {
+        scheduleUpdate();
+        return;
+    }
+
+    if (!m_texture || m_texture->size() != textureSize) {
+        const int levels = std::log2(std::max(textureSize.width(), textureSize.height())) + 1;
+        m_texture.reset(new GLTexture(GL_RGBA8, textureSize, levels));
+        m_texture->setMemoryCategory(GLTexture::MemoryCategory::Effect);
+        m_texture->setFilter(GL_LINEAR_MIPMAP_LINEAR);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_target.reset(new GLFramebuffer(m_texture.get()));
+    }
+
+    GLFramebuffer::pushFramebuffer(m_target.get());
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
+                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
+
+    WindowPaintData data;
+    data.setProjectionMatrix(projectionMatrix);
+
+    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
+    // shared across contexts. Unfortunately, this also introduces a latency of 1
+    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
+    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
+    Compositor::self()->scene()->render(m_window->windowItem(), mask, infiniteRegion(), data);
+    GLFramebuffer::popFramebuffer();
+
+    m_texture->bind();
+    m_texture->generateMipmaps();
+    m_texture->unbind();
+
+    // The fence is needed to avoid the case where qtquick renderer starts using
+    // the texture while all rendering commands to it haven't completed yet.
+    m_dirty = false;
+    m_lastUpdate.start();
+    m_acquireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // We know that the texture has changed, so schedule an update of the thumbnails.
+    Q_EMIT changed();
+}
+
+WindowThumbnailItem::WindowThumbnailItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents);
 }
 
 WindowThumbnailItem::~WindowThumbnailItem()
 {
-    destroyOffscreenTexture();
+    if (m_source) {
+        m_source->removeConsumer(this);
+    }
 
     if (m_provider) {
         if (window()) {
@@ -153,22 +436,6 @@ QSGTextureProvider *WindowThumbnailItem::textureProvider() const
     return m_provider;
 }
 
-void WindowThumbnailItem::updateFrameRenderingConnection()
-{
-    disconnect(m_frameRenderingConnection);
-
-    if (!Compositor::compositing()) {
-        return;
-    }
-    if (!window()) {
-        return;
-    }
-
-    if (Compositor::self()->backend()->compositingType() == OpenGLCompositing) {
-        m_frameRenderingConnection = connect(Compositor::self()->scene(), &Scene::preFrameRender, this, &WindowThumbnailItem::updateOffscreenTexture);
-    }
-}
-
 QSize WindowThumbnailItem::sourceSize() const
 {
     return m_sourceSize;
@@ -178,53 +445,30 @@ void WindowThumbnailItem::setSourceSize(const QSize &sourceSize)
 {
     if (m_sourceSize != sourceSize) {
         m_sourceSize = sourceSize;
-        invalidateOffscreenTexture();
+        updateSource();
         Q_EMIT sourceSizeChanged();
     }
 }
 
-void WindowThumbnailItem::destroyOffscreenTexture()
-{
-    if (!Compositor::compositing()) {
-        return;
-    }
-    if (Compositor::self()->backend()->compositingType() != OpenGLCompositing) {
-        return;
-    }
-
-    if (m_offscreenTexture) {
-        Scene *scene = Compositor::self()->scene();
-        scene->makeOpenGLContextCurrent();
-        m_offscreenTarget.reset();
-        m_offscreenTexture.reset();
-
-        if (m_acquireFence) {
-            glDeleteSync(m_acquireFence);
-            m_acquireFence = 0;
-        }
-        scene->doneOpenGLContextCurrent();
-    }
-}
-
 QSGNode *WindowThumbnailItem::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaintNodeData *)
 {
-    if (Compositor::compositing() && !m_offscreenTexture) {
+    const std::shared_ptr<GLTexture> texture = m_source ? m_source->texture() : nullptr;
+    if (Compositor::compositing() && !texture) {
         return oldNode;
     }
 
     // Wait for rendering commands to the offscreen texture complete if there are any.
-    if (m_acquireFence) {
-        glClientWaitSync(m_acquireFence, GL_SYNC_FLUSH_COMMANDS_BIT, 5000);
-        glDeleteSync(m_acquireFence);
-        m_acquireFence = 0;
+    if (m_source) {
+        m_source->acquire();
     }
 
     if (!m_provider) {
         m_provider = new ThumbnailTextureProvider(window());
     }
 
-    if (m_offscreenTexture) {
-        m_provider->setTexture(m_offscreenTexture);
+    if (texture) {
+        m_provider->setTexture(texture);
+        m_devicePixelRatio = window()->devicePixelRatio();
     } else {
         const QImage placeholderImage = fallbackImage();
         m_provider->setTexture(window()->createTextureFromImage(placeholderImage));
@@ -237,8 +481,9 @@ QSGNode *WindowThumbnailItem::updatePaintNode(QSGNode *oldNode, QQuickItem::Upda
         node->setFiltering(QSGTexture::Linear);
     }
     node->setTexture(m_provider->texture());
+    node->setMipmapFiltering(texture ? QSGTexture::Linear : QSGTexture::None);
 
-    if (m_offscreenTexture && m_offscreenTexture->isYInverted()) {
+    if (texture && texture->isYInverted()) {
         node->setTextureCoordinatesTransform(QSGImageNode::MirrorVertically);
     } else {
         node->setTextureCoordinatesTransform(QSGImageNode::NoTransform);
@@ -314,26 +559,18 @@ void WindowThumbnailItem::setClient(Window *client)
         return;
     }
     if (m_client) {
-        disconnect(m_client, &Window::frameGeometryChanged,
-                   this, &WindowThumbnailItem::invalidateOffscreenTexture);
-        disconnect(m_client, &Window::damaged,
-                   this, &WindowThumbnailItem::invalidateOffscreenTexture);
         disconnect(m_client, &Window::frameGeometryChanged,
                    this, &WindowThumbnailItem::updateImplicitSize);
     }
     m_client = client;
     if (m_client) {
-        connect(m_client, &Window::frameGeometryChanged,
-                this, &WindowThumbnailItem::invalidateOffscreenTexture);
-        connect(m_client, &Window::damaged,
-                this, &WindowThumbnailItem::invalidateOffscreenTexture);
         connect(m_client, &Window::frameGeometryChanged,
                 this, &WindowThumbnailItem::updateImplicitSize);
         setWId(m_client->internalId());
     } else {
         setWId(QUuid());
     }
-    invalidateOffscreenTexture();
+    updateSource();
     updateImplicitSize();
     Q_EMIT clientChanged();
 }
@@ -368,7 +605,7 @@ QRectF WindowThumbnailItem::paintedRect() const
     if (!m_client) {
         return QRectF();
     }
-    if (!m_offscreenTexture) {
+    if (!m_source || !m_source->texture()) {
         const QSizeF iconSize = m_client->icon().actualSize(window(), boundingRect().size().toSize());
         return centeredSize(boundingRect(), iconSize);
     }
@@ -391,63 +628,21 @@ QRectF WindowThumbnailItem::paintedRect() const
     return paintedRect;
 }
 
-void WindowThumbnailItem::invalidateOffscreenTexture()
-{
-    m_dirty = true;
-    update();
-}
-
-void WindowThumbnailItem::updateOffscreenTexture()
+void WindowThumbnailItem::updateSource()
 {
-    if (m_acquireFence || !m_dirty || !m_client) {
-        return;
-    }
-    Q_ASSERT(window());
-
-    const QRectF geometry = m_client->visibleGeometry();
-    QSize textureSize = geometry.toAlignedRect().size();
-    if (sourceSize().width() > 0) {
-        textureSize.setWidth(sourceSize().width());
+    if (m_source) {
+        disconnect(m_source.get(), &WindowThumbnailSource::changed, this, &WindowThumbnailItem::update);
+        m_source->removeConsumer(this);
+        m_source.reset();
     }
-    if (sourceSize().height() > 0) {
-        textureSize.setHeight(sourceSize().height());
-    }
-
-    m_devicePixelRatio = window()->devicePixelRatio();
-    textureSize *= m_devicePixelRatio;
-
-    if (!m_offscreenTexture || m_offscreenTexture->size() != textureSize) {
-        m_offscreenTexture.reset(new GLTexture(GL_RGBA8, textureSize));
-        m_offscreenTexture->setFilter(GL_LINEAR);
-        m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_offscreenTarget.reset(new GLFramebuffer(m_offscreenTexture.get()));
+    if (m_client) {
+        m_source = WindowThumbnailSource::get(m_client, m_sourceSize);
+        m_source->addConsumer(this);
+        connect(m_source.get(), &WindowThumbnailSource::changed, this, &WindowThumbnailItem::update);
     }
-
-    GLFramebuffer::pushFramebuffer(m_offscreenTarget.get());
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    QMatrix4x4 projectionMatrix;
-    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
-                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
-
-    WindowPaintData data;
-    data.setProjectionMatrix(projectionMatrix);
-
-    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
-    // shared across contexts. Unfortunately, this also introduces a latency of 1
-    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
-    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
-    Compositor::self()->scene()->render(m_client->windowItem(), mask, infiniteRegion(), data);
-    GLFramebuffer::popFramebuffer();
-
-    // The fence is needed to avoid the case where qtquick renderer starts using
-    // the texture while all rendering commands to it haven't completed yet.
-    m_dirty = false;
-    m_acquireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-
-    // We know that the texture has changed, so schedule an item update.
     update();
 }
 
 } // namespace KWin
+
+#include "windowthumbnailitem.moc"
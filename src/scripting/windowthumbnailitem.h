@@ -10,14 +10,11 @@
 #include <QQuickItem>
 #include <QUuid>
 
-#include <epoxy/gl.h>
-
 namespace KWin
 {
 class Window;
-class GLFramebuffer;
-class GLTexture;
 class ThumbnailTextureProvider;
+class WindowThumbnailSource;
 
 class WindowThumbnailItem : public QQuickItem
 {
@@ -82,24 +79,16 @@ Q_SIGNALS:
 private:
     QImage fallbackImage() const;
     QRectF paintedRect() const;
-    void invalidateOffscreenTexture();
-    void updateOffscreenTexture();
-    void destroyOffscreenTexture();
+    void updateSource();
     void updateImplicitSize();
-    void updateFrameRenderingConnection();
 
     QSize m_sourceSize;
     QUuid m_wId;
     QPointer<Window> m_client;
-    bool m_dirty = false;
 
     mutable ThumbnailTextureProvider *m_provider = nullptr;
-    std::shared_ptr<GLTexture> m_offscreenTexture;
-    std::unique_ptr<GLFramebuffer> m_offscreenTarget;
-    GLsync m_acquireFence = 0;
+    std::shared_ptr<WindowThumbnailSource> m_source;
     qreal m_devicePixelRatio = 1;
-
-    QMetaObject::Connection m_frameRenderingConnection;
 };
 
 } // namespace KWin
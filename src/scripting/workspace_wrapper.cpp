@@ -11,6 +11,7 @@
 #include "workspace_wrapper.h"
 #include "core/output.h"
 #include "outline.h"
+#include "scripting_logging.h"
 #include "virtualdesktops.h"
 #include "workspace.h"
 #include "x11window.h"
@@ -23,6 +24,8 @@
 #include <QDesktopWidget>
 #endif
 
+#include <optional>
+
 namespace KWin
 {
 
@@ -452,6 +455,70 @@ void WorkspaceWrapper::sendClientToScreen(Window *client, int screen)
     }
 }
 
+QVariantList WorkspaceWrapper::windowSnapshot() const
+{
+    QVariantList snapshot;
+    const QList<Window *> windows = workspace()->allClientList();
+    snapshot.reserve(windows.count());
+    for (const Window *window : windows) {
+        snapshot.append(QVariantMap{
+            {QStringLiteral("internalId"), window->internalId().toString()},
+            {QStringLiteral("caption"), window->caption()},
+            {QStringLiteral("resourceClass"), QString::fromUtf8(window->resourceClass())},
+            {QStringLiteral("frameGeometry"), window->frameGeometry()},
+            {QStringLiteral("desktops"), window->desktopIds()},
+            {QStringLiteral("onAllDesktops"), window->isOnAllDesktops()},
+            {QStringLiteral("activities"), window->activities()},
+            {QStringLiteral("output"), window->output() ? window->output()->name() : QString()},
+            {QStringLiteral("minimized"), window->isMinimized()},
+            {QStringLiteral("fullScreen"), window->isFullScreen()},
+            {QStringLiteral("maximizeMode"), int(window->maximizeMode())},
+            {QStringLiteral("active"), window->isActive()},
+            {QStringLiteral("normalWindow"), window->isNormalWindow()},
+            {QStringLiteral("transient"), window->isTransient()},
+        });
+    }
+    return snapshot;
+}
+
+static std::optional<QRectF> geometryFromScript(const QVariant &value)
+{
+    if (value.userType() == QMetaType::QRectF || value.userType() == QMetaType::QRect) {
+        return value.toRectF();
+    }
+    const QVariantMap map = value.toMap();
+    if (!map.contains(QStringLiteral("x")) || !map.contains(QStringLiteral("y"))
+        || !map.contains(QStringLiteral("width")) || !map.contains(QStringLiteral("height"))) {
+        return std::nullopt;
+    }
+    return QRectF(map.value(QStringLiteral("x")).toReal(), map.value(QStringLiteral("y")).toReal(),
+                  map.value(QStringLiteral("width")).toReal(), map.value(QStringLiteral("height")).toReal());
+}
+
+void WorkspaceWrapper::setFrameGeometries(const QVariantMap &geometries)
+{
+    QHash<QUuid, Window *> windows;
+    const QList<Window *> allWindows = workspace()->allClientList();
+    for (Window *window : allWindows) {
+        windows.insert(window->internalId(), window);
+    }
+
+    GeometryTransaction transaction(workspace());
+    for (auto it = geometries.constBegin(); it != geometries.constEnd(); ++it) {
+        Window *window = windows.value(QUuid::fromString(it.key()));
+        if (!window) {
+            qCWarning(KWIN_SCRIPTING) << "setFrameGeometries: no window with the id" << it.key();
+            continue;
+        }
+        const std::optional<QRectF> geometry = geometryFromScript(it.value());
+        if (!geometry) {
+            qCWarning(KWIN_SCRIPTING) << "setFrameGeometries: invalid geometry for" << it.key();
+            continue;
+        }
+        window->moveResize(*geometry);
+    }
+}
+
 QtScriptWorkspaceWrapper::QtScriptWorkspaceWrapper(QObject *parent)
     : WorkspaceWrapper(parent)
 {
@@ -292,6 +292,20 @@ public:
      * @return The found Client or @c null
      */
     Q_SCRIPTABLE KWin::X11Window *getClient(qulonglong windowId);
+    /**
+     * Returns a snapshot of the state of all managed windows, in stacking order. Each entry is a
+     * plain object with the properties internalId, caption, resourceClass, frameGeometry,
+     * desktops, onAllDesktops, activities, output, minimized, fullScreen, maximizeMode, active,
+     * normalWindow and transient. Reading it is a lot cheaper than reading the properties of
+     * every window one by one.
+     */
+    Q_SCRIPTABLE QVariantList windowSnapshot() const;
+    /**
+     * Moves and resizes many windows at once. @p geometries maps the internalId of a window to
+     * its new frame geometry. The clients only get told about their new geometries once all
+     * windows have been moved.
+     */
+    Q_SCRIPTABLE void setFrameGeometries(const QVariantMap &geometries);
 
 public Q_SLOTS:
     // all the available key bindings
@@ -40,8 +40,11 @@ void ShadowItem::updateGeometry()
     const QRectF rect = m_shadow->rect() + m_shadow->offset();
 
     setPosition(rect.topLeft());
-    setSize(rect.size());
-    discardQuads();
+    // the quads are in item coordinates, so only a new size needs new ones
+    if (size() != rect.size()) {
+        setSize(rect.size());
+        discardQuads();
+    }
 }
 
 void ShadowItem::handleTextureChanged()
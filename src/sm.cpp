@@ -20,6 +20,7 @@
 #include "x11window.h"
 #include <QDebug>
 #include <QSessionManager>
+#include <QtConcurrentRun>
 
 #include "sessionadaptor.h"
 #include <QDBusConnection>
@@ -27,22 +28,10 @@
 namespace KWin
 {
 
-static KConfig *sessionConfig(QString id, QString key)
+static QString sessionConfigName(const QString &id, const QString &key)
 {
-    static KConfig *config = nullptr;
-    static QString lastId;
-    static QString lastKey;
-    static QString pattern = QString(QLatin1String("session/%1_%2_%3")).arg(qApp->applicationName());
-    if (id != lastId || key != lastKey) {
-        delete config;
-        config = nullptr;
-    }
-    lastId = id;
-    lastKey = key;
-    if (!config) {
-        config = new KConfig(pattern.arg(id, key), KConfig::SimpleConfig);
-    }
-    return config;
+    static const QString pattern = QString(QLatin1String("session/%1_%2_%3")).arg(qApp->applicationName());
+    return pattern.arg(id, key);
 }
 
 static const char *const window_type_names[] = {
@@ -74,17 +63,140 @@ static NET::WindowType txtToWindowType(const char *txt)
     return static_cast<NET::WindowType>(-2); // undefined
 }
 
+/**
+ * Takes a snapshot of the state of client \a c that is stored in the session.
+ */
+static SessionInfo sessionInfoForWindow(X11Window *c)
+{
+    c->setSessionActivityOverride(false); // make sure we get the real values
+    SessionInfo info;
+    info.sessionId = c->sessionId();
+    info.windowRole = c->windowRole();
+    info.wmCommand = c->wmCommand();
+    info.resourceName = c->resourceName();
+    info.resourceClass = c->resourceClass();
+    info.geometry = QRectF(c->calculateGravitation(true), c->clientSize()).toRect(); // FRAME
+    info.restore = c->geometryRestore().toRect();
+    info.fsrestore = c->fullscreenGeometryRestore().toRect();
+    info.maximized = (int)c->maximizeMode();
+    info.fullscreen = (int)c->fullScreenMode();
+    info.desktop = c->desktop();
+    info.minimized = c->isMinimized();
+    info.opacity = c->opacity();
+    info.onAllDesktops = c->isOnAllDesktops();
+    info.shaded = c->isShade();
+    info.keepAbove = c->keepAbove();
+    info.keepBelow = c->keepBelow();
+    info.skipTaskbar = c->originalSkipTaskbar();
+    info.skipPager = c->skipPager();
+    info.skipSwitcher = c->skipSwitcher();
+    info.noBorder = c->userNoBorder();
+    info.windowType = c->windowType();
+    info.shortcut = c->shortcut().toString();
+    info.active = c->isActive();
+    info.stackingOrder = workspace()->unconstrainedStackingOrder().indexOf(c);
+    info.activities = c->activities();
+    return info;
+}
+
+static void writeSessionInfo(KConfigGroup &cg, int num, const SessionInfo &info)
+{
+    QString n = QString::number(num);
+    cg.writeEntry(QLatin1String("sessionId") + n, info.sessionId.constData());
+    cg.writeEntry(QLatin1String("windowRole") + n, info.windowRole.constData());
+    cg.writeEntry(QLatin1String("wmCommand") + n, info.wmCommand.constData());
+    cg.writeEntry(QLatin1String("resourceName") + n, info.resourceName.constData());
+    cg.writeEntry(QLatin1String("resourceClass") + n, info.resourceClass.constData());
+    cg.writeEntry(QLatin1String("geometry") + n, info.geometry);
+    cg.writeEntry(QLatin1String("restore") + n, info.restore);
+    cg.writeEntry(QLatin1String("fsrestore") + n, info.fsrestore);
+    cg.writeEntry(QLatin1String("maximize") + n, info.maximized);
+    cg.writeEntry(QLatin1String("fullscreen") + n, info.fullscreen);
+    cg.writeEntry(QLatin1String("desktop") + n, info.desktop);
+    // the config entry is called "iconified" for back. comp. reasons
+    // (kconf_update script for updating session files would be too complicated)
+    cg.writeEntry(QLatin1String("iconified") + n, info.minimized);
+    cg.writeEntry(QLatin1String("opacity") + n, info.opacity);
+    // the config entry is called "sticky" for back. comp. reasons
+    cg.writeEntry(QLatin1String("sticky") + n, info.onAllDesktops);
+    cg.writeEntry(QLatin1String("shaded") + n, info.shaded);
+    // the config entry is called "staysOnTop" for back. comp. reasons
+    cg.writeEntry(QLatin1String("staysOnTop") + n, info.keepAbove);
+    cg.writeEntry(QLatin1String("keepBelow") + n, info.keepBelow);
+    cg.writeEntry(QLatin1String("skipTaskbar") + n, info.skipTaskbar);
+    cg.writeEntry(QLatin1String("skipPager") + n, info.skipPager);
+    cg.writeEntry(QLatin1String("skipSwitcher") + n, info.skipSwitcher);
+    // not really just set by user, but name kept for back. comp. reasons
+    cg.writeEntry(QLatin1String("userNoBorder") + n, info.noBorder);
+    cg.writeEntry(QLatin1String("windowType") + n, windowTypeToTxt(info.windowType));
+    cg.writeEntry(QLatin1String("shortcut") + n, info.shortcut);
+    cg.writeEntry(QLatin1String("stackingOrder") + n, info.stackingOrder);
+    cg.writeEntry(QLatin1String("activities") + n, info.activities);
+}
+
+static void writeSessionData(KConfigGroup &cg, const SessionData &data)
+{
+    for (int i = 0; i < data.windows.count(); ++i) {
+        writeSessionInfo(cg, i + 1, data.windows[i]);
+    }
+    cg.writeEntry("count", data.windows.count());
+    cg.writeEntry("active", data.active);
+}
+
+static SessionData readSessionData(const KConfigGroup &cg)
+{
+    SessionData data;
+    data.desktop = cg.readEntry("desktop", 1);
+    data.active = cg.readEntry("active", 0);
+    const int count = cg.readEntry("count", 0);
+    data.windows.reserve(count);
+    for (int i = 1; i <= count; i++) {
+        QString n = QString::number(i);
+        SessionInfo info;
+        info.sessionId = cg.readEntry(QLatin1String("sessionId") + n, QString()).toLatin1();
+        info.windowRole = cg.readEntry(QLatin1String("windowRole") + n, QString()).toLatin1();
+        info.wmCommand = cg.readEntry(QLatin1String("wmCommand") + n, QString()).toLatin1();
+        info.resourceName = cg.readEntry(QLatin1String("resourceName") + n, QString()).toLatin1();
+        info.resourceClass = cg.readEntry(QLatin1String("resourceClass") + n, QString()).toLower().toLatin1();
+        info.geometry = cg.readEntry(QLatin1String("geometry") + n, QRect());
+        info.restore = cg.readEntry(QLatin1String("restore") + n, QRect());
+        info.fsrestore = cg.readEntry(QLatin1String("fsrestore") + n, QRect());
+        info.maximized = cg.readEntry(QLatin1String("maximize") + n, 0);
+        info.fullscreen = cg.readEntry(QLatin1String("fullscreen") + n, 0);
+        info.desktop = cg.readEntry(QLatin1String("desktop") + n, 0);
+        info.minimized = cg.readEntry(QLatin1String("iconified") + n, false);
+        info.opacity = cg.readEntry(QLatin1String("opacity") + n, 1.0);
+        info.onAllDesktops = cg.readEntry(QLatin1String("sticky") + n, false);
+        info.shaded = cg.readEntry(QLatin1String("shaded") + n, false);
+        info.keepAbove = cg.readEntry(QLatin1String("staysOnTop") + n, false);
+        info.keepBelow = cg.readEntry(QLatin1String("keepBelow") + n, false);
+        info.skipTaskbar = cg.readEntry(QLatin1String("skipTaskbar") + n, false);
+        info.skipPager = cg.readEntry(QLatin1String("skipPager") + n, false);
+        info.skipSwitcher = cg.readEntry(QLatin1String("skipSwitcher") + n, false);
+        info.noBorder = cg.readEntry(QLatin1String("userNoBorder") + n, false);
+        info.windowType = txtToWindowType(cg.readEntry(QLatin1String("windowType") + n, QString()).toLatin1().constData());
+        info.shortcut = cg.readEntry(QLatin1String("shortcut") + n, QString());
+        info.active = (data.active == i);
+        info.stackingOrder = cg.readEntry(QLatin1String("stackingOrder") + n, -1);
+        info.activities = cg.readEntry(QLatin1String("activities") + n, QStringList());
+        data.windows.append(info);
+    }
+    return data;
+}
+
 /**
  * Stores the current session in the config file
  *
- * @see loadSessionInfo
+ * The state of the windows is collected right away, but the config file is written in a
+ * worker thread so that the compositor doesn't freeze during the logout.
+ *
+ * @see loadSession
  */
 void SessionManager::storeSession(const QString &sessionName, SMSavePhase phase)
 {
     qCDebug(KWIN_CORE) << "storing session" << sessionName << "in phase" << phase;
-    KConfig *config = sessionConfig(sessionName, QString());
 
-    KConfigGroup cg(config, "Session");
+    SessionData data;
     int count = 0;
     int active_client = -1;
 
@@ -110,7 +222,7 @@ void SessionManager::storeSession(const QString &sessionName, SMSavePhase phase)
             active_client = count;
         }
         if (phase == SMSavePhase2 || phase == SMSavePhase2Full) {
-            storeClient(cg, count, c);
+            data.windows.append(sessionInfoForWindow(c));
         }
     }
     if (phase == SMSavePhase0) {
@@ -119,60 +231,32 @@ void SessionManager::storeSession(const QString &sessionName, SMSavePhase phase)
         // which results in different sessionkey and different config file :(
         m_sessionActiveClient = active_client;
         m_sessionDesktop = VirtualDesktopManager::self()->current();
+        return;
     } else if (phase == SMSavePhase2) {
-        cg.writeEntry("count", count);
-        cg.writeEntry("active", m_sessionActiveClient);
-        cg.writeEntry("desktop", m_sessionDesktop);
+        data.active = m_sessionActiveClient;
+        data.desktop = m_sessionDesktop;
     } else { // SMSavePhase2Full
-        cg.writeEntry("count", count);
-        cg.writeEntry("active", m_sessionActiveClient);
-        cg.writeEntry("desktop", VirtualDesktopManager::self()->current());
+        data.active = m_sessionActiveClient;
+        data.desktop = VirtualDesktopManager::self()->current();
     }
-    config->sync(); // it previously did some "revert to defaults" stuff for phase1 I think
-}
 
-void SessionManager::storeClient(KConfigGroup &cg, int num, X11Window *c)
-{
-    c->setSessionActivityOverride(false); // make sure we get the real values
-    QString n = QString::number(num);
-    cg.writeEntry(QLatin1String("sessionId") + n, c->sessionId().constData());
-    cg.writeEntry(QLatin1String("windowRole") + n, c->windowRole().constData());
-    cg.writeEntry(QLatin1String("wmCommand") + n, c->wmCommand().constData());
-    cg.writeEntry(QLatin1String("resourceName") + n, c->resourceName().constData());
-    cg.writeEntry(QLatin1String("resourceClass") + n, c->resourceClass().constData());
-    cg.writeEntry(QLatin1String("geometry") + n, QRectF(c->calculateGravitation(true), c->clientSize()).toRect()); // FRAME
-    cg.writeEntry(QLatin1String("restore") + n, c->geometryRestore());
-    cg.writeEntry(QLatin1String("fsrestore") + n, c->fullscreenGeometryRestore());
-    cg.writeEntry(QLatin1String("maximize") + n, (int)c->maximizeMode());
-    cg.writeEntry(QLatin1String("fullscreen") + n, (int)c->fullScreenMode());
-    cg.writeEntry(QLatin1String("desktop") + n, c->desktop());
-    // the config entry is called "iconified" for back. comp. reasons
-    // (kconf_update script for updating session files would be too complicated)
-    cg.writeEntry(QLatin1String("iconified") + n, c->isMinimized());
-    cg.writeEntry(QLatin1String("opacity") + n, c->opacity());
-    // the config entry is called "sticky" for back. comp. reasons
-    cg.writeEntry(QLatin1String("sticky") + n, c->isOnAllDesktops());
-    cg.writeEntry(QLatin1String("shaded") + n, c->isShade());
-    // the config entry is called "staysOnTop" for back. comp. reasons
-    cg.writeEntry(QLatin1String("staysOnTop") + n, c->keepAbove());
-    cg.writeEntry(QLatin1String("keepBelow") + n, c->keepBelow());
-    cg.writeEntry(QLatin1String("skipTaskbar") + n, c->originalSkipTaskbar());
-    cg.writeEntry(QLatin1String("skipPager") + n, c->skipPager());
-    cg.writeEntry(QLatin1String("skipSwitcher") + n, c->skipSwitcher());
-    // not really just set by user, but name kept for back. comp. reasons
-    cg.writeEntry(QLatin1String("userNoBorder") + n, c->userNoBorder());
-    cg.writeEntry(QLatin1String("windowType") + n, windowTypeToTxt(c->windowType()));
-    cg.writeEntry(QLatin1String("shortcut") + n, c->shortcut().toString());
-    cg.writeEntry(QLatin1String("stackingOrder") + n, workspace()->unconstrainedStackingOrder().indexOf(c));
-    cg.writeEntry(QLatin1String("activities") + n, c->activities());
+    // don't let two saves of the same session race each other
+    m_pendingSave.waitForFinished();
+    const QString fileName = sessionConfigName(sessionName, QString());
+    m_pendingSave = QtConcurrent::run([fileName, data]() {
+        KConfig config(fileName, KConfig::SimpleConfig);
+        KConfigGroup cg(&config, "Session");
+        writeSessionData(cg, data);
+        cg.writeEntry("desktop", data.desktop);
+        config.sync();
+    });
 }
 
 void SessionManager::storeSubSession(const QString &name, QSet<QByteArray> sessionIds)
 {
     // TODO clear it first
     KConfigGroup cg(KSharedConfig::openConfig(), QLatin1String("SubSession: ") + name);
-    int count = 0;
-    int active_client = -1;
+    SessionData data;
     const QList<X11Window *> x11Clients = workspace()->clientList();
 
     for (auto it = x11Clients.begin(); it != x11Clients.end(); ++it) {
@@ -194,72 +278,65 @@ void SessionManager::storeSubSession(const QString &name, QSet<QByteArray> sessi
         }
 
         qCDebug(KWIN_CORE) << "storing" << sessionId;
-        count++;
+        data.windows.append(sessionInfoForWindow(c));
         if (c->isActive()) {
-            active_client = count;
+            data.active = data.windows.count();
         }
-        storeClient(cg, count, c);
     }
-    cg.writeEntry("count", count);
-    cg.writeEntry("active", active_client);
+    writeSessionData(cg, data);
     // cg.writeEntry( "desktop", currentDesktop());
 }
 
 /**
  * Loads the session information from the config file.
  *
+ * The file is parsed in a worker thread, the windows that get managed in the meantime
+ * wait for it in takeSessionInfo().
+ *
  * @see storeSession
  */
 void SessionManager::loadSession(const QString &sessionName)
 {
+    qDeleteAll(session);
     session.clear();
-    KConfigGroup cg(sessionConfig(sessionName, QString()), "Session");
+    m_pendingSave.waitForFinished();
+    if (m_pendingLoad) {
+        m_pendingLoad->waitForFinished();
+    }
     Q_EMIT loadSessionRequested(sessionName);
-    addSessionInfo(cg);
+
+    const QString fileName = sessionConfigName(sessionName, QString());
+    m_pendingLoad = std::make_unique<QFutureWatcher<SessionData>>();
+    connect(m_pendingLoad.get(), &QFutureWatcher<SessionData>::finished, this, &SessionManager::finishLoadSession);
+    m_pendingLoad->setFuture(QtConcurrent::run([fileName]() {
+        const KConfig config(fileName, KConfig::SimpleConfig);
+        return readSessionData(KConfigGroup(&config, "Session"));
+    }));
 }
 
-void SessionManager::addSessionInfo(KConfigGroup &cg)
+void SessionManager::finishLoadSession()
 {
-    workspace()->setInitialDesktop(cg.readEntry("desktop", 1));
-    int count = cg.readEntry("count", 0);
-    int active_client = cg.readEntry("active", 0);
-    for (int i = 1; i <= count; i++) {
-        QString n = QString::number(i);
-        SessionInfo *info = new SessionInfo;
-        session.append(info);
-        info->sessionId = cg.readEntry(QLatin1String("sessionId") + n, QString()).toLatin1();
-        info->windowRole = cg.readEntry(QLatin1String("windowRole") + n, QString()).toLatin1();
-        info->wmCommand = cg.readEntry(QLatin1String("wmCommand") + n, QString()).toLatin1();
-        info->resourceName = cg.readEntry(QLatin1String("resourceName") + n, QString()).toLatin1();
-        info->resourceClass = cg.readEntry(QLatin1String("resourceClass") + n, QString()).toLower().toLatin1();
-        info->geometry = cg.readEntry(QLatin1String("geometry") + n, QRect());
-        info->restore = cg.readEntry(QLatin1String("restore") + n, QRect());
-        info->fsrestore = cg.readEntry(QLatin1String("fsrestore") + n, QRect());
-        info->maximized = cg.readEntry(QLatin1String("maximize") + n, 0);
-        info->fullscreen = cg.readEntry(QLatin1String("fullscreen") + n, 0);
-        info->desktop = cg.readEntry(QLatin1String("desktop") + n, 0);
-        info->minimized = cg.readEntry(QLatin1String("iconified") + n, false);
-        info->opacity = cg.readEntry(QLatin1String("opacity") + n, 1.0);
-        info->onAllDesktops = cg.readEntry(QLatin1String("sticky") + n, false);
-        info->shaded = cg.readEntry(QLatin1String("shaded") + n, false);
-        info->keepAbove = cg.readEntry(QLatin1String("staysOnTop") + n, false);
-        info->keepBelow = cg.readEntry(QLatin1String("keepBelow") + n, false);
-        info->skipTaskbar = cg.readEntry(QLatin1String("skipTaskbar") + n, false);
-        info->skipPager = cg.readEntry(QLatin1String("skipPager") + n, false);
-        info->skipSwitcher = cg.readEntry(QLatin1String("skipSwitcher") + n, false);
-        info->noBorder = cg.readEntry(QLatin1String("userNoBorder") + n, false);
-        info->windowType = txtToWindowType(cg.readEntry(QLatin1String("windowType") + n, QString()).toLatin1().constData());
-        info->shortcut = cg.readEntry(QLatin1String("shortcut") + n, QString());
-        info->active = (active_client == i);
-        info->stackingOrder = cg.readEntry(QLatin1String("stackingOrder") + n, -1);
-        info->activities = cg.readEntry(QLatin1String("activities") + n, QStringList());
+    if (!m_pendingLoad) {
+        return;
+    }
+    m_pendingLoad->waitForFinished();
+    const SessionData data = m_pendingLoad->result();
+    m_pendingLoad.reset();
+    addSessionData(data);
+}
+
+void SessionManager::addSessionData(const SessionData &data)
+{
+    workspace()->setInitialDesktop(data.desktop);
+    for (const SessionInfo &info : data.windows) {
+        session.append(new SessionInfo(info));
     }
 }
 
 void SessionManager::loadSubSessionInfo(const QString &name)
 {
     KConfigGroup cg(KSharedConfig::openConfig(), QLatin1String("SubSession: ") + name);
-    addSessionInfo(cg);
+    addSessionData(readSessionData(cg));
 }
 
 static bool sessionInfoWindowTypeMatch(X11Window *c, SessionInfo *info)
@@ -282,6 +359,8 @@ static bool sessionInfoWindowTypeMatch(X11Window *c, SessionInfo *info)
  */
 SessionInfo *SessionManager::takeSessionInfo(X11Window *c)
 {
+    finishLoadSession();
+
     SessionInfo *realInfo = nullptr;
     QByteArray sessionId = c->sessionId();
     QByteArray windowRole = c->windowRole();
@@ -340,6 +419,10 @@ SessionManager::SessionManager(QObject *parent)
 
 SessionManager::~SessionManager()
 {
+    m_pendingSave.waitForFinished();
+    if (m_pendingLoad) {
+        m_pendingLoad->waitForFinished();
+    }
     qDeleteAll(session);
 }
 
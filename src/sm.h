@@ -12,6 +12,8 @@
 #define KWIN_SM_H
 
 #include <QDataStream>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QRect>
 #include <QStringList>
 
@@ -20,11 +22,14 @@
 #include <kwinglobals.h>
 #include <netwm_def.h>
 
+#include <memory>
+
 namespace KWin
 {
 
 class X11Window;
 struct SessionInfo;
+struct SessionData;
 
 class SessionManager : public QObject
 {
@@ -64,9 +69,8 @@ private:
     void setState(SessionState state);
 
     void storeSession(const QString &sessionName, SMSavePhase phase);
-    void storeClient(KConfigGroup &cg, int num, X11Window *c);
-    void loadSessionInfo(const QString &sessionName);
-    void addSessionInfo(KConfigGroup &cg);
+    void finishLoadSession();
+    void addSessionData(const SessionData &data);
 
     SessionState m_sessionState = SessionState::Normal;
 
@@ -74,6 +78,8 @@ private:
     int m_sessionDesktop;
 
     QList<SessionInfo *> session;
+    QFuture<void> m_pendingSave;
+    std::unique_ptr<QFutureWatcher<SessionData>> m_pendingLoad;
 };
 
 struct SessionInfo
@@ -104,11 +110,22 @@ struct SessionInfo
     QString shortcut;
     bool active; // means 'was active in the saved session'
     int stackingOrder;
-    float opacity;
+    qreal opacity;
 
     QStringList activities;
 };
 
+/**
+ * A snapshot of a session, which can be written to and read from the config file in
+ * a worker thread.
+ */
+struct SessionData
+{
+    int desktop = 1;
+    int active = -1;
+    QVector<SessionInfo> windows;
+};
+
 } // namespace
 
 #endif
@@ -0,0 +1,184 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "startuptracer.h"
+#include "utils/common.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <memory>
+
+namespace KWin
+{
+
+StartupTracer::StartupTracer()
+{
+    m_timer.start();
+}
+
+static std::unique_ptr<StartupTracer> &globalTracer()
+{
+    // only ever used from the main thread
+    static std::unique_ptr<StartupTracer> tracer = qEnvironmentVariableIsSet("KWIN_STARTUP_TRACE") ? std::make_unique<StartupTracer>() : nullptr;
+    return tracer;
+}
+
+StartupTracer *StartupTracer::self()
+{
+    return globalTracer().get();
+}
+
+void StartupTracer::beginPhase(const QByteArray &name, const QByteArrayList &dependencies)
+{
+    if (StartupTracer *tracer = self()) {
+        tracer->begin(name, dependencies, tracer->elapsed());
+    }
+}
+
+void StartupTracer::endPhase(const QByteArray &name)
+{
+    if (StartupTracer *tracer = self()) {
+        tracer->end(name, tracer->elapsed());
+    }
+}
+
+void StartupTracer::finish()
+{
+    StartupTracer *tracer = self();
+    if (!tracer) {
+        return;
+    }
+    const QString fileName = qEnvironmentVariable("KWIN_STARTUP_TRACE");
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(tracer->toJson()) == -1) {
+        qCWarning(KWIN_CORE) << "Failed to write the startup trace to" << fileName << file.errorString();
+    }
+    qCInfo(KWIN_CORE).noquote() << tracer->summary();
+    // later phases, e.g. from reconfiguring, aren't interesting anymore
+    globalTracer().reset();
+}
+
+std::chrono::microseconds StartupTracer::elapsed() const
+{
+    return std::chrono::microseconds(m_timer.nsecsElapsed() / 1000);
+}
+
+void StartupTracer::begin(const QByteArray &name, const QByteArrayList &dependencies, std::chrono::microseconds timestamp)
+{
+    Phase phase;
+    phase.name = name;
+    phase.dependencies = dependencies;
+    phase.begin = timestamp;
+    m_phases.append(phase);
+}
+
+void StartupTracer::end(const QByteArray &name, std::chrono::microseconds timestamp)
+{
+    for (auto it = m_phases.rbegin(); it != m_phases.rend(); ++it) {
+        if (it->name == name && !it->finished) {
+            it->end = timestamp;
+            it->finished = true;
+            return;
+        }
+    }
+}
+
+const QVector<StartupTracer::Phase> &StartupTracer::phases() const
+{
+    return m_phases;
+}
+
+const StartupTracer::Phase *StartupTracer::findPhase(const QByteArray &name) const
+{
+    for (const Phase &phase : m_phases) {
+        if (phase.name == name && phase.finished) {
+            return &phase;
+        }
+    }
+    return nullptr;
+}
+
+QByteArrayList StartupTracer::criticalPath() const
+{
+    const Phase *current = nullptr;
+    for (const Phase &phase : m_phases) {
+        if (phase.finished && (!current || phase.end > current->end)) {
+            current = &phase;
+        }
+    }
+
+    QByteArrayList path;
+    // a dependency cycle must not make us loop forever
+    while (current && path.count() < m_phases.count()) {
+        path.prepend(current->name);
+        const Phase *next = nullptr;
+        for (const QByteArray &dependency : current->dependencies) {
+            const Phase *candidate = findPhase(dependency);
+            if (candidate && (!next || candidate->end > next->end)) {
+                next = candidate;
+            }
+        }
+        current = next;
+    }
+    return path;
+}
+
+QByteArray StartupTracer::toJson() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for (const Phase &phase : m_phases) {
+        if (!phase.finished) {
+            continue;
+        }
+        QJsonArray dependencies;
+        for (const QByteArray &dependency : phase.dependencies) {
+            dependencies.append(QString::fromUtf8(dependency));
+        }
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QString::fromUtf8(phase.name)},
+            {QStringLiteral("cat"), QStringLiteral("startup")},
+            {QStringLiteral("ph"), QStringLiteral("X")},
+            {QStringLiteral("ts"), qint64(phase.begin.count())},
+            {QStringLiteral("dur"), qint64((phase.end - phase.begin).count())},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), pid},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("dependencies"), dependencies}}},
+        });
+    }
+    return QJsonDocument(QJsonObject{{QStringLiteral("traceEvents"), events}}).toJson(QJsonDocument::Compact);
+}
+
+static QString formatDuration(std::chrono::microseconds duration)
+{
+    return QString::number(duration.count() / 1000.0, 'f', 1) + QStringLiteral(" ms");
+}
+
+QString StartupTracer::summary() const
+{
+    const QByteArrayList path = criticalPath();
+    if (path.isEmpty()) {
+        return QStringLiteral("No startup phases were recorded");
+    }
+    QString summary = QStringLiteral("Startup took ") + formatDuration(findPhase(path.last())->end) + QStringLiteral(", critical path:");
+    const Phase *previous = nullptr;
+    for (const QByteArray &name : path) {
+        const Phase *phase = findPhase(name);
+        summary += QStringLiteral("\n  ") + QString::fromUtf8(name) + QLatin1Char(' ') + formatDuration(phase->end - phase->begin);
+        if (previous && phase->begin > previous->end) {
+            summary += QStringLiteral(" (started ") + formatDuration(phase->begin - previous->end) + QStringLiteral(" later)");
+        }
+        previous = phase;
+    }
+    return summary;
+}
+
+} // namespace KWin
@@ -0,0 +1,80 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QByteArrayList>
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The StartupTracer records how long each phase of the startup takes and which phases it had
+ * to wait for.
+ *
+ * It's enabled by setting the KWIN_STARTUP_TRACE environment variable to a file name. Once KWin
+ * has started, the phases are written to that file in the Chrome trace event format, which can
+ * be opened in chrome://tracing or Perfetto, and the critical path, that is the chain of phases
+ * that determined when the startup finished, is printed to the log.
+ */
+class KWIN_EXPORT StartupTracer
+{
+public:
+    struct Phase
+    {
+        QByteArray name;
+        QByteArrayList dependencies;
+        std::chrono::microseconds begin = std::chrono::microseconds::zero();
+        std::chrono::microseconds end = std::chrono::microseconds::zero();
+        bool finished = false;
+    };
+
+    StartupTracer();
+
+    /**
+     * Returns the tracer of this process, or @c nullptr if startup tracing isn't enabled.
+     */
+    static StartupTracer *self();
+
+    /**
+     * Convenience helpers that do nothing if startup tracing isn't enabled.
+     */
+    static void beginPhase(const QByteArray &name, const QByteArrayList &dependencies = {});
+    static void endPhase(const QByteArray &name);
+    /**
+     * Writes the trace file and prints the critical path once the startup is done.
+     */
+    static void finish();
+
+    void begin(const QByteArray &name, const QByteArrayList &dependencies, std::chrono::microseconds timestamp);
+    void end(const QByteArray &name, std::chrono::microseconds timestamp);
+
+    const QVector<Phase> &phases() const;
+    /**
+     * Returns the names of the phases on the critical path, starting with the first one. The
+     * path ends at the phase that finished last and follows the dependency that finished last.
+     */
+    QByteArrayList criticalPath() const;
+
+    QByteArray toJson() const;
+    QString summary() const;
+
+private:
+    const Phase *findPhase(const QByteArray &name) const;
+    std::chrono::microseconds elapsed() const;
+
+    QVector<Phase> m_phases;
+    QElapsedTimer m_timer;
+};
+
+} // namespace KWin
@@ -120,6 +120,24 @@ void SurfaceItem::discardPixmap()
     addDamage(rect().toAlignedRect());
 }
 
+void SurfaceItem::trim(bool keepContents)
+{
+    m_damage = QRegion();
+    if (!keepContents) {
+        m_pixmap.reset();
+        m_previousPixmap.reset();
+        m_referencePixmapCounter = 0;
+        return;
+    }
+    if (m_pixmap && m_pixmap->isValid()) {
+        m_previousPixmap.reset();
+        m_referencePixmapCounter = 0;
+    }
+    if (SurfacePixmap *pixmap = this->pixmap()) {
+        pixmap->releaseClientBuffer();
+    }
+}
+
 void SurfaceItem::preprocess()
 {
     updatePixmap();
@@ -166,6 +184,10 @@ void SurfacePixmap::update()
 {
 }
 
+void SurfacePixmap::releaseClientBuffer()
+{
+}
+
 SurfaceTexture *SurfacePixmap::texture() const
 {
     return m_texture.get();
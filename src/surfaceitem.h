@@ -41,6 +41,14 @@ public:
     void referencePreviousPixmap();
     void unreferencePreviousPixmap();
 
+    /**
+     * Drops what the item of a closed window doesn't need any more. If the window is kept
+     * around for a closing animation, only the current contents stay, without the previous
+     * pixmap and the client buffer if the texture has a copy of it. Otherwise the pixmaps
+     * are dropped right away, rather than when the window is eventually deleted.
+     */
+    void trim(bool keepContents);
+
 protected:
     explicit SurfaceItem(Window *window, Item *parent = nullptr);
 
@@ -84,6 +92,11 @@ public:
 
     virtual void create() = 0;
     virtual void update();
+    /**
+     * Releases the client buffer if the texture doesn't need it any more, because the item
+     * won't be updated again.
+     */
+    virtual void releaseClientBuffer();
 
     virtual bool isValid() const = 0;
 
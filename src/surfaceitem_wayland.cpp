@@ -6,14 +6,27 @@
 
 #include "surfaceitem_wayland.h"
 #include "composite.h"
+#include "ftrace.h"
+#include "inputlatencytracker.h"
 #include "scene.h"
+#include "utils/common.h"
 #include "wayland/clientbuffer.h"
+#include "wayland/clientconnection.h"
+#include "wayland/shmclientbuffer.h"
 #include "wayland/subcompositor_interface.h"
 #include "wayland/surface_interface.h"
 
+#include <cmath>
+
 namespace KWin
 {
 
+// The detected opaque region is used once it hasn't shrunk for this many commits.
+static const int s_stableOpaqueCommitThreshold = 3;
+// The detection is given up for a surface once its opaque region has shrunk this many times.
+static const int s_maxOpaqueRegressions = 8;
+static const int s_opaqueTileSize = 64;
+
 SurfaceItemWayland::SurfaceItemWayland(KWaylandServer::SurfaceInterface *surface,
                                        Window *window, Item *parent)
     : SurfaceItem(window, parent)
@@ -33,6 +46,11 @@ SurfaceItemWayland::SurfaceItemWayland(KWaylandServer::SurfaceInterface *surface
             this, &SurfaceItemWayland::handleSurfaceCommitted);
     connect(surface, &KWaylandServer::SurfaceInterface::damaged,
             this, &SurfaceItemWayland::addDamage);
+    connect(surface, &KWaylandServer::SurfaceInterface::damaged, this, [this](const QRegion &region) {
+        m_opaqueScanDamage += region;
+    });
+    connect(surface, &KWaylandServer::SurfaceInterface::bufferSizeChanged,
+            this, &SurfaceItemWayland::resetDetectedOpaque);
     connect(surface, &KWaylandServer::SurfaceInterface::childSubSurfaceRemoved,
             this, &SurfaceItemWayland::handleChildSubSurfaceRemoved);
 
@@ -61,11 +79,110 @@ QRegion SurfaceItemWayland::shape() const
 QRegion SurfaceItemWayland::opaque() const
 {
     if (m_surface) {
-        return m_surface->opaque();
+        const QRegion opaque = m_surface->opaque();
+        if (opaque.isEmpty() && m_stableOpaqueCommits >= s_stableOpaqueCommitThreshold) {
+            return m_detectedOpaque;
+        }
+        return opaque;
     }
     return QRegion();
 }
 
+/**
+ * Returns whether all pixels in @a rect of @a image, which is in one of the 32 bit ARGB
+ * formats, are opaque.
+ */
+static bool isOpaque(const QImage &image, const QRect &rect)
+{
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uint32_t *pixels = reinterpret_cast<const uint32_t *>(image.constScanLine(y)) + rect.x();
+        // no early exit within a row, so that the compiler can vectorize the loop
+        uint32_t alpha = 0xff000000;
+        for (int x = 0; x < rect.width(); ++x) {
+            alpha &= pixels[x];
+        }
+        if ((alpha & 0xff000000) != 0xff000000) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the largest integer rectangle within @a rect.
+ */
+static QRect innerRect(const QRectF &rect)
+{
+    const int left = std::ceil(rect.left());
+    const int top = std::ceil(rect.top());
+    const int right = std::floor(rect.right());
+    const int bottom = std::floor(rect.bottom());
+    return QRect(left, top, right - left, bottom - top);
+}
+
+void SurfaceItemWayland::updateDetectedOpaque()
+{
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_WAYLAND_NO_OPAQUE_DETECTION") != 0;
+    const QRegion damage = std::exchange(m_opaqueScanDamage, QRegion());
+    if (disabled || damage.isEmpty() || m_opaqueRegressions >= s_maxOpaqueRegressions) {
+        return;
+    }
+
+    // Only the clients that don't say which parts of the surface are opaque need this.
+    auto buffer = qobject_cast<KWaylandServer::ShmClientBuffer *>(m_surface->buffer());
+    if (!buffer || !buffer->hasAlphaChannel() || !m_surface->opaque().isEmpty()) {
+        resetDetectedOpaque();
+        return;
+    }
+    const QImage image = buffer->data();
+    if (image.format() != QImage::Format_ARGB32_Premultiplied && image.format() != QImage::Format_ARGB32) {
+        resetDetectedOpaque();
+        return;
+    }
+
+    // The damage is scanned in tiles, so that a translucent border, e.g. a client-side
+    // shadow, doesn't make the whole damaged rectangle translucent.
+    const QMatrix4x4 surfaceToBuffer = m_surface->surfaceToBufferMatrix();
+    const QMatrix4x4 bufferToSurface = surfaceToBuffer.inverted();
+    const QRegion bufferDamage = mapRegion(surfaceToBuffer, damage) & image.rect();
+    QRegion opaque;
+    QRegion translucent;
+    for (const QRect &rect : bufferDamage) {
+        const int firstColumn = rect.left() / s_opaqueTileSize;
+        const int lastColumn = rect.right() / s_opaqueTileSize;
+        const int firstRow = rect.top() / s_opaqueTileSize;
+        const int lastRow = rect.bottom() / s_opaqueTileSize;
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                const QRect tile = rect & QRect(column * s_opaqueTileSize, row * s_opaqueTileSize, s_opaqueTileSize, s_opaqueTileSize);
+                const QRectF surfaceTile = bufferToSurface.mapRect(QRectF(tile));
+                if (isOpaque(image, tile)) {
+                    opaque += innerRect(surfaceTile);
+                } else {
+                    translucent += surfaceTile.toAlignedRect();
+                }
+            }
+        }
+    }
+
+    if (translucent.intersects(m_detectedOpaque)) {
+        m_stableOpaqueCommits = 0;
+        m_opaqueRegressions++;
+    } else if (m_stableOpaqueCommits < s_stableOpaqueCommitThreshold) {
+        m_stableOpaqueCommits++;
+    }
+    m_detectedOpaque = (m_detectedOpaque - translucent) | opaque;
+    if (m_opaqueRegressions >= s_maxOpaqueRegressions) {
+        resetDetectedOpaque();
+    }
+}
+
+void SurfaceItemWayland::resetDetectedOpaque()
+{
+    m_detectedOpaque = QRegion();
+    m_stableOpaqueCommits = 0;
+}
+
 KWaylandServer::SurfaceInterface *SurfaceItemWayland::surface() const
 {
     return m_surface;
@@ -76,6 +193,7 @@ void SurfaceItemWayland::handleSurfaceToBufferMatrixChanged()
     setSurfaceToBufferMatrix(m_surface->surfaceToBufferMatrix());
     discardQuads();
     discardPixmap();
+    resetDetectedOpaque();
 }
 
 void SurfaceItemWayland::handleSurfaceSizeChanged()
@@ -85,9 +203,31 @@ void SurfaceItemWayland::handleSurfaceSizeChanged()
 
 void SurfaceItemWayland::handleSurfaceCommitted()
 {
+    updateDetectedOpaque();
+
     if (m_surface->hasFrameCallbacks()) {
         scheduleFrame();
     }
+
+    if (const auto inputTimestamp = InputLatencyTracker::self()->takeInputTimestamp(m_surface)) {
+        m_commitInputTimestamps.append(*inputTimestamp);
+    }
+
+    if (FTraceLogger::self()->isEnabled()) {
+        const quint32 context = FTraceLogger::nextContext();
+        fTraceBegin(context, "Surface commit (", m_surface->client()->processId(), ":", m_surface->id(), ")");
+        m_commitTraceContexts.append(context);
+    }
+}
+
+QVector<quint32> SurfaceItemWayland::takeCommitTraceContexts()
+{
+    return std::exchange(m_commitTraceContexts, QVector<quint32>());
+}
+
+QVector<std::chrono::microseconds> SurfaceItemWayland::takeCommitInputTimestamps()
+{
+    return std::exchange(m_commitInputTimestamps, QVector<std::chrono::microseconds>());
 }
 
 SurfaceItemWayland *SurfaceItemWayland::getOrCreateSubSurfaceItem(KWaylandServer::SubSurfaceInterface *child)
@@ -173,9 +313,35 @@ void SurfacePixmapWayland::update()
     KWaylandServer::SurfaceInterface *surface = m_item->surface();
     if (surface) {
         setBuffer(surface->buffer());
+        m_releasePoint = surface->bufferReleasePoint();
     }
 }
 
+void SurfacePixmapWayland::releaseShmBuffer()
+{
+    // With a texture budget, the buffer is held until the next one arrives so the texture can be
+    // evicted and uploaded again later.
+    static const bool earlyRelease = !qEnvironmentVariableIsSet("KWIN_WAYLAND_NO_EARLY_SHM_RELEASE")
+        && qEnvironmentVariableIntValue("KWIN_TEXTURE_BUDGET") <= 0;
+    if (earlyRelease && qobject_cast<KWaylandServer::ShmClientBuffer *>(m_buffer)) {
+        m_buffer->release();
+    }
+}
+
+void SurfacePixmapWayland::releaseClientBuffer()
+{
+    // Only shm textures hold a copy, the other ones sample the client buffer.
+    SurfaceTexture *texture = this->texture();
+    if (qobject_cast<KWaylandServer::ShmClientBuffer *>(m_buffer) && texture && texture->isValid()) {
+        m_buffer->release();
+    }
+}
+
+SyncReleasePoint *SurfacePixmapWayland::releasePoint() const
+{
+    return m_releasePoint.get();
+}
+
 bool SurfacePixmapWayland::isValid() const
 {
     return m_buffer;
@@ -211,4 +377,17 @@ QRegion SurfaceItemXwayland::shape() const
     return shape & clipRect.toRect();
 }
 
+QRegion SurfaceItemXwayland::opaque() const
+{
+    // Xwayland doesn't pass on what the X11 window knows, e.g. that a window with a 24 bit visual
+    // is opaque even though its buffer has an alpha channel, or _NET_WM_OPAQUE_REGION.
+    QRegion region = SurfaceItemWayland::opaque();
+    if (!window()->hasAlpha()) {
+        region |= shape();
+    } else {
+        region |= window()->opaqueRegion() & shape();
+    }
+    return region;
+}
+
 } // namespace KWin
@@ -18,6 +18,8 @@ class SurfaceInterface;
 namespace KWin
 {
 
+class SyncReleasePoint;
+
 /**
  * The SurfaceItemWayland class represents a Wayland surface in the scene.
  */
@@ -34,6 +36,17 @@ public:
 
     KWaylandServer::SurfaceInterface *surface() const;
 
+    /**
+     * Returns the ftrace contexts of the commits since the last call, and forgets them. The
+     * scene ends the commit markers when the frame showing the commits is presented.
+     */
+    QVector<quint32> takeCommitTraceContexts();
+    /**
+     * Returns the kernel timestamps of the input events that the commits since the last call
+     * react to, see InputLatencyTracker.
+     */
+    QVector<std::chrono::microseconds> takeCommitInputTimestamps();
+
 private Q_SLOTS:
     void handleSurfaceToBufferMatrixChanged();
     void handleSurfaceCommitted();
@@ -49,9 +62,20 @@ protected:
 
 private:
     SurfaceItemWayland *getOrCreateSubSurfaceItem(KWaylandServer::SubSurfaceInterface *s);
+    void updateDetectedOpaque();
+    void resetDetectedOpaque();
 
     QPointer<KWaylandServer::SurfaceInterface> m_surface;
     QHash<KWaylandServer::SubSurfaceInterface *, SurfaceItemWayland *> m_subsurfaces;
+    QVector<quint32> m_commitTraceContexts;
+    QVector<std::chrono::microseconds> m_commitInputTimestamps;
+    // The parts of an shm buffer with an alpha channel whose pixels are all opaque, for the
+    // clients that don't set an opaque region. They're only trusted once they've been stable
+    // for a few commits, and the detection stops if they keep changing.
+    QRegion m_opaqueScanDamage;
+    QRegion m_detectedOpaque;
+    int m_stableOpaqueCommits = 0;
+    int m_opaqueRegressions = 0;
 };
 
 class KWIN_EXPORT SurfacePixmapWayland final : public SurfacePixmap
@@ -66,8 +90,25 @@ public:
     KWaylandServer::SurfaceInterface *surface() const;
     KWaylandServer::ClientBuffer *buffer() const;
 
+    /**
+     * Releases the shm buffer to the client once its contents have been copied to the
+     * surface texture, so single and double buffered clients don't have to wait until the
+     * next commit replaces the buffer. The buffer is still referenced, the surface texture
+     * can't be recreated from it though until the client commits again.
+     *
+     * Setting the KWIN_WAYLAND_NO_EARLY_SHM_RELEASE environment variable disables it.
+     */
+    void releaseShmBuffer();
+
+    /**
+     * Returns the explicit sync release point of the buffer, if any. It's kept alive, i.e.
+     * not signaled, for as long as the pixmap holds the buffer.
+     */
+    SyncReleasePoint *releasePoint() const;
+
     void create() override;
     void update() override;
+    void releaseClientBuffer() override;
     bool isValid() const override;
 
 private:
@@ -75,6 +116,7 @@ private:
 
     SurfaceItemWayland *m_item;
     KWaylandServer::ClientBuffer *m_buffer = nullptr;
+    std::shared_ptr<SyncReleasePoint> m_releasePoint;
 };
 
 /**
@@ -88,6 +130,7 @@ public:
     explicit SurfaceItemXwayland(Window *window, Item *parent = nullptr);
 
     QRegion shape() const override;
+    QRegion opaque() const override;
 };
 
 } // namespace KWin
@@ -7,6 +7,8 @@
 #include "surfaceitem_x11.h"
 #include "composite.h"
 #include "scene.h"
+#include "utils/c_ptr.h"
+#include "utils/damagesimplifier.h"
 #include "x11syncmanager.h"
 
 namespace KWin
@@ -23,6 +25,8 @@ SurfaceItemX11::SurfaceItemX11(Window *window, Item *parent)
     m_damageHandle = xcb_generate_id(kwinApp()->x11Connection());
     xcb_damage_create(kwinApp()->x11Connection(), m_damageHandle, window->frameId(),
                       XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+    m_damageRegion = xcb_generate_id(kwinApp()->x11Connection());
+    xcb_xfixes_create_region(kwinApp()->x11Connection(), m_damageRegion, 0, nullptr);
 
     setSize(window->bufferGeometry().size());
 }
@@ -59,12 +63,10 @@ bool SurfaceItemX11::fetchDamage()
         return true;
     }
 
-    xcb_xfixes_region_t region = xcb_generate_id(kwinApp()->x11Connection());
-    xcb_xfixes_create_region(kwinApp()->x11Connection(), region, 0, nullptr);
-    xcb_damage_subtract(kwinApp()->x11Connection(), m_damageHandle, 0, region);
-
-    m_damageCookie = xcb_xfixes_fetch_region_unchecked(kwinApp()->x11Connection(), region);
-    xcb_xfixes_destroy_region(kwinApp()->x11Connection(), region);
+    // The subtract replaces the contents of the region, and the X server handles the requests
+    // in order, so the region can be reused even if the previous reply hasn't been read yet.
+    xcb_damage_subtract(kwinApp()->x11Connection(), m_damageHandle, 0, m_damageRegion);
+    m_damageCookie = xcb_xfixes_fetch_region_unchecked(kwinApp()->x11Connection(), m_damageRegion);
 
     m_havePendingDamageRegion = true;
 
@@ -88,7 +90,7 @@ void SurfaceItemX11::waitForDamage()
     const int rectCount = xcb_xfixes_fetch_region_rectangles_length(reply);
     QRegion region;
 
-    if (rectCount > 1 && rectCount < 16) {
+    if (rectCount > 1) {
         xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reply);
 
         QVector<QRect> qtRects;
@@ -98,6 +100,8 @@ void SurfaceItemX11::waitForDamage()
             qtRects << QRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
         }
         region.setRects(qtRects.constData(), rectCount);
+        // the simplifier decides whether the bounding rect or a coarser region is cheaper
+        region = DamageSimplifier::surfaceDamage()->simplify(region);
     } else {
         region = QRect(reply->extents.x, reply->extents.y, reply->extents.width, reply->extents.height);
     }
@@ -113,6 +117,8 @@ void SurfaceItemX11::destroyDamage()
         m_isDamaged = false;
         xcb_damage_destroy(kwinApp()->x11Connection(), m_damageHandle);
         m_damageHandle = XCB_NONE;
+        xcb_xfixes_destroy_region(kwinApp()->x11Connection(), m_damageRegion);
+        m_damageRegion = XCB_NONE;
     }
 }
 
@@ -160,8 +166,15 @@ SurfacePixmapX11::SurfacePixmapX11(SurfaceItemX11 *item, QObject *parent)
 
 SurfacePixmapX11::~SurfacePixmapX11()
 {
+    xcb_connection_t *connection = kwinApp()->x11Connection();
+    if (m_pendingPixmap != XCB_PIXMAP_NONE) {
+        xcb_discard_reply(connection, m_namePixmapCookie.sequence);
+        xcb_discard_reply(connection, m_attributesCookie.sequence);
+        xcb_discard_reply(connection, m_geometryCookie.sequence);
+        xcb_free_pixmap(connection, m_pendingPixmap);
+    }
     if (m_pixmap != XCB_PIXMAP_NONE) {
-        xcb_free_pixmap(kwinApp()->x11Connection(), m_pixmap);
+        xcb_free_pixmap(connection, m_pixmap);
     }
 }
 
@@ -187,20 +200,60 @@ void SurfacePixmapX11::create()
         return;
     }
 
+    if (m_pendingPixmap == XCB_PIXMAP_NONE) {
+        requestPixmap();
+    }
+    // While a window is resized, the previous pixmap is shown until the replies arrive instead
+    // of blocking the compositor on a round trip for every new size. A window that has no
+    // previous pixmap has nothing to show, so there's no point in waiting.
+    const bool wait = !m_item->previousPixmap() || !m_item->previousPixmap()->isValid();
+    if (!finishPixmap(wait)) {
+        if (m_pendingPixmap != XCB_PIXMAP_NONE) {
+            m_item->scheduleFrame();
+        }
+    }
+}
+
+void SurfacePixmapX11::requestPixmap()
+{
+    // The server processes the requests in one go while it's grabbed, so the window attributes
+    // and geometry match the named pixmap even though the replies are only read later.
     XServerGrabber grabber;
     xcb_connection_t *connection = kwinApp()->x11Connection();
-    xcb_window_t frame = window->frameId();
-    xcb_pixmap_t pixmap = xcb_generate_id(connection);
-    xcb_void_cookie_t namePixmapCookie = xcb_composite_name_window_pixmap_checked(connection,
-                                                                                  frame,
-                                                                                  pixmap);
-    Xcb::WindowAttributes windowAttributes(frame);
-    Xcb::WindowGeometry windowGeometry(frame);
-    if (xcb_generic_error_t *error = xcb_request_check(connection, namePixmapCookie)) {
+    const xcb_window_t frame = m_item->window()->frameId();
+    m_pendingPixmap = xcb_generate_id(connection);
+    m_namePixmapCookie = xcb_composite_name_window_pixmap_checked(connection, frame, m_pendingPixmap);
+    m_attributesCookie = xcb_get_window_attributes_unchecked(connection, frame);
+    m_geometryCookie = xcb_get_geometry_unchecked(connection, frame);
+}
+
+bool SurfacePixmapX11::finishPixmap(bool wait)
+{
+    const Window *window = m_item->window();
+    xcb_connection_t *connection = kwinApp()->x11Connection();
+
+    // the geometry is requested last, once its reply is there, so are the other ones
+    xcb_get_geometry_reply_t *geometryReply = nullptr;
+    if (wait) {
+        geometryReply = xcb_get_geometry_reply(connection, m_geometryCookie, nullptr);
+    } else {
+        xcb_generic_error_t *error = nullptr;
+        if (!xcb_poll_for_reply(connection, m_geometryCookie.sequence, reinterpret_cast<void **>(&geometryReply), &error)) {
+            return false;
+        }
+        free(error);
+    }
+    UniqueCPtr<xcb_get_geometry_reply_t> windowGeometry(geometryReply);
+    UniqueCPtr<xcb_get_window_attributes_reply_t> windowAttributes(xcb_get_window_attributes_reply(connection, m_attributesCookie, nullptr));
+
+    const xcb_pixmap_t pixmap = m_pendingPixmap;
+    m_pendingPixmap = XCB_PIXMAP_NONE;
+
+    if (xcb_generic_error_t *error = xcb_request_check(connection, m_namePixmapCookie)) {
         qCDebug(KWIN_CORE, "Failed to create window pixmap for window 0x%x (error code %d)",
                 window->window(), error->error_code);
         free(error);
-        return;
+        return false;
     }
     // check that the received pixmap is valid and actually matches what we
     // know about the window (i.e. size)
@@ -208,14 +261,14 @@ void SurfacePixmapX11::create()
         qCDebug(KWIN_CORE, "Failed to create window pixmap for window 0x%x (not viewable)",
                 window->window());
         xcb_free_pixmap(connection, pixmap);
-        return;
+        return false;
     }
     const QRectF bufferGeometry = window->bufferGeometry();
-    if (windowGeometry.size() != bufferGeometry.size()) {
+    if (!windowGeometry || QSizeF(windowGeometry->width, windowGeometry->height) != bufferGeometry.size()) {
         qCDebug(KWIN_CORE, "Failed to create window pixmap for window 0x%x (mismatched geometry)",
                 window->window());
         xcb_free_pixmap(connection, pixmap);
-        return;
+        return false;
     }
 
     m_pixmap = pixmap;
@@ -224,6 +277,7 @@ void SurfacePixmapX11::create()
     // device pixel size is guaranteed to be the same and we can convert safely
     m_size = bufferGeometry.size().toSize();
     m_contentsRect = QRectF(window->clientPos(), window->clientSize());
+    return true;
 }
 
 } // namespace KWin
@@ -44,6 +44,8 @@ protected:
 
 private:
     xcb_damage_damage_t m_damageHandle = XCB_NONE;
+    // the region that the damage is moved into, reused for every frame
+    xcb_xfixes_region_t m_damageRegion = XCB_NONE;
     xcb_xfixes_fetch_region_cookie_t m_damageCookie;
     bool m_isDamaged = false;
     bool m_havePendingDamageRegion = false;
@@ -64,8 +66,17 @@ public:
     bool isValid() const override;
 
 private:
+    void requestPixmap();
+    bool finishPixmap(bool wait);
+
     SurfaceItemX11 *m_item;
     xcb_pixmap_t m_pixmap = XCB_PIXMAP_NONE;
+
+    // the pixmap whose replies haven't been checked yet
+    xcb_pixmap_t m_pendingPixmap = XCB_PIXMAP_NONE;
+    xcb_void_cookie_t m_namePixmapCookie;
+    xcb_get_window_attributes_cookie_t m_attributesCookie;
+    xcb_get_geometry_cookie_t m_geometryCookie;
 };
 
 } // namespace KWaylandServer
@@ -29,6 +29,13 @@ bool SyncAlarmX11Filter::event(xcb_generic_event_t *event)
     });
     if (client) {
         client->handleSync();
+        return false;
+    }
+    client = workspace()->findClient([alarmEvent](const X11Window *client) {
+        return alarmEvent->alarm == client->frameSync().alarm;
+    });
+    if (client) {
+        client->handleFrameSync(alarmEvent->counter_value);
     }
     return false;
 }
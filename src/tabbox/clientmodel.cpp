@@ -155,7 +155,7 @@ void ClientModel::createClientList(bool partialReset)
 }
 
 void ClientModel::createFocusChainClientList(int desktop,
-    const QSharedPointer<TabBoxClient> &start, TabBoxClientList &stickyClients)
+    const QSharedPointer<TabBoxClient> &start, TabBoxClientList &clientList, TabBoxClientList &stickyClients)
 {
     auto c = start;
     if (!tabBox->isInFocusChain(c.data())) {
@@ -168,7 +168,7 @@ void ClientModel::createFocusChainClientList(int desktop,
     do {
         QSharedPointer<TabBoxClient> add = tabBox->clientToAddToList(c.data(), desktop);
         if (!add.isNull()) {
-            m_clientList += add;
+            clientList += add;
             if (add.data()->isFirstInTabBox()) {
                 stickyClients << add;
             }
@@ -178,7 +178,7 @@ void ClientModel::createFocusChainClientList(int desktop,
 }
 
 void ClientModel::createStackingOrderClientList(int desktop,
-    const QSharedPointer<TabBoxClient> &start, TabBoxClientList &stickyClients)
+    const QSharedPointer<TabBoxClient> &start, TabBoxClientList &clientList, TabBoxClientList &stickyClients)
 {
     // TODO: needs improvement
     const TabBoxClientList stacking = tabBox->stackingOrder();
@@ -189,10 +189,10 @@ void ClientModel::createStackingOrderClientList(int desktop,
         QSharedPointer<TabBoxClient> add = tabBox->clientToAddToList(c.data(), desktop);
         if (!add.isNull()) {
             if (start == add.data()) {
-                m_clientList.removeAll(add);
-                m_clientList.prepend(add);
+                clientList.removeAll(add);
+                clientList.prepend(add);
             } else {
-                m_clientList += add;
+                clientList += add;
             }
             if (add.data()->isFirstInTabBox()) {
                 stickyClients << add;
@@ -221,40 +221,87 @@ void ClientModel::createClientList(int desktop, bool partialReset)
         }
     }
 
-    beginResetModel();
-    m_clientList.clear();
+    TabBoxClientList clientList;
     TabBoxClientList stickyClients;
 
     switch (tabBox->config().clientSwitchingMode()) {
     case TabBoxConfig::FocusChainSwitching: {
-        createFocusChainClientList(desktop, start, stickyClients);
+        createFocusChainClientList(desktop, start, clientList, stickyClients);
         break;
     }
     case TabBoxConfig::StackingOrderSwitching: {
-        createStackingOrderClientList(desktop, start, stickyClients);
+        createStackingOrderClientList(desktop, start, clientList, stickyClients);
         break;
     }
     }
 
     if (tabBox->config().orderMinimizedMode() == TabBoxConfig::GroupByMinimized) {
         // Put all non-minimized included clients first.
-        std::stable_partition(m_clientList.begin(), m_clientList.end(), [](const auto &client) {
+        std::stable_partition(clientList.begin(), clientList.end(), [](const auto &client) {
             return !client.toStrongRef()->isMinimized();
         });
     }
 
     for (const QWeakPointer<TabBoxClient> &c : qAsConst(stickyClients)) {
-        m_clientList.removeAll(c);
-        m_clientList.prepend(c);
+        clientList.removeAll(c);
+        clientList.prepend(c);
     }
     if (tabBox->config().clientApplicationsMode() != TabBoxConfig::AllWindowsCurrentApplication
-        && (tabBox->config().showDesktopMode() == TabBoxConfig::ShowDesktopClient || m_clientList.isEmpty())) {
+        && (tabBox->config().showDesktopMode() == TabBoxConfig::ShowDesktopClient || clientList.isEmpty())) {
         QWeakPointer<TabBoxClient> desktopClient = tabBox->desktopClient();
         if (!desktopClient.isNull()) {
-            m_clientList.append(desktopClient);
+            clientList.append(desktopClient);
         }
     }
-    endResetModel();
+    setClientList(clientList);
+}
+
+void ClientModel::setClientList(const TabBoxClientList &clientList)
+{
+    if (m_clientList.isEmpty()) {
+        if (!clientList.isEmpty()) {
+            beginInsertRows(QModelIndex(), 0, clientList.count() - 1);
+            m_clientList = clientList;
+            endInsertRows();
+        }
+        return;
+    }
+
+    // Apply the difference as individual removals, moves and insertions, so the views keep
+    // the delegates, and thus the thumbnails, of the clients that stay.
+    for (int i = m_clientList.count() - 1; i >= 0; --i) {
+        if (clientList.contains(m_clientList[i])) {
+            continue;
+        }
+        int first = i;
+        while (first > 0 && !clientList.contains(m_clientList[first - 1])) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), first, i);
+        m_clientList.erase(m_clientList.begin() + first, m_clientList.begin() + i + 1);
+        endRemoveRows();
+        i = first;
+    }
+    for (int i = 0; i < clientList.count(); ++i) {
+        const int current = m_clientList.indexOf(clientList[i], i);
+        if (current == i) {
+            continue;
+        }
+        if (current == -1) {
+            beginInsertRows(QModelIndex(), i, i);
+            m_clientList.insert(i, clientList[i]);
+            endInsertRows();
+        } else {
+            beginMoveRows(QModelIndex(), current, current, QModelIndex(), i);
+            m_clientList.move(current, i);
+            endMoveRows();
+        }
+    }
+    if (m_clientList.count() > clientList.count()) {
+        beginRemoveRows(QModelIndex(), clientList.count(), m_clientList.count() - 1);
+        m_clientList.erase(m_clientList.begin() + clientList.count(), m_clientList.end());
+        endRemoveRows();
+    }
 }
 
 void ClientModel::close(int i)
@@ -64,7 +64,7 @@ public:
 
     /**
      * Generates a new list of TabBoxClients based on the current config.
-     * Calling this method will reset the model. If partialReset is true
+     * Calling this method updates the model with the rows that changed. If partialReset is true
      * the top of the list is kept as a starting point. If not the
      * current active client is used as the starting point to generate the
      * list.
@@ -95,9 +95,10 @@ public Q_SLOTS:
 
 private:
     void createFocusChainClientList(int desktop, const QSharedPointer<TabBoxClient> &start,
-        TabBoxClientList &stickyClients);
+        TabBoxClientList &clientList, TabBoxClientList &stickyClients);
     void createStackingOrderClientList(int desktop, const QSharedPointer<TabBoxClient> &start,
-        TabBoxClientList &stickyClients);
+        TabBoxClientList &clientList, TabBoxClientList &stickyClients);
+    void setClientList(const TabBoxClientList &clientList);
 
     TabBoxClientList m_clientList;
 };
@@ -146,34 +146,83 @@ QModelIndex DesktopModel::desktopIndex(int desktop) const
 
 void DesktopModel::createDesktopList()
 {
-    beginResetModel();
-    m_desktopList.clear();
-    qDeleteAll(m_clientModels);
-    m_clientModels.clear();
-
+    QList<int> desktopList;
     switch (tabBox->config().desktopSwitchingMode()) {
     case TabBoxConfig::MostRecentlyUsedDesktopSwitching: {
         int desktop = tabBox->currentDesktop();
         do {
-            m_desktopList.append(desktop);
-            ClientModel *clientModel = new ClientModel(this);
-            clientModel->createClientList(desktop);
-            m_clientModels.insert(desktop, clientModel);
+            desktopList.append(desktop);
             desktop = tabBox->nextDesktopFocusChain(desktop);
         } while (desktop != tabBox->currentDesktop());
         break;
     }
     case TabBoxConfig::StaticDesktopSwitching: {
         for (int i = 1; i <= tabBox->numberOfDesktops(); i++) {
-            m_desktopList.append(i);
-            ClientModel *clientModel = new ClientModel(this);
-            clientModel->createClientList(i);
-            m_clientModels.insert(i, clientModel);
+            desktopList.append(i);
         }
         break;
     }
     }
-    endResetModel();
+
+    // The desktops that stay keep their client models, which only update the clients that
+    // changed, so that the views don't have to recreate all delegates.
+    for (int i = m_desktopList.count() - 1; i >= 0; --i) {
+        const int desktop = m_desktopList[i];
+        if (desktopList.contains(desktop)) {
+            m_clientModels[desktop]->createClientList(desktop);
+            continue;
+        }
+        beginRemoveRows(QModelIndex(), i, i);
+        m_desktopList.removeAt(i);
+        delete m_clientModels.take(desktop);
+        endRemoveRows();
+    }
+    for (int i = 0; i < desktopList.count(); ++i) {
+        const int desktop = desktopList[i];
+        const int current = m_desktopList.indexOf(desktop);
+        if (current == i) {
+            continue;
+        }
+        if (current == -1) {
+            ClientModel *clientModel = createClientModel(desktop);
+            beginInsertRows(QModelIndex(), i, i);
+            m_desktopList.insert(i, desktop);
+            m_clientModels.insert(desktop, clientModel);
+            endInsertRows();
+        } else {
+            beginMoveRows(QModelIndex(), current, current, QModelIndex(), i);
+            m_desktopList.move(current, i);
+            endMoveRows();
+        }
+    }
+}
+
+ClientModel *DesktopModel::createClientModel(int desktop)
+{
+    ClientModel *clientModel = new ClientModel(this);
+    clientModel->createClientList(desktop);
+
+    // the clients are the children of the desktop rows
+    connect(clientModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this, desktop](const QModelIndex &, int first, int last) {
+        beginInsertRows(desktopIndex(desktop), first, last);
+    });
+    connect(clientModel, &QAbstractItemModel::rowsInserted, this, [this]() {
+        endInsertRows();
+    });
+    connect(clientModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, [this, desktop](const QModelIndex &, int first, int last) {
+        beginRemoveRows(desktopIndex(desktop), first, last);
+    });
+    connect(clientModel, &QAbstractItemModel::rowsRemoved, this, [this]() {
+        endRemoveRows();
+    });
+    connect(clientModel, &QAbstractItemModel::rowsAboutToBeMoved, this, [this, desktop](const QModelIndex &, int first, int last, const QModelIndex &, int destination) {
+        const QModelIndex parent = desktopIndex(desktop);
+        beginMoveRows(parent, first, last, parent, destination);
+    });
+    connect(clientModel, &QAbstractItemModel::rowsMoved, this, [this]() {
+        endMoveRows();
+    });
+    return clientModel;
 }
 
 } // namespace Tabbox
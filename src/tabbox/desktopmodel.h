@@ -53,7 +53,7 @@ public:
 
     /**
      * Generates a new list of desktops based on the current config.
-     * Calling this method will reset the model.
+     * Calling this method updates the model with the rows that changed.
      */
     void createDesktopList();
     /**
@@ -71,6 +71,8 @@ public:
     QModelIndex desktopIndex(int desktop) const;
 
 private:
+    ClientModel *createClientModel(int desktop);
+
     QList<int> m_desktopList;
     QMap<int, ClientModel *> m_clientModels;
 };
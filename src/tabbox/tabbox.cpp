@@ -628,6 +628,8 @@ void TabBox::reset(bool partial_reset)
 
         if (!partial_reset) {
             setCurrentDesktop(VirtualDesktopManager::self()->current());
+        } else if (!m_tabBox->currentIndex().isValid()) {
+            setCurrentIndex(m_tabBox->first());
         }
         break;
     }
@@ -74,7 +74,8 @@ public:
     QMap<QString, QObject *> m_desktopTabBoxes;
     ClientModel *m_clientModel;
     DesktopModel *m_desktopModel;
-    QModelIndex index;
+    // follows its row when the models insert, remove or move clients
+    QPersistentModelIndex index;
     /**
      * Indicates if the tabbox is shown.
      */
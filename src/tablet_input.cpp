@@ -69,7 +69,11 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
         break;
     }
 
-    update();
+    // while the tip is down, the focus doesn't change
+    const bool stroke = type == InputRedirection::Axis && m_tipDown && tipDown;
+    if (!stroke) {
+        update();
+    }
 
     const auto button = m_tipDown ? Qt::LeftButton : Qt::NoButton;
     TabletEvent ev(t, pos, pos, QTabletEvent::Stylus, QTabletEvent::Pen, pressure,
@@ -81,8 +85,13 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
 
     ev.setTimestamp(time);
     input()->processSpies(std::bind(&InputEventSpy::tabletToolEvent, std::placeholders::_1, &ev));
-    input()->processFilters(
-        std::bind(&InputEventFilter::tabletToolEvent, std::placeholders::_1, &ev));
+    if (!stroke || !input()->processTabletStroke(&ev)) {
+        if (stroke) {
+            update();
+        }
+        input()->processFilters(InputEventType::Tablet,
+                                std::bind(&InputEventFilter::tabletToolEvent, std::placeholders::_1, &ev));
+    }
 
     m_tipDown = tipDown;
     m_tipNear = tipNear;
@@ -93,8 +102,8 @@ void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPre
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletToolButtonEvent,
                                     std::placeholders::_1, button, isPressed, tabletToolId, time));
-    input()->processFilters(std::bind(&InputEventFilter::tabletToolButtonEvent,
-                                      std::placeholders::_1, button, isPressed, tabletToolId, time));
+    input()->processFilters(InputEventType::Tablet, std::bind(&InputEventFilter::tabletToolButtonEvent,
+                                                              std::placeholders::_1, button, isPressed, tabletToolId, time));
     input()->setLastInputHandler(this);
 }
 
@@ -103,8 +112,8 @@ void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPres
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadButtonEvent,
                                     std::placeholders::_1, button, isPressed, tabletPadId, time));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadButtonEvent,
-                                      std::placeholders::_1, button, isPressed, tabletPadId, time));
+    input()->processFilters(InputEventType::Tablet, std::bind(&InputEventFilter::tabletPadButtonEvent,
+                                                              std::placeholders::_1, button, isPressed, tabletPadId, time));
     input()->setLastInputHandler(this);
 }
 
@@ -113,8 +122,8 @@ void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position,
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadStripEvent,
                                     std::placeholders::_1, number, position, isFinger, tabletPadId, time));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadStripEvent,
-                                      std::placeholders::_1, number, position, isFinger, tabletPadId, time));
+    input()->processFilters(InputEventType::Tablet, std::bind(&InputEventFilter::tabletPadStripEvent,
+                                                              std::placeholders::_1, number, position, isFinger, tabletPadId, time));
     input()->setLastInputHandler(this);
 }
 
@@ -123,8 +132,8 @@ void KWin::TabletInputRedirection::tabletPadRingEvent(int number, int position,
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadRingEvent,
                                     std::placeholders::_1, number, position, isFinger, tabletPadId, time));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadRingEvent,
-                                      std::placeholders::_1, number, position, isFinger, tabletPadId, time));
+    input()->processFilters(InputEventType::Tablet, std::bind(&InputEventFilter::tabletPadRingEvent,
+                                                              std::placeholders::_1, number, position, isFinger, tabletPadId, time));
     input()->setLastInputHandler(this);
 }
 
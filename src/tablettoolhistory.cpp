@@ -0,0 +1,88 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tablettoolhistory.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// The velocity is measured over this window, the samples of a pen arrive every few
+// milliseconds and the individual ones are too noisy.
+static const quint32 s_velocityWindow = 20;
+
+void TabletToolHistory::addSample(const Sample &sample)
+{
+    m_head = (m_head + 1) % s_capacity;
+    m_samples[m_head] = sample;
+    m_count = std::min(m_count + 1, s_capacity);
+}
+
+void TabletToolHistory::clear()
+{
+    m_count = 0;
+}
+
+int TabletToolHistory::count() const
+{
+    return m_count;
+}
+
+const TabletToolHistory::Sample &TabletToolHistory::sample(int index) const
+{
+    Q_ASSERT(index >= 0 && index < m_count);
+    return m_samples[(m_head - index + s_capacity) % s_capacity];
+}
+
+std::optional<QPointF> TabletToolHistory::predictPosition(std::chrono::milliseconds ahead) const
+{
+    if (m_count < 2) {
+        return std::nullopt;
+    }
+    const Sample &newest = sample(0);
+    const Sample *oldest = nullptr;
+    for (int i = 1; i < m_count; ++i) {
+        // the timestamps wrap around every 49 days
+        if (quint32(newest.timestamp - sample(i).timestamp) > s_velocityWindow) {
+            break;
+        }
+        oldest = &sample(i);
+    }
+    if (!oldest) {
+        return std::nullopt;
+    }
+    const quint32 elapsed = newest.timestamp - oldest->timestamp;
+    if (elapsed == 0) {
+        return newest.position;
+    }
+    const QPointF velocity = (newest.position - oldest->position) / elapsed;
+    return newest.position + velocity * ahead.count();
+}
+
+std::chrono::microseconds TabletToolHistory::averageLatency() const
+{
+    if (m_count == 0) {
+        return std::chrono::microseconds::zero();
+    }
+    std::chrono::microseconds sum = std::chrono::microseconds::zero();
+    for (int i = 0; i < m_count; ++i) {
+        sum += sample(i).latency;
+    }
+    return sum / m_count;
+}
+
+std::chrono::microseconds TabletToolHistory::maximumLatency() const
+{
+    std::chrono::microseconds maximum = std::chrono::microseconds::zero();
+    for (int i = 0; i < m_count; ++i) {
+        maximum = std::max(maximum, sample(i).latency);
+    }
+    return maximum;
+}
+
+} // namespace KWin
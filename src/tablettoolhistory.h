@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QPointF>
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace KWin
+{
+
+/**
+ * The TabletToolHistory keeps the most recent samples of a tablet tool in a ring buffer.
+ *
+ * Besides the position and pressure, each sample records how long it took from the kernel
+ * generating the event to KWin sending it to the client, which makes the latency of the pen
+ * measurable. The samples are also used to extrapolate where the tool is going to be.
+ */
+class KWIN_EXPORT TabletToolHistory
+{
+public:
+    struct Sample
+    {
+        QPointF position;
+        qreal pressure = 0;
+        // the 32 bit millisecond timestamp of the event
+        quint32 timestamp = 0;
+        // the time between the event and its delivery to the client
+        std::chrono::microseconds latency = std::chrono::microseconds::zero();
+    };
+
+    static constexpr int s_capacity = 64;
+
+    void addSample(const Sample &sample);
+    void clear();
+
+    int count() const;
+    /**
+     * Returns the sample at @a index, 0 being the most recent one.
+     */
+    const Sample &sample(int index) const;
+
+    /**
+     * Extrapolates the position of the tool @a ahead from the most recent sample, from the
+     * velocity over the last few samples. Returns @c std::nullopt if there isn't enough data.
+     */
+    std::optional<QPointF> predictPosition(std::chrono::milliseconds ahead) const;
+
+    std::chrono::microseconds averageLatency() const;
+    std::chrono::microseconds maximumLatency() const;
+
+private:
+    std::array<Sample, s_capacity> m_samples;
+    int m_head = 0;
+    int m_count = 0;
+};
+
+} // namespace KWin
@@ -145,7 +145,7 @@ void TouchInputRedirection::processDown(qint32 id, const QPointF &pos, quint32 t
     }
     input()->setLastInputHandler(this);
     input()->processSpies(std::bind(&InputEventSpy::touchDown, std::placeholders::_1, id, pos, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchDown, std::placeholders::_1, id, pos, time));
+    input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchDown, std::placeholders::_1, id, pos, time));
     m_windowUpdatedInCycle = false;
 }
 
@@ -161,7 +161,7 @@ void TouchInputRedirection::processUp(qint32 id, quint32 time, InputDevice *devi
     input()->setLastInputHandler(this);
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchUp, std::placeholders::_1, id, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchUp, std::placeholders::_1, id, time));
+    input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchUp, std::placeholders::_1, id, time));
     m_windowUpdatedInCycle = false;
     if (m_activeTouchPoints.count() == 0) {
         update();
@@ -181,7 +181,7 @@ void TouchInputRedirection::processMotion(qint32 id, const QPointF &pos, quint32
     m_lastPosition = pos;
     m_windowUpdatedInCycle = false;
     input()->processSpies(std::bind(&InputEventSpy::touchMotion, std::placeholders::_1, id, pos, time));
-    input()->processFilters(std::bind(&InputEventFilter::touchMotion, std::placeholders::_1, id, pos, time));
+    input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchMotion, std::placeholders::_1, id, pos, time));
     m_windowUpdatedInCycle = false;
 }
 
@@ -196,7 +196,7 @@ void TouchInputRedirection::cancel()
     // the compositor will not receive any TOUCH_MOTION or TOUCH_UP events for that slot.
     if (!m_activeTouchPoints.isEmpty()) {
         m_activeTouchPoints.clear();
-        input()->processFilters(std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
+        input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
     }
 }
 
@@ -205,7 +205,7 @@ void TouchInputRedirection::frame()
     if (!inited() || !waylandServer()->seat()->hasTouch()) {
         return;
     }
-    input()->processFilters(std::bind(&InputEventFilter::touchFrame, std::placeholders::_1));
+    input()->processFilters(InputEventType::Touch, std::bind(&InputEventFilter::touchFrame, std::placeholders::_1));
 }
 
 }
@@ -0,0 +1,93 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "allocationtracker.h"
+
+#include <config-kwin.h>
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <cstring>
+
+#if KWIN_BUILD_ALLOCATION_TRACKING
+
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+}
+
+// The initial-exec model doesn't allocate on the first access, which would recurse into malloc().
+static thread_local quint64 s_allocationCount __attribute__((tls_model("initial-exec"))) = 0;
+
+extern "C" KWIN_EXPORT void *malloc(std::size_t size)
+{
+    ++s_allocationCount;
+    return __libc_malloc(size);
+}
+
+extern "C" KWIN_EXPORT void *calloc(std::size_t count, std::size_t size)
+{
+    ++s_allocationCount;
+    return __libc_calloc(count, size);
+}
+
+extern "C" KWIN_EXPORT void *realloc(void *ptr, std::size_t size)
+{
+    ++s_allocationCount;
+    return __libc_realloc(ptr, size);
+}
+
+#endif
+
+namespace KWin
+{
+
+static AllocationTracker::Phase s_phases[AllocationTracker::maximumPhaseCount];
+static int s_phaseCount = 0;
+
+bool AllocationTracker::isAvailable()
+{
+    return KWIN_BUILD_ALLOCATION_TRACKING;
+}
+
+quint64 AllocationTracker::allocationCount()
+{
+#if KWIN_BUILD_ALLOCATION_TRACKING
+    return s_allocationCount;
+#else
+    return 0;
+#endif
+}
+
+QVector<AllocationTracker::Phase> AllocationTracker::phases()
+{
+    return QVector<Phase>(s_phases, s_phases + s_phaseCount);
+}
+
+void AllocationTracker::reset()
+{
+    s_phaseCount = 0;
+}
+
+void AllocationTracker::recordPhase(const char *name, quint64 allocations)
+{
+    if (!isAvailable() || QThread::currentThread() != QCoreApplication::instance()->thread()) {
+        return;
+    }
+    // A linear search over a static array, so recording doesn't allocate itself.
+    for (int i = 0; i < s_phaseCount; ++i) {
+        if (s_phases[i].name == name || std::strcmp(s_phases[i].name, name) == 0) {
+            s_phases[i].calls++;
+            s_phases[i].allocations += allocations;
+            return;
+        }
+    }
+    if (s_phaseCount < maximumPhaseCount) {
+        s_phases[s_phaseCount++] = Phase{name, 1, allocations};
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,78 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QVector>
+
+#include <cstddef>
+
+namespace KWin
+{
+
+/**
+ * The AllocationTracker class counts the heap allocations of the compositor, to track how many
+ * allocations a frame takes and in which phase they are made.
+ *
+ * It's only available if KWin is built with the KWIN_BUILD_ALLOCATION_TRACKING option, which
+ * interposes malloc(), calloc() and realloc(); this needs glibc. Otherwise nothing is counted.
+ *
+ * The phases are the fTraceDuration() scopes; the allocations of a nested scope are counted
+ * in the enclosing scopes too. Phases are only recorded on the compositor thread.
+ */
+class KWIN_EXPORT AllocationTracker
+{
+public:
+    struct Phase
+    {
+        // the first argument of fTraceDuration(), e.g. "Paint ("
+        const char *name = nullptr;
+        quint64 calls = 0;
+        quint64 allocations = 0;
+    };
+
+    static bool isAvailable();
+    /**
+     * Returns the number of allocations the calling thread has made so far.
+     */
+    static quint64 allocationCount();
+    /**
+     * Returns the phases that have been recorded since the last reset().
+     */
+    static QVector<Phase> phases();
+    static void reset();
+
+    static void recordPhase(const char *name, quint64 allocations);
+
+    /**
+     * The maximum number of phases that are recorded, later ones are dropped.
+     */
+    static constexpr int maximumPhaseCount = 32;
+};
+
+/**
+ * Attributes the allocations made until the scope ends to the phase @a name.
+ */
+class KWIN_EXPORT AllocationScope
+{
+public:
+    template<std::size_t N, typename... Args>
+    explicit AllocationScope(const char (&name)[N], const Args &...)
+        : m_name(name)
+        , m_start(AllocationTracker::allocationCount())
+    {
+    }
+    ~AllocationScope()
+    {
+        AllocationTracker::recordPhase(m_name, AllocationTracker::allocationCount() - m_start);
+    }
+
+private:
+    const char *m_name;
+    quint64 m_start;
+};
+
+} // namespace KWin
@@ -7,15 +7,22 @@
 #pragma once
 
 #include "kwin_export.h"
+#include "region.h"
 
-#include <QList>
 #include <QRegion>
 
+#include <algorithm>
+#include <vector>
+
 namespace KWin
 {
 
 /**
  * The DamageJournal class is a helper that tracks last N damage regions.
+ *
+ * The regions are stored in a ring buffer. The journal also keeps the unions of the most
+ * recent regions for every buffer age that has been asked for, and updates them as new
+ * regions are added, so accumulate() doesn't need to unite the regions over and over again.
  */
 class KWIN_EXPORT DamageJournal
 {
@@ -25,7 +32,7 @@ public:
      */
     int capacity() const
     {
-        return m_capacity;
+        return m_log.size();
     }
 
     /**
@@ -34,7 +41,15 @@ public:
      */
     void setCapacity(int capacity)
     {
-        m_capacity = capacity;
+        std::vector<Region> log(capacity);
+        const int count = std::min(m_count, capacity);
+        for (int i = 0; i < count; ++i) {
+            log[count - 1 - i] = at(i);
+        }
+        m_log = std::move(log);
+        m_head = count - 1;
+        m_count = count;
+        m_unions.clear();
     }
 
     /**
@@ -42,10 +57,23 @@ public:
      */
     void add(const QRegion &region)
     {
-        while (m_log.size() >= m_capacity) {
-            m_log.takeLast();
+        if (m_log.empty()) {
+            return;
+        }
+        m_head = (m_head + 1) % m_log.size();
+        m_log[m_head] = Region(region);
+        m_count = std::min<int>(m_count + 1, m_log.size());
+
+        // m_unions[i] is the union of the i + 1 most recent regions.
+        if (m_unions.size() > size_t(m_count)) {
+            m_unions.resize(m_count);
+        }
+        for (int i = int(m_unions.size()) - 1; i > 0; --i) {
+            m_unions[i] = m_unions[i - 1] | m_log[m_head];
+        }
+        if (!m_unions.empty()) {
+            m_unions[0] = m_log[m_head];
         }
-        m_log.prepend(region);
     }
 
     /**
@@ -54,7 +82,8 @@ public:
      */
     void clear()
     {
-        m_log.clear();
+        m_count = 0;
+        m_unions.clear();
     }
 
     /**
@@ -65,25 +94,39 @@ public:
      */
     QRegion accumulate(int bufferAge, const QRegion &fallback = QRegion()) const
     {
-        QRegion region;
-        if (bufferAge > 0 && bufferAge <= m_log.size()) {
-            for (int i = 0; i < bufferAge - 1; ++i) {
-                region |= m_log[i];
-            }
-        } else {
-            region = fallback;
+        if (bufferAge <= 0 || bufferAge > m_count) {
+            return fallback;
+        }
+        const int depth = bufferAge - 1;
+        if (depth == 0) {
+            return QRegion();
         }
-        return region;
+        while (m_unions.size() < size_t(depth)) {
+            const int i = m_unions.size();
+            m_unions.push_back(i == 0 ? at(0) : m_unions[i - 1] | at(i));
+        }
+        return m_unions[depth - 1].toQRegion();
     }
 
     QRegion lastDamage() const
     {
-        return m_log.first();
+        return m_count ? at(0).toQRegion() : QRegion();
     }
 
 private:
-    QList<QRegion> m_log;
-    int m_capacity = 10;
+    /**
+     * Returns the region added @a index regions before the most recent one.
+     */
+    const Region &at(int index) const
+    {
+        const int size = m_log.size();
+        return m_log[(m_head - index + size) % size];
+    }
+
+    std::vector<Region> m_log = std::vector<Region>(10);
+    mutable std::vector<Region> m_unions;
+    int m_head = -1;
+    int m_count = 0;
 };
 
 } // namespace KWin
@@ -0,0 +1,165 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "damagesimplifier.h"
+
+#include <QVector>
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static const int s_defaultMaximumRectCount = 16;
+static const qreal s_defaultMinimumEfficiency = 0.5;
+static const int s_tileSize = 64;
+static const int s_maximumTileCount = 1 << 16;
+
+static quint64 regionArea(const QRegion &region)
+{
+    quint64 area = 0;
+    for (const QRect &rect : region) {
+        area += quint64(rect.width()) * rect.height();
+    }
+    return area;
+}
+
+static int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+/**
+ * Returns the tiles of a s_tileSize grid that intersect the given @a region, clipped to
+ * the bounding rect of the region. If the region spans too many tiles, the bounding rect
+ * is returned instead.
+ */
+static QRegion snapToTiles(const QRegion &region)
+{
+    const QRect bounds = region.boundingRect();
+    const int left = floorDiv(bounds.left(), s_tileSize);
+    const int top = floorDiv(bounds.top(), s_tileSize);
+    const int columns = floorDiv(bounds.right(), s_tileSize) - left + 1;
+    const int rows = floorDiv(bounds.bottom(), s_tileSize) - top + 1;
+    if (qint64(columns) * rows > s_maximumTileCount) {
+        return bounds;
+    }
+
+    QVector<bool> tiles(columns * rows, false);
+    for (const QRect &rect : region) {
+        const int x0 = floorDiv(rect.left(), s_tileSize) - left;
+        const int x1 = floorDiv(rect.right(), s_tileSize) - left;
+        const int y0 = floorDiv(rect.top(), s_tileSize) - top;
+        const int y1 = floorDiv(rect.bottom(), s_tileSize) - top;
+        for (int y = y0; y <= y1; ++y) {
+            std::fill(tiles.begin() + y * columns + x0, tiles.begin() + y * columns + x1 + 1, true);
+        }
+    }
+
+    QRegion snapped;
+    for (int y = 0; y < rows; ++y) {
+        int x = 0;
+        while (x < columns) {
+            if (!tiles[y * columns + x]) {
+                ++x;
+                continue;
+            }
+            const int start = x;
+            while (x < columns && tiles[y * columns + x]) {
+                ++x;
+            }
+            snapped += QRect((left + start) * s_tileSize, (top + y) * s_tileSize, (x - start) * s_tileSize, s_tileSize);
+        }
+    }
+    return snapped & bounds;
+}
+
+DamageSimplifier::DamageSimplifier()
+    : m_maximumRectCount(s_defaultMaximumRectCount)
+    , m_minimumEfficiency(s_defaultMinimumEfficiency)
+{
+    bool ok = false;
+    const int maximumRectCount = qEnvironmentVariableIntValue("KWIN_DAMAGE_SIMPLIFY_MAX_RECTS", &ok);
+    if (ok) {
+        m_maximumRectCount = maximumRectCount;
+    }
+    const int minimumEfficiency = qEnvironmentVariableIntValue("KWIN_DAMAGE_SIMPLIFY_MIN_EFFICIENCY", &ok);
+    if (ok) {
+        m_minimumEfficiency = std::clamp(minimumEfficiency, 0, 100) / 100.0;
+    }
+}
+
+int DamageSimplifier::maximumRectCount() const
+{
+    return m_maximumRectCount;
+}
+
+void DamageSimplifier::setMaximumRectCount(int count)
+{
+    m_maximumRectCount = count;
+}
+
+qreal DamageSimplifier::minimumEfficiency() const
+{
+    return m_minimumEfficiency;
+}
+
+void DamageSimplifier::setMinimumEfficiency(qreal efficiency)
+{
+    m_minimumEfficiency = efficiency;
+}
+
+QRegion DamageSimplifier::simplify(const QRegion &region)
+{
+    m_statistics.regions++;
+    if (m_maximumRectCount <= 0 || region.rectCount() <= m_maximumRectCount) {
+        return region;
+    }
+
+    const QRect bounds = region.boundingRect();
+    const quint64 area = regionArea(region);
+    const quint64 boundsArea = quint64(bounds.width()) * bounds.height();
+
+    QRegion simplified;
+    if (area >= m_minimumEfficiency * boundsArea) {
+        simplified = bounds;
+    } else {
+        simplified = snapToTiles(region);
+        if (simplified.rectCount() > m_maximumRectCount) {
+            simplified = bounds;
+        }
+    }
+
+    m_statistics.simplifiedRegions++;
+    m_statistics.inputRects += region.rectCount();
+    m_statistics.outputRects += simplified.rectCount();
+    m_statistics.inputArea += area;
+    m_statistics.outputArea += regionArea(simplified);
+
+    return simplified;
+}
+
+const DamageSimplifier::Statistics &DamageSimplifier::statistics() const
+{
+    return m_statistics;
+}
+
+void DamageSimplifier::resetStatistics()
+{
+    m_statistics = Statistics();
+}
+
+DamageSimplifier *DamageSimplifier::surfaceDamage()
+{
+    static DamageSimplifier simplifier;
+    return &simplifier;
+}
+
+DamageSimplifier *DamageSimplifier::outputDamage()
+{
+    static DamageSimplifier simplifier;
+    return &simplifier;
+}
+
+} // namespace KWin
@@ -0,0 +1,81 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QRegion>
+
+namespace KWin
+{
+
+/**
+ * The DamageSimplifier class reduces the number of rectangles in damage regions.
+ *
+ * Regions with many small rectangles, e.g. produced by blinking text cursors or spinners,
+ * are expensive to carry around and end up as many scissored draw calls. If a region has
+ * more rectangles than maximumRectCount(), it is replaced either by its bounding rectangle,
+ * if the rectangles cover at least minimumEfficiency() of it, or by the tiles of a coarse
+ * grid that the rectangles touch.
+ *
+ * The maximum rectangle count can be overridden with the KWIN_DAMAGE_SIMPLIFY_MAX_RECTS
+ * environment variable, zero disables the simplification. The minimum efficiency can be
+ * overridden with KWIN_DAMAGE_SIMPLIFY_MIN_EFFICIENCY, in percent.
+ */
+class KWIN_EXPORT DamageSimplifier
+{
+public:
+    struct Statistics
+    {
+        /**
+         * The number of regions passed to simplify().
+         */
+        quint64 regions = 0;
+        /**
+         * The number of regions that actually had to be simplified.
+         */
+        quint64 simplifiedRegions = 0;
+        /**
+         * The number of rectangles in the simplified regions before and after simplification.
+         */
+        quint64 inputRects = 0;
+        quint64 outputRects = 0;
+        /**
+         * The area of the simplified regions before and after simplification. The difference
+         * is the area that is painted needlessly.
+         */
+        quint64 inputArea = 0;
+        quint64 outputArea = 0;
+    };
+
+    DamageSimplifier();
+
+    int maximumRectCount() const;
+    void setMaximumRectCount(int count);
+
+    qreal minimumEfficiency() const;
+    void setMinimumEfficiency(qreal efficiency);
+
+    QRegion simplify(const QRegion &region);
+
+    const Statistics &statistics() const;
+    void resetStatistics();
+
+    /**
+     * The simplifier applied to the damage that clients commit for their surfaces.
+     */
+    static DamageSimplifier *surfaceDamage();
+    /**
+     * The simplifier applied to the damage of output frames.
+     */
+    static DamageSimplifier *outputDamage();
+
+private:
+    int m_maximumRectCount;
+    qreal m_minimumEfficiency;
+    Statistics m_statistics;
+};
+
+} // namespace KWin
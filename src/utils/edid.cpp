@@ -12,10 +12,13 @@
 #include "config-kwin.h"
 
 #include <QFile>
+#include <QHash>
 #include <QStandardPaths>
 
 #include <KLocalizedString>
 
+#include <tuple>
+
 namespace KWin
 {
 
@@ -133,22 +136,58 @@ static QByteArray parseSerialNumber(const uint8_t *data)
     return QByteArray();
 }
 
+static std::pair<int, int> parseVerticalRateRange(const uint8_t *data)
+{
+    for (int i = 54; i <= 108; i += 18) {
+        // Skip the block if it isn't used as monitor descriptor.
+        if (data[i]) {
+            continue;
+        }
+        if (data[i + 1]) {
+            continue;
+        }
+
+        // We have found the display range limits, the rates are stored in Hz, with an offset
+        // of 255 Hz if the corresponding flag is set.
+        if (data[i + 3] == 0xfd) {
+            const int minimum = data[i + 5] + ((data[i + 4] & 0x1) ? 255 : 0);
+            const int maximum = data[i + 6] + ((data[i + 4] & 0x2) ? 255 : 0);
+            if (minimum > 0 && minimum <= maximum) {
+                return {minimum, maximum};
+            }
+            break;
+        }
+    }
+
+    return {0, 0};
+}
+
 static QByteArray parseVendor(const uint8_t *data)
 {
     const auto pnpId = parsePnpId(data);
 
+    // The lookup reads through the whole pnp.ids file, so it's only done once per vendor
+    // rather than on every hotplug.
+    static QHash<QByteArray, QByteArray> vendors;
+    if (const auto it = vendors.constFind(pnpId); it != vendors.constEnd()) {
+        return *it;
+    }
+
     // Map to vendor name
+    QByteArray vendor;
     QFile pnpFile(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("hwdata/pnp.ids")));
     if (pnpFile.exists() && pnpFile.open(QIODevice::ReadOnly)) {
         while (!pnpFile.atEnd()) {
             const auto line = pnpFile.readLine();
             if (line.startsWith(pnpId)) {
-                return line.mid(4).trimmed();
+                vendor = line.mid(4).trimmed();
+                break;
             }
         }
     }
 
-    return {};
+    vendors.insert(pnpId, vendor);
+    return vendor;
 }
 
 Edid::Edid()
@@ -175,6 +214,7 @@ Edid::Edid(const void *data, uint32_t size)
     m_monitorName = parseMonitorName(bytes);
     m_serialNumber = parseSerialNumber(bytes);
     m_vendor = parseVendor(bytes);
+    std::tie(m_minimumVerticalRate, m_maximumVerticalRate) = parseVerticalRateRange(bytes);
 
     m_isValid = true;
 }
@@ -204,6 +244,16 @@ QByteArray Edid::serialNumber() const
     return m_serialNumber;
 }
 
+int Edid::minimumVerticalRate() const
+{
+    return m_minimumVerticalRate;
+}
+
+int Edid::maximumVerticalRate() const
+{
+    return m_maximumVerticalRate;
+}
+
 QByteArray Edid::vendor() const
 {
     return m_vendor;
@@ -58,6 +58,18 @@ public:
      */
     QByteArray vendor() const;
 
+    /**
+     * Returns the lowest vertical refresh rate the monitor supports, in Hz, or 0 if the
+     * monitor doesn't advertise its range limits.
+     */
+    int minimumVerticalRate() const;
+
+    /**
+     * Returns the highest vertical refresh rate the monitor supports, in Hz, or 0 if the
+     * monitor doesn't advertise its range limits.
+     */
+    int maximumVerticalRate() const;
+
     /**
      * Returns the raw edid
      */
@@ -80,6 +92,8 @@ private:
     QByteArray m_eisaId;
     QByteArray m_monitorName;
     QByteArray m_serialNumber;
+    int m_minimumVerticalRate = 0;
+    int m_maximumVerticalRate = 0;
 
     QByteArray m_raw;
     bool m_isValid = false;
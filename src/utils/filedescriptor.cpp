@@ -8,6 +8,7 @@
 */
 #include "filedescriptor.h"
 
+#include <poll.h>
 #include <unistd.h>
 #include <utility>
 
@@ -58,4 +59,14 @@ FileDescriptor FileDescriptor::duplicate() const
         return {};
     }
 }
+
+bool FileDescriptor::isReadable() const
+{
+    pollfd fd = {
+        .fd = m_fd,
+        .events = POLLIN,
+        .revents = 0,
+    };
+    return ::poll(&fd, 1, 0) == 1 && (fd.revents & POLLIN);
+}
 }
@@ -26,6 +26,12 @@ public:
     int get() const;
     FileDescriptor duplicate() const;
 
+    /**
+     * Returns whether reading from the file descriptor wouldn't block, e.g. whether
+     * the fence of a sync file has been signaled.
+     */
+    bool isReadable() const;
+
 private:
     int m_fd = -1;
 };
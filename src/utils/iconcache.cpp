@@ -0,0 +1,118 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "iconcache.h"
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QImage>
+
+namespace KWin
+{
+
+struct IconCacheEntry
+{
+    QIcon icon;
+    QByteArray payload;
+    int users = 0;
+};
+
+struct IconCacheData
+{
+    QHash<QByteArray, IconCacheEntry> entries;
+    // from QIcon::cacheKey(), which is shared by the copies of an icon, to the key of its entry
+    QHash<qint64, QByteArray> keys;
+};
+
+static IconCacheData &cache()
+{
+    static IconCacheData data;
+    return data;
+}
+
+static QByteArray contentKey(const QIcon &icon)
+{
+    if (!icon.name().isEmpty()) {
+        return QByteArrayLiteral("name:") + icon.name().toUtf8();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const auto sizes = icon.availableSizes();
+    for (const QSize &size : sizes) {
+        const QImage image = icon.pixmap(size).toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        const int dimensions[] = {image.width(), image.height()};
+        hash.addData(reinterpret_cast<const char *>(dimensions), sizeof(dimensions));
+        for (int y = 0; y < image.height(); ++y) {
+            hash.addData(reinterpret_cast<const char *>(image.constScanLine(y)), image.width() * 4);
+        }
+    }
+    return QByteArrayLiteral("pixels:") + hash.result();
+}
+
+QIcon IconCache::acquire(const QIcon &icon)
+{
+    if (icon.isNull()) {
+        return icon;
+    }
+
+    IconCacheData &data = cache();
+    auto keyIt = data.keys.constFind(icon.cacheKey());
+    const QByteArray key = keyIt != data.keys.constEnd() ? *keyIt : contentKey(icon);
+
+    auto it = data.entries.find(key);
+    if (it == data.entries.end()) {
+        it = data.entries.insert(key, IconCacheEntry{icon});
+        data.keys.insert(icon.cacheKey(), key);
+    }
+    it->users++;
+    return it->icon;
+}
+
+void IconCache::release(const QIcon &icon)
+{
+    if (icon.isNull()) {
+        return;
+    }
+
+    IconCacheData &data = cache();
+    const auto keyIt = data.keys.find(icon.cacheKey());
+    if (keyIt == data.keys.end()) {
+        return;
+    }
+    const auto it = data.entries.find(*keyIt);
+    if (it != data.entries.end() && --it->users > 0) {
+        return;
+    }
+    if (it != data.entries.end()) {
+        data.entries.erase(it);
+    }
+    data.keys.erase(keyIt);
+}
+
+QByteArray IconCache::payload(const QIcon &icon)
+{
+    const IconCacheData &data = cache();
+    const QByteArray key = data.keys.value(icon.cacheKey());
+    return key.isNull() ? QByteArray() : data.entries.value(key).payload;
+}
+
+void IconCache::setPayload(const QIcon &icon, const QByteArray &payload)
+{
+    IconCacheData &data = cache();
+    const auto keyIt = data.keys.constFind(icon.cacheKey());
+    if (keyIt == data.keys.constEnd()) {
+        return;
+    }
+    const auto it = data.entries.find(*keyIt);
+    if (it != data.entries.end()) {
+        it->payload = payload;
+    }
+}
+
+int IconCache::count()
+{
+    return cache().entries.count();
+}
+
+} // namespace KWin
@@ -0,0 +1,51 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QByteArray>
+#include <QIcon>
+
+namespace KWin
+{
+
+/**
+ * The IconCache class shares the icons of windows that look the same, e.g. the icons of the
+ * windows of one application, so each of them is kept in memory and encoded for the plasma
+ * window management clients only once.
+ *
+ * Icons are matched by their content: themed icons by their name, other icons by the pixels of
+ * all their sizes. An icon stays in the cache while it's acquired at least once.
+ *
+ * The cache is only used on the main thread.
+ */
+class KWIN_EXPORT IconCache
+{
+public:
+    /**
+     * Returns an icon that looks like @a icon and shares its data with the other acquired icons
+     * that look the same. Every acquired icon must be released with release().
+     */
+    static QIcon acquire(const QIcon &icon);
+    static void release(const QIcon &icon);
+
+    /**
+     * Returns @a icon serialized with QDataStream, as sent to the plasma window management
+     * clients, or an empty byte array if @a icon hasn't been acquired or not encoded yet.
+     */
+    static QByteArray payload(const QIcon &icon);
+    /**
+     * Stores the serialized @a payload of @a icon, if it's still acquired.
+     */
+    static void setPayload(const QIcon &icon, const QByteArray &payload);
+
+    /**
+     * Returns the number of distinct icons in the cache.
+     */
+    static int count();
+};
+
+} // namespace KWin
@@ -0,0 +1,348 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "region.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+/**
+ * Stores the parts of @a rect that are outside @a hole in @a out, and returns their number,
+ * zero to four.
+ */
+static int subtractRect(const QRect &rect, const QRect &hole, QRect *out)
+{
+    if (!rect.intersects(hole)) {
+        out[0] = rect;
+        return 1;
+    }
+
+    const int left = rect.x();
+    const int top = rect.y();
+    const int right = rect.x() + rect.width();
+    const int bottom = rect.y() + rect.height();
+    const int holeLeft = std::max(left, hole.x());
+    const int holeTop = std::max(top, hole.y());
+    const int holeRight = std::min(right, hole.x() + hole.width());
+    const int holeBottom = std::min(bottom, hole.y() + hole.height());
+
+    int count = 0;
+    if (holeTop > top) {
+        out[count++] = QRect(left, top, right - left, holeTop - top);
+    }
+    if (bottom > holeBottom) {
+        out[count++] = QRect(left, holeBottom, right - left, bottom - holeBottom);
+    }
+    if (holeLeft > left) {
+        out[count++] = QRect(left, holeTop, holeLeft - left, holeBottom - holeTop);
+    }
+    if (right > holeRight) {
+        out[count++] = QRect(holeRight, holeTop, right - holeRight, holeBottom - holeTop);
+    }
+    return count;
+}
+
+Region::Region(const QRect &rect)
+{
+    if (!rect.isEmpty()) {
+        m_rects.append(rect);
+    }
+}
+
+Region::Region(const QRegion &region)
+{
+    setRegion(region);
+}
+
+void Region::setRegion(const QRegion &region)
+{
+    if (region.rectCount() <= inlineRectCount) {
+        m_rects.clear();
+        m_rects.append(region.begin(), region.rectCount());
+        m_region.reset();
+    } else {
+        m_rects.clear();
+        m_region = region;
+    }
+}
+
+bool Region::isEmpty() const
+{
+    return m_region ? m_region->isEmpty() : m_rects.isEmpty();
+}
+
+int Region::rectCount() const
+{
+    return m_region ? m_region->rectCount() : m_rects.count();
+}
+
+QRect Region::boundingRect() const
+{
+    if (m_region) {
+        return m_region->boundingRect();
+    }
+    QRect bounds;
+    for (const QRect &rect : m_rects) {
+        bounds |= rect;
+    }
+    return bounds;
+}
+
+bool Region::contains(const QPoint &point) const
+{
+    if (m_region) {
+        return m_region->contains(point);
+    }
+    return std::any_of(m_rects.begin(), m_rects.end(), [&point](const QRect &rect) {
+        return rect.contains(point);
+    });
+}
+
+bool Region::intersects(const QRect &rect) const
+{
+    if (m_region) {
+        return m_region->intersects(rect);
+    }
+    return std::any_of(m_rects.begin(), m_rects.end(), [&rect](const QRect &other) {
+        return other.intersects(rect);
+    });
+}
+
+const QRect *Region::begin() const
+{
+    return m_region ? m_region->begin() : m_rects.constData();
+}
+
+const QRect *Region::end() const
+{
+    return m_region ? m_region->end() : m_rects.constData() + m_rects.count();
+}
+
+void Region::unite(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    if (m_region) {
+        *m_region += rect;
+        return;
+    }
+
+    // Only the parts of the rectangle that aren't in the region yet are added.
+    QVarLengthArray<QRect, 16> pieces{rect};
+    for (const QRect &existing : qAsConst(m_rects)) {
+        QVarLengthArray<QRect, 16> remaining;
+        for (const QRect &piece : qAsConst(pieces)) {
+            QRect parts[4];
+            remaining.append(parts, subtractRect(piece, existing, parts));
+        }
+        if (remaining.isEmpty()) {
+            return;
+        }
+        pieces = remaining;
+    }
+
+    if (m_rects.count() + pieces.count() > inlineRectCount) {
+        QRegion region = toQRegion();
+        region += rect;
+        setRegion(region);
+    } else {
+        m_rects.append(pieces.constData(), pieces.count());
+    }
+}
+
+void Region::intersect(const QRect &rect)
+{
+    if (m_region) {
+        setRegion(*m_region & rect);
+        return;
+    }
+    int count = 0;
+    for (const QRect &existing : qAsConst(m_rects)) {
+        const QRect intersection = existing & rect;
+        if (!intersection.isEmpty()) {
+            m_rects[count++] = intersection;
+        }
+    }
+    m_rects.resize(count);
+}
+
+void Region::subtract(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    if (m_region) {
+        setRegion(*m_region - rect);
+        return;
+    }
+
+    QVarLengthArray<QRect, 16> remaining;
+    for (const QRect &existing : qAsConst(m_rects)) {
+        QRect parts[4];
+        remaining.append(parts, subtractRect(existing, rect, parts));
+    }
+    if (remaining.count() > inlineRectCount) {
+        setRegion(toQRegion() - rect);
+    } else {
+        m_rects.clear();
+        m_rects.append(remaining.constData(), remaining.count());
+    }
+}
+
+Region Region::united(const QRect &rect) const
+{
+    Region result = *this;
+    result.unite(rect);
+    return result;
+}
+
+Region Region::united(const Region &other) const
+{
+    if (m_region || other.m_region) {
+        return Region(toQRegion() | other.toQRegion());
+    }
+    Region result = *this;
+    for (const QRect &rect : other) {
+        result.unite(rect);
+    }
+    return result;
+}
+
+Region Region::intersected(const QRect &rect) const
+{
+    Region result = *this;
+    result.intersect(rect);
+    return result;
+}
+
+Region Region::intersected(const Region &other) const
+{
+    if (m_region || other.m_region) {
+        return Region(toQRegion() & other.toQRegion());
+    }
+    // The rectangles of either region don't overlap, neither do their intersections.
+    Region result;
+    for (const QRect &rect : m_rects) {
+        for (const QRect &otherRect : other.m_rects) {
+            const QRect intersection = rect & otherRect;
+            if (intersection.isEmpty()) {
+                continue;
+            }
+            if (result.m_rects.count() == inlineRectCount) {
+                return Region(toQRegion() & other.toQRegion());
+            }
+            result.m_rects.append(intersection);
+        }
+    }
+    return result;
+}
+
+Region Region::subtracted(const QRect &rect) const
+{
+    Region result = *this;
+    result.subtract(rect);
+    return result;
+}
+
+Region Region::subtracted(const Region &other) const
+{
+    if (other.m_region) {
+        return Region(toQRegion() - *other.m_region);
+    }
+    Region result = *this;
+    for (const QRect &rect : other.m_rects) {
+        result.subtract(rect);
+    }
+    return result;
+}
+
+Region Region::translated(const QPoint &offset) const
+{
+    Region result;
+    if (m_region) {
+        result.m_region = m_region->translated(offset);
+    } else {
+        for (const QRect &rect : m_rects) {
+            result.m_rects.append(rect.translated(offset));
+        }
+    }
+    return result;
+}
+
+QRegion Region::toQRegion() const
+{
+    if (m_region) {
+        return *m_region;
+    }
+    if (m_rects.count() == 1) {
+        return QRegion(m_rects.constFirst());
+    }
+    QRegion region;
+    for (const QRect &rect : m_rects) {
+        region += rect;
+    }
+    return region;
+}
+
+Region &Region::operator|=(const Region &other)
+{
+    *this = united(other);
+    return *this;
+}
+
+Region &Region::operator+=(const Region &other)
+{
+    return *this |= other;
+}
+
+Region &Region::operator&=(const Region &other)
+{
+    *this = intersected(other);
+    return *this;
+}
+
+Region &Region::operator-=(const Region &other)
+{
+    *this = subtracted(other);
+    return *this;
+}
+
+Region Region::operator|(const Region &other) const
+{
+    return united(other);
+}
+
+Region Region::operator+(const Region &other) const
+{
+    return united(other);
+}
+
+Region Region::operator&(const Region &other) const
+{
+    return intersected(other);
+}
+
+Region Region::operator-(const Region &other) const
+{
+    return subtracted(other);
+}
+
+bool Region::operator==(const Region &other) const
+{
+    if (!m_region && !other.m_region && m_rects.count() == other.m_rects.count()
+        && std::equal(m_rects.begin(), m_rects.end(), other.m_rects.begin())) {
+        return true;
+    }
+    return toQRegion() == other.toQRegion();
+}
+
+bool Region::operator!=(const Region &other) const
+{
+    return !(*this == other);
+}
+
+} // namespace KWin
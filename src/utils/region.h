@@ -0,0 +1,89 @@
+/*
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QRegion>
+#include <QVarLengthArray>
+
+#include <optional>
+
+namespace KWin
+{
+
+/**
+ * The Region class is a set of non-overlapping rectangles, like QRegion, for the paths that
+ * combine regions every frame, e.g. repaint and damage tracking.
+ *
+ * Most of the regions there consist of one or a few rectangles. Up to four rectangles are
+ * stored inline and combined with plain rectangle arithmetic, without the heap allocations
+ * and the band rebuilding of QRegion. Regions with more rectangles are stored as a QRegion.
+ *
+ * Unlike QRegion, the rectangles of a small region aren't merged into bands, so the same set
+ * of points can be made of different rectangles. Regions are compared by the points they cover.
+ *
+ * QRegion stays the type of the public interfaces, regions are converted at their boundary
+ * with the Region(const QRegion &) constructor and toQRegion().
+ */
+class KWIN_EXPORT Region
+{
+public:
+    Region() = default;
+    Region(const QRect &rect);
+    explicit Region(const QRegion &region);
+
+    bool isEmpty() const;
+    int rectCount() const;
+    QRect boundingRect() const;
+    bool contains(const QPoint &point) const;
+    bool intersects(const QRect &rect) const;
+
+    /**
+     * The rectangles of the region. They don't overlap, but they aren't sorted.
+     */
+    const QRect *begin() const;
+    const QRect *end() const;
+
+    Region united(const QRect &rect) const;
+    Region united(const Region &other) const;
+    Region intersected(const QRect &rect) const;
+    Region intersected(const Region &other) const;
+    Region subtracted(const QRect &rect) const;
+    Region subtracted(const Region &other) const;
+    Region translated(const QPoint &offset) const;
+
+    QRegion toQRegion() const;
+
+    Region &operator|=(const Region &other);
+    Region &operator+=(const Region &other);
+    Region &operator&=(const Region &other);
+    Region &operator-=(const Region &other);
+
+    Region operator|(const Region &other) const;
+    Region operator+(const Region &other) const;
+    Region operator&(const Region &other) const;
+    Region operator-(const Region &other) const;
+
+    bool operator==(const Region &other) const;
+    bool operator!=(const Region &other) const;
+
+    /**
+     * The maximum number of rectangles that are stored without allocating memory.
+     */
+    static constexpr int inlineRectCount = 4;
+
+private:
+    void unite(const QRect &rect);
+    void intersect(const QRect &rect);
+    void subtract(const QRect &rect);
+    void setRegion(const QRegion &region);
+
+    QVarLengthArray<QRect, inlineRectCount> m_rects;
+    // Holds the region instead of m_rects when it has more than inlineRectCount rectangles.
+    std::optional<QRegion> m_region;
+};
+
+} // namespace KWin
@@ -0,0 +1,97 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace KWin
+{
+
+/**
+ * The SpscQueue class is a bounded lock-free queue for handing values from one thread to
+ * another. All slots are allocated up front, push() and pop() never allocate memory.
+ *
+ * Only a single thread may push values, and only a single (other) thread may peek and pop.
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : m_slots(capacity + 1)
+    {
+    }
+
+    size_t capacity() const
+    {
+        return m_slots.size() - 1;
+    }
+
+    /**
+     * Appends @a value to the queue. Returns @c false if the queue is full. Producer only.
+     */
+    bool push(const T &value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if (next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_slots[tail] = value;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns a pointer to the oldest value without removing it, or @c nullptr if the queue
+     * is empty. The pointer stays valid until pop() is called. Consumer only.
+     */
+    T *front()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head];
+    }
+
+    /**
+     * Removes and returns the oldest value, if any. Consumer only.
+     */
+    std::optional<T> pop()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        T value = std::move(m_slots[head]);
+        m_head.store(increment(head), std::memory_order_release);
+        return value;
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    size_t increment(size_t index) const
+    {
+        return index + 1 == m_slots.size() ? 0 : index + 1;
+    }
+
+    std::vector<T> m_slots;
+    // keep the indices on separate cache lines, so the two threads don't keep stealing them from each other
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+} // namespace KWin
@@ -17,6 +17,10 @@
 #include <QStack>
 #include <QStandardPaths>
 
+#include <map>
+#include <memory>
+#include <tuple>
+
 namespace KWin
 {
 
@@ -28,13 +32,37 @@ public:
     std::chrono::milliseconds delay;
 };
 
+/**
+ * The decoded cursor files, shared by all themes, so that e.g. the pointer, tablet and drag
+ * cursors on outputs with the same scale decode a cursor only once. Cursor files are keyed
+ * by their canonical path, which also covers the aliases of a shape and inherited themes.
+ */
+class KXcursorSpriteCache
+{
+public:
+    /**
+     * Returns the cache, which lives as long as there are themes using it.
+     */
+    static std::shared_ptr<KXcursorSpriteCache> instance();
+
+    QVector<KXcursorSprite> sprites(const QString &filePath, int size, qreal devicePixelRatio);
+
+private:
+    std::map<std::tuple<QString, int, qreal>, QVector<KXcursorSprite>> m_sprites;
+};
+
 class KXcursorThemePrivate : public QSharedData
 {
 public:
     void load(const QString &themeName, int size, qreal devicePixelRatio);
-    void loadCursors(const QString &packagePath, int size, qreal devicePixelRatio);
-
-    QHash<QByteArray, QVector<KXcursorSprite>> registry;
+    void loadCursors(const QString &packagePath);
+
+    int size = 0;
+    qreal devicePixelRatio = 1;
+    std::shared_ptr<KXcursorSpriteCache> cache;
+    // The cursor files of every shape, in the order they're tried. A shape is only decoded
+    // when it's used for the first time.
+    QHash<QByteArray, QStringList> files;
 };
 
 KXcursorSprite::KXcursorSprite()
@@ -106,32 +134,38 @@ static QVector<KXcursorSprite> loadCursor(const QString &filePath, int desiredSi
     return sprites;
 }
 
-void KXcursorThemePrivate::loadCursors(const QString &packagePath, int size, qreal devicePixelRatio)
+std::shared_ptr<KXcursorSpriteCache> KXcursorSpriteCache::instance()
+{
+    static std::weak_ptr<KXcursorSpriteCache> cache;
+    std::shared_ptr<KXcursorSpriteCache> instance = cache.lock();
+    if (!instance) {
+        instance = std::make_shared<KXcursorSpriteCache>();
+        cache = instance;
+    }
+    return instance;
+}
+
+QVector<KXcursorSprite> KXcursorSpriteCache::sprites(const QString &filePath, int size, qreal devicePixelRatio)
+{
+    const auto key = std::make_tuple(filePath, size, devicePixelRatio);
+    auto it = m_sprites.find(key);
+    if (it == m_sprites.end()) {
+        // a file that can't be decoded is remembered as well, so it's not tried again
+        it = m_sprites.emplace(key, loadCursor(filePath, size, devicePixelRatio)).first;
+    }
+    return it->second;
+}
+
+void KXcursorThemePrivate::loadCursors(const QString &packagePath)
 {
     const QDir dir(packagePath);
-    QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-    std::partition(entries.begin(), entries.end(), [](const QFileInfo &fileInfo) {
-        return !fileInfo.isSymLink();
-    });
-
-    for (const QFileInfo &entry : std::as_const(entries)) {
-        const QByteArray shape = QFile::encodeName(entry.fileName());
-        if (registry.contains(shape)) {
-            continue;
-        }
-        if (entry.isSymLink()) {
-            const QFileInfo symLinkInfo(entry.symLinkTarget());
-            if (symLinkInfo.absolutePath() == entry.absolutePath()) {
-                const auto sprites = registry.value(QFile::encodeName(symLinkInfo.fileName()));
-                if (!sprites.isEmpty()) {
-                    registry.insert(shape, sprites);
-                    continue;
-                }
-            }
-        }
-        const QVector<KXcursorSprite> sprites = loadCursor(entry.absoluteFilePath(), size, devicePixelRatio);
-        if (!sprites.isEmpty()) {
-            registry.insert(shape, sprites);
+    const QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+
+    for (const QFileInfo &entry : entries) {
+        // symlinks resolve to the file they alias, so the cache decodes it only once
+        const QString filePath = entry.canonicalFilePath();
+        if (!filePath.isEmpty()) {
+            files[QFile::encodeName(entry.fileName())].append(filePath);
         }
     }
 }
@@ -160,6 +194,10 @@ void KXcursorThemePrivate::load(const QString &themeName, int size, qreal device
 {
     const QStringList paths = searchPaths();
 
+    this->size = size;
+    this->devicePixelRatio = devicePixelRatio;
+    cache = KXcursorSpriteCache::instance();
+
     QStack<QString> stack;
     QSet<QString> loaded;
 
@@ -178,7 +216,7 @@ void KXcursorThemePrivate::load(const QString &themeName, int size, qreal device
             if (!dir.exists()) {
                 continue;
             }
-            loadCursors(dir.filePath(QStringLiteral("cursors")), size, devicePixelRatio);
+            loadCursors(dir.filePath(QStringLiteral("cursors")));
             if (inherits.isEmpty()) {
                 const KConfig config(dir.filePath(QStringLiteral("index.theme")), KConfig::NoGlobals);
                 inherits << KConfigGroup(&config, "Icon Theme").readEntry("Inherits", QStringList());
@@ -220,12 +258,20 @@ KXcursorTheme &KXcursorTheme::operator=(const KXcursorTheme &other)
 
 bool KXcursorTheme::isEmpty() const
 {
-    return d->registry.isEmpty();
+    return d->files.isEmpty();
 }
 
 QVector<KXcursorSprite> KXcursorTheme::shape(const QByteArray &name) const
 {
-    return d->registry.value(name);
+    // the themes inherited later only provide the shape if the earlier files can't be decoded
+    const QStringList filePaths = d->files.value(name);
+    for (const QString &filePath : filePaths) {
+        const QVector<KXcursorSprite> sprites = d->cache->sprites(filePath, d->size, d->devicePixelRatio);
+        if (!sprites.isEmpty()) {
+            return sprites;
+        }
+    }
+    return {};
 }
 
 } // namespace KWin
@@ -88,6 +88,9 @@ public:
      * Loads the Xcursor theme with the given @ themeName and the desired @a size.
      * The @a dpr specifies the desired scale factor. If no theme with the provided
      * name exists, the cursor theme will be empty.
+     *
+     * Only the files of the theme are looked up, the cursors are decoded when they're
+     * used for the first time and shared with the other themes of the same size.
      */
     KXcursorTheme(const QString &theme, int size, qreal devicePixelRatio);
 
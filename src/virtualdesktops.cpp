@@ -29,19 +29,47 @@ namespace KWin
 static bool s_loadingDesktopSettings = false;
 static const double GESTURE_SWITCH_THRESHOLD = .25;
 
+// The membership bits in use by the existing desktops, the highest bit is reserved.
+static quint64 s_usedMembershipBits = 0;
+
 static QString generateDesktopId()
 {
     return QUuid::createUuid().toString(QUuid::WithoutBraces);
 }
 
+static quint64 allocateMembershipBit()
+{
+    for (int i = 0; i < 63; ++i) {
+        const quint64 bit = quint64(1) << i;
+        if (!(s_usedMembershipBits & bit)) {
+            s_usedMembershipBits |= bit;
+            return bit;
+        }
+    }
+    return VirtualDesktop::s_unindexedMembershipBit;
+}
+
 VirtualDesktop::VirtualDesktop(QObject *parent)
     : QObject(parent)
+    , m_membershipBit(allocateMembershipBit())
 {
 }
 
 VirtualDesktop::~VirtualDesktop()
 {
     Q_EMIT aboutToBeDestroyed();
+    if (m_membershipBit != s_unindexedMembershipBit) {
+        s_usedMembershipBits &= ~m_membershipBit;
+    }
+}
+
+quint64 VirtualDesktop::membershipMask(const QVector<VirtualDesktop *> &desktops)
+{
+    quint64 mask = 0;
+    for (const VirtualDesktop *desktop : desktops) {
+        mask |= desktop->membershipBit();
+    }
+    return mask;
 }
 
 void VirtualDesktopManager::setVirtualDesktopManagement(KWaylandServer::PlasmaVirtualDesktopManagementInterface *management)
@@ -63,6 +63,22 @@ public:
         return m_x11DesktopNumber;
     }
 
+    /**
+     * Returns the bit that represents this desktop in a membership mask. Unlike the x11 desktop
+     * number it doesn't change while the desktop exists. If all bits are taken, which shouldn't
+     * happen, s_unindexedMembershipBit is returned and the desktop has to be looked up by pointer.
+     */
+    quint64 membershipBit() const
+    {
+        return m_membershipBit;
+    }
+    /**
+     * Returns the membership mask of the given @p desktops, a window is on a desktop if the
+     * mask of its desktops has the bit of the desktop set.
+     */
+    static quint64 membershipMask(const QVector<VirtualDesktop *> &desktops);
+    static constexpr quint64 s_unindexedMembershipBit = quint64(1) << 63;
+
 Q_SIGNALS:
     void nameChanged();
     void x11DesktopNumberChanged();
@@ -75,6 +91,7 @@ private:
     QString m_id;
     QString m_name;
     int m_x11DesktopNumber = 0;
+    quint64 m_membershipBit;
 };
 
 /**
@@ -28,6 +28,7 @@
 #include "KWayland/Client/keyboard.h"
 #include "KWayland/Client/pointer.h"
 #include "KWayland/Client/pointergestures.h"
+#include "KWayland/Client/region.h"
 #include "KWayland/Client/registry.h"
 #include "KWayland/Client/relativepointer.h"
 #include "KWayland/Client/seat.h"
@@ -792,6 +793,28 @@ void TestWaylandSeat::testPointerSubSurfaceTree()
     QCOMPARE(motionSpy.count(), 2);
     QCOMPARE(enteredSpy.last().last().toPointF(), QPointF(75, 50));
     QCOMPARE(pointer->enteredSurface(), parentSurface.get());
+    // back to grandChild2
+    m_seatInterface->setTimestamp(timestamp++);
+    m_seatInterface->notifyPointerMotion(QPointF(25, 60));
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(enteredSpy.wait());
+    QCOMPARE(enteredSpy.count(), 4);
+    QCOMPARE(pointer->enteredSurface(), grandChild2Surface.get());
+    // grandChild2 doesn't accept input anymore, the next motion has to go to childSurface
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    std::unique_ptr<Region> emptyRegion(m_compositor->createRegion(QRegion(), nullptr));
+    grandChild2Surface->setInputRegion(emptyRegion.get());
+    grandChild2Surface->commit(Surface::CommitFlag::None);
+    childSurface->commit(Surface::CommitFlag::None);
+    parentSurface->commit(Surface::CommitFlag::None);
+    QVERIFY(committedSpy.wait());
+    m_seatInterface->setTimestamp(timestamp++);
+    m_seatInterface->notifyPointerMotion(QPointF(25, 61));
+    m_seatInterface->notifyPointerFrame();
+    QVERIFY(enteredSpy.wait());
+    QCOMPARE(enteredSpy.count(), 5);
+    QCOMPARE(enteredSpy.last().last().toPointF(), QPointF(25, 61));
+    QCOMPARE(pointer->enteredSurface(), childSurface.get());
 }
 
 void TestWaylandSeat::testPointerSwipeGesture_data()
@@ -2012,6 +2035,11 @@ void TestWaylandSeat::testKeymap()
     address = reinterpret_cast<char *>(file.map(0, keymapChangedSpy.first().last().value<quint32>()));
     QVERIFY(address);
     QCOMPARE(qstrcmp(address, "bar"), 0);
+
+    // setting the same keymap again doesn't resend it
+    keymapChangedSpy.clear();
+    m_seatInterface->keyboard()->setKeymap(QByteArrayLiteral("bar"));
+    QVERIFY(!keymapChangedSpy.wait(500));
 }
 
 QTEST_GUILESS_MAIN(TestWaylandSeat)
@@ -569,9 +569,10 @@ void TestWaylandSurface::testMultipleSurfaces()
     QImage buffer2Data = qobject_cast<ShmClientBuffer *>(buffer2)->data();
     QCOMPARE(buffer2Data, red);
 
-    // while buffer2 is accessed we cannot access buffer1
+    // buffer1 can be accessed while buffer2 is
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
-    QVERIFY(buffer1Data.isNull());
+    QCOMPARE(buffer1Data, black);
+    buffer1Data = QImage();
 
     // a deep copy can be kept around
     QImage deepCopy = buffer2Data.copy();
@@ -580,7 +581,7 @@ void TestWaylandSurface::testMultipleSurfaces()
     QVERIFY(buffer2Data.isNull());
     QCOMPARE(deepCopy, red);
 
-    // now that buffer2Data is destroyed we can access buffer1 again
+    // and still after buffer2Data is destroyed
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
     QVERIFY(!buffer1Data.isNull());
     QCOMPARE(buffer1Data, black);
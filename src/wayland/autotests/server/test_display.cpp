@@ -26,6 +26,7 @@ private Q_SLOTS:
     void testClientConnection();
     void testConnectNoSocket();
     void testAutoSocketName();
+    void testClientStatistics();
 };
 
 void TestWaylandServerDisplay::testSocketName()
@@ -178,5 +179,39 @@ void TestWaylandServerDisplay::testAutoSocketName()
     QCOMPARE(socketNameChangedSpy1.count(), 1);
 }
 
+void TestWaylandServerDisplay::testClientStatistics()
+{
+    KWaylandServer::Display display;
+    display.start();
+
+    int sv[2];
+    QVERIFY(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) >= 0);
+    ClientConnection *client = display.createClient(sv[0]);
+    QVERIFY(client);
+    QCOMPARE(client->requestCount(), quint64(0));
+    QCOMPARE(client->eventCount(), quint64(0));
+
+    // every client has the wl_display object
+    QCOMPARE(client->objectCounts().value("wl_display"), 1);
+    QCOMPARE(client->objectCounts().value("wl_callback"), 0);
+
+    wl_resource *callback = wl_resource_create(client->client(), &wl_callback_interface, 1, 0);
+    QVERIFY(callback);
+    QCOMPARE(client->objectCounts().value("wl_callback"), 1);
+
+    // the header and one uint
+    wl_callback_send_done(callback, 0);
+    QCOMPARE(client->eventCount(), quint64(1));
+    QCOMPARE(client->bytesSent(), quint64(12));
+    QCOMPARE(client->bufferMemory(), qint64(0));
+
+    wl_resource_destroy(callback);
+    QCOMPARE(client->objectCounts().value("wl_callback"), 0);
+
+    wl_client_destroy(client->client());
+    close(sv[0]);
+    close(sv[1]);
+}
+
 QTEST_GUILESS_MAIN(TestWaylandServerDisplay)
 #include "test_display.moc"
@@ -0,0 +1,483 @@
+/*
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QSocketNotifier>
+#include <QThread>
+#include <QtTest>
+
+#include "wayland/compositor_interface.h"
+#include "wayland/datadevicemanager_interface.h"
+#include "wayland/display.h"
+#include "wayland/plasmawindowmanagement_interface.h"
+#include "wayland/seat_interface.h"
+#include "wayland/surface_interface.h"
+#include "wayland/xdgshell_interface.h"
+
+#include "KWayland/Client/compositor.h"
+#include "KWayland/Client/connection_thread.h"
+#include "KWayland/Client/datadevice.h"
+#include "KWayland/Client/datadevicemanager.h"
+#include "KWayland/Client/dataoffer.h"
+#include "KWayland/Client/datasource.h"
+#include "KWayland/Client/event_queue.h"
+#include "KWayland/Client/keyboard.h"
+#include "KWayland/Client/plasmawindowmanagement.h"
+#include "KWayland/Client/pointer.h"
+#include "KWayland/Client/registry.h"
+#include "KWayland/Client/seat.h"
+#include "KWayland/Client/surface.h"
+#include "KWayland/Client/xdgshell.h"
+
+#include <fcntl.h>
+#include <functional>
+#include <linux/input.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace KWaylandServer;
+
+/**
+ * Measures the throughput of the protocol implementations: how fast input events reach many
+ * clients, how long a configure round trip takes, how fast a selection is transferred and how
+ * expensive the window management updates are with many windows. The commit rate is measured
+ * by testSurfaceCommit.
+ *
+ * Run with -csv or -xml to track the results.
+ */
+class TestProtocolThroughput : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void benchmarkPointerEvents_data();
+    void benchmarkPointerEvents();
+    void benchmarkKeyboardEvents_data();
+    void benchmarkKeyboardEvents();
+    void benchmarkXdgConfigureRoundTrip();
+    void benchmarkSelectionTransfer_data();
+    void benchmarkSelectionTransfer();
+    void benchmarkWindowManagementUpdates_data();
+    void benchmarkWindowManagementUpdates();
+
+private:
+    struct Connection
+    {
+        KWayland::Client::ConnectionThread *connection = nullptr;
+        QThread *thread = nullptr;
+        KWayland::Client::EventQueue *queue = nullptr;
+        KWayland::Client::Compositor *compositor = nullptr;
+        KWayland::Client::Seat *seat = nullptr;
+        KWayland::Client::Pointer *pointer = nullptr;
+        KWayland::Client::Keyboard *keyboard = nullptr;
+        KWayland::Client::DataDeviceManager *dataDeviceManager = nullptr;
+        KWayland::Client::DataDevice *dataDevice = nullptr;
+        KWayland::Client::XdgShell *xdgShell = nullptr;
+        KWayland::Client::PlasmaWindowManagement *windowManagement = nullptr;
+        KWayland::Client::Surface *surface = nullptr;
+        SurfaceInterface *serverSurface = nullptr;
+    };
+    bool setupConnections(int count);
+    bool setupConnection(Connection *c);
+    void cleanupConnection(Connection *c);
+
+    KWaylandServer::Display *m_display = nullptr;
+    CompositorInterface *m_compositorInterface = nullptr;
+    SeatInterface *m_seatInterface = nullptr;
+    DataDeviceManagerInterface *m_dataDeviceManagerInterface = nullptr;
+    XdgShellInterface *m_xdgShellInterface = nullptr;
+    PlasmaWindowManagementInterface *m_windowManagementInterface = nullptr;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+};
+
+static const QString s_socketName = QStringLiteral("kwin-wayland-server-protocol-throughput-test-0");
+static const int s_eventCount = 100;
+
+static void waitUntil(const std::function<bool()> &condition)
+{
+    while (!condition()) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+}
+
+void TestProtocolThroughput::init()
+{
+    m_display = new KWaylandServer::Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    m_display->createShm();
+    m_compositorInterface = new CompositorInterface(m_display, m_display);
+    m_seatInterface = new SeatInterface(m_display, m_display);
+    m_seatInterface->setHasPointer(true);
+    m_seatInterface->setHasKeyboard(true);
+    m_dataDeviceManagerInterface = new DataDeviceManagerInterface(m_display, m_display);
+    m_xdgShellInterface = new XdgShellInterface(m_display, m_display);
+    m_windowManagementInterface = new PlasmaWindowManagementInterface(m_display, m_display);
+}
+
+bool TestProtocolThroughput::setupConnections(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        auto connection = std::make_unique<Connection>();
+        if (!setupConnection(connection.get())) {
+            return false;
+        }
+        m_connections.push_back(std::move(connection));
+    }
+    return true;
+}
+
+bool TestProtocolThroughput::setupConnection(Connection *c)
+{
+    using namespace KWayland::Client;
+
+    c->connection = new ConnectionThread;
+    QSignalSpy connectedSpy(c->connection, &ConnectionThread::connected);
+    c->connection->setSocketName(s_socketName);
+
+    c->thread = new QThread(this);
+    c->connection->moveToThread(c->thread);
+    c->thread->start();
+
+    c->connection->initConnection();
+    if (!connectedSpy.wait(500)) {
+        return false;
+    }
+
+    c->queue = new EventQueue(this);
+    c->queue->setup(c->connection);
+
+    Registry registry;
+    QSignalSpy interfacesAnnouncedSpy(&registry, &Registry::interfacesAnnounced);
+    registry.setEventQueue(c->queue);
+    registry.create(c->connection);
+    if (!registry.isValid()) {
+        return false;
+    }
+    registry.setup();
+    if (!interfacesAnnouncedSpy.wait(500)) {
+        return false;
+    }
+
+    c->compositor = registry.createCompositor(registry.interface(Registry::Interface::Compositor).name,
+                                              registry.interface(Registry::Interface::Compositor).version,
+                                              this);
+    c->dataDeviceManager = registry.createDataDeviceManager(registry.interface(Registry::Interface::DataDeviceManager).name,
+                                                            registry.interface(Registry::Interface::DataDeviceManager).version,
+                                                            this);
+    c->xdgShell = registry.createXdgShell(registry.interface(Registry::Interface::XdgShellStable).name,
+                                          registry.interface(Registry::Interface::XdgShellStable).version,
+                                          this);
+    c->windowManagement = registry.createPlasmaWindowManagement(registry.interface(Registry::Interface::PlasmaWindowManagement).name,
+                                                                registry.interface(Registry::Interface::PlasmaWindowManagement).version,
+                                                                this);
+    c->seat = registry.createSeat(registry.interface(Registry::Interface::Seat).name, registry.interface(Registry::Interface::Seat).version, this);
+    if (!c->compositor->isValid() || !c->dataDeviceManager->isValid() || !c->xdgShell->isValid() || !c->windowManagement->isValid() || !c->seat->isValid()) {
+        return false;
+    }
+
+    QSignalSpy keyboardSpy(c->seat, &Seat::hasKeyboardChanged);
+    if (!c->seat->hasKeyboard() && !keyboardSpy.wait(500)) {
+        return false;
+    }
+    c->pointer = c->seat->createPointer(c->seat);
+    c->keyboard = c->seat->createKeyboard(c->seat);
+    c->dataDevice = c->dataDeviceManager->getDataDevice(c->seat, this);
+    if (!c->pointer->isValid() || !c->keyboard->isValid() || !c->dataDevice->isValid()) {
+        return false;
+    }
+
+    QSignalSpy surfaceCreatedSpy(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    c->surface = c->compositor->createSurface(this);
+    if (!surfaceCreatedSpy.wait(500)) {
+        return false;
+    }
+    c->serverSurface = surfaceCreatedSpy.last().first().value<SurfaceInterface *>();
+
+    return true;
+}
+
+void TestProtocolThroughput::cleanup()
+{
+    for (const auto &connection : m_connections) {
+        cleanupConnection(connection.get());
+    }
+    m_connections.clear();
+
+    delete m_display;
+    m_display = nullptr;
+    // these are the children of the display
+    m_windowManagementInterface = nullptr;
+    m_xdgShellInterface = nullptr;
+    m_dataDeviceManagerInterface = nullptr;
+    m_seatInterface = nullptr;
+    m_compositorInterface = nullptr;
+}
+
+void TestProtocolThroughput::cleanupConnection(Connection *c)
+{
+    delete c->surface;
+    delete c->windowManagement;
+    delete c->xdgShell;
+    delete c->dataDevice;
+    delete c->dataDeviceManager;
+    delete c->keyboard;
+    delete c->pointer;
+    delete c->seat;
+    delete c->compositor;
+    delete c->queue;
+    if (c->connection) {
+        c->connection->deleteLater();
+    }
+    if (c->thread) {
+        c->thread->quit();
+        c->thread->wait();
+        delete c->thread;
+    }
+}
+
+void TestProtocolThroughput::benchmarkPointerEvents_data()
+{
+    QTest::addColumn<int>("clientCount");
+
+    QTest::addRow("1 client") << 1;
+    QTest::addRow("10 clients") << 10;
+    QTest::addRow("50 clients") << 50;
+}
+
+void TestProtocolThroughput::benchmarkPointerEvents()
+{
+    // the pointer moves across all clients in turn, each gets a burst of motion events
+    QFETCH(int, clientCount);
+    QVERIFY(setupConnections(clientCount));
+
+    int motionCount = 0;
+    for (const auto &connection : m_connections) {
+        connect(connection->pointer, &KWayland::Client::Pointer::motion, this, [&motionCount]() {
+            ++motionCount;
+        });
+    }
+
+    quint32 timestamp = 0;
+    QBENCHMARK {
+        motionCount = 0;
+        for (const auto &connection : m_connections) {
+            m_seatInterface->notifyPointerEnter(connection->serverSurface, QPointF(0, 0));
+            for (int i = 0; i < s_eventCount; ++i) {
+                m_seatInterface->setTimestamp(++timestamp);
+                m_seatInterface->notifyPointerMotion(QPointF(i % 64, i / 64));
+                m_seatInterface->notifyPointerFrame();
+            }
+        }
+        waitUntil([&]() {
+            return motionCount >= clientCount * s_eventCount;
+        });
+    }
+}
+
+void TestProtocolThroughput::benchmarkKeyboardEvents_data()
+{
+    QTest::addColumn<int>("clientCount");
+
+    QTest::addRow("1 client") << 1;
+    QTest::addRow("10 clients") << 10;
+    QTest::addRow("50 clients") << 50;
+}
+
+void TestProtocolThroughput::benchmarkKeyboardEvents()
+{
+    // the keyboard focus moves across all clients in turn, each gets a burst of key presses
+    QFETCH(int, clientCount);
+    QVERIFY(setupConnections(clientCount));
+
+    int keyCount = 0;
+    for (const auto &connection : m_connections) {
+        connect(connection->keyboard, &KWayland::Client::Keyboard::keyChanged, this, [&keyCount]() {
+            ++keyCount;
+        });
+    }
+
+    quint32 timestamp = 0;
+    QBENCHMARK {
+        keyCount = 0;
+        for (const auto &connection : m_connections) {
+            m_seatInterface->setFocusedKeyboardSurface(connection->serverSurface);
+            for (int i = 0; i < s_eventCount / 2; ++i) {
+                m_seatInterface->setTimestamp(++timestamp);
+                m_seatInterface->notifyKeyboardKey(KEY_A, KeyboardKeyState::Pressed);
+                m_seatInterface->setTimestamp(++timestamp);
+                m_seatInterface->notifyKeyboardKey(KEY_A, KeyboardKeyState::Released);
+            }
+        }
+        waitUntil([&]() {
+            return keyCount >= clientCount * (s_eventCount / 2) * 2;
+        });
+    }
+}
+
+void TestProtocolThroughput::benchmarkXdgConfigureRoundTrip()
+{
+    // a configure event is sent and the next one only once the client has acknowledged it,
+    // like during an interactive resize
+    QVERIFY(setupConnections(1));
+    Connection *c = m_connections.front().get();
+
+    QSignalSpy toplevelCreatedSpy(m_xdgShellInterface, &XdgShellInterface::toplevelCreated);
+    std::unique_ptr<KWayland::Client::XdgShellSurface> xdgSurface(c->xdgShell->createSurface(c->surface));
+    QVERIFY(toplevelCreatedSpy.wait());
+    auto toplevel = toplevelCreatedSpy.last().first().value<XdgToplevelInterface *>();
+
+    connect(xdgSurface.get(), &KWayland::Client::XdgShellSurface::configureRequested, this, [&](const QSize &, KWayland::Client::XdgShellSurface::States, quint32 serial) {
+        xdgSurface->ackConfigure(serial);
+        c->connection->flush();
+    });
+
+    quint32 acknowledgedSerial = 0;
+    connect(toplevel->xdgSurface(), &XdgSurfaceInterface::configureAcknowledged, this, [&acknowledgedSerial](quint32 serial) {
+        acknowledgedSerial = serial;
+    });
+
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            const quint32 serial = toplevel->sendConfigure(QSize(100 + i, 100 + i), XdgToplevelInterface::States());
+            waitUntil([&]() {
+                return acknowledgedSerial == serial;
+            });
+        }
+    }
+}
+
+void TestProtocolThroughput::benchmarkSelectionTransfer_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::addRow("4 KiB") << 4 * 1024;
+    QTest::addRow("1 MiB") << 1024 * 1024;
+    QTest::addRow("16 MiB") << 16 * 1024 * 1024;
+}
+
+void TestProtocolThroughput::benchmarkSelectionTransfer()
+{
+    // the first client provides the selection, the second one pastes it
+    QFETCH(int, size);
+    QVERIFY(setupConnections(2));
+    Connection *source = m_connections[0].get();
+    Connection *target = m_connections[1].get();
+    const QString mimeType = QStringLiteral("application/octet-stream");
+    const QByteArray payload(size, 'k');
+
+    std::unique_ptr<KWayland::Client::DataSource> dataSource(source->dataDeviceManager->createDataSource());
+    dataSource->offer(mimeType);
+    // the writer has to run on its own, the reader would block the event loop otherwise
+    std::vector<std::thread> writers;
+    connect(dataSource.get(), &KWayland::Client::DataSource::sendDataRequested, this, [&payload, &writers](const QString &, qint32 fd) {
+        writers.emplace_back([&payload, fd]() {
+            qint64 written = 0;
+            while (written < payload.size()) {
+                const ssize_t count = write(fd, payload.constData() + written, payload.size() - written);
+                if (count < 0) {
+                    break;
+                }
+                written += count;
+            }
+            close(fd);
+        });
+    });
+
+    m_seatInterface->setFocusedKeyboardSurface(source->serverSurface);
+    QSignalSpy selectionChangedSpy(m_seatInterface, &SeatInterface::selectionChanged);
+    source->dataDevice->setSelection(0, dataSource.get());
+    QVERIFY(selectionChangedSpy.wait());
+
+    QSignalSpy selectionOfferedSpy(target->dataDevice, &KWayland::Client::DataDevice::selectionOffered);
+    m_seatInterface->setFocusedKeyboardSurface(target->serverSurface);
+    QVERIFY(selectionOfferedSpy.wait());
+    auto dataOffer = selectionOfferedSpy.last().first().value<KWayland::Client::DataOffer *>();
+
+    QBENCHMARK {
+        int pipeFds[2];
+        QVERIFY(pipe2(pipeFds, O_CLOEXEC) == 0);
+        dataOffer->receive(mimeType, pipeFds[1]);
+        close(pipeFds[1]);
+        target->connection->flush();
+
+        // reads until the source has closed its end, while the requests are dispatched
+        QSocketNotifier notifier(pipeFds[0], QSocketNotifier::Read);
+        qint64 received = 0;
+        bool finished = false;
+        connect(&notifier, &QSocketNotifier::activated, this, [&]() {
+            char buffer[65536];
+            const ssize_t count = read(pipeFds[0], buffer, sizeof(buffer));
+            if (count <= 0) {
+                finished = true;
+                notifier.setEnabled(false);
+            } else {
+                received += count;
+            }
+        });
+        waitUntil([&finished]() {
+            return finished;
+        });
+        close(pipeFds[0]);
+        QCOMPARE(received, qint64(size));
+    }
+
+    for (std::thread &writer : writers) {
+        writer.join();
+    }
+}
+
+void TestProtocolThroughput::benchmarkWindowManagementUpdates_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::addRow("10 windows") << 10;
+    QTest::addRow("100 windows") << 100;
+    QTest::addRow("500 windows") << 500;
+}
+
+void TestProtocolThroughput::benchmarkWindowManagementUpdates()
+{
+    // the task manager is told about a title change of every window, as when switching
+    // virtual desktops or when a script touches all windows
+    QFETCH(int, windowCount);
+    QVERIFY(setupConnections(1));
+    Connection *c = m_connections.front().get();
+
+    QSignalSpy windowCreatedSpy(c->windowManagement, &KWayland::Client::PlasmaWindowManagement::windowCreated);
+    QObject windowParent;
+    QVector<PlasmaWindowInterface *> windows;
+    for (int i = 0; i < windowCount; ++i) {
+        windows.append(m_windowManagementInterface->createWindow(&windowParent, QUuid::createUuid()));
+    }
+    waitUntil([&]() {
+        return windowCreatedSpy.count() == windowCount;
+    });
+
+    int titleChangeCount = 0;
+    for (const QList<QVariant> &arguments : qAsConst(windowCreatedSpy)) {
+        auto window = arguments.first().value<KWayland::Client::PlasmaWindow *>();
+        connect(window, &KWayland::Client::PlasmaWindow::titleChanged, this, [&titleChangeCount]() {
+            ++titleChangeCount;
+        });
+    }
+
+    int generation = 0;
+    QBENCHMARK {
+        titleChangeCount = 0;
+        ++generation;
+        for (PlasmaWindowInterface *window : qAsConst(windows)) {
+            window->setTitle(QStringLiteral("Window %1").arg(generation));
+        }
+        waitUntil([&]() {
+            return titleChangeCount == windowCount;
+        });
+    }
+}
+
+QTEST_GUILESS_MAIN(TestProtocolThroughput)
+#include "test_protocol_throughput.moc"
@@ -0,0 +1,178 @@
+/*
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QThread>
+#include <QtTest>
+
+#include "wayland/compositor_interface.h"
+#include "wayland/display.h"
+#include "wayland/subcompositor_interface.h"
+#include "wayland/surface_interface.h"
+
+#include "KWayland/Client/compositor.h"
+#include "KWayland/Client/connection_thread.h"
+#include "KWayland/Client/event_queue.h"
+#include "KWayland/Client/registry.h"
+#include "KWayland/Client/shm_pool.h"
+#include "KWayland/Client/subcompositor.h"
+#include "KWayland/Client/subsurface.h"
+#include "KWayland/Client/surface.h"
+
+using namespace KWaylandServer;
+
+/**
+ * Measures how long the server takes for the commits of a client that commits a new buffer and
+ * damage 1000 times a second, as games and video players do.
+ */
+class TestSurfaceCommit : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~TestSurfaceCommit() override;
+
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkCommit();
+    void benchmarkSynchronizedSubSurfaceCommit();
+
+private:
+    KWayland::Client::ConnectionThread *m_connection = nullptr;
+    KWayland::Client::EventQueue *m_queue = nullptr;
+    KWayland::Client::Compositor *m_clientCompositor = nullptr;
+    KWayland::Client::SubCompositor *m_clientSubCompositor = nullptr;
+    KWayland::Client::ShmPool *m_shm = nullptr;
+
+    QThread *m_thread = nullptr;
+    KWaylandServer::Display m_display;
+    CompositorInterface *m_serverCompositor = nullptr;
+};
+
+static const QString s_socketName = QStringLiteral("kwin-wayland-server-surface-commit-test-0");
+static const int s_commitCount = 1000;
+
+void TestSurfaceCommit::initTestCase()
+{
+    m_display.addSocketName(s_socketName);
+    m_display.start();
+    QVERIFY(m_display.isRunning());
+
+    m_display.createShm();
+    m_serverCompositor = new CompositorInterface(&m_display, this);
+    new SubCompositorInterface(&m_display, this);
+
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &KWayland::Client::ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new KWayland::Client::EventQueue(this);
+    m_queue->setup(m_connection);
+    QVERIFY(m_queue->isValid());
+
+    auto registry = new KWayland::Client::Registry(this);
+    QSignalSpy interfacesAnnouncedSpy(registry, &KWayland::Client::Registry::interfacesAnnounced);
+    registry->setEventQueue(m_queue);
+    registry->create(m_connection->display());
+    QVERIFY(registry->isValid());
+    registry->setup();
+    QVERIFY(interfacesAnnouncedSpy.wait());
+
+    const auto compositor = registry->interface(KWayland::Client::Registry::Interface::Compositor);
+    m_clientCompositor = registry->createCompositor(compositor.name, compositor.version, this);
+    QVERIFY(m_clientCompositor->isValid());
+
+    const auto subCompositor = registry->interface(KWayland::Client::Registry::Interface::SubCompositor);
+    m_clientSubCompositor = registry->createSubCompositor(subCompositor.name, subCompositor.version, this);
+    QVERIFY(m_clientSubCompositor->isValid());
+
+    const auto shm = registry->interface(KWayland::Client::Registry::Interface::Shm);
+    m_shm = registry->createShmPool(shm.name, shm.version, this);
+    QVERIFY(m_shm->isValid());
+}
+
+TestSurfaceCommit::~TestSurfaceCommit()
+{
+    delete m_shm;
+    delete m_queue;
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+    }
+    m_connection->deleteLater();
+}
+
+static void waitForCommits(QSignalSpy &spy, int count)
+{
+    while (spy.count() < count) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    spy.clear();
+}
+
+void TestSurfaceCommit::benchmarkCommit()
+{
+    QSignalSpy surfaceCreatedSpy(m_serverCompositor, &CompositorInterface::surfaceCreated);
+    std::unique_ptr<KWayland::Client::Surface> surface(m_clientCompositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    auto serverSurface = surfaceCreatedSpy.last().first().value<SurfaceInterface *>();
+
+    QImage image(QSize(64, 64), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    const KWayland::Client::Buffer::Ptr buffer = m_shm->createBuffer(image);
+
+    QSignalSpy committedSpy(serverSurface, &SurfaceInterface::committed);
+    QBENCHMARK {
+        for (int i = 0; i < s_commitCount; ++i) {
+            surface->attachBuffer(buffer);
+            surface->damage(QRect(i % 32, i % 32, 32, 32));
+            surface->commit(KWayland::Client::Surface::CommitFlag::None);
+        }
+        m_connection->flush();
+        waitForCommits(committedSpy, s_commitCount);
+    }
+}
+
+void TestSurfaceCommit::benchmarkSynchronizedSubSurfaceCommit()
+{
+    // the commits of a synchronized subsurface go through the cached state
+    QSignalSpy surfaceCreatedSpy(m_serverCompositor, &CompositorInterface::surfaceCreated);
+    std::unique_ptr<KWayland::Client::Surface> parent(m_clientCompositor->createSurface());
+    std::unique_ptr<KWayland::Client::Surface> child(m_clientCompositor->createSurface());
+    QVERIFY(surfaceCreatedSpy.wait());
+    if (surfaceCreatedSpy.count() < 2) {
+        QVERIFY(surfaceCreatedSpy.wait());
+    }
+    auto serverParent = surfaceCreatedSpy.at(0).first().value<SurfaceInterface *>();
+    std::unique_ptr<KWayland::Client::SubSurface> subSurface(m_clientSubCompositor->createSubSurface(child.get(), parent.get()));
+    subSurface->setMode(KWayland::Client::SubSurface::Mode::Synchronized);
+
+    QImage image(QSize(64, 64), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    const KWayland::Client::Buffer::Ptr buffer = m_shm->createBuffer(image);
+
+    QSignalSpy committedSpy(serverParent, &SurfaceInterface::committed);
+    QBENCHMARK {
+        for (int i = 0; i < s_commitCount; ++i) {
+            child->attachBuffer(buffer);
+            child->damage(QRect(i % 32, i % 32, 32, 32));
+            child->commit(KWayland::Client::Surface::CommitFlag::None);
+            parent->attachBuffer(buffer);
+            parent->damage(QRect(0, 0, 64, 64));
+            parent->commit(KWayland::Client::Surface::CommitFlag::None);
+        }
+        m_connection->flush();
+        waitForCommits(committedSpy, s_commitCount);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSurfaceCommit)
+#include "test_surface_commit.moc"
@@ -65,11 +65,36 @@ void ClientBuffer::unref()
         if (isDestroyed()) {
             delete this;
         } else {
-            wl_buffer_send_release(d->resource);
+            if (!d->isReleased) {
+                wl_buffer_send_release(d->resource);
+            }
+            d->isReleased = false;
         }
     }
 }
 
+void ClientBuffer::release()
+{
+    Q_D(ClientBuffer);
+    if (d->isReleased || d->isDestroyed) {
+        return;
+    }
+    d->isReleased = true;
+    wl_buffer_send_release(d->resource);
+}
+
+bool ClientBuffer::isReleased() const
+{
+    Q_D(const ClientBuffer);
+    return d->isReleased;
+}
+
+void ClientBuffer::markAsAttached()
+{
+    Q_D(ClientBuffer);
+    d->isReleased = false;
+}
+
 void ClientBuffer::markAsDestroyed()
 {
     Q_D(ClientBuffer);
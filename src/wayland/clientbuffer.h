@@ -50,6 +50,18 @@ public:
     void ref();
     void unref();
 
+    /**
+     * Sends the wl_buffer.release event to the client while the buffer is still referenced.
+     * This is meant for buffers whose contents have been copied by the compositor, e.g. shm
+     * buffers uploaded to a texture. The client may reuse the buffer afterwards, so its
+     * contents must not be read anymore, until the buffer is attached again.
+     *
+     * If the buffer has been released this way, dropping the last reference won't send
+     * another wl_buffer.release event.
+     */
+    void release();
+    bool isReleased() const;
+
     /**
      * Returns the wl_resource for this ClientBuffer. If the buffer is destroyed, @c null
      * will be returned.
@@ -65,6 +77,7 @@ public:
     virtual Origin origin() const = 0;
 
     void markAsDestroyed(); ///< @internal
+    void markAsAttached(); ///< @internal
 
 protected:
     ClientBuffer(ClientBufferPrivate &dd);
@@ -5,12 +5,26 @@
 */
 #include "clientconnection.h"
 #include "display.h"
+#include "display_p.h"
+#include "linuxdmabufv1clientbuffer.h"
+#include "shmclientbuffer.h"
+#include "utils/common.h"
 #include "utils/executable_path.h"
 // Qt
 #include <QFileInfo>
 #include <QVector>
 // Wayland
 #include <wayland-server.h>
+// system
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(Q_OS_LINUX)
+#include <linux/sockios.h>
+#endif
 
 namespace KWaylandServer
 {
@@ -29,13 +43,102 @@ public:
 
     qreal scaleOverride = 1.0;
 
+    quint64 requests = 0;
+    quint64 events = 0;
+    quint64 bytesReceived = 0;
+    quint64 bytesSent = 0;
+
+    static void logMessage(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message);
+
 private:
+    struct Listener : wl_listener
+    {
+        ClientConnectionPrivate *owner;
+    };
+
     static void destroyListenerCallback(wl_listener *listener, void *data);
+    static void resourceCreatedCallback(wl_listener *listener, void *data);
+    void checkRequestRate();
+    void checkObjectCount();
+
     ClientConnection *q;
-    wl_listener listener;
+    Listener listener;
+    Listener resourceCreatedListener;
     static QVector<ClientConnectionPrivate *> s_allClients;
+
+    std::chrono::steady_clock::time_point rateWindowStart;
+    quint64 rateWindowRequests = 0;
+    int createdSinceCheck = 0;
+    bool requestRateExceeded = false;
+    bool objectCountExceeded = false;
 };
 
+static int readLimit(const char *name)
+{
+    bool ok = false;
+    const int limit = qEnvironmentVariableIntValue(name, &ok);
+    return ok && limit > 0 ? limit : 0;
+}
+
+/**
+ * The soft limits of the clients, 0 if there's none. A client that goes over one of them is
+ * reported once, it's up to the user to deal with it.
+ */
+static int maxRequestRate()
+{
+    static const int limit = readLimit("KWIN_WAYLAND_CLIENT_MAX_REQUEST_RATE");
+    return limit;
+}
+
+static int maxObjects()
+{
+    static const int limit = readLimit("KWIN_WAYLAND_CLIENT_MAX_OBJECTS");
+    return limit;
+}
+
+// the objects aren't counted on every creation, only every so many
+static const int s_objectCheckInterval = 256;
+
+static quint64 padded(quint64 size)
+{
+    return (size + 3) & ~quint64(3);
+}
+
+/**
+ * Returns the size of the message on the wire, which is the header and the arguments, see
+ * the wire format in the Wayland documentation.
+ */
+static quint64 messageSize(const wl_message *message, const wl_argument *arguments)
+{
+    quint64 size = 8;
+    int i = 0;
+    for (const char *signature = message->signature; *signature; ++signature) {
+        switch (*signature) {
+        case 'i':
+        case 'u':
+        case 'f':
+        case 'o':
+        case 'n':
+            size += 4;
+            break;
+        case 's':
+            size += 4 + (arguments[i].s ? padded(std::strlen(arguments[i].s) + 1) : 0);
+            break;
+        case 'a':
+            size += 4 + (arguments[i].a ? padded(arguments[i].a->size) : 0);
+            break;
+        case 'h':
+            // file descriptors are passed out of band
+            break;
+        default:
+            // the version and nullability of the argument
+            continue;
+        }
+        ++i;
+    }
+    return size;
+}
+
 QVector<ClientConnectionPrivate *> ClientConnectionPrivate::s_allClients;
 
 ClientConnectionPrivate::ClientConnectionPrivate(wl_client *c, Display *display, ClientConnection *q)
@@ -45,7 +148,15 @@ ClientConnectionPrivate::ClientConnectionPrivate(wl_client *c, Display *display,
 {
     s_allClients << this;
     listener.notify = destroyListenerCallback;
+    listener.owner = this;
     wl_client_add_destroy_listener(c, &listener);
+    if (maxObjects()) {
+        resourceCreatedListener.notify = resourceCreatedCallback;
+        resourceCreatedListener.owner = this;
+        wl_client_add_resource_created_listener(c, &resourceCreatedListener);
+    } else {
+        wl_list_init(&resourceCreatedListener.link);
+    }
     wl_client_get_credentials(client, &pid, &user, &group);
     executablePath = executablePathFromPid(pid);
 }
@@ -54,10 +165,72 @@ ClientConnectionPrivate::~ClientConnectionPrivate()
 {
     if (client) {
         wl_list_remove(&listener.link);
+        wl_list_remove(&resourceCreatedListener.link);
     }
     s_allClients.removeAt(s_allClients.indexOf(this));
 }
 
+void ClientConnectionPrivate::logMessage(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    Q_UNUSED(data)
+    // the listener is only found once the ClientConnection has been created
+    wl_listener *listener = wl_client_get_destroy_listener(wl_resource_get_client(message->resource), destroyListenerCallback);
+    if (!listener) {
+        return;
+    }
+    ClientConnectionPrivate *p = static_cast<Listener *>(listener)->owner;
+    const quint64 size = messageSize(message->message, message->arguments);
+    if (type == WL_PROTOCOL_LOGGER_REQUEST) {
+        p->requests++;
+        p->bytesReceived += size;
+        if (maxRequestRate()) {
+            p->checkRequestRate();
+        }
+    } else {
+        p->events++;
+        p->bytesSent += size;
+    }
+}
+
+void ClientConnectionPrivate::checkRequestRate()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - rateWindowStart >= std::chrono::seconds(1)) {
+        rateWindowStart = now;
+        rateWindowRequests = 0;
+    }
+    if (++rateWindowRequests > quint64(maxRequestRate()) && !requestRateExceeded) {
+        requestRateExceeded = true;
+        qCWarning(KWIN_CORE) << executablePath << pid << "sends more than" << maxRequestRate() << "requests per second";
+    }
+}
+
+void ClientConnectionPrivate::resourceCreatedCallback(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data)
+    ClientConnectionPrivate *p = static_cast<Listener *>(listener)->owner;
+    if (++p->createdSinceCheck >= s_objectCheckInterval) {
+        p->createdSinceCheck = 0;
+        p->checkObjectCount();
+    }
+}
+
+void ClientConnectionPrivate::checkObjectCount()
+{
+    if (objectCountExceeded) {
+        return;
+    }
+    int count = 0;
+    const auto objectCounts = q->objectCounts();
+    for (int objects : objectCounts) {
+        count += objects;
+    }
+    if (count > maxObjects()) {
+        objectCountExceeded = true;
+        qCWarning(KWIN_CORE) << executablePath << pid << "has" << count << "objects, more than" << maxObjects() << objectCounts;
+    }
+}
+
 void ClientConnectionPrivate::destroyListenerCallback(wl_listener *listener, void *data)
 {
     Q_UNUSED(listener)
@@ -71,6 +244,7 @@ void ClientConnectionPrivate::destroyListenerCallback(wl_listener *listener, voi
     Q_EMIT q->aboutToBeDestroyed();
     p->client = nullptr;
     wl_list_remove(&p->listener.link);
+    wl_list_remove(&p->resourceCreatedListener.link);
     Q_EMIT q->disconnected(q);
     q->deleteLater();
 }
@@ -147,6 +321,116 @@ QString ClientConnection::executablePath() const
     return d->executablePath;
 }
 
+int ClientConnection::unreadBytes() const
+{
+#if defined(SIOCOUTQ)
+    if (!d->client) {
+        return -1;
+    }
+    int bytes = 0;
+    if (ioctl(wl_client_get_fd(d->client), SIOCOUTQ, &bytes) == -1) {
+        return -1;
+    }
+    return bytes;
+#else
+    return -1;
+#endif
+}
+
+wl_protocol_logger *ClientConnection::addProtocolLogger(wl_display *display)
+{
+    return wl_display_add_protocol_logger(display, ClientConnectionPrivate::logMessage, nullptr);
+}
+
+quint64 ClientConnection::requestCount() const
+{
+    return d->requests;
+}
+
+quint64 ClientConnection::eventCount() const
+{
+    return d->events;
+}
+
+quint64 ClientConnection::bytesReceived() const
+{
+    return d->bytesReceived;
+}
+
+quint64 ClientConnection::bytesSent() const
+{
+    return d->bytesSent;
+}
+
+QHash<QByteArray, int> ClientConnection::objectCounts() const
+{
+    QHash<QByteArray, int> counts;
+    if (!d->client) {
+        return counts;
+    }
+    wl_client_for_each_resource(
+        d->client,
+        [](wl_resource *resource, void *data) {
+            (*static_cast<QHash<QByteArray, int> *>(data))[wl_resource_get_class(resource)]++;
+            return WL_ITERATOR_CONTINUE;
+        },
+        &counts);
+    return counts;
+}
+
+static qint64 dmaBufSize(const KWin::DmaBufAttributes &attributes)
+{
+    // The planes are often in the same dma-buf, with different descriptors.
+    qint64 size = 0;
+    ino_t inodes[4] = {0, 0, 0, 0};
+    for (int i = 0; i < attributes.planeCount; ++i) {
+        const int fd = attributes.fd[i].get();
+        struct stat info;
+        if (fd == -1 || fstat(fd, &info) == -1) {
+            continue;
+        }
+        inodes[i] = info.st_ino;
+        if (std::find(inodes, inodes + i, info.st_ino) != inodes + i) {
+            continue;
+        }
+        const off_t end = lseek(fd, 0, SEEK_END);
+        if (end > 0) {
+            size += end;
+        } else {
+            size += qint64(attributes.pitch[i]) * attributes.height;
+        }
+    }
+    return size;
+}
+
+qint64 ClientConnection::bufferMemory() const
+{
+    struct Context
+    {
+        DisplayPrivate *display;
+        qint64 size;
+    } context{DisplayPrivate::get(d->display), 0};
+    if (!d->client) {
+        return 0;
+    }
+    wl_client_for_each_resource(
+        d->client,
+        [](wl_resource *resource, void *data) {
+            auto context = static_cast<Context *>(data);
+            const char *interface = wl_resource_get_class(resource);
+            if (std::strcmp(interface, "wl_shm_pool") == 0) {
+                context->size += ShmClientBufferIntegration::poolSize(resource);
+            } else if (std::strcmp(interface, "wl_buffer") == 0) {
+                if (auto buffer = qobject_cast<LinuxDmaBufV1ClientBuffer *>(context->display->resourceToBuffer.value(resource))) {
+                    context->size += dmaBufSize(buffer->attributes());
+                }
+            }
+            return WL_ITERATOR_CONTINUE;
+        },
+        &context);
+    return context.size;
+}
+
 void ClientConnection::setScaleOverride(qreal scaleOveride)
 {
     d->scaleOverride = scaleOveride;
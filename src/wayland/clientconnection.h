@@ -9,10 +9,13 @@
 
 #include <sys/types.h>
 
+#include <QHash>
 #include <QObject>
 #include <memory>
 
 struct wl_client;
+struct wl_display;
+struct wl_protocol_logger;
 struct wl_resource;
 
 namespace KWaylandServer
@@ -93,6 +96,48 @@ public:
      */
     QString executablePath() const;
 
+    /**
+     * Returns the number of bytes that have been written to the connection but have not been
+     * read by the client yet. If it keeps growing, the client doesn't keep up with the
+     * events sent to it. Returns @c -1 if the number cannot be determined.
+     *
+     * @since 5.27
+     */
+    int unreadBytes() const;
+
+    /**
+     * Returns the number of requests that the client has sent, and the number of events that
+     * have been sent to it. Messages are only counted once the ClientConnection exists.
+     *
+     * @since 5.27
+     */
+    quint64 requestCount() const;
+    quint64 eventCount() const;
+
+    /**
+     * Returns the number of bytes of the requests of the client, and of the events sent to it.
+     * File descriptors that are passed along aren't counted.
+     *
+     * @since 5.27
+     */
+    quint64 bytesReceived() const;
+    quint64 bytesSent() const;
+
+    /**
+     * Returns the number of objects the client currently has, by interface name.
+     *
+     * @since 5.27
+     */
+    QHash<QByteArray, int> objectCounts() const;
+
+    /**
+     * Returns how many bytes of memory the buffers the client currently has take. shm pools
+     * are counted with their size, dma-bufs with the size of their planes.
+     *
+     * @since 5.27
+     */
+    qint64 bufferMemory() const;
+
     /**
      * Cast operator the native wl_client this ClientConnection represents.
      */
@@ -140,6 +185,7 @@ Q_SIGNALS:
 private:
     friend class Display;
     explicit ClientConnection(wl_client *c, Display *parent);
+    static wl_protocol_logger *addProtocolLogger(wl_display *display);
     std::unique_ptr<ClientConnectionPrivate> d;
 };
 
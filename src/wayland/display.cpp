@@ -41,11 +41,20 @@ Display::Display(QObject *parent)
 {
     d->display = wl_display_create();
     d->loop = wl_display_get_event_loop(d->display);
+    d->statisticsLogger = ClientConnection::addProtocolLogger(d->display);
+
+    d->flushTimer.setSingleShot(true);
+    d->flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&d->flushTimer, &QTimer::timeout, this, [this]() {
+        flush();
+        d->flushedByTimer = true;
+    });
 }
 
 Display::~Display()
 {
     wl_display_destroy_clients(d->display);
+    wl_protocol_logger_destroy(d->statisticsLogger);
     wl_display_destroy(d->display);
 }
 
@@ -101,7 +110,7 @@ bool Display::start()
     connect(d->socketNotifier, &QSocketNotifier::activated, this, &Display::dispatchEvents);
 
     QAbstractEventDispatcher *dispatcher = QCoreApplication::eventDispatcher();
-    connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &Display::flush);
+    connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, &Display::scheduleFlush);
 
     d->running = true;
     Q_EMIT runningChanged(true);
@@ -118,9 +127,40 @@ void Display::dispatchEvents()
 
 void Display::flush()
 {
+    d->flushTimer.stop();
+    d->lastFlushTimestamp = std::chrono::steady_clock::now();
     wl_display_flush_clients(d->display);
 }
 
+void Display::scheduleFlush()
+{
+    if (d->flushTimer.isActive()) {
+        return;
+    }
+    // The first batch of events after a quiet period is flushed right away, so isolated
+    // events are not delayed. Further events, e.g. from a high rate pointer, are coalesced
+    // until the flush interval has passed. If the flush timer has fired in this iteration,
+    // flush once more rather than arming the timer again; it's cheap if there's nothing to
+    // send, and nothing queued after the timer slot can get stuck.
+    const auto elapsed = std::chrono::steady_clock::now() - d->lastFlushTimestamp;
+    if (d->flushedByTimer || elapsed >= d->flushInterval) {
+        d->flushedByTimer = false;
+        flush();
+    } else {
+        d->flushTimer.start(std::chrono::ceil<std::chrono::milliseconds>(d->flushInterval - elapsed));
+    }
+}
+
+std::chrono::milliseconds Display::flushInterval() const
+{
+    return d->flushInterval;
+}
+
+void Display::setFlushInterval(std::chrono::milliseconds interval)
+{
+    d->flushInterval = interval;
+}
+
 void Display::createShm()
 {
     Q_ASSERT(d->display);
@@ -11,6 +11,8 @@
 #include <QList>
 #include <QObject>
 
+#include <chrono>
+
 #include "clientconnection.h"
 
 struct wl_client;
@@ -90,6 +92,25 @@ public:
     bool start();
     void dispatchEvents();
 
+    /**
+     * Flushes the connections to all clients right away.
+     *
+     * Normally, the connections are flushed when the event loop is about to block, but not
+     * more often than once per flushInterval().
+     */
+    void flush();
+
+    /**
+     * Returns the minimum interval between two flushes triggered by the event loop. Events
+     * that are sent within the interval after a flush are coalesced and flushed at the end
+     * of the interval. The default is zero, i.e. the connections are flushed every time the
+     * event loop is about to block.
+     *
+     * @since 5.27
+     */
+    std::chrono::milliseconds flushInterval() const;
+    void setFlushInterval(std::chrono::milliseconds interval);
+
     /**
      * Create a client for the given file descriptor.
      *
@@ -147,7 +168,7 @@ public:
     ClientBuffer *clientBufferForResource(wl_resource *resource) const;
 
 private Q_SLOTS:
-    void flush();
+    void scheduleFlush();
 
 Q_SIGNALS:
     void socketNamesChanged();
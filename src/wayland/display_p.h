@@ -13,8 +13,11 @@
 #include <QList>
 #include <QSocketNotifier>
 #include <QString>
+#include <QTimer>
 #include <QVector>
 
+#include <chrono>
+
 #include <EGL/egl.h>
 
 struct wl_resource;
@@ -45,7 +48,12 @@ public:
     QSocketNotifier *socketNotifier = nullptr;
     wl_display *display = nullptr;
     wl_event_loop *loop = nullptr;
+    wl_protocol_logger *statisticsLogger = nullptr;
     bool running = false;
+    QTimer flushTimer;
+    std::chrono::milliseconds flushInterval = std::chrono::milliseconds::zero();
+    std::chrono::steady_clock::time_point lastFlushTimestamp;
+    bool flushedByTimer = false;
     QList<OutputInterface *> outputs;
     QList<OutputDeviceV2Interface *> outputdevicesV2;
     QVector<SeatInterface *> seats;
@@ -89,6 +89,10 @@ void KeyboardInterface::setKeymap(const QByteArray &content)
     if (content.isNull()) {
         return;
     }
+    if (content == d->keymap) {
+        // all clients already got this keymap, and new ones get the same sealed file
+        return;
+    }
 
     d->keymap = content;
     // +1 to include QByteArray null terminator.
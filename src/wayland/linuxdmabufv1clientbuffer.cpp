@@ -15,9 +15,27 @@
 #include "surface_interface_p.h"
 #include "utils/common.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <linux/sync_file.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
+#include <xf86drm.h>
+
+#ifndef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+// Added in Linux 6.0, the ioctl fails with ENOTTY on older kernels.
+struct dma_buf_export_sync_file
+{
+    uint32_t flags;
+    int32_t fd;
+};
+#define DMA_BUF_IOCTL_EXPORT_SYNC_FILE _IOWR('b', 2, struct dma_buf_export_sync_file)
+#endif
+#ifndef DMA_BUF_SYNC_READ
+#define DMA_BUF_SYNC_READ (1 << 0)
+#endif
 
 namespace KWaylandServer
 {
@@ -92,7 +110,11 @@ LinuxDmaBufParamsV1::LinuxDmaBufParamsV1(LinuxDmaBufV1ClientBufferIntegration *i
 void LinuxDmaBufParamsV1::zwp_linux_buffer_params_v1_destroy_resource(Resource *resource)
 {
     Q_UNUSED(resource)
-    delete this;
+    if (m_isImporting) {
+        m_isDestroyed = true;
+    } else {
+        delete this;
+    }
 }
 
 void LinuxDmaBufParamsV1::zwp_linux_buffer_params_v1_destroy(Resource *resource)
@@ -149,21 +171,37 @@ void LinuxDmaBufParamsV1::zwp_linux_buffer_params_v1_create(Resource *resource,
     m_attrs.height = height;
     m_attrs.format = format;
 
-    LinuxDmaBufV1ClientBuffer *clientBuffer = m_integration->rendererInterface()->importBuffer(std::move(m_attrs), flags);
+    // The test import can take a while, don't block the compositor while the client waits for
+    // the created or the failed event.
+    m_isImporting = true;
+    m_integration->rendererInterface()->importBufferAsync(std::move(m_attrs), flags, [this](LinuxDmaBufV1ClientBuffer *clientBuffer) {
+        finishCreate(clientBuffer);
+    });
+}
+
+void LinuxDmaBufParamsV1::finishCreate(LinuxDmaBufV1ClientBuffer *clientBuffer)
+{
+    m_isImporting = false;
+    if (m_isDestroyed) {
+        delete clientBuffer;
+        delete this;
+        return;
+    }
+
     if (!clientBuffer) {
-        send_failed(resource->handle);
+        send_failed(resource()->handle);
         return;
     }
 
-    wl_resource *bufferResource = wl_resource_create(resource->client(), &wl_buffer_interface, 1, 0);
+    wl_resource *bufferResource = wl_resource_create(resource()->client(), &wl_buffer_interface, 1, 0);
     if (!bufferResource) {
         delete clientBuffer;
-        wl_resource_post_no_memory(resource->handle);
+        wl_resource_post_no_memory(resource()->handle);
         return;
     }
 
     clientBuffer->initialize(bufferResource);
-    send_created(resource->handle, bufferResource);
+    send_created(resource()->handle, bufferResource);
 
     DisplayPrivate *displayPrivate = DisplayPrivate::get(m_integration->display());
     displayPrivate->registerClientBuffer(clientBuffer);
@@ -191,7 +229,8 @@ void LinuxDmaBufParamsV1::zwp_linux_buffer_params_v1_create_immed(Resource *reso
     m_attrs.height = height;
     m_attrs.format = format;
 
-    LinuxDmaBufV1ClientBuffer *clientBuffer = m_integration->rendererInterface()->importBuffer(std::move(m_attrs), flags);
+    // The buffer is only imported when it's used, the client doesn't wait for it anyway.
+    LinuxDmaBufV1ClientBuffer *clientBuffer = m_integration->rendererInterface()->createBuffer(std::move(m_attrs), flags);
     if (!clientBuffer) {
         wl_resource_post_error(resource->handle, error_invalid_wl_buffer, "importing the supplied dmabufs failed");
         return;
@@ -387,6 +426,53 @@ const KWin::DmaBufAttributes &LinuxDmaBufV1ClientBuffer::attributes() const
     return d->attrs;
 }
 
+static KWin::FileDescriptor exportReadFence(int dmabuf)
+{
+    dma_buf_export_sync_file request{
+        .flags = DMA_BUF_SYNC_READ,
+        .fd = -1,
+    };
+    if (drmIoctl(dmabuf, DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &request) != 0) {
+        return KWin::FileDescriptor();
+    }
+    return KWin::FileDescriptor(request.fd);
+}
+
+static KWin::FileDescriptor mergeFences(KWin::FileDescriptor &&first, KWin::FileDescriptor &&second)
+{
+    sync_merge_data request{};
+    qstrncpy(request.name, "kwin implicit fence", sizeof(request.name));
+    request.fd2 = second.get();
+    if (drmIoctl(first.get(), SYNC_IOC_MERGE, &request) == 0) {
+        return KWin::FileDescriptor(request.fence);
+    }
+    // Waiting on one of the planes is better than not waiting at all.
+    return std::move(first);
+}
+
+KWin::FileDescriptor LinuxDmaBufV1ClientBuffer::implicitFence() const
+{
+    Q_D(const LinuxDmaBufV1ClientBuffer);
+    KWin::FileDescriptor fence;
+    for (int i = 0; i < d->attrs.planeCount; ++i) {
+        const int dmabuf = d->attrs.fd[i].get();
+        // the planes usually live in the same buffer object
+        if (std::any_of(d->attrs.fd, d->attrs.fd + i, [dmabuf](const KWin::FileDescriptor &other) {
+                return other.get() == dmabuf;
+            })) {
+            continue;
+        }
+        KWin::FileDescriptor planeFence = exportReadFence(dmabuf);
+        if (!planeFence.isValid()) {
+            // A dma-buf polls readable once no write is pending, but unlike a sync file it
+            // also waits for rendering that is submitted later on.
+            return d->attrs.fd[0].duplicate();
+        }
+        fence = fence.isValid() ? mergeFences(std::move(fence), std::move(planeFence)) : std::move(planeFence);
+    }
+    return fence;
+}
+
 QSize LinuxDmaBufV1ClientBuffer::size() const
 {
     Q_D(const LinuxDmaBufV1ClientBuffer);
@@ -15,6 +15,7 @@
 
 #include <QHash>
 #include <QSet>
+#include <functional>
 #include <sys/types.h>
 
 namespace KWaylandServer
@@ -42,6 +43,14 @@ public:
     quint32 flags() const;
     const KWin::DmaBufAttributes &attributes() const;
 
+    /**
+     * Returns a file descriptor that becomes readable once the rendering to the buffer has
+     * finished. It's a sync file with the implicit write fences of the planes at the time of
+     * the call, or the dma-buf itself if the kernel can't export them. An invalid descriptor
+     * is returned if neither is possible.
+     */
+    KWin::FileDescriptor implicitFence() const;
+
     QSize size() const override;
     bool hasAlphaChannel() const override;
     Origin origin() const override;
@@ -116,6 +125,32 @@ public:
          * @return The imported buffer on success, and nullptr otherwise.
          */
         virtual LinuxDmaBufV1ClientBuffer *importBuffer(KWin::DmaBufAttributes &&attrs, quint32 flags) = 0;
+
+        using ImportCallback = std::function<void(LinuxDmaBufV1ClientBuffer *)>;
+
+        /**
+         * Imports a linux-dmabuf buffer like importBuffer(), but the import may finish later,
+         * e.g. on another thread. The @a callback is invoked on the main thread with the
+         * imported buffer, or nullptr if the import has failed. It may be invoked before
+         * this function returns.
+         *
+         * The default implementation imports the buffer synchronously.
+         */
+        virtual void importBufferAsync(KWin::DmaBufAttributes &&attrs, quint32 flags, ImportCallback callback)
+        {
+            callback(importBuffer(std::move(attrs), flags));
+        }
+
+        /**
+         * Creates a buffer object for a linux-dmabuf buffer that may be imported only when
+         * it's used for the first time, so the failure of the import isn't known yet.
+         *
+         * The default implementation imports the buffer right away.
+         */
+        virtual LinuxDmaBufV1ClientBuffer *createBuffer(KWin::DmaBufAttributes &&attrs, quint32 flags)
+        {
+            return importBuffer(std::move(attrs), flags);
+        }
     };
 
     RendererInterface *rendererInterface() const;
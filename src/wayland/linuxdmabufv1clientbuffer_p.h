@@ -81,10 +81,14 @@ protected:
 
 private:
     bool test(Resource *resource, uint32_t width, uint32_t height);
+    void finishCreate(LinuxDmaBufV1ClientBuffer *clientBuffer);
 
     LinuxDmaBufV1ClientBufferIntegration *m_integration;
     KWin::DmaBufAttributes m_attrs;
     bool m_isUsed = false;
+    // The buffer is imported asynchronously, the object lives on until the import is done.
+    bool m_isImporting = false;
+    bool m_isDestroyed = false;
 };
 
 class LinuxDmaBufV1FormatTable
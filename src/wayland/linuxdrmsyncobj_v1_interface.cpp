@@ -0,0 +1,208 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "linuxdrmsyncobj_v1_interface.h"
+#include "core/syncobjtimeline.h"
+#include "display.h"
+#include "linuxdmabufv1clientbuffer.h"
+#include "linuxdrmsyncobj_v1_interface_p.h"
+#include "surface_interface_p.h"
+
+#include <unistd.h>
+#include <xf86drm.h>
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class LinuxDrmSyncObjV1InterfacePrivate : public QtWaylandServer::wp_linux_drm_syncobj_manager_v1
+{
+public:
+    LinuxDrmSyncObjV1InterfacePrivate(Display *display, int drmFd);
+
+    const int drmFd;
+
+protected:
+    void wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id, wl_resource *surface) override;
+    void wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id, int32_t fd) override;
+};
+
+LinuxDrmSyncObjV1InterfacePrivate::LinuxDrmSyncObjV1InterfacePrivate(Display *display, int drmFd)
+    : QtWaylandServer::wp_linux_drm_syncobj_manager_v1(*display, s_version)
+    , drmFd(drmFd)
+{
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id, wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    if (SurfaceInterfacePrivate::get(surface)->syncObjV1) {
+        wl_resource_post_error(resource->handle, error_surface_exists, "the surface already has a syncobj surface");
+        return;
+    }
+
+    wl_resource *syncObjResource = wl_resource_create(resource->client(), &wp_linux_drm_syncobj_surface_v1_interface, resource->version(), id);
+    if (!syncObjResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    new LinuxDrmSyncObjSurfaceV1(surface, syncObjResource);
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id, int32_t fd)
+{
+    uint32_t handle = 0;
+    const int ret = drmSyncobjFDToHandle(drmFd, fd, &handle);
+    ::close(fd);
+    if (ret != 0) {
+        wl_resource_post_error(resource->handle, error_invalid_timeline, "failed to import the timeline: %s", strerror(errno));
+        return;
+    }
+
+    wl_resource *timelineResource = wl_resource_create(resource->client(), &wp_linux_drm_syncobj_timeline_v1_interface, resource->version(), id);
+    if (!timelineResource) {
+        drmSyncobjDestroy(drmFd, handle);
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    new LinuxDrmSyncObjTimelineV1(timelineResource, std::make_unique<KWin::SyncTimeline>(drmFd, handle));
+}
+
+LinuxDrmSyncObjTimelineV1::LinuxDrmSyncObjTimelineV1(wl_resource *resource, std::unique_ptr<KWin::SyncTimeline> &&timeline)
+    : QtWaylandServer::wp_linux_drm_syncobj_timeline_v1(resource)
+    , m_timeline(std::move(timeline))
+{
+}
+
+LinuxDrmSyncObjTimelineV1::~LinuxDrmSyncObjTimelineV1()
+{
+}
+
+LinuxDrmSyncObjTimelineV1 *LinuxDrmSyncObjTimelineV1::get(wl_resource *resource)
+{
+    if (auto timelineResource = Resource::fromResource(resource)) {
+        return static_cast<LinuxDrmSyncObjTimelineV1 *>(timelineResource->object());
+    }
+    return nullptr;
+}
+
+std::shared_ptr<KWin::SyncTimeline> LinuxDrmSyncObjTimelineV1::timeline() const
+{
+    return m_timeline;
+}
+
+void LinuxDrmSyncObjTimelineV1::wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncObjTimelineV1::wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+LinuxDrmSyncObjSurfaceV1::LinuxDrmSyncObjSurfaceV1(SurfaceInterface *surface, wl_resource *resource)
+    : QtWaylandServer::wp_linux_drm_syncobj_surface_v1(resource)
+    , m_surface(surface)
+{
+    SurfaceInterfacePrivate::get(surface)->syncObjV1 = this;
+}
+
+LinuxDrmSyncObjSurfaceV1::~LinuxDrmSyncObjSurfaceV1()
+{
+    if (m_surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(m_surface);
+        surfacePrivate->pending.acquirePoint = {};
+        surfacePrivate->pending.releasePoint = {};
+        surfacePrivate->syncObjV1 = nullptr;
+    }
+}
+
+void LinuxDrmSyncObjSurfaceV1::wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncObjSurfaceV1::wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void LinuxDrmSyncObjSurfaceV1::wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, wl_resource *timeline_resource, uint32_t point_hi, uint32_t point_lo)
+{
+    if (!m_surface) {
+        wl_resource_post_error(resource->handle, error_no_surface, "the surface has been destroyed");
+        return;
+    }
+    SurfaceInterfacePrivate::get(m_surface)->pending.acquirePoint = SyncPoint{
+        .timeline = LinuxDrmSyncObjTimelineV1::get(timeline_resource)->timeline(),
+        .point = (uint64_t(point_hi) << 32) | point_lo,
+    };
+}
+
+void LinuxDrmSyncObjSurfaceV1::wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, wl_resource *timeline_resource, uint32_t point_hi, uint32_t point_lo)
+{
+    if (!m_surface) {
+        wl_resource_post_error(resource->handle, error_no_surface, "the surface has been destroyed");
+        return;
+    }
+    SurfaceInterfacePrivate::get(m_surface)->pending.releasePoint = SyncPoint{
+        .timeline = LinuxDrmSyncObjTimelineV1::get(timeline_resource)->timeline(),
+        .point = (uint64_t(point_hi) << 32) | point_lo,
+    };
+}
+
+bool LinuxDrmSyncObjSurfaceV1::maybeEmitProtocolErrors()
+{
+    const SurfaceState &pending = SurfaceInterfacePrivate::get(m_surface)->pending;
+    const bool hasSyncPoints = pending.acquirePoint.timeline || pending.releasePoint.timeline;
+    if (!pending.bufferIsSet || !pending.buffer) {
+        if (hasSyncPoints) {
+            wl_resource_post_error(resource()->handle, error_no_buffer, "synchronization points were set without a buffer");
+            return false;
+        }
+        return true;
+    }
+    if (!pending.acquirePoint.timeline) {
+        wl_resource_post_error(resource()->handle, error_no_acquire_point, "no acquire point was set for the buffer");
+        return false;
+    }
+    if (!pending.releasePoint.timeline) {
+        wl_resource_post_error(resource()->handle, error_no_release_point, "no release point was set for the buffer");
+        return false;
+    }
+    if (pending.acquirePoint.timeline == pending.releasePoint.timeline && pending.acquirePoint.point >= pending.releasePoint.point) {
+        wl_resource_post_error(resource()->handle, error_conflicting_points, "the acquire point must precede the release point");
+        return false;
+    }
+    if (!qobject_cast<LinuxDmaBufV1ClientBuffer *>(pending.buffer)) {
+        wl_resource_post_error(resource()->handle, error_unsupported_buffer, "only dma-buf buffers can be synchronized explicitly");
+        return false;
+    }
+    return true;
+}
+
+LinuxDrmSyncObjV1Interface::LinuxDrmSyncObjV1Interface(Display *display, int drmFd, QObject *parent)
+    : QObject(parent)
+    , d(new LinuxDrmSyncObjV1InterfacePrivate(display, drmFd))
+{
+}
+
+LinuxDrmSyncObjV1Interface::~LinuxDrmSyncObjV1Interface()
+{
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,43 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+#include <memory>
+
+namespace KWaylandServer
+{
+class Display;
+class LinuxDrmSyncObjV1InterfacePrivate;
+
+/**
+ * The LinuxDrmSyncObjV1Interface class provides the @c wp_linux_drm_syncobj_manager_v1 global,
+ * which lets clients synchronize their dma-buf buffers explicitly with DRM syncobj timelines
+ * instead of relying on implicit fencing.
+ *
+ * The acquire point of a content update is available as SurfaceInterface::acquireFence(),
+ * the release point as SurfaceInterface::releasePoint().
+ */
+class KWIN_EXPORT LinuxDrmSyncObjV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Creates the global, the timelines will be imported on the DRM device @a drmFd. The
+     * device must support timeline syncobjs.
+     */
+    LinuxDrmSyncObjV1Interface(Display *display, int drmFd, QObject *parent = nullptr);
+    ~LinuxDrmSyncObjV1Interface() override;
+
+private:
+    std::unique_ptr<LinuxDrmSyncObjV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
@@ -0,0 +1,65 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "qwayland-server-linux-drm-syncobj-v1.h"
+
+#include <QPointer>
+
+#include <memory>
+
+namespace KWin
+{
+class SyncTimeline;
+}
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+
+class LinuxDrmSyncObjTimelineV1 : public QtWaylandServer::wp_linux_drm_syncobj_timeline_v1
+{
+public:
+    LinuxDrmSyncObjTimelineV1(wl_resource *resource, std::unique_ptr<KWin::SyncTimeline> &&timeline);
+    ~LinuxDrmSyncObjTimelineV1() override;
+
+    static LinuxDrmSyncObjTimelineV1 *get(wl_resource *resource);
+
+    std::shared_ptr<KWin::SyncTimeline> timeline() const;
+
+protected:
+    void wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource) override;
+
+private:
+    // Shared with the surface states and release points that still refer to the timeline.
+    const std::shared_ptr<KWin::SyncTimeline> m_timeline;
+};
+
+class LinuxDrmSyncObjSurfaceV1 : public QtWaylandServer::wp_linux_drm_syncobj_surface_v1
+{
+public:
+    LinuxDrmSyncObjSurfaceV1(SurfaceInterface *surface, wl_resource *resource);
+    ~LinuxDrmSyncObjSurfaceV1() override;
+
+    /**
+     * Checks the pending state of the surface before it's committed. Returns @c false and
+     * posts a protocol error if the synchronization points don't match the attached buffer.
+     */
+    bool maybeEmitProtocolErrors();
+
+protected:
+    void wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, wl_resource *timeline, uint32_t point_hi, uint32_t point_lo) override;
+    void wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, wl_resource *timeline, uint32_t point_hi, uint32_t point_lo) override;
+
+private:
+    QPointer<SurfaceInterface> m_surface;
+};
+
+} // namespace KWaylandServer
@@ -83,6 +83,8 @@ public:
     void sendVrrPolicy(Resource *resource);
     void sendRgbRange(Resource *resource);
 
+    void scheduleDone();
+
     OutputDeviceV2Interface *q;
     QPointer<Display> m_display;
     KWin::Output *m_handle;
@@ -105,6 +107,7 @@ public:
     uint32_t m_overscan = 0;
     vrr_policy m_vrrPolicy = vrr_policy_automatic;
     rgb_range m_rgbRange = rgb_range_automatic;
+    bool m_donePending = false;
 
 protected:
     void kde_output_device_v2_bind_resource(Resource *resource) override;
@@ -315,6 +318,30 @@ void OutputDeviceV2InterfacePrivate::sendDone(Resource *resource)
     send_done(resource->handle);
 }
 
+void OutputDeviceV2InterfacePrivate::scheduleDone()
+{
+    // A hotplug or a new output configuration changes many properties of many outputs at
+    // once, the done event is sent once all of them have been updated.
+    if (m_donePending) {
+        return;
+    }
+    m_donePending = true;
+    QMetaObject::invokeMethod(q, &OutputDeviceV2Interface::done, Qt::QueuedConnection);
+}
+
+void OutputDeviceV2Interface::done()
+{
+    if (!d->m_donePending) {
+        return;
+    }
+    d->m_donePending = false;
+
+    const auto clientResources = d->resourceMap();
+    for (const auto &resource : clientResources) {
+        d->sendDone(resource);
+    }
+}
+
 void OutputDeviceV2InterfacePrivate::sendEdid(Resource *resource)
 {
     send_edid(resource->handle, QString::fromStdString(m_edid.toBase64().toStdString()));
@@ -355,8 +382,8 @@ void OutputDeviceV2Interface::updateGeometry()
     const auto clientResources = d->resourceMap();
     for (const auto &resource : clientResources) {
         d->sendGeometry(resource);
-        d->sendDone(resource);
     }
+    d->scheduleDone();
 }
 
 void OutputDeviceV2Interface::updatePhysicalSize()
@@ -427,8 +454,8 @@ void OutputDeviceV2Interface::updateScale()
     const auto clientResources = d->resourceMap();
     for (const auto &resource : clientResources) {
         d->sendScale(resource);
-        d->sendDone(resource);
     }
+    d->scheduleDone();
 }
 
 void OutputDeviceV2Interface::updateModes()
@@ -459,9 +486,7 @@ void OutputDeviceV2Interface::updateModes()
 
     qDeleteAll(oldModes.crbegin(), oldModes.crend());
 
-    for (auto resource : clientResources) {
-        d->sendDone(resource);
-    }
+    d->scheduleDone();
 }
 
 void OutputDeviceV2Interface::updateCurrentMode()
@@ -473,7 +498,6 @@ void OutputDeviceV2Interface::updateCurrentMode()
                 const auto clientResources = d->resourceMap();
                 for (auto resource : clientResources) {
                     d->sendCurrentMode(resource);
-                    d->sendDone(resource);
                 }
                 updateGeometry();
             }
@@ -488,8 +512,8 @@ void OutputDeviceV2Interface::updateEdid()
     const auto clientResources = d->resourceMap();
     for (const auto &resource : clientResources) {
         d->sendEdid(resource);
-        d->sendDone(resource);
     }
+    d->scheduleDone();
 }
 
 void OutputDeviceV2Interface::updateEnabled()
@@ -500,8 +524,8 @@ void OutputDeviceV2Interface::updateEnabled()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendEnabled(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -513,8 +537,8 @@ void OutputDeviceV2Interface::updateUuid()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendUuid(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -526,8 +550,8 @@ void OutputDeviceV2Interface::updateCapabilities()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendCapabilities(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -539,8 +563,8 @@ void OutputDeviceV2Interface::updateOverscan()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendOverscan(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -552,8 +576,8 @@ void OutputDeviceV2Interface::updateVrrPolicy()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendVrrPolicy(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -565,8 +589,8 @@ void OutputDeviceV2Interface::updateRgbRange()
         const auto clientResources = d->resourceMap();
         for (const auto &resource : clientResources) {
             d->sendRgbRange(resource);
-            d->sendDone(resource);
         }
+        d->scheduleDone();
     }
 }
 
@@ -50,6 +50,14 @@ public:
 
     KWin::Output *handle() const;
 
+    /**
+     * Sends the done event for the properties that have changed since the last one.
+     *
+     * Changes are collected and announced with a single done event when control returns to
+     * the event loop, call this if the clients have to see them earlier.
+     */
+    void done();
+
     static OutputDeviceV2Interface *get(wl_resource *native);
 
 private:
@@ -6,6 +6,7 @@
 */
 #include "outputmanagement_v2_interface.h"
 #include "display.h"
+#include "display_p.h"
 #include "outputdevice_v2_interface.h"
 #include "outputmanagement_v2_interface.h"
 #include "utils/common.h"
@@ -13,6 +14,7 @@
 #include "core/outputconfiguration.h"
 #include "core/platform.h"
 #include "main.h"
+#include "wayland_server.h"
 #include "workspace.h"
 
 #include "qwayland-server-kde-output-management-v2.h"
@@ -233,6 +235,12 @@ void OutputConfigurationV2Interface::kde_output_configuration_v2_apply(Resource
                 workspace()->setPrimaryOutput(requestedPrimaryOutput);
             }
         }
+        // the clients expect to know the new state of the output devices by the time they
+        // are told that the configuration has been applied
+        const auto outputDevices = DisplayPrivate::get(waylandServer()->display())->outputdevicesV2;
+        for (OutputDeviceV2Interface *outputDevice : outputDevices) {
+            outputDevice->done();
+        }
         send_applied();
     } else {
         qCDebug(KWIN_CORE) << "Applying config failed";
@@ -8,7 +8,9 @@
 #include "plasmavirtualdesktop_interface.h"
 #include "surface_interface.h"
 #include "utils/common.h"
+#include "utils/iconcache.h"
 
+#include <QCoreApplication>
 #include <QFile>
 #include <QHash>
 #include <QIcon>
@@ -31,10 +33,11 @@ public:
     PlasmaWindowManagementInterfacePrivate(PlasmaWindowManagementInterface *_q, Display *display);
     void sendShowingDesktopState();
     void sendShowingDesktopState(wl_resource *resource);
-    void sendStackingOrderChanged();
     void sendStackingOrderChanged(wl_resource *resource);
-    void sendStackingOrderUuidsChanged();
-    void sendStackingOrderUuidsChanged(wl_resource *resource);
+    void sendStackingOrderUuidsChanged(wl_resource *resource, const QString &uuids);
+    QString serializeStackingOrderUuids() const;
+    void scheduleStackingOrderUpdate();
+    void sendPendingStackingOrder();
 
     PlasmaWindowManagementInterface::ShowingDesktopState state = PlasmaWindowManagementInterface::ShowingDesktopState::Disabled;
     QList<PlasmaWindowInterface *> windows;
@@ -42,6 +45,11 @@ public:
     quint32 windowIdCounter = 0;
     QVector<quint32> stackingOrder;
     QVector<QString> stackingOrderUuids;
+    // The stacking order changes several times while a window gets activated, the clients
+    // only get the final one, once per event loop iteration.
+    QVector<quint32> sentStackingOrder;
+    QVector<QString> sentStackingOrderUuids;
+    bool stackingOrderUpdateScheduled = false;
     PlasmaWindowManagementInterface *q;
 
 protected:
@@ -142,46 +150,72 @@ void PlasmaWindowManagementInterfacePrivate::sendShowingDesktopState(wl_resource
     send_show_desktop_changed(r, s);
 }
 
-void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged()
+void PlasmaWindowManagementInterfacePrivate::scheduleStackingOrderUpdate()
 {
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        sendStackingOrderChanged(resource->handle);
+    if (stackingOrderUpdateScheduled) {
+        return;
     }
+    stackingOrderUpdateScheduled = true;
+    QMetaObject::invokeMethod(
+        q, [this]() {
+            sendPendingStackingOrder();
+        },
+        Qt::QueuedConnection);
 }
 
-void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged(wl_resource *r)
+void PlasmaWindowManagementInterfacePrivate::sendPendingStackingOrder()
 {
-    if (wl_resource_get_version(r) < ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STACKING_ORDER_CHANGED_SINCE_VERSION) {
+    stackingOrderUpdateScheduled = false;
+
+    const bool stackingOrderChanged = sentStackingOrder != stackingOrder;
+    const bool stackingOrderUuidsChanged = sentStackingOrderUuids != stackingOrderUuids;
+    if (!stackingOrderChanged && !stackingOrderUuidsChanged) {
         return;
     }
+    sentStackingOrder = stackingOrder;
+    sentStackingOrderUuids = stackingOrderUuids;
 
-    send_stacking_order_changed(r, QByteArray::fromRawData(reinterpret_cast<const char *>(stackingOrder.constData()), sizeof(uint32_t) * stackingOrder.size()));
-}
-
-void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged()
-{
+    // serialize once rather than for every bound client
+    const QString uuids = stackingOrderUuidsChanged ? serializeStackingOrderUuids() : QString();
     const auto clientResources = resourceMap();
     for (auto resource : clientResources) {
-        sendStackingOrderUuidsChanged(resource->handle);
+        if (stackingOrderChanged) {
+            sendStackingOrderChanged(resource->handle);
+        }
+        if (stackingOrderUuidsChanged) {
+            sendStackingOrderUuidsChanged(resource->handle, uuids);
+        }
     }
 }
 
-void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged(wl_resource *r)
+void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged(wl_resource *r)
 {
-    if (wl_resource_get_version(r) < ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STACKING_ORDER_UUID_CHANGED_SINCE_VERSION) {
+    if (wl_resource_get_version(r) < ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STACKING_ORDER_CHANGED_SINCE_VERSION) {
         return;
     }
 
+    send_stacking_order_changed(r, QByteArray::fromRawData(reinterpret_cast<const char *>(sentStackingOrder.constData()), sizeof(uint32_t) * sentStackingOrder.size()));
+}
+
+QString PlasmaWindowManagementInterfacePrivate::serializeStackingOrderUuids() const
+{
     QString uuids;
-    for (const auto &uuid : qAsConst(stackingOrderUuids)) {
+    for (const auto &uuid : qAsConst(sentStackingOrderUuids)) {
         uuids += uuid;
         uuids += QLatin1Char(';');
     }
     // Remove the trailing ';', on the receiving side this is interpreted as an empty uuid.
-    if (stackingOrderUuids.size() > 0) {
+    if (sentStackingOrderUuids.size() > 0) {
         uuids.remove(uuids.length() - 1, 1);
     }
+    return uuids;
+}
+
+void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged(wl_resource *r, const QString &uuids)
+{
+    if (wl_resource_get_version(r) < ORG_KDE_PLASMA_WINDOW_MANAGEMENT_STACKING_ORDER_UUID_CHANGED_SINCE_VERSION) {
+        return;
+    }
     send_stacking_order_uuid_changed(r, uuids);
 }
 
@@ -194,8 +228,9 @@ void PlasmaWindowManagementInterfacePrivate::org_kde_plasma_window_management_bi
             send_window(resource->handle, window->d->windowId);
         }
     }
+    // a pending update will reach this client too
     sendStackingOrderChanged(resource->handle);
-    sendStackingOrderUuidsChanged(resource->handle);
+    sendStackingOrderUuidsChanged(resource->handle, serializeStackingOrderUuids());
 }
 
 void PlasmaWindowManagementInterfacePrivate::org_kde_plasma_window_management_show_desktop(Resource *resource, uint32_t state)
@@ -294,7 +329,7 @@ void PlasmaWindowManagementInterface::setStackingOrder(const QVector<quint32> &s
         return;
     }
     d->stackingOrder = stackingOrder;
-    d->sendStackingOrderChanged();
+    d->scheduleStackingOrderUpdate();
 }
 
 void PlasmaWindowManagementInterface::setStackingOrderUuids(const QVector<QString> &stackingOrderUuids)
@@ -303,7 +338,7 @@ void PlasmaWindowManagementInterface::setStackingOrderUuids(const QVector<QStrin
         return;
     }
     d->stackingOrderUuids = stackingOrderUuids;
-    d->sendStackingOrderUuidsChanged();
+    d->scheduleStackingOrderUpdate();
 }
 
 void PlasmaWindowManagementInterface::setPlasmaVirtualDesktopManagementInterface(PlasmaVirtualDesktopManagementInterface *manager)
@@ -455,13 +490,36 @@ void PlasmaWindowInterfacePrivate::setResourceName(const QString &resourceName)
 void PlasmaWindowInterfacePrivate::org_kde_plasma_window_get_icon(Resource *resource, int32_t fd)
 {
     Q_UNUSED(resource)
+    // The icons of windows are shared, so are their encoded forms. An icon is encoded the first
+    // time it's requested, later requests for it only write the payload.
+    const QByteArray payload = IconCache::payload(m_icon);
+    if (!payload.isEmpty()) {
+        QtConcurrent::run(
+            [fd](const QByteArray &payload) {
+                QFile file;
+                file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
+                file.write(payload);
+                file.close();
+            },
+            payload);
+        return;
+    }
     QtConcurrent::run(
         [fd](const QIcon &icon) {
+            QByteArray payload;
+            QDataStream ds(&payload, QIODevice::WriteOnly);
+            ds << icon;
+
             QFile file;
             file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
-            QDataStream ds(&file);
-            ds << icon;
+            file.write(payload);
             file.close();
+
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(), [icon, payload]() {
+                    IconCache::setPayload(icon, payload);
+                },
+                Qt::QueuedConnection);
         },
         m_icon);
 }
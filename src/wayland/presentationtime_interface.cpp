@@ -0,0 +1,125 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "presentationtime_interface.h"
+#include "clientconnection.h"
+#include "display.h"
+#include "output_interface.h"
+#include "surface_interface_p.h"
+
+#include "qwayland-server-presentation-time.h"
+
+#include <time.h>
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class PresentationTimeInterfacePrivate : public QtWaylandServer::wp_presentation
+{
+public:
+    PresentationTimeInterfacePrivate(Display *display);
+
+protected:
+    void wp_presentation_bind_resource(Resource *resource) override;
+    void wp_presentation_destroy(Resource *resource) override;
+    void wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface, uint32_t callback) override;
+};
+
+PresentationTimeInterfacePrivate::PresentationTimeInterfacePrivate(Display *display)
+    : QtWaylandServer::wp_presentation(*display, s_version)
+{
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_bind_resource(Resource *resource)
+{
+    send_clock_id(resource->handle, CLOCK_MONOTONIC);
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface_resource, uint32_t callback)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+
+    wl_resource *feedbackResource = wl_resource_create(resource->client(), &wp_presentation_feedback_interface, resource->version(), callback);
+    if (!feedbackResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    // The feedback object has no requests, it's destroyed after the presented or discarded event.
+    wl_resource_set_implementation(feedbackResource, nullptr, nullptr, [](wl_resource *resource) {
+        wl_list_remove(wl_resource_get_link(resource));
+    });
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    wl_list_insert(surfacePrivate->pending.presentationFeedbacks.prev, wl_resource_get_link(feedbackResource));
+}
+
+PresentationTimeInterface::PresentationTimeInterface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new PresentationTimeInterfacePrivate(display))
+{
+}
+
+PresentationTimeInterface::~PresentationTimeInterface()
+{
+}
+
+void discardPresentationFeedbacks(wl_list *resources)
+{
+    wl_resource *resource;
+    wl_resource *tmp;
+    wl_resource_for_each_safe (resource, tmp, resources) {
+        wp_presentation_feedback_send_discarded(resource);
+        wl_resource_destroy(resource);
+    }
+}
+
+PresentationFeedback::PresentationFeedback(wl_list *resources, OutputInterface *output)
+    : m_output(output)
+{
+    wl_list_init(&m_resources);
+    wl_list_insert_list(&m_resources, resources);
+    wl_list_init(resources);
+}
+
+PresentationFeedback::~PresentationFeedback()
+{
+    discardPresentationFeedbacks(&m_resources);
+}
+
+void PresentationFeedback::presented(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refreshInterval, quint64 sequence, Kinds kinds)
+{
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp);
+    const auto nanoseconds = timestamp - seconds;
+    const quint64 tvSec = seconds.count();
+
+    wl_resource *resource;
+    wl_resource *tmp;
+    wl_resource_for_each_safe (resource, tmp, &m_resources) {
+        if (m_output) {
+            ClientConnection *client = m_output->display()->getConnection(wl_resource_get_client(resource));
+            const QVector<wl_resource *> outputResources = m_output->clientResources(client);
+            for (wl_resource *outputResource : outputResources) {
+                wp_presentation_feedback_send_sync_output(resource, outputResource);
+            }
+        }
+        wp_presentation_feedback_send_presented(resource,
+                                                tvSec >> 32, tvSec & 0xffffffff,
+                                                nanoseconds.count(),
+                                                refreshInterval.count(),
+                                                sequence >> 32, sequence & 0xffffffff,
+                                                uint32_t(kinds));
+        wl_resource_destroy(resource);
+    }
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,82 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+#include <QPointer>
+
+#include <chrono>
+#include <memory>
+
+#include <wayland-server-core.h>
+
+namespace KWaylandServer
+{
+class Display;
+class OutputInterface;
+class PresentationTimeInterfacePrivate;
+
+/**
+ * The PresentationTimeInterface class provides the @c wp_presentation global, which lets
+ * clients know when exactly their content updates have been shown on the screen.
+ *
+ * The presentation clock is @c CLOCK_MONOTONIC.
+ */
+class KWIN_EXPORT PresentationTimeInterface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PresentationTimeInterface(Display *display, QObject *parent = nullptr);
+    ~PresentationTimeInterface() override;
+
+private:
+    std::unique_ptr<PresentationTimeInterfacePrivate> d;
+};
+
+/**
+ * The PresentationFeedback class holds the @c wp_presentation_feedback objects that have been
+ * requested for a content update of a surface. The feedback is taken from the surface when
+ * the content update is painted, and sent when the frame that shows it is presented.
+ *
+ * If the feedback is destroyed before presented() has been called, the content update is
+ * reported to the client as discarded.
+ */
+class KWIN_EXPORT PresentationFeedback
+{
+public:
+    enum class Kind {
+        Vsync = 0x1,
+        HwClock = 0x2,
+        HwCompletion = 0x4,
+        ZeroCopy = 0x8,
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    /**
+     * Takes over the wp_presentation_feedback resources linked in @a resources.
+     */
+    PresentationFeedback(wl_list *resources, OutputInterface *output);
+    ~PresentationFeedback();
+
+    /**
+     * Sends the presented event to all feedback objects. The @a refreshInterval must be zero
+     * if the output has no constant refresh rate, the @a sequence must be zero if it's unknown.
+     */
+    void presented(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refreshInterval, quint64 sequence, Kinds kinds);
+
+private:
+    wl_list m_resources;
+    QPointer<OutputInterface> m_output;
+    Q_DISABLE_COPY(PresentationFeedback)
+};
+
+} // namespace KWaylandServer
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWaylandServer::PresentationFeedback::Kinds)
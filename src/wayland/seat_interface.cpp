@@ -25,6 +25,7 @@
 #include "relativepointer_v1_interface_p.h"
 #include "seat_interface_p.h"
 #include "surface_interface.h"
+#include "surface_interface_p.h"
 #include "textinput_v2_interface_p.h"
 #include "textinput_v3_interface_p.h"
 #include "touch_interface_p.h"
@@ -33,6 +34,7 @@
 
 #include <linux/input.h>
 
+#include <cmath>
 #include <functional>
 
 namespace KWaylandServer
@@ -472,13 +474,7 @@ void SeatInterface::notifyPointerMotion(const QPointF &pos)
     }
 
     QPointF localPosition = focusedPointerSurfaceTransformation().map(pos);
-    SurfaceInterface *effectiveFocusedSurface = focusedSurface->inputSurfaceAt(localPosition);
-    if (!effectiveFocusedSurface) {
-        effectiveFocusedSurface = focusedSurface;
-    }
-    if (focusedSurface != effectiveFocusedSurface) {
-        localPosition = focusedSurface->mapToChild(effectiveFocusedSurface, localPosition);
-    }
+    SurfaceInterface *effectiveFocusedSurface = d->pointerInputSurfaceAt(focusedSurface, &localPosition);
 
     if (d->pointer->focusedSurface() != effectiveFocusedSurface) {
         d->pointer->sendEnter(effectiveFocusedSurface, localPosition, display()->nextSerial());
@@ -487,6 +483,36 @@ void SeatInterface::notifyPointerMotion(const QPointF &pos)
     d->pointer->sendMotion(localPosition);
 }
 
+SurfaceInterface *SeatInterfacePrivate::pointerInputSurfaceAt(SurfaceInterface *surface, QPointF *position)
+{
+    // Most motion events stay within the same surface, which doesn't need a walk through the
+    // surface tree then.
+    auto &cache = globalPointer.focus.inputCache;
+    if (cache.surface && cache.generation == SurfaceInterfacePrivate::inputGeneration) {
+        const QPointF local = *position - cache.offset;
+        if (SurfaceInterfacePrivate::get(cache.surface)->contains(local)
+            && cache.region.contains(QPoint(std::floor(local.x()), std::floor(local.y())))) {
+            *position = local;
+            return cache.surface;
+        }
+    }
+
+    QPoint offset;
+    QRegion region;
+    SurfaceInterface *effectiveSurface = SurfaceInterfacePrivate::get(surface)->inputSurfaceAt(*position, &offset, &region);
+    if (!effectiveSurface) {
+        cache = {};
+        return surface;
+    }
+
+    cache.surface = effectiveSurface;
+    cache.offset = offset;
+    cache.region = region;
+    cache.generation = SurfaceInterfacePrivate::inputGeneration;
+    *position -= offset;
+    return effectiveSurface;
+}
+
 quint32 SeatInterface::timestamp() const
 {
     return d->timestamp;
@@ -592,13 +618,7 @@ void SeatInterface::notifyPointerEnter(SurfaceInterface *surface, const QPointF
 
     d->globalPointer.pos = position;
     QPointF localPosition = focusedPointerSurfaceTransformation().map(position);
-    SurfaceInterface *effectiveFocusedSurface = surface->inputSurfaceAt(localPosition);
-    if (!effectiveFocusedSurface) {
-        effectiveFocusedSurface = surface;
-    }
-    if (surface != effectiveFocusedSurface) {
-        localPosition = surface->mapToChild(effectiveFocusedSurface, localPosition);
-    }
+    SurfaceInterface *effectiveFocusedSurface = d->pointerInputSurfaceAt(surface, &localPosition);
     d->pointer->sendEnter(effectiveFocusedSurface, localPosition, serial);
 }
 
@@ -12,6 +12,7 @@
 #include <QHash>
 #include <QMap>
 #include <QPointer>
+#include <QRegion>
 #include <QVector>
 
 #include <optional>
@@ -86,10 +87,25 @@ public:
             QPointF offset = QPointF();
             QMatrix4x4 transformation;
             quint32 serial = 0;
+
+            // The surface of the focused surface tree that got the last event. As long as
+            // the input regions don't change, it gets all input in the region.
+            struct
+            {
+                QPointer<SurfaceInterface> surface;
+                QPoint offset;
+                QRegion region;
+                quint64 generation = 0;
+            } inputCache;
         };
         Focus focus;
     };
     Pointer globalPointer;
+    /**
+     * Returns the surface of the tree of @a surface that receives pointer input at @a position
+     * and maps @a position to it. Falls back to @a surface.
+     */
+    SurfaceInterface *pointerInputSurfaceAt(SurfaceInterface *surface, QPointF *position);
     void updatePointerButtonSerial(quint32 button, quint32 serial);
     void updatePointerButtonState(quint32 button, Pointer::State state);
 
@@ -7,67 +7,311 @@
 #include "shmclientbuffer.h"
 #include "clientbuffer_p.h"
 #include "display.h"
+#include "display_p.h"
+#include "utils/filedescriptor.h"
+
+#include "qwayland-server-wayland.h"
 
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace KWaylandServer
 {
-static const ShmClientBuffer *s_accessedBuffer = nullptr;
-static int s_accessCounter = 0;
+static const int s_version = 1;
+
+// mappings at least this big are worth backing with huge pages
+static const size_t s_hugePageThreshold = 2 * 1024 * 1024;
 
-class ShmClientBufferPrivate : public ClientBufferPrivate
+static const uint32_t s_formats[] = {
+    WL_SHM_FORMAT_ARGB8888,
+    WL_SHM_FORMAT_XRGB8888,
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    WL_SHM_FORMAT_ARGB2101010,
+    WL_SHM_FORMAT_XRGB2101010,
+    WL_SHM_FORMAT_ABGR2101010,
+    WL_SHM_FORMAT_XBGR2101010,
+    WL_SHM_FORMAT_ABGR16161616,
+    WL_SHM_FORMAT_XBGR16161616,
+#endif
+};
+
+/**
+ * A mapping of the memory of a shm pool. The images handed out by ShmClientBuffer::data()
+ * share it, so it stays valid while they are around even if the pool is remapped.
+ */
+class ShmMapping
 {
 public:
-    ShmClientBufferPrivate(ShmClientBuffer *q);
+    ShmMapping(uchar *data, size_t size)
+        : data(data)
+        , size(size)
+    {
+    }
+    ~ShmMapping()
+    {
+        munmap(data, size);
+    }
 
-    static void buffer_destroy_callback(wl_listener *listener, void *data);
+    uchar *data;
+    // the size of the address range, it can be larger than the pool
+    size_t size;
+};
 
-    ShmClientBuffer *q;
-    QImage::Format format = QImage::Format_Invalid;
-    uint32_t width = 0;
-    uint32_t height = 0;
-    bool hasAlphaChannel = false;
-    QImage savedData;
+static void adviseMapping(void *data, size_t size)
+{
+#if defined(MADV_HUGEPAGE)
+    if (size >= s_hugePageThreshold) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+}
 
-    struct DestroyListener
-    {
-        wl_listener listener;
-        ShmClientBufferPrivate *receiver;
-    };
-    DestroyListener destroyListener;
+static std::shared_ptr<ShmMapping> mapPool(int fd, size_t size)
+{
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    // The client has already written to the pages, prefault them so that the first upload
+    // doesn't take a page fault on every one of them.
+    flags |= MAP_POPULATE;
+#endif
+    void *data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    adviseMapping(data, size);
+    return std::make_shared<ShmMapping>(static_cast<uchar *>(data), size);
+}
+
+/**
+ * Returns whether reading the first @a size bytes of the file can't raise a SIGBUS. That's
+ * the case if the client can't shrink the file anymore, i.e. it's a sealed memfd.
+ */
+static bool isSigbusImpossible(int fd, qint64 size)
+{
+    const int seals = fcntl(fd, F_GET_SEALS);
+    if (seals == -1 || !(seals & F_SEAL_SHRINK)) {
+        return false;
+    }
+    struct stat info;
+    return fstat(fd, &info) == 0 && info.st_size >= size;
+}
+
+class ShmPool : public QtWaylandServer::wl_shm_pool
+{
+public:
+    ShmPool(ShmClientBufferIntegration *integration, wl_client *client, int id, int version, KWin::FileDescriptor &&fd, std::shared_ptr<ShmMapping> &&mapping, qint64 size);
+
+    static ShmPool *get(wl_resource *resource);
+
+    void ref();
+    void unref();
+
+    ShmClientBufferIntegration *integration;
+    KWin::FileDescriptor fd;
+    std::shared_ptr<ShmMapping> mapping;
+    // the size of the pool, as told by the client
+    qint64 size;
+    bool sigbusImpossible;
+
+protected:
+    void shm_pool_destroy_resource(Resource *resource) override;
+    void shm_pool_create_buffer(Resource *resource, uint32_t id, int32_t offset, int32_t width, int32_t height, int32_t stride, uint32_t format) override;
+    void shm_pool_destroy(Resource *resource) override;
+    void shm_pool_resize(Resource *resource, int32_t size) override;
+
+private:
+    bool grow(size_t size);
+
+    int refCount = 1;
+};
+
+ShmPool::ShmPool(ShmClientBufferIntegration *integration, wl_client *client, int id, int version, KWin::FileDescriptor &&fd, std::shared_ptr<ShmMapping> &&mapping, qint64 size)
+    : QtWaylandServer::wl_shm_pool(client, id, version)
+    , integration(integration)
+    , fd(std::move(fd))
+    , mapping(std::move(mapping))
+    , size(size)
+    , sigbusImpossible(isSigbusImpossible(this->fd.get(), size))
+{
+}
+
+ShmPool *ShmPool::get(wl_resource *resource)
+{
+    if (auto poolResource = Resource::fromResource(resource)) {
+        return static_cast<ShmPool *>(poolResource->shm_pool_object);
+    }
+    return nullptr;
+}
+
+void ShmPool::ref()
+{
+    refCount++;
+}
+
+void ShmPool::unref()
+{
+    if (--refCount == 0) {
+        delete this;
+    }
+}
+
+void ShmPool::shm_pool_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    unref();
+}
+
+void ShmPool::shm_pool_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+static int bytesPerPixel(uint32_t format)
+{
+    switch (format) {
+    case WL_SHM_FORMAT_ABGR16161616:
+    case WL_SHM_FORMAT_XBGR16161616:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+void ShmPool::shm_pool_create_buffer(Resource *resource, uint32_t id, int32_t offset, int32_t width, int32_t height, int32_t stride, uint32_t format)
+{
+    if (std::find(std::begin(s_formats), std::end(s_formats), format) == std::end(s_formats)) {
+        wl_resource_post_error(resource->handle, WL_SHM_ERROR_INVALID_FORMAT, "invalid format 0x%x", format);
+        return;
+    }
+
+    if (offset < 0 || width <= 0 || height <= 0 || stride < qint64(width) * bytesPerPixel(format)
+        || qint64(stride) * height > size - offset) {
+        wl_resource_post_error(resource->handle, WL_SHM_ERROR_INVALID_STRIDE, "invalid width, height or stride (%dx%d, %d)", width, height, stride);
+        return;
+    }
+
+    wl_resource *bufferResource = wl_resource_create(resource->client(), &wl_buffer_interface, 1, id);
+    if (!bufferResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    auto buffer = new ShmClientBuffer(this, ShmAttributes{offset, width, height, stride, format}, bufferResource);
+    DisplayPrivate::get(integration->display())->registerClientBuffer(buffer);
+}
+
+void ShmPool::shm_pool_resize(Resource *resource, int32_t newSize)
+{
+    if (newSize < size) {
+        wl_resource_post_error(resource->handle, WL_SHM_ERROR_INVALID_FD, "shrinking pool invalid");
+        return;
+    }
+
+    if (size_t(newSize) > mapping->size) {
+        // Clients that resize their pools usually do so many times in a row, e.g. while their
+        // window is being resized. Map more than asked for, so that most resizes fit into the
+        // existing mapping. Only the address space is reserved, nothing beyond the pool is read.
+        if (!grow(std::max(size_t(newSize), mapping->size + mapping->size / 2))) {
+            wl_resource_post_error(resource->handle, WL_SHM_ERROR_INVALID_FD, "failed to map the pool: %s", strerror(errno));
+            return;
+        }
+    }
+#if defined(MADV_WILLNEED)
+    // madvise() wants a page aligned start, the mapping itself is
+    const qint64 start = size & ~qint64(sysconf(_SC_PAGESIZE) - 1);
+    madvise(mapping->data + start, newSize - start, MADV_WILLNEED);
+#endif
+
+    size = newSize;
+    sigbusImpossible = isSigbusImpossible(fd.get(), size);
+}
+
+bool ShmPool::grow(size_t newSize)
+{
+#if defined(Q_OS_LINUX)
+    // Growing the mapping in place keeps the images that have been handed out valid.
+    void *data = mremap(mapping->data, mapping->size, newSize, 0);
+    if (data != MAP_FAILED) {
+        mapping->size = newSize;
+        adviseMapping(mapping->data, newSize);
+        return true;
+    }
+#endif
+
+    std::shared_ptr<ShmMapping> newMapping = mapPool(fd.get(), newSize);
+    if (!newMapping) {
+        return false;
+    }
+    mapping = std::move(newMapping);
+    return true;
+}
+
+class ShmClientBufferIntegrationPrivate : public QtWaylandServer::wl_shm
+{
+public:
+    ShmClientBufferIntegrationPrivate(Display *display, ShmClientBufferIntegration *q);
+
+    ShmClientBufferIntegration *q;
+
+protected:
+    void shm_bind_resource(Resource *resource) override;
+    void shm_create_pool(Resource *resource, uint32_t id, int32_t fd, int32_t size) override;
 };
 
-ShmClientBufferPrivate::ShmClientBufferPrivate(ShmClientBuffer *q)
-    : q(q)
+ShmClientBufferIntegrationPrivate::ShmClientBufferIntegrationPrivate(Display *display, ShmClientBufferIntegration *q)
+    : QtWaylandServer::wl_shm(*display, s_version)
+    , q(q)
 {
 }
 
-static void cleanupShmPool(void *poolHandle)
+void ShmClientBufferIntegrationPrivate::shm_bind_resource(Resource *resource)
 {
-    wl_shm_pool_unref(static_cast<wl_shm_pool *>(poolHandle));
+    for (uint32_t format : s_formats) {
+        send_format(resource->handle, format);
+    }
 }
 
-void ShmClientBufferPrivate::buffer_destroy_callback(wl_listener *listener, void *data)
+void ShmClientBufferIntegrationPrivate::shm_create_pool(Resource *resource, uint32_t id, int32_t fd, int32_t size)
 {
-    Q_UNUSED(data)
+    KWin::FileDescriptor fileDescriptor(fd);
 
-    auto bufferPrivate = reinterpret_cast<ShmClientBufferPrivate::DestroyListener *>(listener)->receiver;
-    wl_shm_buffer *buffer = wl_shm_buffer_get(bufferPrivate->q->resource());
-    wl_shm_pool *pool = wl_shm_buffer_ref_pool(buffer);
+    if (size <= 0) {
+        wl_resource_post_error(resource->handle, error_invalid_stride, "invalid size (%d)", size);
+        return;
+    }
 
-    wl_list_remove(&bufferPrivate->destroyListener.listener.link);
-    wl_list_init(&bufferPrivate->destroyListener.listener.link);
+    std::shared_ptr<ShmMapping> mapping = mapPool(fileDescriptor.get(), size);
+    if (!mapping) {
+        wl_resource_post_error(resource->handle, error_invalid_fd, "failed to map the pool: %s", strerror(errno));
+        return;
+    }
 
-    bufferPrivate->savedData = QImage(static_cast<const uchar *>(wl_shm_buffer_get_data(buffer)),
-                                      bufferPrivate->width,
-                                      bufferPrivate->height,
-                                      wl_shm_buffer_get_stride(buffer),
-                                      bufferPrivate->format,
-                                      cleanupShmPool,
-                                      pool);
+    new ShmPool(q, resource->client(), id, resource->version(), std::move(fileDescriptor), std::move(mapping), size);
 }
 
+class ShmClientBufferPrivate : public ClientBufferPrivate, public QtWaylandServer::wl_buffer
+{
+public:
+    ShmClientBufferPrivate(ShmPool *pool, const ShmAttributes &attributes);
+    ~ShmClientBufferPrivate() override;
+
+    ShmPool *pool;
+    ShmAttributes attributes;
+    QImage::Format format = QImage::Format_Invalid;
+    bool hasAlphaChannel = false;
+
+protected:
+    void buffer_destroy(Resource *resource) override;
+};
+
 static bool alphaChannelFromFormat(uint32_t format)
 {
     switch (format) {
@@ -111,28 +355,40 @@ static QImage::Format imageFormatForShmFormat(uint32_t format)
     }
 }
 
-ShmClientBuffer::ShmClientBuffer(wl_resource *resource)
-    : ClientBuffer(resource, *new ShmClientBufferPrivate(this))
+ShmClientBufferPrivate::ShmClientBufferPrivate(ShmPool *pool, const ShmAttributes &attributes)
+    : pool(pool)
+    , attributes(attributes)
+    , format(imageFormatForShmFormat(attributes.format))
+    , hasAlphaChannel(alphaChannelFromFormat(attributes.format))
 {
-    Q_D(ShmClientBuffer);
+    // The pool stays around as long as the buffer, so the contents can still be accessed
+    // after the client has destroyed the wl_buffer.
+    pool->ref();
+}
+
+ShmClientBufferPrivate::~ShmClientBufferPrivate()
+{
+    pool->unref();
+}
 
-    wl_shm_buffer *buffer = wl_shm_buffer_get(resource);
-    d->width = wl_shm_buffer_get_width(buffer);
-    d->height = wl_shm_buffer_get_height(buffer);
-    d->hasAlphaChannel = alphaChannelFromFormat(wl_shm_buffer_get_format(buffer));
-    d->format = imageFormatForShmFormat(wl_shm_buffer_get_format(buffer));
+void ShmClientBufferPrivate::buffer_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
 
-    // The underlying shm pool will be referenced if the wl_shm_buffer is destroyed so the
-    // compositor can access buffer data even after the buffer is gone.
-    d->destroyListener.receiver = d;
-    d->destroyListener.listener.notify = ShmClientBufferPrivate::buffer_destroy_callback;
-    wl_resource_add_destroy_listener(resource, &d->destroyListener.listener);
+ShmClientBuffer::ShmClientBuffer(ShmPool *pool, const ShmAttributes &attributes, wl_resource *resource)
+    : ClientBuffer(resource, *new ShmClientBufferPrivate(pool, attributes))
+{
+    Q_D(ShmClientBuffer);
+    d->init(resource);
 }
 
+ShmClientBuffer::~ShmClientBuffer() = default;
+
 QSize ShmClientBuffer::size() const
 {
     Q_D(const ShmClientBuffer);
-    return QSize(d->width, d->height);
+    return QSize(d->attributes.width, d->attributes.height);
 }
 
 bool ShmClientBuffer::hasAlphaChannel() const
@@ -146,54 +402,60 @@ ClientBuffer::Origin ShmClientBuffer::origin() const
     return Origin::TopLeft;
 }
 
-static void cleanupShmData(void *bufferHandle)
+static void releaseMapping(void *mapping)
 {
-    Q_ASSERT_X(s_accessCounter > 0, "cleanup", "access counter must be positive");
-    s_accessCounter--;
-    if (s_accessCounter == 0) {
-        s_accessedBuffer = nullptr;
-    }
-    wl_shm_buffer_end_access(static_cast<wl_shm_buffer *>(bufferHandle));
+    delete static_cast<std::shared_ptr<ShmMapping> *>(mapping);
+}
+
+static void releaseCopy(void *data)
+{
+    delete[] static_cast<uchar *>(data);
 }
 
 QImage ShmClientBuffer::data() const
 {
-    if (s_accessedBuffer && s_accessedBuffer != this) {
-        return QImage();
+    Q_D(const ShmClientBuffer);
+    const ShmAttributes &attributes = d->attributes;
+
+    if (d->pool->sigbusImpossible) {
+        auto mapping = new std::shared_ptr<ShmMapping>(d->pool->mapping);
+        const uchar *data = (*mapping)->data + attributes.offset;
+        return QImage(data, attributes.width, attributes.height, attributes.stride, d->format, releaseMapping, mapping);
     }
 
-    Q_D(const ShmClientBuffer);
-    if (wl_shm_buffer *buffer = wl_shm_buffer_get(resource())) {
-        s_accessedBuffer = this;
-        s_accessCounter++;
-        wl_shm_buffer_begin_access(buffer);
-        const uchar *data = static_cast<const uchar *>(wl_shm_buffer_get_data(buffer));
-        const uint32_t stride = wl_shm_buffer_get_stride(buffer);
-        return QImage(data, d->width, d->height, stride, d->format, cleanupShmData, buffer);
+    // The client can truncate the file at any time, reading the mapping could raise a SIGBUS
+    // then. pread() fails gracefully instead, and doesn't need a signal handler.
+    const size_t byteCount = size_t(attributes.stride) * attributes.height;
+    uchar *data = new uchar[byteCount];
+    size_t offset = 0;
+    while (offset < byteCount) {
+        const ssize_t ret = pread(d->pool->fd.get(), data + offset, byteCount - offset, attributes.offset + offset);
+        if (ret > 0) {
+            offset += ret;
+        } else if (ret == -1 && errno == EINTR) {
+            continue;
+        } else {
+            std::memset(data + offset, 0, byteCount - offset);
+            break;
+        }
     }
-    return d->savedData;
+    return QImage(data, attributes.width, attributes.height, attributes.stride, d->format, releaseCopy, data);
 }
 
 ShmClientBufferIntegration::ShmClientBufferIntegration(Display *display)
     : ClientBufferIntegration(display)
+    , d(std::make_unique<ShmClientBufferIntegrationPrivate>(display, this))
 {
-#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_ARGB2101010);
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_XRGB2101010);
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_ABGR2101010);
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_XBGR2101010);
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_ABGR16161616);
-    wl_display_add_shm_format(*display, WL_SHM_FORMAT_XBGR16161616);
-#endif
-    wl_display_init_shm(*display);
 }
 
-ClientBuffer *ShmClientBufferIntegration::createBuffer(::wl_resource *resource)
+ShmClientBufferIntegration::~ShmClientBufferIntegration() = default;
+
+qint64 ShmClientBufferIntegration::poolSize(wl_resource *resource)
 {
-    if (wl_shm_buffer_get(resource)) {
-        return new ShmClientBuffer(resource);
+    if (ShmPool *pool = ShmPool::get(resource)) {
+        return pool->size;
     }
-    return nullptr;
+    return 0;
 }
 
 } // namespace KWaylandServer
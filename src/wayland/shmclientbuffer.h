@@ -9,15 +9,28 @@
 #include "clientbuffer.h"
 #include "clientbufferintegration.h"
 
+#include <memory>
+
 namespace KWaylandServer
 {
 class ShmClientBufferPrivate;
+class ShmClientBufferIntegrationPrivate;
+class ShmPool;
+
+struct ShmAttributes
+{
+    int32_t offset = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t stride = 0;
+    uint32_t format = 0;
+};
 
 /**
  * The ShmClientBuffer class represents a wl_shm_buffer client buffer.
  *
- * The buffer's data can be accessed using the data() function. Note that it is not allowed
- * to access data of several shared memory buffers simultaneously.
+ * The buffer's data can be accessed using the data() function. The data of several buffers
+ * can be accessed at the same time.
  */
 class KWIN_EXPORT ShmClientBuffer : public ClientBuffer
 {
@@ -25,8 +38,14 @@ class KWIN_EXPORT ShmClientBuffer : public ClientBuffer
     Q_DECLARE_PRIVATE(ShmClientBuffer)
 
 public:
-    explicit ShmClientBuffer(wl_resource *resource);
+    ShmClientBuffer(ShmPool *pool, const ShmAttributes &attributes, wl_resource *resource);
+    ~ShmClientBuffer() override;
 
+    /**
+     * Returns the contents of the buffer. If the client can't truncate the memory of the
+     * pool, the image refers to it directly; otherwise it's a copy, so that KWin can't be
+     * brought down by a SIGBUS.
+     */
     QImage data() const;
 
     QSize size() const override;
@@ -43,8 +62,15 @@ class ShmClientBufferIntegration : public ClientBufferIntegration
 
 public:
     explicit ShmClientBufferIntegration(Display *display);
+    ~ShmClientBufferIntegration() override;
+
+    /**
+     * Returns the size of the wl_shm_pool @a resource, in bytes.
+     */
+    static qint64 poolSize(wl_resource *resource);
 
-    ClientBuffer *createBuffer(::wl_resource *resource) override;
+private:
+    std::unique_ptr<ShmClientBufferIntegrationPrivate> d;
 };
 
 } // namespace KWaylandServer
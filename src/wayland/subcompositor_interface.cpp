@@ -164,7 +164,7 @@ void SubSurfaceInterfacePrivate::subsurface_set_desync(Resource *)
     mode = SubSurfaceInterface::Mode::Desynchronized;
     if (!q->isSynchronized()) {
         auto surfacePrivate = SurfaceInterfacePrivate::get(surface);
-        surfacePrivate->commitFromCache();
+        surfacePrivate->commitState(&surfacePrivate->cached);
     }
     Q_EMIT q->modeChanged(SubSurfaceInterface::Mode::Desynchronized);
 }
@@ -178,6 +178,7 @@ void SubSurfaceInterfacePrivate::parentCommit()
     if (hasPendingPosition) {
         hasPendingPosition = false;
         position = pendingPosition;
+        ++SurfaceInterfacePrivate::inputGeneration;
         Q_EMIT q->positionChanged(position);
     }
 
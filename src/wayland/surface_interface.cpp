@@ -12,13 +12,17 @@
 #include "fractionalscale_v1_interface_p.h"
 #include "idleinhibit_v1_interface_p.h"
 #include "linuxdmabufv1clientbuffer.h"
+#include "linuxdrmsyncobj_v1_interface_p.h"
 #include "pointerconstraints_v1_interface_p.h"
+#include "presentationtime_interface.h"
 #include "region_interface_p.h"
 #include "subcompositor_interface.h"
 #include "subsurface_interface_p.h"
 #include "surface_interface_p.h"
 #include "surfacerole_p.h"
+#include "transaction.h"
 #include "utils.h"
+#include "utils/damagesimplifier.h"
 
 #include <wayland-server.h>
 // std
@@ -43,6 +47,9 @@ SurfaceInterfacePrivate::SurfaceInterfacePrivate(SurfaceInterface *q)
     wl_list_init(&current.frameCallbacks);
     wl_list_init(&pending.frameCallbacks);
     wl_list_init(&cached.frameCallbacks);
+    wl_list_init(&current.presentationFeedbacks);
+    wl_list_init(&pending.presentationFeedbacks);
+    wl_list_init(&cached.presentationFeedbacks);
 }
 
 SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
@@ -60,6 +67,15 @@ SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
         wl_resource_destroy(resource);
     }
 
+    discardPresentationFeedbacks(&current.presentationFeedbacks);
+    discardPresentationFeedbacks(&pending.presentationFeedbacks);
+    discardPresentationFeedbacks(&cached.presentationFeedbacks);
+
+    const QList<Transaction *> pendingTransactions = std::exchange(transactions, {});
+    for (Transaction *transaction : pendingTransactions) {
+        transaction->discard(q);
+    }
+
     if (current.buffer) {
         current.buffer->unref();
     }
@@ -71,6 +87,7 @@ void SurfaceInterfacePrivate::addChild(SubSurfaceInterface *child)
     pending.above.append(child);
     cached.above.append(child);
     current.above.append(child);
+    ++inputGeneration;
     child->surface()->setOutputs(outputs);
     child->surface()->setPreferredScale(preferredScale);
 
@@ -87,6 +104,7 @@ void SurfaceInterfacePrivate::removeChild(SubSurfaceInterface *child)
     cached.above.removeAll(child);
     current.below.removeAll(child);
     current.above.removeAll(child);
+    ++inputGeneration;
     Q_EMIT q->childSubSurfaceRemoved(child);
     Q_EMIT q->childSubSurfacesChanged();
 }
@@ -270,6 +288,9 @@ void SurfaceInterfacePrivate::surface_attach(Resource *resource, struct ::wl_res
         return;
     }
     pending.buffer = compositor->display()->clientBufferForResource(buffer);
+    if (pending.buffer) {
+        pending.buffer->markAsAttached();
+    }
 }
 
 void SurfaceInterfacePrivate::surface_damage(Resource *, int32_t x, int32_t y, int32_t width, int32_t height)
@@ -314,10 +335,31 @@ void SurfaceInterfacePrivate::surface_set_input_region(Resource *resource, struc
 void SurfaceInterfacePrivate::surface_commit(Resource *resource)
 {
     Q_UNUSED(resource)
+    if (syncObjV1 && !syncObjV1->maybeEmitProtocolErrors()) {
+        return;
+    }
+    // The client must have flushed its rendering commands by now, so the acquire fence can
+    // be exported and waited on by the GPU without blocking the compositor.
+    if (pending.acquirePoint.timeline) {
+        pending.acquireFence = pending.acquirePoint.timeline->exportSyncFile(pending.acquirePoint.point);
+        pending.acquirePoint = {};
+    }
+    if (pending.releasePoint.timeline) {
+        pending.bufferReleasePoint = std::make_shared<KWin::SyncReleasePoint>(pending.releasePoint.timeline, pending.releasePoint.point);
+        pending.releasePoint = {};
+    }
+    // Otherwise the commit waits for the implicit fences of the dma-buf, so the scene never
+    // has to wait for the client's rendering in the middle of a frame.
+    if (pending.bufferIsSet && !pending.acquireFence.isValid()) {
+        if (auto dmabuf = qobject_cast<LinuxDmaBufV1ClientBuffer *>(pending.buffer)) {
+            pending.implicitFence = dmabuf->implicitFence();
+        }
+    }
+
     if (subSurface) {
         commitSubSurface();
     } else {
-        applyState(&pending);
+        commitState(&pending);
     }
 }
 
@@ -416,6 +458,14 @@ bool SurfaceInterface::hasFrameCallbacks() const
     return !wl_list_empty(&d->current.frameCallbacks);
 }
 
+std::unique_ptr<PresentationFeedback> SurfaceInterface::takePresentationFeedback(OutputInterface *output)
+{
+    if (wl_list_empty(&d->current.presentationFeedbacks)) {
+        return nullptr;
+    }
+    return std::make_unique<PresentationFeedback>(&d->current.presentationFeedbacks, output);
+}
+
 QMatrix4x4 SurfaceInterfacePrivate::buildSurfaceToBufferMatrix()
 {
     // The order of transforms is reversed, i.e. the viewport transform is the first one.
@@ -485,65 +535,123 @@ QMatrix4x4 SurfaceInterfacePrivate::buildSurfaceToBufferMatrix()
 
 void SurfaceState::mergeInto(SurfaceState *target)
 {
+    // Everything that is handed over is moved and the state is reset field by field rather
+    // than by assigning a default constructed state, which would allocate an infinite input
+    // region and touch the reference counts of every member on every commit.
     if (bufferIsSet) {
-        target->buffer = buffer;
+        target->buffer = std::move(buffer);
         target->offset = offset;
-        target->damage = damage;
-        target->bufferDamage = bufferDamage;
-        target->bufferIsSet = bufferIsSet;
+        target->damage = std::exchange(damage, QRegion());
+        target->bufferDamage = std::exchange(bufferDamage, QRegion());
+        target->bufferIsSet = true;
+        target->acquireFence = std::move(acquireFence);
+        target->bufferReleasePoint = std::move(bufferReleasePoint);
+        target->implicitFence = std::move(implicitFence);
+        buffer.clear();
+        offset = QPoint();
+        bufferIsSet = false;
     }
     if (viewport.sourceGeometryIsSet) {
         target->viewport.sourceGeometry = viewport.sourceGeometry;
         target->viewport.sourceGeometryIsSet = true;
+        viewport.sourceGeometry = QRectF();
+        viewport.sourceGeometryIsSet = false;
     }
     if (viewport.destinationSizeIsSet) {
         target->viewport.destinationSize = viewport.destinationSize;
         target->viewport.destinationSizeIsSet = true;
+        viewport.destinationSize = QSize();
+        viewport.destinationSizeIsSet = false;
     }
     if (childrenChanged) {
         target->below = below;
         target->above = above;
         target->childrenChanged = true;
+        childrenChanged = false;
     }
     wl_list_insert_list(&target->frameCallbacks, &frameCallbacks);
+    wl_list_init(&frameCallbacks);
+
+    // The previous content update is superseded and will never be presented.
+    discardPresentationFeedbacks(&target->presentationFeedbacks);
+    wl_list_insert_list(&target->presentationFeedbacks, &presentationFeedbacks);
+    wl_list_init(&presentationFeedbacks);
 
     if (shadowIsSet) {
-        target->shadow = shadow;
+        target->shadow = std::move(shadow);
         target->shadowIsSet = true;
+        shadow.clear();
+        shadowIsSet = false;
     }
     if (blurIsSet) {
-        target->blur = blur;
+        target->blur = std::move(blur);
         target->blurIsSet = true;
+        blur.clear();
+        blurIsSet = false;
     }
     if (contrastIsSet) {
-        target->contrast = contrast;
+        target->contrast = std::move(contrast);
         target->contrastIsSet = true;
+        contrast.clear();
+        contrastIsSet = false;
     }
     if (slideIsSet) {
-        target->slide = slide;
+        target->slide = std::move(slide);
         target->slideIsSet = true;
+        slide.clear();
+        slideIsSet = false;
     }
     if (inputIsSet) {
-        target->input = input;
+        // the value of an unset input region is never looked at, it can stay empty
+        target->input = std::exchange(input, QRegion());
         target->inputIsSet = true;
+        inputIsSet = false;
     }
     if (opaqueIsSet) {
-        target->opaque = opaque;
+        target->opaque = std::exchange(opaque, QRegion());
         target->opaqueIsSet = true;
+        opaqueIsSet = false;
     }
     if (bufferScaleIsSet) {
         target->bufferScale = bufferScale;
         target->bufferScaleIsSet = true;
+        bufferScale = 1;
+        bufferScaleIsSet = false;
     }
     if (bufferTransformIsSet) {
         target->bufferTransform = bufferTransform;
         target->bufferTransformIsSet = true;
-    }
-
-    *this = SurfaceState{};
+        bufferTransform = KWin::Output::Transform::Normal;
+        bufferTransformIsSet = false;
+    }
+    if (presentationHintIsSet) {
+        target->presentationHint = presentationHint;
+        target->presentationHintIsSet = true;
+        presentationHint = PresentationHint::VSync;
+        presentationHintIsSet = false;
+    }
+    if (xdgSurface.windowGeometryIsSet) {
+        target->xdgSurface.windowGeometry = xdgSurface.windowGeometry;
+        target->xdgSurface.windowGeometryIsSet = true;
+        xdgSurface.windowGeometry = QRect();
+        xdgSurface.windowGeometryIsSet = false;
+    }
+    if (xdgSurface.acknowledgedConfigureIsSet) {
+        target->xdgSurface.acknowledgedConfigure = xdgSurface.acknowledgedConfigure;
+        target->xdgSurface.acknowledgedConfigureIsSet = true;
+        xdgSurface.acknowledgedConfigure = 0;
+        xdgSurface.acknowledgedConfigureIsSet = false;
+    }
+
+    acquirePoint = {};
+    releasePoint = {};
+    acquireFence = KWin::FileDescriptor();
+    bufferReleasePoint.reset();
+    implicitFence = KWin::FileDescriptor();
+
+    // Both lists normally share their data already, then this is a no-op.
     below = target->below;
     above = target->above;
-    wl_list_init(&frameCallbacks);
 }
 
 void SurfaceInterfacePrivate::applyState(SurfaceState *next)
@@ -558,6 +666,9 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
     const bool slideChanged = next->slideIsSet;
     const bool childrenChanged = next->childrenChanged;
     const bool visibilityChanged = bufferChanged && bool(current.buffer) != bool(next->buffer);
+    const bool inputRegionChanged = next->inputIsSet;
+    const bool scaleOverrideChanged = scaleOverride != pendingScaleOverride;
+    const bool hadAlphaChannel = current.buffer && current.buffer->hasAlphaChannel();
 
     const QSizeF oldSurfaceSize = surfaceSize;
     const QSize oldBufferSize = bufferSize;
@@ -565,6 +676,7 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
     const QRegion oldInputRegion = inputRegion;
 
     next->mergeInto(&current);
+    current.implicitFence = KWin::FileDescriptor();
     scaleOverride = pendingScaleOverride;
 
     if (lockedPointer) {
@@ -613,22 +725,28 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
             surfaceSize = implicitSurfaceSize;
         }
 
-        const QRectF surfaceRect(QPoint(0, 0), surfaceSize);
-        inputRegion = current.input & surfaceRect.toAlignedRect();
+        // Most commits only attach a new buffer and add damage, the regions only have to be
+        // computed again if something they depend on has changed.
+        const bool hasAlphaChannel = current.buffer->hasAlphaChannel();
+        if (inputRegionChanged || opaqueRegionChanged || visibilityChanged || scaleOverrideChanged
+            || hasAlphaChannel != hadAlphaChannel || surfaceSize / scaleOverride != oldSurfaceSize) {
+            const QRectF surfaceRect(QPoint(0, 0), surfaceSize);
+            inputRegion = current.input & surfaceRect.toAlignedRect();
+
+            if (!hasAlphaChannel) {
+                opaqueRegion = surfaceRect.toAlignedRect();
+            } else {
+                opaqueRegion = current.opaque & surfaceRect.toAlignedRect();
+            }
 
-        if (!current.buffer->hasAlphaChannel()) {
-            opaqueRegion = surfaceRect.toAlignedRect();
-        } else {
-            opaqueRegion = current.opaque & surfaceRect.toAlignedRect();
-        }
+            QMatrix4x4 scaleOverrideMatrix;
+            if (scaleOverride != 1.) {
+                scaleOverrideMatrix.scale(1. / scaleOverride, 1. / scaleOverride);
+            }
 
-        QMatrix4x4 scaleOverrideMatrix;
-        if (scaleOverride != 1.) {
-            scaleOverrideMatrix.scale(1. / scaleOverride, 1. / scaleOverride);
+            opaqueRegion = map_helper(scaleOverrideMatrix, opaqueRegion);
+            inputRegion = map_helper(scaleOverrideMatrix, inputRegion);
         }
-
-        opaqueRegion = map_helper(scaleOverrideMatrix, opaqueRegion);
-        inputRegion = map_helper(scaleOverrideMatrix, inputRegion);
         surfaceSize = surfaceSize / scaleOverride;
         implicitSurfaceSize = implicitSurfaceSize / scaleOverride;
     } else {
@@ -641,6 +759,9 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
 
     surfaceToBufferMatrix = buildSurfaceToBufferMatrix();
     bufferToSurfaceMatrix = surfaceToBufferMatrix.inverted();
+    if (oldInputRegion != inputRegion || surfaceSize != oldSurfaceSize || childrenChanged) {
+        ++inputGeneration;
+    }
     if (opaqueRegionChanged) {
         Q_EMIT q->opaqueChanged(opaqueRegion);
     }
@@ -660,7 +781,7 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
         if (current.buffer && (!current.damage.isEmpty() || !current.bufferDamage.isEmpty())) {
             const QRegion windowRegion = QRegion(0, 0, q->size().width(), q->size().height());
             const QRegion bufferDamage = q->mapFromBuffer(current.bufferDamage);
-            current.damage = windowRegion.intersected(current.damage.united(bufferDamage));
+            current.damage = KWin::DamageSimplifier::surfaceDamage()->simplify(windowRegion.intersected(current.damage.united(bufferDamage)));
             Q_EMIT q->damaged(current.damage);
         }
     }
@@ -710,10 +831,24 @@ void SurfaceInterfacePrivate::commitSubSurface()
     } else {
         if (hasCacheState) {
             commitToCache();
-            commitFromCache();
+            commitState(&cached);
         } else {
-            applyState(&pending);
+            commitState(&pending);
+        }
+    }
+}
+
+void SurfaceInterfacePrivate::commitState(SurfaceState *state)
+{
+    if (Transaction::isNeeded(q, state)) {
+        Transaction::create(q, state);
+        if (state == &cached) {
+            hasCacheState = false;
         }
+    } else if (state == &cached) {
+        commitFromCache();
+    } else {
+        applyState(state);
     }
 }
 
@@ -748,6 +883,7 @@ void SurfaceInterfacePrivate::updateEffectiveMapped()
     }
 
     mapped = effectiveMapped;
+    ++inputGeneration;
 
     if (mapped) {
         Q_EMIT q->mapped();
@@ -977,30 +1113,47 @@ SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
 }
 
 SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
+{
+    return d->inputSurfaceAt(position);
+}
+
+quint64 SurfaceInterfacePrivate::inputGeneration = 1;
+
+/**
+ * Looks for the input surface at @a position, which is relative to the surface at @a offset.
+ * The surfaces are visited from top to bottom. If @a covered is set, the input regions of the
+ * surfaces that have been passed are collected in it.
+ */
+static SurfaceInterfacePrivate *findInputSurface(SurfaceInterfacePrivate *surface, const QPointF &position, QPoint *offset, QRegion *covered)
 {
     // TODO: Most of this is very similar to SurfaceInterface::surfaceAt
     //       Is there a way to reduce the code duplication?
-    if (!isMapped()) {
+    if (!surface->mapped) {
         return nullptr;
     }
 
-    for (auto it = d->current.above.crbegin(); it != d->current.above.crend(); ++it) {
+    const QPoint surfaceOffset = *offset;
+    for (auto it = surface->current.above.crbegin(); it != surface->current.above.crend(); ++it) {
         const SubSurfaceInterface *current = *it;
-        auto surface = current->surface();
-        if (auto s = surface->inputSurfaceAt(position - current->position())) {
+        *offset = surfaceOffset + current->position();
+        if (auto s = findInputSurface(SurfaceInterfacePrivate::get(current->surface()), position, offset, covered)) {
             return s;
         }
     }
 
     // check whether the geometry and input region contain the pos
-    if (d->inputContains(position)) {
-        return this;
+    *offset = surfaceOffset;
+    if (surface->inputContains(position - surfaceOffset)) {
+        return surface;
+    }
+    if (covered) {
+        *covered += surface->inputRegion.translated(surfaceOffset);
     }
 
-    for (auto it = d->current.below.crbegin(); it != d->current.below.crend(); ++it) {
+    for (auto it = surface->current.below.crbegin(); it != surface->current.below.crend(); ++it) {
         const SubSurfaceInterface *current = *it;
-        auto surface = current->surface();
-        if (auto s = surface->inputSurfaceAt(position - current->position())) {
+        *offset = surfaceOffset + current->position();
+        if (auto s = findInputSurface(SurfaceInterfacePrivate::get(current->surface()), position, offset, covered)) {
             return s;
         }
     }
@@ -1008,6 +1161,23 @@ SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
     return nullptr;
 }
 
+SurfaceInterface *SurfaceInterfacePrivate::inputSurfaceAt(const QPointF &position, QPoint *offset, QRegion *exclusive)
+{
+    QPoint surfaceOffset(0, 0);
+    QRegion covered;
+    SurfaceInterfacePrivate *surface = findInputSurface(this, position, &surfaceOffset, exclusive ? &covered : nullptr);
+    if (!surface) {
+        return nullptr;
+    }
+    if (offset) {
+        *offset = surfaceOffset;
+    }
+    if (exclusive) {
+        *exclusive = surface->inputRegion - covered.translated(-surfaceOffset);
+    }
+    return surface->q;
+}
+
 LockedPointerV1Interface *SurfaceInterface::lockedPointer() const
 {
     return d->lockedPointer;
@@ -1023,6 +1193,21 @@ bool SurfaceInterface::inhibitsIdle() const
     return !d->idleInhibitors.isEmpty();
 }
 
+PresentationHint SurfaceInterface::presentationHint() const
+{
+    return d->current.presentationHint;
+}
+
+const KWin::FileDescriptor &SurfaceInterface::acquireFence() const
+{
+    return d->current.acquireFence;
+}
+
+std::shared_ptr<KWin::SyncReleasePoint> SurfaceInterface::bufferReleasePoint() const
+{
+    return d->current.bufferReleasePoint;
+}
+
 LinuxDmaBufV1Feedback *SurfaceInterface::dmabufFeedbackV1() const
 {
     return d->dmabufFeedbackV1.get();
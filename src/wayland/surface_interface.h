@@ -13,6 +13,14 @@
 #include <QPointer>
 #include <QRegion>
 
+#include <memory>
+
+namespace KWin
+{
+class FileDescriptor;
+class SyncReleasePoint;
+}
+
 namespace KWaylandServer
 {
 class BlurInterface;
@@ -26,6 +34,21 @@ class SlideInterface;
 class SubSurfaceInterface;
 class SurfaceInterfacePrivate;
 class LinuxDmaBufV1Feedback;
+class PresentationFeedback;
+
+/**
+ * The PresentationHint enum describes how the content updates of a surface should be presented.
+ */
+enum class PresentationHint {
+    /**
+     * The content updates are synchronized to the vertical blank, no tearing is visible.
+     */
+    VSync,
+    /**
+     * The content updates may be presented as soon as possible, at the cost of tearing.
+     */
+    Async,
+};
 
 /**
  * @brief Resource representing a wl_surface.
@@ -158,6 +181,14 @@ public:
     void frameRendered(quint32 msec);
     bool hasFrameCallbacks() const;
 
+    /**
+     * Takes the presentation feedback requested for the current content update of this
+     * surface, not including subsurfaces. Returns @c null if no feedback has been requested
+     * or it has already been taken. The @a output is announced to the client with the
+     * sync_output event when the feedback is presented.
+     */
+    std::unique_ptr<PresentationFeedback> takePresentationFeedback(OutputInterface *output);
+
     QRegion damage() const;
     QRegion opaque() const;
     QRegion input() const;
@@ -301,6 +332,31 @@ public:
      */
     bool inhibitsIdle() const;
 
+    /**
+     * Returns how the client would like the content updates of this surface to be presented.
+     * The default is PresentationHint::VSync.
+     *
+     * @since 5.27
+     */
+    PresentationHint presentationHint() const;
+
+    /**
+     * Returns the sync file that is signaled when the client has finished rendering the
+     * current buffer, or an invalid file descriptor if the buffer is synchronized implicitly.
+     *
+     * @since 5.27
+     */
+    const KWin::FileDescriptor &acquireFence() const;
+
+    /**
+     * Returns the release point of the current buffer, or @c null if the buffer is
+     * synchronized implicitly. The release point is signaled as soon as the last reference
+     * to it is dropped, so it must be kept alive for as long as the buffer is in use.
+     *
+     * @since 5.27
+     */
+    std::shared_ptr<KWin::SyncReleasePoint> bufferReleasePoint() const;
+
     /**
      * dmabuf feedback installed on this SurfaceInterface
      */
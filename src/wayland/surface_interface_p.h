@@ -6,6 +6,7 @@
 */
 #pragma once
 
+#include "core/syncobjtimeline.h"
 #include "surface_interface.h"
 #include "utils.h"
 // Qt
@@ -20,6 +21,15 @@ class IdleInhibitorV1Interface;
 class SurfaceRole;
 class ViewportInterface;
 class FractionalScaleV1Interface;
+class TearingControlV1Interface;
+class LinuxDrmSyncObjSurfaceV1;
+class Transaction;
+
+struct SyncPoint
+{
+    std::shared_ptr<KWin::SyncTimeline> timeline;
+    uint64_t point = 0;
+};
 
 struct SurfaceState
 {
@@ -39,9 +49,12 @@ struct SurfaceState
     bool childrenChanged = false;
     bool bufferScaleIsSet = false;
     bool bufferTransformIsSet = false;
+    bool presentationHintIsSet = false;
     qint32 bufferScale = 1;
     KWin::Output::Transform bufferTransform = KWin::Output::Transform::Normal;
+    PresentationHint presentationHint = PresentationHint::VSync;
     wl_list frameCallbacks;
+    wl_list presentationFeedbacks;
     QPoint offset = QPoint();
     QPointer<ClientBuffer> buffer;
     QPointer<ShadowInterface> shadow;
@@ -49,6 +62,16 @@ struct SurfaceState
     QPointer<ContrastInterface> contrast;
     QPointer<SlideInterface> slide;
 
+    // The synchronization points set by the client are turned into the acquire fence and
+    // the release point of the buffer when the state is committed.
+    SyncPoint acquirePoint;
+    SyncPoint releasePoint;
+    KWin::FileDescriptor acquireFence;
+    std::shared_ptr<KWin::SyncReleasePoint> bufferReleasePoint;
+    // Without explicit synchronization, this becomes readable once the client's rendering to
+    // the dma-buf has finished. It's only needed until the state is applied.
+    KWin::FileDescriptor implicitFence;
+
     // Subsurfaces are stored in two lists. The below list contains subsurfaces that
     // are below their parent surface; the above list contains subsurfaces that are
     // placed above the parent surface.
@@ -62,8 +85,24 @@ struct SurfaceState
         bool sourceGeometryIsSet = false;
         bool destinationSizeIsSet = false;
     } viewport;
+
+    // The xdg_surface state is double buffered with the surface, so that a configure is
+    // acknowledged together with the buffer that matches it.
+    struct
+    {
+        QRect windowGeometry = QRect();
+        quint32 acknowledgedConfigure = 0;
+        bool windowGeometryIsSet = false;
+        bool acknowledgedConfigureIsSet = false;
+    } xdgSurface;
 };
 
+/**
+ * Sends the discarded event to the wp_presentation_feedback resources linked in @a resources
+ * and destroys them.
+ */
+void discardPresentationFeedbacks(wl_list *resources);
+
 class SurfaceInterfacePrivate : public QtWaylandServer::wl_surface
 {
 public:
@@ -91,6 +130,12 @@ public:
     void commitFromCache();
 
     void commitSubSurface();
+    /**
+     * Applies @a state, which is either the pending or the cached state, together with the
+     * cached states of the synchronized subsurfaces. If they can't be applied yet, they are
+     * put in a Transaction that applies them once they are ready.
+     */
+    void commitState(SurfaceState *state);
     QMatrix4x4 buildSurfaceToBufferMatrix();
     void applyState(SurfaceState *next);
 
@@ -104,6 +149,21 @@ public:
     bool contains(const QPointF &position) const;
     bool inputContains(const QPointF &position) const;
 
+    /**
+     * Returns the surface in this surface tree that receives input at @a position, like
+     * SurfaceInterface::inputSurfaceAt(). @a offset is set to the position of that surface
+     * relative to this one. @a exclusive is set to the part of its input region, in its own
+     * coordinates, that isn't covered by the surfaces above it; input anywhere in there goes
+     * to the same surface as long as inputGeneration doesn't change.
+     */
+    SurfaceInterface *inputSurfaceAt(const QPointF &position, QPoint *offset = nullptr, QRegion *exclusive = nullptr);
+
+    /**
+     * Changes whenever anything that inputSurfaceAt() depends on changes in any surface, e.g.
+     * an input region, whether a surface is mapped or the position of a subsurface.
+     */
+    static quint64 inputGeneration;
+
     CompositorInterface *compositor;
     SurfaceInterface *q;
     SurfaceRole *role = nullptr;
@@ -137,7 +197,11 @@ public:
     ViewportInterface *viewportExtension = nullptr;
     std::unique_ptr<LinuxDmaBufV1Feedback> dmabufFeedbackV1;
     FractionalScaleV1Interface *fractionalScaleExtension = nullptr;
+    TearingControlV1Interface *tearingControlExtension = nullptr;
+    LinuxDrmSyncObjSurfaceV1 *syncObjV1 = nullptr;
     ClientConnection *client = nullptr;
+    // The transactions that contain a state of this surface, in the order they were committed.
+    QList<Transaction *> transactions;
 
 protected:
     void surface_destroy_resource(Resource *resource) override;
@@ -0,0 +1,116 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "tearingcontrol_v1_interface.h"
+
+#include "display.h"
+#include "surface_interface_p.h"
+
+#include <QPointer>
+
+#include "qwayland-server-tearing-control-v1.h"
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class TearingControlManagerV1InterfacePrivate : public QtWaylandServer::wp_tearing_control_manager_v1
+{
+protected:
+    void wp_tearing_control_manager_v1_destroy(Resource *resource) override;
+    void wp_tearing_control_manager_v1_get_tearing_control(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
+};
+
+class TearingControlV1Interface : public QtWaylandServer::wp_tearing_control_v1
+{
+public:
+    TearingControlV1Interface(SurfaceInterface *surface, wl_resource *resource);
+    ~TearingControlV1Interface() override;
+
+protected:
+    void wp_tearing_control_v1_set_presentation_hint(Resource *resource, uint32_t hint) override;
+    void wp_tearing_control_v1_destroy(Resource *resource) override;
+    void wp_tearing_control_v1_destroy_resource(Resource *resource) override;
+
+private:
+    QPointer<SurfaceInterface> m_surface;
+};
+
+void TearingControlManagerV1InterfacePrivate::wp_tearing_control_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void TearingControlManagerV1InterfacePrivate::wp_tearing_control_manager_v1_get_tearing_control(Resource *resource, uint32_t id, struct ::wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    if (SurfaceInterfacePrivate::get(surface)->tearingControlExtension) {
+        wl_resource_post_error(resource->handle, error_tearing_control_exists, "the specified surface already has a tearing control");
+        return;
+    }
+
+    wl_resource *tearingControlResource = wl_resource_create(resource->client(), &wp_tearing_control_v1_interface, resource->version(), id);
+    if (!tearingControlResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    new TearingControlV1Interface(surface, tearingControlResource);
+}
+
+TearingControlV1Interface::TearingControlV1Interface(SurfaceInterface *surface, wl_resource *resource)
+    : QtWaylandServer::wp_tearing_control_v1(resource)
+    , m_surface(surface)
+{
+    SurfaceInterfacePrivate::get(surface)->tearingControlExtension = this;
+}
+
+TearingControlV1Interface::~TearingControlV1Interface()
+{
+    if (m_surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(m_surface);
+        // The hint goes back to vsync with the next commit, like any other double-buffered state.
+        surfacePrivate->pending.presentationHint = PresentationHint::VSync;
+        surfacePrivate->pending.presentationHintIsSet = true;
+        surfacePrivate->tearingControlExtension = nullptr;
+    }
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_set_presentation_hint(Resource *resource, uint32_t hint)
+{
+    Q_UNUSED(resource)
+    if (!m_surface) {
+        return;
+    }
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(m_surface);
+    surfacePrivate->pending.presentationHint = hint == presentation_hint_async ? PresentationHint::Async : PresentationHint::VSync;
+    surfacePrivate->pending.presentationHintIsSet = true;
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+TearingControlManagerV1Interface::TearingControlManagerV1Interface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new TearingControlManagerV1InterfacePrivate)
+{
+    d->init(*display, s_version);
+}
+
+TearingControlManagerV1Interface::~TearingControlManagerV1Interface()
+{
+}
+
+} // namespace KWaylandServer
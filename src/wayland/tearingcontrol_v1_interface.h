@@ -0,0 +1,37 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+#include <memory>
+
+namespace KWaylandServer
+{
+class Display;
+class TearingControlManagerV1InterfacePrivate;
+
+/**
+ * The TearingControlManagerV1Interface class provides the @c wp_tearing_control_manager_v1
+ * global, which lets clients hint that their surfaces may be presented asynchronously.
+ *
+ * @see SurfaceInterface::presentationHint
+ */
+class KWIN_EXPORT TearingControlManagerV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TearingControlManagerV1Interface(Display *display, QObject *parent = nullptr);
+    ~TearingControlManagerV1Interface() override;
+
+private:
+    std::unique_ptr<TearingControlManagerV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
@@ -0,0 +1,232 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "transaction.h"
+#include "subsurface_interface_p.h"
+#include "surface_interface_p.h"
+
+#include <QSocketNotifier>
+
+#include <wayland-server.h>
+
+namespace KWaylandServer
+{
+
+static const KWin::FileDescriptor &readinessFence(const SurfaceState *state)
+{
+    // the implicit fence is only exported if there's no explicit one
+    return state->acquireFence.isValid() ? state->acquireFence : state->implicitFence;
+}
+
+static bool isSignaled(const SurfaceState *state)
+{
+    const KWin::FileDescriptor &fence = readinessFence(state);
+    return !fence.isValid() || fence.isReadable();
+}
+
+static std::unique_ptr<SurfaceState> takeState(SurfaceState *source)
+{
+    auto state = std::make_unique<SurfaceState>();
+    wl_list_init(&state->frameCallbacks);
+    wl_list_init(&state->presentationFeedbacks);
+    // mergeInto() hands the subsurface lists of the target back to the source
+    state->below = source->below;
+    state->above = source->above;
+    source->mergeInto(state.get());
+    return state;
+}
+
+static void destroyState(SurfaceState *state)
+{
+    wl_resource *resource;
+    wl_resource *tmp;
+
+    wl_resource_for_each_safe (resource, tmp, &state->frameCallbacks) {
+        wl_resource_destroy(resource);
+    }
+    discardPresentationFeedbacks(&state->presentationFeedbacks);
+}
+
+/**
+ * Calls @a callback for the subsurfaces that are applied along with @a state, it's the same
+ * condition as in SubSurfaceInterfacePrivate::parentCommit().
+ */
+template<typename Callback>
+static void forEachSynchronizedChild(const SurfaceState *state, Callback callback)
+{
+    for (const QList<SubSurfaceInterface *> *children : {&state->below, &state->above}) {
+        for (SubSurfaceInterface *subsurface : *children) {
+            if (SubSurfaceInterfacePrivate::get(subsurface)->mode != SubSurfaceInterface::Mode::Synchronized) {
+                continue;
+            }
+            if (SurfaceInterface *surface = subsurface->surface()) {
+                callback(SurfaceInterfacePrivate::get(surface));
+            }
+        }
+    }
+}
+
+Transaction::~Transaction()
+{
+    for (Entry &entry : m_entries) {
+        destroyState(entry.state.get());
+    }
+}
+
+bool Transaction::isNeeded(SurfaceInterface *surface, const SurfaceState *state)
+{
+    if (!SurfaceInterfacePrivate::get(surface)->transactions.isEmpty() || !isSignaled(state)) {
+        return true;
+    }
+    bool needed = false;
+    forEachSynchronizedChild(state, [&needed](SurfaceInterfacePrivate *child) {
+        if (!needed && child->hasCacheState) {
+            needed = isNeeded(child->q, &child->cached);
+        }
+    });
+    return needed;
+}
+
+void Transaction::create(SurfaceInterface *surface, SurfaceState *state)
+{
+    auto transaction = new Transaction();
+    transaction->add(surface, state);
+    transaction->tryApply();
+}
+
+void Transaction::add(SurfaceInterface *surface, SurfaceState *state)
+{
+    m_entries.push_back(Entry{surface, takeState(state), nullptr});
+    SurfaceInterfacePrivate::get(surface)->transactions.append(this);
+    watch(m_entries.back());
+
+    const SurfaceState *taken = m_entries.back().state.get();
+    forEachSynchronizedChild(taken, [this](SurfaceInterfacePrivate *child) {
+        if (child->hasCacheState) {
+            child->hasCacheState = false;
+            add(child->q, &child->cached);
+        }
+    });
+}
+
+void Transaction::watch(Entry &entry)
+{
+    if (isSignaled(entry.state.get())) {
+        return;
+    }
+    entry.notifier = std::make_unique<QSocketNotifier>(readinessFence(entry.state.get()).get(), QSocketNotifier::Read);
+    QSocketNotifier *notifier = entry.notifier.get();
+    connect(notifier, &QSocketNotifier::activated, this, [this, notifier]() {
+        // a fence stays readable once it has signaled
+        notifier->setEnabled(false);
+        tryApply();
+    });
+}
+
+void Transaction::discard(SurfaceInterface *surface)
+{
+    // The surface has already forgotten about the transaction.
+    for (Entry &entry : m_entries) {
+        if (entry.surface == surface) {
+            entry.notifier.reset();
+            destroyState(entry.state.get());
+            entry.surface.clear();
+        }
+    }
+
+    // This is called while the surface is being destroyed, so don't apply anything right now.
+    if (!m_entries.front().surface) {
+        QMetaObject::invokeMethod(this, &Transaction::finish, Qt::QueuedConnection);
+    } else {
+        QMetaObject::invokeMethod(this, &Transaction::tryApply, Qt::QueuedConnection);
+    }
+}
+
+bool Transaction::isReady() const
+{
+    for (const Entry &entry : m_entries) {
+        if (!entry.surface) {
+            continue;
+        }
+        if (SurfaceInterfacePrivate::get(entry.surface)->transactions.constFirst() != this) {
+            return false;
+        }
+        if (!isSignaled(entry.state.get())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Transaction::apply()
+{
+    // The cached states of synchronized subsurfaces are applied by their parent, so the
+    // states of this transaction are put back in place. The subsurfaces may have cached
+    // newer states in the meantime, those belong to the next commit of the parent.
+    std::vector<Entry> newer;
+    for (auto it = m_entries.begin() + 1; it != m_entries.end(); ++it) {
+        if (!it->surface) {
+            continue;
+        }
+        SurfaceInterfacePrivate *child = SurfaceInterfacePrivate::get(it->surface);
+        if (child->hasCacheState) {
+            newer.push_back(Entry{it->surface, takeState(&child->cached), nullptr});
+        }
+        it->state->mergeInto(&child->cached);
+        child->hasCacheState = true;
+    }
+
+    const Entry &root = m_entries.front();
+    SurfaceInterfacePrivate::get(root.surface)->applyState(root.state.get());
+
+    for (Entry &entry : newer) {
+        if (entry.surface) {
+            SurfaceInterfacePrivate *child = SurfaceInterfacePrivate::get(entry.surface);
+            entry.state->mergeInto(&child->cached);
+            child->hasCacheState = true;
+        } else {
+            destroyState(entry.state.get());
+        }
+    }
+}
+
+void Transaction::tryApply()
+{
+    if (m_finished || !m_entries.front().surface || !isReady()) {
+        return;
+    }
+    apply();
+    finish();
+}
+
+void Transaction::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+
+    QList<Transaction *> next;
+    for (const Entry &entry : m_entries) {
+        if (!entry.surface) {
+            continue;
+        }
+        QList<Transaction *> &transactions = SurfaceInterfacePrivate::get(entry.surface)->transactions;
+        transactions.removeOne(this);
+        if (!transactions.isEmpty() && !next.contains(transactions.constFirst())) {
+            next.append(transactions.constFirst());
+        }
+    }
+
+    // finish() can be reached from one of the socket notifiers
+    deleteLater();
+
+    for (Transaction *transaction : std::as_const(next)) {
+        transaction->tryApply();
+    }
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+
+#include <memory>
+#include <vector>
+
+class QSocketNotifier;
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+struct SurfaceState;
+
+/**
+ * The Transaction class holds content updates of a surface and of its synchronized
+ * subsurfaces that have to be applied together.
+ *
+ * Most commits are applied as soon as they arrive. A transaction is only made if that's
+ * not possible yet, because the client is still rendering to the buffer, as told by its
+ * explicit acquire fence or the implicit fences of the dma-buf, or because an earlier
+ * transaction of one of the surfaces is still waiting. The transaction takes the committed
+ * state and the cached states of the synchronized subsurfaces, so that later commits can't
+ * leak into it, and applies all of them in one go once the fences have signaled and the
+ * transactions before it have been applied. The scene never sees a half updated surface
+ * tree, and won't sample a buffer the GPU is still rendering to.
+ */
+class Transaction : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~Transaction() override;
+
+    /**
+     * Returns whether committing @a state of the @a surface has to wait, i.e. whether it
+     * has to go through a transaction.
+     */
+    static bool isNeeded(SurfaceInterface *surface, const SurfaceState *state);
+
+    /**
+     * Moves @a state of the @a surface and the cached states of its synchronized subsurfaces
+     * into a new transaction, which applies them once they are ready.
+     */
+    static void create(SurfaceInterface *surface, SurfaceState *state);
+
+    /**
+     * Drops the state of the @a surface, which is about to be destroyed. If it's the surface
+     * that has been committed, the whole transaction is dropped.
+     */
+    void discard(SurfaceInterface *surface);
+
+private:
+    struct Entry
+    {
+        QPointer<SurfaceInterface> surface;
+        std::unique_ptr<SurfaceState> state;
+        // Goes away before the state, which owns the fence it watches.
+        std::unique_ptr<QSocketNotifier> notifier;
+    };
+
+    Transaction() = default;
+
+    void add(SurfaceInterface *surface, SurfaceState *state);
+    void watch(Entry &entry);
+    bool isReady() const;
+    void apply();
+    void tryApply();
+    void finish();
+
+    // The first entry is the committed surface, the others its synchronized subsurfaces.
+    std::vector<Entry> m_entries;
+    bool m_finished = false;
+};
+
+} // namespace KWaylandServer
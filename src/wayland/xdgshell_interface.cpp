@@ -10,6 +10,7 @@
 #include "display.h"
 #include "output_interface.h"
 #include "seat_interface.h"
+#include "surface_interface_p.h"
 #include "utils.h"
 
 #include <QTimer>
@@ -139,6 +140,7 @@ void XdgSurfaceInterfacePrivate::commit()
         firstBufferAttached = true;
     }
 
+    auto &next = SurfaceInterfacePrivate::get(surface)->current.xdgSurface;
     if (next.acknowledgedConfigureIsSet) {
         current.acknowledgedConfigure = next.acknowledgedConfigure;
         next.acknowledgedConfigureIsSet = false;
@@ -157,7 +159,11 @@ void XdgSurfaceInterfacePrivate::reset()
     firstBufferAttached = false;
     isConfigured = false;
     current = XdgSurfaceState{};
-    next = XdgSurfaceState{};
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->pending.xdgSurface = {};
+        surfacePrivate->current.xdgSurface = {};
+    }
     Q_EMIT q->resetOccurred();
 }
 
@@ -237,6 +243,10 @@ void XdgSurfaceInterfacePrivate::xdg_surface_set_window_geometry(Resource *resou
         return;
     }
 
+    if (!surface) {
+        return;
+    }
+    auto &next = SurfaceInterfacePrivate::get(surface)->pending.xdgSurface;
     next.windowGeometry = QRect(x, y, width, height);
     next.windowGeometryIsSet = true;
 }
@@ -244,6 +254,10 @@ void XdgSurfaceInterfacePrivate::xdg_surface_set_window_geometry(Resource *resou
 void XdgSurfaceInterfacePrivate::xdg_surface_ack_configure(Resource *resource, uint32_t serial)
 {
     Q_UNUSED(resource)
+    if (!surface) {
+        return;
+    }
+    auto &next = SurfaceInterfacePrivate::get(surface)->pending.xdgSurface;
     next.acknowledgedConfigure = serial;
     next.acknowledgedConfigureIsSet = true;
 }
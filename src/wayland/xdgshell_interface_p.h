@@ -106,7 +106,7 @@ public:
     bool firstBufferAttached = false;
     bool isConfigured = false;
 
-    XdgSurfaceState next;
+    // The pending state is kept in the SurfaceState, so it's applied with the surface.
     XdgSurfaceState current;
 
     static XdgSurfaceInterfacePrivate *get(XdgSurfaceInterface *surface);
@@ -38,6 +38,7 @@
 #include "wayland/keyboard_shortcuts_inhibit_v1_interface.h"
 #include "wayland/keystate_interface.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/linuxdrmsyncobj_v1_interface.h"
 #include "wayland/lockscreen_overlay_v1_interface.h"
 #include "wayland/output_interface.h"
 #include "wayland/outputdevice_v2_interface.h"
@@ -47,6 +48,7 @@
 #include "wayland/plasmawindowmanagement_interface.h"
 #include "wayland/pointerconstraints_v1_interface.h"
 #include "wayland/pointergestures_v1_interface.h"
+#include "wayland/presentationtime_interface.h"
 #include "wayland/primaryoutput_v1_interface.h"
 #include "wayland/primaryselectiondevicemanager_v1_interface.h"
 #include "wayland/relativepointer_v1_interface.h"
@@ -56,6 +58,7 @@
 #include "wayland/shadow_interface.h"
 #include "wayland/subcompositor_interface.h"
 #include "wayland/tablet_v2_interface.h"
+#include "wayland/tearingcontrol_v1_interface.h"
 #include "wayland/viewporter_interface.h"
 #include "wayland/xdgactivation_v1_interface.h"
 #include "wayland/xdgdecoration_v1_interface.h"
@@ -304,6 +307,16 @@ void WaylandServer::handleOutputDisabled(Output *output)
 
 bool WaylandServer::start()
 {
+    // High rate input devices can wake up the compositor a thousand times per second or more,
+    // coalesce the events sent to clients rather than flushing them after every wake up.
+    std::chrono::milliseconds flushInterval(2);
+    bool ok = false;
+    const int interval = qEnvironmentVariableIntValue("KWIN_WAYLAND_FLUSH_INTERVAL", &ok);
+    if (ok && interval >= 0) {
+        flushInterval = std::chrono::milliseconds(interval);
+    }
+    m_display->setFlushInterval(flushInterval);
+
     return m_display->start();
 }
 
@@ -373,7 +386,9 @@ bool WaylandServer::init(InitializationFlags flags)
     });
 
     new ViewporterInterface(m_display, m_display);
+    new PresentationTimeInterface(m_display, m_display);
     new FractionalScaleManagerV1Interface(m_display, m_display);
+    new TearingControlManagerV1Interface(m_display, m_display);
     m_display->createShm();
     m_seat = new SeatInterface(m_display, m_display);
     new PointerGesturesV1Interface(m_display, m_display);
@@ -486,6 +501,14 @@ KWaylandServer::LinuxDmaBufV1ClientBufferIntegration *WaylandServer::linuxDmabuf
     return m_linuxDmabuf;
 }
 
+KWaylandServer::LinuxDrmSyncObjV1Interface *WaylandServer::linuxDrmSyncObj(int drmFd)
+{
+    if (!m_linuxDrmSyncObj) {
+        m_linuxDrmSyncObj = new LinuxDrmSyncObjV1Interface(m_display, drmFd, m_display);
+    }
+    return m_linuxDrmSyncObj;
+}
+
 SurfaceInterface *WaylandServer::findForeignTransientForSurface(SurfaceInterface *surface)
 {
     return m_XdgForeign->transientFor(surface);
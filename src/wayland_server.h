@@ -45,6 +45,7 @@ class XdgForeignV2Interface;
 class XdgOutputManagerV1Interface;
 class LinuxDmaBufV1ClientBufferIntegration;
 class LinuxDmaBufV1ClientBuffer;
+class LinuxDrmSyncObjV1Interface;
 class TabletManagerV2Interface;
 class KeyboardShortcutsInhibitManagerV1Interface;
 class XdgDecorationManagerV1Interface;
@@ -131,6 +132,12 @@ public:
 
     KWaylandServer::LinuxDmaBufV1ClientBufferIntegration *linuxDmabuf();
 
+    /**
+     * Creates the linux-drm-syncobj global on the DRM device @a drmFd of the renderer, if it
+     * hasn't been created yet. The device must support timeline syncobjs.
+     */
+    KWaylandServer::LinuxDrmSyncObjV1Interface *linuxDrmSyncObj(int drmFd);
+
     KWaylandServer::InputMethodV1Interface *inputMethod() const
     {
         return m_inputMethod;
@@ -278,6 +285,7 @@ private:
     KWaylandServer::XdgOutputManagerV1Interface *m_xdgOutputManagerV1 = nullptr;
     KWaylandServer::XdgDecorationManagerV1Interface *m_xdgDecorationManagerV1 = nullptr;
     KWaylandServer::LinuxDmaBufV1ClientBufferIntegration *m_linuxDmabuf = nullptr;
+    KWaylandServer::LinuxDrmSyncObjV1Interface *m_linuxDrmSyncObj = nullptr;
     KWaylandServer::KeyboardShortcutsInhibitManagerV1Interface *m_keyboardShortcutsInhibitManager = nullptr;
     QSet<KWaylandServer::LinuxDmaBufV1ClientBuffer *> m_linuxDmabufBuffers;
     QPointer<KWaylandServer::ClientConnection> m_xwaylandConnection;
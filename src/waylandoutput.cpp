@@ -57,11 +57,26 @@ void WaylandOutput::scheduleUpdate()
 void WaylandOutput::update()
 {
     const QRect geometry = m_platformOutput->geometry();
+    const int scale = std::ceil(m_platformOutput->scale());
+    const KWaylandServer::OutputInterface::Mode mode{m_platformOutput->modeSize(), m_platformOutput->refreshRate()};
+
+    // Every done event makes the clients relayout, so don't send any if the output has only
+    // changed in ways that aren't visible through wl_output and xdg_output.
+    const bool changed = m_waylandOutput->globalPosition() != geometry.topLeft()
+        || m_waylandOutput->scale() != scale
+        || m_waylandOutput->transform() != m_platformOutput->transform()
+        || m_waylandOutput->pixelSize() != mode.size
+        || m_waylandOutput->refreshRate() != mode.refreshRate
+        || m_xdgOutputV1->logicalPosition() != QPointF(geometry.topLeft())
+        || m_xdgOutputV1->logicalSize() != QSizeF(geometry.size());
+    if (!changed) {
+        return;
+    }
 
     m_waylandOutput->setGlobalPosition(geometry.topLeft());
-    m_waylandOutput->setScale(std::ceil(m_platformOutput->scale()));
+    m_waylandOutput->setScale(scale);
     m_waylandOutput->setTransform(m_platformOutput->transform());
-    m_waylandOutput->setMode(m_platformOutput->modeSize(), m_platformOutput->refreshRate());
+    m_waylandOutput->setMode(mode);
 
     m_xdgOutputV1->setLogicalPosition(geometry.topLeft());
     m_xdgOutputV1->setLogicalSize(geometry.size());
@@ -32,6 +32,7 @@
 #include "shadowitem.h"
 #include "surfaceitem_x11.h"
 #include "useractions.h"
+#include "utils/iconcache.h"
 #include "virtualdesktops.h"
 #include "wayland/output_interface.h"
 #include "wayland/plasmawindowmanagement_interface.h"
@@ -123,6 +124,7 @@ Window::~Window()
 {
     Q_ASSERT(m_blockGeometryUpdates == 0);
     Q_ASSERT(m_decoration.decoration == nullptr);
+    IconCache::release(m_icon);
     delete info;
 }
 
@@ -220,9 +222,9 @@ QRectF Window::visibleGeometry() const
     return QRectF();
 }
 
-Xcb::Property Window::fetchWmClientLeader() const
+Xcb::Property Window::fetchWmClientLeader(xcb_window_t window)
 {
-    return Xcb::Property(false, window(), atoms->wm_client_leader, XCB_ATOM_WINDOW, 0, 10000);
+    return Xcb::Property(false, window, atoms->wm_client_leader, XCB_ATOM_WINDOW, 0, 10000);
 }
 
 void Window::readWmClientLeader(Xcb::Property &prop)
@@ -232,7 +234,7 @@ void Window::readWmClientLeader(Xcb::Property &prop)
 
 void Window::getWmClientLeader()
 {
-    auto prop = fetchWmClientLeader();
+    auto prop = fetchWmClientLeader(window());
     readWmClientLeader(prop);
 }
 
@@ -545,10 +547,15 @@ bool Window::isDeleted() const
 bool Window::isOnCurrentActivity() const
 {
 #if KWIN_BUILD_ACTIVITIES
-    if (!Workspace::self()->activities()) {
+    const Activities *activities = Workspace::self()->activities();
+    if (!activities || m_activityMask == 0) {
         return true;
     }
-    return isOnActivity(Workspace::self()->activities()->current());
+    const quint64 currentMask = activities->currentMask();
+    if ((m_activityMask | currentMask) & Activities::s_unindexedMask) {
+        return isOnActivity(activities->current());
+    }
+    return m_activityMask & currentMask;
 #else
     return true;
 #endif
@@ -576,9 +583,9 @@ xcb_window_t Window::frameId() const
     return m_client;
 }
 
-Xcb::Property Window::fetchSkipCloseAnimation() const
+Xcb::Property Window::fetchSkipCloseAnimation(xcb_window_t window)
 {
-    return Xcb::Property(false, window(), atoms->kde_skip_close_animation, XCB_ATOM_CARDINAL, 0, 1);
+    return Xcb::Property(false, window, atoms->kde_skip_close_animation, XCB_ATOM_CARDINAL, 0, 1);
 }
 
 void Window::readSkipCloseAnimation(Xcb::Property &property)
@@ -588,7 +595,7 @@ void Window::readSkipCloseAnimation(Xcb::Property &property)
 
 void Window::getSkipCloseAnimation()
 {
-    Xcb::Property property = fetchSkipCloseAnimation();
+    Xcb::Property property = fetchSkipCloseAnimation(window());
     readSkipCloseAnimation(property);
 }
 
@@ -723,7 +730,17 @@ QMargins Window::frameMargins() const
 
 bool Window::isOnDesktop(VirtualDesktop *desktop) const
 {
-    return isOnAllDesktops() || desktops().contains(desktop);
+    if (isOnAllDesktops()) {
+        return true;
+    }
+    if (!desktop) {
+        return false;
+    }
+    const quint64 bit = desktop->membershipBit();
+    if (bit == VirtualDesktop::s_unindexedMembershipBit) {
+        return desktops().contains(desktop);
+    }
+    return m_desktopMask & bit;
 }
 
 bool Window::isOnDesktop(int d) const
@@ -814,7 +831,9 @@ void Window::doSetSkipSwitcher()
 
 void Window::setIcon(const QIcon &icon)
 {
-    m_icon = icon;
+    // The windows of an application usually have the same icon, keep it only once.
+    const QIcon previousIcon = std::exchange(m_icon, IconCache::acquire(icon));
+    IconCache::release(previousIcon);
     Q_EMIT iconChanged();
 }
 
@@ -1101,6 +1120,7 @@ void Window::setDesktops(QVector<VirtualDesktop *> desktops)
     const bool wasOnCurrentDesktop = isOnCurrentDesktop() && was_desk >= 0;
 
     m_desktops = desktops;
+    m_desktopMask = VirtualDesktop::membershipMask(m_desktops);
 
     if (windowManagementInterface()) {
         if (m_desktops.isEmpty()) {
@@ -3446,6 +3466,15 @@ void Window::evaluateWindowRules()
     applyWindowRules();
 }
 
+void Window::evaluateTitleWindowRules()
+{
+    // the caption also changes when only its suffix does
+    if (captionNormal() == m_rulesCaption) {
+        return;
+    }
+    evaluateWindowRules();
+}
+
 /**
  * Returns the list of activities the window window is on.
  * if it's on all activities, the list will be empty.
@@ -3560,6 +3589,9 @@ void Window::setOnAllActivities(bool all)
  */
 void Window::updateActivities(bool includeTransients)
 {
+#if KWIN_BUILD_ACTIVITIES
+    m_activityMask = Activities::mask(activities());
+#endif
     if (m_activityUpdatesBlocked) {
         m_blockedActivityUpdatesRequireTransients |= includeTransients;
         return;
@@ -4401,7 +4433,8 @@ void Window::cleanTabBox()
 
 void Window::setupWindowRules(bool ignore_temporary)
 {
-    disconnect(this, &Window::captionChanged, this, &Window::evaluateWindowRules);
+    disconnect(this, &Window::captionChanged, this, &Window::evaluateTitleWindowRules);
+    m_rulesCaption = captionNormal();
     m_rules = workspace()->rulebook()->find(this, ignore_temporary);
     // check only after getting the rules, because there may be a rule forcing window type
 }
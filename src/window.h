@@ -1091,6 +1091,10 @@ public:
     void removeRule(Rules *r);
     void setupWindowRules(bool ignore_temporary);
     void evaluateWindowRules();
+    /**
+     * Re-evaluates the window rules if the caption differs from the one they were matched against.
+     */
+    void evaluateTitleWindowRules();
     virtual void applyWindowRules();
     virtual bool takeFocus() = 0;
     virtual bool wantsInput() const = 0;
@@ -1565,7 +1569,7 @@ protected:
     void detectShape(xcb_window_t id);
     virtual void propertyNotifyEvent(xcb_property_notify_event_t *e);
     virtual void clientMessageEvent(xcb_client_message_event_t *e);
-    Xcb::Property fetchWmClientLeader() const;
+    static Xcb::Property fetchWmClientLeader(xcb_window_t window);
     void readWmClientLeader(Xcb::Property &p);
     void getWmClientLeader();
     void getWmClientMachine();
@@ -1582,7 +1586,7 @@ protected:
 
     void getResourceClass();
     void setResourceClass(const QByteArray &name, const QByteArray &className = QByteArray());
-    Xcb::Property fetchSkipCloseAnimation() const;
+    static Xcb::Property fetchSkipCloseAnimation(xcb_window_t window);
     void readSkipCloseAnimation(Xcb::Property &prop);
     void getSkipCloseAnimation();
     void copyToDeleted(Window *c);
@@ -1908,6 +1912,10 @@ protected:
     void cleanTabBox();
 
     QStringList m_activityList;
+    // The membership masks of desktops() and activities(), kept up to date by the subclasses
+    // that override those. An empty mask means on all desktops or activities.
+    quint64 m_desktopMask = 0;
+    quint64 m_activityMask = 0;
 
 private Q_SLOTS:
     void shadeHover();
@@ -1987,6 +1995,7 @@ private:
     int m_blockGeometryUpdates = 0; // > 0 = New geometry is remembered, but not actually set
     MoveResizeMode m_pendingMoveResizeMode = MoveResizeMode::None;
     friend class GeometryUpdatesBlocker;
+    friend class Workspace; // for GeometryTransaction
     Output *m_moveResizeOutput;
     QRectF m_moveResizeGeometry;
     QRectF m_keyboardGeometryRestore;
@@ -2026,6 +2035,7 @@ private:
     QKeySequence _shortcut;
 
     WindowRules m_rules;
+    QString m_rulesCaption;
     quint32 m_lastUsageSerial = 0;
     bool m_lockScreenOverlay = false;
 };
@@ -2268,7 +2278,7 @@ inline WindowItem *Window::windowItem() const
 
 inline bool Window::isOnAllDesktops() const
 {
-    return desktops().isEmpty();
+    return m_desktopMask == 0;
 }
 
 inline bool Window::isOnAllActivities() const
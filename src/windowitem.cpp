@@ -74,6 +74,16 @@ Window *WindowItem::window() const
     return m_window;
 }
 
+std::chrono::milliseconds WindowItem::lastFrameCallbackTimestamp() const
+{
+    return m_lastFrameCallbackTimestamp;
+}
+
+void WindowItem::setLastFrameCallbackTimestamp(std::chrono::milliseconds timestamp)
+{
+    m_lastFrameCallbackTimestamp = timestamp;
+}
+
 void WindowItem::refVisible(int reason)
 {
     if (reason & PAINT_DISABLED_BY_HIDDEN) {
@@ -161,6 +171,11 @@ bool WindowItem::computeVisibility() const
 void WindowItem::updateVisibility()
 {
     setVisible(computeVisibility());
+
+    // The decoration of a hidden window isn't painted, its texture can go until it's shown again.
+    if (!isVisible() && m_decorationItem) {
+        m_decorationItem->releaseRenderer();
+    }
 }
 
 void WindowItem::updatePosition()
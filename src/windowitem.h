@@ -8,6 +8,8 @@
 
 #include "item.h"
 
+#include <chrono>
+
 namespace KDecoration2
 {
 class Decoration;
@@ -52,6 +54,13 @@ public:
     void refVisible(int reason);
     void unrefVisible(int reason);
 
+    /**
+     * The presentation timestamp of the last frame after which the window got its frame
+     * callbacks. The scene uses it to throttle the frame callbacks of occluded windows.
+     */
+    std::chrono::milliseconds lastFrameCallbackTimestamp() const;
+    void setLastFrameCallbackTimestamp(std::chrono::milliseconds timestamp);
+
 protected:
     explicit WindowItem(Window *window, Item *parent = nullptr);
     void updateSurfaceItem(SurfaceItem *surfaceItem);
@@ -78,6 +87,7 @@ private:
     int m_forceVisibleByDesktopCount = 0;
     int m_forceVisibleByMinimizeCount = 0;
     int m_forceVisibleByActivityCount = 0;
+    std::chrono::milliseconds m_lastFrameCallbackTimestamp = std::chrono::milliseconds::zero();
 };
 
 /**
@@ -55,6 +55,7 @@
 #include "utils/xcbutils.h"
 #include "virtualdesktops.h"
 #include "was_user_interaction_x11_filter.h"
+#include "wayland/display.h"
 #include "wayland_server.h"
 #include "xwaylandwindow.h"
 // KDE
@@ -372,9 +373,23 @@ void Workspace::initializeX11()
             windowGeometries[i] = Xcb::WindowGeometry(wins[i]);
         }
 
-        // Get the replies
+        // Get the replies, and request everything that managing the windows needs at once, so
+        // that it's one round trip for all windows instead of one per window
+        std::vector<std::unique_ptr<X11WindowPrefetch>> prefetches(tree->children_len);
         for (int i = 0; i < tree->children_len; i++) {
-            Xcb::WindowAttributes attr(windowAttributes.at(i));
+            Xcb::WindowAttributes &attr = windowAttributes[i];
+
+            if (attr.isNull() || attr->override_redirect || attr->map_state == XCB_MAP_STATE_UNMAPPED) {
+                continue;
+            }
+            if (Application::wasCrash()) {
+                fixPositionAfterCrash(wins[i], windowGeometries.at(i).data());
+            }
+            prefetches[i] = std::make_unique<X11WindowPrefetch>(wins[i]);
+        }
+
+        for (int i = 0; i < tree->children_len; i++) {
+            Xcb::WindowAttributes &attr = windowAttributes[i];
 
             if (attr.isNull()) {
                 continue;
@@ -385,13 +400,8 @@ void Workspace::initializeX11()
                     // ### This will request the attributes again
                     createUnmanaged(wins[i]);
                 }
-            } else if (attr->map_state != XCB_MAP_STATE_UNMAPPED) {
-                if (Application::wasCrash()) {
-                    fixPositionAfterCrash(wins[i], windowGeometries.at(i).data());
-                }
-
-                // ### This will request the attributes again
-                createX11Window(wins[i], true);
+            } else if (prefetches[i]) {
+                createX11Window(*prefetches[i], true);
             }
         }
 
@@ -838,6 +848,12 @@ void Workspace::removeFromStack(Window *window)
 }
 
 X11Window *Workspace::createX11Window(xcb_window_t windowId, bool is_mapped)
+{
+    X11WindowPrefetch prefetch(windowId);
+    return createX11Window(prefetch, is_mapped);
+}
+
+X11Window *Workspace::createX11Window(X11WindowPrefetch &prefetch, bool is_mapped)
 {
     StackingUpdatesBlocker blocker(this);
     X11Window *window = nullptr;
@@ -850,7 +866,7 @@ X11Window *Workspace::createX11Window(xcb_window_t windowId, bool is_mapped)
     if (X11Compositor *compositor = X11Compositor::self()) {
         connect(window, &X11Window::blockingCompositingChanged, compositor, &X11Compositor::updateClientCompositeBlocking);
     }
-    if (!window->manage(windowId, is_mapped)) {
+    if (!window->manage(prefetch, is_mapped)) {
         X11Window::deleteClient(window);
         return nullptr;
     }
@@ -892,6 +908,11 @@ void Workspace::addX11Window(X11Window *window)
     }
     m_x11Clients.append(window);
     m_allClients.append(window);
+    for (xcb_window_t id : {window->window(), window->wrapperId(), window->frameId(), window->inputId()}) {
+        if (id != XCB_WINDOW_NONE) {
+            m_x11WindowIds.insert(id, window);
+        }
+    }
     addToStack(window);
     updateClientArea(); // This cannot be in manage(), because the window got added only now
     window->updateLayer();
@@ -914,6 +935,7 @@ void Workspace::addX11Window(X11Window *window)
 void Workspace::addUnmanaged(Unmanaged *window)
 {
     m_unmanaged.append(window);
+    m_unmanagedIds.insert(window->window(), window);
     addToStack(window);
 }
 
@@ -925,6 +947,14 @@ void Workspace::removeX11Window(X11Window *window)
     Q_ASSERT(m_x11Clients.contains(window));
     // TODO: if marked window is removed, notify the marked list
     m_x11Clients.removeAll(window);
+    // the ids might have been reset already while the window got released
+    for (auto it = m_x11WindowIds.begin(); it != m_x11WindowIds.end();) {
+        if (it.value() == window) {
+            it = m_x11WindowIds.erase(it);
+        } else {
+            ++it;
+        }
+    }
     Group *group = findGroup(window->window());
     if (group != nullptr) {
         group->lostLeader();
@@ -936,6 +966,13 @@ void Workspace::removeUnmanaged(Unmanaged *window)
 {
     Q_ASSERT(m_unmanaged.contains(window));
     m_unmanaged.removeAll(window);
+    for (auto it = m_unmanagedIds.begin(); it != m_unmanagedIds.end();) {
+        if (it.value() == window) {
+            it = m_unmanagedIds.erase(it);
+        } else {
+            ++it;
+        }
+    }
     removeFromStack(window);
     Q_EMIT unmanagedRemoved(window);
 }
@@ -1010,6 +1047,9 @@ void Workspace::removeWindow(Window *window)
     }
 
     m_allClients.removeAll(window);
+    if (m_geometryBlockedWindows.removeOne(window)) {
+        window->blockGeometryUpdates(false);
+    }
     if (window == m_delayFocusWindow) {
         cancelDelayFocus();
     }
@@ -1186,7 +1226,8 @@ void Workspace::slotCurrentDesktopChanged(uint oldDesktop, uint newDesktop)
     closeActivePopup();
     ++block_focus;
     StackingUpdatesBlocker blocker(this);
-    updateWindowVisibilityOnDesktopChange(VirtualDesktopManager::self()->desktopForX11Id(newDesktop));
+    updateWindowVisibilityOnDesktopChange(VirtualDesktopManager::self()->desktopForX11Id(oldDesktop),
+                                          VirtualDesktopManager::self()->desktopForX11Id(newDesktop));
     // Restore the focus on this desktop
     --block_focus;
 
@@ -1205,17 +1246,31 @@ void Workspace::slotCurrentDesktopChangingCancelled()
     Q_EMIT currentDesktopChangingCancelled();
 }
 
-void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop)
+void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *oldDesktop, VirtualDesktop *newDesktop)
 {
+    // Only the windows that are on exactly one of the two desktops change their visibility,
+    // the ones on all desktops or on neither of them are left alone.
+    QVector<X11Window *> hiding;
+    QVector<X11Window *> showing;
     for (auto it = stacking_order.constBegin(); it != stacking_order.constEnd(); ++it) {
         X11Window *c = qobject_cast<X11Window *>(*it);
-        if (!c) {
+        if (!c || !c->isOnCurrentActivity()) {
+            continue;
+        }
+        const bool onNewDesktop = c->isOnDesktop(newDesktop);
+        if (oldDesktop && c->isOnDesktop(oldDesktop) == onNewDesktop) {
             continue;
         }
-        if (!c->isOnDesktop(newDesktop) && c != m_moveResizeWindow && c->isOnCurrentActivity()) {
-            (c)->updateVisibility();
+        if (onNewDesktop) {
+            showing.append(c);
+        } else if (c != m_moveResizeWindow) {
+            hiding.append(c);
         }
     }
+
+    for (X11Window *c : std::as_const(hiding)) {
+        c->updateVisibility();
+    }
     // Now propagate the change, after hiding, before showing
     if (rootInfo()) {
         rootInfo()->setCurrentDesktop(VirtualDesktopManager::self()->current());
@@ -1225,14 +1280,9 @@ void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop
         m_moveResizeWindow->setDesktops({newDesktop});
     }
 
-    for (int i = stacking_order.size() - 1; i >= 0; --i) {
-        X11Window *c = qobject_cast<X11Window *>(stacking_order.at(i));
-        if (!c) {
-            continue;
-        }
-        if (c->isOnDesktop(newDesktop) && c->isOnCurrentActivity()) {
-            c->updateVisibility();
-        }
+    // show from the top, so that the windows below get exposed only once
+    for (auto it = showing.crbegin(); it != showing.crend(); ++it) {
+        (*it)->updateVisibility();
     }
     if (showingDesktop()) { // Do this only after desktop change to avoid flicker
         setShowingDesktop(false);
@@ -1551,7 +1601,7 @@ void Workspace::sendWindowToDesktop(Window *window, int desk, bool dont_activate
     for (auto it = transients_stacking_order.constBegin(); it != transients_stacking_order.constEnd(); ++it) {
         sendWindowToDesktop(*it, desk, dont_activate);
     }
-    updateClientArea();
+    updateClientArea(window);
 }
 
 void Workspace::sendWindowToOutput(Window *window, Output *output)
@@ -1832,6 +1882,18 @@ QString Workspace::supportInformation() const
             support.append(QStringLiteral("Adaptive Sync: %1\n").arg(vrr));
         }
     }
+    if (waylandServer()) {
+        support.append(QStringLiteral("\nWayland Clients\n"));
+        support.append(QStringLiteral("===============\n"));
+        support.append(QStringLiteral("Flush interval: %1 ms\n").arg(waylandServer()->display()->flushInterval().count()));
+        const auto connections = waylandServer()->display()->connections();
+        for (const KWaylandServer::ClientConnection *connection : connections) {
+            support.append(QStringLiteral("%1 (pid %2): %3 unread bytes\n")
+                               .arg(connection->executablePath())
+                               .arg(connection->processId())
+                               .arg(connection->unreadBytes()));
+        }
+    }
     support.append(QStringLiteral("\nCompositing\n"));
     support.append(QStringLiteral("===========\n"));
     if (effects) {
@@ -1995,34 +2057,41 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool(const Unmanaged *)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    return m_unmanagedIds.value(w);
 }
 
 X11Window *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
+    X11Window *window = m_x11WindowIds.value(w);
+    if (!window) {
+        return nullptr;
+    }
     switch (predicate) {
     case Predicate::WindowMatch:
-        return findClient([w](const X11Window *c) {
-            return c->window() == w;
-        });
+        return window->window() == w ? window : nullptr;
     case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->wrapperId() == w;
-        });
+        return window->wrapperId() == w ? window : nullptr;
     case Predicate::FrameIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->frameId() == w;
-        });
+        return window->frameId() == w ? window : nullptr;
     case Predicate::InputIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->inputId() == w;
-        });
+        return window->inputId() == w ? window : nullptr;
     }
     return nullptr;
 }
 
+void Workspace::addX11WindowId(xcb_window_t id, X11Window *window)
+{
+    // the ids of windows that are still being managed are added with the window
+    if (m_x11Clients.contains(window)) {
+        m_x11WindowIds.insert(id, window);
+    }
+}
+
+void Workspace::removeX11WindowId(xcb_window_t id)
+{
+    m_x11WindowIds.remove(id);
+}
+
 Window *Workspace::findToplevel(std::function<bool(const Window *)> func) const
 {
     if (auto *ret = Window::findInList(m_allClients, func)) {
@@ -2237,11 +2306,29 @@ void Workspace::checkTransients(xcb_window_t w)
     }
 }
 
+void Workspace::blockGeometryUpdates(bool block)
+{
+    if (block) {
+        if (m_blockGeometryUpdates++ == 0) {
+            m_geometryBlockedWindows = m_allClients;
+            for (Window *window : std::as_const(m_geometryBlockedWindows)) {
+                window->blockGeometryUpdates(true);
+            }
+        }
+    } else if (--m_blockGeometryUpdates == 0) {
+        const QList<Window *> windows = std::exchange(m_geometryBlockedWindows, {});
+        for (Window *window : windows) {
+            window->blockGeometryUpdates(false);
+        }
+    }
+}
+
 /**
  * Resizes the workspace after an XRANDR screen size change
  */
 void Workspace::desktopResized()
 {
+    GeometryTransaction transaction(this);
     m_placementTracker->inhibit();
 
     const QRect oldGeometry = m_geometry;
@@ -2377,6 +2464,67 @@ QRectF Workspace::adjustClientArea(Window *window, const QRectF &area) const
     return adjustedArea;
 }
 
+bool Workspace::StrutContribution::operator==(const StrutContribution &other) const
+{
+    return workArea == other.workArea
+        && restrictsWorkArea == other.restrictsWorkArea
+        && strutRects == other.strutRects
+        && screenAreas == other.screenAreas
+        && onAllDesktops == other.onAllDesktops
+        && desktops == other.desktops;
+}
+
+bool Workspace::StrutContribution::isOnDesktop(const VirtualDesktop *desktop) const
+{
+    return onAllDesktops || desktops.contains(desktop);
+}
+
+std::optional<Workspace::StrutContribution> Workspace::strutContribution(Window *window) const
+{
+    if (!window->hasStrut()) {
+        return std::nullopt;
+    }
+    StrutContribution contribution;
+    contribution.workArea = adjustClientArea(window, m_geometry);
+
+    // This happens sometimes when the workspace size changes and the
+    // struted windows haven't repositioned yet
+    if (!contribution.workArea.isValid()) {
+        return std::nullopt;
+    }
+    // sanity check that a strut doesn't exclude a complete screen geometry
+    // this is a violation to EWMH, as KWin just ignores the strut
+    for (const Output *output : std::as_const(m_outputs)) {
+        if (!contribution.workArea.intersects(output->geometry())) {
+            qCDebug(KWIN_CORE) << "Adjusted client area would exclude a complete screen, ignore";
+            contribution.workArea = m_geometry;
+            break;
+        }
+    }
+    contribution.strutRects = window->strutRects();
+    const QRect clientsScreenRect = window->output()->geometry();
+    for (auto strut = contribution.strutRects.begin(); strut != contribution.strutRects.end(); strut++) {
+        *strut = StrutRect((*strut).intersected(clientsScreenRect), (*strut).area());
+    }
+
+    // Ignore offscreen xinerama struts. These interfere with the larger monitors on the setup
+    // and should be ignored so that applications that use the work area to work out where
+    // windows can go can use the entire visible area of the larger monitors.
+    // This goes against the EWMH description of the work area but it is a toss up between
+    // having unusable sections of the screen (Which can be quite large with newer monitors)
+    // or having some content appear offscreen (Relatively rare compared to other).
+    contribution.restrictsWorkArea = !hasOffscreenXineramaStrut(window);
+
+    for (const Output *output : std::as_const(m_outputs)) {
+        contribution.screenAreas[output] = adjustClientArea(window, output->fractionalGeometry());
+    }
+    contribution.onAllDesktops = window->isOnAllDesktops();
+    if (!contribution.onAllDesktops) {
+        contribution.desktops = window->desktops();
+    }
+    return contribution;
+}
+
 /**
  * Updates the current client areas according to the current windows.
  *
@@ -2388,62 +2536,89 @@ QRectF Workspace::adjustClientArea(Window *window, const QRectF &area) const
  */
 void Workspace::updateClientArea()
 {
-    const QVector<VirtualDesktop *> desktops = VirtualDesktopManager::self()->desktops();
+    m_strutContributions.clear();
+    for (Window *window : qAsConst(m_allClients)) {
+        if (std::optional<StrutContribution> contribution = strutContribution(window)) {
+            m_strutContributions.insert(window, *contribution);
+        }
+    }
+
+    updateClientAreas(VirtualDesktopManager::self()->desktops(), false);
+}
+
+/**
+ * Updates the client areas after the strut of @p window may have changed, e.g. because it
+ * has been moved or sent to another desktop. Only the areas of the desktops the strut is or
+ * has been on are recomputed, and nothing is done if the strut is still the same.
+ *
+ * The struts of the other windows, the outputs and the desktops must not have changed since
+ * the last full update, use updateClientArea() if they may have.
+ */
+void Workspace::updateClientArea(Window *window)
+{
+    const std::optional<StrutContribution> contribution = strutContribution(window);
+    const auto it = m_strutContributions.constFind(window);
+    const std::optional<StrutContribution> previousContribution = it != m_strutContributions.constEnd() ? std::make_optional(*it) : std::nullopt;
+    if (contribution == previousContribution) {
+        return;
+    }
+
+    if (contribution) {
+        m_strutContributions.insert(window, *contribution);
+    } else {
+        m_strutContributions.remove(window);
+    }
 
+    QVector<VirtualDesktop *> desktops;
+    const QVector<VirtualDesktop *> allDesktops = VirtualDesktopManager::self()->desktops();
+    for (VirtualDesktop *desktop : allDesktops) {
+        if ((contribution && contribution->isOnDesktop(desktop)) || (previousContribution && previousContribution->isOnDesktop(desktop))) {
+            desktops.append(desktop);
+        }
+    }
+    updateClientAreas(desktops, true);
+}
+
+void Workspace::updateClientAreas(const QVector<VirtualDesktop *> &desktops, bool incremental)
+{
+    // An incremental update keeps the areas of the other desktops.
     QHash<const VirtualDesktop *, QRectF> workAreas;
     QHash<const VirtualDesktop *, StrutRects> restrictedAreas;
     QHash<const VirtualDesktop *, QHash<const Output *, QRectF>> screenAreas;
+    if (incremental) {
+        workAreas = m_workAreas;
+        restrictedAreas = m_restrictedAreas;
+        screenAreas = m_screenAreas;
+    }
 
     for (const VirtualDesktop *desktop : desktops) {
         workAreas[desktop] = m_geometry;
+        restrictedAreas.remove(desktop);
 
+        QHash<const Output *, QRectF> &desktopScreenAreas = screenAreas[desktop];
+        desktopScreenAreas.clear();
         for (const Output *output : std::as_const(m_outputs)) {
-            screenAreas[desktop][output] = output->fractionalGeometry();
+            desktopScreenAreas[output] = output->fractionalGeometry();
         }
     }
 
+    // Whether a strut that would remove a screen completely is ignored depends on the struts
+    // before it, so the windows are always gone through in the same order.
     for (Window *window : qAsConst(m_allClients)) {
-        if (!window->hasStrut()) {
+        const auto contribution = m_strutContributions.constFind(window);
+        if (contribution == m_strutContributions.constEnd()) {
             continue;
         }
-        QRectF r = adjustClientArea(window, m_geometry);
-
-        // This happens sometimes when the workspace size changes and the
-        // struted windows haven't repositioned yet
-        if (!r.isValid()) {
-            continue;
-        }
-        // sanity check that a strut doesn't exclude a complete screen geometry
-        // this is a violation to EWMH, as KWin just ignores the strut
-        for (const Output *output : std::as_const(m_outputs)) {
-            if (!r.intersects(output->geometry())) {
-                qCDebug(KWIN_CORE) << "Adjusted client area would exclude a complete screen, ignore";
-                r = m_geometry;
-                break;
+        for (const VirtualDesktop *vd : desktops) {
+            if (!contribution->isOnDesktop(vd)) {
+                continue;
             }
-        }
-        StrutRects strutRegion = window->strutRects();
-        const QRect clientsScreenRect = window->output()->geometry();
-        for (auto strut = strutRegion.begin(); strut != strutRegion.end(); strut++) {
-            *strut = StrutRect((*strut).intersected(clientsScreenRect), (*strut).area());
-        }
-
-        // Ignore offscreen xinerama struts. These interfere with the larger monitors on the setup
-        // and should be ignored so that applications that use the work area to work out where
-        // windows can go can use the entire visible area of the larger monitors.
-        // This goes against the EWMH description of the work area but it is a toss up between
-        // having unusable sections of the screen (Which can be quite large with newer monitors)
-        // or having some content appear offscreen (Relatively rare compared to other).
-        bool hasOffscreenStrut = hasOffscreenXineramaStrut(window);
-
-        const auto vds = window->isOnAllDesktops() ? desktops : window->desktops();
-        for (VirtualDesktop *vd : vds) {
-            if (!hasOffscreenStrut) {
-                workAreas[vd] &= r;
+            if (contribution->restrictsWorkArea) {
+                workAreas[vd] &= contribution->workArea;
             }
-            restrictedAreas[vd] += strutRegion;
+            restrictedAreas[vd] += contribution->strutRects;
             for (Output *output : std::as_const(m_outputs)) {
-                const auto geo = screenAreas[vd][output].intersected(adjustClientArea(window, output->fractionalGeometry()));
+                const auto geo = screenAreas[vd][output].intersected(contribution->screenAreas.value(output));
                 // ignore the geometry if it results in the screen getting removed completely
                 if (!geo.isEmpty()) {
                     screenAreas[vd][output] = geo;
@@ -2469,6 +2644,16 @@ void Workspace::updateClientArea()
         }
 
         for (auto it = m_allClients.constBegin(); it != m_allClients.constEnd(); ++it) {
+            // the areas of the desktops that weren't updated are the same as before
+            if (incremental && !(*it)->isOnAllDesktops()) {
+                const QVector<VirtualDesktop *> windowDesktops = (*it)->desktops();
+                const bool affected = std::any_of(windowDesktops.begin(), windowDesktops.end(), [&desktops](VirtualDesktop *desktop) {
+                    return desktops.contains(desktop);
+                });
+                if (!affected) {
+                    continue;
+                }
+            }
             (*it)->checkWorkspacePosition();
         }
 
@@ -24,6 +24,7 @@
 // std
 #include <functional>
 #include <memory>
+#include <optional>
 
 class KConfig;
 class KConfigGroup;
@@ -63,6 +64,7 @@ class Unmanaged;
 class UserActionsMenu;
 class VirtualDesktop;
 class X11Window;
+struct X11WindowPrefetch;
 class X11EventFilter;
 class FocusChain;
 class ApplicationMenu;
@@ -136,6 +138,12 @@ public:
      * @see findClient(std::function<bool (const X11Window *)>)
      */
     X11Window *findClient(Predicate predicate, xcb_window_t w) const;
+    /**
+     * @internal Keeps the window id lookup of findClient(Predicate, xcb_window_t) up to date
+     * for the ids that change after the window has been added, i.e. the input window.
+     */
+    void addX11WindowId(xcb_window_t id, X11Window *window);
+    void removeX11WindowId(xcb_window_t id);
     void forEachClient(std::function<void(X11Window *)> func);
     void forEachAbstractClient(std::function<void(Window *)> func);
     Unmanaged *findUnmanaged(std::function<bool(const Unmanaged *)> func) const;
@@ -536,6 +544,7 @@ public Q_SLOTS:
     void setupWindowShortcutDone(bool);
 
     void updateClientArea();
+    void updateClientArea(Window *window);
 
 private Q_SLOTS:
     void desktopResized();
@@ -615,6 +624,7 @@ private:
     void lowerWindowWithinApplication(Window *window);
     bool allowFullClientRaising(const Window *window, xcb_timestamp_t timestamp);
     void blockStackingUpdates(bool block);
+    void blockGeometryUpdates(bool block);
     void updateToolWindows(bool also_hide);
     void fixPositionAfterCrash(xcb_window_t w, const xcb_get_geometry_reply_t *geom);
     void saveOldScreenSizes();
@@ -624,6 +634,7 @@ private:
 
     /// This is the right way to create a new X11 window
     X11Window *createX11Window(xcb_window_t windowId, bool is_mapped);
+    X11Window *createX11Window(X11WindowPrefetch &prefetch, bool is_mapped);
     void addX11Window(X11Window *c);
     void setupWindowConnections(Window *window);
     Unmanaged *createUnmanaged(xcb_window_t windowId);
@@ -635,7 +646,7 @@ private:
     //---------------------------------------------------------------------
 
     void closeActivePopup();
-    void updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop);
+    void updateWindowVisibilityOnDesktopChange(VirtualDesktop *oldDesktop, VirtualDesktop *newDesktop);
     void activateWindowOnNewDesktop(VirtualDesktop *desktop);
     Window *findWindowToActivateOnDesktop(VirtualDesktop *desktop);
     void removeWindow(Window *window);
@@ -652,8 +663,6 @@ private:
         QList<Constraint *> parents;
         // All constraints below our "above" window
         QList<Constraint *> children;
-        // Used to prevent cycles.
-        bool enqueued = false;
     };
 
     QList<Constraint *> m_constraints;
@@ -681,6 +690,9 @@ private:
     QList<X11Window *> m_x11Clients;
     QList<Window *> m_allClients;
     QList<Unmanaged *> m_unmanaged;
+    // the window, wrapper, frame and input ids of the X11 windows, every X11 event needs a lookup
+    QHash<xcb_window_t, X11Window *> m_x11WindowIds;
+    QHash<xcb_window_t, Unmanaged *> m_unmanagedIds;
     QList<Deleted *> deleted;
     QList<InternalWindow *> m_internalWindows;
 
@@ -722,6 +734,25 @@ private:
     std::unique_ptr<KStartupInfo> m_startup;
     std::unique_ptr<ColorMapper> m_colorMapper;
 
+    /**
+     * How the strut of a window restricts the client areas.
+     */
+    struct StrutContribution
+    {
+        QRectF workArea;
+        bool restrictsWorkArea = true;
+        StrutRects strutRects;
+        QHash<const Output *, QRectF> screenAreas;
+        bool onAllDesktops = false;
+        QVector<VirtualDesktop *> desktops;
+
+        bool operator==(const StrutContribution &other) const;
+        bool isOnDesktop(const VirtualDesktop *desktop) const;
+    };
+    std::optional<StrutContribution> strutContribution(Window *window) const;
+    void updateClientAreas(const QVector<VirtualDesktop *> &desktops, bool incremental);
+
+    QHash<const Window *, StrutContribution> m_strutContributions;
     QHash<const VirtualDesktop *, QRectF> m_workAreas;
     QHash<const VirtualDesktop *, StrutRects> m_restrictedAreas;
     QHash<const VirtualDesktop *, QHash<const Output *, QRectF>> m_screenAreas;
@@ -737,6 +768,9 @@ private:
     bool m_blockedPropagatingNewWindows; // Propagate also new windows after enabling stacking updates?
     std::unique_ptr<Xcb::Window> m_nullFocus;
     friend class StackingUpdatesBlocker;
+    int m_blockGeometryUpdates = 0; // When > 0, window geometry changes are applied only at the end
+    QList<Window *> m_geometryBlockedWindows;
+    friend class GeometryTransaction;
 
     std::unique_ptr<KillWindow> m_windowKiller;
     std::unique_ptr<X11EventFilter> m_movingClientFilter;
@@ -787,6 +821,29 @@ private:
     Workspace *ws;
 };
 
+/**
+ * Batches the geometry changes of all windows while it exists. Every window is moved or resized
+ * once at the end, with its final geometry, instead of sending a configure and damaging the
+ * scene for every intermediate step. Use it around operations that move many windows one
+ * after another, and which don't look at the frame geometry of the windows they've just moved.
+ */
+class GeometryTransaction
+{
+public:
+    explicit GeometryTransaction(Workspace *w)
+        : ws(w)
+    {
+        ws->blockGeometryUpdates(true);
+    }
+    ~GeometryTransaction()
+    {
+        ws->blockGeometryUpdates(false);
+    }
+
+private:
+    Workspace *ws;
+};
+
 class ColorMapper : public QObject
 {
     Q_OBJECT
@@ -11,6 +11,7 @@
 #include "x11window.h"
 // kwin
 #include "core/output.h"
+#include "core/renderloop.h"
 #if KWIN_BUILD_ACTIVITIES
 #include "activities.h"
 #endif
@@ -257,6 +258,9 @@ X11Window::~X11Window()
     if (m_syncRequest.alarm != XCB_NONE) {
         xcb_sync_destroy_alarm(kwinApp()->x11Connection(), m_syncRequest.alarm);
     }
+    if (m_frameSync.alarm != XCB_NONE) {
+        xcb_sync_destroy_alarm(kwinApp()->x11Connection(), m_frameSync.alarm);
+    }
     Q_ASSERT(!isInteractiveMoveResize());
     Q_ASSERT(m_client == XCB_WINDOW_NONE);
     Q_ASSERT(m_wrapper == XCB_WINDOW_NONE);
@@ -384,12 +388,35 @@ void X11Window::destroyWindow()
  * reparenting, initial geometry, initial state, placement, etc.
  * Returns false if KWin is not going to manage this window.
  */
+X11WindowPrefetch::X11WindowPrefetch(xcb_window_t window)
+    : window(window)
+    , attributes(window)
+    , geometry(window)
+    , wmClientLeader(X11Window::fetchWmClientLeader(window))
+    , skipCloseAnimation(X11Window::fetchSkipCloseAnimation(window))
+    , showOnScreenEdge(X11Window::fetchShowOnScreenEdge(window))
+    , colorScheme(X11Window::fetchPreferredColorScheme(window))
+    , firstInTabBox(X11Window::fetchFirstInTabBox(window))
+    , transient(X11Window::fetchTransient(window))
+    , activities(X11Window::fetchActivities(window))
+    , applicationMenuServiceName(X11Window::fetchApplicationMenuServiceName(window))
+    , applicationMenuObjectPath(X11Window::fetchApplicationMenuObjectPath(window))
+{
+}
+
 bool X11Window::manage(xcb_window_t w, bool isMapped)
+{
+    X11WindowPrefetch prefetch(w);
+    return manage(prefetch, isMapped);
+}
+
+bool X11Window::manage(X11WindowPrefetch &prefetch, bool isMapped)
 {
     StackingUpdatesBlocker stacking_blocker(workspace());
 
-    Xcb::WindowAttributes attr(w);
-    Xcb::WindowGeometry windowGeometry(w);
+    const xcb_window_t w = prefetch.window;
+    Xcb::WindowAttributes &attr = prefetch.attributes;
+    Xcb::WindowGeometry &windowGeometry = prefetch.geometry;
     if (attr.isNull() || windowGeometry.isNull()) {
         return false;
     }
@@ -409,16 +436,6 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     const NET::Properties2 properties2 =
         NET::WM2BlockCompositing | NET::WM2WindowClass | NET::WM2WindowRole | NET::WM2UserTime | NET::WM2StartupId | NET::WM2ExtendedStrut | NET::WM2Opacity | NET::WM2FullscreenMonitors | NET::WM2GroupLeader | NET::WM2Urgency | NET::WM2Input | NET::WM2Protocols | NET::WM2InitialMappingState | NET::WM2IconPixmap | NET::WM2OpaqueRegion | NET::WM2DesktopFileName | NET::WM2GTKFrameExtents | NET::WM2GTKApplicationId;
 
-    auto wmClientLeaderCookie = fetchWmClientLeader();
-    auto skipCloseAnimationCookie = fetchSkipCloseAnimation();
-    auto showOnScreenEdgeCookie = fetchShowOnScreenEdge();
-    auto colorSchemeCookie = fetchPreferredColorScheme();
-    auto firstInTabBoxCookie = fetchFirstInTabBox();
-    auto transientCookie = fetchTransient();
-    auto activitiesCookie = fetchActivities();
-    auto applicationMenuServiceNameCookie = fetchApplicationMenuServiceName();
-    auto applicationMenuObjectPathCookie = fetchApplicationMenuObjectPath();
-
     m_geometryHints.init(window());
     m_motif.init(window());
     info = new WinInfo(this, m_client, kwinApp()->x11RootWindow(), properties, properties2);
@@ -434,7 +451,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     m_colormap = attr->colormap;
 
     getResourceClass();
-    readWmClientLeader(wmClientLeaderCookie);
+    readWmClientLeader(prefetch.wmClientLeader);
     getWmClientMachine();
     getSyncCounter();
     // First only read the caption text, so that setupWindowRules() can use it for matching,
@@ -460,7 +477,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     updateAllowedActions(); // Group affects isMinimizable()
 
     setModal((info->state() & NET::Modal) != 0); // Needs to be valid before handling groups
-    readTransientProperty(transientCookie);
+    readTransientProperty(prefetch.transient);
     QByteArray desktopFileName{info->desktopFileName()};
     if (desktopFileName.isEmpty()) {
         desktopFileName = info->gtkApplicationId();
@@ -472,14 +489,14 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     m_geometryHints.read();
     getMotifHints();
     getWmOpaqueRegion();
-    readSkipCloseAnimation(skipCloseAnimationCookie);
+    readSkipCloseAnimation(prefetch.skipCloseAnimation);
 
     // TODO: Try to obey all state information from info->state()
 
     setOriginalSkipTaskbar((info->state() & NET::SkipTaskbar) != 0);
     setSkipPager((info->state() & NET::SkipPager) != 0);
     setSkipSwitcher((info->state() & NET::SkipSwitcher) != 0);
-    readFirstInTabBox(firstInTabBoxCookie);
+    readFirstInTabBox(prefetch.firstInTabBox);
 
     setupCompositing();
 
@@ -502,7 +519,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     init_minimize = rules()->checkMinimize(init_minimize, !isMapped);
     noborder = rules()->checkNoBorder(noborder, !isMapped);
 
-    readActivities(activitiesCookie);
+    readActivities(prefetch.activities);
 
     // Initial desktop placement
     std::optional<QVector<VirtualDesktop *>> initialDesktops;
@@ -682,10 +699,10 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
 
     // Create client group if the window will have a decoration
     bool dontKeepInArea = false;
-    setColorScheme(readPreferredColorScheme(colorSchemeCookie));
+    setColorScheme(readPreferredColorScheme(prefetch.colorScheme));
 
-    readApplicationMenuServiceName(applicationMenuServiceNameCookie);
-    readApplicationMenuObjectPath(applicationMenuObjectPathCookie);
+    readApplicationMenuServiceName(prefetch.applicationMenuServiceName);
+    readApplicationMenuObjectPath(prefetch.applicationMenuObjectPath);
 
     updateDecoration(false); // Also gravitates
     // TODO: Is CentralGravity right here, when resizing is done after gravitating?
@@ -960,7 +977,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     updateWindowRules(Rules::All); // Was blocked while !isManaged()
 
     setBlockingCompositing(info->isBlockingCompositing());
-    readShowOnScreenEdge(showOnScreenEdgeCookie);
+    readShowOnScreenEdge(prefetch.showOnScreenEdge);
 
     setupWindowManagementInterface();
 
@@ -1085,7 +1102,7 @@ void X11Window::updateInputWindow()
     }
 
     if (region.isEmpty()) {
-        m_decoInputExtent.reset();
+        destroyInputWindow();
         return;
     }
 
@@ -1103,6 +1120,7 @@ void X11Window::updateInputWindow()
         const uint32_t values[] = {true,
                                    XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION};
         m_decoInputExtent.create(bounds, XCB_WINDOW_CLASS_INPUT_ONLY, mask, values);
+        workspace()->addX11WindowId(m_decoInputExtent, this);
         if (mapping_state == Mapped) {
             m_decoInputExtent.map();
         }
@@ -1171,7 +1189,15 @@ void X11Window::destroyDecoration()
             Q_EMIT geometryShapeChanged(this, oldgeom);
         }
     }
-    m_decoInputExtent.reset();
+    destroyInputWindow();
+}
+
+void X11Window::destroyInputWindow()
+{
+    if (m_decoInputExtent.isValid()) {
+        workspace()->removeX11WindowId(m_decoInputExtent);
+        m_decoInputExtent.reset();
+    }
 }
 
 void X11Window::maybeCreateX11DecorationRenderer()
@@ -2292,44 +2318,63 @@ bool X11Window::wantsSyncCounter() const
     return true;
 }
 
+static xcb_sync_alarm_t createSyncAlarm(xcb_sync_counter_t counter)
+{
+    auto *c = kwinApp()->x11Connection();
+    const uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_EVENTS;
+    const uint32_t values[] = {
+        counter,
+        XCB_SYNC_VALUETYPE_RELATIVE,
+        XCB_SYNC_TESTTYPE_POSITIVE_TRANSITION,
+        1};
+    const xcb_sync_alarm_t alarm = xcb_generate_id(c);
+    auto cookie = xcb_sync_create_alarm_checked(c, alarm, mask, values);
+    UniqueCPtr<xcb_generic_error_t> error(xcb_request_check(c, cookie));
+    if (error) {
+        return XCB_NONE;
+    }
+    xcb_sync_change_alarm_value_list_t value;
+    memset(&value, 0, sizeof(value));
+    value.value.hi = 0;
+    value.value.lo = 1;
+    value.delta.hi = 0;
+    value.delta.lo = 1;
+    xcb_sync_change_alarm_aux(c, alarm, XCB_SYNC_CA_DELTA | XCB_SYNC_CA_VALUE, &value);
+    return alarm;
+}
+
 void X11Window::getSyncCounter()
 {
     if (!Xcb::Extensions::self()->isSyncAvailable()) {
         return;
     }
-    if (!wantsSyncCounter()) {
-        return;
-    }
 
-    Xcb::Property syncProp(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 1);
-    const xcb_sync_counter_t counter = syncProp.value<xcb_sync_counter_t>(XCB_NONE);
-    if (counter != XCB_NONE) {
+    // the second counter is only set by clients that support the extended frame synchronization
+    Xcb::Property syncProp(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 2);
+    const xcb_sync_counter_t *counters = syncProp.value<const xcb_sync_counter_t *>(32, XCB_ATOM_CARDINAL);
+    const int counterCount = counters ? xcb_get_property_value_length(syncProp.data()) / sizeof(xcb_sync_counter_t) : 0;
+
+    const xcb_sync_counter_t counter = counterCount > 0 ? counters[0] : XCB_NONE;
+    if (counter != XCB_NONE && wantsSyncCounter()) {
         m_syncRequest.counter = counter;
         m_syncRequest.value.hi = 0;
         m_syncRequest.value.lo = 0;
-        auto *c = kwinApp()->x11Connection();
-        xcb_sync_set_counter(c, m_syncRequest.counter, m_syncRequest.value);
+        xcb_sync_set_counter(kwinApp()->x11Connection(), m_syncRequest.counter, m_syncRequest.value);
         if (m_syncRequest.alarm == XCB_NONE) {
-            const uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_EVENTS;
-            const uint32_t values[] = {
-                m_syncRequest.counter,
-                XCB_SYNC_VALUETYPE_RELATIVE,
-                XCB_SYNC_TESTTYPE_POSITIVE_TRANSITION,
-                1};
-            m_syncRequest.alarm = xcb_generate_id(c);
-            auto cookie = xcb_sync_create_alarm_checked(c, m_syncRequest.alarm, mask, values);
-            UniqueCPtr<xcb_generic_error_t> error(xcb_request_check(c, cookie));
-            if (error) {
-                m_syncRequest.alarm = XCB_NONE;
-            } else {
-                xcb_sync_change_alarm_value_list_t value;
-                memset(&value, 0, sizeof(value));
-                value.value.hi = 0;
-                value.value.lo = 1;
-                value.delta.hi = 0;
-                value.delta.lo = 1;
-                xcb_sync_change_alarm_aux(c, m_syncRequest.alarm, XCB_SYNC_CA_DELTA | XCB_SYNC_CA_VALUE, &value);
-            }
+            m_syncRequest.alarm = createSyncAlarm(m_syncRequest.counter);
+        }
+    }
+
+    const xcb_sync_counter_t frameCounter = counterCount > 1 ? counters[1] : XCB_NONE;
+    if (frameCounter != m_frameSync.counter) {
+        if (m_frameSync.alarm != XCB_NONE) {
+            xcb_sync_destroy_alarm(kwinApp()->x11Connection(), m_frameSync.alarm);
+            m_frameSync.alarm = XCB_NONE;
+        }
+        m_frameSync.counter = frameCounter;
+        if (frameCounter != XCB_NONE) {
+            // the counter belongs to the client, unlike the basic one it's never set by KWin
+            m_frameSync.alarm = createSyncAlarm(frameCounter);
         }
     }
 }
@@ -2461,11 +2506,12 @@ void X11Window::updateAllowedActions(bool force)
     }
 }
 
-Xcb::StringProperty X11Window::fetchActivities() const
+Xcb::StringProperty X11Window::fetchActivities(xcb_window_t window)
 {
 #if KWIN_BUILD_ACTIVITIES
-    return Xcb::StringProperty(window(), atoms->activities);
+    return Xcb::StringProperty(window, atoms->activities);
 #else
+    Q_UNUSED(window)
     return Xcb::StringProperty();
 #endif
 }
@@ -2508,7 +2554,7 @@ void X11Window::readActivities(Xcb::StringProperty &property)
 void X11Window::checkActivities()
 {
 #if KWIN_BUILD_ACTIVITIES
-    Xcb::StringProperty property = fetchActivities();
+    Xcb::StringProperty property = fetchActivities(window());
     readActivities(property);
 #endif
 }
@@ -2519,9 +2565,9 @@ void X11Window::setSessionActivityOverride(bool needed)
     updateActivities(false);
 }
 
-Xcb::Property X11Window::fetchFirstInTabBox() const
+Xcb::Property X11Window::fetchFirstInTabBox(xcb_window_t window)
 {
-    return Xcb::Property(false, m_client, atoms->kde_first_in_window_list,
+    return Xcb::Property(false, window, atoms->kde_first_in_window_list,
                          atoms->kde_first_in_window_list, 0, 1);
 }
 
@@ -2533,13 +2579,13 @@ void X11Window::readFirstInTabBox(Xcb::Property &property)
 void X11Window::updateFirstInTabBox()
 {
     // TODO: move into KWindowInfo
-    Xcb::Property property = fetchFirstInTabBox();
+    Xcb::Property property = fetchFirstInTabBox(window());
     readFirstInTabBox(property);
 }
 
-Xcb::StringProperty X11Window::fetchPreferredColorScheme() const
+Xcb::StringProperty X11Window::fetchPreferredColorScheme(xcb_window_t window)
 {
-    return Xcb::StringProperty(m_client, atoms->kde_color_sheme);
+    return Xcb::StringProperty(window, atoms->kde_color_sheme);
 }
 
 QString X11Window::readPreferredColorScheme(Xcb::StringProperty &property) const
@@ -2549,7 +2595,7 @@ QString X11Window::readPreferredColorScheme(Xcb::StringProperty &property) const
 
 QString X11Window::preferredColorScheme() const
 {
-    Xcb::StringProperty property = fetchPreferredColorScheme();
+    Xcb::StringProperty property = fetchPreferredColorScheme(window());
     return readPreferredColorScheme(property);
 }
 
@@ -2689,9 +2735,9 @@ QMatrix4x4 X11Window::inputTransformation() const
     return matrix;
 }
 
-Xcb::Property X11Window::fetchShowOnScreenEdge() const
+Xcb::Property X11Window::fetchShowOnScreenEdge(xcb_window_t window)
 {
-    return Xcb::Property(false, window(), atoms->kde_screen_edge_show, XCB_ATOM_CARDINAL, 0, 1);
+    return Xcb::Property(false, window, atoms->kde_screen_edge_show, XCB_ATOM_CARDINAL, 0, 1);
 }
 
 void X11Window::readShowOnScreenEdge(Xcb::Property &property)
@@ -2762,7 +2808,7 @@ void X11Window::readShowOnScreenEdge(Xcb::Property &property)
 
 void X11Window::updateShowOnScreenEdge()
 {
-    Xcb::Property property = fetchShowOnScreenEdge();
+    Xcb::Property property = fetchShowOnScreenEdge(window());
     readShowOnScreenEdge(property);
 }
 
@@ -2789,9 +2835,9 @@ QSizeF X11Window::resizeIncrements() const
     return m_geometryHints.resizeIncrements();
 }
 
-Xcb::StringProperty X11Window::fetchApplicationMenuServiceName() const
+Xcb::StringProperty X11Window::fetchApplicationMenuServiceName(xcb_window_t window)
 {
-    return Xcb::StringProperty(m_client, atoms->kde_net_wm_appmenu_service_name);
+    return Xcb::StringProperty(window, atoms->kde_net_wm_appmenu_service_name);
 }
 
 void X11Window::readApplicationMenuServiceName(Xcb::StringProperty &property)
@@ -2801,13 +2847,13 @@ void X11Window::readApplicationMenuServiceName(Xcb::StringProperty &property)
 
 void X11Window::checkApplicationMenuServiceName()
 {
-    Xcb::StringProperty property = fetchApplicationMenuServiceName();
+    Xcb::StringProperty property = fetchApplicationMenuServiceName(window());
     readApplicationMenuServiceName(property);
 }
 
-Xcb::StringProperty X11Window::fetchApplicationMenuObjectPath() const
+Xcb::StringProperty X11Window::fetchApplicationMenuObjectPath(xcb_window_t window)
 {
-    return Xcb::StringProperty(m_client, atoms->kde_net_wm_appmenu_object_path);
+    return Xcb::StringProperty(window, atoms->kde_net_wm_appmenu_object_path);
 }
 
 void X11Window::readApplicationMenuObjectPath(Xcb::StringProperty &property)
@@ -2817,7 +2863,7 @@ void X11Window::readApplicationMenuObjectPath(Xcb::StringProperty &property)
 
 void X11Window::checkApplicationMenuObjectPath()
 {
-    Xcb::StringProperty property = fetchApplicationMenuObjectPath();
+    Xcb::StringProperty property = fetchApplicationMenuObjectPath(window());
     readApplicationMenuObjectPath(property);
 }
 
@@ -2840,6 +2886,83 @@ void X11Window::handleSync()
     }
 }
 
+void X11Window::handleFrameSync(const xcb_sync_int64_t &value)
+{
+    // the counter is odd while the client draws a frame, and even once the frame is complete
+    if (value.lo & 1) {
+        return;
+    }
+    m_frameSync.completedFrame = value;
+
+    if (!Compositor::compositing() || !isShown() || !isOnCurrentDesktop() || !windowItem()) {
+        // the frame isn't going to be painted, don't let the client wait for it
+        m_frameSync.completedFrame.reset();
+        sendFrameDrawn(value, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()));
+        return;
+    }
+    // the frame usually comes with damage, but the client can also finish a frame without
+    // changing anything
+    windowItem()->scheduleFrame();
+}
+
+void X11Window::framePainted(Output *output)
+{
+    if (!m_frameSync.completedFrame) {
+        return;
+    }
+    const xcb_sync_int64_t value = *m_frameSync.completedFrame;
+    m_frameSync.completedFrame.reset();
+
+    // the presentation timestamps of the render loop are in the same monotonic clock
+    const auto drawn = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    sendFrameDrawn(value, drawn);
+
+    // for a frame that's drawn before the previous one has been presented, the timings of the
+    // previous one are skipped
+    disconnect(m_frameSync.presentedConnection);
+    RenderLoop *renderLoop = output->renderLoop();
+    m_frameSync.presentedConnection = connect(renderLoop, &RenderLoop::framePresented, this, [this, value, drawn](RenderLoop *loop, std::chrono::nanoseconds timestamp) {
+        disconnect(m_frameSync.presentedConnection);
+
+        const auto presentationOffset = std::chrono::duration_cast<std::chrono::microseconds>(timestamp) - drawn;
+        // the refresh rate is in millihertz
+        const uint32_t refreshInterval = loop->refreshRate() > 0 ? 1000000000 / loop->refreshRate() : 0;
+
+        xcb_client_message_event_t ev;
+        static_assert(sizeof(ev) == 32, "Would leak stack data otherwise");
+        memset(&ev, 0, sizeof(ev));
+        ev.response_type = XCB_CLIENT_MESSAGE;
+        ev.window = window();
+        ev.type = atoms->net_wm_frame_timings;
+        ev.format = 32;
+        ev.data.data32[0] = value.lo;
+        ev.data.data32[1] = value.hi;
+        ev.data.data32[2] = int32_t(presentationOffset.count());
+        ev.data.data32[3] = refreshInterval;
+        // KWin starts painting with the next vblank, not a fixed delay after it
+        ev.data.data32[4] = 0;
+        xcb_send_event(kwinApp()->x11Connection(), false, window(), 0, reinterpret_cast<const char *>(&ev));
+        xcb_flush(kwinApp()->x11Connection());
+    });
+}
+
+void X11Window::sendFrameDrawn(const xcb_sync_int64_t &value, std::chrono::microseconds timestamp)
+{
+    xcb_client_message_event_t ev;
+    static_assert(sizeof(ev) == 32, "Would leak stack data otherwise");
+    memset(&ev, 0, sizeof(ev));
+    ev.response_type = XCB_CLIENT_MESSAGE;
+    ev.window = window();
+    ev.type = atoms->net_wm_frame_drawn;
+    ev.format = 32;
+    ev.data.data32[0] = value.lo;
+    ev.data.data32[1] = value.hi;
+    ev.data.data32[2] = uint64_t(timestamp.count()) & 0xffffffff;
+    ev.data.data32[3] = uint64_t(timestamp.count()) >> 32;
+    xcb_send_event(kwinApp()->x11Connection(), false, window(), 0, reinterpret_cast<const char *>(&ev));
+    xcb_flush(kwinApp()->x11Connection());
+}
+
 void X11Window::performInteractiveResize()
 {
     resize(moveResizeGeometry().size());
@@ -2985,9 +3108,9 @@ bool X11Window::sameAppWindowRoleMatch(const X11Window *c1, const X11Window *c2,
  - every window in the group : group()->members()
 */
 
-Xcb::TransientFor X11Window::fetchTransient() const
+Xcb::TransientFor X11Window::fetchTransient(xcb_window_t window)
 {
-    return Xcb::TransientFor(window());
+    return Xcb::TransientFor(window);
 }
 
 void X11Window::readTransientProperty(Xcb::TransientFor &transientFor)
@@ -3005,7 +3128,7 @@ void X11Window::readTransientProperty(Xcb::TransientFor &transientFor)
 
 void X11Window::readTransient()
 {
-    Xcb::TransientFor transientFor = fetchTransient();
+    Xcb::TransientFor transientFor = fetchTransient(window());
     readTransientProperty(transientFor);
 }
 
@@ -3940,7 +4063,7 @@ void X11Window::configureRequest(int value_mask, qreal rx, qreal ry, qreal rw, q
         // see Workspace::updateClientArea() and
         // X11Window::adjustedClientArea()
         if (hasStrut()) {
-            workspace()->updateClientArea();
+            workspace()->updateClientArea(this);
         }
     }
 
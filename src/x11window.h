@@ -66,6 +66,29 @@ private:
     xcb_gcontext_t m_gc;
 };
 
+/**
+ * The requests whose replies manage() needs. Creating the prefetches of all windows that are
+ * about to be managed before managing any of them sends all requests in one go, instead of
+ * waiting for the replies of one window after the other.
+ */
+struct KWIN_EXPORT X11WindowPrefetch
+{
+    explicit X11WindowPrefetch(xcb_window_t window);
+
+    const xcb_window_t window;
+    Xcb::WindowAttributes attributes;
+    Xcb::WindowGeometry geometry;
+    Xcb::Property wmClientLeader;
+    Xcb::Property skipCloseAnimation;
+    Xcb::Property showOnScreenEdge;
+    Xcb::StringProperty colorScheme;
+    Xcb::Property firstInTabBox;
+    Xcb::TransientFor transient;
+    Xcb::StringProperty activities;
+    Xcb::StringProperty applicationMenuServiceName;
+    Xcb::StringProperty applicationMenuObjectPath;
+};
+
 class KWIN_EXPORT X11Window : public Window
 {
     Q_OBJECT
@@ -144,6 +167,7 @@ public:
     NET::WindowType windowType(bool direct = false, int supported_types = 0) const override;
 
     bool manage(xcb_window_t w, bool isMapped);
+    bool manage(X11WindowPrefetch &prefetch, bool isMapped);
     void releaseWindow(bool on_shutdown = false);
     void destroyWindow() override;
 
@@ -263,10 +287,10 @@ public:
 
     bool isClientSideDecorated() const;
 
-    Xcb::Property fetchFirstInTabBox() const;
+    static Xcb::Property fetchFirstInTabBox(xcb_window_t window);
     void readFirstInTabBox(Xcb::Property &property);
     void updateFirstInTabBox();
-    Xcb::StringProperty fetchPreferredColorScheme() const;
+    static Xcb::StringProperty fetchPreferredColorScheme(xcb_window_t window);
     QString readPreferredColorScheme(Xcb::StringProperty &property) const;
     QString preferredColorScheme() const override;
 
@@ -282,11 +306,11 @@ public:
      */
     void showOnScreenEdge() override;
 
-    Xcb::StringProperty fetchApplicationMenuServiceName() const;
+    static Xcb::StringProperty fetchApplicationMenuServiceName(xcb_window_t window);
     void readApplicationMenuServiceName(Xcb::StringProperty &property);
     void checkApplicationMenuServiceName();
 
-    Xcb::StringProperty fetchApplicationMenuObjectPath() const;
+    static Xcb::StringProperty fetchApplicationMenuObjectPath(xcb_window_t window);
     void readApplicationMenuObjectPath(Xcb::StringProperty &property);
     void checkApplicationMenuObjectPath();
 
@@ -308,6 +332,38 @@ public:
     void handleSync();
     void handleSyncTimeout();
 
+    /**
+     * The extended frame synchronization of _NET_WM_FRAME_DRAWN and _NET_WM_FRAME_TIMINGS. The
+     * client marks the start and the end of its frames with the second counter of
+     * _NET_WM_SYNC_REQUEST_COUNTER, KWin tells it when a frame has been drawn and when it's been
+     * presented, so the client can pace itself to the display.
+     */
+    struct FrameSync
+    {
+        xcb_sync_counter_t counter = XCB_NONE;
+        xcb_sync_alarm_t alarm = XCB_NONE;
+        // the last frame the client finished, which hasn't been drawn yet
+        std::optional<xcb_sync_int64_t> completedFrame;
+        QMetaObject::Connection presentedConnection;
+    };
+    const FrameSync &frameSync() const
+    {
+        return m_frameSync;
+    }
+    void handleFrameSync(const xcb_sync_int64_t &value);
+
+    /**
+     * How many PropertyNotify events the window has caused, for the debug console.
+     */
+    quint64 propertyNotifyCount() const
+    {
+        return m_propertyNotifyCount;
+    }
+    /**
+     * Called when the window has been painted on @a output.
+     */
+    void framePainted(Output *output);
+
     bool allowWindowActivation(xcb_timestamp_t time = -1U, bool focus_in = false,
                                bool ignore_desktop = false);
 
@@ -408,11 +464,13 @@ private:
     int checkShadeGeometry(int w, int h);
     void getSyncCounter();
     void sendSyncRequest();
+    void sendFrameDrawn(const xcb_sync_int64_t &value, std::chrono::microseconds timestamp);
     void leaveInteractiveMoveResize() override;
     void performInteractiveResize();
     void establishCommandWindowGrab(uint8_t button);
     void establishCommandAllGrab(uint8_t button);
     void resizeDecoration();
+    void destroyInputWindow();
 
     void pingWindow();
     void killProcess(bool ask, xcb_timestamp_t timestamp = XCB_TIME_CURRENT_TIME);
@@ -444,7 +502,7 @@ private:
 
     void updateInputWindow();
 
-    Xcb::Property fetchShowOnScreenEdge() const;
+    static Xcb::Property fetchShowOnScreenEdge(xcb_window_t window);
     void readShowOnScreenEdge(Xcb::Property &property);
     /**
      * Reads the property and creates/destroys the screen edge if required
@@ -477,7 +535,7 @@ private:
     };
     MappingState mapping_state;
 
-    Xcb::TransientFor fetchTransient() const;
+    static Xcb::TransientFor fetchTransient(xcb_window_t window);
     void readTransientProperty(Xcb::TransientFor &transientFor);
     void readTransient();
     xcb_window_t verifyTransientFor(xcb_window_t transient_for, bool set);
@@ -513,13 +571,16 @@ private:
     NET::Actions allowed_actions;
     bool shade_geometry_change;
     SyncRequest m_syncRequest;
+    FrameSync m_frameSync;
+    quint64 m_propertyNotifyCount = 0;
     static bool check_active_modal; ///< \see X11Window::checkActiveModal()
     int sm_stacking_order;
     friend struct ResetupRulesProcedure;
+    friend struct X11WindowPrefetch;
 
     friend bool performTransiencyCheck();
 
-    Xcb::StringProperty fetchActivities() const;
+    static Xcb::StringProperty fetchActivities(xcb_window_t window);
     void readActivities(Xcb::StringProperty &property);
     bool activitiesDefined; // whether the x property was actually set
 
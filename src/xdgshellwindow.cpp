@@ -10,17 +10,20 @@
 */
 #include "xdgshellwindow.h"
 #include "core/output.h"
+#include "core/renderloop.h"
 #if KWIN_BUILD_ACTIVITIES
 #include "activities.h"
 #endif
 #include "decorations/decorationbridge.h"
 #include "deleted.h"
+#include "ftrace.h"
 #include "placement.h"
 #include "screenedge.h"
 #include "touch_input.h"
 #include "utils/subsurfacemonitor.h"
 #include "virtualdesktops.h"
 #include "wayland/appmenu_interface.h"
+#include "wayland/clientconnection.h"
 #include "wayland/output_interface.h"
 #include "wayland/plasmashell_interface.h"
 #include "wayland/seat_interface.h"
@@ -39,6 +42,10 @@ using namespace KWaylandServer;
 namespace KWin
 {
 
+// How long a configure event may stay unacknowledged during an interactive resize before
+// the next one is sent anyway.
+static const std::chrono::milliseconds s_configureThrottleTimeout(100);
+
 XdgSurfaceWindow::XdgSurfaceWindow(XdgSurfaceInterface *shellSurface)
     : WaylandWindow(shellSurface->surface())
     , m_shellSurface(shellSurface)
@@ -89,10 +96,19 @@ XdgSurfaceWindow::XdgSurfaceWindow(XdgSurfaceInterface *shellSurface)
 
     m_configureTimer->setSingleShot(true);
     connect(m_configureTimer, &QTimer::timeout, this, &XdgSurfaceWindow::sendConfigure);
+
+    m_map.created = std::chrono::steady_clock::now();
+    if (FTraceLogger::self()->isEnabled()) {
+        m_map.traceContext = FTraceLogger::nextContext();
+        fTraceBegin(m_map.traceContext, "Map window (", surface()->client()->processId(), ":", surface()->id(), ")");
+    }
 }
 
 XdgSurfaceWindow::~XdgSurfaceWindow()
 {
+    if (m_map.traceContext && !m_map.firstFrame) {
+        fTraceEnd(m_map.traceContext, "Window destroyed before mapping");
+    }
     qDeleteAll(m_configureEvents);
 }
 
@@ -122,9 +138,37 @@ XdgSurfaceConfigure *XdgSurfaceWindow::lastAcknowledgedConfigure() const
 
 void XdgSurfaceWindow::scheduleConfigure()
 {
-    if (!isZombie()) {
-        m_configureTimer->start();
+    if (isZombie()) {
+        return;
     }
+
+    // During an interactive resize, the geometry changes with every pointer motion. A slow
+    // client can't keep up with that, the configure events pile up and the resize lags far
+    // behind the pointer. So only one configure event is kept in flight, the next one is sent
+    // when the client has committed a buffer for it and carries the latest geometry.
+    if (isInteractiveResize() && !m_configureEvents.isEmpty()) {
+        const auto age = std::chrono::steady_clock::now() - m_configureEvents.constLast()->timestamp;
+        if (age < s_configureThrottleTimeout) {
+            if (!m_configureTimer->isActive()) {
+                m_configureTimer->start(std::chrono::ceil<std::chrono::milliseconds>(s_configureThrottleTimeout - age));
+            }
+            return;
+        }
+    }
+
+    m_configureTimer->start(0);
+}
+
+void XdgSurfaceWindow::cancelScheduledConfigure()
+{
+    if (!m_configureFlags) {
+        m_configureTimer->stop();
+    }
+}
+
+XdgSurfaceConfigure *XdgSurfaceWindow::lastSentConfigure() const
+{
+    return m_configureEvents.isEmpty() ? nullptr : m_configureEvents.constLast();
 }
 
 void XdgSurfaceWindow::sendConfigure()
@@ -139,9 +183,11 @@ void XdgSurfaceWindow::sendConfigure()
 
     configureEvent->gravity = m_nextGravity;
     configureEvent->flags |= m_configureFlags;
+    configureEvent->timestamp = std::chrono::steady_clock::now();
     m_configureFlags = {};
 
     m_configureEvents.append(configureEvent);
+    markMapStage(m_map.initialConfigure, "configured");
 }
 
 void XdgSurfaceWindow::handleConfigureAcknowledged(quint32 serial)
@@ -155,6 +201,11 @@ void XdgSurfaceWindow::handleCommit()
         return;
     }
 
+    const bool mapping = !readyForPainting();
+    if (mapping) {
+        markMapStage(m_map.firstCommit, "committed");
+    }
+
     if (m_lastAcknowledgedConfigureSerial.has_value()) {
         const quint32 serial = m_lastAcknowledgedConfigureSerial.value();
         while (!m_configureEvents.isEmpty()) {
@@ -163,6 +214,13 @@ void XdgSurfaceWindow::handleCommit()
             }
             m_lastAcknowledgedConfigure.reset(m_configureEvents.takeFirst());
         }
+        if (m_lastAcknowledgedConfigure) {
+            updateConfigureLatency(m_lastAcknowledgedConfigure.get());
+        }
+        // A throttled configure event can go out now that the client has caught up.
+        if (m_configureEvents.isEmpty() && m_configureTimer->isActive() && m_configureTimer->interval() > 0) {
+            m_configureTimer->start(0);
+        }
     }
 
     handleRolePrecommit();
@@ -177,6 +235,90 @@ void XdgSurfaceWindow::handleCommit()
 
     setReadyForPainting();
     updateDepth();
+
+    // Showing the window adds it to the workspace right away.
+    if (mapping) {
+        markMapStage(m_map.added, "added");
+    }
+}
+
+void XdgSurfaceWindow::updateConfigureLatency(const XdgSurfaceConfigure *configureEvent)
+{
+    m_configureLatency = std::chrono::steady_clock::now() - configureEvent->timestamp;
+    m_maximumConfigureLatency = std::max(m_maximumConfigureLatency, m_configureLatency);
+    m_totalConfigureLatency += m_configureLatency;
+    m_acknowledgedConfigureCount++;
+}
+
+static qreal toMilliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<qreal, std::milli>(duration).count();
+}
+
+qreal XdgSurfaceWindow::configureLatency() const
+{
+    return toMilliseconds(m_configureLatency);
+}
+
+qreal XdgSurfaceWindow::averageConfigureLatency() const
+{
+    if (!m_acknowledgedConfigureCount) {
+        return 0;
+    }
+    return toMilliseconds(m_totalConfigureLatency / m_acknowledgedConfigureCount);
+}
+
+qreal XdgSurfaceWindow::maximumConfigureLatency() const
+{
+    return toMilliseconds(m_maximumConfigureLatency);
+}
+
+void XdgSurfaceWindow::markMapStage(std::optional<std::chrono::nanoseconds> &stage, const char *name)
+{
+    if (stage) {
+        return;
+    }
+    stage = std::chrono::steady_clock::now() - m_map.created;
+    if (m_map.traceContext) {
+        fTrace("Window map stage=", name, " ctx=", m_map.traceContext);
+    }
+}
+
+void XdgSurfaceWindow::framePainted(Output *output)
+{
+    if (m_map.firstFrame || m_map.presentedConnection) {
+        return;
+    }
+    m_map.presentedConnection = connect(output->renderLoop(), &RenderLoop::framePresented, this, [this](RenderLoop *loop, std::chrono::nanoseconds timestamp) {
+        Q_UNUSED(loop)
+        disconnect(m_map.presentedConnection);
+
+        // the presentation timestamps of the render loop are in the same monotonic clock
+        m_map.firstFrame = timestamp - std::chrono::duration_cast<std::chrono::nanoseconds>(m_map.created.time_since_epoch());
+        if (m_map.traceContext) {
+            fTraceEnd(m_map.traceContext, "Window mapped latency=", std::chrono::duration_cast<std::chrono::microseconds>(*m_map.firstFrame).count());
+        }
+    });
+}
+
+qreal XdgSurfaceWindow::initialConfigureLatency() const
+{
+    return toMilliseconds(m_map.initialConfigure.value_or(std::chrono::nanoseconds::zero()));
+}
+
+qreal XdgSurfaceWindow::firstCommitLatency() const
+{
+    return toMilliseconds(m_map.firstCommit.value_or(std::chrono::nanoseconds::zero()));
+}
+
+qreal XdgSurfaceWindow::mapLatency() const
+{
+    return toMilliseconds(m_map.added.value_or(std::chrono::nanoseconds::zero()));
+}
+
+qreal XdgSurfaceWindow::firstFrameLatency() const
+{
+    return toMilliseconds(m_map.firstFrame.value_or(std::chrono::nanoseconds::zero()));
 }
 
 void XdgSurfaceWindow::handleRolePrecommit()
@@ -345,9 +487,7 @@ void XdgSurfaceWindow::destroyWindow()
 
 void XdgSurfaceWindow::updateClientArea()
 {
-    if (hasStrut()) {
-        workspace()->updateClientArea();
-    }
+    workspace()->updateClientArea(this);
 }
 
 void XdgSurfaceWindow::updateShowOnScreenEdge()
@@ -1362,9 +1502,22 @@ bool XdgToplevelWindow::initialFullScreenMode() const
 
 void XdgToplevelWindow::initialize()
 {
+    const auto setupTimestamp = std::chrono::steady_clock::now();
     bool needsPlacement = isPlaceable();
     setupWindowRules(false);
 
+    // If the initial configure event doesn't depend on the window rules and the placement, it's
+    // sent right away, the client can prepare its first frame while the window is being set up.
+    m_earlyInitialConfigure = canConfigureEarly();
+    if (m_earlyInitialConfigure) {
+        maximize(initialMaximizeMode());
+        setFullScreen(initialFullScreenMode(), false);
+        configureDecoration();
+        sendConfigure();
+        cancelScheduledConfigure();
+        surface()->client()->flush();
+    }
+
     // Move or resize the window only if enforced by a window rule.
     const QPointF forcedPosition = rules()->checkPosition(invalidPoint, true);
     if (forcedPosition != invalidPoint) {
@@ -1413,14 +1566,57 @@ void XdgToplevelWindow::initialize()
         workspace()->placement()->place(this, area);
     }
 
-    configureDecoration();
-    scheduleConfigure();
+    if (!m_earlyInitialConfigure) {
+        configureDecoration();
+        scheduleConfigure();
+    } else if (!isInitialConfigureCurrent()) {
+        scheduleConfigure();
+    }
     updateColorScheme();
     setupWindowManagementInterface();
 
+    m_setupDuration = std::chrono::steady_clock::now() - setupTimestamp;
     m_isInitialized = true;
 }
 
+bool XdgToplevelWindow::canConfigureEarly() const
+{
+    static const bool disabled = qEnvironmentVariableIsSet("KWIN_XDG_NO_EARLY_CONFIGURE");
+    if (disabled) {
+        return false;
+    }
+    // A window rule can change the size, the states and the decoration of the window.
+    if (!rules()->isEmpty()) {
+        return false;
+    }
+    // The configure bounds depend on the output that the window is placed on.
+    if (workspace()->outputs().count() != 1) {
+        return false;
+    }
+    return !isPlaceable() || options->placement() != PlacementMaximizing;
+}
+
+bool XdgToplevelWindow::isInitialConfigureCurrent() const
+{
+    const auto configureEvent = static_cast<XdgToplevelConfigure *>(lastSentConfigure());
+    if (!configureEvent) {
+        return false;
+    }
+    return configureEvent->states == m_nextStates
+        && configureEvent->decoration == m_nextDecoration
+        && configureEvent->bounds.size() == moveResizeGeometry().size();
+}
+
+qreal XdgToplevelWindow::setupDuration() const
+{
+    return toMilliseconds(m_setupDuration);
+}
+
+bool XdgToplevelWindow::earlyInitialConfigure() const
+{
+    return m_earlyInitialConfigure;
+}
+
 void XdgToplevelWindow::updateMaximizeMode(MaximizeMode maximizeMode)
 {
     if (m_maximizeMode == maximizeMode) {
@@ -17,6 +17,7 @@
 #include <QQueue>
 #include <QTimer>
 
+#include <chrono>
 #include <optional>
 
 namespace KWaylandServer
@@ -48,11 +49,28 @@ public:
     Gravity gravity;
     qreal serial;
     ConfigureFlags flags;
+    std::chrono::steady_clock::time_point timestamp;
 };
 
 class XdgSurfaceWindow : public WaylandWindow
 {
     Q_OBJECT
+    /**
+     * The time in milliseconds between the last configure event that the client has
+     * acknowledged and the commit that applied it.
+     */
+    Q_PROPERTY(qreal configureLatency READ configureLatency)
+    Q_PROPERTY(qreal averageConfigureLatency READ averageConfigureLatency)
+    Q_PROPERTY(qreal maximumConfigureLatency READ maximumConfigureLatency)
+    /**
+     * The time in milliseconds from the creation of the window until the initial configure
+     * event has been sent, its first buffer has been committed, it has been added to the
+     * workspace and its first frame has been presented, or zero if that hasn't happened yet.
+     */
+    Q_PROPERTY(qreal initialConfigureLatency READ initialConfigureLatency)
+    Q_PROPERTY(qreal firstCommitLatency READ firstCommitLatency)
+    Q_PROPERTY(qreal mapLatency READ mapLatency)
+    Q_PROPERTY(qreal firstFrameLatency READ firstFrameLatency)
 
 public:
     explicit XdgSurfaceWindow(KWaylandServer::XdgSurfaceInterface *shellSurface);
@@ -66,6 +84,20 @@ public:
 
     void installPlasmaShellSurface(KWaylandServer::PlasmaShellSurfaceInterface *shellSurface);
 
+    qreal configureLatency() const;
+    qreal averageConfigureLatency() const;
+    qreal maximumConfigureLatency() const;
+    qreal initialConfigureLatency() const;
+    qreal firstCommitLatency() const;
+    qreal mapLatency() const;
+    qreal firstFrameLatency() const;
+
+    /**
+     * Called by the scene when a frame that contains the window has been painted on the
+     * given @a output.
+     */
+    void framePainted(Output *output);
+
 protected:
     void moveResizeInternal(const QRectF &rect, MoveResizeMode mode) override;
 
@@ -76,6 +108,14 @@ protected:
     XdgSurfaceConfigure *lastAcknowledgedConfigure() const;
     void scheduleConfigure();
     void sendConfigure();
+    /**
+     * Cancels the scheduled configure event, unless it has to carry a window position update.
+     */
+    void cancelScheduledConfigure();
+    /**
+     * Returns the last configure event that has been sent and not acknowledged yet, or null.
+     */
+    XdgSurfaceConfigure *lastSentConfigure() const;
 
     QPointer<KWaylandServer::PlasmaShellSurfaceInterface> m_plasmaShellSurface;
 
@@ -93,6 +133,8 @@ private:
     void setHaveNextWindowGeometry();
     void resetHaveNextWindowGeometry();
     void maybeUpdateMoveResizeGeometry(const QRectF &rect);
+    void updateConfigureLatency(const XdgSurfaceConfigure *configureEvent);
+    void markMapStage(std::optional<std::chrono::nanoseconds> &stage, const char *name);
 
     KWaylandServer::XdgSurfaceInterface *m_shellSurface;
     QTimer *m_configureTimer;
@@ -102,6 +144,22 @@ private:
     std::optional<quint32> m_lastAcknowledgedConfigureSerial;
     QRectF m_windowGeometry;
     bool m_haveNextWindowGeometry = false;
+    std::chrono::nanoseconds m_configureLatency = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_maximumConfigureLatency = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_totalConfigureLatency = std::chrono::nanoseconds::zero();
+    int m_acknowledgedConfigureCount = 0;
+
+    // The stages of mapping the window, relative to the creation of the window.
+    struct
+    {
+        std::chrono::steady_clock::time_point created;
+        std::optional<std::chrono::nanoseconds> initialConfigure;
+        std::optional<std::chrono::nanoseconds> firstCommit;
+        std::optional<std::chrono::nanoseconds> added;
+        std::optional<std::chrono::nanoseconds> firstFrame;
+        quint32 traceContext = 0;
+        QMetaObject::Connection presentedConnection;
+    } m_map;
 };
 
 class XdgToplevelConfigure final : public XdgSurfaceConfigure
@@ -114,6 +172,15 @@ public:
 class XdgToplevelWindow final : public XdgSurfaceWindow
 {
     Q_OBJECT
+    /**
+     * The time in milliseconds it took to apply the window rules and to place the window.
+     */
+    Q_PROPERTY(qreal setupDuration READ setupDuration)
+    /**
+     * Whether the initial configure event has been sent before the window rules have been
+     * applied and the window has been placed.
+     */
+    Q_PROPERTY(bool earlyInitialConfigure READ earlyInitialConfigure)
 
     enum class PingReason {
         CloseWindow,
@@ -168,6 +235,9 @@ public:
     void installPalette(KWaylandServer::ServerSideDecorationPaletteInterface *palette);
     void installXdgDecoration(KWaylandServer::XdgToplevelDecorationV1Interface *decoration);
 
+    qreal setupDuration() const;
+    bool earlyInitialConfigure() const;
+
 protected:
     XdgSurfaceConfigure *sendRoleConfigure() const override;
     void handleRoleCommit() override;
@@ -205,6 +275,8 @@ private:
     void handleMaximumSizeChanged();
     void handleMinimumSizeChanged();
     void initialize();
+    bool canConfigureEarly() const;
+    bool isInitialConfigureCurrent() const;
     void updateMaximizeMode(MaximizeMode maximizeMode);
     void updateFullScreenMode(bool set);
     void sendPing(PingReason reason);
@@ -232,6 +304,8 @@ private:
     bool m_isInitialized = false;
     bool m_userNoBorder = false;
     bool m_isTransient = false;
+    bool m_earlyInitialConfigure = false;
+    std::chrono::nanoseconds m_setupDuration = std::chrono::nanoseconds::zero();
     QPointer<Output> m_fullScreenRequestedOutput;
     std::shared_ptr<KDecoration2::Decoration> m_nextDecoration;
 };
@@ -14,7 +14,13 @@
 // frameworks
 #include <KConfigGroup>
 // Qt
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QKeyEvent>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QTemporaryFile>
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 #include <QtXkbCommonSupport/private/qxkbcommon_p.h>
@@ -211,7 +217,7 @@ xkb_keymap *Xkb::loadKeymapFromConfig()
 
     m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
 
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    return compileKeymap(ruleNames);
 }
 
 xkb_keymap *Xkb::loadDefaultKeymap()
@@ -219,7 +225,78 @@ xkb_keymap *Xkb::loadDefaultKeymap()
     xkb_rule_names ruleNames = {};
     applyEnvironmentRules(ruleNames);
     m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    return compileKeymap(ruleNames);
+}
+
+static QString keymapCacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/kwin/xkb");
+}
+
+QByteArray Xkb::keymapCacheKey(const xkb_rule_names &ruleNames) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const char *name : {ruleNames.rules, ruleNames.model, ruleNames.layout, ruleNames.variant, ruleNames.options}) {
+        // tell unset names apart from empty ones, libxkbcommon only replaces the former by its defaults
+        if (name) {
+            hash.addData(QByteArray(name));
+            hash.addData("\n", 1);
+        } else {
+            hash.addData("\0\n", 2);
+        }
+    }
+    // updates of the xkb data replace files in these directories, which invalidates the cache
+    for (unsigned int i = 0; i < xkb_context_num_include_paths(m_context); ++i) {
+        const QString includePath = QString::fromLocal8Bit(xkb_context_include_path_get(m_context, i));
+        hash.addData(includePath.toLocal8Bit());
+        for (const QLatin1String &component : {QLatin1String("rules"), QLatin1String("keycodes"), QLatin1String("types"), QLatin1String("compat"), QLatin1String("symbols")}) {
+            const QFileInfo info(includePath + QLatin1Char('/') + component);
+            const qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+            hash.addData(QByteArray::number(modified));
+            hash.addData("\n", 1);
+        }
+    }
+    return hash.result().toHex();
+}
+
+/**
+ * Compiling a keymap from rule names means resolving and parsing dozens of files of the xkb data,
+ * parsing the compiled result is a lot cheaper. So the compiled keymaps are kept on disk.
+ */
+xkb_keymap *Xkb::compileKeymap(const xkb_rule_names &ruleNames)
+{
+    static const bool cacheDisabled = qEnvironmentVariableIntValue("KWIN_XKB_NO_KEYMAP_CACHE");
+    if (cacheDisabled) {
+        return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    }
+
+    const QString filePath = keymapCacheDirectory() + QLatin1Char('/') + QString::fromLatin1(keymapCacheKey(ruleNames));
+    QFile cachedFile(filePath);
+    if (cachedFile.open(QIODevice::ReadOnly)) {
+        const QByteArray contents = cachedFile.readAll();
+        cachedFile.close();
+        if (xkb_keymap *keymap = xkb_keymap_new_from_buffer(m_context, contents.constData(), contents.size(), XKB_KEYMAP_FORMAT_TEXT_V1, XKB_KEYMAP_COMPILE_NO_FLAGS)) {
+            return keymap;
+        }
+        qCDebug(KWIN_XKB) << "Discarding invalid cached keymap" << filePath;
+        QFile::remove(filePath);
+    }
+
+    xkb_keymap *keymap = xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap) {
+        return nullptr;
+    }
+    UniqueCPtr<char> keymapString(xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
+    if (keymapString && QDir().mkpath(keymapCacheDirectory())) {
+        QSaveFile file(filePath);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(keymapString.get());
+            if (!file.commit()) {
+                qCDebug(KWIN_XKB) << "Failed to store the compiled keymap in" << filePath;
+            }
+        }
+    }
+    return keymap;
 }
 
 void Xkb::installKeymap(int fd, uint32_t size)
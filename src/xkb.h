@@ -117,6 +117,8 @@ private:
     void applyEnvironmentRules(xkb_rule_names &);
     xkb_keymap *loadKeymapFromConfig();
     xkb_keymap *loadDefaultKeymap();
+    xkb_keymap *compileKeymap(const xkb_rule_names &ruleNames);
+    QByteArray keymapCacheKey(const xkb_rule_names &ruleNames) const;
     void updateKeymap(xkb_keymap *keymap);
     void createKeymapFile();
     void updateModifiers();
@@ -23,6 +23,8 @@
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -32,8 +34,27 @@ namespace KWin
 namespace Xwl
 {
 
-// in Bytes: equals 64KB
-static const uint32_t s_incrChunkSize = 63 * 1024;
+// in Bytes: the chunk size if the X server can't tell its maximum request length
+static const uint32_t s_minIncrChunkSize = 63 * 1024;
+// in Bytes: bigger chunks wouldn't save much more round trips, but keep large buffers around
+static const uint32_t s_maxIncrChunkSize = 1024 * 1024;
+// in Bytes: the size the transfer pipes are enlarged to, the default of 64KB needs many rounds
+// through the event loop for an image
+static const int s_pipeSize = 1024 * 1024;
+// the number of full chunks that are kept while the X client hasn't picked up the previous one,
+// the rest of the data stays in the pipe and the source is throttled by the pipe being full
+static const int s_maxQueuedChunks = 2;
+
+static uint32_t incrChunkSize()
+{
+    // the maximum request length is in units of 4 bytes, leave room for the ChangeProperty
+    // request header
+    const uint64_t maximumRequestLength = uint64_t(xcb_get_maximum_request_length(kwinApp()->x11Connection())) * 4;
+    if (maximumRequestLength <= s_minIncrChunkSize + 1024) {
+        return s_minIncrChunkSize;
+    }
+    return std::min<uint64_t>(maximumRequestLength - 1024, s_maxIncrChunkSize);
+}
 
 Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, QObject *parent)
     : QObject(parent)
@@ -41,6 +62,13 @@ Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, Q
     , m_fd(fd)
     , m_timestamp(timestamp)
 {
+    // the fds are driven by socket notifiers, a stalled peer must not block KWin
+    const int flags = fcntl(m_fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    // this fails if the fd isn't a pipe, or the size is above the limit of the user
+    fcntl(m_fd, F_SETPIPE_SZ, s_pipeSize);
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -83,6 +111,7 @@ TransferWltoX::TransferWltoX(xcb_atom_t selection, xcb_selection_request_event_t
                              qint32 fd, QObject *parent)
     : Transfer(selection, fd, 0, parent)
     , m_request(request)
+    , m_chunkSize(incrChunkSize())
 {
 }
 
@@ -135,7 +164,7 @@ void TransferWltoX::startIncr()
                                  XCB_CW_EVENT_MASK, mask);
 
     // spec says to make the available space larger
-    const uint32_t chunkSpace = 1024 + s_incrChunkSize;
+    const uint32_t chunkSpace = 1024 + m_chunkSize;
     xcb_change_property(xcbConn,
                         XCB_PROP_MODE_REPLACE,
                         m_request->requestor,
@@ -154,27 +183,39 @@ void TransferWltoX::startIncr()
 
 void TransferWltoX::readWlSource()
 {
-    if (m_chunks.size() == 0 || m_chunks.last().second == s_incrChunkSize) {
+    if (m_chunks.size() == 0 || m_chunks.last().second == m_chunkSize) {
         // append new chunk
         auto next = QPair<QByteArray, int>();
-        next.first.resize(s_incrChunkSize);
+        next.first.resize(m_chunkSize);
         next.second = 0;
         m_chunks.append(next);
     }
 
-    const auto oldLen = m_chunks.last().second;
-    const auto avail = s_incrChunkSize - m_chunks.last().second;
-    Q_ASSERT(avail > 0);
+    // read as much as is available right now, instead of one pipe buffer per notifier activation
+    ssize_t readLen = 0;
+    while (m_chunks.last().second < m_chunkSize) {
+        const auto oldLen = m_chunks.last().second;
+        const auto avail = m_chunkSize - oldLen;
 
-    ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
-    if (readLen == -1) {
-        qCWarning(KWIN_XWL) << "Error reading in Wl data.";
+        readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
+        if (readLen == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            qCWarning(KWIN_XWL) << "Error reading in Wl data.";
 
-        // TODO: cleanup X side?
-        endTransfer();
-        return;
+            // TODO: cleanup X side?
+            endTransfer();
+            return;
+        }
+        if (readLen == 0) {
+            break;
+        }
+        m_chunks.last().second = oldLen + readLen;
     }
-    m_chunks.last().second = oldLen + readLen;
 
     if (readLen == 0) {
         // at the fd end - complete transfer now
@@ -195,7 +236,7 @@ void TransferWltoX::readWlSource()
             Q_EMIT selectionNotify(m_request, true);
             endTransfer();
         }
-    } else if (m_chunks.last().second == s_incrChunkSize) {
+    } else if (m_chunks.last().second == m_chunkSize) {
         // first chunk full, but not yet at fd end -> go incremental
         if (incr()) {
             m_flushPropertyOnDelete = true;
@@ -207,6 +248,10 @@ void TransferWltoX::readWlSource()
             // starting incremental transfer
             startIncr();
         }
+        // stop reading until the X client catches up, otherwise a big paste ends up in memory
+        if (m_chunks.size() >= s_maxQueuedChunks) {
+            socketNotifier()->setEnabled(false);
+        }
     }
     resetTimeout();
 }
@@ -251,6 +296,9 @@ void TransferWltoX::handlePropertyDelete()
             endTransfer();
         } else if (!m_chunks.isEmpty()) {
             flushSourceData();
+            if (socketNotifier() && !socketNotifier()->isEnabled()) {
+                socketNotifier()->setEnabled(true);
+            }
         }
     }
 }
@@ -446,11 +494,18 @@ void TransferXtoWl::dataSourceWrite()
 {
     QByteArray property = m_receiver->data();
 
-    ssize_t len = write(fd(), property.constData(), property.size());
+    ssize_t len;
+    do {
+        len = write(fd(), property.constData(), property.size());
+    } while (len == -1 && errno == EINTR);
     if (len == -1) {
-        qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
-        endTransfer();
-        return;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
+            endTransfer();
+            return;
+        }
+        // the pipe is full, continue once the client has read from it
+        len = 0;
     }
 
     m_receiver->partRead(len);
@@ -138,6 +138,8 @@ private:
      * TODO: explain second QPair component
      */
     QVector<QPair<QByteArray, int>> m_chunks;
+    // the size of the chunks, and the property size at which the transfer goes incremental
+    const int m_chunkSize;
 
     bool m_propertyIsSet = false;
     bool m_flushPropertyOnDelete = false;
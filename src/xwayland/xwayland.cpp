@@ -87,9 +87,17 @@ Xwayland::~Xwayland()
     m_launcher->stop();
 }
 
-void Xwayland::start()
+void Xwayland::start(StartMode mode)
 {
-    m_launcher->start();
+    switch (mode) {
+    case StartMode::Immediately:
+        m_launcher->start();
+        break;
+    case StartMode::OnDemand:
+        m_launcher->startOnDemand();
+        exportDisplay();
+        break;
+    }
 }
 
 XwaylandLauncher *Xwayland::xwaylandLauncher() const
@@ -191,12 +199,7 @@ void Xwayland::handleXwaylandReady()
 
     m_dataBridge = std::make_unique<DataBridge>();
 
-    auto env = m_app->processStartupEnvironment();
-    env.insert(QStringLiteral("DISPLAY"), m_launcher->displayName());
-    env.insert(QStringLiteral("XAUTHORITY"), m_launcher->xauthority());
-    qputenv("DISPLAY", m_launcher->displayName().toLatin1());
-    qputenv("XAUTHORITY", m_launcher->xauthority().toLatin1());
-    m_app->setProcessStartupEnvironment(env);
+    exportDisplay();
 
     connect(workspace(), &Workspace::primaryOutputChanged, this, &Xwayland::updatePrimary);
     updatePrimary();
@@ -207,6 +210,16 @@ void Xwayland::handleXwaylandReady()
     m_xrandrEventsFilter = new XrandrEventFilter(this);
 }
 
+void Xwayland::exportDisplay()
+{
+    auto env = m_app->processStartupEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), m_launcher->displayName());
+    env.insert(QStringLiteral("XAUTHORITY"), m_launcher->xauthority());
+    qputenv("DISPLAY", m_launcher->displayName().toLatin1());
+    qputenv("XAUTHORITY", m_launcher->xauthority().toLatin1());
+    m_app->setProcessStartupEnvironment(env);
+}
+
 void Xwayland::updatePrimary()
 {
     Xcb::RandR::ScreenResources resources(kwinApp()->x11RootWindow());
@@ -38,7 +38,16 @@ public:
     Xwayland(Application *app);
     ~Xwayland() override;
 
-    void start();
+    enum class StartMode {
+        Immediately,
+        /**
+         * Xwayland is started when the first X11 client connects to the display. The display
+         * is exported to the environment right away.
+         */
+        OnDemand,
+    };
+
+    void start(StartMode mode = StartMode::Immediately);
 
     XwaylandLauncher *xwaylandLauncher() const;
 
@@ -69,6 +78,7 @@ private:
     void installSocketNotifier();
     void uninstallSocketNotifier();
     void updatePrimary();
+    void exportDisplay();
 
     bool createX11Connection();
     void destroyX11Connection();
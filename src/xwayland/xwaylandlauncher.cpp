@@ -75,6 +75,23 @@ void XwaylandLauncher::start()
         return;
     }
 
+    setupSocket();
+    startInternal();
+}
+
+void XwaylandLauncher::startOnDemand()
+{
+    if (m_xwaylandProcess || !m_socketNotifiers.isEmpty()) {
+        return;
+    }
+
+    m_onDemand = true;
+    setupSocket();
+    watchSockets();
+}
+
+void XwaylandLauncher::setupSocket()
+{
     if (!m_listenFds.isEmpty()) {
         Q_ASSERT(!m_displayName.isEmpty());
     } else {
@@ -85,8 +102,26 @@ void XwaylandLauncher::start()
         m_displayName = m_socket->name();
         m_listenFds = m_socket->fileDescriptors();
     }
+}
 
-    startInternal();
+void XwaylandLauncher::watchSockets()
+{
+    for (int socket : qAsConst(m_listenFds)) {
+        // the connection stays in the backlog of the socket until Xwayland accepts it
+        auto notifier = new QSocketNotifier(socket, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this]() {
+            qCDebug(KWIN_XWL) << "Starting Xwayland for the first X11 client";
+            unwatchSockets();
+            startInternal();
+        });
+        m_socketNotifiers.append(notifier);
+    }
+}
+
+void XwaylandLauncher::unwatchSockets()
+{
+    qDeleteAll(m_socketNotifiers);
+    m_socketNotifiers.clear();
 }
 
 bool XwaylandLauncher::startInternal()
@@ -190,6 +225,7 @@ bool XwaylandLauncher::startInternal()
 
 void XwaylandLauncher::stop()
 {
+    unwatchSockets();
     if (!m_xwaylandProcess) {
         return;
     }
@@ -241,7 +277,12 @@ void XwaylandLauncher::restartInternal()
     if (m_xwaylandProcess) {
         stopInternal();
     }
-    startInternal();
+    if (m_onDemand) {
+        // the clients are gone with the crashed Xwayland
+        watchSockets();
+    } else {
+        startInternal();
+    }
 }
 
 void XwaylandLauncher::maybeDestroyReadyNotifier()
@@ -57,6 +57,11 @@ public:
     void setXauthority(const QString &xauthority);
 
     void start();
+    /**
+     * Listens on the X11 sockets without running Xwayland, it's started as soon as the first
+     * X11 client connects. If Xwayland quits, it's only started again by the next client.
+     */
+    void startOnDemand();
     void stop();
 
     QString displayName() const;
@@ -90,12 +95,17 @@ private Q_SLOTS:
 
 private:
     void maybeDestroyReadyNotifier();
+    void setupSocket();
+    void watchSockets();
+    void unwatchSockets();
     bool startInternal();
     void stopInternal();
     void restartInternal();
 
     QProcess *m_xwaylandProcess = nullptr;
     QSocketNotifier *m_readyNotifier = nullptr;
+    // in the on demand mode, these notify about the first client connecting
+    QVector<QSocketNotifier *> m_socketNotifiers;
     QTimer *m_resetCrashCountTimer = nullptr;
     // this is only used when kwin is run without kwin_wayland_wrapper
     std::unique_ptr<XwaylandSocket> m_socket;
@@ -103,6 +113,7 @@ private:
     QString m_displayName;
     QString m_xAuthority;
 
+    bool m_onDemand = false;
     int m_crashCount = 0;
     int m_xcbConnectionFd = -1;
 };